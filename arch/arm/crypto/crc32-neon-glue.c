@@ -0,0 +1,199 @@
+/*
+ * CRC32(C) using NEON vmull.p8 folding, for ARMv7 cores that have neither
+ * the CRC nor the PMULL instructions of ARMv8
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/crc32.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+
+#include <crypto/internal/hash.h>
+
+#include <asm/hwcap.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+#include <asm/unaligned.h>
+
+#define NEON_MIN_LEN		64U	/* minimum size of buffer
+					 * for crc32_neon_fold_le */
+#define SCALE_F			16U	/* size of NEON register */
+
+void crc32_neon_fold_le(const u8 *buf, unsigned int len, u32 crc,
+			const u64 k[4], u8 out[16]);
+
+/* fold by 64 and by 16 byte constants, as in crc32-ce-core.S */
+static const u64 crc32_neon_k[4] = {
+	0x154442bd4ULL, 0x1c6e41596ULL, 0x1751997d0ULL, 0x0ccaa009eULL,
+};
+
+static const u64 crc32c_neon_k[4] = {
+	0x740eef02ULL, 0x9e4addf8ULL, 0xf20c0dfeULL, 0x14cd00bd6ULL,
+};
+
+static int crc32_cra_init(struct crypto_tfm *tfm)
+{
+	u32 *key = crypto_tfm_ctx(tfm);
+
+	*key = 0;
+	return 0;
+}
+
+static int crc32c_cra_init(struct crypto_tfm *tfm)
+{
+	u32 *key = crypto_tfm_ctx(tfm);
+
+	*key = ~0;
+	return 0;
+}
+
+static int crc32_setkey(struct crypto_shash *hash, const u8 *key,
+			unsigned int keylen)
+{
+	u32 *mctx = crypto_shash_ctx(hash);
+
+	if (keylen != sizeof(u32)) {
+		crypto_shash_set_flags(hash, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	*mctx = le32_to_cpup((__le32 *)key);
+	return 0;
+}
+
+static int crc32_init(struct shash_desc *desc)
+{
+	u32 *mctx = crypto_shash_ctx(desc->tfm);
+	u32 *crc = shash_desc_ctx(desc);
+
+	*crc = *mctx;
+	return 0;
+}
+
+/*
+ * The NEON code folds the buffer down to 16 bytes carrying the same CRC,
+ * which the table driven code then finishes off along with the tail.
+ */
+static u32 crc32_neon_update_le(u32 crc, const u8 *data, unsigned int length,
+				const u64 k[4],
+				u32 (*fallback)(u32, const u8 *, size_t))
+{
+	u8 folded[SCALE_F];
+	unsigned int l;
+
+	if (length >= NEON_MIN_LEN && may_use_simd()) {
+		l = round_down(length, SCALE_F);
+
+		kernel_neon_begin();
+		crc32_neon_fold_le(data, l, crc, k, folded);
+		kernel_neon_end();
+
+		crc = fallback(0, folded, SCALE_F);
+		data += l;
+		length -= l;
+	}
+
+	if (length > 0)
+		crc = fallback(crc, data, length);
+
+	return crc;
+}
+
+static int crc32_update(struct shash_desc *desc, const u8 *data,
+			unsigned int length)
+{
+	u32 *crc = shash_desc_ctx(desc);
+
+	*crc = crc32_neon_update_le(*crc, data, length, crc32_neon_k,
+				    crc32_le);
+	return 0;
+}
+
+static int crc32c_update(struct shash_desc *desc, const u8 *data,
+			 unsigned int length)
+{
+	u32 *crc = shash_desc_ctx(desc);
+
+	*crc = crc32_neon_update_le(*crc, data, length, crc32c_neon_k,
+				    __crc32c_le);
+	return 0;
+}
+
+static int crc32_final(struct shash_desc *desc, u8 *out)
+{
+	u32 *crc = shash_desc_ctx(desc);
+
+	put_unaligned_le32(*crc, out);
+	return 0;
+}
+
+static int crc32c_final(struct shash_desc *desc, u8 *out)
+{
+	u32 *crc = shash_desc_ctx(desc);
+
+	put_unaligned_le32(~*crc, out);
+	return 0;
+}
+
+/*
+ * Ranked above the generic table code but below crc32-arm-ce, which wins
+ * whenever the core has the ARMv8 CRC or PMULL instructions.
+ */
+static struct shash_alg crc32_neon_algs[] = { {
+	.setkey			= crc32_setkey,
+	.init			= crc32_init,
+	.update			= crc32_update,
+	.final			= crc32_final,
+	.descsize		= sizeof(u32),
+	.digestsize		= sizeof(u32),
+
+	.base.cra_ctxsize	= sizeof(u32),
+	.base.cra_init		= crc32_cra_init,
+	.base.cra_name		= "crc32",
+	.base.cra_driver_name	= "crc32-arm-neon",
+	.base.cra_priority	= 150,
+	.base.cra_blocksize	= 1,
+	.base.cra_module	= THIS_MODULE,
+}, {
+	.setkey			= crc32_setkey,
+	.init			= crc32_init,
+	.update			= crc32c_update,
+	.final			= crc32c_final,
+	.descsize		= sizeof(u32),
+	.digestsize		= sizeof(u32),
+
+	.base.cra_ctxsize	= sizeof(u32),
+	.base.cra_init		= crc32c_cra_init,
+	.base.cra_name		= "crc32c",
+	.base.cra_driver_name	= "crc32c-arm-neon",
+	.base.cra_priority	= 150,
+	.base.cra_blocksize	= 1,
+	.base.cra_module	= THIS_MODULE,
+} };
+
+static int __init crc32_neon_mod_init(void)
+{
+	if (!(elf_hwcap & HWCAP_NEON))
+		return -ENODEV;
+
+	return crypto_register_shashes(crc32_neon_algs,
+				       ARRAY_SIZE(crc32_neon_algs));
+}
+
+static void __exit crc32_neon_mod_exit(void)
+{
+	crypto_unregister_shashes(crc32_neon_algs,
+				  ARRAY_SIZE(crc32_neon_algs));
+}
+
+module_init(crc32_neon_mod_init);
+module_exit(crc32_neon_mod_exit);
+
+MODULE_DESCRIPTION("CRC32 and CRC32C using NEON vmull.p8");
+MODULE_LICENSE("GPL v2");
+MODULE_ALIAS_CRYPTO("crc32");
+MODULE_ALIAS_CRYPTO("crc32c");
@@ -0,0 +1,127 @@
+/*
+ * crc32-neon.c - CRC32 and CRC32C folding with NEON vmull.p8
+ *
+ * The folding scheme is the one of crc32-ce-core.S, but without the
+ * ARMv8 64x64 bit vmull.p64. Each 64x64 bit carryless product is built
+ * from eight 8x8 bit vmull.p8 products of byte rotated operands, as in
+ * the p8 fallback of the ARMv8 GHASH code.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Built with NEON enabled, so only call this between kernel_neon_begin()
+ * and kernel_neon_end().
+ */
+
+#include <arm_neon.h>
+
+#define P8(x)		vreinterpret_p8_u64(x)
+#define U64(x)		vreinterpretq_u64_p16(x)
+
+/* Rotate a 128-bit value left by n bytes */
+#define ROL8(x, n)	vreinterpretq_u64_u8(vextq_u8(vreinterpretq_u8_u64(x), \
+					vreinterpretq_u8_u64(x), 16 - (n)))
+
+/*
+ * Partial product pairs cover byte offsets 1 to 4 of both operands. The
+ * masks drop what the high half of each pair holds beyond 64 bits, which
+ * the byte rotation wrapped around.
+ */
+static inline uint64x2_t crc32_neon_fix(uint64x2_t x, uint64_t mask)
+{
+	uint64x1_t lo = vget_low_u64(x), hi = vget_high_u64(x);
+
+	lo = veor_u64(lo, hi);
+	hi = vand_u64(hi, vcreate_u64(mask));
+	lo = veor_u64(lo, hi);
+
+	return vcombine_u64(lo, hi);
+}
+
+/* 64x64 -> 128 bit carryless multiplication */
+static inline uint64x2_t crc32_neon_pmull(uint64x1_t a64, uint64x1_t b64)
+{
+	poly8x8_t a = P8(a64), b = P8(b64);
+	uint64x2_t d, l, m, n, k;
+
+	d = U64(vmull_p8(a, b));
+	l = veorq_u64(U64(vmull_p8(vext_p8(a, a, 1), b)),
+		      U64(vmull_p8(a, vext_p8(b, b, 1))));
+	m = veorq_u64(U64(vmull_p8(vext_p8(a, a, 2), b)),
+		      U64(vmull_p8(a, vext_p8(b, b, 2))));
+	n = veorq_u64(U64(vmull_p8(vext_p8(a, a, 3), b)),
+		      U64(vmull_p8(a, vext_p8(b, b, 3))));
+	k = U64(vmull_p8(a, vext_p8(b, b, 4)));
+
+	l = crc32_neon_fix(l, 0x0000ffffffffffffULL);
+	m = crc32_neon_fix(m, 0x00000000ffffffffULL);
+	n = crc32_neon_fix(n, 0x000000000000ffffULL);
+	k = vcombine_u64(veor_u64(vget_low_u64(k), vget_high_u64(k)),
+			 vcreate_u64(0));
+
+	d = veorq_u64(d, veorq_u64(ROL8(l, 1), ROL8(m, 2)));
+	return veorq_u64(d, veorq_u64(ROL8(n, 3), ROL8(k, 4)));
+}
+
+/* Fold x forward over the distance k was computed for */
+static inline uint64x2_t crc32_neon_fold(uint64x2_t x, uint64x1_t klo,
+					 uint64x1_t khi)
+{
+	return veorq_u64(crc32_neon_pmull(vget_low_u64(x), klo),
+			 crc32_neon_pmull(vget_high_u64(x), khi));
+}
+
+static inline uint64x2_t crc32_neon_load(const uint8_t *p)
+{
+	return vreinterpretq_u64_u8(vld1q_u8(p));
+}
+
+/*
+ * Fold len bytes (a multiple of 16, at least 64) of buf, with the initial
+ * crc, into 16 bytes in out whose CRC, computed from a zero initial value,
+ * is the CRC of the whole buffer. k holds the fold by 64 and by 16 byte
+ * constants, in the layout of crc32-ce-core.S.
+ */
+void crc32_neon_fold_le(const uint8_t *buf, unsigned int len, uint32_t crc,
+			const uint64_t k[4], uint8_t out[16])
+{
+	uint64x1_t k1 = vcreate_u64(k[0]), k2 = vcreate_u64(k[1]);
+	uint64x1_t k3 = vcreate_u64(k[2]), k4 = vcreate_u64(k[3]);
+	uint64x2_t x0, x1, x2, x3;
+
+	x0 = veorq_u64(crc32_neon_load(buf),
+		       vcombine_u64(vcreate_u64(crc), vcreate_u64(0)));
+	x1 = crc32_neon_load(buf + 16);
+	x2 = crc32_neon_load(buf + 32);
+	x3 = crc32_neon_load(buf + 48);
+	buf += 64;
+	len -= 64;
+
+	/* four independent folds keep the multiplier pipeline busy */
+	while (len >= 64) {
+		x0 = veorq_u64(crc32_neon_fold(x0, k1, k2),
+			       crc32_neon_load(buf));
+		x1 = veorq_u64(crc32_neon_fold(x1, k1, k2),
+			       crc32_neon_load(buf + 16));
+		x2 = veorq_u64(crc32_neon_fold(x2, k1, k2),
+			       crc32_neon_load(buf + 32));
+		x3 = veorq_u64(crc32_neon_fold(x3, k1, k2),
+			       crc32_neon_load(buf + 48));
+		buf += 64;
+		len -= 64;
+	}
+
+	x0 = veorq_u64(crc32_neon_fold(x0, k3, k4), x1);
+	x0 = veorq_u64(crc32_neon_fold(x0, k3, k4), x2);
+	x0 = veorq_u64(crc32_neon_fold(x0, k3, k4), x3);
+
+	while (len >= 16) {
+		x0 = veorq_u64(crc32_neon_fold(x0, k3, k4),
+			       crc32_neon_load(buf));
+		buf += 16;
+		len -= 16;
+	}
+
+	vst1q_u8(out, vreinterpretq_u8_u64(x0));
+}
@@ -0,0 +1,184 @@
+/*
+ * poly1305-neon.c - Poly1305 block functions using NEON
+ *
+ * The accumulator is kept in the 26-bit limbs of poly1305_generic.c.
+ * Two blocks are processed per step as h = (h + m1) * r^2 + m2 * r, the
+ * first block in one 32-bit lane and the second in the other, so every
+ * vmull.u32 and vmlal.u32 does two of the limb products. The lanes are
+ * summed and carried in 64-bit d registers, which keeps the accumulator
+ * in NEON registers across the whole loop.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Built with NEON enabled, so only call this between kernel_neon_begin()
+ * and kernel_neon_end().
+ */
+
+#include <arm_neon.h>
+
+#define POLY1305_BLOCK		16
+#define MASK26			0x3ffffff
+
+/* Split two blocks into 26-bit limbs, x into lane 0 and y into lane 1 */
+static inline void poly1305_neon_split(uint32x2_t m[5], uint32x4_t x,
+				       uint32x4_t y, uint32x2_t hibit)
+{
+	uint32x4x2_t z = vzipq_u32(x, y);
+	uint32x2_t w0 = vget_low_u32(z.val[0]), w1 = vget_high_u32(z.val[0]);
+	uint32x2_t w2 = vget_low_u32(z.val[1]), w3 = vget_high_u32(z.val[1]);
+	uint32x2_t mask = vdup_n_u32(MASK26);
+
+	m[0] = vand_u32(w0, mask);
+	m[1] = vand_u32(vorr_u32(vshr_n_u32(w0, 26), vshl_n_u32(w1, 6)), mask);
+	m[2] = vand_u32(vorr_u32(vshr_n_u32(w1, 20), vshl_n_u32(w2, 12)), mask);
+	m[3] = vand_u32(vorr_u32(vshr_n_u32(w2, 14), vshl_n_u32(w3, 18)), mask);
+	m[4] = vorr_u32(vshr_n_u32(w3, 8), hibit);
+}
+
+static inline uint32x4_t poly1305_neon_load(const uint8_t *src)
+{
+	return vreinterpretq_u32_u8(vld1q_u8(src));
+}
+
+static inline uint64x1_t poly1305_neon_sum(uint64x2_t d)
+{
+	return vadd_u64(vget_low_u64(d), vget_high_u64(d));
+}
+
+/*
+ * h = (h + m) * r, summed over both lanes, with s = 5 * r. h is below
+ * 2^32, so reinterpreting it as two 32-bit lanes adds it to lane 0 only.
+ */
+static inline void poly1305_neon_mul(uint64x1_t h[5], const uint32x2_t m[5],
+				     const uint32x2_t r[5],
+				     const uint32x2_t s[5])
+{
+	uint64x1_t mask = vcreate_u64(MASK26);
+	uint32x2_t a[5];
+	uint64x2_t d0, d1, d2, d3, d4;
+	uint64x1_t e0, e1, e2, e3, e4, c;
+	int i;
+
+	for (i = 0; i < 5; i++)
+		a[i] = vadd_u32(m[i], vreinterpret_u32_u64(h[i]));
+
+	d0 = vmull_u32(a[0], r[0]);
+	d0 = vmlal_u32(d0, a[1], s[4]);
+	d0 = vmlal_u32(d0, a[2], s[3]);
+	d0 = vmlal_u32(d0, a[3], s[2]);
+	d0 = vmlal_u32(d0, a[4], s[1]);
+
+	d1 = vmull_u32(a[0], r[1]);
+	d1 = vmlal_u32(d1, a[1], r[0]);
+	d1 = vmlal_u32(d1, a[2], s[4]);
+	d1 = vmlal_u32(d1, a[3], s[3]);
+	d1 = vmlal_u32(d1, a[4], s[2]);
+
+	d2 = vmull_u32(a[0], r[2]);
+	d2 = vmlal_u32(d2, a[1], r[1]);
+	d2 = vmlal_u32(d2, a[2], r[0]);
+	d2 = vmlal_u32(d2, a[3], s[4]);
+	d2 = vmlal_u32(d2, a[4], s[3]);
+
+	d3 = vmull_u32(a[0], r[3]);
+	d3 = vmlal_u32(d3, a[1], r[2]);
+	d3 = vmlal_u32(d3, a[2], r[1]);
+	d3 = vmlal_u32(d3, a[3], r[0]);
+	d3 = vmlal_u32(d3, a[4], s[4]);
+
+	d4 = vmull_u32(a[0], r[4]);
+	d4 = vmlal_u32(d4, a[1], r[3]);
+	d4 = vmlal_u32(d4, a[2], r[2]);
+	d4 = vmlal_u32(d4, a[3], r[1]);
+	d4 = vmlal_u32(d4, a[4], r[0]);
+
+	e0 = poly1305_neon_sum(d0);
+	e1 = poly1305_neon_sum(d1);
+	e2 = poly1305_neon_sum(d2);
+	e3 = poly1305_neon_sum(d3);
+	e4 = poly1305_neon_sum(d4);
+
+	/* (partial) h %= p, in 64 bits as 5 * (e4 >> 26) may not fit 32 */
+	e1 = vadd_u64(e1, vshr_n_u64(e0, 26));	h[0] = vand_u64(e0, mask);
+	e2 = vadd_u64(e2, vshr_n_u64(e1, 26));	h[1] = vand_u64(e1, mask);
+	e3 = vadd_u64(e3, vshr_n_u64(e2, 26));	h[2] = vand_u64(e2, mask);
+	e4 = vadd_u64(e4, vshr_n_u64(e3, 26));	h[3] = vand_u64(e3, mask);
+	c = vshr_n_u64(e4, 26);			h[4] = vand_u64(e4, mask);
+	h[0] = vadd_u64(h[0], vadd_u64(c, vshl_n_u64(c, 2)));
+	h[1] = vadd_u64(h[1], vshr_n_u64(h[0], 26));
+	h[0] = vand_u64(h[0], mask);
+}
+
+static inline void poly1305_neon_get(uint64x1_t hv[5], const uint32_t h[5])
+{
+	int i;
+
+	for (i = 0; i < 5; i++)
+		hv[i] = vcreate_u64(h[i]);
+}
+
+static inline void poly1305_neon_put(uint32_t h[5], const uint64x1_t hv[5])
+{
+	int i;
+
+	for (i = 0; i < 5; i++)
+		h[i] = vget_lane_u64(hv[i], 0);
+}
+
+/*
+ * Process blocks one at a time, adding hibit above each: 1 << 24 for full
+ * message blocks, 0 for a final block that carries its own padding bit.
+ */
+void poly1305_neon_blocks(uint32_t h[5], const uint8_t *src,
+			  const uint32_t r[5], unsigned int blocks,
+			  uint32_t hibit)
+{
+	uint32x2_t rv[5], sv[5], m[5];
+	uint32x2_t hb = vcreate_u32(hibit);
+	uint32x4_t zero = vdupq_n_u32(0);
+	uint64x1_t hv[5];
+	int i;
+
+	for (i = 0; i < 5; i++) {
+		rv[i] = vdup_n_u32(r[i]);
+		sv[i] = vmul_n_u32(rv[i], 5);
+	}
+	poly1305_neon_get(hv, h);
+
+	while (blocks--) {
+		poly1305_neon_split(m, poly1305_neon_load(src), zero, hb);
+		poly1305_neon_mul(hv, m, rv, sv);
+		src += POLY1305_BLOCK;
+	}
+
+	poly1305_neon_put(h, hv);
+}
+
+/* Process pairs of full blocks, with u = r^2 */
+void poly1305_neon_2blocks(uint32_t h[5], const uint8_t *src,
+			   const uint32_t r[5], const uint32_t u[5],
+			   unsigned int pairs)
+{
+	uint32x2_t rv[5], sv[5], m[5];
+	uint32x2_t hb = vdup_n_u32(1 << 24);
+	uint64x1_t hv[5];
+	int i;
+
+	for (i = 0; i < 5; i++) {
+		rv[i] = vcreate_u32((uint64_t)r[i] << 32 | u[i]);
+		sv[i] = vmul_n_u32(rv[i], 5);
+	}
+	poly1305_neon_get(hv, h);
+
+	while (pairs--) {
+		poly1305_neon_split(m, poly1305_neon_load(src),
+				    poly1305_neon_load(src + POLY1305_BLOCK),
+				    hb);
+		poly1305_neon_mul(hv, m, rv, sv);
+		src += 2 * POLY1305_BLOCK;
+	}
+
+	poly1305_neon_put(h, hv);
+}
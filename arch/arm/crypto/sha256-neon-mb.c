@@ -0,0 +1,206 @@
+/*
+ * sha256-neon-mb.c - SHA-256 of four messages at once using NEON
+ *
+ * Each 32-bit lane of a q register carries the same state word of a
+ * different message, so the scalar algorithm runs unchanged on four
+ * messages per instruction. Only the message loads need a transpose.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Built with NEON enabled, so only call this between kernel_neon_begin()
+ * and kernel_neon_end().
+ */
+
+#include <arm_neon.h>
+
+#define SHA256_MB_LANES		4
+#define SHA256_BLOCK		64
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)	vsriq_n_u32(vshlq_n_u32(x, 32 - (n)), x, n)
+
+#define S0(x)	veorq_u32(veorq_u32(ROR(x, 2), ROR(x, 13)), ROR(x, 22))
+#define S1(x)	veorq_u32(veorq_u32(ROR(x, 6), ROR(x, 11)), ROR(x, 25))
+#define s0(x)	veorq_u32(veorq_u32(ROR(x, 7), ROR(x, 18)), vshrq_n_u32(x, 3))
+#define s1(x)	veorq_u32(veorq_u32(ROR(x, 17), ROR(x, 19)), vshrq_n_u32(x, 10))
+
+/* (e & f) ^ (~e & g) */
+#define CH(e, f, g)	vbslq_u32(e, f, g)
+/* where a and b agree that's the result, elsewhere c decides */
+#define MAJ(a, b, c)	vbslq_u32(veorq_u32(a, b), c, b)
+
+/*
+ * Load 16 bytes from each lane and transpose them, so that w[i] holds
+ * big endian word i of every lane.
+ */
+static inline void sha256_mb_load4(uint32x4_t w[4],
+				   const uint8_t *src[SHA256_MB_LANES],
+				   unsigned int off)
+{
+	uint32x4_t r0, r1, r2, r3;
+	uint32x4x2_t t0, t1;
+
+	r0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(src[0] + off)));
+	r1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(src[1] + off)));
+	r2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(src[2] + off)));
+	r3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(src[3] + off)));
+
+	t0 = vtrnq_u32(r0, r1);
+	t1 = vtrnq_u32(r2, r3);
+
+	w[0] = vcombine_u32(vget_low_u32(t0.val[0]), vget_low_u32(t1.val[0]));
+	w[1] = vcombine_u32(vget_low_u32(t0.val[1]), vget_low_u32(t1.val[1]));
+	w[2] = vcombine_u32(vget_high_u32(t0.val[0]),
+			    vget_high_u32(t1.val[0]));
+	w[3] = vcombine_u32(vget_high_u32(t0.val[1]),
+			    vget_high_u32(t1.val[1]));
+}
+
+static void sha256_mb_blocks(uint32x4_t st[8],
+			     const uint8_t *src[SHA256_MB_LANES],
+			     unsigned int blocks)
+{
+	const uint8_t *p[SHA256_MB_LANES];
+	unsigned int i, t;
+
+	for (i = 0; i < SHA256_MB_LANES; i++)
+		p[i] = src[i];
+
+	while (blocks--) {
+		uint32x4_t a = st[0], b = st[1], c = st[2], d = st[3];
+		uint32x4_t e = st[4], f = st[5], g = st[6], h = st[7];
+		uint32x4_t w[16];
+
+		for (i = 0; i < 4; i++)
+			sha256_mb_load4(&w[i * 4], p, i * 16);
+
+		for (t = 0; t < 64; t++) {
+			uint32x4_t t1, t2;
+
+			if (t >= 16)
+				w[t & 15] = vaddq_u32(
+					vaddq_u32(s1(w[(t - 2) & 15]),
+						  w[(t - 7) & 15]),
+					vaddq_u32(s0(w[(t - 15) & 15]),
+						  w[t & 15]));
+
+			t1 = vaddq_u32(vaddq_u32(h, S1(e)),
+				       vaddq_u32(CH(e, f, g),
+						 vaddq_u32(vdupq_n_u32(sha256_k[t]),
+							   w[t & 15])));
+			t2 = vaddq_u32(S0(a), MAJ(a, b, c));
+
+			h = g;
+			g = f;
+			f = e;
+			e = vaddq_u32(d, t1);
+			d = c;
+			c = b;
+			b = a;
+			a = vaddq_u32(t1, t2);
+		}
+
+		st[0] = vaddq_u32(st[0], a);
+		st[1] = vaddq_u32(st[1], b);
+		st[2] = vaddq_u32(st[2], c);
+		st[3] = vaddq_u32(st[3], d);
+		st[4] = vaddq_u32(st[4], e);
+		st[5] = vaddq_u32(st[5], f);
+		st[6] = vaddq_u32(st[6], g);
+		st[7] = vaddq_u32(st[7], h);
+
+		for (i = 0; i < SHA256_MB_LANES; i++)
+			p[i] += SHA256_BLOCK;
+	}
+}
+
+/*
+ * Finish num_msgs (at most four) messages that start from the same hash
+ * state: state/count/partial as in struct sha256_state, followed by len
+ * bytes from data[i] each. The final states end up in digests[i], in CPU
+ * byte order. Unused lanes hash message 0 again and are discarded.
+ */
+void sha256_neon_mb_finup(const uint32_t state[8], uint64_t count,
+			  const uint8_t *partial,
+			  const uint8_t * const data[], unsigned int len,
+			  uint32_t digests[][8], unsigned int num_msgs)
+{
+	uint8_t buf[SHA256_MB_LANES][2 * SHA256_BLOCK]
+		__attribute__((aligned(16)));
+	const uint8_t *src[SHA256_MB_LANES];
+	uint32_t out[8][SHA256_MB_LANES];
+	uint64_t bits = (count + len) << 3;
+	unsigned int fill = count % SHA256_BLOCK;
+	unsigned int head = 0, off = 0, tail, blocks, i, j;
+	uint32x4_t st[8];
+
+	for (i = 0; i < 8; i++)
+		st[i] = vdupq_n_u32(state[i]);
+
+	/* complete the block the common prefix left partially filled */
+	if (fill) {
+		if (fill + len >= SHA256_BLOCK) {
+			off = SHA256_BLOCK - fill;
+			for (i = 0; i < SHA256_MB_LANES; i++) {
+				const uint8_t *d = data[i < num_msgs ? i : 0];
+
+				__builtin_memcpy(buf[i], partial, fill);
+				__builtin_memcpy(buf[i] + fill, d, off);
+				src[i] = buf[i];
+			}
+			sha256_mb_blocks(st, src, 1);
+		} else {
+			head = fill;
+		}
+	}
+
+	blocks = (len - off) / SHA256_BLOCK;
+	for (i = 0; i < SHA256_MB_LANES; i++)
+		src[i] = data[i < num_msgs ? i : 0] + off;
+	sha256_mb_blocks(st, src, blocks);
+	off += blocks * SHA256_BLOCK;
+
+	/* pad what is left into one or two blocks per lane */
+	tail = head + len - off;
+	blocks = tail + 9 > SHA256_BLOCK ? 2 : 1;
+	for (i = 0; i < SHA256_MB_LANES; i++) {
+		uint8_t *b = buf[i];
+
+		__builtin_memcpy(b, partial, head);
+		__builtin_memcpy(b + head, data[i < num_msgs ? i : 0] + off,
+				 len - off);
+		b[tail] = 0x80;
+		__builtin_memset(b + tail + 1, 0,
+				 blocks * SHA256_BLOCK - 8 - tail - 1);
+		for (j = 0; j < 8; j++)
+			b[blocks * SHA256_BLOCK - 1 - j] = bits >> (j * 8);
+		src[i] = b;
+	}
+	sha256_mb_blocks(st, src, blocks);
+
+	for (i = 0; i < 8; i++)
+		vst1q_u32(out[i], st[i]);
+	for (i = 0; i < num_msgs; i++)
+		for (j = 0; j < 8; j++)
+			digests[i][j] = out[j][i];
+}
@@ -23,12 +23,20 @@
 #include <asm/byteorder.h>
 #include <asm/simd.h>
 #include <asm/neon.h>
+#include <asm/unaligned.h>
 
 #include "sha256_glue.h"
 
 asmlinkage void sha256_block_data_order_neon(u32 *digest, const void *data,
 					     unsigned int num_blks);
 
+#define SHA256_NEON_MB_MSGS	4
+
+void sha256_neon_mb_finup(const u32 state[8], u64 count, const u8 *partial,
+			  const u8 * const data[], unsigned int len,
+			  u32 digests[][SHA256_DIGEST_SIZE / 4],
+			  unsigned int num_msgs);
+
 static int sha256_update(struct shash_desc *desc, const u8 *data,
 			 unsigned int len)
 {
@@ -68,13 +76,49 @@ static int sha256_final(struct shash_desc *desc, u8 *out)
 	return sha256_finup(desc, NULL, 0, out);
 }
 
+static int sha256_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			   unsigned int len, u8 * const outs[],
+			   unsigned int num_msgs)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int ds = crypto_shash_digestsize(desc->tfm);
+	u32 digests[SHA256_NEON_MB_MSGS][SHA256_DIGEST_SIZE / 4];
+	unsigned int i, j;
+
+	if (!may_use_simd()) {
+		struct sha256_state orig = *sctx;
+
+		for (i = 0; i < num_msgs; i++) {
+			*sctx = orig;
+			crypto_sha256_arm_finup(desc, data[i], len, outs[i]);
+		}
+		memzero_explicit(&orig, sizeof(orig));
+		return 0;
+	}
+
+	kernel_neon_begin();
+	sha256_neon_mb_finup(sctx->state, sctx->count, sctx->buf, data, len,
+			     digests, num_msgs);
+	kernel_neon_end();
+
+	for (i = 0; i < num_msgs; i++)
+		for (j = 0; j < ds / sizeof(u32); j++)
+			put_unaligned_be32(digests[i][j], outs[i] + j * 4);
+
+	memzero_explicit(digests, sizeof(digests));
+	*sctx = (struct sha256_state){};
+	return 0;
+}
+
 struct shash_alg sha256_neon_algs[] = { {
 	.digestsize	=	SHA256_DIGEST_SIZE,
 	.init		=	sha256_base_init,
 	.update		=	sha256_update,
 	.final		=	sha256_final,
 	.finup		=	sha256_finup,
+	.finup_mb	=	sha256_finup_mb,
 	.descsize	=	sizeof(struct sha256_state),
+	.mb_max_msgs	=	SHA256_NEON_MB_MSGS,
 	.base		=	{
 		.cra_name	=	"sha256",
 		.cra_driver_name =	"sha256-neon",
@@ -89,7 +133,9 @@ struct shash_alg sha256_neon_algs[] = { {
 	.update		=	sha256_update,
 	.final		=	sha256_final,
 	.finup		=	sha256_finup,
+	.finup_mb	=	sha256_finup_mb,
 	.descsize	=	sizeof(struct sha256_state),
+	.mb_max_msgs	=	SHA256_NEON_MB_MSGS,
 	.base		=	{
 		.cra_name	=	"sha224",
 		.cra_driver_name =	"sha224-neon",
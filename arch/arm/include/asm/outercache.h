@@ -30,6 +30,8 @@ struct outer_cache_fns {
 	void (*clean_range)(unsigned long, unsigned long);
 	void (*flush_range)(unsigned long, unsigned long);
 	void (*flush_all)(void);
+	void (*clean_all_by_index)(void);
+	void (*flush_all_by_index)(void);
 	void (*disable)(void);
 #ifdef CONFIG_OUTER_CACHE_SYNC
 	void (*sync)(void);
@@ -94,6 +96,39 @@ static inline void outer_flush_all(void)
 		outer_cache.flush_all();
 }
 
+/**
+ * outer_has_all_by_index - whether the outer_*_all_by_index() calls work
+ */
+static inline bool outer_has_all_by_index(void)
+{
+	return outer_cache.clean_all_by_index && outer_cache.flush_all_by_index;
+}
+
+/**
+ * outer_clean_all_by_index - clean all outer cache lines, one at a time
+ *
+ * Unlike outer_flush_all(), this may run alongside range operations on
+ * other CPUs, with interrupts enabled. Meant for buffers too large for
+ * the range operations to be worth it.
+ */
+static inline void outer_clean_all_by_index(void)
+{
+	if (outer_cache.clean_all_by_index)
+		outer_cache.clean_all_by_index();
+}
+
+/**
+ * outer_flush_all_by_index - clean and invalidate all outer cache lines,
+ * one at a time
+ *
+ * The notes of outer_clean_all_by_index() apply.
+ */
+static inline void outer_flush_all_by_index(void)
+{
+	if (outer_cache.flush_all_by_index)
+		outer_cache.flush_all_by_index();
+}
+
 /**
  * outer_disable - clean, invalidate and disable the outer cache
  *
@@ -124,6 +159,9 @@ static inline void outer_clean_range(phys_addr_t start, phys_addr_t end)
 static inline void outer_flush_range(phys_addr_t start, phys_addr_t end)
 { }
 static inline void outer_flush_all(void) { }
+static inline bool outer_has_all_by_index(void) { return false; }
+static inline void outer_clean_all_by_index(void) { }
+static inline void outer_flush_all_by_index(void) { }
 static inline void outer_disable(void) { }
 static inline void outer_resume(void) { }
 
@@ -83,6 +83,12 @@
 #define PTE_EXT_SHARED		(_AT(pteval_t, 1) << 10)	/* v6 */
 #define PTE_EXT_NG		(_AT(pteval_t, 1) << 11)	/* v6 */
 
+/*
+ *   - large page (64K), v6
+ */
+#define PTE_LARGE_TEX(x)	(_AT(pteval_t, (x)) << 12)
+#define PTE_LARGE_XN		(_AT(pteval_t, 1) << 15)
+
 /*
  *   - small page
  */
@@ -214,7 +214,32 @@ static inline pte_t *pmd_page_vaddr(pmd_t pmd)
 #define pte_page(pte)		pfn_to_page(pte_pfn(pte))
 #define mk_pte(page,prot)	pfn_pte(page_to_pfn(page), prot)
 
-#define pte_clear(mm,addr,ptep)	set_pte_ext(ptep, __pte(0), 0)
+#ifdef CONFIG_ARM_LARGE_USER_PAGES
+extern void __split_large_pte(struct mm_struct *mm, unsigned long addr,
+			      pte_t *ptep);
+
+/*
+ * The hardware entries of a 64K large page are all alike, so changing
+ * one of them first returns the whole block to small pages.
+ */
+static inline void split_large_pte(struct mm_struct *mm, unsigned long addr,
+				   pte_t *ptep)
+{
+	if (unlikely((pte_val(ptep[PTE_HWTABLE_PTRS]) & PTE_TYPE_MASK) ==
+		     PTE_TYPE_LARGE))
+		__split_large_pte(mm, addr, ptep);
+}
+#else
+static inline void split_large_pte(struct mm_struct *mm, unsigned long addr,
+				   pte_t *ptep)
+{
+}
+#endif
+
+#define pte_clear(mm,addr,ptep)	do {				\
+	split_large_pte(mm, addr, ptep);			\
+	set_pte_ext(ptep, __pte(0), 0);				\
+} while (0)
 
 #define pte_isset(pte, val)	((u32)(val) == (val) ? pte_val(pte) & (val) \
 						: !!(pte_val(pte) & (val)))
@@ -251,6 +276,7 @@ static inline void set_pte_at(struct mm_struct *mm, unsigned long addr,
 		ext |= PTE_EXT_NG;
 	}
 
+	split_large_pte(mm, addr, ptep);
 	set_pte_ext(ptep, pteval, ext);
 }
 
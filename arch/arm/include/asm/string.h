@@ -26,6 +26,16 @@ extern void * memset(void *, int, __kernel_size_t);
 
 extern void __memzero(void *ptr, __kernel_size_t n);
 
+/*
+ * memcpy() for large copies from contexts that may use kernel mode NEON,
+ * it falls back to memcpy() wherever NEON cannot be used.
+ */
+#ifdef CONFIG_ARM_NEON_COPY
+extern void * memcpy_neon(void *, const void *, __kernel_size_t);
+#else
+#define memcpy_neon(to, from, n)	memcpy(to, from, n)
+#endif
+
 #define memset(p,v,n)							\
 	({								\
 	 	void *__p = (p); size_t __n = n;			\
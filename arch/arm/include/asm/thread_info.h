@@ -62,6 +62,13 @@ struct thread_info {
 #endif
 	union fp_state		fpstate __attribute__((aligned(8)));
 	union vfp_state		vfpstate;
+#ifdef CONFIG_VFP_EAGER_RESTORE
+	__u32			vfp_traps;	/* lazy VFP enables */
+	__u32			vfp_saves;	/* VFP saves on switch out */
+	__u32			vfp_loads;	/* eager VFP loads on switch in */
+	__u8			vfp_hot;	/* slices in a row using VFP */
+	__u8			vfp_loaded;	/* VFP loaded eagerly this slice */
+#endif
 #ifdef CONFIG_ARM_THUMBEE
 	unsigned long		thumbee_state;	/* ThumbEE Handler Base register */
 #endif
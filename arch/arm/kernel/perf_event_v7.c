@@ -85,9 +85,34 @@
 #define ARMV7_A8_PERFCTR_STALL_ISIDE			0x56
 
 /* ARMv7 Cortex-A9 specific event types */
-#define ARMV7_A9_PERFCTR_INSTR_CORE_RENAME		0x68
+#define ARMV7_A9_PERFCTR_COHERENT_LINEFILL_MISS		0x50
+#define ARMV7_A9_PERFCTR_COHERENT_LINEFILL_HIT		0x51
 #define ARMV7_A9_PERFCTR_STALL_ICACHE			0x60
+#define ARMV7_A9_PERFCTR_STALL_DCACHE			0x61
+#define ARMV7_A9_PERFCTR_STALL_TLB			0x62
+#define ARMV7_A9_PERFCTR_STREX_PASSED			0x63
+#define ARMV7_A9_PERFCTR_STREX_FAILED			0x64
+#define ARMV7_A9_PERFCTR_DATA_EVICTION			0x65
 #define ARMV7_A9_PERFCTR_STALL_DISPATCH			0x66
+#define ARMV7_A9_PERFCTR_ISSUE_EMPTY			0x67
+#define ARMV7_A9_PERFCTR_INSTR_CORE_RENAME		0x68
+#define ARMV7_A9_PERFCTR_PRED_FUNC_RETURN		0x6e
+#define ARMV7_A9_PERFCTR_INSTR_MAIN_UNIT		0x70
+#define ARMV7_A9_PERFCTR_INSTR_SECOND_UNIT		0x71
+#define ARMV7_A9_PERFCTR_INSTR_LDST			0x72
+#define ARMV7_A9_PERFCTR_INSTR_FP			0x73
+#define ARMV7_A9_PERFCTR_INSTR_NEON			0x74
+#define ARMV7_A9_PERFCTR_STALL_PLD			0x80
+#define ARMV7_A9_PERFCTR_STALL_WRITE			0x81
+#define ARMV7_A9_PERFCTR_STALL_ITLB			0x82
+#define ARMV7_A9_PERFCTR_STALL_DTLB			0x83
+#define ARMV7_A9_PERFCTR_STALL_IUTLB			0x84
+#define ARMV7_A9_PERFCTR_STALL_DUTLB			0x85
+#define ARMV7_A9_PERFCTR_STALL_DMB			0x86
+#define ARMV7_A9_PERFCTR_INSTR_ISB			0x90
+#define ARMV7_A9_PERFCTR_INSTR_DSB			0x91
+#define ARMV7_A9_PERFCTR_INSTR_DMB			0x92
+#define ARMV7_A9_PERFCTR_EXT_IRQ			0x93
 
 /* ARMv7 Cortex-A5 specific event types */
 #define ARMV7_A5_PERFCTR_PREFETCH_LINEFILL		0xc2
@@ -596,6 +621,92 @@ static struct attribute_group armv7_pmuv1_events_attr_group = {
 	.attrs = armv7_pmuv1_event_attrs,
 };
 
+/* Cortex-A9 implementation defined events, see its TRM */
+ARMV7_EVENT_ATTR(a9_coherent_linefill_miss, ARMV7_A9_PERFCTR_COHERENT_LINEFILL_MISS);
+ARMV7_EVENT_ATTR(a9_coherent_linefill_hit, ARMV7_A9_PERFCTR_COHERENT_LINEFILL_HIT);
+ARMV7_EVENT_ATTR(a9_stall_icache, ARMV7_A9_PERFCTR_STALL_ICACHE);
+ARMV7_EVENT_ATTR(a9_stall_dcache, ARMV7_A9_PERFCTR_STALL_DCACHE);
+ARMV7_EVENT_ATTR(a9_stall_tlb, ARMV7_A9_PERFCTR_STALL_TLB);
+ARMV7_EVENT_ATTR(a9_strex_passed, ARMV7_A9_PERFCTR_STREX_PASSED);
+ARMV7_EVENT_ATTR(a9_strex_failed, ARMV7_A9_PERFCTR_STREX_FAILED);
+ARMV7_EVENT_ATTR(a9_data_eviction, ARMV7_A9_PERFCTR_DATA_EVICTION);
+ARMV7_EVENT_ATTR(a9_stall_dispatch, ARMV7_A9_PERFCTR_STALL_DISPATCH);
+ARMV7_EVENT_ATTR(a9_issue_empty, ARMV7_A9_PERFCTR_ISSUE_EMPTY);
+ARMV7_EVENT_ATTR(a9_inst_core_renamed, ARMV7_A9_PERFCTR_INSTR_CORE_RENAME);
+ARMV7_EVENT_ATTR(a9_pred_func_return, ARMV7_A9_PERFCTR_PRED_FUNC_RETURN);
+ARMV7_EVENT_ATTR(a9_inst_main_unit, ARMV7_A9_PERFCTR_INSTR_MAIN_UNIT);
+ARMV7_EVENT_ATTR(a9_inst_second_unit, ARMV7_A9_PERFCTR_INSTR_SECOND_UNIT);
+ARMV7_EVENT_ATTR(a9_inst_ldst, ARMV7_A9_PERFCTR_INSTR_LDST);
+ARMV7_EVENT_ATTR(a9_inst_fp, ARMV7_A9_PERFCTR_INSTR_FP);
+ARMV7_EVENT_ATTR(a9_inst_neon, ARMV7_A9_PERFCTR_INSTR_NEON);
+ARMV7_EVENT_ATTR(a9_stall_pld, ARMV7_A9_PERFCTR_STALL_PLD);
+ARMV7_EVENT_ATTR(a9_stall_write, ARMV7_A9_PERFCTR_STALL_WRITE);
+ARMV7_EVENT_ATTR(a9_stall_itlb, ARMV7_A9_PERFCTR_STALL_ITLB);
+ARMV7_EVENT_ATTR(a9_stall_dtlb, ARMV7_A9_PERFCTR_STALL_DTLB);
+ARMV7_EVENT_ATTR(a9_stall_iutlb, ARMV7_A9_PERFCTR_STALL_IUTLB);
+ARMV7_EVENT_ATTR(a9_stall_dutlb, ARMV7_A9_PERFCTR_STALL_DUTLB);
+ARMV7_EVENT_ATTR(a9_stall_dmb, ARMV7_A9_PERFCTR_STALL_DMB);
+ARMV7_EVENT_ATTR(a9_inst_isb, ARMV7_A9_PERFCTR_INSTR_ISB);
+ARMV7_EVENT_ATTR(a9_inst_dsb, ARMV7_A9_PERFCTR_INSTR_DSB);
+ARMV7_EVENT_ATTR(a9_inst_dmb, ARMV7_A9_PERFCTR_INSTR_DMB);
+ARMV7_EVENT_ATTR(a9_ext_irq, ARMV7_A9_PERFCTR_EXT_IRQ);
+
+static struct attribute *armv7_a9_event_attrs[] = {
+	&armv7_event_attr_sw_incr.attr.attr,
+	&armv7_event_attr_l1i_cache_refill.attr.attr,
+	&armv7_event_attr_l1i_tlb_refill.attr.attr,
+	&armv7_event_attr_l1d_cache_refill.attr.attr,
+	&armv7_event_attr_l1d_cache.attr.attr,
+	&armv7_event_attr_l1d_tlb_refill.attr.attr,
+	&armv7_event_attr_ld_retired.attr.attr,
+	&armv7_event_attr_st_retired.attr.attr,
+	&armv7_event_attr_inst_retired.attr.attr,
+	&armv7_event_attr_exc_taken.attr.attr,
+	&armv7_event_attr_exc_return.attr.attr,
+	&armv7_event_attr_cid_write_retired.attr.attr,
+	&armv7_event_attr_pc_write_retired.attr.attr,
+	&armv7_event_attr_br_immed_retired.attr.attr,
+	&armv7_event_attr_br_return_retired.attr.attr,
+	&armv7_event_attr_unaligned_ldst_retired.attr.attr,
+	&armv7_event_attr_br_mis_pred.attr.attr,
+	&armv7_event_attr_cpu_cycles.attr.attr,
+	&armv7_event_attr_br_pred.attr.attr,
+	&armv7_event_attr_a9_coherent_linefill_miss.attr.attr,
+	&armv7_event_attr_a9_coherent_linefill_hit.attr.attr,
+	&armv7_event_attr_a9_stall_icache.attr.attr,
+	&armv7_event_attr_a9_stall_dcache.attr.attr,
+	&armv7_event_attr_a9_stall_tlb.attr.attr,
+	&armv7_event_attr_a9_strex_passed.attr.attr,
+	&armv7_event_attr_a9_strex_failed.attr.attr,
+	&armv7_event_attr_a9_data_eviction.attr.attr,
+	&armv7_event_attr_a9_stall_dispatch.attr.attr,
+	&armv7_event_attr_a9_issue_empty.attr.attr,
+	&armv7_event_attr_a9_inst_core_renamed.attr.attr,
+	&armv7_event_attr_a9_pred_func_return.attr.attr,
+	&armv7_event_attr_a9_inst_main_unit.attr.attr,
+	&armv7_event_attr_a9_inst_second_unit.attr.attr,
+	&armv7_event_attr_a9_inst_ldst.attr.attr,
+	&armv7_event_attr_a9_inst_fp.attr.attr,
+	&armv7_event_attr_a9_inst_neon.attr.attr,
+	&armv7_event_attr_a9_stall_pld.attr.attr,
+	&armv7_event_attr_a9_stall_write.attr.attr,
+	&armv7_event_attr_a9_stall_itlb.attr.attr,
+	&armv7_event_attr_a9_stall_dtlb.attr.attr,
+	&armv7_event_attr_a9_stall_iutlb.attr.attr,
+	&armv7_event_attr_a9_stall_dutlb.attr.attr,
+	&armv7_event_attr_a9_stall_dmb.attr.attr,
+	&armv7_event_attr_a9_inst_isb.attr.attr,
+	&armv7_event_attr_a9_inst_dsb.attr.attr,
+	&armv7_event_attr_a9_inst_dmb.attr.attr,
+	&armv7_event_attr_a9_ext_irq.attr.attr,
+	NULL,
+};
+
+static struct attribute_group armv7_a9_events_attr_group = {
+	.name = "events",
+	.attrs = armv7_a9_event_attrs,
+};
+
 ARMV7_EVENT_ATTR(mem_access, ARMV7_PERFCTR_MEM_ACCESS);
 ARMV7_EVENT_ATTR(l1i_cache, ARMV7_PERFCTR_L1_ICACHE_ACCESS);
 ARMV7_EVENT_ATTR(l1d_cache_wb, ARMV7_PERFCTR_L1_DCACHE_WB);
@@ -1209,7 +1320,7 @@ static int armv7_a9_pmu_init(struct arm_pmu *cpu_pmu)
 	cpu_pmu->name		= "armv7_cortex_a9";
 	cpu_pmu->map_event	= armv7_a9_map_event;
 	cpu_pmu->attr_groups[ARMPMU_ATTR_GROUP_EVENTS] =
-		&armv7_pmuv1_events_attr_group;
+		&armv7_a9_events_attr_group;
 	cpu_pmu->attr_groups[ARMPMU_ATTR_GROUP_FORMATS] =
 		&armv7_pmu_format_attr_group;
 	return armv7_probe_num_events(cpu_pmu);
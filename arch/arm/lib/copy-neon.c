@@ -0,0 +1,79 @@
+/*
+ *  linux/arch/arm/lib/copy-neon.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Large kernel copies with NEON loads and stores, which keep more of the
+ * memory bandwidth busy than ldm/stm do on cores like the Cortex-A9.
+ * Small copies and copies from interrupt context, where kernel mode NEON
+ * is not allowed, go to the ARM routines.  Entering kernel mode NEON may
+ * have to save the VFP state of the current task, so the threshold is
+ * kept well above that cost.
+ */
+
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/jump_label.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#define NEON_COPY_MIN		512
+#define NEON_COPY_ALIGN		64
+
+extern void __memcpy_neon(void *to, const void *from, size_t n);
+extern void __copy_page_std(void *to, const void *from);
+
+static DEFINE_STATIC_KEY_FALSE(neon_copy_key);
+
+static inline bool neon_copy_usable(void)
+{
+	return static_branch_likely(&neon_copy_key) && !in_interrupt();
+}
+
+void *memcpy_neon(void *to, const void *from, size_t n)
+{
+	size_t head, bulk;
+
+	if (n < NEON_COPY_MIN || !neon_copy_usable())
+		return memcpy(to, from, n);
+
+	/* Align the destination, the NEON stores rely on it */
+	head = -(unsigned long)to & (NEON_COPY_ALIGN - 1);
+	bulk = (n - head) & ~(NEON_COPY_ALIGN - 1);
+
+	memcpy(to, from, head);
+	kernel_neon_begin();
+	__memcpy_neon(to + head, from + head, bulk);
+	kernel_neon_end();
+	memcpy(to + head + bulk, from + head + bulk, n - head - bulk);
+
+	return to;
+}
+EXPORT_SYMBOL(memcpy_neon);
+
+/* Overrides the weak copy_page in copy_page.S */
+void copy_page(void *to, const void *from)
+{
+	if (!neon_copy_usable()) {
+		__copy_page_std(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__memcpy_neon(to, from, PAGE_SIZE);
+	kernel_neon_end();
+}
+
+static int __init neon_copy_init(void)
+{
+	/* elf_hwcap is final once vfp_init() has run */
+	if (cpu_has_neon())
+		static_branch_enable(&neon_copy_key);
+
+	return 0;
+}
+arch_initcall(neon_copy_init);
@@ -91,7 +91,7 @@ __copy_to_user_memcpy(void __user *to, const void *from, unsigned long n)
 	int atomic;
 
 	if (uaccess_kernel()) {
-		memcpy((void *)to, from, n);
+		memcpy_neon((void *)to, from, n);
 		return 0;
 	}
 
@@ -119,7 +119,7 @@ __copy_to_user_memcpy(void __user *to, const void *from, unsigned long n)
 			tocopy = n;
 
 		ua_flags = uaccess_save_and_enable();
-		memcpy((void *)to, from, tocopy);
+		memcpy_neon((void *)to, from, tocopy);
 		uaccess_restore(ua_flags);
 		to += tocopy;
 		from += tocopy;
@@ -0,0 +1,87 @@
+/*
+ * Timing of the Zynq machine init steps on the boot path
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Enabled with zynq_boot_time on the command line. The steps up to and
+ * including the timer init run before sched_clock does, so they are
+ * counted in CPU cycles with the Cortex-A9 PMU cycle counter. The PMU
+ * driver takes that counter over later on, from then on the steps are
+ * timed with local_clock().
+ *
+ * The time spent before the kernel runs, decompressing the zImage, can
+ * only be measured by the decompressor itself. It passes it on with
+ * zynq_zimage_us=<microseconds>, which is logged as is.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/sched/clock.h>
+#include <asm/barrier.h>
+#include "common.h"
+
+#define PMCR_E		BIT(0)
+#define PMCR_C		BIT(2)
+#define PMCNTEN_CCNT	BIT(31)
+
+bool zynq_boot_time __read_mostly;
+
+static int __init zynq_boot_time_setup(char *str)
+{
+	zynq_boot_time = true;
+
+	/* Reset and start the cycle counter, counting every cycle */
+	asm volatile("mcr p15, 0, %0, c9, c12, 0" : : "r" (PMCR_E | PMCR_C));
+	asm volatile("mcr p15, 0, %0, c9, c12, 1" : : "r" (PMCNTEN_CCNT));
+	isb();
+
+	return 0;
+}
+early_param("zynq_boot_time", zynq_boot_time_setup);
+
+static int __init zynq_zimage_us_setup(char *str)
+{
+	unsigned int us;
+
+	if (!str || kstrtouint(str, 0, &us))
+		return -EINVAL;
+
+	pr_info("zynq: zImage decompression took %u us\n", us);
+
+	return 0;
+}
+early_param("zynq_zimage_us", zynq_zimage_us_setup);
+
+u32 __init zynq_boot_cycles(void)
+{
+	u32 cycles;
+
+	if (!zynq_boot_time)
+		return 0;
+
+	asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r" (cycles));
+
+	return cycles;
+}
+
+void __init zynq_boot_report_cycles(const char *step, u32 start)
+{
+	if (zynq_boot_time)
+		pr_info("zynq: %s took %u cycles\n", step,
+			zynq_boot_cycles() - start);
+}
+
+u64 zynq_boot_clock(void)
+{
+	return zynq_boot_time ? local_clock() : 0;
+}
+
+void zynq_boot_report(const char *step, u64 start)
+{
+	if (zynq_boot_time)
+		pr_info("zynq: %s took %llu us\n", step,
+			div_u64(local_clock() - start, NSEC_PER_USEC));
+}
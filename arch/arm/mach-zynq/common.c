@@ -26,6 +26,7 @@
 #include <linux/of_irq.h>
 #include <linux/of_platform.h>
 #include <linux/of.h>
+#include <linux/platform_data/cpuidle-zynq.h>
 #include <linux/memblock.h>
 #include <linux/irqchip.h>
 #include <linux/irqchip/arm-gic.h>
@@ -58,12 +59,27 @@ void __iomem *zynq_scu_base;
  */
 static void __init zynq_memory_init(void)
 {
+	u32 start = zynq_boot_cycles();
+
 	if (!__pa(PAGE_OFFSET))
 		memblock_reserve(__pa(PAGE_OFFSET), 0x80000);
+
+	zynq_boot_report_cycles("memory init", start);
 }
 
+#ifdef CONFIG_ARM_ZYNQ_CPUIDLE
+static struct cpuidle_zynq_data zynq_cpuidle_pdata = {
+	.self_refresh_available	= zynq_pm_self_refresh_available,
+	.prepare_self_refresh	= zynq_pm_prepare_self_refresh,
+	.enter_self_refresh	= zynq_pm_enter_self_refresh,
+};
+#endif
+
 static struct platform_device zynq_cpuidle_device = {
 	.name = "cpuidle-zynq",
+#ifdef CONFIG_ARM_ZYNQ_CPUIDLE
+	.dev.platform_data = &zynq_cpuidle_pdata,
+#endif
 };
 
 /**
@@ -100,8 +116,15 @@ static int __init zynq_get_revision(void)
 
 static void __init zynq_init_late(void)
 {
+	u64 start = zynq_boot_clock();
+
 	zynq_core_pm_init();
 	zynq_pm_late_init();
+
+	/* Only now that the self refresh code sits in OCM */
+	platform_device_register(&zynq_cpuidle_device);
+
+	zynq_boot_report("late init", start);
 }
 
 /**
@@ -113,6 +136,7 @@ static void __init zynq_init_machine(void)
 	struct soc_device_attribute *soc_dev_attr;
 	struct soc_device *soc_dev;
 	struct device *parent = NULL;
+	u64 start = zynq_boot_clock();
 
 	soc_dev_attr = kzalloc(sizeof(*soc_dev_attr), GFP_KERNEL);
 	if (!soc_dev_attr)
@@ -143,14 +167,18 @@ out:
 	 */
 	of_platform_default_populate(NULL, NULL, parent);
 
-	platform_device_register(&zynq_cpuidle_device);
+	zynq_boot_report("machine init", start);
 }
 
 static void __init zynq_timer_init(void)
 {
+	u32 start = zynq_boot_cycles();
+
 	zynq_clock_init();
 	of_clk_init(NULL);
 	clocksource_probe();
+
+	zynq_boot_report_cycles("clock and timer init", start);
 }
 
 static struct map_desc zynq_cortex_a9_scu_map __initdata = {
@@ -176,14 +204,24 @@ static void __init zynq_scu_map_io(void)
  */
 static void __init zynq_map_io(void)
 {
+	u32 start = zynq_boot_cycles();
+
 	debug_ll_io_init();
 	zynq_scu_map_io();
+
+	zynq_boot_report_cycles("SCU map", start);
 }
 
 static void __init zynq_irq_init(void)
 {
+	u32 start = zynq_boot_cycles();
+
 	zynq_early_slcr_init();
+	zynq_boot_report_cycles("SLCR init", start);
+
+	start = zynq_boot_cycles();
 	irqchip_init();
+	zynq_boot_report_cycles("irqchip init", start);
 }
 
 static const char * const zynq_dt_match[] = {
@@ -192,9 +230,12 @@ static const char * const zynq_dt_match[] = {
 };
 
 DT_MACHINE_START(XILINX_EP107, "Xilinx Zynq Platform")
-	/* 64KB way size, 8-way associativity, parity disabled */
-	.l2c_aux_val    = 0x00400000,
-	.l2c_aux_mask	= 0xffbfffff,
+	/*
+	 * 64KB way size, 8-way associativity, parity disabled, event
+	 * monitor bus enabled for the L2C-310 PMU
+	 */
+	.l2c_aux_val    = 0x00500000,
+	.l2c_aux_mask	= 0xffafffff,
 	.smp		= smp_ops(zynq_smp_ops),
 	.map_io		= zynq_map_io,
 	.init_irq	= zynq_irq_init,
@@ -24,6 +24,7 @@ extern void zynq_slcr_cpu_start(int cpu);
 extern bool zynq_slcr_cpu_state_read(int cpu);
 extern void zynq_slcr_cpu_state_write(int cpu, bool die);
 extern u32 zynq_slcr_get_device_id(void);
+extern void __iomem *zynq_slcr_get_base(void);
 
 #ifdef CONFIG_SMP
 extern char zynq_secondary_trampoline;
@@ -35,7 +36,16 @@ extern const struct smp_operations zynq_smp_ops;
 
 extern void __iomem *zynq_scu_base;
 
+extern bool zynq_boot_time;
+u32 zynq_boot_cycles(void);
+void zynq_boot_report_cycles(const char *step, u32 start);
+u64 zynq_boot_clock(void);
+void zynq_boot_report(const char *step, u64 start);
+
 void zynq_pm_late_init(void);
+bool zynq_pm_self_refresh_available(void);
+void zynq_pm_prepare_self_refresh(void);
+void zynq_pm_enter_self_refresh(int cpu);
 
 static inline void zynq_core_pm_init(void)
 {
@@ -0,0 +1,208 @@
+/*
+ * Load based parking of the second Cortex-A9 core
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * While the whole system needs less than one core, CPU1 is taken offline.
+ * zynq_cpu_kill() then holds it in reset with its clock stopped through
+ * the SLCR. As soon as the load goes up again it is brought back, its
+ * trampoline at the reset vector is still in place from the last start.
+ *
+ * Parking is off by default and is switched on with zynq_park.enable=1,
+ * either on the command line or through /sys/module/zynq_park/parameters.
+ * Only a core parked here is brought back, a core taken offline by the
+ * user stays offline. With nohz_full=1 CPU1 is left alone.
+ */
+
+#include <linux/cpu.h>
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/sched/stat.h>
+#include <linux/tick.h>
+#include <linux/workqueue.h>
+#include "common.h"
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "zynq_park."
+
+#define ZYNQ_PARK_CPU		1
+
+static bool zynq_park_enable;
+static unsigned int zynq_park_sample_ms = 50;
+/* Busy time of all cores together, in percent of one core */
+static unsigned int zynq_park_low = 30;
+static unsigned int zynq_park_high = 70;
+/* Number of low samples in a row before the core is parked */
+static unsigned int zynq_park_low_samples = 4;
+
+module_param_named(sample_ms, zynq_park_sample_ms, uint, 0644);
+module_param_named(low, zynq_park_low, uint, 0644);
+module_param_named(high, zynq_park_high, uint, 0644);
+module_param_named(low_samples, zynq_park_low_samples, uint, 0644);
+
+static DEFINE_MUTEX(zynq_park_lock);
+static bool zynq_park_ready;
+static bool zynq_park_parked;
+static unsigned int zynq_park_low_count;
+static u64 zynq_park_prev_idle[NR_CPUS];
+static u64 zynq_park_prev_wall[NR_CPUS];
+static bool zynq_park_prev_valid;
+
+static void zynq_park_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(zynq_park_work, zynq_park_work_fn);
+
+/* Always sample from CPU0, the core that is never parked */
+static void zynq_park_queue(unsigned long delay)
+{
+	queue_delayed_work_on(0, system_freezable_wq, &zynq_park_work, delay);
+}
+
+/**
+ * zynq_park_load - Get the load since the previous sample
+ *
+ * Return: Busy time of all online cores, in percent of one core, or -1
+ *	   if there is no previous sample or no idle time accounting.
+ */
+static int zynq_park_load(void)
+{
+	u64 busy = 0, period = 0;
+	bool valid = zynq_park_prev_valid;
+	u64 idle, wall;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		idle = get_cpu_idle_time_us(cpu, &wall);
+		if (idle == -1ULL)
+			return -1;
+
+		if (wall > zynq_park_prev_wall[cpu]) {
+			u64 dwall = wall - zynq_park_prev_wall[cpu];
+			u64 didle = idle - zynq_park_prev_idle[cpu];
+
+			busy += dwall > didle ? dwall - didle : 0;
+			period = max(period, dwall);
+		}
+
+		zynq_park_prev_idle[cpu] = idle;
+		zynq_park_prev_wall[cpu] = wall;
+	}
+
+	zynq_park_prev_valid = true;
+	if (!valid || !period)
+		return -1;
+
+	return div64_u64(busy * 100, period);
+}
+
+static void zynq_park_set(bool park)
+{
+	struct device *dev = get_cpu_device(ZYNQ_PARK_CPU);
+	int ret;
+
+	if (!dev)
+		return;
+
+	lock_device_hotplug();
+	ret = park ? device_offline(dev) : device_online(dev);
+	unlock_device_hotplug();
+
+	if (ret < 0)
+		pr_debug("%s: failed to %s CPU%d: %d\n", __func__,
+			 park ? "park" : "unpark", ZYNQ_PARK_CPU, ret);
+	else
+		zynq_park_parked = park;
+
+	/* The set of cores changed, start sampling from scratch */
+	zynq_park_prev_valid = false;
+	zynq_park_low_count = 0;
+}
+
+static void zynq_park_work_fn(struct work_struct *work)
+{
+	int load;
+
+	mutex_lock(&zynq_park_lock);
+
+	if (!zynq_park_enable)
+		goto out;
+
+	load = zynq_park_load();
+	if (load < 0)
+		goto resched;
+
+	if (zynq_park_parked) {
+		if (load >= zynq_park_high)
+			zynq_park_set(false);
+	} else if (cpu_online(ZYNQ_PARK_CPU)) {
+		if (load < zynq_park_low && nr_running() <= 1) {
+			if (++zynq_park_low_count >= zynq_park_low_samples)
+				zynq_park_set(true);
+		} else {
+			zynq_park_low_count = 0;
+		}
+	}
+
+resched:
+	zynq_park_queue(msecs_to_jiffies(zynq_park_sample_ms));
+out:
+	mutex_unlock(&zynq_park_lock);
+}
+
+static int zynq_park_enable_set(const char *val, const struct kernel_param *kp)
+{
+	bool enable;
+	int ret;
+
+	ret = strtobool(val, &enable);
+	if (ret)
+		return ret;
+
+	mutex_lock(&zynq_park_lock);
+	zynq_park_enable = enable;
+	/* When set from the command line, zynq_park_init() starts sampling */
+	if (zynq_park_ready) {
+		if (enable) {
+			zynq_park_prev_valid = false;
+			zynq_park_low_count = 0;
+			zynq_park_queue(0);
+		} else if (zynq_park_parked) {
+			zynq_park_set(false);
+		}
+	}
+	mutex_unlock(&zynq_park_lock);
+
+	return 0;
+}
+
+static const struct kernel_param_ops zynq_park_enable_ops = {
+	.set = zynq_park_enable_set,
+	.get = param_get_bool,
+};
+module_param_cb(enable, &zynq_park_enable_ops, &zynq_park_enable, 0644);
+
+static int __init zynq_park_init(void)
+{
+	if (!of_machine_is_compatible("xlnx,zynq-7000"))
+		return 0;
+
+	/* A full dynticks core is kept for one task, it is never parked */
+	if (tick_nohz_full_cpu(ZYNQ_PARK_CPU)) {
+		pr_info("zynq_park: CPU%d is full dynticks, not parking it\n",
+			ZYNQ_PARK_CPU);
+		return 0;
+	}
+
+	mutex_lock(&zynq_park_lock);
+	zynq_park_ready = true;
+	if (zynq_park_enable)
+		zynq_park_queue(0);
+	mutex_unlock(&zynq_park_lock);
+
+	return 0;
+}
+late_initcall(zynq_park_init);
@@ -34,6 +34,9 @@
  */
 static int ncores;
 
+/* Address the trampoline at the reset vector currently jumps to */
+static u32 zynq_cpun_jump_address;
+
 int zynq_cpun_start(u32 address, int cpu)
 {
 	u32 trampoline_code_size = &zynq_secondary_trampoline_end -
@@ -48,6 +51,19 @@ int zynq_cpun_start(u32 address, int cpu)
 						&zynq_secondary_trampoline;
 
 		zynq_slcr_cpu_stop(cpu);
+
+		/*
+		 * With the kernel owning low memory the trampoline stays where
+		 * it was put, so bringing a core back after hotplug only has
+		 * to release it from reset. Starting at 0 means the caller put
+		 * its own code at the reset vector.
+		 */
+		if (!address)
+			zynq_cpun_jump_address = 0;
+		else if (!__pa(PAGE_OFFSET) &&
+			 address == zynq_cpun_jump_address)
+			address = 0;
+
 		if (address) {
 			if (__pa(PAGE_OFFSET)) {
 				zero = ioremap(0, trampoline_code_size);
@@ -69,12 +85,21 @@ int zynq_cpun_start(u32 address, int cpu)
 							trampoline_size);
 			writel(address, zero + trampoline_size);
 
-			flush_cache_all();
+			/*
+			 * The core fetches the trampoline with its caches off,
+			 * only the lines of the cacheable lowmem alias need to
+			 * reach memory, not the whole of L1.
+			 */
+			if (!__pa(PAGE_OFFSET))
+				__cpuc_flush_dcache_area((__force void *)zero,
+							 trampoline_code_size);
 			outer_flush_range(0, trampoline_code_size);
 			smp_wmb();
 
 			if (__pa(PAGE_OFFSET))
 				iounmap(zero);
+			else
+				zynq_cpun_jump_address = address;
 		}
 		zynq_slcr_cpu_start(cpu);
 
@@ -87,8 +112,13 @@ int zynq_cpun_start(u32 address, int cpu)
 }
 EXPORT_SYMBOL(zynq_cpun_start);
 
+/* Release time of the core being brought up, for zynq_boot_time */
+static u64 zynq_secondary_release;
+
 static int zynq_boot_secondary(unsigned int cpu, struct task_struct *idle)
 {
+	zynq_secondary_release = zynq_boot_clock();
+
 	return zynq_cpun_start(__pa_symbol(secondary_startup), cpu);
 }
 
@@ -108,7 +138,11 @@ static void __init zynq_smp_init_cpus(void)
 
 static void __init zynq_smp_prepare_cpus(unsigned int max_cpus)
 {
+	u64 start = zynq_boot_clock();
+
 	scu_enable(zynq_scu_base);
+
+	zynq_boot_report("SCU init", start);
 }
 
 /**
@@ -121,6 +155,9 @@ static void __init zynq_smp_prepare_cpus(unsigned int max_cpus)
 static void zynq_secondary_init(unsigned int cpu)
 {
 	zynq_core_pm_init();
+
+	if (system_state == SYSTEM_BOOTING)
+		zynq_boot_report("secondary start", zynq_secondary_release);
 }
 
 #ifdef CONFIG_HOTPLUG_CPU
@@ -150,7 +187,8 @@ static void zynq_cpu_die(unsigned int cpu)
 	/*
 	 * there is no power-control hardware on this platform, so all
 	 * we can do is put the core into WFI; this is safe as the calling
-	 * code will have already disabled interrupts
+	 * code will have already disabled interrupts. zynq_cpu_kill() then
+	 * puts the core into reset and stops its clock through the SLCR.
 	 */
 	for (;;)
 		cpu_do_idle();
@@ -19,20 +19,70 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <linux/cpumask.h>
+#include <linux/genalloc.h>
 #include <linux/io.h>
 #include <linux/of_address.h>
 #include <linux/of_device.h>
+#include <linux/of_platform.h>
+#include <linux/cpu_pm.h>
+#include <linux/suspend.h>
+#include <linux/syscore_ops.h>
+#include <asm/cacheflush.h>
+#include <asm/fncpy.h>
+#include <asm/suspend.h>
 #include "common.h"
+#include "pm.h"
 
-/* register offsets */
-#define DDRC_CTRL_REG1_OFFS		0x60
-#define DDRC_DRAM_PARAM_REG3_OFFS	0x20
+static void __iomem *ddrc_base;
 
-/* bitfields */
-#define DDRC_CLOCKSTOP_MASK	BIT(23)
-#define DDRC_SELFREFRESH_MASK	BIT(12)
+#ifdef CONFIG_ARM_ZYNQ_CPUIDLE
+/* Self refresh code copied to OCM, followed by the word the cores sync on */
+static void (*zynq_ddr_self_refresh_in_ocm)(void __iomem *ddrc_base,
+					    u32 *sync, int role);
+static u32 __iomem *zynq_ddr_self_refresh_sync;
+#endif
 
-static void __iomem *ddrc_base;
+#ifdef CONFIG_SUSPEND
+/* Suspend code copied to OCM */
+static void (*zynq_sys_suspend_in_ocm)(void __iomem *ddrc_base,
+				       void __iomem *slcr_base);
+#endif
+
+#ifdef CONFIG_HIBERNATION
+/*
+ * OCM is not part of the hibernation image. The kernel that boots the image
+ * may have left different code there, or none, so the copies are written
+ * again before cpuidle or suspend can jump into them.
+ */
+struct zynq_pm_ocm_code {
+	void __iomem *ocm;
+	void *fn;
+	size_t fn_sz;
+	void __iomem *data;
+	size_t data_sz;
+};
+
+static struct zynq_pm_ocm_code zynq_pm_ocm_code[2];
+static unsigned int zynq_pm_ocm_code_count;
+
+static void zynq_pm_ocm_restore(void)
+{
+	struct zynq_pm_ocm_code *code;
+	unsigned int i;
+
+	for (i = 0; i < zynq_pm_ocm_code_count; i++) {
+		code = &zynq_pm_ocm_code[i];
+		fncpy(code->ocm, code->fn, code->fn_sz);
+		if (code->data_sz)
+			memset_io(code->data, 0, code->data_sz);
+	}
+}
+
+static struct syscore_ops zynq_pm_syscore_ops = {
+	.resume = zynq_pm_ocm_restore,
+};
+#endif
 
 /**
  * zynq_pm_ioremap() - Create IO mappings
@@ -58,6 +108,232 @@ static void __iomem *zynq_pm_ioremap(const char *comp)
 	return base;
 }
 
+#if defined(CONFIG_ARM_ZYNQ_CPUIDLE) || defined(CONFIG_SUSPEND)
+/**
+ * zynq_pm_ocm_pool() - Find the OCM pool
+ * Return: Pointer to the pool or NULL.
+ *
+ * DDR can't be accessed while it is in self refresh, so the code entering
+ * and leaving it runs from an OCM pool provided by a "mmio-sram" node.
+ */
+static struct gen_pool * __init zynq_pm_ocm_pool(void)
+{
+	struct platform_device *pdev;
+	struct gen_pool *ocm_pool;
+	struct device_node *np;
+
+	np = of_find_compatible_node(NULL, NULL, "mmio-sram");
+	if (!np) {
+		pr_warn("%s: no mmio-sram node for OCM\n", __func__);
+		return NULL;
+	}
+
+	pdev = of_find_device_by_node(np);
+	of_node_put(np);
+	if (!pdev) {
+		pr_warn("%s: failed to find OCM device\n", __func__);
+		return NULL;
+	}
+
+	ocm_pool = gen_pool_get(&pdev->dev, NULL);
+	put_device(&pdev->dev);
+	if (!ocm_pool)
+		pr_warn("%s: OCM pool unavailable\n", __func__);
+
+	return ocm_pool;
+}
+
+/**
+ * zynq_pm_ocm_copy() - Copy a function to OCM
+ * @ocm_pool:	OCM pool to allocate from
+ * @fn:		Function to copy
+ * @fn_sz:	Size of the function
+ * @data_sz:	Size of a data area to allocate behind the function
+ * @data:	Returns the data area, if @data_sz isn't 0
+ * Return: Pointer to the copied function or NULL.
+ */
+static void * __init zynq_pm_ocm_copy(struct gen_pool *ocm_pool, void *fn,
+				      size_t fn_sz, size_t data_sz,
+				      void __iomem **data)
+{
+	unsigned long ocm_base;
+	phys_addr_t ocm_pbase;
+	void __iomem *ocm;
+	size_t code_sz, sz;
+
+	code_sz = ALIGN(fn_sz, FNCPY_ALIGN);
+	sz = code_sz + data_sz;
+	ocm_base = gen_pool_alloc(ocm_pool, sz);
+	if (!ocm_base) {
+		pr_warn("%s: unable to alloc OCM\n", __func__);
+		return NULL;
+	}
+
+	ocm_pbase = gen_pool_virt_to_phys(ocm_pool, ocm_base);
+
+	ocm = __arm_ioremap_exec(ocm_pbase, sz, false);
+	if (!ocm) {
+		pr_warn("%s: __arm_ioremap_exec failed\n", __func__);
+		gen_pool_free(ocm_pool, ocm_base, sz);
+		return NULL;
+	}
+
+	if (data_sz) {
+		*data = ocm + code_sz;
+		memset_io(*data, 0, data_sz);
+	}
+
+#ifdef CONFIG_HIBERNATION
+	if (zynq_pm_ocm_code_count < ARRAY_SIZE(zynq_pm_ocm_code)) {
+		struct zynq_pm_ocm_code *code;
+
+		code = &zynq_pm_ocm_code[zynq_pm_ocm_code_count++];
+		code->ocm = ocm;
+		code->fn = fn;
+		code->fn_sz = fn_sz;
+		code->data = data_sz ? *data : NULL;
+		code->data_sz = data_sz;
+	}
+#endif
+
+	return fncpy(ocm, fn, fn_sz);
+}
+#endif
+
+#ifdef CONFIG_ARM_ZYNQ_CPUIDLE
+/**
+ * zynq_pm_self_refresh_available() - Check for the DDR self refresh state
+ * Return: true if zynq_pm_enter_self_refresh() can be used.
+ */
+bool zynq_pm_self_refresh_available(void)
+{
+	return zynq_ddr_self_refresh_in_ocm != NULL;
+}
+
+/**
+ * zynq_pm_prepare_self_refresh() - Reset the OCM sync word
+ *
+ * Must be called by one core before any of them calls
+ * zynq_pm_enter_self_refresh(), and after all of them returned from it the
+ * previous time.
+ */
+void zynq_pm_prepare_self_refresh(void)
+{
+	writel(ZYNQ_SR_IDLE, zynq_ddr_self_refresh_sync);
+}
+
+/**
+ * zynq_pm_enter_self_refresh() - Wait for an interrupt with DDR in self refresh
+ * @cpu:	The calling CPU
+ *
+ * All online cores have to call this at the same time with interrupts
+ * disabled. CPU0 puts DDR in self refresh once the other core is parked,
+ * and every core returns after its next interrupt with DDR running again.
+ */
+void zynq_pm_enter_self_refresh(int cpu)
+{
+	int role;
+
+	if (cpu)
+		role = ZYNQ_SR_FOLLOWER;
+	else if (num_online_cpus() > 1)
+		role = ZYNQ_SR_LEADER;
+	else
+		role = ZYNQ_SR_LEADER_ALONE;
+
+	zynq_ddr_self_refresh_in_ocm(ddrc_base,
+				     (u32 __force *)zynq_ddr_self_refresh_sync,
+				     role);
+}
+#endif
+
+#ifdef CONFIG_SUSPEND
+static int zynq_pm_suspend(unsigned long arg)
+{
+	zynq_sys_suspend_in_ocm(ddrc_base, zynq_slcr_get_base());
+
+	return 0;
+}
+
+static int zynq_pm_enter(suspend_state_t suspend_state)
+{
+	int ret;
+
+	switch (suspend_state) {
+	case PM_SUSPEND_STANDBY:
+	case PM_SUSPEND_MEM:
+		ret = cpu_pm_enter();
+		if (ret)
+			return ret;
+		ret = cpu_cluster_pm_enter();
+		if (ret) {
+			cpu_pm_exit();
+			return ret;
+		}
+
+		outer_disable();
+		cpu_suspend(0, zynq_pm_suspend);
+		outer_resume();
+
+		cpu_cluster_pm_exit();
+		cpu_pm_exit();
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Standby takes the same path, there is no lighter state to offer */
+static int zynq_pm_valid(suspend_state_t state)
+{
+	return state == PM_SUSPEND_STANDBY || state == PM_SUSPEND_MEM;
+}
+
+static const struct platform_suspend_ops zynq_pm_ops = {
+	.enter		= zynq_pm_enter,
+	.valid		= zynq_pm_valid,
+};
+#endif
+
+/**
+ * zynq_pm_ocm_init() - Set up the code running from OCM
+ *
+ * Copies the DDR self refresh code for cpuidle and the suspend code to OCM.
+ * Suspend to RAM is only offered if the latter succeeded.
+ */
+static void __init zynq_pm_ocm_init(void)
+{
+#if defined(CONFIG_ARM_ZYNQ_CPUIDLE) || defined(CONFIG_SUSPEND)
+	struct gen_pool *ocm_pool;
+
+	ocm_pool = zynq_pm_ocm_pool();
+	if (!ocm_pool)
+		return;
+#endif
+
+#ifdef CONFIG_ARM_ZYNQ_CPUIDLE
+	zynq_ddr_self_refresh_in_ocm =
+		zynq_pm_ocm_copy(ocm_pool, &zynq_ddr_self_refresh,
+				 zynq_ddr_self_refresh_sz, sizeof(u32),
+				 (void __iomem **)&zynq_ddr_self_refresh_sync);
+#endif
+
+#ifdef CONFIG_SUSPEND
+	zynq_sys_suspend_in_ocm =
+		zynq_pm_ocm_copy(ocm_pool, &zynq_sys_suspend,
+				 zynq_sys_suspend_sz, 0, NULL);
+	if (zynq_sys_suspend_in_ocm)
+		suspend_set_ops(&zynq_pm_ops);
+#endif
+
+#ifdef CONFIG_HIBERNATION
+	if (zynq_pm_ocm_code_count)
+		register_syscore_ops(&zynq_pm_syscore_ops);
+#endif
+}
+
 /**
  * zynq_pm_late_init() - Power management init
  *
@@ -79,5 +355,7 @@ void __init zynq_pm_late_init(void)
 		reg = readl(ddrc_base + DDRC_DRAM_PARAM_REG3_OFFS);
 		reg |= DDRC_CLOCKSTOP_MASK;
 		writel(reg, ddrc_base + DDRC_DRAM_PARAM_REG3_OFFS);
+
+		zynq_pm_ocm_init();
 	}
 }
@@ -0,0 +1,51 @@
+/*
+ * Zynq power management
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __MACH_ZYNQ_PM_H__
+#define __MACH_ZYNQ_PM_H__
+
+/* register offsets */
+#define DDRC_DRAM_PARAM_REG3_OFFS	0x20
+#define DDRC_MODE_STS_REG_OFFS		0x54
+#define DDRC_CTRL_REG1_OFFS		0x60
+
+/* bitfields */
+#define DDRC_CLOCKSTOP_MASK		0x800000
+#define DDRC_SELFREFRESH_MASK		0x1000
+#define DDRC_MODE_STS_MASK		0x7
+#define DDRC_MODE_STS_SELFREFRESH	0x3
+
+/* SLCR PLL registers */
+#define SLCR_ARM_PLL_CTRL_OFFS		0x100
+#define SLCR_DDR_PLL_CTRL_OFFS		0x104
+#define SLCR_PLL_STATUS_OFFS		0x10c
+
+#define SLCR_PLL_PWRDWN_MASK		0x2
+#define SLCR_PLL_BYPASS_FORCE_MASK	0x10
+#define SLCR_PLL_STATUS_ARM_LOCK	0x1
+#define SLCR_PLL_STATUS_DDR_LOCK	0x2
+
+/* roles in zynq_ddr_self_refresh() */
+#define ZYNQ_SR_FOLLOWER		0
+#define ZYNQ_SR_LEADER			1
+#define ZYNQ_SR_LEADER_ALONE		2
+
+/* values of the sync word in OCM */
+#define ZYNQ_SR_IDLE			0
+#define ZYNQ_SR_PARKED			1
+#define ZYNQ_SR_WOKEN			2
+
+#ifndef __ASSEMBLY__
+extern void zynq_ddr_self_refresh(void __iomem *ddrc_base, u32 *sync,
+				  int role);
+extern unsigned int zynq_ddr_self_refresh_sz;
+extern void zynq_sys_suspend(void __iomem *ddrc_base,
+			     void __iomem *slcr_base);
+extern unsigned int zynq_sys_suspend_sz;
+#endif
+
+#endif
@@ -77,6 +77,19 @@ static inline int zynq_slcr_unlock(void)
 	return 0;
 }
 
+/**
+ * zynq_slcr_get_base - Get the mapping of the SLCR block
+ *
+ * The PLLs can only be reconfigured from code that doesn't depend on DDR,
+ * which is why the suspend code gets direct access to the registers.
+ *
+ * Return:	Virtual base address of the SLCR, already unlocked
+ */
+void __iomem *zynq_slcr_get_base(void)
+{
+	return zynq_slcr_base;
+}
+
 /**
  * zynq_slcr_get_device_id - Read device code id
  *
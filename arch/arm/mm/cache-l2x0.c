@@ -17,6 +17,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 #include <linux/cpu.h>
+#include <linux/debugfs.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/smp.h>
@@ -548,6 +549,35 @@ static void l2c310_flush_all_erratum(void)
 	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
 }
 
+/*
+ * Clean or flush the whole cache one line at a time, by index and way.
+ * Unlike the background operations by way, these are atomic line
+ * operations, which other CPUs may issue range operations alongside, so
+ * no lock is needed and the system can keep running.
+ */
+static void l2c310_op_all_by_index(void __iomem *reg)
+{
+	unsigned ways = fls(l2x0_way_mask);
+	unsigned sets = l2x0_size / ways / CACHE_LINE_SIZE;
+	unsigned way, set;
+
+	for (way = 0; way < ways; way++)
+		for (set = 0; set < sets; set++)
+			writel_relaxed(way << 28 | set * CACHE_LINE_SIZE, reg);
+
+	__l2c210_cache_sync(l2x0_base);
+}
+
+static void l2c310_clean_all_by_index(void)
+{
+	l2c310_op_all_by_index(l2x0_base + L2X0_CLEAN_LINE_IDX);
+}
+
+static void l2c310_flush_all_by_index(void)
+{
+	l2c310_op_all_by_index(l2x0_base + L2X0_CLEAN_INV_LINE_IDX);
+}
+
 static void __init l2c310_save(void __iomem *base)
 {
 	unsigned revision;
@@ -703,6 +733,9 @@ static void __init l2c310_fixup(void __iomem *base, u32 cache_id,
 	    fns->inv_range == l2c210_inv_range) {
 		fns->inv_range = l2c310_inv_range_erratum;
 		fns->flush_range = l2c310_flush_range_erratum;
+		/* Clean and invalidate by index is affected as well */
+		fns->clean_all_by_index = NULL;
+		fns->flush_all_by_index = NULL;
 		errata[n++] = "588369";
 	}
 
@@ -783,6 +816,8 @@ static const struct l2c_init_data l2c310_init_fns __initconst = {
 		.clean_range = l2c210_clean_range,
 		.flush_range = l2c210_flush_range,
 		.flush_all = l2c210_flush_all,
+		.clean_all_by_index = l2c310_clean_all_by_index,
+		.flush_all_by_index = l2c310_flush_all_by_index,
 		.disable = l2c310_disable,
 		.sync = l2c210_sync,
 		.resume = l2c310_resume,
@@ -934,6 +969,113 @@ void __init l2x0_init(void __iomem *base, u32 aux_val, u32 aux_mask)
 	__l2c_init(data, aux_val, aux_mask, cache_id, false);
 }
 
+#ifdef CONFIG_DEBUG_FS
+/*
+ * The L2C-310 prefetch control register is the one piece of the setup that
+ * may be changed while the cache is enabled, so expose it for tuning.  The
+ * files follow the naming and the sense of the device tree properties.
+ * Changes are kept in l2x0_saved_regs as well, to survive a resume.
+ */
+struct l2c310_prefetch_attr {
+	const char *name;
+	u32 mask;
+	bool inverted;
+};
+
+static const struct l2c310_prefetch_attr l2c310_prefetch_attrs[] = {
+	{ "double-linefill", L310_PREFETCH_CTRL_DBL_LINEFILL },
+	{ "double-linefill-incr", L310_PREFETCH_CTRL_DBL_LINEFILL_INCR },
+	{ "double-linefill-wrap", L310_PREFETCH_CTRL_DBL_LINEFILL_WRAP, true },
+	{ "prefetch-drop", L310_PREFETCH_CTRL_PREFETCH_DROP },
+	{ "prefetch-offset", L310_PREFETCH_CTRL_OFFSET_MASK },
+	{ "prefetch-data", L310_PREFETCH_CTRL_DATA_PREFETCH },
+	{ "prefetch-instr", L310_PREFETCH_CTRL_INSTR_PREFETCH },
+};
+
+static int l2c310_prefetch_get(void *data, u64 *val)
+{
+	const struct l2c310_prefetch_attr *attr = data;
+	u32 prefetch = readl_relaxed(l2x0_base + L310_PREFETCH_CTRL);
+
+	if (attr->inverted)
+		prefetch = ~prefetch;
+	*val = (prefetch & attr->mask) >> __ffs(attr->mask);
+
+	return 0;
+}
+
+static int l2c310_prefetch_set(void *data, u64 val)
+{
+	const struct l2c310_prefetch_attr *attr = data;
+	unsigned revision;
+	unsigned long flags;
+	u32 prefetch, aux;
+
+	if (val > attr->mask >> __ffs(attr->mask))
+		return -EINVAL;
+
+	/* Only offsets 0-7, 15, 23 and 31 are supported by the hardware */
+	if (attr->mask == L310_PREFETCH_CTRL_OFFSET_MASK &&
+	    val > 7 && val != 15 && val != 23 && val != 31)
+		return -EINVAL;
+
+	if (attr->inverted)
+		val = !val;
+
+	/* Double linefill is not safe on r3p0 - r3p1, see 752271 */
+	revision = readl_relaxed(l2x0_base + L2X0_CACHE_ID) &
+		   L2X0_CACHE_ID_RTL_MASK;
+	if (attr->mask == L310_PREFETCH_CTRL_DBL_LINEFILL && val &&
+	    revision >= L310_CACHE_ID_RTL_R3P0 &&
+	    revision < L310_CACHE_ID_RTL_R3P2)
+		return -EPERM;
+
+	raw_spin_lock_irqsave(&l2x0_lock, flags);
+	prefetch = l2x0_saved_regs.prefetch_ctrl & ~attr->mask;
+	prefetch |= (u32)val << __ffs(attr->mask);
+	l2c_write_sec(prefetch, l2x0_base, L310_PREFETCH_CTRL);
+	l2x0_saved_regs.prefetch_ctrl = prefetch;
+
+	/* The prefetch enables are aliases of the AUX_CTRL bits */
+	aux = L310_AUX_CTRL_DATA_PREFETCH | L310_AUX_CTRL_INSTR_PREFETCH;
+	l2x0_saved_regs.aux_ctrl &= ~aux;
+	l2x0_saved_regs.aux_ctrl |= prefetch & aux;
+	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
+
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(l2c310_prefetch_fops, l2c310_prefetch_get,
+			l2c310_prefetch_set, "%llu\n");
+
+static int __init l2c310_debugfs_init(void)
+{
+	struct dentry *dir;
+	unsigned revision;
+	unsigned i;
+
+	if (!l2x0_base || !l2x0_data || l2x0_data->save != l2c310_save)
+		return 0;
+
+	/* Prefetch offset/control register exists from r2p0 */
+	revision = readl_relaxed(l2x0_base + L2X0_CACHE_ID) &
+		   L2X0_CACHE_ID_RTL_MASK;
+	if (revision < L310_CACHE_ID_RTL_R2P0)
+		return 0;
+
+	dir = debugfs_create_dir("l2c310", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	for (i = 0; i < ARRAY_SIZE(l2c310_prefetch_attrs); i++)
+		debugfs_create_file(l2c310_prefetch_attrs[i].name, 0644, dir,
+				    (void *)&l2c310_prefetch_attrs[i],
+				    &l2c310_prefetch_fops);
+
+	return 0;
+}
+late_initcall(l2c310_debugfs_init);
+#endif
+
 #ifdef CONFIG_OF
 static int l2_wt_override;
 
@@ -1317,6 +1459,8 @@ static const struct l2c_init_data of_l2c310_data __initconst = {
 		.clean_range = l2c210_clean_range,
 		.flush_range = l2c210_flush_range,
 		.flush_all   = l2c210_flush_all,
+		.clean_all_by_index = l2c310_clean_all_by_index,
+		.flush_all_by_index = l2c310_flush_all_by_index,
 		.disable     = l2c310_disable,
 		.sync        = l2c210_sync,
 		.resume      = l2c310_resume,
@@ -10,6 +10,7 @@
  *  DMA uncached mapping support.
  */
 #include <linux/bootmem.h>
+#include <linux/debugfs.h>
 #include <linux/module.h>
 #include <linux/mm.h>
 #include <linux/genalloc.h>
@@ -1015,6 +1016,55 @@ static void dma_cache_maint_page(struct page *page, unsigned long offset,
 	} while (left);
 }
 
+/*
+ * From dma_outer_all_threshold bytes on, going over the whole outer cache
+ * by index takes fewer register writes than going over the buffer by
+ * address. The L1 is still maintained by address: its operations are
+ * cheap in comparison and broadcast to the other CPUs by the hardware,
+ * while set/way ones would need IPIs, which callers holding spinlocks
+ * can't wait for. 0 turns this off.
+ */
+static unsigned long dma_outer_all_threshold = SZ_1M;
+static atomic_t dma_outer_all_cleans;
+static atomic_t dma_outer_all_flushes;
+
+static bool dma_outer_maint_all(size_t size, bool invalidate)
+{
+	unsigned long threshold = READ_ONCE(dma_outer_all_threshold);
+
+	if (!threshold || size < threshold || !outer_has_all_by_index())
+		return false;
+
+	if (invalidate) {
+		outer_flush_all_by_index();
+		atomic_inc(&dma_outer_all_flushes);
+	} else {
+		outer_clean_all_by_index();
+		atomic_inc(&dma_outer_all_cleans);
+	}
+
+	return true;
+}
+
+static int __init dma_outer_all_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	if (!outer_has_all_by_index())
+		return 0;
+
+	dir = debugfs_create_dir("dma_outer_all", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_ulong("threshold", 0644, dir, &dma_outer_all_threshold);
+	debugfs_create_atomic_t("cleans", 0444, dir, &dma_outer_all_cleans);
+	debugfs_create_atomic_t("flushes", 0444, dir, &dma_outer_all_flushes);
+
+	return 0;
+}
+late_initcall(dma_outer_all_debugfs_init);
+
 /*
  * Make an area consistent for devices.
  * Note: Drivers should NOT use this function directly, as it will break
@@ -1028,6 +1078,9 @@ static void __dma_page_cpu_to_dev(struct page *page, unsigned long off,
 
 	dma_cache_maint_page(page, off, size, dir, dmac_map_area);
 
+	if (dma_outer_maint_all(size, dir == DMA_FROM_DEVICE))
+		return;
+
 	paddr = page_to_phys(page) + off;
 	if (dir == DMA_FROM_DEVICE) {
 		outer_inv_range(paddr, paddr + size);
@@ -1045,7 +1098,8 @@ static void __dma_page_dev_to_cpu(struct page *page, unsigned long off,
 	/* FIXME: non-speculating: not required */
 	/* in any case, don't bother invalidating if DMA to device */
 	if (dir != DMA_TO_DEVICE) {
-		outer_inv_range(paddr, paddr + size);
+		if (!dma_outer_maint_all(size, true))
+			outer_inv_range(paddr, paddr + size);
 
 		dma_cache_maint_page(page, off, size, dir, dmac_unmap_area);
 	}
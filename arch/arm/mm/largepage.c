@@ -0,0 +1,174 @@
+/*
+ * arch/arm/mm/largepage.c
+ *
+ * 64K large pages for user mappings of physically contiguous buffers.
+ *
+ * Linux keeps tracking such a mapping one 4K pte at a time. Only the
+ * sixteen hardware entries of an aligned block are rewritten as the
+ * identical large page descriptors the short-descriptor format wants,
+ * so a single TLB entry covers the block. Any later change to one of
+ * the ptes first turns the block back into small pages, see
+ * split_large_pte().
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/huge_mm.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/spinlock.h>
+
+#include <asm/cacheflush.h>
+#include <asm/pgtable.h>
+#include <asm/tlbflush.h>
+
+#define LPAGE_SHIFT	16
+#define LPAGE_SIZE	(1UL << LPAGE_SHIFT)
+#define LPAGE_MASK	(~(LPAGE_SIZE - 1))
+#define PTRS_PER_LPAGE	(LPAGE_SIZE / PAGE_SIZE)
+
+static void lpage_write_hw(pte_t *ptep, pteval_t val)
+{
+	pte_t *hw = ptep + PTE_HWTABLE_PTRS;
+	unsigned i;
+
+	for (i = 0; i < PTRS_PER_LPAGE; i++)
+		hw[i] = __pte(val);
+	clean_dcache_area(hw, PTRS_PER_LPAGE * sizeof(pte_t));
+}
+
+/*
+ * Small and large entries for the same address must never meet in the
+ * TLB, so the block is unmapped and flushed before either is written.
+ * Accesses in between fault and wait on the pte lock we hold.
+ */
+static void lpage_break(struct mm_struct *mm, pte_t *ptep, unsigned long addr)
+{
+	struct vm_area_struct vma = {
+		.vm_mm = mm,
+		.vm_flags = VM_EXEC,
+	};
+
+	lpage_write_hw(ptep, 0);
+	flush_tlb_range(&vma, addr, addr + LPAGE_SIZE);
+}
+
+void __split_large_pte(struct mm_struct *mm, unsigned long addr, pte_t *ptep)
+{
+	pte_t *first = ptep - ((addr >> PAGE_SHIFT) & (PTRS_PER_LPAGE - 1));
+	unsigned i;
+
+	addr &= LPAGE_MASK;
+	lpage_break(mm, first, addr);
+
+	for (i = 0; i < PTRS_PER_LPAGE; i++)
+		set_pte_ext(first + i, first[i], PTE_EXT_NG);
+}
+
+/* Convert the small page descriptor of the block's first page */
+static pteval_t lpage_from_small(pteval_t small)
+{
+	pteval_t large;
+
+	large = small & (LPAGE_MASK | PTE_BUFFERABLE | PTE_CACHEABLE |
+			 PTE_EXT_AP_MASK | PTE_EXT_APX | PTE_EXT_SHARED |
+			 PTE_EXT_NG);
+	large |= PTE_LARGE_TEX((small >> 6) & 7);
+	if (small & PTE_EXT_XN)
+		large |= PTE_LARGE_XN;
+
+	return large | PTE_TYPE_LARGE;
+}
+
+/*
+ * The block qualifies if its ptes map sixteen contiguous, 64K aligned
+ * pfns with the same attributes, all valid. Writable ptes are made
+ * dirty up front: a pfn mapping does not track dirtiness, and a clean
+ * writable pte is read-only in hardware, which would split the block
+ * again on the first write.
+ */
+static void lpage_make(struct mm_struct *mm, pte_t *ptep, unsigned long addr)
+{
+	pte_t first = pte_mkdirty(ptep[0]);
+	pteval_t hw;
+	unsigned i;
+
+	if ((pte_val(ptep[PTE_HWTABLE_PTRS]) & PTE_TYPE_MASK) ==
+	    PTE_TYPE_LARGE)
+		return;
+
+	if (!pte_valid_user(first) || (pte_pfn(first) & (PTRS_PER_LPAGE - 1)))
+		return;
+
+	for (i = 1; i < PTRS_PER_LPAGE; i++)
+		if (pte_val(pte_mkdirty(ptep[i])) !=
+		    pte_val(first) + i * PAGE_SIZE)
+			return;
+
+	for (i = 0; i < PTRS_PER_LPAGE; i++)
+		if (pte_write(ptep[i]) && !pte_dirty(ptep[i]))
+			set_pte_ext(ptep + i, pte_mkdirty(ptep[i]),
+				    PTE_EXT_NG);
+
+	/* PROT_NONE ptes are valid to Linux but not to the hardware */
+	hw = pte_val(ptep[PTE_HWTABLE_PTRS]);
+	if ((hw & PTE_TYPE_MASK) != PTE_TYPE_SMALL)
+		return;
+
+	lpage_break(mm, ptep, addr);
+	lpage_write_hw(ptep, lpage_from_small(hw));
+}
+
+/**
+ * pfnmap_hugepage_madvise - map a pfn mapping with 64K pages, or not
+ * @vma: the VM_PFNMAP vma
+ * @start: start of the range
+ * @end: end of the range
+ * @advice: MADV_HUGEPAGE or MADV_NOHUGEPAGE
+ *
+ * With MADV_HUGEPAGE, every 64K block of the range that qualifies is
+ * mapped with a large page. Blocks that do not, such as those of a
+ * buffer that is not physically contiguous, keep their small pages.
+ * Drivers must already have populated the mapping, as remap_pfn_range()
+ * does. MADV_NOHUGEPAGE returns the range to small pages.
+ *
+ * Called with mmap_sem held for writing, as madvise() takes it for these
+ * advices. Holding it for reading would do: the block is rewritten under
+ * the pte lock, which faults on it wait for.
+ */
+int pfnmap_hugepage_madvise(struct vm_area_struct *vma, unsigned long start,
+			    unsigned long end, int advice)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long addr;
+	spinlock_t *ptl;
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *ptep;
+
+	for (addr = ALIGN(start, LPAGE_SIZE); addr + LPAGE_SIZE <= end;
+	     addr += LPAGE_SIZE) {
+		pgd = pgd_offset(mm, addr);
+		if (pgd_none_or_clear_bad(pgd))
+			continue;
+		pud = pud_offset(pgd, addr);
+		if (pud_none_or_clear_bad(pud))
+			continue;
+		pmd = pmd_offset(pud, addr);
+		if (pmd_none_or_clear_bad(pmd))
+			continue;
+
+		ptep = pte_offset_map_lock(mm, pmd, addr, &ptl);
+		if (advice == MADV_HUGEPAGE)
+			lpage_make(mm, ptep, addr);
+		else
+			split_large_pte(mm, addr, ptep);
+		pte_unmap_unlock(ptep, ptl);
+
+		cond_resched();
+	}
+
+	return 0;
+}
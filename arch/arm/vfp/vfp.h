@@ -378,3 +378,4 @@ struct op {
 };
 
 asmlinkage void vfp_save_state(void *location, u32 fpexc);
+asmlinkage void vfp_load_state(void *location, u32 fpexc);
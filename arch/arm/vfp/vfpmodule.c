@@ -13,7 +13,10 @@
 #include <linux/cpu_pm.h>
 #include <linux/hardirq.h>
 #include <linux/kernel.h>
+#include <linux/moduleparam.h>
 #include <linux/notifier.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
 #include <linux/signal.h>
 #include <linux/sched/signal.h>
 #include <linux/smp.h>
@@ -138,7 +141,95 @@ static void vfp_thread_copy(struct thread_info *thread)
 #ifdef CONFIG_SMP
 	thread->vfpstate.hard.cpu = NR_CPUS;
 #endif
+#ifdef CONFIG_VFP_EAGER_RESTORE
+	thread->vfp_traps = 0;
+	thread->vfp_saves = 0;
+	thread->vfp_loads = 0;
+	thread->vfp_hot = 0;
+	thread->vfp_loaded = 0;
+#endif
+}
+
+#ifdef CONFIG_VFP_EAGER_RESTORE
+/*
+ * A thread which used the VFP in eager_slices slices in a row gets its
+ * state loaded as it is switched in, instead of through the trap on its
+ * first VFP instruction.  Whether it still uses the VFP can't be seen
+ * once the state is loaded, so vfp_hot wraps after 256 slices and the
+ * thread goes back to a lazy restore for one slice.  0 disables it.
+ */
+static unsigned int eager_slices = 5;
+module_param(eager_slices, uint, 0644);
+MODULE_PARM_DESC(eager_slices, "Slices in a row using VFP before its state is restored eagerly");
+
+static void vfp_account_save(union vfp_state *vfp)
+{
+	container_of(vfp, struct thread_info, vfpstate)->vfp_saves++;
+}
+
+/*
+ * Account the VFP use of the thread being switched out.  The VFP is
+ * only enabled with its state in the hardware if it trapped or was
+ * loaded eagerly during this slice.
+ */
+static void vfp_switch_out(struct thread_info *prev, unsigned int cpu,
+			   u32 fpexc)
+{
+	if ((fpexc & FPEXC_EN) && vfp_current_hw_state[cpu] == &prev->vfpstate) {
+		prev->vfp_hot++;
+		if (!prev->vfp_loaded)
+			prev->vfp_traps++;
+	} else {
+		prev->vfp_hot = 0;
+	}
+	prev->vfp_loaded = 0;
+}
+
+/*
+ * Load the VFP state of a thread being switched in if it keeps using
+ * the VFP.  Returns false to leave it to the lazy restore, which is also
+ * the place to handle a pending exception.
+ */
+static bool vfp_switch_in(struct thread_info *next, unsigned int cpu,
+			  u32 fpexc)
+{
+	union vfp_state *vfp = &next->vfpstate;
+
+	if (!eager_slices || next->vfp_hot < eager_slices)
+		return false;
+
+	if (vfp_state_in_hw(cpu, next)) {
+		if (fpexc & FPEXC_EX)
+			return false;
+		fmxr(FPEXC, fpexc | FPEXC_EN);
+	} else {
+		if (vfp->hard.fpexc & FPEXC_EX)
+			return false;
+#ifndef CONFIG_SMP
+		/* On UP, the state of the previous owner may not be saved */
+		if (vfp_current_hw_state[cpu]) {
+			fpexc |= FPEXC_EN;
+			fmxr(FPEXC, fpexc);
+			vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+			vfp_account_save(vfp_current_hw_state[cpu]);
+		}
+#endif
+		vfp_load_state(vfp, vfp->hard.fpexc | FPEXC_EN);
+		vfp_current_hw_state[cpu] = vfp;
+#ifdef CONFIG_SMP
+		vfp->hard.cpu = cpu;
+#endif
+		next->vfp_loads++;
+	}
+
+	next->vfp_loaded = 1;
+	return true;
+}
+#else
+static inline void vfp_account_save(union vfp_state *vfp)
+{
 }
+#endif
 
 /*
  * When this function is called with the following 'cmd's, the following
@@ -179,12 +270,21 @@ static int vfp_notifier(struct notifier_block *self, unsigned long cmd, void *v)
 		 * case the thread migrates to a different CPU. The
 		 * restoring is done lazily.
 		 */
-		if ((fpexc & FPEXC_EN) && vfp_current_hw_state[cpu])
+		if ((fpexc & FPEXC_EN) && vfp_current_hw_state[cpu]) {
 			vfp_save_state(vfp_current_hw_state[cpu], fpexc);
+			vfp_account_save(vfp_current_hw_state[cpu]);
+		}
+#endif
+
+#ifdef CONFIG_VFP_EAGER_RESTORE
+		/* We still run on the stack of the previous thread */
+		vfp_switch_out(current_thread_info(), thread->cpu, fpexc);
+		if (vfp_switch_in(thread, thread->cpu, fpexc))
+			break;
 #endif
 
 		/*
-		 * Always disable VFP so we can lazily save/restore the
+		 * Otherwise disable VFP so we can lazily save/restore the
 		 * old state.
 		 */
 		fmxr(FPEXC, fpexc & ~FPEXC_EN);
@@ -678,6 +778,24 @@ void vfp_kmode_exception(void)
 		pr_crit("BUG: FP instruction issued in kernel mode with FP unit disabled\n");
 }
 
+#ifdef CONFIG_PROC_PID_ARCH_STATUS
+/*
+ * Report the VFP context switch statistics in /proc/<pid>/arch_status.
+ */
+int proc_pid_arch_status(struct seq_file *m, struct pid_namespace *ns,
+			 struct pid *pid, struct task_struct *task)
+{
+	struct thread_info *thread = task_thread_info(task);
+
+	seq_printf(m, "vfp_traps:\t%u\n", thread->vfp_traps);
+	seq_printf(m, "vfp_saves:\t%u\n", thread->vfp_saves);
+	seq_printf(m, "vfp_eager_loads:\t%u\n", thread->vfp_loads);
+	seq_printf(m, "vfp_hot_slices:\t%u\n", thread->vfp_hot);
+
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_KERNEL_MODE_NEON
 
 /*
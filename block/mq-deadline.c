@@ -31,6 +31,7 @@ static const int write_expire = 5 * HZ; /* ditto for writes, these limits are SO
 static const int writes_starved = 2;    /* max times reads can starve a write */
 static const int fifo_batch = 16;       /* # of sequential requests treated as one
 				     by the above parameters. For throughput. */
+static const int write_hold = HZ / 10;  /* max time a short write waits for merges */
 
 struct deadline_data {
 	/*
@@ -57,6 +58,9 @@ struct deadline_data {
 	int fifo_batch;
 	int writes_starved;
 	int front_merges;
+	int read_priority;
+	int write_align;		/* in sectors, -1 follows io_opt */
+	int write_hold;
 
 	spinlock_t lock;
 	struct list_head dispatch;
@@ -191,6 +195,90 @@ static inline int deadline_check_fifo(struct deadline_data *dd, int ddir)
 	return 0;
 }
 
+/*
+ * Alignment that writes are merged up to in read_priority mode. By default
+ * this is the optimal I/O size of the device, which for SD/eMMC is the
+ * preferred erase size.
+ */
+static unsigned int dd_write_align(struct deadline_data *dd,
+				   struct request_queue *q)
+{
+	unsigned int align;
+
+	if (dd->write_align >= 0)
+		align = dd->write_align;
+	else
+		align = queue_io_opt(q) >> 9;
+
+	return min(align, queue_max_sectors(q));
+}
+
+static unsigned long dd_write_held_until(struct deadline_data *dd,
+					 struct request *rq)
+{
+	return (unsigned long)rq->fifo_time - dd->fifo_expire[WRITE] +
+		dd->write_hold;
+}
+
+/*
+ * A write may go out once it is as large as the alignment, ends on an
+ * alignment boundary, or has waited write_hold for writes to merge into it.
+ */
+static bool dd_write_ready(struct deadline_data *dd, struct request *rq)
+{
+	unsigned int align = dd_write_align(dd, rq->q);
+	sector_t end = blk_rq_pos(rq) + blk_rq_sectors(rq);
+
+	if (!align || blk_rq_sectors(rq) >= align)
+		return true;
+	if (!sector_div(end, align))
+		return true;
+
+	return time_after_eq(jiffies, dd_write_held_until(dd, rq));
+}
+
+/*
+ * read_priority mode: reads are always dispatched first and writes only
+ * when no reads are queued, unless the oldest write has expired. Short
+ * writes are held back so that they can grow to the write alignment,
+ * which avoids read-modify-write of whole erase blocks on flash media.
+ */
+static struct request *dd_read_priority_select(struct blk_mq_hw_ctx *hctx,
+					       struct deadline_data *dd)
+{
+	struct request *rq;
+	long delay;
+
+	if (!list_empty(&dd->fifo_list[WRITE]) && deadline_check_fifo(dd, WRITE))
+		return rq_entry_fifo(dd->fifo_list[WRITE].next);
+
+	if (!list_empty(&dd->fifo_list[READ])) {
+		rq = dd->next_rq[READ];
+		if (!rq || deadline_check_fifo(dd, READ))
+			rq = rq_entry_fifo(dd->fifo_list[READ].next);
+		return rq;
+	}
+
+	if (list_empty(&dd->fifo_list[WRITE]))
+		return NULL;
+
+	/* no reads queued: flush the writes that are ready, in sort order */
+	rq = dd->next_rq[WRITE];
+	if (rq && dd_write_ready(dd, rq))
+		return rq;
+
+	list_for_each_entry(rq, &dd->fifo_list[WRITE], queuelist)
+		if (dd_write_ready(dd, rq))
+			return rq;
+
+	/* the oldest write is the first one whose hold time runs out */
+	rq = rq_entry_fifo(dd->fifo_list[WRITE].next);
+	delay = (long)(dd_write_held_until(dd, rq) - jiffies);
+	blk_mq_delay_run_hw_queue(hctx, jiffies_to_msecs(max(delay, 1L)));
+
+	return NULL;
+}
+
 /*
  * deadline_dispatch_requests selects the best request according to
  * read/write expire, fifo_batch, etc
@@ -208,6 +296,14 @@ static struct request *__dd_dispatch_request(struct blk_mq_hw_ctx *hctx)
 		goto done;
 	}
 
+	if (dd->read_priority) {
+		rq = dd_read_priority_select(hctx, dd);
+		if (!rq)
+			return NULL;
+		dd->batching = 0;
+		goto dispatch_request;
+	}
+
 	reads = !list_empty(&dd->fifo_list[READ]);
 	writes = !list_empty(&dd->fifo_list[WRITE]);
 
@@ -338,6 +434,8 @@ static int dd_init_queue(struct request_queue *q, struct elevator_type *e)
 	dd->writes_starved = writes_starved;
 	dd->front_merges = 1;
 	dd->fifo_batch = fifo_batch;
+	dd->write_align = -1;
+	dd->write_hold = write_hold;
 	spin_lock_init(&dd->lock);
 	INIT_LIST_HEAD(&dd->dispatch);
 
@@ -480,6 +578,9 @@ SHOW_FUNCTION(deadline_write_expire_show, dd->fifo_expire[WRITE], 1);
 SHOW_FUNCTION(deadline_writes_starved_show, dd->writes_starved, 0);
 SHOW_FUNCTION(deadline_front_merges_show, dd->front_merges, 0);
 SHOW_FUNCTION(deadline_fifo_batch_show, dd->fifo_batch, 0);
+SHOW_FUNCTION(deadline_read_priority_show, dd->read_priority, 0);
+SHOW_FUNCTION(deadline_write_align_show, dd->write_align, 0);
+SHOW_FUNCTION(deadline_write_hold_show, dd->write_hold, 1);
 #undef SHOW_FUNCTION
 
 #define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
@@ -503,6 +604,9 @@ STORE_FUNCTION(deadline_write_expire_store, &dd->fifo_expire[WRITE], 0, INT_MAX,
 STORE_FUNCTION(deadline_writes_starved_store, &dd->writes_starved, INT_MIN, INT_MAX, 0);
 STORE_FUNCTION(deadline_front_merges_store, &dd->front_merges, 0, 1, 0);
 STORE_FUNCTION(deadline_fifo_batch_store, &dd->fifo_batch, 0, INT_MAX, 0);
+STORE_FUNCTION(deadline_read_priority_store, &dd->read_priority, 0, 1, 0);
+STORE_FUNCTION(deadline_write_align_store, &dd->write_align, -1, INT_MAX, 0);
+STORE_FUNCTION(deadline_write_hold_store, &dd->write_hold, 0, INT_MAX, 1);
 #undef STORE_FUNCTION
 
 #define DD_ATTR(name) \
@@ -515,6 +619,9 @@ static struct elv_fs_entry deadline_attrs[] = {
 	DD_ATTR(writes_starved),
 	DD_ATTR(front_merges),
 	DD_ATTR(fifo_batch),
+	DD_ATTR(read_priority),
+	DD_ATTR(write_align),
+	DD_ATTR(write_hold),
 	__ATTR_NULL
 };
 
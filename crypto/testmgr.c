@@ -567,6 +567,88 @@ static int test_hash(struct crypto_ahash *tfm,
 	return 0;
 }
 
+/*
+ * Hash every vector as all messages of one crypto_shash_finup_mb() call,
+ * once from the start and once after a third of it went through update so
+ * that the messages continue from a partial block.
+ */
+static int test_shash_finup_mb(struct crypto_shash *tfm,
+			       const struct hash_testvec *template,
+			       unsigned int tcount)
+{
+	const char *algo = crypto_tfm_alg_driver_name(crypto_shash_tfm(tfm));
+	unsigned int num_msgs = crypto_shash_mb_max_msgs(tfm);
+	unsigned int ds = crypto_shash_digestsize(tfm);
+	const u8 *data[HASH_MAX_MB_MSGS];
+	u8 *outs[HASH_MAX_MB_MSGS];
+	unsigned int i, j, head;
+	u8 *buf, *result;
+	int ret = 0;
+
+	if (num_msgs < 2)
+		return 0;
+
+	result = kmalloc(num_msgs * ds, GFP_KERNEL);
+	if (!result)
+		return -ENOMEM;
+
+	for (i = 0; i < tcount && !ret; i++) {
+		unsigned int psize = template[i].psize;
+		/* odd stride, so the messages differ in alignment */
+		unsigned int stride = psize | 1;
+
+		if (template[i].np || template[i].ksize)
+			continue;
+
+		buf = kmalloc(num_msgs * stride, GFP_KERNEL);
+		if (!buf) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		for (j = 0; j < num_msgs; j++)
+			memcpy(buf + j * stride, template[i].plaintext, psize);
+
+		for (head = 0; head <= psize / 3 && !ret; head += psize / 3 ?: 1) {
+			SHASH_DESC_ON_STACK(desc, tfm);
+
+			desc->tfm = tfm;
+			desc->flags = 0;
+
+			for (j = 0; j < num_msgs; j++) {
+				data[j] = buf + j * stride + head;
+				outs[j] = result + j * ds;
+			}
+			memset(result, 0, num_msgs * ds);
+
+			ret = crypto_shash_init(desc) ?:
+			      crypto_shash_update(desc, buf, head) ?:
+			      crypto_shash_finup_mb(desc, data, psize - head,
+						    outs, num_msgs);
+			if (ret) {
+				pr_err("alg: hash: finup_mb failed on test %u for %s: ret=%d\n",
+				       i + 1, algo, -ret);
+				break;
+			}
+
+			for (j = 0; j < num_msgs; j++) {
+				if (memcmp(outs[j], template[i].digest, ds)) {
+					pr_err("alg: hash: finup_mb test %u failed for %s, message %u, head %u\n",
+					       i + 1, algo, j, head);
+					hexdump(outs[j], ds);
+					ret = -EINVAL;
+					break;
+				}
+			}
+		}
+
+		kfree(buf);
+	}
+
+	kfree(result);
+	return ret;
+}
+
 static int __test_aead(struct crypto_aead *tfm, int enc,
 		       const struct aead_testvec *template, unsigned int tcount,
 		       const bool diff_dst, const int align_offset)
@@ -1827,6 +1909,19 @@ static int alg_test_hash(const struct alg_test_desc *desc, const char *driver,
 				desc->suite.hash.count, false);
 
 	crypto_free_ahash(tfm);
+
+	if (!err) {
+		struct crypto_shash *stfm;
+
+		/* only synchronous hashes have finup_mb */
+		stfm = crypto_alloc_shash(driver, type, mask);
+		if (!IS_ERR(stfm)) {
+			err = test_shash_finup_mb(stfm, desc->suite.hash.vecs,
+						  desc->suite.hash.count);
+			crypto_free_shash(stfm);
+		}
+	}
+
 	return err;
 }
 
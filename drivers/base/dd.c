@@ -24,6 +24,7 @@
 #include <linux/kthread.h>
 #include <linux/wait.h>
 #include <linux/async.h>
+#include <linux/of.h>
 #include <linux/pm_runtime.h>
 #include <linux/pinctrl/devinfo.h>
 
@@ -54,6 +55,9 @@ static LIST_HEAD(deferred_probe_pending_list);
 static LIST_HEAD(deferred_probe_active_list);
 static atomic_t deferred_trigger_count = ATOMIC_INIT(0);
 
+/* Quiet time after the last bind before all deferred devices are retried */
+#define DEFERRED_PROBE_SWEEP_MS	50
+
 /*
  * In some cases, like suspend to RAM or hibernation, It might be reasonable
  * to prohibit probing of devices as it could be unsafe.
@@ -61,6 +65,9 @@ static atomic_t deferred_trigger_count = ATOMIC_INIT(0);
  */
 static bool defer_all_probes;
 
+/* Device deferred_probe_work_func() is retrying, for the initcall stats */
+static struct device *deferred_probe_retry_dev;
+
 /*
  * deferred_probe_work_func() - Retry probing devices in the active list.
  */
@@ -106,7 +113,9 @@ static void deferred_probe_work_func(struct work_struct *work)
 		device_pm_unlock();
 
 		dev_dbg(dev, "Retrying from deferred list\n");
+		deferred_probe_retry_dev = dev;
 		bus_probe_device(dev);
+		deferred_probe_retry_dev = NULL;
 
 		mutex_lock(&deferred_probe_mutex);
 
@@ -178,6 +187,141 @@ static void driver_deferred_probe_trigger(void)
 	schedule_work(&deferred_probe_work);
 }
 
+static void deferred_probe_sweep_func(struct work_struct *work)
+{
+	driver_deferred_probe_trigger();
+}
+static DECLARE_DELAYED_WORK(deferred_probe_sweep_work,
+			    deferred_probe_sweep_func);
+
+/*
+ * Phandle lists naming the suppliers of a device in DT.  Properties made
+ * of a single phandle, like the *-supply regulators, don't need listing.
+ */
+static const struct {
+	const char *list;
+	const char *cells;
+} deferred_probe_supplier_props[] = {
+	{ "clocks", "#clock-cells" },
+	{ "dmas", "#dma-cells" },
+	{ "resets", "#reset-cells" },
+	{ "power-domains", "#power-domain-cells" },
+	{ "phys", "#phy-cells" },
+	{ "pwms", "#pwm-cells" },
+	{ "iommus", "#iommu-cells" },
+	{ "mboxes", "#mbox-cells" },
+};
+
+/* Check if @np is @supplier or below it, consumes the reference to @np */
+static bool deferred_probe_node_within(struct device_node *np,
+				       struct device_node *supplier)
+{
+	while (np && np != supplier)
+		np = of_get_next_parent(np);
+	of_node_put(np);
+
+	return np != NULL;
+}
+
+/*
+ * Check if @dev may be waiting for @supplier, going by the DT node of @dev:
+ * its parent or one of its phandles is @supplier or a node below it.  The
+ * parent covers the devices of an FPGA region.  Any property holding a
+ * single cell is tried as a phandle, a value that is not one only costs a
+ * useless retry.
+ */
+static bool driver_deferred_probe_depends(struct device *dev,
+					  struct device_node *supplier)
+{
+	struct device_node *np = dev->of_node;
+	struct of_phandle_args args;
+	struct property *prop;
+	int i, n;
+
+	if (!np)
+		return false;
+
+	if (deferred_probe_node_within(of_get_parent(np), supplier))
+		return true;
+
+	for (i = 0; i < ARRAY_SIZE(deferred_probe_supplier_props); i++) {
+		for (n = 0; !of_parse_phandle_with_args(np,
+				deferred_probe_supplier_props[i].list,
+				deferred_probe_supplier_props[i].cells, n,
+				&args); n++) {
+			if (deferred_probe_node_within(args.np, supplier))
+				return true;
+		}
+	}
+
+	for_each_property_of_node(np, prop) {
+		if (prop->length != sizeof(__be32))
+			continue;
+		if (deferred_probe_node_within(of_find_node_by_phandle(
+				be32_to_cpup(prop->value)), supplier))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * driver_deferred_probe_trigger_consumers() - Re-probe consumers of a device
+ * @dev: device that was just bound to a driver
+ *
+ * Retrying every deferred device each time a device binds is quadratic in
+ * the number of deferred devices.  Only the deferred devices that depend on
+ * @dev through DT are retried right away, see
+ * driver_deferred_probe_depends().  DT does not tell every dependency, so
+ * all the deferred devices are still retried, but only once no device has
+ * bound for DEFERRED_PROBE_SWEEP_MS.
+ */
+static void driver_deferred_probe_trigger_consumers(struct device *dev)
+{
+	struct device_private *private, *next;
+
+	if (!driver_deferred_probe_enable)
+		return;
+
+	if (!dev->of_node) {
+		driver_deferred_probe_trigger();
+		return;
+	}
+
+	mutex_lock(&deferred_probe_mutex);
+	atomic_inc(&deferred_trigger_count);
+	list_for_each_entry_safe(private, next, &deferred_probe_pending_list,
+				 deferred_probe) {
+		if (driver_deferred_probe_depends(private->device,
+						  dev->of_node))
+			list_move_tail(&private->deferred_probe,
+				       &deferred_probe_active_list);
+	}
+	mutex_unlock(&deferred_probe_mutex);
+
+	schedule_work(&deferred_probe_work);
+	mod_delayed_work(system_wq, &deferred_probe_sweep_work,
+			 msecs_to_jiffies(DEFERRED_PROBE_SWEEP_MS));
+}
+
+/*
+ * Retry a deferred device alone, when a device bound while it was probing
+ * and it may have missed the trigger for its supplier.
+ */
+static void driver_deferred_probe_retry(struct device *dev)
+{
+	if (!driver_deferred_probe_enable)
+		return;
+
+	mutex_lock(&deferred_probe_mutex);
+	if (!list_empty(&dev->p->deferred_probe))
+		list_move_tail(&dev->p->deferred_probe,
+			       &deferred_probe_active_list);
+	mutex_unlock(&deferred_probe_mutex);
+
+	schedule_work(&deferred_probe_work);
+}
+
 /**
  * device_block_probing() - Block/defere device's probes
  *
@@ -215,6 +359,8 @@ static int deferred_probe_initcall(void)
 	driver_deferred_probe_trigger();
 	/* Sort as many dependencies as possible before exiting initcalls */
 	flush_work(&deferred_probe_work);
+	while (flush_delayed_work(&deferred_probe_sweep_work))
+		flush_work(&deferred_probe_work);
 	return 0;
 }
 late_initcall(deferred_probe_initcall);
@@ -251,10 +397,10 @@ static void driver_bound(struct device *dev)
 
 	/*
 	 * Make sure the device is no longer in one of the deferred lists and
-	 * kick off retrying all pending devices
+	 * kick off retrying the pending devices that depend on it
 	 */
 	driver_deferred_probe_del(dev);
-	driver_deferred_probe_trigger();
+	driver_deferred_probe_trigger_consumers(dev);
 
 	if (dev->bus)
 		blocking_notifier_call_chain(&dev->bus->p->bus_notifier,
@@ -442,9 +588,9 @@ pinctrl_bind_failed:
 		/* Driver requested deferred probing */
 		dev_dbg(dev, "Driver %s requests probe deferral\n", drv->name);
 		driver_deferred_probe_add(dev);
-		/* Did a trigger occur while probing? Need to re-trigger if yes */
+		/* Did a trigger occur while probing? Need to retry if yes */
 		if (local_trigger_count != atomic_read(&deferred_trigger_count))
-			driver_deferred_probe_trigger();
+			driver_deferred_probe_retry(dev);
 		break;
 	case -ENODEV:
 	case -ENXIO:
@@ -513,6 +659,7 @@ EXPORT_SYMBOL_GPL(wait_for_device_probe);
  */
 int driver_probe_device(struct device_driver *drv, struct device *dev)
 {
+	u64 calltime = 0;
 	int ret = 0;
 
 	if (!device_is_registered(dev))
@@ -526,7 +673,13 @@ int driver_probe_device(struct device_driver *drv, struct device *dev)
 		pm_runtime_get_sync(dev->parent);
 
 	pm_runtime_barrier(dev);
+	if (IS_ENABLED(CONFIG_INITCALL_STATS))
+		calltime = ktime_get_ns();
 	ret = really_probe(dev, drv);
+	if (IS_ENABLED(CONFIG_INITCALL_STATS))
+		initcall_stats_add(NULL, drv->name, dev_name(dev),
+				   ktime_get_ns() - calltime, ret,
+				   dev == READ_ONCE(deferred_probe_retry_dev));
 	pm_request_idle(dev);
 
 	if (dev->parent)
@@ -269,6 +269,9 @@ static int __init rmem_cma_setup(struct reserved_mem *rmem)
 
 	if (of_get_flat_dt_prop(node, "linux,cma-default", NULL))
 		dma_contiguous_set_default(cma);
+	/* Scanout and DMA buffers that must not wait for migration */
+	if (of_get_flat_dt_prop(node, "linux,reserved-for-dma", NULL))
+		cma_set_reserved(cma);
 
 	rmem->ops = &rmem_cma_ops;
 	rmem->priv = cma;
@@ -11,6 +11,7 @@
 #include <linux/device.h>
 #include <linux/module.h>
 #include <linux/init.h>
+#include <linux/initrd.h>
 #include <linux/timer.h>
 #include <linux/vmalloc.h>
 #include <linux/interrupt.h>
@@ -31,6 +32,7 @@
 #include <linux/reboot.h>
 #include <linux/security.h>
 #include <linux/swait.h>
+#include <linux/of.h>
 
 #include <generated/utsrelease.h>
 
@@ -392,6 +394,8 @@ fw_get_filesystem_firmware(struct device *device, struct firmware_buf *buf)
 	enum kernel_read_file_id id = READING_FIRMWARE;
 	size_t msize = INT_MAX;
 
+	wait_for_initramfs();
+
 	/* Already populated data member means we're loading into a buffer */
 	if (buf->data) {
 		id = READING_FIRMWARE_PREALLOC_BUFFER;
@@ -1423,6 +1427,165 @@ request_firmware_nowait(
 }
 EXPORT_SYMBOL(request_firmware_nowait);
 
+/*
+ * Firmware preloading
+ *
+ * The images named by firmware_class.preload= and by the
+ * linux,firmware-preload property of /chosen are loaded in parallel as soon
+ * as the root filesystem is mounted, and kept loaded.  request_firmware()
+ * then returns the loaded buffer without looking the image up again, and
+ * requests coming in while it is still loading wait for the same buffer.
+ * Early userspace preloads more images by writing their names to
+ * /sys/module/firmware_class/parameters/preload.  Images are only kept as
+ * long as they fit in preload_max_kb KiB altogether.
+ */
+struct fw_preload {
+	struct list_head list;
+	const char *name;
+	const struct firmware *fw;
+};
+
+static char fw_preload_para[256];
+static unsigned int fw_preload_max_kb = 16384;
+static DEFINE_MUTEX(fw_preload_lock);
+static LIST_HEAD(fw_preload_list);
+static size_t fw_preload_size;
+static bool fw_preload_ready;
+/* Exclusive, so that the boot does not wait for the preloads to finish */
+static ASYNC_DOMAIN_EXCLUSIVE(fw_preload_domain);
+
+static void fw_preload_one(void *data, async_cookie_t cookie)
+{
+	struct fw_preload *fwp = data;
+	const struct firmware *fw;
+	int ret;
+
+	ret = request_firmware_direct(&fw, fwp->name, NULL);
+
+	mutex_lock(&fw_preload_lock);
+	if (!ret && fw_preload_size + fw->size >
+	    (size_t)fw_preload_max_kb << 10) {
+		release_firmware(fw);
+		ret = -ENOSPC;
+	}
+	if (ret) {
+		list_del(&fwp->list);
+	} else {
+		fwp->fw = fw;
+		fw_preload_size += fw->size;
+	}
+	mutex_unlock(&fw_preload_lock);
+
+	if (ret) {
+		pr_warn("preloading %s failed: %d\n", fwp->name, ret);
+		kfree_const(fwp->name);
+		kfree(fwp);
+	}
+}
+
+/* Called with fw_preload_lock held */
+static void fw_preload_name(const char *name)
+{
+	struct fw_preload *fwp;
+
+	list_for_each_entry(fwp, &fw_preload_list, list) {
+		if (!strcmp(fwp->name, name))
+			return;
+	}
+
+	fwp = kzalloc(sizeof(*fwp), GFP_KERNEL);
+	if (!fwp)
+		return;
+
+	fwp->name = kstrdup_const(name, GFP_KERNEL);
+	if (!fwp->name) {
+		kfree(fwp);
+		return;
+	}
+
+	list_add_tail(&fwp->list, &fw_preload_list);
+	async_schedule_domain(fw_preload_one, fwp, &fw_preload_domain);
+}
+
+/* Called with fw_preload_lock held, names are separated by ',' or spaces */
+static void fw_preload_names(char *names)
+{
+	char *name;
+
+	while ((name = strsep(&names, ", \t\n")) != NULL) {
+		if (*name)
+			fw_preload_name(name);
+	}
+}
+
+/**
+ * firmware_preload() - start preloading the firmware images listed at boot
+ *
+ * Called once the root filesystem is mounted.
+ */
+void firmware_preload(void)
+{
+	struct device_node *chosen;
+	struct property *prop;
+	const char *name;
+
+	mutex_lock(&fw_preload_lock);
+	fw_preload_ready = true;
+	fw_preload_names(fw_preload_para);
+
+	chosen = of_find_node_by_path("/chosen");
+	of_property_for_each_string(chosen, "linux,firmware-preload", prop,
+				    name)
+		fw_preload_name(name);
+	of_node_put(chosen);
+	mutex_unlock(&fw_preload_lock);
+}
+
+static int fw_preload_set(const char *val, const struct kernel_param *kp)
+{
+	char *names;
+
+	mutex_lock(&fw_preload_lock);
+	if (!fw_preload_ready && system_state == SYSTEM_BOOTING) {
+		/* From the command line, the root filesystem isn't there yet */
+		strlcpy(fw_preload_para, val, sizeof(fw_preload_para));
+	} else {
+		fw_preload_ready = true;
+		names = kstrdup(val, GFP_KERNEL);
+		if (names)
+			fw_preload_names(names);
+		kfree(names);
+	}
+	mutex_unlock(&fw_preload_lock);
+
+	return 0;
+}
+
+static int fw_preload_get(char *buffer, const struct kernel_param *kp)
+{
+	struct fw_preload *fwp;
+	int len = 0;
+
+	mutex_lock(&fw_preload_lock);
+	list_for_each_entry(fwp, &fw_preload_list, list) {
+		if (fwp->fw)
+			len += scnprintf(buffer + len, PAGE_SIZE - len, "%s%s",
+					 len ? "," : "", fwp->name);
+	}
+	mutex_unlock(&fw_preload_lock);
+
+	return len;
+}
+
+static const struct kernel_param_ops fw_preload_ops = {
+	.set = fw_preload_set,
+	.get = fw_preload_get,
+};
+module_param_cb(preload, &fw_preload_ops, NULL, 0644);
+MODULE_PARM_DESC(preload, "firmware images to load once the root filesystem is mounted, and to keep loaded");
+module_param_named(preload_max_kb, fw_preload_max_kb, uint, 0644);
+MODULE_PARM_DESC(preload_max_kb, "maximum size of the preloaded firmware images, in KiB");
+
 #ifdef CONFIG_PM_SLEEP
 static ASYNC_DOMAIN_EXCLUSIVE(fw_cache_domain);
 
@@ -40,6 +40,10 @@
 #include <linux/signal.h>
 #include <linux/ioctl.h>
 #include <linux/skbuff.h>
+#include <linux/delay.h>
+#include <linux/gpio/consumer.h>
+#include <linux/of.h>
+#include <linux/serdev.h>
 #include <asm/unaligned.h>
 
 #include <net/bluetooth/bluetooth.h>
@@ -52,6 +56,12 @@ struct h4_struct {
 	struct sk_buff_head txq;
 };
 
+/* A controller on a serdev bus, see h4_serdev_probe() */
+struct h4_serdev {
+	struct hci_uart hu;
+	struct gpio_desc *enable_gpio;
+};
+
 /* Initialize protocol */
 static int h4_open(struct hci_uart *hu)
 {
@@ -59,9 +69,29 @@ static int h4_open(struct hci_uart *hu)
 
 	BT_DBG("hu %p", hu);
 
+	if (hu->serdev) {
+		struct h4_serdev *h4dev = serdev_device_get_drvdata(hu->serdev);
+		int err;
+
+		err = serdev_device_open(hu->serdev);
+		if (err)
+			return err;
+
+		/* H4 has no means to recover lost bytes */
+		serdev_device_set_flow_control(hu->serdev, true);
+
+		if (h4dev->enable_gpio) {
+			gpiod_set_value_cansleep(h4dev->enable_gpio, 1);
+			msleep(100);
+		}
+	}
+
 	h4 = kzalloc(sizeof(*h4), GFP_KERNEL);
-	if (!h4)
+	if (!h4) {
+		if (hu->serdev)
+			serdev_device_close(hu->serdev);
 		return -ENOMEM;
+	}
 
 	skb_queue_head_init(&h4->txq);
 
@@ -97,6 +127,13 @@ static int h4_close(struct hci_uart *hu)
 	hu->priv = NULL;
 	kfree(h4);
 
+	if (hu->serdev) {
+		struct h4_serdev *h4dev = serdev_device_get_drvdata(hu->serdev);
+
+		gpiod_set_value_cansleep(h4dev->enable_gpio, 0);
+		serdev_device_close(hu->serdev);
+	}
+
 	return 0;
 }
 
@@ -157,16 +194,135 @@ static const struct hci_uart_proto h4p = {
 	.flush		= h4_flush,
 };
 
+#ifdef CONFIG_BT_HCIUART_SERDEV
+/*
+ * Controllers that speak plain H4 and need no vendor setup, on a UART
+ * described in the device tree. Received bytes come straight from the
+ * serial driver's flip buffer work, without a line discipline in between.
+ */
+static int h4_serdev_probe(struct serdev_device *serdev)
+{
+	struct h4_serdev *h4dev;
+	struct hci_uart *hu;
+	u32 speed = 115200;
+
+	h4dev = devm_kzalloc(&serdev->dev, sizeof(*h4dev), GFP_KERNEL);
+	if (!h4dev)
+		return -ENOMEM;
+	hu = &h4dev->hu;
+
+	serdev_device_set_drvdata(serdev, h4dev);
+	hu->serdev = serdev;
+
+	h4dev->enable_gpio = devm_gpiod_get_optional(&serdev->dev, "enable",
+						     GPIOD_OUT_LOW);
+	if (IS_ERR(h4dev->enable_gpio))
+		return PTR_ERR(h4dev->enable_gpio);
+
+	/* The controller must come up at this rate, H4 can't change it */
+	of_property_read_u32(serdev->dev.of_node, "current-speed", &speed);
+	hci_uart_set_speeds(hu, speed, 0);
+
+	return hci_uart_register_device(hu, &h4p);
+}
+
+static void h4_serdev_remove(struct serdev_device *serdev)
+{
+	struct h4_serdev *h4dev = serdev_device_get_drvdata(serdev);
+	struct hci_uart *hu = &h4dev->hu;
+	struct hci_dev *hdev = hu->hdev;
+
+	cancel_work_sync(&hu->write_work);
+
+	hci_unregister_dev(hdev);
+	hci_free_dev(hdev);
+	hu->proto->close(hu);
+}
+
+static const struct of_device_id h4_serdev_of_match[] = {
+	{ .compatible = "gameslab,bluetooth-h4" },
+	{},
+};
+MODULE_DEVICE_TABLE(of, h4_serdev_of_match);
+
+static struct serdev_device_driver h4_serdev_drv = {
+	.driver		= {
+		.name	= "hci-h4",
+		.of_match_table = of_match_ptr(h4_serdev_of_match),
+	},
+	.probe	= h4_serdev_probe,
+	.remove	= h4_serdev_remove,
+};
+#endif
+
 int __init h4_init(void)
 {
+#ifdef CONFIG_BT_HCIUART_SERDEV
+	serdev_device_driver_register(&h4_serdev_drv);
+#endif
+
 	return hci_uart_register_proto(&h4p);
 }
 
 int __exit h4_deinit(void)
 {
+#ifdef CONFIG_BT_HCIUART_SERDEV
+	serdev_device_driver_unregister(&h4_serdev_drv);
+#endif
+
 	return hci_uart_unregister_proto(&h4p);
 }
 
+/*
+ * Hand over a packet that is complete in the buffer, in an skb of its own
+ * size. Returns the bytes consumed, including the packet type, or 0 when
+ * the packet must be reassembled.
+ */
+static int h4_recv_complete(struct hci_dev *hdev, const unsigned char *buffer,
+			    int count, const struct h4_recv_pkt *pkt)
+{
+	struct hci_uart *hu = hci_get_drvdata(hdev);
+	u8 alignment = hu->alignment;
+	struct sk_buff *skb;
+	int dlen, len;
+
+	if (count < 1 + pkt->hlen)
+		return 0;
+
+	switch (pkt->lsize) {
+	case 0:
+		dlen = 0;
+		break;
+	case 1:
+		dlen = buffer[1 + pkt->loff];
+		break;
+	case 2:
+		dlen = get_unaligned_le16(buffer + 1 + pkt->loff);
+		break;
+	default:
+		return 0;
+	}
+
+	len = pkt->hlen + dlen;
+	if (count < 1 + len || len > pkt->maxlen)
+		return 0;
+
+	skb = bt_skb_alloc(len, GFP_ATOMIC);
+	if (!skb)
+		return -ENOMEM;
+
+	hci_skb_pkt_type(skb) = pkt->type;
+	hci_skb_expect(skb) = len;
+	memcpy(skb_put(skb, len), buffer + 1, len);
+
+	hu->padding = (skb->len - 1) % alignment;
+	hu->padding = (alignment - hu->padding) % alignment;
+
+	pkt->recv(hdev, skb);
+
+	return 1 + len;
+}
+
 struct sk_buff *h4_recv_buf(struct hci_dev *hdev, struct sk_buff *skb,
 			    const unsigned char *buffer, int count,
 			    const struct h4_recv_pkt *pkts, int pkts_count)
@@ -175,7 +331,7 @@ struct sk_buff *h4_recv_buf(struct hci_dev *hdev, struct sk_buff *skb,
 	u8 alignment = hu->alignment;
 
 	while (count) {
-		int i, len;
+		int i, len = 0;
 
 		/* remove padding bytes from buffer */
 		for (; hu->padding && count > 0; hu->padding--) {
@@ -190,6 +346,11 @@ struct sk_buff *h4_recv_buf(struct hci_dev *hdev, struct sk_buff *skb,
 				if (buffer[0] != (&pkts[i])->type)
 					continue;
 
+				len = h4_recv_complete(hdev, buffer, count,
+						       &pkts[i]);
+				if (len)
+					break;
+
 				skb = bt_skb_alloc((&pkts[i])->maxlen,
 						   GFP_ATOMIC);
 				if (!skb)
@@ -200,6 +361,15 @@ struct sk_buff *h4_recv_buf(struct hci_dev *hdev, struct sk_buff *skb,
 				break;
 			}
 
+			if (len < 0)
+				return ERR_PTR(len);
+
+			if (len) {
+				count -= len;
+				buffer += len;
+				continue;
+			}
+
 			/* Check for invalid packet type */
 			if (!skb)
 				return ERR_PTR(-EILSEQ);
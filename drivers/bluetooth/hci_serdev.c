@@ -283,6 +283,10 @@ int hci_uart_register_device(struct hci_uart *hu,
 
 	serdev_device_set_client_ops(hu->serdev, &hci_serdev_client_ops);
 
+	/* h4_recv_buf() pads to this, the line discipline sets it too */
+	if (!hu->alignment)
+		hu->alignment = 1;
+
 	err = p->open(hu);
 	if (err)
 		return err;
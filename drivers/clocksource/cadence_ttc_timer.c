@@ -19,6 +19,7 @@
 #include <linux/interrupt.h>
 #include <linux/clockchips.h>
 #include <linux/clocksource.h>
+#include <linux/cpu.h>
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
 #include <linux/slab.h>
@@ -31,6 +32,9 @@
  * T2: Timer 2, clockevent source for hrtimers
  * T3: Timer 3, <unused>
  *
+ * On SMP systems whose device tree gives T3 an interrupt, T2 and T3 are
+ * instead per-CPU clockevent sources for CPU0 and CPU1.
+ *
  * The input frequency to the timer module for emulation is 2.5MHz which is
  * common to all the timer channels (T1, T2, and T3). With a pre-scaler of 32,
  * the timers are clocked at 78.125KHz (12.8 us resolution).
@@ -66,6 +70,16 @@
 #define CLK_CNTRL_PRESCALE_EN	1
 #define CNT_CNTRL_RESET		(1 << 4)
 
+/*
+ * The clockevent timers only have to span a few tens of milliseconds,
+ * so prescale them no further than needed to keep this rate. That gives
+ * hrtimers about microsecond resolution rather than that of PRESCALE.
+ */
+#define TTC_CE_MIN_RATE		1000000
+#define TTC_CE_MAX_EXPONENT	16
+
+#define TTC_CE_PERCPU		2	/* T2 and T3 */
+
 #define MAX_F_ERR 50
 
 /**
@@ -99,6 +113,8 @@ struct ttc_timer_clocksource {
 struct ttc_timer_clockevent {
 	struct ttc_timer		ttc;
 	struct clock_event_device	ce;
+	unsigned long			prescale;
+	int				cpu;	/* -1 if not per-CPU */
 };
 
 #define to_ttc_timer_clkevent(x) \
@@ -106,6 +122,8 @@ struct ttc_timer_clockevent {
 
 static void __iomem *ttc_sched_clock_val_reg;
 
+static struct ttc_timer_clockevent *ttc_percpu_ce[TTC_CE_PERCPU];
+
 /**
  * ttc_set_interval - Set the timer interval value
  *
@@ -213,7 +231,7 @@ static int ttc_set_periodic(struct clock_event_device *evt)
 	struct ttc_timer *timer = &ttce->ttc;
 
 	ttc_set_interval(timer,
-			 DIV_ROUND_CLOSEST(ttce->ttc.freq, PRESCALE * HZ));
+			 DIV_ROUND_CLOSEST(ttce->ttc.freq, ttce->prescale * HZ));
 	return 0;
 }
 
@@ -383,6 +401,13 @@ static int __init ttc_setup_clocksource(struct clk *clk, void __iomem *base,
 	return 0;
 }
 
+static void ttc_clockevent_update_freq(void *info)
+{
+	struct ttc_timer_clockevent *ttcce = info;
+
+	clockevents_update_freq(&ttcce->ce, ttcce->ttc.freq / ttcce->prescale);
+}
+
 static int ttc_rate_change_clockevent_cb(struct notifier_block *nb,
 		unsigned long event, void *data)
 {
@@ -396,7 +421,16 @@ static int ttc_rate_change_clockevent_cb(struct notifier_block *nb,
 		/* update cached frequency */
 		ttc->freq = ndata->new_rate;
 
-		clockevents_update_freq(&ttcce->ce, ndata->new_rate / PRESCALE);
+		/*
+		 * A per-CPU device must be reprogrammed on its own CPU. If
+		 * that CPU is offline, registration picks up the new rate.
+		 */
+		if (ttcce->cpu >= 0)
+			smp_call_function_single(ttcce->cpu,
+						 ttc_clockevent_update_freq,
+						 ttcce, 1);
+		else
+			ttc_clockevent_update_freq(ttcce);
 
 		/* fall through */
 	case PRE_RATE_CHANGE:
@@ -406,10 +440,54 @@ static int ttc_rate_change_clockevent_cb(struct notifier_block *nb,
 	}
 }
 
+static unsigned long __init ttc_clockevent_prescale(unsigned long freq)
+{
+	unsigned int exp = 1;
+
+	while (exp < TTC_CE_MAX_EXPONENT &&
+	       (freq >> (exp + 1)) >= TTC_CE_MIN_RATE)
+		exp++;
+
+	return 1UL << exp;
+}
+
+static void ttc_clockevent_register(struct ttc_timer_clockevent *ttcce)
+{
+	clockevents_config_and_register(&ttcce->ce,
+			ttcce->ttc.freq / ttcce->prescale, 1, 0xfffe);
+}
+
+static int ttc_starting_cpu(unsigned int cpu)
+{
+	struct ttc_timer_clockevent *ttcce;
+
+	if (cpu >= TTC_CE_PERCPU || !ttc_percpu_ce[cpu])
+		return 0;
+
+	ttcce = ttc_percpu_ce[cpu];
+	irq_force_affinity(ttcce->ce.irq, cpumask_of(cpu));
+	ttc_clockevent_register(ttcce);
+	return 0;
+}
+
+static int ttc_dying_cpu(unsigned int cpu)
+{
+	if (cpu >= TTC_CE_PERCPU || !ttc_percpu_ce[cpu])
+		return 0;
+
+	ttc_shutdown(&ttc_percpu_ce[cpu]->ce);
+	return 0;
+}
+
+/*
+ * Set up the counter at @base as a clockevent source. A per-CPU source
+ * (@cpu >= 0) is only registered once that CPU comes up.
+ */
 static int __init ttc_setup_clockevent(struct clk *clk,
-				       void __iomem *base, u32 irq)
+				       void __iomem *base, u32 irq, int cpu)
 {
 	struct ttc_timer_clockevent *ttcce;
+	unsigned long irqflags = IRQF_TIMER;
 	int err;
 
 	ttcce = kzalloc(sizeof(*ttcce), GFP_KERNEL);
@@ -436,6 +514,8 @@ static int __init ttc_setup_clockevent(struct clk *clk,
 	}
 
 	ttcce->ttc.freq = clk_get_rate(ttcce->ttc.clk);
+	ttcce->prescale = ttc_clockevent_prescale(ttcce->ttc.freq);
+	ttcce->cpu = cpu;
 
 	ttcce->ttc.base_addr = base;
 	ttcce->ce.name = "ttc_clockevent";
@@ -447,31 +527,67 @@ static int __init ttc_setup_clockevent(struct clk *clk,
 	ttcce->ce.tick_resume = ttc_resume;
 	ttcce->ce.rating = 200;
 	ttcce->ce.irq = irq;
-	ttcce->ce.cpumask = cpu_possible_mask;
+	if (cpu >= 0) {
+		ttcce->ce.cpumask = cpumask_of(cpu);
+		irqflags |= IRQF_NOBALANCING;
+	} else {
+		ttcce->ce.cpumask = cpu_possible_mask;
+	}
 
 	/*
 	 * Setup the clock event timer to be an interval timer which
-	 * is prescaled by 32 using the interval interrupt. Leave it
+	 * is prescaled using the interval interrupt. Leave it
 	 * disabled for now.
 	 */
 	writel_relaxed(0x23, ttcce->ttc.base_addr + TTC_CNT_CNTRL_OFFSET);
-	writel_relaxed(CLK_CNTRL_PRESCALE | CLK_CNTRL_PRESCALE_EN,
-		     ttcce->ttc.base_addr + TTC_CLK_CNTRL_OFFSET);
+	writel_relaxed(((__ffs(ttcce->prescale) - 1) << 1) |
+		       CLK_CNTRL_PRESCALE_EN,
+		       ttcce->ttc.base_addr + TTC_CLK_CNTRL_OFFSET);
 	writel_relaxed(0x1,  ttcce->ttc.base_addr + TTC_IER_OFFSET);
 
 	err = request_irq(irq, ttc_clock_event_interrupt,
-			  IRQF_TIMER, ttcce->ce.name, ttcce);
+			  irqflags, ttcce->ce.name, ttcce);
 	if (err) {
 		kfree(ttcce);
 		return err;
 	}
 
-	clockevents_config_and_register(&ttcce->ce,
-			ttcce->ttc.freq / PRESCALE, 1, 0xfffe);
+	if (cpu >= 0)
+		ttc_percpu_ce[cpu] = ttcce;
+	else
+		ttc_clockevent_register(ttcce);
 
 	return 0;
 }
 
+/*
+ * Use T2 and T3 as clockevent sources for CPU0 and CPU1, so each CPU
+ * has its own high-rate timer for hrtimers.
+ */
+static int __init ttc_setup_percpu_clockevents(struct device_node *timer,
+					       void __iomem *base,
+					       struct clk *clk_ce, u32 irq)
+{
+	unsigned int irq3;
+	int ret;
+
+	irq3 = irq_of_parse_and_map(timer, 2);
+	if (!irq3)
+		return -ENODEV;
+
+	ret = ttc_setup_clockevent(clk_ce, base + 4, irq, 0);
+	if (ret)
+		return ret;
+
+	ret = ttc_setup_clockevent(clk_ce, base + 8, irq3, 1);
+	if (ret)
+		return ret;
+
+	return cpuhp_setup_state(CPUHP_AP_CADENCE_TTC_TIMER_STARTING,
+				 "clockevents/cadence/ttc:starting",
+				 ttc_starting_cpu, ttc_dying_cpu);
+}
+
 /**
  * ttc_timer_init - Initialize the timer
  *
@@ -531,7 +647,11 @@ static int __init ttc_timer_init(struct device_node *timer)
 	if (ret)
 		return ret;
 
-	ret = ttc_setup_clockevent(clk_ce, timer_baseaddr + 4, irq);
+	if (num_possible_cpus() > 1 && of_irq_count(timer) >= 3)
+		ret = ttc_setup_percpu_clockevents(timer, timer_baseaddr,
+						   clk_ce, irq);
+	else
+		ret = ttc_setup_clockevent(clk_ce, timer_baseaddr + 4, irq, -1);
 	if (ret)
 		return ret;
 
@@ -13,6 +13,14 @@
 
 #include "cpufreq-dt.h"
 
+/*
+ * The ARM PLL is never relocked, a CPU frequency change only rewrites the
+ * ARM_CLK_CTRL divisor. Let governors follow the load closely.
+ */
+static const struct cpufreq_dt_platform_data zynq_pdata __initconst = {
+	.transition_delay_us = 1000,
+};
+
 static const struct of_device_id machines[] __initconst = {
 	{ .compatible = "allwinner,sun4i-a10", },
 	{ .compatible = "allwinner,sun5i-a10s", },
@@ -92,7 +100,7 @@ static const struct of_device_id machines[] __initconst = {
 	{ .compatible = "ti,omap4", },
 	{ .compatible = "ti,omap5", },
 
-	{ .compatible = "xlnx,zynq-7000", },
+	{ .compatible = "xlnx,zynq-7000", .data = &zynq_pdata, },
 
 	{ .compatible = "zte,zx296718", },
 
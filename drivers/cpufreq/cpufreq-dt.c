@@ -40,6 +40,9 @@ static struct freq_attr *cpufreq_dt_attr[] = {
 	NULL,
 };
 
+/* From the platform data, applied to every policy */
+static unsigned int transition_delay_us;
+
 static int set_target(struct cpufreq_policy *policy, unsigned int index)
 {
 	struct private_data *priv = policy->driver_data;
@@ -274,6 +277,7 @@ static int cpufreq_init(struct cpufreq_policy *policy)
 		transition_latency = CPUFREQ_ETERNAL;
 
 	policy->cpuinfo.transition_latency = transition_latency;
+	policy->transition_delay_us = transition_delay_us;
 
 	return 0;
 
@@ -371,6 +375,9 @@ static int dt_cpufreq_probe(struct platform_device *pdev)
 	if (data && data->have_governor_per_policy)
 		dt_cpufreq_driver.flags |= CPUFREQ_HAVE_GOVERNOR_PER_POLICY;
 
+	if (data)
+		transition_delay_us = data->transition_delay_us;
+
 	ret = cpufreq_register_driver(&dt_cpufreq_driver);
 	if (ret)
 		dev_err(&pdev->dev, "failed register driver: %d\n", ret);
@@ -14,6 +14,8 @@
 
 struct cpufreq_dt_platform_data {
 	bool have_governor_per_policy;
+	/* Minimum time between two requests of a governor, 0 for default */
+	unsigned int transition_delay_us;
 };
 
 #endif /* __CPUFREQ_DT_H__ */
@@ -27,17 +27,44 @@
 
 #include <linux/init.h>
 #include <linux/cpuidle.h>
+#include <linux/moduleparam.h>
 #include <linux/platform_device.h>
+#include <linux/platform_data/cpuidle-zynq.h>
 #include <asm/cpuidle.h>
 
 #define ZYNQ_MAX_STATES		2
 
-/* Actual code that puts the SoC in different idle states */
+static atomic_t zynq_idle_barrier;
+
+static struct cpuidle_zynq_data *zynq_cpuidle_pdata;
+
+/*
+ * DDR self refresh also stalls every bus master, the display scanout and
+ * audio DMA included, and none of them holds off idle with a PM QoS
+ * request. The latency and residency below are estimates, not measured,
+ * so the state is only used on request.
+ */
+static bool ram_sr;
+module_param(ram_sr, bool, 0444);
+MODULE_PARM_DESC(ram_sr, "enable the RAM self refresh idle state");
+
+/*
+ * Actual code that puts the SoC in different idle states. With more than
+ * one core this is a coupled state, DDR can only go to self refresh once
+ * every core waits in OCM and none of them fetches from DDR anymore.
+ */
 static int zynq_enter_idle(struct cpuidle_device *dev,
 			   struct cpuidle_driver *drv, int index)
 {
-	/* Add code for DDR self refresh start */
-	cpu_do_idle();
+	if (!dev->cpu)
+		zynq_cpuidle_pdata->prepare_self_refresh();
+
+	cpuidle_coupled_parallel_barrier(dev, &zynq_idle_barrier);
+
+	zynq_cpuidle_pdata->enter_self_refresh(dev->cpu);
+
+	/* The sync word must not be reset before every core is done */
+	cpuidle_coupled_parallel_barrier(dev, &zynq_idle_barrier);
 
 	return index;
 }
@@ -49,8 +76,9 @@ static struct cpuidle_driver zynq_idle_driver = {
 		ARM_CPUIDLE_WFI_STATE,
 		{
 			.enter			= zynq_enter_idle,
-			.exit_latency		= 10,
+			.exit_latency		= 40,
 			.target_residency	= 10000,
+			.flags			= CPUIDLE_FLAG_COUPLED,
 			.name			= "RAM_SR",
 			.desc			= "WFI and RAM Self Refresh",
 		},
@@ -64,7 +92,17 @@ static int zynq_cpuidle_probe(struct platform_device *pdev)
 {
 	pr_info("Xilinx Zynq CpuIdle Driver started\n");
 
-	return cpuidle_register(&zynq_idle_driver, NULL);
+	zynq_cpuidle_pdata = pdev->dev.platform_data;
+	if (!zynq_cpuidle_pdata ||
+	    !zynq_cpuidle_pdata->self_refresh_available()) {
+		dev_info(&pdev->dev, "DDR self refresh unavailable\n");
+		zynq_idle_driver.state_count = 1;
+	} else if (!ram_sr) {
+		dev_info(&pdev->dev, "RAM_SR disabled, see cpuidle_zynq.ram_sr\n");
+		zynq_idle_driver.state_count = 1;
+	}
+
+	return cpuidle_register(&zynq_idle_driver, cpu_possible_mask);
 }
 
 static struct platform_driver zynq_cpuidle_driver = {
@@ -20,6 +20,7 @@
 #include <linux/ktime.h>
 #include <linux/hrtimer.h>
 #include <linux/module.h>
+#include <linux/seqlock.h>
 #include <linux/suspend.h>
 #include <linux/tick.h>
 #include <trace/events/power.h>
@@ -630,6 +631,136 @@ int cpuidle_register(struct cpuidle_driver *drv,
 }
 EXPORT_SYMBOL_GPL(cpuidle_register);
 
+/*
+ * A periodic wakeup source reports each of its interrupts along with the
+ * period it measured. The next one is then expected one period after the
+ * last, on the CPU that took it, which lets the governor avoid an idle
+ * state it would only leave again before the target residency. A source
+ * that missed two periods is considered stopped.
+ *
+ * The governor runs after RCU has stopped watching the idle CPU, so the
+ * sources live in a small static table, each behind a seqcount.
+ */
+#define CPUIDLE_WAKEUPS_MAX	4
+
+struct cpuidle_wakeup {
+	seqcount_t seq;
+	u64 last_ns;
+	u64 period_ns;
+	int cpu;
+	bool used;
+};
+
+static struct cpuidle_wakeup cpuidle_wakeups[CPUIDLE_WAKEUPS_MAX];
+static DEFINE_MUTEX(cpuidle_wakeup_lock);
+
+/**
+ * cpuidle_wakeup_register - add a periodic wakeup source
+ *
+ * Returns NULL if the table is full, which callers may ignore as all
+ * other functions accept a NULL source.
+ */
+struct cpuidle_wakeup *cpuidle_wakeup_register(void)
+{
+	struct cpuidle_wakeup *wk = NULL;
+	int i;
+
+	mutex_lock(&cpuidle_wakeup_lock);
+	for (i = 0; i < CPUIDLE_WAKEUPS_MAX; i++) {
+		if (!cpuidle_wakeups[i].used) {
+			wk = &cpuidle_wakeups[i];
+			seqcount_init(&wk->seq);
+			wk->last_ns = 0;
+			wk->period_ns = 0;
+			WRITE_ONCE(wk->used, true);
+			break;
+		}
+	}
+	mutex_unlock(&cpuidle_wakeup_lock);
+
+	return wk;
+}
+EXPORT_SYMBOL_GPL(cpuidle_wakeup_register);
+
+/**
+ * cpuidle_wakeup_unregister - remove a periodic wakeup source
+ * @wk: the source, may be NULL
+ */
+void cpuidle_wakeup_unregister(struct cpuidle_wakeup *wk)
+{
+	if (!wk)
+		return;
+
+	mutex_lock(&cpuidle_wakeup_lock);
+	WRITE_ONCE(wk->used, false);
+	mutex_unlock(&cpuidle_wakeup_lock);
+}
+EXPORT_SYMBOL_GPL(cpuidle_wakeup_unregister);
+
+/**
+ * cpuidle_wakeup_event - report an interrupt of a periodic wakeup source
+ * @wk: the source, may be NULL
+ * @now_ns: ktime_get_ns() of the interrupt, 0 when the source stops
+ * @period_ns: the period until the next interrupt, 0 if unknown
+ *
+ * Called from the interrupt handler with interrupts disabled. Events of
+ * one source must be serialized by the caller.
+ */
+void cpuidle_wakeup_event(struct cpuidle_wakeup *wk, u64 now_ns,
+			  u64 period_ns)
+{
+	if (!wk)
+		return;
+
+	write_seqcount_begin(&wk->seq);
+	wk->last_ns = now_ns;
+	wk->period_ns = period_ns;
+	wk->cpu = smp_processor_id();
+	write_seqcount_end(&wk->seq);
+}
+EXPORT_SYMBOL_GPL(cpuidle_wakeup_event);
+
+/**
+ * cpuidle_wakeup_next - time until the next expected periodic wakeup
+ * @cpu: the CPU going idle
+ * @now_ns: the current ktime_get_ns()
+ *
+ * Returns U64_MAX if no periodic interrupt is expected on @cpu.
+ */
+u64 cpuidle_wakeup_next(int cpu, u64 now_ns)
+{
+	u64 next = U64_MAX, last, period, delta;
+	unsigned int seq;
+	int i, wcpu;
+
+	for (i = 0; i < CPUIDLE_WAKEUPS_MAX; i++) {
+		struct cpuidle_wakeup *wk = &cpuidle_wakeups[i];
+
+		if (!READ_ONCE(wk->used))
+			continue;
+
+		do {
+			seq = read_seqcount_begin(&wk->seq);
+			last = wk->last_ns;
+			period = wk->period_ns;
+			wcpu = wk->cpu;
+		} while (read_seqcount_retry(&wk->seq, seq));
+
+		if (!last || !period || wcpu != cpu || now_ns < last)
+			continue;
+
+		delta = now_ns - last;
+		if (delta >= 2 * period)
+			continue;
+		if (delta >= period)
+			delta -= period;
+
+		next = min(next, period - delta);
+	}
+
+	return next;
+}
+
 #ifdef CONFIG_SMP
 
 /*
@@ -322,6 +322,14 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev)
 	expected_interval = get_typical_interval(data);
 	expected_interval = min(expected_interval, data->next_timer_us);
 
+	/*
+	 * A periodic interrupt, such as the display vblank, is not a timer
+	 * but wakes the CPU just as reliably.
+	 */
+	expected_interval = min_t(u64, expected_interval,
+			div_u64(cpuidle_wakeup_next(dev->cpu, ktime_get_ns()),
+				NSEC_PER_USEC));
+
 	if (CPUIDLE_DRIVER_STATE_START > 0) {
 		struct cpuidle_state *s = &drv->states[CPUIDLE_DRIVER_STATE_START];
 		unsigned int polling_threshold;
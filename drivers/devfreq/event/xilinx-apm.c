@@ -0,0 +1,205 @@
+/*
+ * Xilinx AXI Performance Monitor devfreq-event driver
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ */
+
+#include <linux/clk.h>
+#include <linux/devfreq-event.h>
+#include <linux/err.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+
+/* Register offsets */
+#define APM_GCC_HIGH		0x0000
+#define APM_GCC_LOW		0x0004
+#define APM_MSR0		0x0044
+#define APM_MC(n)		(0x0100 + (n) * 0x10)
+#define APM_CTL			0x0300
+
+/* APM_CTL */
+#define APM_CTL_MCNTR_EN	BIT(0)
+#define APM_CTL_MCNTR_RESET	BIT(1)
+#define APM_CTL_GCC_EN		BIT(16)
+#define APM_CTL_GCC_RESET	BIT(17)
+
+/* APM_MSR0, one byte per metric counter: slot in [7:5], metric in [4:0] */
+#define APM_MSR_SLOT_SHIFT	5
+#define APM_METRIC_WR_BYTES	2
+#define APM_METRIC_RD_BYTES	3
+
+/* Metric counters used here */
+#define APM_MC_WR		0
+#define APM_MC_RD		1
+
+/*
+ * The monitor counts the bytes written and read on one AXI slot, sampled
+ * against its global clock counter. The busier direction is reported, as
+ * a fraction of the bytes the slot could have moved in that time.
+ */
+struct xilinx_apm {
+	struct devfreq_event_dev *edev;
+	struct devfreq_event_desc desc;
+	void __iomem *regs;
+	struct clk *clk;
+	u32 slot;
+	u32 bytes_per_beat;
+};
+
+static void xilinx_apm_start(struct xilinx_apm *apm)
+{
+	u32 msr;
+
+	msr = ((apm->slot << APM_MSR_SLOT_SHIFT) | APM_METRIC_WR_BYTES) <<
+	      (APM_MC_WR * 8);
+	msr |= ((apm->slot << APM_MSR_SLOT_SHIFT) | APM_METRIC_RD_BYTES) <<
+	       (APM_MC_RD * 8);
+	writel_relaxed(msr, apm->regs + APM_MSR0);
+
+	writel_relaxed(APM_CTL_MCNTR_RESET | APM_CTL_GCC_RESET,
+		       apm->regs + APM_CTL);
+	writel_relaxed(APM_CTL_MCNTR_EN | APM_CTL_GCC_EN, apm->regs + APM_CTL);
+}
+
+static void xilinx_apm_stop(struct xilinx_apm *apm)
+{
+	writel_relaxed(0, apm->regs + APM_CTL);
+}
+
+static int xilinx_apm_disable(struct devfreq_event_dev *edev)
+{
+	struct xilinx_apm *apm = devfreq_event_get_drvdata(edev);
+
+	xilinx_apm_stop(apm);
+	clk_disable_unprepare(apm->clk);
+
+	return 0;
+}
+
+static int xilinx_apm_enable(struct devfreq_event_dev *edev)
+{
+	struct xilinx_apm *apm = devfreq_event_get_drvdata(edev);
+	int ret;
+
+	ret = clk_prepare_enable(apm->clk);
+	if (ret) {
+		dev_err(&edev->dev, "failed to enable apm clk: %d\n", ret);
+		return ret;
+	}
+
+	xilinx_apm_start(apm);
+
+	return 0;
+}
+
+static int xilinx_apm_set_event(struct devfreq_event_dev *edev)
+{
+	return 0;
+}
+
+static int xilinx_apm_get_event(struct devfreq_event_dev *edev,
+				struct devfreq_event_data *edata)
+{
+	struct xilinx_apm *apm = devfreq_event_get_drvdata(edev);
+	u32 wr, rd;
+	u64 cycles;
+
+	xilinx_apm_stop(apm);
+
+	wr = readl_relaxed(apm->regs + APM_MC(APM_MC_WR));
+	rd = readl_relaxed(apm->regs + APM_MC(APM_MC_RD));
+	cycles = (u64)readl_relaxed(apm->regs + APM_GCC_HIGH) << 32 |
+		 readl_relaxed(apm->regs + APM_GCC_LOW);
+
+	xilinx_apm_start(apm);
+
+	/* Both counts in units of beats, to keep them in an unsigned long */
+	edata->load_count = max(wr, rd) / apm->bytes_per_beat;
+	edata->total_count = min_t(u64, cycles, ULONG_MAX);
+
+	return 0;
+}
+
+static const struct devfreq_event_ops xilinx_apm_ops = {
+	.disable = xilinx_apm_disable,
+	.enable = xilinx_apm_enable,
+	.get_event = xilinx_apm_get_event,
+	.set_event = xilinx_apm_set_event,
+};
+
+static const struct of_device_id xilinx_apm_id_match[] = {
+	{ .compatible = "xlnx,axi-perf-monitor" },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, xilinx_apm_id_match);
+
+static int xilinx_apm_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct device_node *np = dev->of_node;
+	struct xilinx_apm *apm;
+	struct resource *res;
+	u32 width = 64;
+
+	apm = devm_kzalloc(dev, sizeof(*apm), GFP_KERNEL);
+	if (!apm)
+		return -ENOMEM;
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	apm->regs = devm_ioremap_resource(dev, res);
+	if (IS_ERR(apm->regs))
+		return PTR_ERR(apm->regs);
+
+	apm->clk = devm_clk_get(dev, NULL);
+	if (IS_ERR(apm->clk)) {
+		dev_err(dev, "Cannot get the apm clk\n");
+		return PTR_ERR(apm->clk);
+	}
+
+	of_property_read_u32(np, "xlnx,slot", &apm->slot);
+	of_property_read_u32(np, "xlnx,slot-data-width", &width);
+	if (apm->slot > 7 || width < 8 || !is_power_of_2(width)) {
+		dev_err(dev, "invalid slot %u or data width %u\n",
+			apm->slot, width);
+		return -EINVAL;
+	}
+	apm->bytes_per_beat = width / 8;
+
+	apm->desc.ops = &xilinx_apm_ops;
+	apm->desc.driver_data = apm;
+	apm->desc.name = np->name;
+
+	apm->edev = devm_devfreq_event_add_edev(dev, &apm->desc);
+	if (IS_ERR(apm->edev)) {
+		dev_err(dev, "failed to add devfreq-event device\n");
+		return PTR_ERR(apm->edev);
+	}
+
+	platform_set_drvdata(pdev, apm);
+
+	return 0;
+}
+
+static struct platform_driver xilinx_apm_driver = {
+	.probe	= xilinx_apm_probe,
+	.driver = {
+		.name	= "xilinx-apm",
+		.of_match_table = xilinx_apm_id_match,
+	},
+};
+module_platform_driver(xilinx_apm_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Xilinx AXI Performance Monitor devfreq-event driver");
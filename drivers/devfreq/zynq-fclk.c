@@ -0,0 +1,288 @@
+/*
+ * Zynq PL fabric clock frequency driver with DEVFREQ Framework
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Scales one of the FCLK clocks the PS feeds into the programmable logic,
+ * following the AXI traffic that AXI Performance Monitors in the PL report
+ * through devfreq-event devices. The busiest monitor decides.
+ */
+
+#include <linux/clk.h>
+#include <linux/devfreq.h>
+#include <linux/devfreq-event.h>
+#include <linux/devfreq_cooling.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/pm_opp.h>
+#include <linux/regulator/consumer.h>
+#include <linux/slab.h>
+
+#define ZYNQ_FCLK_UPTHRESHOLD		70
+#define ZYNQ_FCLK_DOWNDIFFERENTIAL	20
+
+struct zynq_fclk {
+	struct device *dev;
+	struct devfreq *devfreq;
+	struct devfreq_simple_ondemand_data ondemand_data;
+	struct devfreq_event_dev **edev;
+	unsigned int edev_count;
+	struct thermal_cooling_device *cdev;
+	struct clk *clk;
+	struct regulator *vccint;
+	unsigned long rate;
+};
+
+static int zynq_fclk_target(struct device *dev, unsigned long *freq, u32 flags)
+{
+	struct zynq_fclk *fclk = dev_get_drvdata(dev);
+	unsigned long rate, volt;
+	struct dev_pm_opp *opp;
+	int ret;
+
+	opp = devfreq_recommended_opp(dev, freq, flags);
+	if (IS_ERR(opp))
+		return PTR_ERR(opp);
+
+	rate = dev_pm_opp_get_freq(opp);
+	volt = dev_pm_opp_get_voltage(opp);
+	dev_pm_opp_put(opp);
+
+	if (rate == fclk->rate)
+		return 0;
+
+	/* Raise VCCINT before speeding up, lower it after slowing down */
+	if (fclk->vccint && volt && rate > fclk->rate) {
+		ret = regulator_set_voltage(fclk->vccint, volt, volt);
+		if (ret) {
+			dev_err(dev, "failed to set vccint to %lu uV: %d\n",
+				volt, ret);
+			return ret;
+		}
+	}
+
+	ret = clk_set_rate(fclk->clk, rate);
+	if (ret) {
+		dev_err(dev, "failed to set fclk to %lu Hz: %d\n", rate, ret);
+		return ret;
+	}
+
+	if (fclk->vccint && volt && rate < fclk->rate) {
+		ret = regulator_set_voltage(fclk->vccint, volt, volt);
+		if (ret)
+			dev_warn(dev, "failed to set vccint to %lu uV: %d\n",
+				 volt, ret);
+	}
+
+	/* The dividers might not hit the OPP exactly */
+	fclk->rate = clk_get_rate(fclk->clk);
+	*freq = fclk->rate;
+
+	return 0;
+}
+
+static int zynq_fclk_get_dev_status(struct device *dev,
+				    struct devfreq_dev_status *stat)
+{
+	struct zynq_fclk *fclk = dev_get_drvdata(dev);
+	struct devfreq_event_data edata;
+	unsigned int i;
+	int ret;
+
+	stat->current_frequency = fclk->rate;
+	stat->busy_time = 0;
+	stat->total_time = 0;
+
+	for (i = 0; i < fclk->edev_count; i++) {
+		ret = devfreq_event_get_event(fclk->edev[i], &edata);
+		if (ret < 0)
+			return ret;
+
+		/* Compare the loads as fractions, keep the busiest one */
+		if (!edata.total_count)
+			continue;
+		if (!stat->total_time ||
+		    (u64)edata.load_count * stat->total_time >
+		    (u64)stat->busy_time * edata.total_count) {
+			stat->busy_time = edata.load_count;
+			stat->total_time = edata.total_count;
+		}
+	}
+
+	return 0;
+}
+
+static int zynq_fclk_get_cur_freq(struct device *dev, unsigned long *freq)
+{
+	struct zynq_fclk *fclk = dev_get_drvdata(dev);
+
+	*freq = fclk->rate;
+
+	return 0;
+}
+
+static void zynq_fclk_disable_edev(struct zynq_fclk *fclk, unsigned int count)
+{
+	while (count--)
+		devfreq_event_disable_edev(fclk->edev[count]);
+}
+
+static void zynq_fclk_exit(struct device *dev)
+{
+	struct zynq_fclk *fclk = dev_get_drvdata(dev);
+
+	zynq_fclk_disable_edev(fclk, fclk->edev_count);
+	dev_pm_opp_of_remove_table(dev);
+}
+
+static struct devfreq_dev_profile zynq_fclk_profile = {
+	.polling_ms	= 50,
+	.target		= zynq_fclk_target,
+	.get_dev_status	= zynq_fclk_get_dev_status,
+	.get_cur_freq	= zynq_fclk_get_cur_freq,
+	.exit		= zynq_fclk_exit,
+};
+
+static int zynq_fclk_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct device_node *np = dev->of_node;
+	struct zynq_fclk *fclk;
+	unsigned int i;
+	int count, ret;
+
+	fclk = devm_kzalloc(dev, sizeof(*fclk), GFP_KERNEL);
+	if (!fclk)
+		return -ENOMEM;
+	fclk->dev = dev;
+	platform_set_drvdata(pdev, fclk);
+
+	fclk->clk = devm_clk_get(dev, "fclk");
+	if (IS_ERR(fclk->clk)) {
+		ret = PTR_ERR(fclk->clk);
+		if (ret != -EPROBE_DEFER)
+			dev_err(dev, "failed to get fclk: %d\n", ret);
+		return ret;
+	}
+
+	/* The PL supply is optional, without it only the clock is scaled */
+	fclk->vccint = devm_regulator_get_optional(dev, "vccint");
+	if (IS_ERR(fclk->vccint)) {
+		ret = PTR_ERR(fclk->vccint);
+		if (ret == -EPROBE_DEFER)
+			return ret;
+		fclk->vccint = NULL;
+	}
+
+	count = devfreq_event_get_edev_count(dev);
+	if (count <= 0) {
+		dev_err(dev, "no devfreq-event device to measure the load\n");
+		return -EINVAL;
+	}
+	fclk->edev_count = count;
+
+	fclk->edev = devm_kcalloc(dev, count, sizeof(*fclk->edev),
+				  GFP_KERNEL);
+	if (!fclk->edev)
+		return -ENOMEM;
+
+	for (i = 0; i < fclk->edev_count; i++) {
+		fclk->edev[i] = devfreq_event_get_edev_by_phandle(dev, i);
+		if (IS_ERR(fclk->edev[i]))
+			return -EPROBE_DEFER;
+	}
+
+	ret = dev_pm_opp_of_add_table(dev);
+	if (ret) {
+		dev_err(dev, "failed to get the OPP table: %d\n", ret);
+		return ret;
+	}
+
+	for (i = 0; i < fclk->edev_count; i++) {
+		ret = devfreq_event_enable_edev(fclk->edev[i]);
+		if (ret < 0) {
+			dev_err(dev, "failed to enable devfreq-event: %d\n",
+				ret);
+			zynq_fclk_disable_edev(fclk, i);
+			goto err_opp;
+		}
+	}
+
+	ret = clk_prepare_enable(fclk->clk);
+	if (ret)
+		goto err_edev;
+	fclk->rate = clk_get_rate(fclk->clk);
+	zynq_fclk_profile.initial_freq = fclk->rate;
+
+	fclk->ondemand_data.upthreshold = ZYNQ_FCLK_UPTHRESHOLD;
+	fclk->ondemand_data.downdifferential = ZYNQ_FCLK_DOWNDIFFERENTIAL;
+	of_property_read_u32(np, "upthreshold",
+			     &fclk->ondemand_data.upthreshold);
+	of_property_read_u32(np, "downdifferential",
+			     &fclk->ondemand_data.downdifferential);
+
+	fclk->devfreq = devm_devfreq_add_device(dev, &zynq_fclk_profile,
+						"simple_ondemand",
+						&fclk->ondemand_data);
+	if (IS_ERR(fclk->devfreq)) {
+		ret = PTR_ERR(fclk->devfreq);
+		dev_err(dev, "failed to add devfreq device: %d\n", ret);
+		goto err_clk;
+	}
+
+	devm_devfreq_register_opp_notifier(dev, fclk->devfreq);
+
+	/* Let thermal zones cap the fabric clock, like cpufreq-dt does */
+	if (of_find_property(np, "#cooling-cells", NULL)) {
+		fclk->cdev = of_devfreq_cooling_register(np, fclk->devfreq);
+		if (IS_ERR(fclk->cdev)) {
+			dev_warn(dev, "running without cooling device: %ld\n",
+				 PTR_ERR(fclk->cdev));
+			fclk->cdev = NULL;
+		}
+	}
+
+	return 0;
+
+err_clk:
+	clk_disable_unprepare(fclk->clk);
+err_edev:
+	zynq_fclk_disable_edev(fclk, fclk->edev_count);
+err_opp:
+	dev_pm_opp_of_remove_table(dev);
+	return ret;
+}
+
+static int zynq_fclk_remove(struct platform_device *pdev)
+{
+	struct zynq_fclk *fclk = platform_get_drvdata(pdev);
+
+	/* The devfreq device goes away later, its exit() drops the rest */
+	if (fclk->cdev)
+		devfreq_cooling_unregister(fclk->cdev);
+	clk_disable_unprepare(fclk->clk);
+
+	return 0;
+}
+
+static const struct of_device_id zynq_fclk_of_match[] = {
+	{ .compatible = "xlnx,zynq-fclk-devfreq" },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, zynq_fclk_of_match);
+
+static struct platform_driver zynq_fclk_driver = {
+	.probe	= zynq_fclk_probe,
+	.remove	= zynq_fclk_remove,
+	.driver = {
+		.name	= "zynq-fclk-devfreq",
+		.of_match_table = zynq_fclk_of_match,
+	},
+};
+module_platform_driver(zynq_fclk_driver);
+
+MODULE_LICENSE("GPL v2");
+MODULE_DESCRIPTION("Zynq PL fabric clock DEVFREQ driver");
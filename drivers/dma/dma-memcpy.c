@@ -0,0 +1,173 @@
+/*
+ * Offload of large kernel memory copies to a DMA memcpy channel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * One DMA_MEMCPY capable channel, the PL330 on Zynq, is taken at boot and
+ * shared by all callers. Copies of at least dma_memcpy.threshold bytes go
+ * to it and the CPU is free until dma_memcpy_wait(), shorter ones or ones
+ * the channel can't do are done by the CPU right away. The channel is not
+ * faster than the A9 at copying, what is gained is the CPU time.
+ */
+
+#include <linux/cache.h>
+#include <linux/dma-mapping.h>
+#include <linux/dma-memcpy.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+
+static struct dma_chan *dma_memcpy_chan;
+
+static unsigned int threshold = 16384;
+module_param(threshold, uint, 0644);
+MODULE_PARM_DESC(threshold, "smallest copy offloaded to the DMA channel");
+
+static void dma_memcpy_callback(void *arg)
+{
+	struct dma_memcpy *op = arg;
+
+	complete(&op->done);
+}
+
+static void dma_memcpy_cpu_done(struct dma_memcpy *op)
+{
+	op->chan = NULL;
+	complete(&op->done);
+}
+
+/*
+ * The destination is invalidated from the cache when the transfer is
+ * done, it must not share cache lines with anything the CPU writes in
+ * the meantime.
+ */
+static bool dma_memcpy_worth(struct dma_chan *chan, unsigned long dst,
+			     unsigned long src, size_t len)
+{
+	if (!chan || len < READ_ONCE(threshold))
+		return false;
+	if (!IS_ALIGNED(dst | len, cache_line_size()))
+		return false;
+
+	return is_dma_copy_aligned(chan->device, src, dst, len);
+}
+
+static int dma_memcpy_submit(struct dma_memcpy *op, struct dma_chan *chan)
+{
+	struct dma_async_tx_descriptor *tx;
+
+	tx = dmaengine_prep_dma_memcpy(chan, op->dst, op->src, op->len,
+				       DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!tx)
+		return -ENOMEM;
+
+	tx->callback = dma_memcpy_callback;
+	tx->callback_param = op;
+	op->cookie = dmaengine_submit(tx);
+	if (dma_submit_error(op->cookie))
+		return -EIO;
+
+	op->chan = chan;
+	dma_async_issue_pending(chan);
+
+	return 0;
+}
+
+static void dma_memcpy_unmap(struct dma_memcpy *op, struct device *dev)
+{
+	dma_unmap_single(dev, op->src, op->len, DMA_TO_DEVICE);
+	dma_unmap_single(dev, op->dst, op->len, DMA_FROM_DEVICE);
+}
+
+/**
+ * dma_memcpy_start - Start copying between two lowmem buffers
+ * @op:		Copy to start
+ * @dst:	Destination, in the linear mapping
+ * @src:	Source, in the linear mapping
+ * @len:	Length of the copy
+ *
+ * Buffers outside of the linear mapping, such as vmalloc() ones, are
+ * copied by the CPU.
+ */
+void dma_memcpy_start(struct dma_memcpy *op, void *dst, const void *src,
+		      size_t len)
+{
+	struct dma_chan *chan = dma_memcpy_chan;
+	struct device *dev;
+
+	init_completion(&op->done);
+	op->len = len;
+
+	if (!dma_memcpy_worth(chan, (unsigned long)dst, (unsigned long)src,
+			      len) ||
+	    !virt_addr_valid(dst) || !virt_addr_valid(src))
+		goto cpu;
+
+	dev = chan->device->dev;
+	op->src = dma_map_single(dev, (void *)src, len, DMA_TO_DEVICE);
+	if (dma_mapping_error(dev, op->src))
+		goto cpu;
+	op->dst = dma_map_single(dev, dst, len, DMA_FROM_DEVICE);
+	if (dma_mapping_error(dev, op->dst)) {
+		dma_unmap_single(dev, op->src, len, DMA_TO_DEVICE);
+		goto cpu;
+	}
+
+	if (!dma_memcpy_submit(op, chan))
+		return;
+
+	dma_memcpy_unmap(op, dev);
+cpu:
+	memcpy(dst, src, len);
+	dma_memcpy_cpu_done(op);
+}
+EXPORT_SYMBOL_GPL(dma_memcpy_start);
+
+/**
+ * dma_memcpy_wait - Wait for a copy to be done
+ * @op:		Copy started by dma_memcpy_start()
+ *
+ * Context: Process context when the copy was offloaded, it sleeps.
+ *
+ * Return: 0 or -EIO if the DMA transfer failed, the destination is then
+ *	   undefined.
+ */
+int dma_memcpy_wait(struct dma_memcpy *op)
+{
+	enum dma_status status;
+
+	if (!op->chan)
+		return 0;
+
+	wait_for_completion(&op->done);
+	status = dmaengine_tx_status(op->chan, op->cookie, NULL);
+	dma_memcpy_unmap(op, op->chan->device->dev);
+
+	return status == DMA_COMPLETE ? 0 : -EIO;
+}
+EXPORT_SYMBOL_GPL(dma_memcpy_wait);
+
+static int __init dma_memcpy_init(void)
+{
+	dma_cap_mask_t mask;
+	struct dma_chan *chan;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMCPY, mask);
+
+	chan = dma_request_chan_by_mask(&mask);
+	if (IS_ERR(chan)) {
+		pr_info("dma_memcpy: no memcpy channel, copying with the CPU\n");
+		return 0;
+	}
+
+	pr_info("dma_memcpy: offloading copies to %s\n", dma_chan_name(chan));
+	dma_memcpy_chan = chan;
+
+	return 0;
+}
+late_initcall(dma_memcpy_init);
@@ -15,12 +15,16 @@
 #include <linux/dmaengine.h>
 #include <linux/freezer.h>
 #include <linux/init.h>
+#include <linux/kernel_stat.h>
 #include <linux/kthread.h>
 #include <linux/sched/task.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/random.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/tick.h>
+#include <linux/vmalloc.h>
 #include <linux/wait.h>
 
 static unsigned int test_buf_size = 16384;
@@ -85,6 +89,31 @@ static bool verbose;
 module_param(verbose, bool, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(verbose, "Enable \"success\" result messages (default: off)");
 
+static bool benchmark;
+module_param(benchmark, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(benchmark,
+		"Measure throughput and latency instead of verifying (default: off)");
+
+#define DMATEST_MAX_BENCH_SIZES	8
+
+static unsigned int bench_sizes[DMATEST_MAX_BENCH_SIZES];
+static int nr_bench_sizes;
+module_param_array(bench_sizes, uint, &nr_bench_sizes, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(bench_sizes,
+		"Transfer sizes to benchmark (default: test_buf_size)");
+
+static unsigned int queue_depth = 1;
+module_param(queue_depth, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(queue_depth,
+		"Descriptors kept in flight in benchmark mode (default: 1)");
+
+static char test_loopback[20];
+module_param_string(loopback_channel, test_loopback, sizeof(test_loopback),
+		S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(loopback_channel,
+		"Bus ID of the slave channel receiving what \"channel\" sends, "
+		"e.g. AXI DMA S2MM behind a loopback FIFO (default: none)");
+
 /**
  * struct dmatest_params - test parameters.
  * @buf_size:		size of the memcpy test buffer
@@ -96,6 +125,12 @@ MODULE_PARM_DESC(verbose, "Enable \"success\" result messages (default: off)");
  * @xor_sources:	number of xor source buffers
  * @pq_sources:		number of p+q source buffers
  * @timeout:		transfer timeout in msec, -1 for infinite timeout
+ * @noverify:		disable data setup and verification
+ * @benchmark:		measure throughput and latency instead of verifying
+ * @sizes:		transfer sizes to benchmark
+ * @nr_sizes:		number of entries in @sizes
+ * @queue_depth:	descriptors kept in flight while benchmarking
+ * @loopback:		bus ID of the slave channel looped back to @channel
  */
 struct dmatest_params {
 	unsigned int	buf_size;
@@ -108,6 +143,11 @@ struct dmatest_params {
 	unsigned int	pq_sources;
 	int		timeout;
 	bool		noverify;
+	bool		benchmark;
+	unsigned int	sizes[DMATEST_MAX_BENCH_SIZES];
+	unsigned int	nr_sizes;
+	unsigned int	queue_depth;
+	char		loopback[20];
 };
 
 /**
@@ -164,6 +204,7 @@ struct dmatest_thread {
 	struct dmatest_info	*info;
 	struct task_struct	*task;
 	struct dma_chan		*chan;
+	struct dma_chan		*rx_chan;
 	u8			**srcs;
 	u8			**usrcs;
 	u8			**dsts;
@@ -175,6 +216,7 @@ struct dmatest_thread {
 struct dmatest_chan {
 	struct list_head	node;
 	struct dma_chan		*chan;
+	struct dma_chan		*rx_chan;
 	struct list_head	threads;
 };
 
@@ -789,6 +831,262 @@ err_thread_type:
 	return ret;
 }
 
+/*
+ * Benchmark mode keeps queue_depth descriptors in flight on the channel,
+ * or on a loopback pair, and times each one from submission to its
+ * completion callback. Buffers are mapped once up front and never
+ * verified, so only the DMA engine and its driver are measured.
+ */
+struct dmatest_bench {
+	wait_queue_head_t	wait;
+	unsigned int		completed;	/* under wait.lock */
+	u64			*lat_ns;
+};
+
+struct dmatest_bench_slot {
+	struct dmatest_bench	*bench;
+	unsigned int		seq;
+	u64			submit_ns;
+	u8			*src;
+	u8			*dst;
+	dma_addr_t		src_dma;
+	dma_addr_t		dst_dma;
+};
+
+static void dmatest_bench_callback(void *arg)
+{
+	struct dmatest_bench_slot *slot = arg;
+	struct dmatest_bench *bench = slot->bench;
+	unsigned long flags;
+
+	bench->lat_ns[slot->seq] = ktime_get_ns() - slot->submit_ns;
+
+	spin_lock_irqsave(&bench->wait.lock, flags);
+	bench->completed++;
+	wake_up_locked(&bench->wait);
+	spin_unlock_irqrestore(&bench->wait.lock, flags);
+}
+
+static int dmatest_bench_submit(struct dmatest_thread *thread,
+				struct dmatest_bench_slot *slot, size_t len)
+{
+	struct dma_chan *chan = thread->chan;
+	struct dma_async_tx_descriptor *tx;
+	dma_cookie_t cookie;
+
+	if (thread->rx_chan) {
+		struct dma_async_tx_descriptor *rx;
+
+		/* S2MM has to be armed before MM2S starts pushing data */
+		rx = dmaengine_prep_slave_single(thread->rx_chan, slot->dst_dma,
+						 len, DMA_DEV_TO_MEM,
+						 DMA_PREP_INTERRUPT |
+						 DMA_CTRL_ACK);
+		if (!rx)
+			return -ENOMEM;
+
+		rx->callback = dmatest_bench_callback;
+		rx->callback_param = slot;
+		slot->submit_ns = ktime_get_ns();
+		cookie = dmaengine_submit(rx);
+		if (dma_submit_error(cookie))
+			return -EIO;
+
+		tx = dmaengine_prep_slave_single(chan, slot->src_dma, len,
+						 DMA_MEM_TO_DEV, DMA_CTRL_ACK);
+	} else {
+		tx = chan->device->device_prep_dma_memcpy(chan, slot->dst_dma,
+							  slot->src_dma, len,
+							  DMA_PREP_INTERRUPT |
+							  DMA_CTRL_ACK);
+		if (tx) {
+			tx->callback = dmatest_bench_callback;
+			tx->callback_param = slot;
+		}
+		slot->submit_ns = ktime_get_ns();
+	}
+
+	if (!tx)
+		return -ENOMEM;
+
+	cookie = dmaengine_submit(tx);
+	return dma_submit_error(cookie) ? -EIO : 0;
+}
+
+/* idle time of all online CPUs in usecs */
+static u64 dmatest_idle_us(void)
+{
+	u64 idle = 0, t;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		t = get_cpu_idle_time_us(cpu, NULL);
+		if (t == -1ULL)
+			t = div_u64(kcpustat_cpu(cpu).cpustat[CPUTIME_IDLE],
+				    NSEC_PER_USEC);
+		idle += t;
+	}
+
+	return idle;
+}
+
+static int dmatest_cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u64 dmatest_percentile_us(u64 *sorted, unsigned int n,
+				 unsigned int pct)
+{
+	return div_u64(sorted[(u64)(n - 1) * pct / 100], NSEC_PER_USEC);
+}
+
+static int dmatest_bench_size(struct dmatest_thread *thread, unsigned int len)
+{
+	struct dmatest_params *params = &thread->info->params;
+	struct dma_chan *rx_chan = thread->rx_chan ?: thread->chan;
+	struct device *tx_dev = thread->chan->device->dev;
+	struct device *rx_dev = rx_chan->device->dev;
+	unsigned int depth = max(params->queue_depth, 1U);
+	unsigned int count = params->iterations ?: 1000;
+	struct dmatest_bench_slot *slots, *slot;
+	struct dmatest_bench bench;
+	unsigned int submitted = 0, done, mapped, i;
+	u64 start_ns, elapsed_ns, idle_us, wall_us, busy_us;
+	int ret = -ENOMEM;
+
+	if (!len)
+		return -EINVAL;
+
+	init_waitqueue_head(&bench.wait);
+	bench.completed = 0;
+	bench.lat_ns = vmalloc(count * sizeof(*bench.lat_ns));
+	slots = kcalloc(depth, sizeof(*slots), GFP_KERNEL);
+	if (!bench.lat_ns || !slots)
+		goto out_free;
+
+	for (mapped = 0; mapped < depth; mapped++) {
+		slot = &slots[mapped];
+		slot->bench = &bench;
+		slot->src = kmalloc(len, GFP_KERNEL);
+		slot->dst = kmalloc(len, GFP_KERNEL);
+		if (!slot->src || !slot->dst)
+			goto out_unmap;
+
+		slot->src_dma = dma_map_single(tx_dev, slot->src, len,
+					       DMA_TO_DEVICE);
+		if (dma_mapping_error(tx_dev, slot->src_dma))
+			goto out_unmap;
+
+		slot->dst_dma = dma_map_single(rx_dev, slot->dst, len,
+					       DMA_FROM_DEVICE);
+		if (dma_mapping_error(rx_dev, slot->dst_dma)) {
+			dma_unmap_single(tx_dev, slot->src_dma, len,
+					 DMA_TO_DEVICE);
+			goto out_unmap;
+		}
+	}
+
+	idle_us = dmatest_idle_us();
+	start_ns = ktime_get_ns();
+
+	while ((done = READ_ONCE(bench.completed)) < count) {
+		while (submitted < count && submitted - done < depth) {
+			slot = &slots[submitted % depth];
+			slot->seq = submitted;
+			ret = dmatest_bench_submit(thread, slot, len);
+			if (ret)
+				goto out_stop;
+			submitted++;
+		}
+
+		dma_async_issue_pending(rx_chan);
+		if (thread->rx_chan)
+			dma_async_issue_pending(thread->chan);
+
+		if (!wait_event_freezable_timeout(bench.wait,
+				READ_ONCE(bench.completed) != done ||
+				kthread_should_stop(),
+				msecs_to_jiffies(params->timeout))) {
+			ret = -ETIMEDOUT;
+			goto out_stop;
+		}
+		if (kthread_should_stop()) {
+			ret = -EINTR;
+			goto out_stop;
+		}
+	}
+
+	elapsed_ns = ktime_get_ns() - start_ns;
+	wall_us = div_u64(elapsed_ns, NSEC_PER_USEC) * num_online_cpus();
+	idle_us = dmatest_idle_us() - idle_us;
+	busy_us = wall_us > idle_us ? wall_us - idle_us : 0;
+
+	sort(bench.lat_ns, count, sizeof(*bench.lat_ns), dmatest_cmp_u64,
+	     NULL);
+
+	pr_info("%s: %u x %u bytes, depth %u: %llu MB/s, latency p50 %llu p90 %llu p99 %llu max %llu us, cpu %llu%%\n",
+		current->comm, count, len, depth,
+		div64_u64((u64)count * len * 1000, max_t(u64, elapsed_ns, 1)),
+		dmatest_percentile_us(bench.lat_ns, count, 50),
+		dmatest_percentile_us(bench.lat_ns, count, 90),
+		dmatest_percentile_us(bench.lat_ns, count, 99),
+		div_u64(bench.lat_ns[count - 1], NSEC_PER_USEC),
+		div64_u64(busy_us * 100, max_t(u64, wall_us, 1)));
+
+	ret = 0;
+	goto out_unmap;
+
+out_stop:
+	pr_warn("%s: %u byte benchmark stopped after %u of %u descriptors (%d)\n",
+		current->comm, len, READ_ONCE(bench.completed), count, ret);
+	if (thread->rx_chan)
+		dmaengine_terminate_sync(thread->rx_chan);
+	dmaengine_terminate_sync(thread->chan);
+
+out_unmap:
+	/* the last callback may still be dropping the wait queue lock */
+	spin_lock_irq(&bench.wait.lock);
+	spin_unlock_irq(&bench.wait.lock);
+
+	for (i = 0; i < mapped; i++) {
+		dma_unmap_single(tx_dev, slots[i].src_dma, len, DMA_TO_DEVICE);
+		dma_unmap_single(rx_dev, slots[i].dst_dma, len,
+				 DMA_FROM_DEVICE);
+	}
+	for (i = 0; i < depth; i++) {
+		kfree(slots[i].src);
+		kfree(slots[i].dst);
+	}
+out_free:
+	kfree(slots);
+	vfree(bench.lat_ns);
+	return ret;
+}
+
+static int dmatest_bench_func(void *data)
+{
+	struct dmatest_thread *thread = data;
+	struct dmatest_params *params;
+	unsigned int i;
+	int ret = 0;
+
+	set_freezable();
+
+	smp_rmb();
+	params = &thread->info->params;
+
+	for (i = 0; i < params->nr_sizes && !ret && !kthread_should_stop(); i++)
+		ret = dmatest_bench_size(thread, params->sizes[i]);
+
+	thread->done = true;
+	wake_up(&thread_wait);
+
+	return ret;
+}
+
 static void dmatest_cleanup_channel(struct dmatest_chan *dtc)
 {
 	struct dmatest_thread	*thread;
@@ -806,6 +1104,8 @@ static void dmatest_cleanup_channel(struct dmatest_chan *dtc)
 
 	/* terminate all transfers on specified channels */
 	dmaengine_terminate_all(dtc->chan);
+	if (dtc->rx_chan)
+		dmaengine_terminate_all(dtc->rx_chan);
 
 	kfree(dtc);
 }
@@ -827,6 +1127,8 @@ static int dmatest_add_threads(struct dmatest_info *info,
 		op = "xor";
 	else if (type == DMA_PQ)
 		op = "pq";
+	else if (type == DMA_SLAVE)
+		op = "loop";
 	else
 		return -EINVAL;
 
@@ -839,10 +1141,12 @@ static int dmatest_add_threads(struct dmatest_info *info,
 		}
 		thread->info = info;
 		thread->chan = dtc->chan;
+		thread->rx_chan = dtc->rx_chan;
 		thread->type = type;
 		smp_wmb();
-		thread->task = kthread_create(dmatest_func, thread, "%s-%s%u",
-				dma_chan_name(chan), op, i);
+		thread->task = kthread_create(params->benchmark ?
+				dmatest_bench_func : dmatest_func,
+				thread, "%s-%s%u", dma_chan_name(chan), op, i);
 		if (IS_ERR(thread->task)) {
 			pr_warn("Failed to create thread %s-%s%u\n",
 				dma_chan_name(chan), op, i);
@@ -874,8 +1178,18 @@ static int dmatest_add_channel(struct dmatest_info *info,
 	}
 
 	dtc->chan = chan;
+	dtc->rx_chan = NULL;
 	INIT_LIST_HEAD(&dtc->threads);
 
+	if (info->params.benchmark) {
+		/* only memcpy is timed, other operations are left alone */
+		if (dma_has_cap(DMA_MEMCPY, dma_dev->cap_mask)) {
+			cnt = dmatest_add_threads(info, dtc, DMA_MEMCPY);
+			thread_count += cnt > 0 ? cnt : 0;
+		}
+		goto out;
+	}
+
 	if (dma_has_cap(DMA_MEMCPY, dma_dev->cap_mask)) {
 		if (dmatest == 0) {
 			cnt = dmatest_add_threads(info, dtc, DMA_MEMCPY);
@@ -899,6 +1213,7 @@ static int dmatest_add_channel(struct dmatest_info *info,
 		thread_count += cnt > 0 ? cnt : 0;
 	}
 
+out:
 	pr_info("Started %u threads using %s\n",
 		thread_count, dma_chan_name(chan));
 
@@ -919,6 +1234,63 @@ static bool filter(struct dma_chan *chan, void *param)
 		return true;
 }
 
+static bool filter_loopback(struct dma_chan *chan, void *param)
+{
+	struct dmatest_params *params = param;
+
+	return strcmp(dma_chan_name(chan), params->loopback) == 0;
+}
+
+/*
+ * Benchmark a slave channel pair, such as AXI DMA MM2S and S2MM joined by
+ * a loopback FIFO in the PL: @channel transmits, @loopback_channel
+ * receives and completes each descriptor.
+ */
+static void request_loopback_channels(struct dmatest_info *info)
+{
+	struct dmatest_params *params = &info->params;
+	struct dma_chan *tx_chan, *rx_chan;
+	struct dmatest_chan *dtc;
+	dma_cap_mask_t mask;
+	int cnt;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_SLAVE, mask);
+
+	tx_chan = dma_request_channel(mask, filter, params);
+	if (!tx_chan) {
+		pr_warn("No slave channel %s\n", params->channel);
+		return;
+	}
+
+	rx_chan = dma_request_channel(mask, filter_loopback, params);
+	if (!rx_chan) {
+		pr_warn("No slave channel %s\n", params->loopback);
+		goto err_rx;
+	}
+
+	dtc = kmalloc(sizeof(struct dmatest_chan), GFP_KERNEL);
+	if (!dtc)
+		goto err_dtc;
+
+	dtc->chan = tx_chan;
+	dtc->rx_chan = rx_chan;
+	INIT_LIST_HEAD(&dtc->threads);
+
+	cnt = dmatest_add_threads(info, dtc, DMA_SLAVE);
+	pr_info("Started %d threads using %s -> %s\n", cnt > 0 ? cnt : 0,
+		dma_chan_name(tx_chan), dma_chan_name(rx_chan));
+
+	list_add_tail(&dtc->node, &info->channels);
+	info->nr_channels++;
+	return;
+
+err_dtc:
+	dma_release_channel(rx_chan);
+err_rx:
+	dma_release_channel(tx_chan);
+}
+
 static void request_channels(struct dmatest_info *info,
 			     enum dma_transaction_type type)
 {
@@ -959,6 +1331,23 @@ static void run_threaded_test(struct dmatest_info *info)
 	params->pq_sources = pq_sources;
 	params->timeout = timeout;
 	params->noverify = noverify;
+	params->benchmark = benchmark;
+	params->queue_depth = queue_depth;
+	strlcpy(params->loopback, strim(test_loopback),
+		sizeof(params->loopback));
+
+	if (nr_bench_sizes) {
+		memcpy(params->sizes, bench_sizes, sizeof(params->sizes));
+		params->nr_sizes = nr_bench_sizes;
+	} else {
+		params->sizes[0] = test_buf_size;
+		params->nr_sizes = 1;
+	}
+
+	if (params->benchmark && params->loopback[0]) {
+		request_loopback_channels(info);
+		return;
+	}
 
 	request_channels(info, DMA_MEMCPY);
 	request_channels(info, DMA_XOR);
@@ -969,14 +1358,17 @@ static void run_threaded_test(struct dmatest_info *info)
 static void stop_threaded_test(struct dmatest_info *info)
 {
 	struct dmatest_chan *dtc, *_dtc;
-	struct dma_chan *chan;
+	struct dma_chan *chan, *rx_chan;
 
 	list_for_each_entry_safe(dtc, _dtc, &info->channels, node) {
 		list_del(&dtc->node);
 		chan = dtc->chan;
+		rx_chan = dtc->rx_chan;
 		dmatest_cleanup_channel(dtc);
 		pr_debug("dropped channel %s\n", dma_chan_name(chan));
 		dma_release_channel(chan);
+		if (rx_chan)
+			dma_release_channel(rx_chan);
 	}
 
 	info->nr_channels = 0;
@@ -268,6 +268,23 @@ static unsigned cmd_line;
 
 #define NR_DEFAULT_DESC	16
 
+/*
+ * Descriptors set aside for each channel when a client allocates it, so
+ * that preparing a transfer doesn't go through the DMAC pool lock or the
+ * allocator.
+ */
+static unsigned int chan_descs = NR_DEFAULT_DESC;
+module_param(chan_descs, uint, 0444);
+MODULE_PARM_DESC(chan_descs, "descriptors reserved for each allocated channel");
+
+/*
+ * Run the completion callbacks from the (SCHED_FIFO) IRQ thread instead of
+ * the channel tasklets, which share the softirq with everything else.
+ */
+static bool threaded_irq;
+module_param(threaded_irq, bool, 0444);
+MODULE_PARM_DESC(threaded_irq, "run completion callbacks from an IRQ thread");
+
 /* Delay for runtime PM autosuspend, ms */
 #define PL330_AUTOSUSPEND_DELAY 20
 
@@ -423,6 +440,10 @@ struct dma_pl330_chan {
 	struct list_head work_list;
 	/* List of completed descriptors */
 	struct list_head completed_list;
+	/* Free descriptors reserved for this channel */
+	struct list_head desc_pool;
+	/* Completions for the IRQ thread to handle */
+	atomic_t cb_pending;
 
 	/* Pointer to the DMAC that manages this channel,
 	 * NULL if the channel is available to be acquired.
@@ -484,6 +505,8 @@ struct pl330_dmac {
 	struct pl330_thread	*manager;
 	/* To handle bad news in interrupt */
 	struct tasklet_struct	tasks;
+	/* IRQ whose thread runs the callbacks, 0 to use the tasklets */
+	int			thread_irq;
 	struct _pl330_tbd	dmac_tbd;
 	/* State of DMAC operation */
 	enum pl330_dmac_state	state;
@@ -1510,7 +1533,12 @@ static void dma_pl330_rqcb(struct dma_pl330_desc *desc, enum pl330_op_err err)
 
 	spin_unlock_irqrestore(&pch->lock, flags);
 
-	tasklet_schedule(&pch->task);
+	if (pch->dmac->thread_irq) {
+		atomic_set(&pch->cb_pending, 1);
+		irq_wake_thread(pch->dmac->thread_irq, pch->dmac);
+	} else {
+		tasklet_schedule(&pch->task);
+	}
 }
 
 static void pl330_dotask(unsigned long data)
@@ -2056,7 +2084,7 @@ static void pl330_tasklet(unsigned long data)
 			}
 		} else {
 			desc->status = FREE;
-			list_move_tail(&desc->node, &pch->dmac->desc_pool);
+			list_move_tail(&desc->node, &pch->desc_pool);
 		}
 
 		dma_descriptor_unmap(&desc->txd);
@@ -2096,6 +2124,9 @@ static struct dma_chan *of_dma_pl330_xlate(struct of_phandle_args *dma_spec,
 	return dma_get_slave_channel(&pl330->peripherals[chan_id].chan);
 }
 
+static void pl330_fill_chan_pool(struct dma_pl330_chan *pch,
+				 unsigned int count);
+
 static int pl330_alloc_chan_resources(struct dma_chan *chan)
 {
 	struct dma_pl330_chan *pch = to_pchan(chan);
@@ -2117,6 +2148,8 @@ static int pl330_alloc_chan_resources(struct dma_chan *chan)
 
 	spin_unlock_irqrestore(&pl330->lock, flags);
 
+	pl330_fill_chan_pool(pch, chan_descs);
+
 	return 1;
 }
 
@@ -2176,9 +2209,9 @@ static int pl330_terminate_all(struct dma_chan *chan)
 		dma_cookie_complete(&desc->txd);
 	}
 
-	list_splice_tail_init(&pch->submitted_list, &pl330->desc_pool);
-	list_splice_tail_init(&pch->work_list, &pl330->desc_pool);
-	list_splice_tail_init(&pch->completed_list, &pl330->desc_pool);
+	list_splice_tail_init(&pch->submitted_list, &pch->desc_pool);
+	list_splice_tail_init(&pch->work_list, &pch->desc_pool);
+	list_splice_tail_init(&pch->completed_list, &pch->desc_pool);
 	spin_unlock_irqrestore(&pch->lock, flags);
 	pm_runtime_mark_last_busy(pl330->ddma.dev);
 	if (power_down)
@@ -2222,6 +2255,10 @@ static void pl330_free_chan_resources(struct dma_chan *chan)
 	unsigned long flags;
 
 	tasklet_kill(&pch->task);
+	if (pl330->thread_irq) {
+		synchronize_irq(pl330->thread_irq);
+		atomic_set(&pch->cb_pending, 0);
+	}
 
 	pm_runtime_get_sync(pch->dmac->ddma.dev);
 	spin_lock_irqsave(&pl330->lock, flags);
@@ -2229,10 +2266,17 @@ static void pl330_free_chan_resources(struct dma_chan *chan)
 	pl330_release_channel(pch->thread);
 	pch->thread = NULL;
 
+	spin_unlock_irqrestore(&pl330->lock, flags);
+
+	/* Hand the channel's descriptors back to the DMAC */
+	spin_lock_irqsave(&pch->lock, flags);
 	if (pch->cyclic)
-		list_splice_tail_init(&pch->work_list, &pch->dmac->desc_pool);
+		list_splice_tail_init(&pch->work_list, &pch->desc_pool);
+	spin_lock(&pl330->pool_lock);
+	list_splice_tail_init(&pch->desc_pool, &pl330->desc_pool);
+	spin_unlock(&pl330->pool_lock);
+	spin_unlock_irqrestore(&pch->lock, flags);
 
-	spin_unlock_irqrestore(&pl330->lock, flags);
 	pm_runtime_mark_last_busy(pch->dmac->ddma.dev);
 	pm_runtime_put_autosuspend(pch->dmac->ddma.dev);
 }
@@ -2426,16 +2470,16 @@ static int add_desc(struct pl330_dmac *pl330, gfp_t flg, int count)
 	return count;
 }
 
-static struct dma_pl330_desc *pluck_desc(struct pl330_dmac *pl330)
+static struct dma_pl330_desc *pluck_desc(struct list_head *pool,
+				       spinlock_t *lock)
 {
 	struct dma_pl330_desc *desc = NULL;
 	unsigned long flags;
 
-	spin_lock_irqsave(&pl330->pool_lock, flags);
+	spin_lock_irqsave(lock, flags);
 
-	if (!list_empty(&pl330->desc_pool)) {
-		desc = list_entry(pl330->desc_pool.next,
-				struct dma_pl330_desc, node);
+	if (!list_empty(pool)) {
+		desc = list_entry(pool->next, struct dma_pl330_desc, node);
 
 		list_del_init(&desc->node);
 
@@ -2443,19 +2487,49 @@ static struct dma_pl330_desc *pluck_desc(struct pl330_dmac *pl330)
 		desc->txd.callback = NULL;
 	}
 
-	spin_unlock_irqrestore(&pl330->pool_lock, flags);
+	spin_unlock_irqrestore(lock, flags);
 
 	return desc;
 }
 
+/* Move up to count descriptors from the DMAC pool to the channel's own */
+static void pl330_fill_chan_pool(struct dma_pl330_chan *pch,
+				 unsigned int count)
+{
+	struct pl330_dmac *pl330 = pch->dmac;
+	struct dma_pl330_desc *desc;
+	unsigned long flags;
+	LIST_HEAD(pool);
+	unsigned int n = 0;
+
+	while (n < count) {
+		desc = pluck_desc(&pl330->desc_pool, &pl330->pool_lock);
+		if (!desc) {
+			if (!add_desc(pl330, GFP_KERNEL, count - n))
+				break;
+			continue;
+		}
+
+		desc->status = FREE;
+		list_add_tail(&desc->node, &pool);
+		n++;
+	}
+
+	spin_lock_irqsave(&pch->lock, flags);
+	list_splice_tail(&pool, &pch->desc_pool);
+	spin_unlock_irqrestore(&pch->lock, flags);
+}
+
 static struct dma_pl330_desc *pl330_get_desc(struct dma_pl330_chan *pch)
 {
 	struct pl330_dmac *pl330 = pch->dmac;
 	u8 *peri_id = pch->chan.private;
 	struct dma_pl330_desc *desc;
 
-	/* Pluck one desc from the pool of DMAC */
-	desc = pluck_desc(pl330);
+	/* Pluck one desc from the channel's pool, then from the DMAC's */
+	desc = pluck_desc(&pch->desc_pool, &pch->lock);
+	if (!desc)
+		desc = pluck_desc(&pl330->desc_pool, &pl330->pool_lock);
 
 	/* If the DMAC pool is empty, alloc new */
 	if (!desc) {
@@ -2463,7 +2537,7 @@ static struct dma_pl330_desc *pl330_get_desc(struct dma_pl330_chan *pch)
 			return NULL;
 
 		/* Try again */
-		desc = pluck_desc(pl330);
+		desc = pluck_desc(&pl330->desc_pool, &pl330->pool_lock);
 		if (!desc) {
 			dev_err(pch->dmac->ddma.dev,
 				"%s:%d ALERT!\n", __func__, __LINE__);
@@ -2484,6 +2558,31 @@ static struct dma_pl330_desc *pl330_get_desc(struct dma_pl330_chan *pch)
 	return desc;
 }
 
+/* Return a chain of descriptors that never got submitted */
+static void __pl330_giveback_desc(struct dma_pl330_chan *pch,
+				  struct dma_pl330_desc *first)
+{
+	unsigned long flags;
+	struct dma_pl330_desc *desc;
+
+	if (!first)
+		return;
+
+	spin_lock_irqsave(&pch->lock, flags);
+
+	while (!list_empty(&first->node)) {
+		desc = list_entry(first->node.next,
+				struct dma_pl330_desc, node);
+		desc->status = FREE;
+		list_move_tail(&desc->node, &pch->desc_pool);
+	}
+
+	first->status = FREE;
+	list_move_tail(&first->node, &pch->desc_pool);
+
+	spin_unlock_irqrestore(&pch->lock, flags);
+}
+
 static inline void fill_px(struct pl330_xfer *px,
 		dma_addr_t dst, dma_addr_t src, size_t len)
 {
@@ -2550,7 +2649,6 @@ static struct dma_async_tx_descriptor *pl330_prep_dma_cyclic(
 {
 	struct dma_pl330_desc *desc = NULL, *first = NULL;
 	struct dma_pl330_chan *pch = to_pchan(chan);
-	struct pl330_dmac *pl330 = pch->dmac;
 	unsigned int i;
 	dma_addr_t dst;
 	dma_addr_t src;
@@ -2573,17 +2671,7 @@ static struct dma_async_tx_descriptor *pl330_prep_dma_cyclic(
 			if (!first)
 				return NULL;
 
-			spin_lock_irqsave(&pl330->pool_lock, flags);
-
-			while (!list_empty(&first->node)) {
-				desc = list_entry(first->node.next,
-						struct dma_pl330_desc, node);
-				list_move_tail(&desc->node, &pl330->desc_pool);
-			}
-
-			list_move_tail(&first->node, &pl330->desc_pool);
-
-			spin_unlock_irqrestore(&pl330->pool_lock, flags);
+			__pl330_giveback_desc(pch, first);
 
 			return NULL;
 		}
@@ -2680,27 +2768,6 @@ pl330_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dst,
 	return &desc->txd;
 }
 
-static void __pl330_giveback_desc(struct pl330_dmac *pl330,
-				  struct dma_pl330_desc *first)
-{
-	unsigned long flags;
-	struct dma_pl330_desc *desc;
-
-	if (!first)
-		return;
-
-	spin_lock_irqsave(&pl330->pool_lock, flags);
-
-	while (!list_empty(&first->node)) {
-		desc = list_entry(first->node.next,
-				struct dma_pl330_desc, node);
-		list_move_tail(&desc->node, &pl330->desc_pool);
-	}
-
-	list_move_tail(&first->node, &pl330->desc_pool);
-
-	spin_unlock_irqrestore(&pl330->pool_lock, flags);
-}
 
 static struct dma_async_tx_descriptor *
 pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
@@ -2724,12 +2791,10 @@ pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 
 		desc = pl330_get_desc(pch);
 		if (!desc) {
-			struct pl330_dmac *pl330 = pch->dmac;
-
 			dev_err(pch->dmac->ddma.dev,
 				"%s:%d Unable to fetch desc\n",
 				__func__, __LINE__);
-			__pl330_giveback_desc(pl330, first);
+			__pl330_giveback_desc(pch, first);
 
 			return NULL;
 		}
@@ -2770,6 +2835,30 @@ static irqreturn_t pl330_irq_handler(int irq, void *data)
 		return IRQ_NONE;
 }
 
+/* Woken up by dma_pl330_rqcb(), does what the channel tasklets would */
+static irqreturn_t pl330_irq_thread(int irq, void *data)
+{
+	struct pl330_dmac *pl330 = data;
+	unsigned int i;
+
+	if (!pl330->peripherals)
+		return IRQ_HANDLED;
+
+	for (i = 0; i < pl330->num_peripherals; i++) {
+		struct dma_pl330_chan *pch = &pl330->peripherals[i];
+
+		if (!atomic_xchg(&pch->cb_pending, 0))
+			continue;
+
+		/* Clients expect their callbacks to run with BHs off */
+		local_bh_disable();
+		pl330_tasklet((unsigned long)pch);
+		local_bh_enable();
+	}
+
+	return IRQ_HANDLED;
+}
+
 #define PL330_DMA_BUSWIDTHS \
 	BIT(DMA_SLAVE_BUSWIDTH_UNDEFINED) | \
 	BIT(DMA_SLAVE_BUSWIDTH_1_BYTE) | \
@@ -2858,11 +2947,14 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 	for (i = 0; i < AMBA_NR_IRQS; i++) {
 		irq = adev->irq[i];
 		if (irq) {
-			ret = devm_request_irq(&adev->dev, irq,
-					       pl330_irq_handler, 0,
-					       dev_name(&adev->dev), pl330);
+			ret = devm_request_threaded_irq(&adev->dev, irq,
+					pl330_irq_handler,
+					threaded_irq ? pl330_irq_thread : NULL,
+					0, dev_name(&adev->dev), pl330);
 			if (ret)
 				return ret;
+			if (threaded_irq && !pl330->thread_irq)
+				pl330->thread_irq = irq;
 		} else {
 			break;
 		}
@@ -2902,6 +2994,8 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 		INIT_LIST_HEAD(&pch->submitted_list);
 		INIT_LIST_HEAD(&pch->work_list);
 		INIT_LIST_HEAD(&pch->completed_list);
+		INIT_LIST_HEAD(&pch->desc_pool);
+		atomic_set(&pch->cb_pending, 0);
 		spin_lock_init(&pch->lock);
 		pch->thread = NULL;
 		pch->chan.device = pd;
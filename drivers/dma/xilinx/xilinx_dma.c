@@ -19,7 +19,9 @@
  * The AXI Direct Memory Access (AXI DMA) core is a soft Xilinx IP core that
  * provides high-bandwidth one dimensional direct memory access between memory
  * and AXI4-Stream target peripherals. It supports one receive and one
- * transmit channel, both of them optional at synthesis time.
+ * transmit channel, both of them optional at synthesis time. In multichannel
+ * mode it serves up to 16 streams per direction, told apart by their TDEST,
+ * and each receive stream has its own descriptor ring.
  *
  * The AXI CDMA, is a soft IP, which provides high-bandwidth Direct Memory
  * Access (DMA) between a memory-mapped source address and a memory-mapped
@@ -32,17 +34,21 @@
  */
 
 #include <linux/bitops.h>
+#include <linux/debugfs.h>
 #include <linux/dmapool.h>
 #include <linux/dma/xilinx_dma.h>
+#include <linux/genalloc.h>
 #include <linux/init.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/iopoll.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of_address.h>
 #include <linux/of_dma.h>
 #include <linux/of_platform.h>
 #include <linux/of_irq.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/clk.h>
 #include <linux/io-64-nonatomic-lo-hi.h>
@@ -113,7 +119,7 @@
 #define XILINX_VDMA_REG_START_ADDRESS(n)	(0x000c + 4 * (n))
 #define XILINX_VDMA_REG_START_ADDRESS_64(n)	(0x000c + 8 * (n))
 
-/* HW specific definitions */
+/* HW specific definitions, 16 channels per direction in multichannel mode */
 #define XILINX_DMA_MAX_CHANS_PER_DEVICE	0x20
 
 #define XILINX_DMA_DMAXR_ALL_IRQ_MASK	\
@@ -151,6 +157,9 @@
 /* Delay loop counter to prevent hardware failure */
 #define XILINX_DMA_LOOP_COUNT		1000000
 
+/* Default number of segments kept preallocated per channel */
+#define XILINX_DMA_SEG_CACHE_DEFAULT	32
+
 /* AXI DMA Specific Registers/Offsets */
 #define XILINX_DMA_REG_SRCDSTADDR	0x18
 #define XILINX_DMA_REG_BTT		0x28
@@ -160,6 +169,9 @@
 #define XILINX_DMA_CR_COALESCE_MAX	GENMASK(23, 16)
 #define XILINX_DMA_CR_CYCLIC_BD_EN_MASK	BIT(4)
 #define XILINX_DMA_CR_COALESCE_SHIFT	16
+#define XILINX_DMA_CR_DELAY_MAX		GENMASK(31, 24)
+#define XILINX_DMA_CR_DELAY_SHIFT	24
+#define XILINX_DMA_BD_STS_COMPLETE	BIT(31)
 #define XILINX_DMA_BD_SOP		BIT(27)
 #define XILINX_DMA_BD_EOP		BIT(26)
 #define XILINX_DMA_COALESCE_MAX		255
@@ -301,6 +313,38 @@ struct xilinx_dma_tx_descriptor {
 	bool cyclic;
 };
 
+/**
+ * struct xilinx_dma_chan_stats - Per channel statistics
+ * @submitted: Descriptors submitted
+ * @completed: Descriptors completed by the hardware
+ * @bytes: Bytes moved by the completed descriptors
+ * @irqs: Interrupts handled
+ * @tasklet_runs: Tasklet runs following an interrupt
+ * @tasklet_ns: Sum of the interrupt to tasklet latencies
+ * @tasklet_max_ns: Worst interrupt to tasklet latency
+ * @busy_ns: Time spent with descriptors on the hardware
+ * @irq_stamp: Time of the first interrupt the tasklet hasn't serviced yet
+ * @busy_since: Start of the current busy period, 0 while idle
+ * @since: Time the statistics were started
+ *
+ * Counters are updated under the channel lock, or only from the channel
+ * interrupt or tasklet. They cost a few additions per descriptor and are
+ * always on.
+ */
+struct xilinx_dma_chan_stats {
+	u64 submitted;
+	u64 completed;
+	u64 bytes;
+	u64 irqs;
+	u64 tasklet_runs;
+	u64 tasklet_ns;
+	u64 tasklet_max_ns;
+	u64 busy_ns;
+	ktime_t irq_stamp;
+	ktime_t busy_since;
+	ktime_t since;
+};
+
 /**
  * struct xilinx_dma_chan - Driver specific DMA channel structure
  * @xdev: Driver specific device structure
@@ -327,11 +371,19 @@ struct xilinx_dma_tx_descriptor {
  * @desc_pendingcount: Descriptor pending count
  * @ext_addr: Indicates 64 bit addressing is supported by dma channel
  * @desc_submitcount: Descriptor h/w submitted count
- * @residue: Residue for AXI DMA
  * @seg_v: Statically allocated segments base
  * @cyclic_seg_v: Statically allocated segment base for cyclic transfers
  * @start_transfer: Differentiate b/w DMA IP's transfer
  * @stop_transfer: Differentiate b/w DMA IP's quiesce
+ * @tdest: TDEST of the channel for multi-channel DMA
+ * @seg_lock: Segment cache lock
+ * @free_seg_list: Cache of free segments, recycled on completion
+ * @free_seg_count: Number of segments in the cache
+ * @seg_cache_size: Maximum number of segments kept in the cache
+ * @coalesce: AXI DMA interrupt threshold, 0 for one per submitted batch
+ * @delay: AXI DMA interrupt delay timeout, used with @coalesce
+ * @poll_budget: Descriptors cleaned per poll in polling mode, 0 if disabled
+ * @stats: Channel statistics, exported through debugfs
  */
 struct xilinx_dma_chan {
 	struct xilinx_dma_device *xdev;
@@ -358,12 +410,19 @@ struct xilinx_dma_chan {
 	u32 desc_pendingcount;
 	bool ext_addr;
 	u32 desc_submitcount;
-	u32 residue;
 	struct xilinx_axidma_tx_segment *seg_v;
 	struct xilinx_axidma_tx_segment *cyclic_seg_v;
 	void (*start_transfer)(struct xilinx_dma_chan *chan);
 	int (*stop_transfer)(struct xilinx_dma_chan *chan);
 	u16 tdest;
+	spinlock_t seg_lock;
+	struct list_head free_seg_list;
+	u32 free_seg_count;
+	u32 seg_cache_size;
+	u32 coalesce;
+	u32 delay;
+	u32 poll_budget;
+	struct xilinx_dma_chan_stats stats;
 };
 
 struct xilinx_dma_config {
@@ -392,6 +451,8 @@ struct xilinx_dma_config {
  * @rxs_clk: DMA s2mm stream clock
  * @nr_channels: Number of channels DMA device supports
  * @chan_id: DMA channel identifier
+ * @debugfs: Debugfs directory of the device
+ * @ocm_pool: On-chip SRAM pool the descriptors are taken from first, or NULL
  */
 struct xilinx_dma_device {
 	void __iomem *regs;
@@ -411,6 +472,8 @@ struct xilinx_dma_device {
 	struct clk *rxs_clk;
 	u32 nr_channels;
 	u32 chan_id;
+	struct dentry *debugfs;
+	struct gen_pool *ocm_pool;
 };
 
 /* Macros */
@@ -515,18 +578,72 @@ static inline void xilinx_axidma_buf(struct xilinx_dma_chan *chan,
  * Descriptors and segments alloc and free
  */
 
+/*
+ * All segment types are a 64 byte hardware descriptor followed by the list
+ * node and the bus address, so the segment cache handles them through the
+ * AXI DMA layout.
+ */
+static inline void xilinx_dma_check_segment_layout(void)
+{
+	BUILD_BUG_ON(offsetof(struct xilinx_vdma_tx_segment, node) !=
+		     offsetof(struct xilinx_axidma_tx_segment, node));
+	BUILD_BUG_ON(offsetof(struct xilinx_cdma_tx_segment, node) !=
+		     offsetof(struct xilinx_axidma_tx_segment, node));
+	BUILD_BUG_ON(offsetof(struct xilinx_vdma_tx_segment, phys) !=
+		     offsetof(struct xilinx_axidma_tx_segment, phys));
+	BUILD_BUG_ON(offsetof(struct xilinx_cdma_tx_segment, phys) !=
+		     offsetof(struct xilinx_axidma_tx_segment, phys));
+	BUILD_BUG_ON(sizeof(struct xilinx_vdma_tx_segment) !=
+		     sizeof(struct xilinx_axidma_tx_segment));
+	BUILD_BUG_ON(sizeof(struct xilinx_cdma_tx_segment) !=
+		     sizeof(struct xilinx_axidma_tx_segment));
+}
+
 /**
- * xilinx_vdma_alloc_tx_segment - Allocate transaction segment
+ * xilinx_dma_free_segment - Free a segment to the pool it came from
+ * @chan: Driver specific DMA channel
+ * @segment: Segment, not on any list
+ */
+static void xilinx_dma_free_segment(struct xilinx_dma_chan *chan,
+				    struct xilinx_axidma_tx_segment *segment)
+{
+	struct gen_pool *ocm_pool = chan->xdev->ocm_pool;
+
+	if (ocm_pool && addr_in_gen_pool(ocm_pool, (unsigned long)segment,
+					 sizeof(*segment)))
+		gen_pool_free(ocm_pool, (unsigned long)segment,
+			      sizeof(*segment));
+	else
+		dma_pool_free(chan->desc_pool, segment, segment->phys);
+}
+
+/**
+ * xilinx_dma_get_segment - Get a zeroed segment, from the cache if possible
  * @chan: Driver specific DMA channel
  *
- * Return: The allocated segment on success and NULL on failure.
+ * Return: The segment on success and NULL on failure.
  */
-static struct xilinx_vdma_tx_segment *
-xilinx_vdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
+static void *xilinx_dma_get_segment(struct xilinx_dma_chan *chan)
 {
-	struct xilinx_vdma_tx_segment *segment;
+	struct xilinx_axidma_tx_segment *segment;
+	unsigned long flags;
 	dma_addr_t phys;
 
+	spin_lock_irqsave(&chan->seg_lock, flags);
+	segment = list_first_entry_or_null(&chan->free_seg_list,
+					   struct xilinx_axidma_tx_segment,
+					   node);
+	if (segment) {
+		list_del(&segment->node);
+		chan->free_seg_count--;
+	}
+	spin_unlock_irqrestore(&chan->seg_lock, flags);
+
+	if (segment) {
+		memset(&segment->hw, 0, sizeof(segment->hw));
+		return segment;
+	}
+
 	segment = dma_pool_zalloc(chan->desc_pool, GFP_ATOMIC, &phys);
 	if (!segment)
 		return NULL;
@@ -537,24 +654,103 @@ xilinx_vdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
 }
 
 /**
- * xilinx_cdma_alloc_tx_segment - Allocate transaction segment
+ * xilinx_dma_put_segment - Return a segment to the cache or the pool
+ * @chan: Driver specific DMA channel
+ * @seg: Segment, not on any list
+ */
+static void xilinx_dma_put_segment(struct xilinx_dma_chan *chan, void *seg)
+{
+	struct xilinx_axidma_tx_segment *segment = seg;
+	unsigned long flags;
+	bool cached = false;
+
+	spin_lock_irqsave(&chan->seg_lock, flags);
+	if (chan->free_seg_count < chan->seg_cache_size) {
+		/* LIFO, the next prep gets a cache-hot segment */
+		list_add(&segment->node, &chan->free_seg_list);
+		chan->free_seg_count++;
+		cached = true;
+	}
+	spin_unlock_irqrestore(&chan->seg_lock, flags);
+
+	if (!cached)
+		xilinx_dma_free_segment(chan, segment);
+}
+
+/**
+ * xilinx_dma_fill_seg_cache - Preallocate the segment cache
  * @chan: Driver specific DMA channel
  *
- * Return: The allocated segment on success and NULL on failure.
+ * The cached segments come from on-chip SRAM while there is some, the
+ * descriptor fetches then neither wait for DDR nor go through the L2.
  */
-static struct xilinx_cdma_tx_segment *
-xilinx_cdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
+static void xilinx_dma_fill_seg_cache(struct xilinx_dma_chan *chan)
 {
-	struct xilinx_cdma_tx_segment *segment;
+	struct gen_pool *ocm_pool = chan->xdev->ocm_pool;
+	struct xilinx_axidma_tx_segment *segment;
 	dma_addr_t phys;
 
-	segment = dma_pool_zalloc(chan->desc_pool, GFP_ATOMIC, &phys);
-	if (!segment)
-		return NULL;
+	xilinx_dma_check_segment_layout();
 
-	segment->phys = phys;
+	while (chan->free_seg_count < chan->seg_cache_size) {
+		segment = gen_pool_dma_alloc_align(ocm_pool, sizeof(*segment),
+						   &phys,
+						   __alignof__(*segment));
+		if (segment)
+			memset(segment, 0, sizeof(*segment));
+		else
+			segment = dma_pool_zalloc(chan->desc_pool, GFP_KERNEL,
+						  &phys);
+		if (!segment)
+			break;
 
-	return segment;
+		segment->phys = phys;
+		list_add(&segment->node, &chan->free_seg_list);
+		chan->free_seg_count++;
+	}
+}
+
+/**
+ * xilinx_dma_free_seg_cache - Release the cached segments to the pool
+ * @chan: Driver specific DMA channel
+ */
+static void xilinx_dma_free_seg_cache(struct xilinx_dma_chan *chan)
+{
+	struct xilinx_axidma_tx_segment *segment, *next;
+	unsigned long flags;
+	LIST_HEAD(list);
+
+	spin_lock_irqsave(&chan->seg_lock, flags);
+	list_splice_init(&chan->free_seg_list, &list);
+	chan->free_seg_count = 0;
+	spin_unlock_irqrestore(&chan->seg_lock, flags);
+
+	list_for_each_entry_safe(segment, next, &list, node)
+		xilinx_dma_free_segment(chan, segment);
+}
+
+/**
+ * xilinx_vdma_alloc_tx_segment - Allocate transaction segment
+ * @chan: Driver specific DMA channel
+ *
+ * Return: The allocated segment on success and NULL on failure.
+ */
+static struct xilinx_vdma_tx_segment *
+xilinx_vdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
+{
+	return xilinx_dma_get_segment(chan);
+}
+
+/**
+ * xilinx_cdma_alloc_tx_segment - Allocate transaction segment
+ * @chan: Driver specific DMA channel
+ *
+ * Return: The allocated segment on success and NULL on failure.
+ */
+static struct xilinx_cdma_tx_segment *
+xilinx_cdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
+{
+	return xilinx_dma_get_segment(chan);
 }
 
 /**
@@ -566,16 +762,7 @@ xilinx_cdma_alloc_tx_segment(struct xilinx_dma_chan *chan)
 static struct xilinx_axidma_tx_segment *
 xilinx_axidma_alloc_tx_segment(struct xilinx_dma_chan *chan)
 {
-	struct xilinx_axidma_tx_segment *segment;
-	dma_addr_t phys;
-
-	segment = dma_pool_zalloc(chan->desc_pool, GFP_ATOMIC, &phys);
-	if (!segment)
-		return NULL;
-
-	segment->phys = phys;
-
-	return segment;
+	return xilinx_dma_get_segment(chan);
 }
 
 /**
@@ -586,7 +773,7 @@ xilinx_axidma_alloc_tx_segment(struct xilinx_dma_chan *chan)
 static void xilinx_dma_free_tx_segment(struct xilinx_dma_chan *chan,
 				struct xilinx_axidma_tx_segment *segment)
 {
-	dma_pool_free(chan->desc_pool, segment, segment->phys);
+	xilinx_dma_put_segment(chan, segment);
 }
 
 /**
@@ -597,7 +784,7 @@ static void xilinx_dma_free_tx_segment(struct xilinx_dma_chan *chan,
 static void xilinx_cdma_free_tx_segment(struct xilinx_dma_chan *chan,
 				struct xilinx_cdma_tx_segment *segment)
 {
-	dma_pool_free(chan->desc_pool, segment, segment->phys);
+	xilinx_dma_put_segment(chan, segment);
 }
 
 /**
@@ -608,7 +795,7 @@ static void xilinx_cdma_free_tx_segment(struct xilinx_dma_chan *chan,
 static void xilinx_vdma_free_tx_segment(struct xilinx_dma_chan *chan,
 					struct xilinx_vdma_tx_segment *segment)
 {
-	dma_pool_free(chan->desc_pool, segment, segment->phys);
+	xilinx_dma_put_segment(chan, segment);
 }
 
 /**
@@ -687,6 +874,32 @@ static void xilinx_dma_free_desc_list(struct xilinx_dma_chan *chan,
 	}
 }
 
+/**
+ * xilinx_dma_account_busy - Track the channel busy time
+ * @chan: Driver specific DMA channel
+ *
+ * The channel counts as busy while it has descriptors on the hardware, call
+ * with the lock held whenever the active list may have changed.
+ */
+static void xilinx_dma_account_busy(struct xilinx_dma_chan *chan)
+{
+	struct xilinx_dma_chan_stats *stats = &chan->stats;
+	bool busy = !list_empty(&chan->active_list);
+	ktime_t now;
+
+	if (busy == !!stats->busy_since)
+		return;
+
+	now = ktime_get();
+	if (busy) {
+		stats->busy_since = now;
+	} else {
+		stats->busy_ns += ktime_to_ns(ktime_sub(now,
+							stats->busy_since));
+		stats->busy_since = 0;
+	}
+}
+
 /**
  * xilinx_dma_free_descriptors - Free channel descriptors
  * @chan: Driver specific DMA channel
@@ -700,6 +913,7 @@ static void xilinx_dma_free_descriptors(struct xilinx_dma_chan *chan)
 	xilinx_dma_free_desc_list(chan, &chan->pending_list);
 	xilinx_dma_free_desc_list(chan, &chan->done_list);
 	xilinx_dma_free_desc_list(chan, &chan->active_list);
+	xilinx_dma_account_busy(chan);
 
 	spin_unlock_irqrestore(&chan->lock, flags);
 }
@@ -719,6 +933,7 @@ static void xilinx_dma_free_chan_resources(struct dma_chan *dchan)
 		xilinx_dma_free_tx_segment(chan, chan->cyclic_seg_v);
 		xilinx_dma_free_tx_segment(chan, chan->seg_v);
 	}
+	xilinx_dma_free_seg_cache(chan);
 	dma_pool_destroy(chan->desc_pool);
 	chan->desc_pool = NULL;
 }
@@ -748,17 +963,25 @@ static void xilinx_dma_chan_handle_cyclic(struct xilinx_dma_chan *chan,
 /**
  * xilinx_dma_chan_desc_cleanup - Clean channel descriptors
  * @chan: Driver specific DMA channel
+ * @budget: Maximum number of descriptors to clean
+ *
+ * Return: The number of descriptors cleaned
  */
-static void xilinx_dma_chan_desc_cleanup(struct xilinx_dma_chan *chan)
+static int xilinx_dma_chan_desc_cleanup(struct xilinx_dma_chan *chan,
+					int budget)
 {
 	struct xilinx_dma_tx_descriptor *desc, *next;
 	unsigned long flags;
+	int done = 0;
 
 	spin_lock_irqsave(&chan->lock, flags);
 
 	list_for_each_entry_safe(desc, next, &chan->done_list, node) {
 		struct dmaengine_desc_callback cb;
 
+		if (done == budget)
+			break;
+
 		if (desc->cyclic) {
 			xilinx_dma_chan_handle_cyclic(chan, desc, &flags);
 			break;
@@ -778,20 +1001,12 @@ static void xilinx_dma_chan_desc_cleanup(struct xilinx_dma_chan *chan)
 		/* Run any dependencies, then free the descriptor */
 		dma_run_dependencies(&desc->async_tx);
 		xilinx_dma_free_tx_descriptor(chan, desc);
+		done++;
 	}
 
 	spin_unlock_irqrestore(&chan->lock, flags);
-}
 
-/**
- * xilinx_dma_do_tasklet - Schedule completion tasklet
- * @data: Pointer to the Xilinx DMA channel structure
- */
-static void xilinx_dma_do_tasklet(unsigned long data)
-{
-	struct xilinx_dma_chan *chan = (struct xilinx_dma_chan *)data;
-
-	xilinx_dma_chan_desc_cleanup(chan);
+	return done;
 }
 
 /**
@@ -839,6 +1054,8 @@ static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 		return -ENOMEM;
 	}
 
+	xilinx_dma_fill_seg_cache(chan);
+
 	if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
 		/*
 		 * For AXI DMA case after submitting a pending_list, keep
@@ -876,6 +1093,98 @@ static int xilinx_dma_alloc_chan_resources(struct dma_chan *dchan)
 	return 0;
 }
 
+/**
+ * xilinx_dma_desc_len - Number of bytes a descriptor moves
+ * @chan: Driver specific DMA channel
+ * @desc: DMA transaction descriptor
+ *
+ * Return: The descriptor length in bytes
+ */
+static size_t xilinx_dma_desc_len(struct xilinx_dma_chan *chan,
+				  struct xilinx_dma_tx_descriptor *desc)
+{
+	struct xilinx_vdma_tx_segment *vseg;
+	struct xilinx_cdma_tx_segment *cseg;
+	struct xilinx_axidma_tx_segment *aseg;
+	size_t len = 0;
+
+	switch (chan->xdev->dma_config->dmatype) {
+	case XDMA_TYPE_VDMA:
+		list_for_each_entry(vseg, &desc->segments, node)
+			len += vseg->hw.hsize * vseg->hw.vsize;
+		break;
+	case XDMA_TYPE_CDMA:
+		list_for_each_entry(cseg, &desc->segments, node)
+			len += cseg->hw.control & XILINX_DMA_MAX_TRANS_LEN;
+		break;
+	default:
+		list_for_each_entry(aseg, &desc->segments, node)
+			len += aseg->hw.control & XILINX_DMA_MAX_TRANS_LEN;
+		break;
+	}
+
+	return len;
+}
+
+/**
+ * xilinx_dma_get_residue - Bytes an active descriptor has left to move
+ * @chan: Driver specific DMA channel
+ * @desc: DMA transaction descriptor
+ *
+ * Segments count as done once the hardware flags their BD complete, which
+ * for AXI DMA also reports the number of bytes actually moved. A cyclic
+ * AXI DMA ring is never flagged done, its position comes from CURDESC.
+ * VDMA frames and direct register mode transfers complete as a whole.
+ *
+ * Return: The residue in bytes
+ */
+static u32 xilinx_dma_get_residue(struct xilinx_dma_chan *chan,
+				  struct xilinx_dma_tx_descriptor *desc)
+{
+	struct xilinx_axidma_tx_segment *aseg;
+	struct xilinx_cdma_tx_segment *cseg;
+	struct xilinx_axidma_desc_hw *hw;
+	bool pending = false;
+	u32 residue = 0;
+	u32 cur;
+
+	if (!chan->has_sg)
+		return xilinx_dma_desc_len(chan, desc);
+
+	switch (chan->xdev->dma_config->dmatype) {
+	case XDMA_TYPE_CDMA:
+		list_for_each_entry(cseg, &desc->segments, node)
+			if (!(cseg->hw.status & XILINX_DMA_BD_STS_COMPLETE))
+				residue += cseg->hw.control &
+					   XILINX_DMA_MAX_TRANS_LEN;
+		break;
+	case XDMA_TYPE_AXIDMA:
+		if (desc->cyclic && !chan->xdev->mcdma) {
+			cur = dma_ctrl_read(chan, XILINX_DMA_REG_CURDESC);
+			list_for_each_entry(aseg, &desc->segments, node) {
+				if (lower_32_bits(aseg->phys) == cur)
+					pending = true;
+				if (pending)
+					residue += aseg->hw.control &
+						   XILINX_DMA_MAX_TRANS_LEN;
+			}
+			break;
+		}
+
+		list_for_each_entry(aseg, &desc->segments, node) {
+			hw = &aseg->hw;
+			residue += (hw->control - hw->status) &
+				   XILINX_DMA_MAX_TRANS_LEN;
+		}
+		break;
+	default:
+		residue = xilinx_dma_desc_len(chan, desc);
+		break;
+	}
+
+	return residue;
+}
+
 /**
  * xilinx_dma_tx_status - Get DMA transaction status
  * @dchan: DMA channel
@@ -890,8 +1199,6 @@ static enum dma_status xilinx_dma_tx_status(struct dma_chan *dchan,
 {
 	struct xilinx_dma_chan *chan = to_xilinx_chan(dchan);
 	struct xilinx_dma_tx_descriptor *desc;
-	struct xilinx_axidma_tx_segment *segment;
-	struct xilinx_axidma_desc_hw *hw;
 	enum dma_status ret;
 	unsigned long flags;
 	u32 residue = 0;
@@ -900,24 +1207,35 @@ static enum dma_status xilinx_dma_tx_status(struct dma_chan *dchan,
 	if (ret == DMA_COMPLETE || !txstate)
 		return ret;
 
-	if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
-		spin_lock_irqsave(&chan->lock, flags);
-
-		desc = list_last_entry(&chan->active_list,
-				       struct xilinx_dma_tx_descriptor, node);
-		if (chan->has_sg) {
-			list_for_each_entry(segment, &desc->segments, node) {
-				hw = &segment->hw;
-				residue += (hw->control - hw->status) &
-					   XILINX_DMA_MAX_TRANS_LEN;
-			}
+	spin_lock_irqsave(&chan->lock, flags);
+
+	list_for_each_entry(desc, &chan->pending_list, node) {
+		if (desc->async_tx.cookie == cookie) {
+			residue = xilinx_dma_desc_len(chan, desc);
+			goto out;
 		}
-		spin_unlock_irqrestore(&chan->lock, flags);
+	}
 
-		chan->residue = residue;
-		dma_set_residue(txstate, chan->residue);
+	list_for_each_entry(desc, &chan->active_list, node) {
+		if (desc->async_tx.cookie == cookie) {
+			residue = xilinx_dma_get_residue(chan, desc);
+			goto out;
+		}
 	}
 
+	/* A cyclic descriptor stays on the done list once it has wrapped */
+	list_for_each_entry(desc, &chan->done_list, node) {
+		if (desc->async_tx.cookie == cookie && desc->cyclic) {
+			residue = xilinx_dma_get_residue(chan, desc);
+			goto out;
+		}
+	}
+
+out:
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	dma_set_residue(txstate, residue);
+
 	return ret;
 }
 
@@ -1049,9 +1367,14 @@ static void xilinx_vdma_start_transfer(struct xilinx_dma_chan *chan)
 	else
 		reg &= ~XILINX_DMA_DMACR_FRAMECNT_EN;
 
-	/* Configure channel to allow number frame buffers */
+	/*
+	 * Configure channel to allow number frame buffers. In direct
+	 * register mode descriptors go round all the frame stores one by
+	 * one, whatever is pending right now.
+	 */
 	dma_ctrl_write(chan, XILINX_DMA_REG_FRMSTORE,
-			chan->desc_pendingcount);
+			chan->has_sg ? chan->desc_pendingcount :
+				       chan->num_frms);
 
 	/*
 	 * With SG, start with circular mode, so that BDs can be fetched.
@@ -1116,6 +1439,18 @@ static void xilinx_vdma_start_transfer(struct xilinx_dma_chan *chan)
 		vdma_desc_write(chan, XILINX_DMA_REG_FRMDLY_STRIDE,
 				last->hw.stride);
 		vdma_desc_write(chan, XILINX_DMA_REG_VSIZE, last->hw.vsize);
+
+		/* Without a fixed park frame, park on the one just written */
+		if (config->park && config->park_frm < 0) {
+			if (chan->direction == DMA_MEM_TO_DEV)
+				dma_write(chan, XILINX_DMA_REG_PARK_PTR,
+					(i - 1) <<
+					XILINX_DMA_PARK_PTR_RD_REF_SHIFT);
+			else
+				dma_write(chan, XILINX_DMA_REG_PARK_PTR,
+					(i - 1) <<
+					XILINX_DMA_PARK_PTR_WR_REF_SHIFT);
+		}
 	}
 
 	if (!chan->has_sg) {
@@ -1199,6 +1534,7 @@ static void xilinx_dma_start_transfer(struct xilinx_dma_chan *chan)
 {
 	struct xilinx_dma_tx_descriptor *head_desc, *tail_desc;
 	struct xilinx_axidma_tx_segment *tail_segment, *old_head, *new_head;
+	bool extend = false;
 	u32 reg;
 
 	if (chan->err)
@@ -1207,11 +1543,27 @@ static void xilinx_dma_start_transfer(struct xilinx_dma_chan *chan)
 	if (list_empty(&chan->pending_list))
 		return;
 
-	/* If it is SG mode and hardware is busy, cannot submit */
-	if (chan->has_sg && xilinx_dma_is_running(chan) &&
-	    !xilinx_dma_is_idle(chan)) {
-		dev_dbg(chan->dev, "DMA controller still busy\n");
-		return;
+	/*
+	 * In multichannel mode each S2MM channel has a ring of its own, free
+	 * again once its previous batch completed whatever the other channels
+	 * do. The MM2S channels share the engine's ring.
+	 *
+	 * If it is SG mode and hardware is busy, a single channel chain can
+	 * still grow: the running chain ends on the reserve BD, which becomes
+	 * the head of the new batch, and moving TAILDESC past it is enough
+	 * for the hardware to carry on without stopping.
+	 */
+	if (chan->has_sg && chan->xdev->mcdma &&
+	    chan->direction == DMA_DEV_TO_MEM) {
+		if (!list_empty(&chan->active_list))
+			return;
+	} else if (chan->has_sg && xilinx_dma_is_running(chan) &&
+		   !xilinx_dma_is_idle(chan)) {
+		if (chan->xdev->mcdma || chan->cyclic) {
+			dev_dbg(chan->dev, "DMA controller still busy\n");
+			return;
+		}
+		extend = true;
 	}
 
 	head_desc = list_first_entry(&chan->pending_list,
@@ -1238,7 +1590,34 @@ static void xilinx_dma_start_transfer(struct xilinx_dma_chan *chan)
 
 	reg = dma_ctrl_read(chan, XILINX_DMA_REG_DMACR);
 
-	if (chan->desc_pendingcount <= XILINX_DMA_COALESCE_MAX) {
+	if (extend) {
+		/*
+		 * The threshold of the running batch no longer matches the
+		 * chain, complete descriptors one by one unless coalescing,
+		 * where the delay timer flushes the tail.
+		 */
+		if (!chan->coalesce) {
+			reg &= ~XILINX_DMA_CR_COALESCE_MAX;
+			reg |= 1 << XILINX_DMA_CR_COALESCE_SHIFT;
+			dma_ctrl_write(chan, XILINX_DMA_REG_DMACR, reg);
+		}
+
+		xilinx_write(chan, XILINX_DMA_REG_TAILDESC,
+			     tail_segment->phys);
+		goto out;
+	}
+
+	if (chan->coalesce) {
+		reg &= ~(XILINX_DMA_CR_COALESCE_MAX | XILINX_DMA_CR_DELAY_MAX);
+		reg |= chan->coalesce << XILINX_DMA_CR_COALESCE_SHIFT;
+		reg |= chan->delay << XILINX_DMA_CR_DELAY_SHIFT;
+		dma_ctrl_write(chan, XILINX_DMA_REG_DMACR, reg);
+	} else if (chan->xdev->mcdma) {
+		/* The threshold counts the BDs of all channels */
+		reg &= ~XILINX_DMA_CR_COALESCE_MAX;
+		reg |= 1 << XILINX_DMA_CR_COALESCE_SHIFT;
+		dma_ctrl_write(chan, XILINX_DMA_REG_DMACR, reg);
+	} else if (chan->desc_pendingcount <= XILINX_DMA_COALESCE_MAX) {
 		reg &= ~XILINX_DMA_CR_COALESCE_MAX;
 		reg |= chan->desc_pendingcount <<
 				  XILINX_DMA_CR_COALESCE_SHIFT;
@@ -1308,6 +1687,7 @@ static void xilinx_dma_start_transfer(struct xilinx_dma_chan *chan)
 			       hw->control & XILINX_DMA_MAX_TRANS_LEN);
 	}
 
+out:
 	list_splice_tail_init(&chan->pending_list, &chan->active_list);
 	chan->desc_pendingcount = 0;
 }
@@ -1323,6 +1703,7 @@ static void xilinx_dma_issue_pending(struct dma_chan *dchan)
 
 	spin_lock_irqsave(&chan->lock, flags);
 	chan->start_transfer(chan);
+	xilinx_dma_account_busy(chan);
 	spin_unlock_irqrestore(&chan->lock, flags);
 }
 
@@ -1335,17 +1716,37 @@ static void xilinx_dma_issue_pending(struct dma_chan *dchan)
 static void xilinx_dma_complete_descriptor(struct xilinx_dma_chan *chan)
 {
 	struct xilinx_dma_tx_descriptor *desc, *next;
+	struct xilinx_axidma_tx_segment *seg;
 
 	/* This function was invoked with lock held */
 	if (list_empty(&chan->active_list))
 		return;
 
 	list_for_each_entry_safe(desc, next, &chan->active_list, node) {
+		/*
+		 * With coalescing, polling or a chain extended while running,
+		 * the active list can run ahead of the hardware. Stop at the
+		 * first descriptor it hasn't finished.
+		 */
+		if (chan->xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA &&
+		    chan->has_sg && !desc->cyclic) {
+			seg = list_last_entry(&desc->segments,
+					      struct xilinx_axidma_tx_segment,
+					      node);
+			if (!(seg->hw.status & XILINX_DMA_BD_STS_COMPLETE))
+				break;
+		}
+
 		list_del(&desc->node);
 		if (!desc->cyclic)
 			dma_cookie_complete(&desc->async_tx);
 		list_add_tail(&desc->node, &chan->done_list);
+
+		chan->stats.completed++;
+		chan->stats.bytes += xilinx_dma_desc_len(chan, desc);
 	}
+
+	xilinx_dma_account_busy(chan);
 }
 
 /**
@@ -1420,6 +1821,26 @@ static irqreturn_t xilinx_dma_irq_handler(int irq, void *data)
 	dma_ctrl_write(chan, XILINX_DMA_REG_DMASR,
 			status & XILINX_DMA_DMAXR_ALL_IRQ_MASK);
 
+	chan->stats.irqs++;
+	if (!chan->stats.irq_stamp)
+		chan->stats.irq_stamp = ktime_get();
+
+	/*
+	 * In polling mode completions are masked until the tasklet has
+	 * drained the channel, much like NAPI.
+	 */
+	if (chan->poll_budget && !chan->cyclic &&
+	    !(status & XILINX_DMA_DMASR_ERR_IRQ)) {
+		spin_lock(&chan->lock);
+		dma_ctrl_clr(chan, XILINX_DMA_REG_DMACR,
+			     XILINX_DMA_DMACR_FRM_CNT_IRQ |
+			     XILINX_DMA_DMACR_DLY_CNT_IRQ);
+		spin_unlock(&chan->lock);
+
+		tasklet_schedule(&chan->tasklet);
+		return IRQ_HANDLED;
+	}
+
 	if (status & XILINX_DMA_DMASR_ERR_IRQ) {
 		/*
 		 * An error occurred. If C_FLUSH_ON_FSYNC is enabled and the
@@ -1447,15 +1868,18 @@ static irqreturn_t xilinx_dma_irq_handler(int irq, void *data)
 	if (status & XILINX_DMA_DMASR_DLY_CNT_IRQ) {
 		/*
 		 * Device takes too long to do the transfer when user requires
-		 * responsiveness.
+		 * responsiveness. With coalescing this is also how the tail
+		 * of a burst below the threshold gets completed.
 		 */
 		dev_dbg(chan->dev, "Inter-packet latency too long\n");
 	}
 
-	if (status & XILINX_DMA_DMASR_FRM_CNT_IRQ) {
+	if ((status & XILINX_DMA_DMASR_FRM_CNT_IRQ) ||
+	    (chan->coalesce && (status & XILINX_DMA_DMASR_DLY_CNT_IRQ))) {
 		spin_lock(&chan->lock);
 		xilinx_dma_complete_descriptor(chan);
 		chan->start_transfer(chan);
+		xilinx_dma_account_busy(chan);
 		spin_unlock(&chan->lock);
 	}
 
@@ -1463,6 +1887,136 @@ static irqreturn_t xilinx_dma_irq_handler(int irq, void *data)
 	return IRQ_HANDLED;
 }
 
+/**
+ * xilinx_dma_mc_irq_handler - Multichannel DMA interrupt handler
+ * @irq: IRQ number
+ * @data: Pointer to the first Xilinx DMA channel of the direction
+ *
+ * All channels of a direction share the interrupt and the status register,
+ * so the interrupt is acknowledged once and every channel completes what
+ * its BDs say the hardware has finished. Coalescing, when set up, applies
+ * to the direction as a whole. The MM2S channels then get a chance to
+ * refill the shared ring, the S2MM ones their own.
+ *
+ * Return: IRQ_HANDLED/IRQ_NONE
+ */
+static irqreturn_t xilinx_dma_mc_irq_handler(int irq, void *data)
+{
+	struct xilinx_dma_chan *chan = data, *c;
+	struct xilinx_dma_device *xdev = chan->xdev;
+	u32 status, errors = 0;
+	u64 completed;
+	int i;
+
+	status = dma_ctrl_read(chan, XILINX_DMA_REG_DMASR);
+	if (!(status & XILINX_DMA_DMAXR_ALL_IRQ_MASK))
+		return IRQ_NONE;
+
+	dma_ctrl_write(chan, XILINX_DMA_REG_DMASR,
+			status & XILINX_DMA_DMAXR_ALL_IRQ_MASK);
+
+	if (status & XILINX_DMA_DMASR_ERR_IRQ) {
+		/* The engine halts, and takes all its channels down with it */
+		errors = status & XILINX_DMA_DMASR_ALL_ERR_MASK;
+		dev_err(chan->dev, "%s channels have errors %x\n",
+			chan->direction == DMA_MEM_TO_DEV ? "MM2S" : "S2MM",
+			errors);
+	}
+
+	for (i = 0; i < XILINX_DMA_MAX_CHANS_PER_DEVICE; i++) {
+		c = xdev->chan[i];
+		if (!c || c->direction != chan->direction)
+			continue;
+
+		spin_lock(&c->lock);
+		completed = c->stats.completed;
+		if (errors)
+			c->err = true;
+		xilinx_dma_complete_descriptor(c);
+		spin_unlock(&c->lock);
+
+		if (c->stats.completed == completed && !errors)
+			continue;
+
+		c->stats.irqs++;
+		if (!c->stats.irq_stamp)
+			c->stats.irq_stamp = ktime_get();
+		tasklet_schedule(&c->tasklet);
+	}
+
+	for (i = 0; i < XILINX_DMA_MAX_CHANS_PER_DEVICE; i++) {
+		c = xdev->chan[i];
+		if (!c || c->direction != chan->direction)
+			continue;
+
+		spin_lock(&c->lock);
+		c->start_transfer(c);
+		xilinx_dma_account_busy(c);
+		spin_unlock(&c->lock);
+	}
+
+	return IRQ_HANDLED;
+}
+
+/**
+ * xilinx_dma_poll - Reap completed descriptors with interrupts masked
+ * @chan: Driver specific DMA channel
+ *
+ * Completes what the hardware has finished, refills it and cleans up to
+ * poll_budget descriptors. Polls again while there is more work than the
+ * budget, otherwise unmasks the completion interrupts. Completion status
+ * bits latched while masked raise the interrupt again straight away.
+ */
+static void xilinx_dma_poll(struct xilinx_dma_chan *chan)
+{
+	unsigned long flags;
+	int done;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	xilinx_dma_complete_descriptor(chan);
+	chan->start_transfer(chan);
+	xilinx_dma_account_busy(chan);
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	done = xilinx_dma_chan_desc_cleanup(chan, chan->poll_budget);
+	if (done == chan->poll_budget) {
+		tasklet_schedule(&chan->tasklet);
+		return;
+	}
+
+	spin_lock_irqsave(&chan->lock, flags);
+	dma_ctrl_set(chan, XILINX_DMA_REG_DMACR,
+		     XILINX_DMA_DMACR_FRM_CNT_IRQ |
+		     XILINX_DMA_DMACR_DLY_CNT_IRQ);
+	spin_unlock_irqrestore(&chan->lock, flags);
+}
+
+/**
+ * xilinx_dma_do_tasklet - Schedule completion tasklet
+ * @data: Pointer to the Xilinx DMA channel structure
+ */
+static void xilinx_dma_do_tasklet(unsigned long data)
+{
+	struct xilinx_dma_chan *chan = (struct xilinx_dma_chan *)data;
+	struct xilinx_dma_chan_stats *stats = &chan->stats;
+	ktime_t stamp = stats->irq_stamp;
+
+	if (stamp) {
+		u64 lat = ktime_to_ns(ktime_sub(ktime_get(), stamp));
+
+		stats->irq_stamp = 0;
+		stats->tasklet_runs++;
+		stats->tasklet_ns += lat;
+		if (lat > stats->tasklet_max_ns)
+			stats->tasklet_max_ns = lat;
+	}
+
+	if (chan->poll_budget && !chan->cyclic)
+		xilinx_dma_poll(chan);
+	else
+		xilinx_dma_chan_desc_cleanup(chan, INT_MAX);
+}
+
 /**
  * append_desc_queue - Queuing descriptor
  * @chan: Driver specific dma channel
@@ -1542,13 +2096,16 @@ static dma_cookie_t xilinx_dma_tx_submit(struct dma_async_tx_descriptor *tx)
 		 * Channel is no longer functional
 		 */
 		err = xilinx_dma_chan_reset(chan);
-		if (err < 0)
+		if (err < 0) {
+			xilinx_dma_free_tx_descriptor(chan, desc);
 			return err;
+		}
 	}
 
 	spin_lock_irqsave(&chan->lock, flags);
 
 	cookie = dma_cookie_assign(tx);
+	chan->stats.submitted++;
 
 	/* Put this transaction onto the tail of the pending queue */
 	append_desc_queue(chan, desc);
@@ -1763,6 +2320,9 @@ static struct dma_async_tx_descriptor *xilinx_dma_prep_slave_sg(
 					  sg_used, 0);
 
 			hw->control = copy;
+			if (chan->xdev->mcdma)
+				hw->mcdma_control = chan->tdest &
+						    XILINX_DMA_BD_TDEST_MASK;
 
 			if (chan->direction == DMA_MEM_TO_DEV) {
 				if (app_w)
@@ -2091,6 +2651,131 @@ int xilinx_vdma_channel_set_config(struct dma_chan *dchan,
 }
 EXPORT_SYMBOL(xilinx_vdma_channel_set_config);
 
+/**
+ * xilinx_dma_channel_set_coalesce - Configure AXI DMA interrupt coalescing
+ * @dchan: DMA channel
+ * @coalesce: Completed descriptors per interrupt, 0 for one per batch
+ * @delay: Delay timeout raising an interrupt for a partial count, in
+ *	   units of 125 SG clock cycles, required when coalescing
+ *
+ * Takes effect with the next transfer started on the channel.
+ *
+ * Return: '0' on success and failure value on error
+ */
+int xilinx_dma_channel_set_coalesce(struct dma_chan *dchan,
+				    unsigned int coalesce, unsigned int delay)
+{
+	struct xilinx_dma_chan *chan = to_xilinx_chan(dchan);
+	unsigned long flags;
+
+	if (chan->xdev->dma_config->dmatype != XDMA_TYPE_AXIDMA)
+		return -EINVAL;
+
+	if (coalesce > XILINX_DMA_COALESCE_MAX ||
+	    delay > XILINX_DMA_DMACR_DELAY_MAX)
+		return -EINVAL;
+
+	/* Without a delay the tail of a burst would never complete */
+	if (coalesce > 1 && !delay)
+		return -EINVAL;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	chan->coalesce = coalesce;
+	chan->delay = coalesce ? delay : 0;
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	return 0;
+}
+EXPORT_SYMBOL(xilinx_dma_channel_set_coalesce);
+
+/* -----------------------------------------------------------------------------
+ * Debugfs
+ */
+
+static int xilinx_dma_stats_show(struct seq_file *s, void *data)
+{
+	struct xilinx_dma_chan *chan = s->private;
+	struct xilinx_dma_chan_stats stats;
+	struct xilinx_dma_tx_descriptor *desc;
+	unsigned int pending = 0, active = 0, done = 0;
+	unsigned long flags;
+	u64 elapsed, busy;
+	ktime_t now;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	stats = chan->stats;
+	list_for_each_entry(desc, &chan->pending_list, node)
+		pending++;
+	list_for_each_entry(desc, &chan->active_list, node)
+		active++;
+	list_for_each_entry(desc, &chan->done_list, node)
+		done++;
+	now = ktime_get();
+	spin_unlock_irqrestore(&chan->lock, flags);
+
+	busy = stats.busy_ns;
+	if (stats.busy_since)
+		busy += ktime_to_ns(ktime_sub(now, stats.busy_since));
+	elapsed = ktime_to_ns(ktime_sub(now, stats.since));
+
+	seq_printf(s, "submitted:\t%llu\n", stats.submitted);
+	seq_printf(s, "completed:\t%llu\n", stats.completed);
+	seq_printf(s, "bytes:\t\t%llu\n", stats.bytes);
+	seq_printf(s, "irqs:\t\t%llu\n", stats.irqs);
+	seq_printf(s, "tasklet_avg_ns:\t%llu\n", stats.tasklet_runs ?
+		   div64_u64(stats.tasklet_ns, stats.tasklet_runs) : 0);
+	seq_printf(s, "tasklet_max_ns:\t%llu\n", stats.tasklet_max_ns);
+	seq_printf(s, "pending:\t%u\n", pending);
+	seq_printf(s, "active:\t\t%u\n", active);
+	seq_printf(s, "done:\t\t%u\n", done);
+	seq_printf(s, "busy_ns:\t%llu\n", busy);
+	seq_printf(s, "idle_ns:\t%llu\n", elapsed > busy ? elapsed - busy : 0);
+	seq_printf(s, "hw_idle:\t%d\n", xilinx_dma_is_idle(chan));
+
+	return 0;
+}
+
+static int xilinx_dma_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, xilinx_dma_stats_show, inode->i_private);
+}
+
+static const struct file_operations xilinx_dma_stats_fops = {
+	.owner		= THIS_MODULE,
+	.open		= xilinx_dma_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/**
+ * xilinx_dma_debugfs_init - Export the channel statistics
+ * @xdev: Driver specific device structure
+ *
+ * Creates one file per channel in a directory named after the device.
+ * Failing to do so isn't fatal, the device just goes without.
+ */
+static void xilinx_dma_debugfs_init(struct xilinx_dma_device *xdev)
+{
+	char name[16];
+	int i;
+
+	xdev->debugfs = debugfs_create_dir(dev_name(xdev->dev), NULL);
+	if (IS_ERR_OR_NULL(xdev->debugfs)) {
+		xdev->debugfs = NULL;
+		return;
+	}
+
+	for (i = 0; i < xdev->nr_channels; i++) {
+		if (!xdev->chan[i])
+			continue;
+
+		snprintf(name, sizeof(name), "chan%d", i);
+		debugfs_create_file(name, 0444, xdev->debugfs, xdev->chan[i],
+				    &xilinx_dma_stats_fops);
+	}
+}
+
 /* -----------------------------------------------------------------------------
  * Probe and remove
  */
@@ -2335,12 +3020,19 @@ static int xilinx_dma_chan_probe(struct xilinx_dma_device *xdev,
 	INIT_LIST_HEAD(&chan->pending_list);
 	INIT_LIST_HEAD(&chan->done_list);
 	INIT_LIST_HEAD(&chan->active_list);
+	spin_lock_init(&chan->seg_lock);
+	INIT_LIST_HEAD(&chan->free_seg_list);
+	chan->stats.since = ktime_get();
 
 	/* Retrieve the channel properties from the device tree */
 	has_dre = of_property_read_bool(node, "xlnx,include-dre");
 
 	chan->genlock = of_property_read_bool(node, "xlnx,genlock-mode");
 
+	chan->seg_cache_size = XILINX_DMA_SEG_CACHE_DEFAULT;
+	of_property_read_u32(node, "xlnx,desc-cache-size",
+			     &chan->seg_cache_size);
+
 	err = of_property_read_u32(node, "xlnx,datawidth", &value);
 	if (err) {
 		dev_err(xdev->dev, "missing xlnx,datawidth property\n");
@@ -2360,7 +3052,7 @@ static int xilinx_dma_chan_probe(struct xilinx_dma_device *xdev,
 	    of_device_is_compatible(node, "xlnx,axi-cdma-channel")) {
 		chan->direction = DMA_MEM_TO_DEV;
 		chan->id = chan_id;
-		chan->tdest = chan_id;
+		chan->tdest = chan_id - xdev->nr_channels;
 
 		chan->ctrl_offset = XILINX_DMA_MM2S_CTRL_OFFSET;
 		if (xdev->dma_config->dmatype == XDMA_TYPE_VDMA) {
@@ -2391,13 +3083,48 @@ static int xilinx_dma_chan_probe(struct xilinx_dma_device *xdev,
 		return -EINVAL;
 	}
 
-	/* Request the interrupt */
-	chan->irq = irq_of_parse_and_map(node, 0);
-	err = request_irq(chan->irq, xilinx_dma_irq_handler, IRQF_SHARED,
-			  "xilinx-dma-controller", chan);
-	if (err) {
-		dev_err(xdev->dev, "unable to request IRQ %d\n", chan->irq);
-		return err;
+	if (xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
+		u32 coalesce = 0, delay = 0;
+
+		of_property_read_u32(node, "xlnx,irq-coalesce", &coalesce);
+		of_property_read_u32(node, "xlnx,irq-delay", &delay);
+		if (coalesce > XILINX_DMA_COALESCE_MAX ||
+		    delay > XILINX_DMA_DMACR_DELAY_MAX ||
+		    (coalesce > 1 && !delay)) {
+			dev_warn(xdev->dev,
+				 "invalid irq coalescing %u/%u, ignored\n",
+				 coalesce, delay);
+		} else {
+			chan->coalesce = coalesce;
+			chan->delay = coalesce ? delay : 0;
+		}
+	}
+
+	/* Polling needs the per BD completion status of AXI DMA SG mode */
+	of_property_read_u32(node, "xlnx,poll-budget", &chan->poll_budget);
+	if (chan->poll_budget &&
+	    (xdev->dma_config->dmatype != XDMA_TYPE_AXIDMA || !chan->has_sg ||
+	     xdev->mcdma)) {
+		dev_warn(xdev->dev,
+			 "polling needs AXI DMA in single channel SG mode\n");
+		chan->poll_budget = 0;
+	}
+
+	/*
+	 * Request the interrupt. In multichannel mode the first channel of
+	 * the node requests it on behalf of all of them.
+	 */
+	if (!xdev->mcdma || !chan->tdest) {
+		chan->irq = irq_of_parse_and_map(node, 0);
+		err = request_irq(chan->irq, xdev->mcdma ?
+				  xilinx_dma_mc_irq_handler :
+				  xilinx_dma_irq_handler, IRQF_SHARED,
+				  "xilinx-dma-controller", chan);
+		if (err) {
+			dev_err(xdev->dev, "unable to request IRQ %d\n",
+				chan->irq);
+			return err;
+		}
 	}
 
 	if (xdev->dma_config->dmatype == XDMA_TYPE_AXIDMA) {
@@ -2442,7 +3169,7 @@ static int xilinx_dma_chan_probe(struct xilinx_dma_device *xdev,
  * @xdev: Driver specific device structure
  * @node: Device node
  *
- * Return: 0 always.
+ * Return: 0 on success, -EINVAL if the channels don't fit.
  */
 static int xilinx_dma_child_probe(struct xilinx_dma_device *xdev,
 				    struct device_node *node) {
@@ -2452,6 +3179,12 @@ static int xilinx_dma_child_probe(struct xilinx_dma_device *xdev,
 	if ((ret < 0) && xdev->mcdma)
 		dev_warn(xdev->dev, "missing dma-channels property\n");
 
+	if (xdev->chan_id + nr_channels > XILINX_DMA_MAX_CHANS_PER_DEVICE) {
+		dev_err(xdev->dev, "too many channels, %u left\n",
+			XILINX_DMA_MAX_CHANS_PER_DEVICE - xdev->chan_id);
+		return -EINVAL;
+	}
+
 	for (i = 0; i < nr_channels; i++)
 		xilinx_dma_chan_probe(xdev, node, xdev->chan_id++);
 
@@ -2580,6 +3313,11 @@ static int xilinx_dma_probe(struct platform_device *pdev)
 	/* Set the dma mask bits */
 	dma_set_mask(xdev->dev, DMA_BIT_MASK(addr_width));
 
+	/* Optional on-chip SRAM for the descriptors, DDR is used otherwise */
+	xdev->ocm_pool = of_gen_pool_get(node, "sram", 0);
+	if (xdev->ocm_pool)
+		dev_dbg(xdev->dev, "descriptors in on-chip SRAM\n");
+
 	/* Initialize the DMA engine */
 	xdev->common.dev = &pdev->dev;
 
@@ -2603,9 +3341,6 @@ static int xilinx_dma_probe(struct platform_device *pdev)
 					  xilinx_dma_prep_dma_cyclic;
 		xdev->common.device_prep_interleaved_dma =
 					xilinx_dma_prep_interleaved;
-		/* Residue calculation is supported by only AXI DMA */
-		xdev->common.residue_granularity =
-					  DMA_RESIDUE_GRANULARITY_SEGMENT;
 	} else if (xdev->dma_config->dmatype == XDMA_TYPE_CDMA) {
 		dma_cap_set(DMA_MEMCPY, xdev->common.cap_mask);
 		xdev->common.device_prep_dma_memcpy = xilinx_cdma_prep_memcpy;
@@ -2614,6 +3349,9 @@ static int xilinx_dma_probe(struct platform_device *pdev)
 				xilinx_vdma_dma_prep_interleaved;
 	}
 
+	/* Residue is tracked per BD, or per frame for the VDMA */
+	xdev->common.residue_granularity = DMA_RESIDUE_GRANULARITY_SEGMENT;
+
 	platform_set_drvdata(pdev, xdev);
 
 	/* Initialize the channels */
@@ -2640,6 +3378,8 @@ static int xilinx_dma_probe(struct platform_device *pdev)
 		goto error;
 	}
 
+	xilinx_dma_debugfs_init(xdev);
+
 	dev_info(&pdev->dev, "Xilinx AXI VDMA Engine Driver Probed!!\n");
 
 	return 0;
@@ -2665,6 +3405,8 @@ static int xilinx_dma_remove(struct platform_device *pdev)
 	struct xilinx_dma_device *xdev = platform_get_drvdata(pdev);
 	int i;
 
+	debugfs_remove_recursive(xdev->debugfs);
+
 	of_dma_controller_free(pdev->dev.of_node);
 
 	dma_async_device_unregister(&xdev->common);
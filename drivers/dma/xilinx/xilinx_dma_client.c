@@ -0,0 +1,519 @@
+/*
+ * Xilinx AXI DMA userspace client
+ *
+ * 2017 (c) Craig Bishop
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+/*
+ * A misc device per client node in the device tree, feeding the AXI DMA
+ * channels named "tx" (MM2S) and "rx" (S2MM) straight from userspace
+ * memory. A transfer takes either a dma-buf or plain user memory, which
+ * is pinned and mapped for the length of the transfer rather than copied
+ * through a bounce buffer. Each transfer returns a sync_file fence that
+ * signals on completion, so a process can keep several frames in flight
+ * and poll or hand the fences on.
+ */
+
+#include <linux/dma-buf.h>
+#include <linux/dma-fence.h>
+#include <linux/dmaengine.h>
+#include <linux/fcntl.h>
+#include <linux/file.h>
+#include <linux/miscdevice.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/sync_file.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+
+#include <uapi/linux/xilinx_dma_client.h>
+
+#define DRIVER_NAME	"xilinx_dma_client"
+
+struct xdma_client {
+	struct miscdevice misc;
+	struct device *dev;
+	struct dma_chan *chan[2];	/* by XDMA_CLIENT_* direction */
+	struct workqueue_struct *wq;
+
+	u64 fence_context;
+	atomic_t fence_seqno;
+	spinlock_t lock;		/* fences and the in flight list */
+	struct list_head xfers;
+};
+
+/**
+ * struct xdma_transfer - A transfer in flight
+ * @fence: Completion fence, first as the fence core frees the transfer
+ * @client: Client device
+ * @chan: DMA channel the transfer runs on
+ * @dir: DMA mapping direction
+ * @node: Node in the client in flight list
+ * @work: Unmaps the memory once the transfer completed
+ * @sgt: Table of the pinned user pages
+ * @map: Mapped table handed to the DMA channel
+ * @pages: Pinned user pages
+ * @npages: Number of pinned user pages
+ * @dmabuf: dma-buf being transferred, if any
+ * @attach: Attachment of the DMA controller to @dmabuf
+ */
+struct xdma_transfer {
+	struct dma_fence fence;
+	struct xdma_client *client;
+	struct dma_chan *chan;
+	enum dma_data_direction dir;
+	struct list_head node;
+	struct work_struct work;
+	struct sg_table sgt;
+	struct sg_table *map;
+	struct page **pages;
+	unsigned int npages;
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+};
+
+/* ---------------------------------------------------------------------
+ * Fences
+ */
+
+static const char *xdma_client_fence_driver_name(struct dma_fence *fence)
+{
+	return DRIVER_NAME;
+}
+
+static const char *xdma_client_fence_timeline_name(struct dma_fence *fence)
+{
+	struct xdma_transfer *xfer =
+		container_of(fence, struct xdma_transfer, fence);
+
+	return dev_name(xfer->client->dev);
+}
+
+static bool xdma_client_fence_enable_signaling(struct dma_fence *fence)
+{
+	return true;
+}
+
+static const struct dma_fence_ops xdma_client_fence_ops = {
+	.get_driver_name	= xdma_client_fence_driver_name,
+	.get_timeline_name	= xdma_client_fence_timeline_name,
+	.enable_signaling	= xdma_client_fence_enable_signaling,
+	.wait			= dma_fence_default_wait,
+};
+
+/* ---------------------------------------------------------------------
+ * Memory
+ */
+
+static int xdma_client_map_dmabuf(struct xdma_transfer *xfer, int fd)
+{
+	struct device *dev = xfer->chan->device->dev;
+	struct sg_table *sgt;
+	int ret;
+
+	xfer->dmabuf = dma_buf_get(fd);
+	if (IS_ERR(xfer->dmabuf)) {
+		ret = PTR_ERR(xfer->dmabuf);
+		goto err;
+	}
+
+	xfer->attach = dma_buf_attach(xfer->dmabuf, dev);
+	if (IS_ERR(xfer->attach)) {
+		ret = PTR_ERR(xfer->attach);
+		goto err_put;
+	}
+
+	sgt = dma_buf_map_attachment(xfer->attach, xfer->dir);
+	if (IS_ERR(sgt)) {
+		ret = PTR_ERR(sgt);
+		goto err_detach;
+	}
+
+	xfer->map = sgt;
+	return 0;
+
+err_detach:
+	dma_buf_detach(xfer->dmabuf, xfer->attach);
+err_put:
+	dma_buf_put(xfer->dmabuf);
+err:
+	xfer->dmabuf = NULL;
+	return ret;
+}
+
+static void xdma_client_unpin(struct xdma_transfer *xfer,
+			      unsigned int npages)
+{
+	unsigned int i;
+
+	for (i = 0; i < npages; i++) {
+		if (xfer->dir == DMA_FROM_DEVICE)
+			set_page_dirty_lock(xfer->pages[i]);
+		put_page(xfer->pages[i]);
+	}
+
+	kvfree(xfer->pages);
+}
+
+static int xdma_client_map_user(struct xdma_transfer *xfer,
+				unsigned long addr, size_t len)
+{
+	struct device *dev = xfer->chan->device->dev;
+	unsigned long offset = offset_in_page(addr);
+	int pinned;
+	int ret;
+
+	if (!len || addr + len < addr)
+		return -EINVAL;
+
+	xfer->npages = DIV_ROUND_UP(offset + len, PAGE_SIZE);
+	xfer->pages = kvmalloc_array(xfer->npages, sizeof(*xfer->pages),
+				     GFP_KERNEL);
+	if (!xfer->pages)
+		return -ENOMEM;
+
+	pinned = get_user_pages_fast(addr & PAGE_MASK, xfer->npages,
+				     xfer->dir == DMA_FROM_DEVICE,
+				     xfer->pages);
+	if (pinned != xfer->npages) {
+		ret = pinned < 0 ? pinned : -EFAULT;
+		goto err_unpin;
+	}
+
+	ret = sg_alloc_table_from_pages(&xfer->sgt, xfer->pages, xfer->npages,
+					offset, len, GFP_KERNEL);
+	if (ret)
+		goto err_unpin;
+
+	xfer->sgt.nents = dma_map_sg(dev, xfer->sgt.sgl, xfer->sgt.orig_nents,
+				     xfer->dir);
+	if (!xfer->sgt.nents) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	xfer->map = &xfer->sgt;
+	return 0;
+
+err_free:
+	sg_free_table(&xfer->sgt);
+err_unpin:
+	xdma_client_unpin(xfer, max(pinned, 0));
+	xfer->pages = NULL;
+	return ret;
+}
+
+static void xdma_client_unmap(struct xdma_transfer *xfer)
+{
+	if (xfer->dmabuf) {
+		dma_buf_unmap_attachment(xfer->attach, xfer->map, xfer->dir);
+		dma_buf_detach(xfer->dmabuf, xfer->attach);
+		dma_buf_put(xfer->dmabuf);
+	} else {
+		dma_unmap_sg(xfer->chan->device->dev, xfer->sgt.sgl,
+			     xfer->sgt.orig_nents, xfer->dir);
+		sg_free_table(&xfer->sgt);
+		xdma_client_unpin(xfer, xfer->npages);
+	}
+}
+
+/* ---------------------------------------------------------------------
+ * Transfers
+ */
+
+static void xdma_client_xfer_release(struct xdma_transfer *xfer)
+{
+	struct xdma_client *client = xfer->client;
+	unsigned long flags;
+
+	spin_lock_irqsave(&client->lock, flags);
+	list_del(&xfer->node);
+	spin_unlock_irqrestore(&client->lock, flags);
+
+	xdma_client_unmap(xfer);
+	dma_fence_put(&xfer->fence);
+}
+
+static void xdma_client_xfer_work(struct work_struct *work)
+{
+	xdma_client_xfer_release(container_of(work, struct xdma_transfer,
+					      work));
+}
+
+/*
+ * Runs from the DMA tasklet. Whoever signals the fence first, this or
+ * device removal, owns the cleanup.
+ */
+static void xdma_client_xfer_done(void *data)
+{
+	struct xdma_transfer *xfer = data;
+
+	if (!dma_fence_signal(&xfer->fence))
+		queue_work(xfer->client->wq, &xfer->work);
+}
+
+static int xdma_client_ioctl_xfer(struct xdma_client *client,
+				  void __user *argp)
+{
+	struct dma_async_tx_descriptor *desc;
+	struct xdma_transfer *xfer;
+	struct dma_chan *chan;
+	struct xdma_client_xfer args;
+	struct sync_file *sync_file;
+	unsigned long flags;
+	int ret;
+	int fd;
+
+	if (copy_from_user(&args, argp, sizeof(args)))
+		return -EFAULT;
+
+	if (args.dir > XDMA_CLIENT_DEV_TO_MEM || !client->chan[args.dir] ||
+	    args.flags & ~O_CLOEXEC)
+		return -EINVAL;
+
+	chan = client->chan[args.dir];
+
+	xfer = kzalloc(sizeof(*xfer), GFP_KERNEL);
+	if (!xfer)
+		return -ENOMEM;
+
+	xfer->client = client;
+	xfer->chan = chan;
+	xfer->dir = args.dir == XDMA_CLIENT_MEM_TO_DEV ? DMA_TO_DEVICE :
+							 DMA_FROM_DEVICE;
+	INIT_WORK(&xfer->work, xdma_client_xfer_work);
+	INIT_LIST_HEAD(&xfer->node);
+
+	if (args.dmabuf_fd >= 0)
+		ret = xdma_client_map_dmabuf(xfer, args.dmabuf_fd);
+	else
+		ret = xdma_client_map_user(xfer, args.addr, args.len);
+	if (ret) {
+		kfree(xfer);
+		return ret;
+	}
+
+	dma_fence_init(&xfer->fence, &xdma_client_fence_ops, &client->lock,
+		       client->fence_context,
+		       atomic_inc_return(&client->fence_seqno));
+
+	sync_file = sync_file_create(&xfer->fence);
+	if (!sync_file) {
+		ret = -ENOMEM;
+		goto err_release;
+	}
+
+	fd = get_unused_fd_flags(args.flags);
+	if (fd < 0) {
+		ret = fd;
+		goto err_file;
+	}
+
+	/* Nothing can fail between prep and submit, the channel has no undo */
+	desc = dmaengine_prep_slave_sg(chan, xfer->map->sgl,
+				       xfer->map->nents,
+				       args.dir == XDMA_CLIENT_MEM_TO_DEV ?
+				       DMA_MEM_TO_DEV : DMA_DEV_TO_MEM,
+				       DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!desc) {
+		ret = -ENOMEM;
+		goto err_fd;
+	}
+
+	desc->callback = xdma_client_xfer_done;
+	desc->callback_param = xfer;
+
+	spin_lock_irqsave(&client->lock, flags);
+	list_add_tail(&xfer->node, &client->xfers);
+	spin_unlock_irqrestore(&client->lock, flags);
+
+	ret = dma_submit_error(dmaengine_submit(desc));
+	if (ret)
+		goto err_fd;
+
+	/* The transfer may complete and go at any point from here on */
+	dma_async_issue_pending(chan);
+
+	/* Too late to take the transfer back, it cleans up after itself */
+	args.fence_fd = fd;
+	if (copy_to_user(argp, &args, sizeof(args))) {
+		put_unused_fd(fd);
+		fput(sync_file->file);
+		return -EFAULT;
+	}
+
+	fd_install(fd, sync_file->file);
+
+	return 0;
+
+err_fd:
+	put_unused_fd(fd);
+err_file:
+	fput(sync_file->file);
+err_release:
+	xdma_client_xfer_release(xfer);
+	return ret;
+}
+
+static long xdma_client_ioctl(struct file *file, unsigned int cmd,
+			      unsigned long arg)
+{
+	struct xdma_client *client = container_of(file->private_data,
+						  struct xdma_client, misc);
+
+	switch (cmd) {
+	case XDMA_CLIENT_IOCTL_XFER:
+		return xdma_client_ioctl_xfer(client, (void __user *)arg);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations xdma_client_fops = {
+	.owner		= THIS_MODULE,
+	.unlocked_ioctl	= xdma_client_ioctl,
+	.compat_ioctl	= xdma_client_ioctl,
+	.llseek		= noop_llseek,
+};
+
+/* ---------------------------------------------------------------------
+ * Probe and remove
+ */
+
+static int xdma_client_request_chan(struct xdma_client *client,
+				    unsigned int dir, const char *name)
+{
+	struct dma_chan *chan;
+
+	chan = dma_request_chan(client->dev, name);
+	if (IS_ERR(chan)) {
+		if (PTR_ERR(chan) == -ENODEV)
+			return 0;
+		return PTR_ERR(chan);
+	}
+
+	client->chan[dir] = chan;
+	return 0;
+}
+
+static void xdma_client_release_chans(struct xdma_client *client)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(client->chan); i++)
+		if (client->chan[i])
+			dma_release_channel(client->chan[i]);
+}
+
+static int xdma_client_probe(struct platform_device *pdev)
+{
+	struct xdma_client *client;
+	int ret;
+
+	client = devm_kzalloc(&pdev->dev, sizeof(*client), GFP_KERNEL);
+	if (!client)
+		return -ENOMEM;
+
+	client->dev = &pdev->dev;
+	spin_lock_init(&client->lock);
+	INIT_LIST_HEAD(&client->xfers);
+	client->fence_context = dma_fence_context_alloc(1);
+
+	ret = xdma_client_request_chan(client, XDMA_CLIENT_MEM_TO_DEV, "tx");
+	if (!ret)
+		ret = xdma_client_request_chan(client, XDMA_CLIENT_DEV_TO_MEM,
+					       "rx");
+	if (ret)
+		goto err_chans;
+
+	if (!client->chan[XDMA_CLIENT_MEM_TO_DEV] &&
+	    !client->chan[XDMA_CLIENT_DEV_TO_MEM]) {
+		dev_err(&pdev->dev, "No tx or rx DMA channel\n");
+		return -ENODEV;
+	}
+
+	client->wq = alloc_workqueue(DRIVER_NAME, 0, 0);
+	if (!client->wq) {
+		ret = -ENOMEM;
+		goto err_chans;
+	}
+
+	client->misc.minor = MISC_DYNAMIC_MINOR;
+	/* Client nodes often share a name, the unit address tells them apart */
+	client->misc.name = dev_name(&pdev->dev);
+	client->misc.fops = &xdma_client_fops;
+	client->misc.parent = &pdev->dev;
+
+	ret = misc_register(&client->misc);
+	if (ret)
+		goto err_wq;
+
+	platform_set_drvdata(pdev, client);
+
+	return 0;
+
+err_wq:
+	destroy_workqueue(client->wq);
+err_chans:
+	xdma_client_release_chans(client);
+	return ret;
+}
+
+static int xdma_client_remove(struct platform_device *pdev)
+{
+	struct xdma_client *client = platform_get_drvdata(pdev);
+	struct xdma_transfer *xfer, *next;
+	unsigned int i;
+	LIST_HEAD(cancelled);
+
+	misc_deregister(&client->misc);
+
+	for (i = 0; i < ARRAY_SIZE(client->chan); i++)
+		if (client->chan[i])
+			dmaengine_terminate_sync(client->chan[i]);
+
+	/* Signal what the channels dropped, the rest is on the workqueue */
+	spin_lock_irq(&client->lock);
+	list_for_each_entry_safe(xfer, next, &client->xfers, node) {
+		if (!dma_fence_signal_locked(&xfer->fence))
+			list_move_tail(&xfer->node, &cancelled);
+	}
+	spin_unlock_irq(&client->lock);
+
+	list_for_each_entry_safe(xfer, next, &cancelled, node)
+		xdma_client_xfer_release(xfer);
+
+	destroy_workqueue(client->wq);
+	xdma_client_release_chans(client);
+
+	return 0;
+}
+
+static const struct of_device_id xdma_client_of_ids[] = {
+	{ .compatible = "xlnx,axi-dma-client", },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, xdma_client_of_ids);
+
+static struct platform_driver xdma_client_driver = {
+	.driver = {
+		.name = DRIVER_NAME,
+		.of_match_table = xdma_client_of_ids,
+	},
+	.probe = xdma_client_probe,
+	.remove = xdma_client_remove,
+};
+
+module_platform_driver(xdma_client_driver);
+
+MODULE_AUTHOR("Craig Bishop <craig@craigjb.com>");
+MODULE_DESCRIPTION("Xilinx AXI DMA userspace client");
+MODULE_LICENSE("GPL v2");
@@ -18,6 +18,7 @@
  * You should have received a copy of the GNU General Public License along with
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <linux/debugfs.h>
 #include <linux/firmware.h>
 #include <linux/fpga/fpga-mgr.h>
 #include <linux/idr.h>
@@ -27,9 +28,135 @@
 #include <linux/slab.h>
 #include <linux/scatterlist.h>
 #include <linux/highmem.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
+#include <linux/vmalloc.h>
+#include <linux/wait.h>
+#include <linux/zlib.h>
+#include <linux/crc32.h>
+#include <asm/unaligned.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/fpga.h>
+
+EXPORT_TRACEPOINT_SYMBOL_GPL(zynq_fpga_dma_queue);
+EXPORT_TRACEPOINT_SYMBOL_GPL(zynq_fpga_dma_done);
 
 static DEFINE_IDA(fpga_mgr_ida);
 static struct class *fpga_mgr_class;
+static struct dentry *fpga_mgr_debugfs_root;
+
+/* fpga_mgr_load flags */
+#define FPGA_MGR_LOAD_BUSY	0
+
+/*
+ * Partial reconfiguration images are kept resident after their first load,
+ * copied out of the firmware loader and already split into a sg_table, so
+ * swapping a region back costs only the write to the FPGA. 0 disables it.
+ */
+static unsigned int pr_cache_kb = 4096;
+module_param(pr_cache_kb, uint, 0644);
+MODULE_PARM_DESC(pr_cache_kb,
+		 "Size limit of each manager's partial image cache in KiB");
+
+#ifdef CONFIG_HIBERNATION
+/*
+ * The FPGA loses its configuration while the system is hibernated, and the
+ * kernel booting the snapshot may not have programmed it at all. The last
+ * full image is kept so that restoring the manager writes it again, before
+ * the drivers of the logic inside it are restored. Being ordinary kernel
+ * memory the copy is saved in the snapshot itself.
+ */
+static bool restore_image = true;
+module_param(restore_image, bool, 0644);
+MODULE_PARM_DESC(restore_image,
+		 "Keep the last full image to reprogram it after hibernation");
+#endif
+
+#define FPGA_MGR_HISTORY	8
+
+struct fpga_mgr_load_record {
+	char image[32];
+	size_t bytes;
+	u64 us[FPGA_MGR_PHASE_NR];
+	u64 total_us;
+	int ret;
+};
+
+/*
+ * Loads are timed from the outermost public entry point down, the
+ * exclusive manager reference keeps @cur, @depth and @start private to
+ * the loader. @lock protects the history against debugfs readers.
+ */
+struct fpga_mgr_stats {
+	struct mutex lock;
+	struct fpga_mgr_load_record history[FPGA_MGR_HISTORY];
+	unsigned int count;
+	struct fpga_mgr_load_record cur;
+	unsigned int depth;
+	ktime_t start;
+	struct dentry *debugfs;
+};
+
+struct fpga_mgr_pr_image {
+	struct list_head node;
+	char *name;
+	char *buf;
+	size_t size;
+	struct sg_table sgt;
+	bool has_sgt;
+};
+
+static void fpga_mgr_load_begin(struct fpga_manager *mgr,
+				const char *image_name)
+{
+	struct fpga_mgr_stats *stats = mgr->stats;
+
+	if (stats->depth++)
+		return;
+
+	memset(&stats->cur, 0, sizeof(stats->cur));
+	strlcpy(stats->cur.image, image_name, sizeof(stats->cur.image));
+	stats->start = ktime_get();
+	trace_fpga_mgr_load_begin(mgr, image_name);
+}
+
+static int fpga_mgr_load_end(struct fpga_manager *mgr, int ret)
+{
+	struct fpga_mgr_stats *stats = mgr->stats;
+
+	if (--stats->depth)
+		return ret;
+
+	stats->cur.total_us = ktime_us_delta(ktime_get(), stats->start);
+	stats->cur.ret = ret;
+	trace_fpga_mgr_load_end(mgr, stats->cur.bytes, stats->cur.total_us,
+				ret);
+
+	mutex_lock(&stats->lock);
+	stats->history[stats->count++ % FPGA_MGR_HISTORY] = stats->cur;
+	mutex_unlock(&stats->lock);
+
+	return ret;
+}
+
+static ktime_t fpga_mgr_phase_begin(struct fpga_manager *mgr,
+				    enum fpga_mgr_phase phase)
+{
+	trace_fpga_mgr_phase_begin(mgr, phase, 0);
+
+	return ktime_get();
+}
+
+static void fpga_mgr_phase_end(struct fpga_manager *mgr,
+			       enum fpga_mgr_phase phase, ktime_t start,
+			       size_t bytes, int ret)
+{
+	mgr->stats->cur.us[phase] += ktime_us_delta(ktime_get(), start);
+	mgr->stats->cur.bytes += bytes;
+	trace_fpga_mgr_phase_end(mgr, phase, ret);
+}
 
 /*
  * Call the low level driver's write_init function.  This will do the
@@ -41,14 +168,17 @@ static int fpga_mgr_write_init_buf(struct fpga_manager *mgr,
 				   struct fpga_image_info *info,
 				   const char *buf, size_t count)
 {
+	ktime_t start;
 	int ret;
 
 	mgr->state = FPGA_MGR_STATE_WRITE_INIT;
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_WRITE_INIT);
 	if (!mgr->mops->initial_header_size)
 		ret = mgr->mops->write_init(mgr, info, NULL, 0);
 	else
 		ret = mgr->mops->write_init(
 		    mgr, info, buf, min(mgr->mops->initial_header_size, count));
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_WRITE_INIT, start, 0, ret);
 
 	if (ret) {
 		dev_err(&mgr->dev, "Error preparing FPGA for writing\n");
@@ -106,10 +236,13 @@ static int fpga_mgr_write_init_sg(struct fpga_manager *mgr,
 static int fpga_mgr_write_complete(struct fpga_manager *mgr,
 				   struct fpga_image_info *info)
 {
+	ktime_t start;
 	int ret;
 
 	mgr->state = FPGA_MGR_STATE_WRITE_COMPLETE;
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_WRITE_COMPLETE);
 	ret = mgr->mops->write_complete(mgr, info);
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_WRITE_COMPLETE, start, 0, ret);
 	if (ret) {
 		dev_err(&mgr->dev, "Error after writing image data to FPGA\n");
 		mgr->state = FPGA_MGR_STATE_WRITE_COMPLETE_ERR;
@@ -137,17 +270,26 @@ static int fpga_mgr_write_complete(struct fpga_manager *mgr,
  *
  * Return: 0 on success, negative error code otherwise.
  */
-int fpga_mgr_buf_load_sg(struct fpga_manager *mgr, struct fpga_image_info *info,
-			 struct sg_table *sgt)
+static int __fpga_mgr_buf_load_sg(struct fpga_manager *mgr,
+				  struct fpga_image_info *info,
+				  struct sg_table *sgt)
 {
+	struct scatterlist *sg;
+	size_t bytes = 0;
+	ktime_t start;
 	int ret;
+	int i;
 
 	ret = fpga_mgr_write_init_sg(mgr, info, sgt);
 	if (ret)
 		return ret;
 
+	for_each_sg(sgt->sgl, sg, sgt->nents, i)
+		bytes += sg->length;
+
 	/* Write the FPGA image to the FPGA. */
 	mgr->state = FPGA_MGR_STATE_WRITE;
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_WRITE);
 	if (mgr->mops->write_sg) {
 		ret = mgr->mops->write_sg(mgr, sgt);
 	} else {
@@ -161,6 +303,7 @@ int fpga_mgr_buf_load_sg(struct fpga_manager *mgr, struct fpga_image_info *info,
 		}
 		sg_miter_stop(&miter);
 	}
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_WRITE, start, bytes, ret);
 
 	if (ret) {
 		dev_err(&mgr->dev, "Error while writing image data to FPGA\n");
@@ -170,12 +313,21 @@ int fpga_mgr_buf_load_sg(struct fpga_manager *mgr, struct fpga_image_info *info,
 
 	return fpga_mgr_write_complete(mgr, info);
 }
+
+int fpga_mgr_buf_load_sg(struct fpga_manager *mgr, struct fpga_image_info *info,
+			 struct sg_table *sgt)
+{
+	fpga_mgr_load_begin(mgr, "sg");
+
+	return fpga_mgr_load_end(mgr, __fpga_mgr_buf_load_sg(mgr, info, sgt));
+}
 EXPORT_SYMBOL_GPL(fpga_mgr_buf_load_sg);
 
 static int fpga_mgr_buf_load_mapped(struct fpga_manager *mgr,
 				    struct fpga_image_info *info,
 				    const char *buf, size_t count)
 {
+	ktime_t start;
 	int ret;
 
 	ret = fpga_mgr_write_init_buf(mgr, info, buf, count);
@@ -186,7 +338,9 @@ static int fpga_mgr_buf_load_mapped(struct fpga_manager *mgr,
 	 * Write the FPGA image to the FPGA.
 	 */
 	mgr->state = FPGA_MGR_STATE_WRITE;
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_WRITE);
 	ret = mgr->mops->write(mgr, buf, count);
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_WRITE, start, count, ret);
 	if (ret) {
 		dev_err(&mgr->dev, "Error while writing image data to FPGA\n");
 		mgr->state = FPGA_MGR_STATE_WRITE_ERR;
@@ -196,42 +350,24 @@ static int fpga_mgr_buf_load_mapped(struct fpga_manager *mgr,
 	return fpga_mgr_write_complete(mgr, info);
 }
 
-/**
- * fpga_mgr_buf_load - load fpga from image in buffer
- * @mgr:	fpga manager
- * @flags:	flags setting fpga confuration modes
- * @buf:	buffer contain fpga image
- * @count:	byte count of buf
- *
- * Step the low level fpga manager through the device-specific steps of getting
- * an FPGA ready to be configured, writing the image to it, then doing whatever
- * post-configuration steps necessary.  This code assumes the caller got the
- * mgr pointer from of_fpga_mgr_get() and checked that it is not an error code.
+/*
+ * Convert a linear kernel pointer, vmalloc or lowmem, into a sg_table of
+ * its pages for use by the driver.
  *
- * Return: 0 on success, negative error code otherwise.
+ * Buffers the core allocates itself come from kvmalloc(), so they are
+ * physically contiguous whenever memory allows and end up as one large
+ * segment. DMA engines with a short command queue, like the Zynq PCAP,
+ * then take an interrupt per megabyte rather than per page.
  */
-int fpga_mgr_buf_load(struct fpga_manager *mgr, struct fpga_image_info *info,
-		      const char *buf, size_t count)
+static int fpga_mgr_buf_to_sgt(const char *buf, size_t count,
+			       struct sg_table *sgt)
 {
 	struct page **pages;
-	struct sg_table sgt;
 	const void *p;
 	int nr_pages;
 	int index;
 	int rc;
 
-	/*
-	 * This is just a fast path if the caller has already created a
-	 * contiguous kernel buffer and the driver doesn't require SG, non-SG
-	 * drivers will still work on the slow path.
-	 */
-	if (mgr->mops->write)
-		return fpga_mgr_buf_load_mapped(mgr, info, buf, count);
-
-	/*
-	 * Convert the linear kernel pointer into a sg_table of pages for use
-	 * by the driver.
-	 */
 	nr_pages = DIV_ROUND_UP((unsigned long)buf + count, PAGE_SIZE) -
 		   (unsigned long)buf / PAGE_SIZE;
 	pages = kmalloc_array(nr_pages, sizeof(struct page *), GFP_KERNEL);
@@ -255,19 +391,490 @@ int fpga_mgr_buf_load(struct fpga_manager *mgr, struct fpga_image_info *info,
 	 * The temporary pages list is used to code share the merging algorithm
 	 * in sg_alloc_table_from_pages
 	 */
-	rc = sg_alloc_table_from_pages(&sgt, pages, index, offset_in_page(buf),
+	rc = sg_alloc_table_from_pages(sgt, pages, index, offset_in_page(buf),
 				       count, GFP_KERNEL);
 	kfree(pages);
+
+	return rc;
+}
+
+#if IS_ENABLED(CONFIG_FPGA_MGR_COMPRESSED)
+/*
+ * gzip compressed images are inflated a chunk at a time and each chunk is
+ * written as soon as it is ready, so neither the compressed file nor the
+ * full image needs to be in memory twice. Drivers see successive write or
+ * write_sg calls, the first chunk also goes to write_init for the header.
+ */
+#define FPGA_MGR_GZIP_CHUNK_SIZE	SZ_1M
+
+#define GZIP_FEXTRA	BIT(2)
+#define GZIP_FNAME	BIT(3)
+#define GZIP_FCOMMENT	BIT(4)
+#define GZIP_FHCRC	BIT(1)
+
+static bool fpga_mgr_is_gzip(const char *buf, size_t count)
+{
+	return count >= 18 && buf[0] == '\x1f' && buf[1] == '\x8b' &&
+	       buf[2] == 8;
+}
+
+/* Return: offset of the deflate stream, negative error code otherwise */
+static int fpga_mgr_gzip_skip_header(const u8 *buf, size_t count)
+{
+	u8 flags = buf[3];
+	size_t pos = 10;
+
+	if (flags & GZIP_FEXTRA) {
+		if (pos + 2 > count)
+			return -EINVAL;
+		pos += 2 + (buf[pos] | buf[pos + 1] << 8);
+	}
+
+	if (flags & GZIP_FNAME) {
+		while (pos < count && buf[pos])
+			pos++;
+		pos++;
+	}
+
+	if (flags & GZIP_FCOMMENT) {
+		while (pos < count && buf[pos])
+			pos++;
+		pos++;
+	}
+
+	if (flags & GZIP_FHCRC)
+		pos += 2;
+
+	/* The stream is followed by the CRC32 and size trailer */
+	if (pos + 8 > count)
+		return -EINVAL;
+
+	return pos;
+}
+
+static int fpga_mgr_write_chunk(struct fpga_manager *mgr, const char *buf,
+				size_t count)
+{
+	struct sg_table sgt;
+	ktime_t start;
+	int ret;
+
+	if (mgr->mops->write) {
+		start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_WRITE);
+		ret = mgr->mops->write(mgr, buf, count);
+		fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_WRITE, start, count,
+				   ret);
+		return ret;
+	}
+
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_SETUP);
+	ret = fpga_mgr_buf_to_sgt(buf, count, &sgt);
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_SETUP, start, 0, ret);
+	if (ret)
+		return ret;
+
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_WRITE);
+	ret = mgr->mops->write_sg(mgr, &sgt);
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_WRITE, start, count, ret);
+	sg_free_table(&sgt);
+
+	return ret;
+}
+
+static int fpga_mgr_buf_load_gzip(struct fpga_manager *mgr,
+				  struct fpga_image_info *info,
+				  const char *buf, size_t count)
+{
+	struct z_stream_s strm = { };
+	const u8 *trailer = (const u8 *)buf + count - 8;
+	u32 crc = ~0;
+	bool first = true;
+	ktime_t start;
+	char *chunk;
+	size_t len;
+	int zret;
+	int ret;
+
+	ret = fpga_mgr_gzip_skip_header(buf, count);
+	if (ret < 0) {
+		dev_err(&mgr->dev, "Invalid gzip header\n");
+		return ret;
+	}
+
+	strm.next_in = buf + ret;
+	strm.avail_in = count - ret - 8;
+
+	strm.workspace = vmalloc(zlib_inflate_workspacesize());
+	chunk = kvmalloc(FPGA_MGR_GZIP_CHUNK_SIZE, GFP_KERNEL);
+	if (!strm.workspace || !chunk) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	if (zlib_inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+		ret = -EINVAL;
+		goto out_free;
+	}
+
+	do {
+		strm.next_out = chunk;
+		strm.avail_out = FPGA_MGR_GZIP_CHUNK_SIZE;
+
+		start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_SETUP);
+		zret = zlib_inflate(&strm, Z_SYNC_FLUSH);
+		fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_SETUP, start, 0, 0);
+		len = FPGA_MGR_GZIP_CHUNK_SIZE - strm.avail_out;
+		if ((zret != Z_OK && zret != Z_STREAM_END) ||
+		    (zret == Z_OK && !strm.avail_in && strm.avail_out)) {
+			dev_err(&mgr->dev, "Corrupt compressed image\n");
+			mgr->state = first ? FPGA_MGR_STATE_WRITE_INIT_ERR :
+					     FPGA_MGR_STATE_WRITE_ERR;
+			ret = -EINVAL;
+			goto out_end;
+		}
+
+		if (first) {
+			ret = fpga_mgr_write_init_buf(mgr, info, chunk, len);
+			if (ret)
+				goto out_end;
+			mgr->state = FPGA_MGR_STATE_WRITE;
+			first = false;
+		}
+
+		crc = crc32_le(crc, (u8 *)chunk, len);
+		ret = fpga_mgr_write_chunk(mgr, chunk, len);
+		if (ret) {
+			dev_err(&mgr->dev,
+				"Error while writing image data to FPGA\n");
+			mgr->state = FPGA_MGR_STATE_WRITE_ERR;
+			goto out_end;
+		}
+	} while (zret != Z_STREAM_END);
+
+	/* Don't complete the load of an image that came out wrong */
+	if (~crc != get_unaligned_le32(trailer) ||
+	    (u32)strm.total_out != get_unaligned_le32(trailer + 4)) {
+		dev_err(&mgr->dev, "Compressed image fails its CRC check\n");
+		mgr->state = FPGA_MGR_STATE_WRITE_ERR;
+		ret = -EBADMSG;
+		goto out_end;
+	}
+
+	ret = 0;
+
+out_end:
+	zlib_inflateEnd(&strm);
+out_free:
+	kvfree(chunk);
+	vfree(strm.workspace);
+
+	if (ret)
+		return ret;
+
+	return fpga_mgr_write_complete(mgr, info);
+}
+#else
+static bool fpga_mgr_is_gzip(const char *buf, size_t count)
+{
+	return false;
+}
+
+static int fpga_mgr_buf_load_gzip(struct fpga_manager *mgr,
+				  struct fpga_image_info *info,
+				  const char *buf, size_t count)
+{
+	return -EINVAL;
+}
+#endif
+
+/**
+ * fpga_mgr_buf_load - load fpga from image in buffer
+ * @mgr:	fpga manager
+ * @flags:	flags setting fpga confuration modes
+ * @buf:	buffer contain fpga image
+ * @count:	byte count of buf
+ *
+ * Step the low level fpga manager through the device-specific steps of getting
+ * an FPGA ready to be configured, writing the image to it, then doing whatever
+ * post-configuration steps necessary.  This code assumes the caller got the
+ * mgr pointer from of_fpga_mgr_get() and checked that it is not an error code.
+ * With CONFIG_FPGA_MGR_COMPRESSED the image may also be gzip compressed.
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+static int __fpga_mgr_buf_load(struct fpga_manager *mgr,
+			       struct fpga_image_info *info,
+			       const char *buf, size_t count)
+{
+	struct sg_table sgt;
+	ktime_t start;
+	int rc;
+
+	if (fpga_mgr_is_gzip(buf, count))
+		return fpga_mgr_buf_load_gzip(mgr, info, buf, count);
+
+	/*
+	 * This is just a fast path if the caller has already created a
+	 * contiguous kernel buffer and the driver doesn't require SG, non-SG
+	 * drivers will still work on the slow path.
+	 */
+	if (mgr->mops->write)
+		return fpga_mgr_buf_load_mapped(mgr, info, buf, count);
+
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_SETUP);
+	rc = fpga_mgr_buf_to_sgt(buf, count, &sgt);
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_SETUP, start, 0, rc);
 	if (rc)
 		return rc;
 
-	rc = fpga_mgr_buf_load_sg(mgr, info, &sgt);
+	rc = __fpga_mgr_buf_load_sg(mgr, info, &sgt);
 	sg_free_table(&sgt);
 
 	return rc;
 }
+
+#ifdef CONFIG_HIBERNATION
+static void fpga_mgr_restore_image_free(struct fpga_manager *mgr)
+{
+	kvfree(mgr->restore_buf);
+	mgr->restore_buf = NULL;
+	mgr->restore_len = 0;
+}
+
+/*
+ * Called after each load. A full image replaces the kept one, a failed full
+ * load drops it, as the FPGA no longer holds it. Partial images are left to
+ * their owners.
+ */
+static void fpga_mgr_restore_image_set(struct fpga_manager *mgr,
+				       struct fpga_image_info *info,
+				       const char *buf, size_t count, int ret)
+{
+	if (info->flags & (FPGA_MGR_PARTIAL_RECONFIG |
+			   FPGA_MGR_EXTERNAL_CONFIG))
+		return;
+
+	fpga_mgr_restore_image_free(mgr);
+	if (ret || !READ_ONCE(restore_image))
+		return;
+
+	mgr->restore_buf = kvmalloc(count, GFP_KERNEL);
+	if (!mgr->restore_buf) {
+		dev_warn(&mgr->dev, "no memory to keep the image for resume\n");
+		return;
+	}
+
+	memcpy(mgr->restore_buf, buf, count);
+	mgr->restore_len = count;
+	mgr->restore_info = *info;
+}
+
+static int fpga_mgr_restore(struct device *dev)
+{
+	struct fpga_manager *mgr = to_fpga_manager(dev);
+	int ret;
+
+	if (!mgr->restore_buf)
+		return 0;
+
+	dev_info(dev, "rewriting the image to %s\n", mgr->name);
+
+	fpga_mgr_load_begin(mgr, "restore");
+	ret = fpga_mgr_load_end(mgr,
+				__fpga_mgr_buf_load(mgr, &mgr->restore_info,
+						    mgr->restore_buf,
+						    mgr->restore_len));
+	if (ret)
+		dev_err(dev, "failed to rewrite the image: %d\n", ret);
+
+	return ret;
+}
+
+/* Background loads must not be cut short by the snapshot */
+static int fpga_mgr_prepare(struct device *dev)
+{
+	struct fpga_manager *mgr = to_fpga_manager(dev);
+
+	wait_on_bit(&mgr->load.flags, FPGA_MGR_LOAD_BUSY,
+		    TASK_UNINTERRUPTIBLE);
+
+	return 0;
+}
+
+static const struct dev_pm_ops fpga_mgr_pm_ops = {
+	.prepare	= fpga_mgr_prepare,
+	.restore	= fpga_mgr_restore,
+};
+#else
+static void fpga_mgr_restore_image_free(struct fpga_manager *mgr)
+{
+}
+
+static void fpga_mgr_restore_image_set(struct fpga_manager *mgr,
+				       struct fpga_image_info *info,
+				       const char *buf, size_t count, int ret)
+{
+}
+#endif
+
+int fpga_mgr_buf_load(struct fpga_manager *mgr, struct fpga_image_info *info,
+		      const char *buf, size_t count)
+{
+	int ret;
+
+	fpga_mgr_load_begin(mgr, "buffer");
+
+	ret = __fpga_mgr_buf_load(mgr, info, buf, count);
+	fpga_mgr_restore_image_set(mgr, info, buf, count, ret);
+
+	return fpga_mgr_load_end(mgr, ret);
+}
 EXPORT_SYMBOL_GPL(fpga_mgr_buf_load);
 
+static void fpga_mgr_pr_image_free(struct fpga_manager *mgr,
+				   struct fpga_mgr_pr_image *image)
+{
+	list_del(&image->node);
+	mgr->pr_cache_bytes -= image->size;
+	if (image->has_sgt)
+		sg_free_table(&image->sgt);
+	kvfree(image->buf);
+	kfree(image->name);
+	kfree(image);
+}
+
+static void fpga_mgr_pr_cache_flush(struct fpga_manager *mgr)
+{
+	struct fpga_mgr_pr_image *image, *next;
+
+	mutex_lock(&mgr->pr_cache_lock);
+	list_for_each_entry_safe(image, next, &mgr->pr_cache, node)
+		fpga_mgr_pr_image_free(mgr, image);
+	mutex_unlock(&mgr->pr_cache_lock);
+}
+
+/*
+ * Called with pr_cache_lock held. Images too large for the cache are
+ * returned in @fwp instead.
+ */
+static struct fpga_mgr_pr_image *
+fpga_mgr_pr_cache_get(struct fpga_manager *mgr, const char *image_name,
+		      size_t limit, const struct firmware **fwp)
+{
+	struct device *dev = &mgr->dev;
+	struct fpga_mgr_pr_image *image, *victim, *next;
+	const struct firmware *fw;
+	ktime_t start;
+	int ret;
+
+	list_for_each_entry(image, &mgr->pr_cache, node) {
+		if (!strcmp(image->name, image_name)) {
+			list_move(&image->node, &mgr->pr_cache);
+			return image;
+		}
+	}
+
+	mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ;
+
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_FIRMWARE);
+	ret = request_firmware(&fw, image_name, dev);
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_FIRMWARE, start, 0, ret);
+	if (ret) {
+		mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ_ERR;
+		dev_err(dev, "Error requesting firmware %s\n", image_name);
+		return ERR_PTR(ret);
+	}
+
+	if (fw->size > limit) {
+		*fwp = fw;
+		return NULL;
+	}
+
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_SETUP);
+
+	ret = -ENOMEM;
+	image = kzalloc(sizeof(*image), GFP_KERNEL);
+	if (!image)
+		goto err_release;
+
+	image->name = kstrdup(image_name, GFP_KERNEL);
+	image->buf = kvmalloc(fw->size, GFP_KERNEL);
+	if (!image->name || !image->buf)
+		goto err_free;
+
+	memcpy(image->buf, fw->data, fw->size);
+	image->size = fw->size;
+
+	if (!mgr->mops->write && !fpga_mgr_is_gzip(image->buf, image->size)) {
+		ret = fpga_mgr_buf_to_sgt(image->buf, image->size,
+					  &image->sgt);
+		if (ret)
+			goto err_free;
+		image->has_sgt = true;
+	}
+
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_SETUP, start, 0, 0);
+	release_firmware(fw);
+
+	/* Evict least recently used images to make room */
+	list_for_each_entry_safe_reverse(victim, next, &mgr->pr_cache, node) {
+		if (mgr->pr_cache_bytes + image->size <= limit)
+			break;
+		fpga_mgr_pr_image_free(mgr, victim);
+	}
+
+	list_add(&image->node, &mgr->pr_cache);
+	mgr->pr_cache_bytes += image->size;
+
+	return image;
+
+err_free:
+	kvfree(image->buf);
+	kfree(image->name);
+	kfree(image);
+err_release:
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_SETUP, start, 0, ret);
+	release_firmware(fw);
+	mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ_ERR;
+
+	return ERR_PTR(ret);
+}
+
+/*
+ * Return: 0 on success, negative error code otherwise, or 1 if the cache
+ * is disabled.
+ */
+static int fpga_mgr_pr_cache_load(struct fpga_manager *mgr,
+				  struct fpga_image_info *info,
+				  const char *image_name)
+{
+	size_t limit = (size_t)READ_ONCE(pr_cache_kb) * SZ_1K;
+	const struct firmware *fw = NULL;
+	struct fpga_mgr_pr_image *image;
+	int ret;
+
+	if (!limit)
+		return 1;
+
+	mutex_lock(&mgr->pr_cache_lock);
+
+	image = fpga_mgr_pr_cache_get(mgr, image_name, limit, &fw);
+	if (IS_ERR(image)) {
+		ret = PTR_ERR(image);
+	} else if (!image) {
+		ret = __fpga_mgr_buf_load(mgr, info, fw->data, fw->size);
+		release_firmware(fw);
+	} else if (image->has_sgt) {
+		ret = __fpga_mgr_buf_load_sg(mgr, info, &image->sgt);
+	} else {
+		ret = __fpga_mgr_buf_load(mgr, info, image->buf, image->size);
+	}
+
+	mutex_unlock(&mgr->pr_cache_lock);
+
+	return ret;
+}
+
 /**
  * fpga_mgr_firmware_load - request firmware and load to fpga
  * @mgr:	fpga manager
@@ -280,6 +887,8 @@ EXPORT_SYMBOL_GPL(fpga_mgr_buf_load);
  * from of_fpga_mgr_get() or fpga_mgr_get() and checked that it is not an error
  * code.
  *
+ * Partial reconfiguration images are cached, see pr_cache_kb.
+ *
  * Return: 0 on success, negative error code otherwise.
  */
 int fpga_mgr_firmware_load(struct fpga_manager *mgr,
@@ -288,27 +897,208 @@ int fpga_mgr_firmware_load(struct fpga_manager *mgr,
 {
 	struct device *dev = &mgr->dev;
 	const struct firmware *fw;
+	ktime_t start;
 	int ret;
 
 	dev_info(dev, "writing %s to %s\n", image_name, mgr->name);
 
+	fpga_mgr_load_begin(mgr, image_name);
+
+	if (info->flags & FPGA_MGR_PARTIAL_RECONFIG) {
+		ret = fpga_mgr_pr_cache_load(mgr, info, image_name);
+		if (ret <= 0)
+			return fpga_mgr_load_end(mgr, ret);
+	}
+
 	mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ;
 
+	start = fpga_mgr_phase_begin(mgr, FPGA_MGR_PHASE_FIRMWARE);
 	ret = request_firmware(&fw, image_name, dev);
+	fpga_mgr_phase_end(mgr, FPGA_MGR_PHASE_FIRMWARE, start, 0, ret);
 	if (ret) {
 		mgr->state = FPGA_MGR_STATE_FIRMWARE_REQ_ERR;
 		dev_err(dev, "Error requesting firmware %s\n", image_name);
-		return ret;
+		return fpga_mgr_load_end(mgr, ret);
 	}
 
-	ret = fpga_mgr_buf_load(mgr, info, fw->data, fw->size);
+	ret = __fpga_mgr_buf_load(mgr, info, fw->data, fw->size);
+	fpga_mgr_restore_image_set(mgr, info, fw->data, fw->size, ret);
 
 	release_firmware(fw);
 
-	return ret;
+	return fpga_mgr_load_end(mgr, ret);
 }
 EXPORT_SYMBOL_GPL(fpga_mgr_firmware_load);
 
+/* Debugfs */
+
+static int fpga_mgr_stats_show(struct seq_file *s, void *data)
+{
+	struct fpga_mgr_stats *stats = s->private;
+	struct fpga_mgr_load_record *rec;
+	unsigned int i, n;
+
+	seq_puts(s, "image                            bytes      MB/s  firmware     setup write_init     write  complete     total  ret\n");
+
+	mutex_lock(&stats->lock);
+	n = min_t(unsigned int, stats->count, FPGA_MGR_HISTORY);
+	for (i = 0; i < n; i++) {
+		rec = &stats->history[(stats->count - n + i) % FPGA_MGR_HISTORY];
+		/* bytes per microsecond is MB/s, over the write phase */
+		seq_printf(s, "%-32s %9zu %5llu %9llu %9llu %10llu %9llu %9llu %9llu %4d\n",
+			   rec->image, rec->bytes,
+			   rec->us[FPGA_MGR_PHASE_WRITE] ?
+			   div64_u64(rec->bytes,
+				     rec->us[FPGA_MGR_PHASE_WRITE]) : 0,
+			   rec->us[FPGA_MGR_PHASE_FIRMWARE],
+			   rec->us[FPGA_MGR_PHASE_SETUP],
+			   rec->us[FPGA_MGR_PHASE_WRITE_INIT],
+			   rec->us[FPGA_MGR_PHASE_WRITE],
+			   rec->us[FPGA_MGR_PHASE_WRITE_COMPLETE],
+			   rec->total_us, rec->ret);
+	}
+	mutex_unlock(&stats->lock);
+
+	return 0;
+}
+
+static int fpga_mgr_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fpga_mgr_stats_show, inode->i_private);
+}
+
+static const struct file_operations fpga_mgr_stats_fops = {
+	.owner = THIS_MODULE,
+	.open = fpga_mgr_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/**
+ * fpga_mgr_read - read fpga configuration memory back
+ * @mgr:	fpga manager
+ * @addr:	device specific frame address to start at
+ * @buf:	buffer for the data
+ * @count:	byte count of buf, a multiple of 4
+ * @flags:	FPGA_MGR_READBACK_* flags
+ *
+ * Block RAM contents and, with FPGA_MGR_READBACK_CAPTURE, flip-flop state
+ * can be saved this way while the FPGA keeps running.  This code assumes
+ * the caller got the mgr pointer from of_fpga_mgr_get() or fpga_mgr_get()
+ * and checked that it is not an error code.
+ *
+ * Return: 0 on success, -EOPNOTSUPP if the low level driver has no readback,
+ * other negative error code otherwise.
+ */
+int fpga_mgr_read(struct fpga_manager *mgr, u32 addr, char *buf,
+		  size_t count, unsigned long flags)
+{
+	if (!mgr->mops->read)
+		return -EOPNOTSUPP;
+
+	if (!count || count % 4)
+		return -EINVAL;
+
+	return mgr->mops->read(mgr, addr, buf, count, flags);
+}
+EXPORT_SYMBOL_GPL(fpga_mgr_read);
+
+static void fpga_mgr_load_work(struct work_struct *work)
+{
+	struct fpga_mgr_load *load = container_of(work, struct fpga_mgr_load,
+						  work);
+	struct fpga_manager *mgr = container_of(load, struct fpga_manager,
+						load);
+	fpga_mgr_load_done_t done = load->done;
+	void *context = load->context;
+	struct fpga_manager *ref = NULL;
+	int ret;
+
+	/* Loads from sysfs have nobody else holding the manager for them */
+	if (load->sysfs) {
+		ref = fpga_mgr_get(mgr->dev.parent);
+		if (IS_ERR(ref)) {
+			ret = PTR_ERR(ref);
+			goto out;
+		}
+	}
+
+	ret = fpga_mgr_firmware_load(mgr, load->info, load->image_name);
+
+	if (ref)
+		fpga_mgr_put(ref);
+out:
+	kfree(load->image_name);
+	load->image_name = NULL;
+	load->result = ret;
+	sysfs_notify(&mgr->dev.kobj, NULL, "load_result");
+	sysfs_notify(&mgr->dev.kobj, NULL, "state");
+
+	/* Unregister may free the manager as soon as the bit is clear */
+	if (done)
+		done(mgr, ret, context);
+
+	clear_bit_unlock(FPGA_MGR_LOAD_BUSY, &load->flags);
+	smp_mb__after_atomic();
+	wake_up_bit(&load->flags, FPGA_MGR_LOAD_BUSY);
+}
+
+static int __fpga_mgr_firmware_load_async(struct fpga_manager *mgr,
+					  struct fpga_image_info *info,
+					  const char *image_name,
+					  fpga_mgr_load_done_t done,
+					  void *context, bool sysfs)
+{
+	struct fpga_mgr_load *load = &mgr->load;
+
+	if (test_and_set_bit_lock(FPGA_MGR_LOAD_BUSY, &load->flags))
+		return -EBUSY;
+
+	load->image_name = kstrdup(image_name, GFP_KERNEL);
+	if (!load->image_name) {
+		clear_bit_unlock(FPGA_MGR_LOAD_BUSY, &load->flags);
+		return -ENOMEM;
+	}
+
+	load->info = info;
+	load->done = done;
+	load->context = context;
+	load->sysfs = sysfs;
+	load->result = -EINPROGRESS;
+	queue_work(system_unbound_wq, &load->work);
+
+	return 0;
+}
+
+/**
+ * fpga_mgr_firmware_load_async - load firmware to fpga in the background
+ * @mgr:	fpga manager
+ * @info:	fpga image specific information
+ * @image_name:	name of image file on the firmware search path
+ * @done:	optional: called with the result once the load has finished
+ * @context:	passed to @done
+ *
+ * Like fpga_mgr_firmware_load(), but returns as soon as the load is queued.
+ * The caller keeps its reference to the manager, and @info, until @done has
+ * been called.  @done runs in process context, before the next load can be
+ * queued, so it must not start one itself.
+ * Userspace can follow the same load by polling the load_result and state
+ * sysfs attributes.
+ *
+ * Return: 0 if the load was queued, -EBUSY if one is already in progress,
+ * other negative error code otherwise.
+ */
+int fpga_mgr_firmware_load_async(struct fpga_manager *mgr,
+				 struct fpga_image_info *info,
+				 const char *image_name,
+				 fpga_mgr_load_done_t done, void *context)
+{
+	return __fpga_mgr_firmware_load_async(mgr, info, image_name,
+					      done, context, false);
+}
+EXPORT_SYMBOL_GPL(fpga_mgr_firmware_load_async);
+
 static const char * const state_str[] = {
 	[FPGA_MGR_STATE_UNKNOWN] =		"unknown",
 	[FPGA_MGR_STATE_POWER_OFF] =		"power off",
@@ -351,15 +1141,174 @@ static ssize_t state_show(struct device *dev,
 	return sprintf(buf, "%s\n", state_str[mgr->state]);
 }
 
+/*
+ * Writing an image name starts a full reconfiguration and returns at once.
+ * load_result then reads -EINPROGRESS until the load has finished, and
+ * both load_result and state wake up poll() when it does.
+ */
+static ssize_t firmware_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct fpga_manager *mgr = to_fpga_manager(dev);
+	char *name;
+	int ret;
+
+	name = kstrndup(buf, count, GFP_KERNEL);
+	if (!name)
+		return -ENOMEM;
+
+	name[strcspn(name, "\n")] = '\0';
+	if (!strlen(name)) {
+		kfree(name);
+		return -EINVAL;
+	}
+
+	ret = __fpga_mgr_firmware_load_async(mgr, &mgr->load.sysfs_info, name,
+					     NULL, NULL, true);
+	kfree(name);
+
+	return ret ? ret : count;
+}
+
+static ssize_t load_result_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct fpga_manager *mgr = to_fpga_manager(dev);
+
+	return sprintf(buf, "%d\n", mgr->load.result);
+}
+
+/* Drop cached partial images, e.g. after updating them on disk */
+static ssize_t pr_cache_flush_store(struct device *dev,
+				    struct device_attribute *attr,
+				    const char *buf, size_t count)
+{
+	fpga_mgr_pr_cache_flush(to_fpga_manager(dev));
+
+	return count;
+}
+
+/*
+ * Writing "<frame address> <bytes> [capture]" takes a snapshot of
+ * configuration memory, which can then be read from readback_data.
+ */
+static ssize_t readback_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct fpga_manager *mgr = to_fpga_manager(dev);
+	struct fpga_manager *ref;
+	unsigned long flags = 0;
+	char mode[8] = "";
+	size_t len;
+	char *data;
+	u32 addr;
+	int ret;
+
+	ret = sscanf(buf, "%x %zu %7s", &addr, &len, mode);
+	if (ret < 2)
+		return -EINVAL;
+
+	if (ret == 3) {
+		if (strcmp(mode, "capture"))
+			return -EINVAL;
+		flags |= FPGA_MGR_READBACK_CAPTURE;
+	}
+
+	if (!len || len % 4)
+		return -EINVAL;
+
+	data = kvmalloc(len, GFP_KERNEL);
+	if (!data)
+		return -ENOMEM;
+
+	ref = fpga_mgr_get(dev->parent);
+	if (IS_ERR(ref)) {
+		kvfree(data);
+		return PTR_ERR(ref);
+	}
+
+	ret = fpga_mgr_read(mgr, addr, data, len, flags);
+	fpga_mgr_put(ref);
+	if (ret) {
+		kvfree(data);
+		return ret;
+	}
+
+	mutex_lock(&mgr->readback_lock);
+	kvfree(mgr->readback_buf);
+	mgr->readback_buf = data;
+	mgr->readback_len = len;
+	mutex_unlock(&mgr->readback_lock);
+
+	return count;
+}
+
+static ssize_t readback_data_read(struct file *filp, struct kobject *kobj,
+				  struct bin_attribute *attr, char *buf,
+				  loff_t off, size_t count)
+{
+	struct fpga_manager *mgr = to_fpga_manager(kobj_to_dev(kobj));
+	ssize_t ret;
+
+	mutex_lock(&mgr->readback_lock);
+	ret = memory_read_from_buffer(buf, count, &off, mgr->readback_buf,
+				      mgr->readback_len);
+	mutex_unlock(&mgr->readback_lock);
+
+	return ret;
+}
+
 static DEVICE_ATTR_RO(name);
 static DEVICE_ATTR_RO(state);
+static DEVICE_ATTR_WO(firmware);
+static DEVICE_ATTR_RO(load_result);
+static DEVICE_ATTR_WO(pr_cache_flush);
+static DEVICE_ATTR_WO(readback);
+static BIN_ATTR_RO(readback_data, 0);
 
 static struct attribute *fpga_mgr_attrs[] = {
 	&dev_attr_name.attr,
 	&dev_attr_state.attr,
+	&dev_attr_firmware.attr,
+	&dev_attr_load_result.attr,
+	&dev_attr_pr_cache_flush.attr,
+	&dev_attr_readback.attr,
 	NULL,
 };
-ATTRIBUTE_GROUPS(fpga_mgr);
+
+static struct bin_attribute *fpga_mgr_bin_attrs[] = {
+	&bin_attr_readback_data,
+	NULL,
+};
+
+static umode_t fpga_mgr_attr_is_visible(struct kobject *kobj,
+					struct attribute *attr, int n)
+{
+	struct fpga_manager *mgr = to_fpga_manager(kobj_to_dev(kobj));
+
+	if (attr == &dev_attr_readback.attr && !mgr->mops->read)
+		return 0;
+
+	return attr->mode;
+}
+
+static umode_t fpga_mgr_bin_attr_is_visible(struct kobject *kobj,
+					    struct bin_attribute *attr, int n)
+{
+	struct fpga_manager *mgr = to_fpga_manager(kobj_to_dev(kobj));
+
+	return mgr->mops->read ? attr->attr.mode : 0;
+}
+
+static const struct attribute_group fpga_mgr_group = {
+	.attrs = fpga_mgr_attrs,
+	.bin_attrs = fpga_mgr_bin_attrs,
+	.is_visible = fpga_mgr_attr_is_visible,
+	.is_bin_visible = fpga_mgr_bin_attr_is_visible,
+};
+__ATTRIBUTE_GROUPS(fpga_mgr);
 
 static struct fpga_manager *__fpga_mgr_get(struct device *dev)
 {
@@ -482,6 +1431,13 @@ int fpga_mgr_register(struct device *dev, const char *name,
 	if (!mgr)
 		return -ENOMEM;
 
+	mgr->stats = kzalloc(sizeof(*mgr->stats), GFP_KERNEL);
+	if (!mgr->stats) {
+		ret = -ENOMEM;
+		goto error_kfree;
+	}
+	mutex_init(&mgr->stats->lock);
+
 	id = ida_simple_get(&fpga_mgr_ida, 0, 0, GFP_KERNEL);
 	if (id < 0) {
 		ret = id;
@@ -489,6 +1445,10 @@ int fpga_mgr_register(struct device *dev, const char *name,
 	}
 
 	mutex_init(&mgr->ref_mutex);
+	INIT_WORK(&mgr->load.work, fpga_mgr_load_work);
+	mutex_init(&mgr->pr_cache_lock);
+	INIT_LIST_HEAD(&mgr->pr_cache);
+	mutex_init(&mgr->readback_lock);
 
 	mgr->name = name;
 	mgr->mops = mops;
@@ -516,6 +1476,13 @@ int fpga_mgr_register(struct device *dev, const char *name,
 	if (ret)
 		goto error_device;
 
+	if (fpga_mgr_debugfs_root)
+		mgr->stats->debugfs = debugfs_create_file(dev_name(&mgr->dev),
+							  0444,
+							  fpga_mgr_debugfs_root,
+							  mgr->stats,
+							  &fpga_mgr_stats_fops);
+
 	dev_info(&mgr->dev, "%s registered\n", mgr->name);
 
 	return 0;
@@ -523,6 +1490,7 @@ int fpga_mgr_register(struct device *dev, const char *name,
 error_device:
 	ida_simple_remove(&fpga_mgr_ida, id);
 error_kfree:
+	kfree(mgr->stats);
 	kfree(mgr);
 
 	return ret;
@@ -539,6 +1507,10 @@ void fpga_mgr_unregister(struct device *dev)
 
 	dev_info(&mgr->dev, "%s %s\n", __func__, mgr->name);
 
+	/* Wait for a background load and keep new ones from starting */
+	wait_on_bit_lock(&mgr->load.flags, FPGA_MGR_LOAD_BUSY,
+			 TASK_UNINTERRUPTIBLE);
+
 	/*
 	 * If the low level driver provides a method for putting fpga into
 	 * a desired state upon unregister, do it.
@@ -546,6 +1518,8 @@ void fpga_mgr_unregister(struct device *dev)
 	if (mgr->mops->fpga_remove)
 		mgr->mops->fpga_remove(mgr);
 
+	debugfs_remove(mgr->stats->debugfs);
+
 	device_unregister(&mgr->dev);
 }
 EXPORT_SYMBOL_GPL(fpga_mgr_unregister);
@@ -554,7 +1528,11 @@ static void fpga_mgr_dev_release(struct device *dev)
 {
 	struct fpga_manager *mgr = to_fpga_manager(dev);
 
+	fpga_mgr_pr_cache_flush(mgr);
 	ida_simple_remove(&fpga_mgr_ida, mgr->dev.id);
+	kfree(mgr->stats);
+	kvfree(mgr->readback_buf);
+	fpga_mgr_restore_image_free(mgr);
 	kfree(mgr);
 }
 
@@ -568,12 +1546,20 @@ static int __init fpga_mgr_class_init(void)
 
 	fpga_mgr_class->dev_groups = fpga_mgr_groups;
 	fpga_mgr_class->dev_release = fpga_mgr_dev_release;
+#ifdef CONFIG_HIBERNATION
+	fpga_mgr_class->pm = &fpga_mgr_pm_ops;
+#endif
+
+	fpga_mgr_debugfs_root = debugfs_create_dir("fpga_manager", NULL);
+	if (IS_ERR(fpga_mgr_debugfs_root))
+		fpga_mgr_debugfs_root = NULL;
 
 	return 0;
 }
 
 static void __exit fpga_mgr_class_exit(void)
 {
+	debugfs_remove_recursive(fpga_mgr_debugfs_root);
 	class_destroy(fpga_mgr_class);
 	ida_destroy(&fpga_mgr_ida);
 }
@@ -25,6 +25,11 @@
 #include <linux/of_platform.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+/* Retry a boot time image that is not readable yet for about 30 seconds */
+#define FPGA_REGION_PRELOAD_DELAY_MS	500
+#define FPGA_REGION_PRELOAD_TRIES	60
 
 /**
  * struct fpga_region - FPGA Region structure
@@ -32,12 +37,18 @@
  * @mutex: enforces exclusive reference to region
  * @bridge_list: list of FPGA bridges specified in region
  * @info: fpga image specific information
+ * @preload_work: programs the boot time image given in the base tree
+ * @preload_name: name of the boot time image
+ * @preload_tries: attempts left while the image is not readable yet
  */
 struct fpga_region {
 	struct device dev;
 	struct mutex mutex; /* for exclusive reference to region */
 	struct list_head bridge_list;
 	struct fpga_image_info *info;
+	struct delayed_work preload_work;
+	const char *preload_name;
+	unsigned int preload_tries;
 };
 
 #define to_fpga_region(d) container_of(d, struct fpga_region, dev)
@@ -288,6 +299,100 @@ err_put_region:
 	return ret;
 }
 
+/**
+ * fpga_region_swap - reprogram a partial region in place
+ * @region: FPGA region
+ * @firmware_name: name of FPGA image firmware file
+ *
+ * Swap the image in a partial reconfiguration region whose overlay is
+ * already applied.  The new image must present the same interface to the
+ * static design, so the overlay, the devices it created and the region's
+ * bridge list are all kept: only those bridges, normally just the region's
+ * PR decoupler, are toggled around the load.
+ *
+ * Return 0 for success or negative error code.
+ */
+static int fpga_region_swap(struct fpga_region *region,
+			    const char *firmware_name)
+{
+	struct fpga_manager *mgr;
+	int ret;
+
+	region = fpga_region_get(region);
+	if (IS_ERR(region))
+		return PTR_ERR(region);
+
+	if (!region->info ||
+	    !(region->info->flags & FPGA_MGR_PARTIAL_RECONFIG)) {
+		ret = -EINVAL;
+		goto err_put_region;
+	}
+
+	mgr = fpga_region_get_manager(region);
+	if (IS_ERR(mgr)) {
+		ret = PTR_ERR(mgr);
+		goto err_put_region;
+	}
+
+	ret = fpga_bridges_disable(&region->bridge_list);
+	if (ret) {
+		dev_err(&region->dev, "failed to disable region bridges\n");
+		goto err_put_mgr;
+	}
+
+	ret = fpga_mgr_firmware_load(mgr, region->info, firmware_name);
+	if (ret) {
+		/* Leave the bridges closed in front of a broken image */
+		dev_err(&region->dev, "failed to load fpga image\n");
+		goto err_put_mgr;
+	}
+
+	ret = fpga_bridges_enable(&region->bridge_list);
+	if (ret)
+		dev_err(&region->dev, "failed to enable region bridges\n");
+
+err_put_mgr:
+	fpga_mgr_put(mgr);
+err_put_region:
+	fpga_region_put(region);
+
+	return ret;
+}
+
+/*
+ * Writing an image name swaps it into a partial region without touching
+ * the overlay, see fpga_region_swap().
+ */
+static ssize_t firmware_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+	char *name;
+	int ret;
+
+	name = kstrndup(buf, count, GFP_KERNEL);
+	if (!name)
+		return -ENOMEM;
+
+	name[strcspn(name, "\n")] = '\0';
+	if (strlen(name))
+		ret = fpga_region_swap(region, name);
+	else
+		ret = -EINVAL;
+	kfree(name);
+
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR_WO(firmware);
+
+static struct attribute *fpga_region_attrs[] = {
+	&dev_attr_firmware.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(fpga_region);
+
 /**
  * child_regions_with_firmware
  * @overlay: device node of the overlay
@@ -325,6 +430,45 @@ static int child_regions_with_firmware(struct device_node *overlay)
 	return ret;
 }
 
+/**
+ * fpga_region_parse_info - read FPGA image properties
+ * @region: FPGA region
+ * @np: overlay, or region node for a boot time image
+ *
+ * Return: the region's new image info, or NULL if out of memory.
+ */
+static struct fpga_image_info *
+fpga_region_parse_info(struct fpga_region *region, struct device_node *np)
+{
+	struct fpga_image_info *info;
+
+	info = devm_kzalloc(&region->dev, sizeof(*info), GFP_KERNEL);
+	if (!info)
+		return NULL;
+
+	region->info = info;
+
+	if (of_property_read_bool(np, "partial-fpga-config"))
+		info->flags |= FPGA_MGR_PARTIAL_RECONFIG;
+
+	if (of_property_read_bool(np, "external-fpga-config"))
+		info->flags |= FPGA_MGR_EXTERNAL_CONFIG;
+
+	if (of_property_read_bool(np, "encrypted-fpga-config"))
+		info->flags |= FPGA_MGR_ENCRYPTED_BITSTREAM;
+
+	of_property_read_u32(np, "region-unfreeze-timeout-us",
+			     &info->enable_timeout_us);
+
+	of_property_read_u32(np, "region-freeze-timeout-us",
+			     &info->disable_timeout_us);
+
+	of_property_read_u32(np, "config-complete-timeout-us",
+			     &info->config_complete_timeout_us);
+
+	return info;
+}
+
 /**
  * fpga_region_notify_pre_apply - pre-apply overlay notification
  *
@@ -358,38 +502,17 @@ static int fpga_region_notify_pre_apply(struct fpga_region *region,
 	struct fpga_image_info *info;
 	int ret;
 
-	info = devm_kzalloc(&region->dev, sizeof(*info), GFP_KERNEL);
+	info = fpga_region_parse_info(region, nd->overlay);
 	if (!info)
 		return -ENOMEM;
 
-	region->info = info;
-
 	/* Reject overlay if child FPGA Regions have firmware-name property */
 	ret = child_regions_with_firmware(nd->overlay);
 	if (ret)
 		return ret;
 
-	/* Read FPGA region properties from the overlay */
-	if (of_property_read_bool(nd->overlay, "partial-fpga-config"))
-		info->flags |= FPGA_MGR_PARTIAL_RECONFIG;
-
-	if (of_property_read_bool(nd->overlay, "external-fpga-config"))
-		info->flags |= FPGA_MGR_EXTERNAL_CONFIG;
-
-	if (of_property_read_bool(nd->overlay, "encrypted-fpga-config"))
-		info->flags |= FPGA_MGR_ENCRYPTED_BITSTREAM;
-
 	of_property_read_string(nd->overlay, "firmware-name", &firmware_name);
 
-	of_property_read_u32(nd->overlay, "region-unfreeze-timeout-us",
-			     &info->enable_timeout_us);
-
-	of_property_read_u32(nd->overlay, "region-freeze-timeout-us",
-			     &info->disable_timeout_us);
-
-	of_property_read_u32(nd->overlay, "config-complete-timeout-us",
-			     &info->config_complete_timeout_us);
-
 	/* If FPGA was externally programmed, don't specify firmware */
 	if ((info->flags & FPGA_MGR_EXTERNAL_CONFIG) && firmware_name) {
 		pr_err("error: specified firmware and external-fpga-config");
@@ -421,10 +544,13 @@ static int fpga_region_notify_pre_apply(struct fpga_region *region,
 static void fpga_region_notify_post_remove(struct fpga_region *region,
 					   struct of_overlay_notify_data *nd)
 {
+	/* Wait for a swap through the firmware attribute to finish */
+	mutex_lock(&region->mutex);
 	fpga_bridges_disable(&region->bridge_list);
 	fpga_bridges_put(&region->bridge_list);
 	devm_kfree(&region->dev, region->info);
 	region->info = NULL;
+	mutex_unlock(&region->mutex);
 }
 
 /**
@@ -489,6 +615,53 @@ static struct notifier_block fpga_region_of_nb = {
 	.notifier_call = of_fpga_region_notify,
 };
 
+/**
+ * fpga_region_preload - program the boot time image
+ * @work: delayed work in the FPGA region
+ *
+ * A region in the base tree may name a "firmware-name" to program at boot.
+ * The load runs in the background from probe, in parallel with the rest of
+ * the boot, and the region's child devices are only populated once it has
+ * succeeded, so the drivers for the PL devices need no deferred probing.
+ * If the image is not readable yet, e.g. the root filesystem holding it is
+ * not mounted, or the manager has not probed, the load is retried for a
+ * while.
+ */
+static void fpga_region_preload(struct work_struct *work)
+{
+	struct fpga_region *region = container_of(to_delayed_work(work),
+						  struct fpga_region,
+						  preload_work);
+	struct device_node *np = region->dev.of_node;
+	int ret;
+
+	if (!fpga_region_parse_info(region, np)) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	ret = fpga_region_program_fpga(region, region->preload_name, np);
+	/* Missing image, or manager not registered yet */
+	if ((ret == -ENOENT || ret == -ENODEV) && --region->preload_tries) {
+		devm_kfree(&region->dev, region->info);
+		region->info = NULL;
+		schedule_delayed_work(&region->preload_work,
+			msecs_to_jiffies(FPGA_REGION_PRELOAD_DELAY_MS));
+		return;
+	}
+	if (ret)
+		goto err;
+
+	of_platform_populate(np, fpga_region_of_match, NULL, &region->dev);
+	dev_info(&region->dev, "programmed %s\n", region->preload_name);
+
+	return;
+
+err:
+	dev_err(&region->dev, "failed to program %s: %d\n",
+		region->preload_name, ret);
+}
+
 static int fpga_region_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -508,6 +681,7 @@ static int fpga_region_probe(struct platform_device *pdev)
 
 	mutex_init(&region->mutex);
 	INIT_LIST_HEAD(&region->bridge_list);
+	INIT_DELAYED_WORK(&region->preload_work, fpga_region_preload);
 
 	device_initialize(&region->dev);
 	region->dev.class = fpga_region_class;
@@ -524,7 +698,14 @@ static int fpga_region_probe(struct platform_device *pdev)
 	if (ret)
 		goto err_remove;
 
-	of_platform_populate(np, fpga_region_of_match, NULL, &region->dev);
+	if (!of_property_read_string(np, "firmware-name",
+				     &region->preload_name)) {
+		region->preload_tries = FPGA_REGION_PRELOAD_TRIES;
+		schedule_delayed_work(&region->preload_work, 0);
+	} else {
+		of_platform_populate(np, fpga_region_of_match, NULL,
+				     &region->dev);
+	}
 
 	dev_info(dev, "FPGA Region probed\n");
 
@@ -542,6 +723,7 @@ static int fpga_region_remove(struct platform_device *pdev)
 {
 	struct fpga_region *region = platform_get_drvdata(pdev);
 
+	cancel_delayed_work_sync(&region->preload_work);
 	device_unregister(&region->dev);
 
 	return 0;
@@ -576,6 +758,7 @@ static int __init fpga_region_init(void)
 	if (IS_ERR(fpga_region_class))
 		return PTR_ERR(fpga_region_class);
 
+	fpga_region_class->dev_groups = fpga_region_groups;
 	fpga_region_class->dev_release = fpga_region_dev_release;
 
 	ret = of_overlay_notifier_register(&fpga_region_of_nb);
@@ -32,6 +32,8 @@
 #include <linux/string.h>
 #include <linux/scatterlist.h>
 
+#include <trace/events/fpga.h>
+
 /* Offsets into SLCR regmap */
 
 /* FPGA Software Reset Control */
@@ -112,6 +114,24 @@
  * interrupting
  */
 #define DMA_SRC_LAST_TRANSFER		1
+/* Largest single DMA command, the length registers count 27 bits of words */
+#define DMA_MAX_LEN			(GENMASK(26, 0) * 4)
+
+/* Configuration packets for readback, UG470 chapter 5 */
+#define PKT_DUMMY			0xffffffff
+#define PKT_SYNC			0xaa995566
+#define PKT_NOOP			0x20000000
+#define PKT_WRITE_CMD			0x30008001
+#define PKT_WRITE_FAR			0x30002001
+#define PKT_READ_FDRO			0x28006000
+#define PKT_TYPE2_READ(words)		(0x48000000 | (words))
+#define CMD_RCFG			0x04
+#define CMD_RCRC			0x07
+#define CMD_GCAPTURE			0x0c
+#define CMD_DESYNC			0x0d
+/* 7 series frames are 101 words, readback data starts with a pad frame */
+#define FRAME_WORDS			101
+#define READBACK_CMD_WORDS		32
 /* Timeout for DMA completion */
 #define DMA_TIMEOUT_MS			5000
 
@@ -128,6 +148,7 @@
 #define FPGA_RST_NONE_MASK		0x0
 
 struct zynq_fpga_priv {
+	struct device *dev;
 	int irq;
 	struct clk *clk;
 
@@ -165,11 +186,23 @@ static inline void zynq_fpga_set_irq(struct zynq_fpga_priv *priv, u32 enable)
 }
 
 /* Must be called with dma_lock held */
+/* Push one command into the DMA command queue, lengths are in words */
+static void zynq_fpga_queue_dma(struct zynq_fpga_priv *priv, u32 src, u32 dst,
+				u32 src_len, u32 dst_len)
+{
+	zynq_fpga_write(priv, DMA_SRC_ADDR_OFFSET, src);
+	zynq_fpga_write(priv, DMA_DST_ADDR_OFFSET, dst);
+	zynq_fpga_write(priv, DMA_SRC_LEN_OFFSET, src_len);
+	zynq_fpga_write(priv, DMA_DEST_LEN_OFFSET, dst_len);
+}
+
 static void zynq_step_dma(struct zynq_fpga_priv *priv)
 {
+	struct scatterlist *next;
 	u32 addr;
 	u32 len;
 	bool first;
+	bool last;
 
 	first = priv->dma_elm == 0;
 	while (priv->cur_sg) {
@@ -179,7 +212,24 @@ static void zynq_step_dma(struct zynq_fpga_priv *priv)
 
 		addr = sg_dma_address(priv->cur_sg);
 		len = sg_dma_len(priv->cur_sg);
-		if (priv->dma_elm + 1 == priv->dma_nelms) {
+
+		/* The command queue is only a few entries deep, so merge
+		 * physically adjacent segments into one command to keep more
+		 * data queued per DMA done interrupt.
+		 */
+		while (priv->dma_elm + 1 < priv->dma_nelms) {
+			next = sg_next(priv->cur_sg);
+			if (sg_dma_address(next) != addr + len ||
+			    len + sg_dma_len(next) > DMA_MAX_LEN)
+				break;
+			len += sg_dma_len(next);
+			priv->cur_sg = next;
+			priv->dma_elm++;
+		}
+
+		last = priv->dma_elm + 1 == priv->dma_nelms;
+		trace_zynq_fpga_dma_queue(priv->dev, addr, len, last);
+		if (last) {
 			/* The last transfer waits for the PCAP to finish too,
 			 * notice this also changes the irq_mask to ignore
 			 * IXR_DMA_DONE_MASK which ensures we do not trigger
@@ -192,10 +242,7 @@ static void zynq_step_dma(struct zynq_fpga_priv *priv)
 			priv->dma_elm++;
 		}
 
-		zynq_fpga_write(priv, DMA_SRC_ADDR_OFFSET, addr);
-		zynq_fpga_write(priv, DMA_DST_ADDR_OFFSET, DMA_INVALID_ADDRESS);
-		zynq_fpga_write(priv, DMA_SRC_LEN_OFFSET, len / 4);
-		zynq_fpga_write(priv, DMA_DEST_LEN_OFFSET, 0);
+		zynq_fpga_queue_dma(priv, addr, DMA_INVALID_ADDRESS, len / 4, 0);
 	}
 
 	/* Once the first transfer is queued we can turn on the ISR, future
@@ -237,6 +284,7 @@ static irqreturn_t zynq_fpga_isr(int irq, void *data)
 	}
 	spin_unlock(&priv->dma_lock);
 
+	trace_zynq_fpga_dma_done(priv->dev, intr_status);
 	zynq_fpga_set_irq(priv, 0);
 	complete(&priv->dma_done);
 
@@ -546,12 +594,125 @@ static enum fpga_mgr_states zynq_fpga_ops_state(struct fpga_manager *mgr)
 	return FPGA_MGR_STATE_UNKNOWN;
 }
 
+/* Read configuration memory back through the PCAP, without shutting the
+ * PL down. Three DMA commands go into the queue back to back: the command
+ * sequence up to the FDRO read, the read itself into memory, and the
+ * DESYNC sequence. Queueing the read before the PCAP starts returning
+ * data keeps its read FIFO from overflowing.
+ */
+static int zynq_fpga_ops_read(struct fpga_manager *mgr, u32 addr, char *buf,
+			      size_t count, unsigned long flags)
+{
+	struct zynq_fpga_priv *priv = mgr->priv;
+	struct device *dev = mgr->dev.parent;
+	size_t words = count / 4 + FRAME_WORDS;
+	dma_addr_t cmd_dma, data_dma;
+	u32 *cmd, *data;
+	u32 ctrl, status, intr_status;
+	unsigned int n = 0, desync;
+	int err;
+
+	if (words > GENMASK(26, 0))
+		return -EINVAL;
+
+	cmd = dma_alloc_coherent(dev, READBACK_CMD_WORDS * 4, &cmd_dma,
+				 GFP_KERNEL);
+	if (!cmd)
+		return -ENOMEM;
+
+	data = dma_alloc_coherent(dev, words * 4, &data_dma, GFP_KERNEL);
+	if (!data) {
+		err = -ENOMEM;
+		goto out_free_cmd;
+	}
+
+	cmd[n++] = PKT_DUMMY;
+	cmd[n++] = PKT_SYNC;
+	cmd[n++] = PKT_NOOP;
+	cmd[n++] = PKT_WRITE_CMD;
+	cmd[n++] = CMD_RCRC;
+	cmd[n++] = PKT_NOOP;
+	cmd[n++] = PKT_NOOP;
+	if (flags & FPGA_MGR_READBACK_CAPTURE) {
+		/* Copy flip-flop state into configuration memory first */
+		cmd[n++] = PKT_WRITE_CMD;
+		cmd[n++] = CMD_GCAPTURE;
+		cmd[n++] = PKT_NOOP;
+	}
+	cmd[n++] = PKT_WRITE_CMD;
+	cmd[n++] = CMD_RCFG;
+	cmd[n++] = PKT_NOOP;
+	cmd[n++] = PKT_WRITE_FAR;
+	cmd[n++] = addr;
+	cmd[n++] = PKT_READ_FDRO;
+	cmd[n++] = PKT_TYPE2_READ(words);
+	cmd[n++] = PKT_NOOP;
+	cmd[n++] = PKT_NOOP;
+	desync = n;
+	cmd[n++] = PKT_WRITE_CMD;
+	cmd[n++] = CMD_DESYNC;
+	cmd[n++] = PKT_NOOP;
+	cmd[n++] = PKT_NOOP;
+
+	err = clk_enable(priv->clk);
+	if (err)
+		goto out_free_data;
+
+	ctrl = zynq_fpga_read(priv, CTRL_OFFSET);
+	zynq_fpga_write(priv, CTRL_OFFSET,
+			CTRL_PCAP_PR_MASK | CTRL_PCAP_MODE_MASK | ctrl);
+	ctrl = zynq_fpga_read(priv, MCTRL_OFFSET);
+	zynq_fpga_write(priv, MCTRL_OFFSET, ~MCTRL_PCAP_LPBK_MASK & ctrl);
+
+	status = zynq_fpga_read(priv, STATUS_OFFSET);
+	if (!(status & STATUS_DMA_Q_E)) {
+		dev_err(&mgr->dev, "DMA command queue not right\n");
+		err = -EBUSY;
+		goto out_clk;
+	}
+
+	zynq_fpga_set_irq(priv, 0);
+	zynq_fpga_write(priv, INT_STS_OFFSET, IXR_ALL_MASK);
+
+	zynq_fpga_queue_dma(priv, cmd_dma, DMA_INVALID_ADDRESS, desync, 0);
+	zynq_fpga_queue_dma(priv, DMA_INVALID_ADDRESS, data_dma, 0, words);
+	zynq_fpga_queue_dma(priv, (cmd_dma + desync * 4) | DMA_SRC_LAST_TRANSFER,
+			    DMA_INVALID_ADDRESS, n - desync, 0);
+
+	err = zynq_fpga_poll_timeout(priv, INT_STS_OFFSET, intr_status,
+				     (intr_status & IXR_ERROR_FLAGS_MASK) ||
+				     (intr_status & IXR_D_P_DONE_MASK) ==
+				     IXR_D_P_DONE_MASK,
+				     INIT_POLL_DELAY, DMA_TIMEOUT_MS * 1000);
+	zynq_fpga_write(priv, INT_STS_OFFSET, IXR_ALL_MASK);
+
+	if (!err && (intr_status & IXR_ERROR_FLAGS_MASK))
+		err = -EIO;
+	if (err) {
+		dev_err(&mgr->dev, "Readback failed: INT_STS:0x%x STATUS:0x%x\n",
+			intr_status, zynq_fpga_read(priv, STATUS_OFFSET));
+		goto out_clk;
+	}
+
+	memcpy(buf, data + FRAME_WORDS, count);
+
+out_clk:
+	clk_disable(priv->clk);
+out_free_data:
+	dma_free_coherent(dev, words * 4, data, data_dma);
+out_free_cmd:
+	dma_free_coherent(dev, READBACK_CMD_WORDS * 4, cmd, cmd_dma);
+
+	return err;
+}
+
 static const struct fpga_manager_ops zynq_fpga_ops = {
 	.initial_header_size = 128,
 	.state = zynq_fpga_ops_state,
 	.write_init = zynq_fpga_ops_write_init,
 	.write_sg = zynq_fpga_ops_write,
 	.write_complete = zynq_fpga_ops_write_complete,
+	.read = zynq_fpga_ops_read,
 };
 
 static int zynq_fpga_probe(struct platform_device *pdev)
@@ -564,6 +725,8 @@ static int zynq_fpga_probe(struct platform_device *pdev)
 	priv = devm_kzalloc(dev, sizeof(*priv), GFP_KERNEL);
 	if (!priv)
 		return -ENOMEM;
+
+	priv->dev = dev;
 	spin_lock_init(&priv->dma_lock);
 
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
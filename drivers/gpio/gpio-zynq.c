@@ -229,6 +229,114 @@ static void zynq_gpio_set_value(struct gpio_chip *chip, unsigned int pin,
 	writel_relaxed(state, gpio->base_addr + reg_offset);
 }
 
+/**
+ * zynq_gpio_bank_bits - Extract the bits of one bank from a gpiolib bitmap
+ * @map:	bitmap with one bit per gpio pin of the device
+ * @gpio:	gpio device the bitmap belongs to
+ * @bank_num:	bank whose bits are extracted
+ *
+ * Return: the bits for the pins of the bank, pin 0 of the bank being bit 0.
+ */
+static u32 zynq_gpio_bank_bits(const unsigned long *map,
+			       struct zynq_gpio *gpio, unsigned int bank_num)
+{
+	unsigned int start = gpio->p_data->bank_min[bank_num];
+	unsigned int nbits = gpio->p_data->bank_max[bank_num] - start + 1;
+	unsigned int idx = BIT_WORD(start);
+	unsigned int off = start % BITS_PER_LONG;
+	u32 val;
+
+	val = map[idx] >> off;
+	if (off + nbits > BITS_PER_LONG)
+		val |= map[idx + 1] << (BITS_PER_LONG - off);
+
+	return val & GENMASK(nbits - 1, 0);
+}
+
+/**
+ * zynq_gpio_get_multiple - Get the state of several pins of the GPIO device
+ * @chip:	gpio_chip instance to be worked on
+ * @mask:	bitmap of the pins to read
+ * @bits:	bitmap receiving the state of the pins in @mask
+ *
+ * This function reads the data register of each bank with a pin in @mask
+ * once, rather than once per pin.
+ *
+ * Return: 0 always
+ */
+static int zynq_gpio_get_multiple(struct gpio_chip *chip, unsigned long *mask,
+				  unsigned long *bits)
+{
+	struct zynq_gpio *gpio = gpiochip_get_data(chip);
+	unsigned int bank_num, i, pin;
+	u32 bank_mask, data;
+
+	for (bank_num = 0; bank_num < gpio->p_data->max_bank; bank_num++) {
+		bank_mask = zynq_gpio_bank_bits(mask, gpio, bank_num);
+		if (!bank_mask)
+			continue;
+
+		data = readl_relaxed(gpio->base_addr +
+				     ZYNQ_GPIO_DATA_RO_OFFSET(bank_num));
+
+		for (i = 0; bank_mask; i++, bank_mask >>= 1) {
+			if (!(bank_mask & 1))
+				continue;
+			pin = gpio->p_data->bank_min[bank_num] + i;
+			if (data & BIT(i))
+				__set_bit(pin, bits);
+			else
+				__clear_bit(pin, bits);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * zynq_gpio_set_multiple - Modify the state of several pins of the GPIO device
+ * @chip:	gpio_chip instance to be worked on
+ * @mask:	bitmap of the pins to modify
+ * @bits:	bitmap holding the new state of the pins in @mask
+ *
+ * Each bank half is updated with a single write to its mask/data register,
+ * so at most two writes per bank are needed and pins outside @mask are left
+ * untouched without a read-modify-write.
+ */
+static void zynq_gpio_set_multiple(struct gpio_chip *chip, unsigned long *mask,
+				   unsigned long *bits)
+{
+	struct zynq_gpio *gpio = gpiochip_get_data(chip);
+	unsigned int bank_num;
+	u32 bank_mask, bank_bits;
+
+	for (bank_num = 0; bank_num < gpio->p_data->max_bank; bank_num++) {
+		bank_mask = zynq_gpio_bank_bits(mask, gpio, bank_num);
+		if (!bank_mask)
+			continue;
+
+		bank_bits = zynq_gpio_bank_bits(bits, gpio, bank_num);
+
+		/*
+		 * the upper 16 bits of the mask/data register mask out the
+		 * pins which are not to be changed
+		 */
+		if (bank_mask & ~ZYNQ_GPIO_UPPER_MASK)
+			writel_relaxed((~bank_mask << ZYNQ_GPIO_MID_PIN_NUM) |
+				       (bank_bits & ~ZYNQ_GPIO_UPPER_MASK),
+				       gpio->base_addr +
+				       ZYNQ_GPIO_DATA_LSW_OFFSET(bank_num));
+
+		bank_mask >>= ZYNQ_GPIO_MID_PIN_NUM;
+		bank_bits >>= ZYNQ_GPIO_MID_PIN_NUM;
+		if (bank_mask)
+			writel_relaxed((~bank_mask << ZYNQ_GPIO_MID_PIN_NUM) |
+				       bank_bits,
+				       gpio->base_addr +
+				       ZYNQ_GPIO_DATA_MSW_OFFSET(bank_num));
+	}
+}
+
 /**
  * zynq_gpio_dir_in - Set the direction of the specified GPIO pin as input
  * @chip:	gpio_chip instance to be worked on
@@ -706,7 +814,9 @@ static int zynq_gpio_probe(struct platform_device *pdev)
 	chip->owner = THIS_MODULE;
 	chip->parent = &pdev->dev;
 	chip->get = zynq_gpio_get_value;
+	chip->get_multiple = zynq_gpio_get_multiple;
 	chip->set = zynq_gpio_set_value;
+	chip->set_multiple = zynq_gpio_set_multiple;
 	chip->request = zynq_gpio_request;
 	chip->free = zynq_gpio_free;
 	chip->direction_input = zynq_gpio_dir_in;
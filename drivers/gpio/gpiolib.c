@@ -351,17 +351,18 @@ static long linehandle_ioctl(struct file *filep, unsigned int cmd,
 	int i;
 
 	if (cmd == GPIOHANDLE_GET_LINE_VALUES_IOCTL) {
-		int val;
-
-		memset(&ghd, 0, sizeof(ghd));
+		int vals[GPIOHANDLES_MAX];
+		int ret;
 
 		/* TODO: check if descriptors are really input */
-		for (i = 0; i < lh->numdescs; i++) {
-			val = gpiod_get_value_cansleep(lh->descs[i]);
-			if (val < 0)
-				return val;
-			ghd.values[i] = val;
-		}
+		ret = gpiod_get_array_value_complex(false, true, lh->numdescs,
+						    lh->descs, vals);
+		if (ret)
+			return ret;
+
+		memset(&ghd, 0, sizeof(ghd));
+		for (i = 0; i < lh->numdescs; i++)
+			ghd.values[i] = vals[i];
 
 		if (copy_to_user(ip, &ghd, sizeof(ghd)))
 			return -EFAULT;
@@ -558,6 +559,8 @@ out_free_lh:
  * @desc: the GPIO descriptor held by this event
  * @eflags: the event flags this line was requested with
  * @irq: the interrupt that trigger in response to events on this GPIO
+ * @cansleep: the line value can only be read from the irq thread
+ * @timestamp: time of the last interrupt, handed to the irq thread
  * @wait: wait queue that handles blocking reads of events
  * @events: KFIFO for the GPIO events
  * @read_lock: mutex lock to protect reads from colliding with adding
@@ -569,8 +572,10 @@ struct lineevent_state {
 	struct gpio_desc *desc;
 	u32 eflags;
 	int irq;
+	bool cansleep;
+	u64 timestamp;
 	wait_queue_head_t wait;
-	DECLARE_KFIFO(events, struct gpioevent_data, 16);
+	DECLARE_KFIFO(events, struct gpioevent_data, 256);
 	struct mutex read_lock;
 };
 
@@ -700,17 +705,17 @@ static const struct file_operations lineevent_fileops = {
 #endif
 };
 
-static irqreturn_t lineevent_irq_thread(int irq, void *p)
+static irqreturn_t lineevent_emit(struct lineevent_state *le, u64 timestamp)
 {
-	struct lineevent_state *le = p;
 	struct gpioevent_data ge;
 	int ret;
 
-	ge.timestamp = ktime_get_real_ns();
+	ge.timestamp = timestamp;
 
 	if (le->eflags & GPIOEVENT_REQUEST_RISING_EDGE
 	    && le->eflags & GPIOEVENT_REQUEST_FALLING_EDGE) {
-		int level = gpiod_get_value_cansleep(le->desc);
+		int level = le->cansleep ? gpiod_get_value_cansleep(le->desc) :
+					   gpiod_get_value(le->desc);
 
 		if (level)
 			/* Emit low-to-high event */
@@ -731,10 +736,39 @@ static irqreturn_t lineevent_irq_thread(int irq, void *p)
 	ret = kfifo_put(&le->events, ge);
 	if (ret != 0)
 		wake_up_poll(&le->wait, POLLIN);
+	else
+		dev_warn_ratelimited(&le->gdev->dev,
+				     "event FIFO full, dropping events\n");
 
 	return IRQ_HANDLED;
 }
 
+static irqreturn_t lineevent_irq_thread(int irq, void *p)
+{
+	struct lineevent_state *le = p;
+
+	return lineevent_emit(le, le->timestamp);
+}
+
+/*
+ * Take the timestamp in hard interrupt context, so that it does not
+ * include the wakeup latency of the irq thread. If the line can be read
+ * without sleeping, as on SoC GPIO blocks, the whole event is reported
+ * from here, and edges that come faster than the thread could run are
+ * all queued.
+ */
+static irqreturn_t lineevent_irq_handler(int irq, void *p)
+{
+	struct lineevent_state *le = p;
+	u64 timestamp = ktime_get_ns();
+
+	if (!le->cansleep)
+		return lineevent_emit(le, timestamp);
+
+	le->timestamp = timestamp;
+	return IRQ_WAKE_THREAD;
+}
+
 static int lineevent_create(struct gpio_device *gdev, void __user *ip)
 {
 	struct gpioevent_request eventreq;
@@ -824,10 +858,11 @@ static int lineevent_create(struct gpio_device *gdev, void __user *ip)
 	INIT_KFIFO(le->events);
 	init_waitqueue_head(&le->wait);
 	mutex_init(&le->read_lock);
+	le->cansleep = gpiod_cansleep(desc);
 
-	/* Request a thread to read the events */
+	/* Request a thread to read the events from sleeping chips */
 	ret = request_threaded_irq(le->irq,
-			NULL,
+			lineevent_irq_handler,
 			lineevent_irq_thread,
 			irqflags,
 			le->label,
@@ -2447,6 +2482,80 @@ static int _gpiod_get_raw_value(const struct gpio_desc *desc)
 	return value;
 }
 
+/*
+ * read multiple inputs on the same chip;
+ * use the chip's get_multiple function if available;
+ * otherwise read the inputs sequentially;
+ * @mask: bit mask array; one bit per input; BITS_PER_LONG bits per word
+ *        defines which inputs are to be read
+ * @bits: bit value array; one bit per input; BITS_PER_LONG bits per word
+ *        receives the values of the inputs specified by mask
+ */
+static int gpio_chip_get_multiple(struct gpio_chip *chip,
+				  unsigned long *mask, unsigned long *bits)
+{
+	unsigned int i;
+	int value;
+
+	if (chip->get_multiple)
+		return chip->get_multiple(chip, mask, bits);
+
+	if (!chip->get)
+		return -EIO;
+
+	for_each_set_bit(i, mask, chip->ngpio) {
+		value = chip->get(chip, i);
+		if (value < 0)
+			return value;
+		if (value)
+			__set_bit(i, bits);
+		else
+			__clear_bit(i, bits);
+	}
+	return 0;
+}
+
+int gpiod_get_array_value_complex(bool raw, bool can_sleep,
+				  unsigned int array_size,
+				  struct gpio_desc **desc_array,
+				  int *value_array)
+{
+	int i = 0;
+
+	while (i < array_size) {
+		struct gpio_chip *chip = desc_array[i]->gdev->chip;
+		unsigned long mask[BITS_TO_LONGS(chip->ngpio)];
+		unsigned long bits[BITS_TO_LONGS(chip->ngpio)];
+		int first, j, ret;
+
+		if (!can_sleep)
+			WARN_ON(chip->can_sleep);
+
+		memset(mask, 0, sizeof(mask));
+		first = i;
+		do {
+			__set_bit(gpio_chip_hwgpio(desc_array[i]), mask);
+			i++;
+		} while ((i < array_size) &&
+			 (desc_array[i]->gdev->chip == chip));
+
+		ret = gpio_chip_get_multiple(chip, mask, bits);
+		if (ret)
+			return ret;
+
+		for (j = first; j < i; j++) {
+			const struct gpio_desc *desc = desc_array[j];
+			int value = test_bit(gpio_chip_hwgpio(desc), bits);
+
+			if (!raw && test_bit(FLAG_ACTIVE_LOW, &desc->flags))
+				value = !value;
+			value_array[j] = value;
+			trace_gpio_value(desc_to_gpio(desc), 1, value);
+		}
+	}
+	return 0;
+}
+
 /**
  * gpiod_get_raw_value() - return a gpio's raw value
  * @desc: gpio whose value will be returned
@@ -2636,6 +2745,51 @@ void gpiod_set_array_value_complex(bool raw, bool can_sleep,
 	}
 }
 
+/**
+ * gpiod_get_raw_array_value() - read raw values from an array of GPIOs
+ * @array_size: number of elements in the descriptor / value arrays
+ * @desc_array: array of GPIO descriptors whose values will be read
+ * @value_array: array to store the read values
+ *
+ * Read the raw values of the GPIOs, i.e. the values of the physical lines
+ * without regard for their ACTIVE_LOW status.  Return 0 in case of success,
+ * else an error code.
+ *
+ * This function should be called from contexts where we cannot sleep,
+ * and it will complain if the GPIO chip functions potentially sleep.
+ */
+int gpiod_get_raw_array_value(unsigned int array_size,
+			      struct gpio_desc **desc_array, int *value_array)
+{
+	if (!desc_array)
+		return -EINVAL;
+	return gpiod_get_array_value_complex(true, false, array_size,
+					     desc_array, value_array);
+}
+EXPORT_SYMBOL_GPL(gpiod_get_raw_array_value);
+
+/**
+ * gpiod_get_array_value() - read values from an array of GPIOs
+ * @array_size: number of elements in the descriptor / value arrays
+ * @desc_array: array of GPIO descriptors whose values will be read
+ * @value_array: array to store the read values
+ *
+ * Read the logical values of the GPIOs, i.e. taking their ACTIVE_LOW status
+ * into account.  Return 0 in case of success, else an error code.
+ *
+ * This function should be called from contexts where we cannot sleep,
+ * and it will complain if the GPIO chip functions potentially sleep.
+ */
+int gpiod_get_array_value(unsigned int array_size,
+			  struct gpio_desc **desc_array, int *value_array)
+{
+	if (!desc_array)
+		return -EINVAL;
+	return gpiod_get_array_value_complex(false, false, array_size,
+					     desc_array, value_array);
+}
+EXPORT_SYMBOL_GPL(gpiod_get_array_value);
+
 /**
  * gpiod_set_raw_value() - assign a gpio's raw value
  * @desc: gpio whose value will be assigned
@@ -2951,6 +3105,53 @@ void gpiod_set_value_cansleep(struct gpio_desc *desc, int value)
 }
 EXPORT_SYMBOL_GPL(gpiod_set_value_cansleep);
 
+/**
+ * gpiod_get_raw_array_value_cansleep() - read raw values from array of GPIOs
+ * @array_size: number of elements in the descriptor / value arrays
+ * @desc_array: array of GPIO descriptors whose values will be read
+ * @value_array: array to store the read values
+ *
+ * Read the raw values of the GPIOs, i.e. the values of the physical lines
+ * without regard for their ACTIVE_LOW status.  Return 0 in case of success,
+ * else an error code.
+ *
+ * This function is to be called from contexts that can sleep.
+ */
+int gpiod_get_raw_array_value_cansleep(unsigned int array_size,
+				       struct gpio_desc **desc_array,
+				       int *value_array)
+{
+	might_sleep_if(extra_checks);
+	if (!desc_array)
+		return -EINVAL;
+	return gpiod_get_array_value_complex(true, true, array_size,
+					     desc_array, value_array);
+}
+EXPORT_SYMBOL_GPL(gpiod_get_raw_array_value_cansleep);
+
+/**
+ * gpiod_get_array_value_cansleep() - read values from an array of GPIOs
+ * @array_size: number of elements in the descriptor / value arrays
+ * @desc_array: array of GPIO descriptors whose values will be read
+ * @value_array: array to store the read values
+ *
+ * Read the logical values of the GPIOs, i.e. taking their ACTIVE_LOW status
+ * into account.  Return 0 in case of success, else an error code.
+ *
+ * This function is to be called from contexts that can sleep.
+ */
+int gpiod_get_array_value_cansleep(unsigned int array_size,
+				   struct gpio_desc **desc_array,
+				   int *value_array)
+{
+	might_sleep_if(extra_checks);
+	if (!desc_array)
+		return -EINVAL;
+	return gpiod_get_array_value_complex(false, true, array_size,
+					     desc_array, value_array);
+}
+EXPORT_SYMBOL_GPL(gpiod_get_array_value_cansleep);
+
 /**
  * gpiod_set_raw_array_value_cansleep() - assign values to an array of GPIOs
  * @array_size: number of elements in the descriptor / value arrays
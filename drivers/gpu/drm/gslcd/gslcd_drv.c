@@ -0,0 +1,647 @@
+/*
+ * Gameslab LCD controller DRM/KMS driver
+ *
+ * Author: Craig Bishop
+ *         craig@craigjb.com
+ *
+ * 2017 (c) Craig Bishop
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+/*
+ * The LCD core scans out a primary framebuffer to a fixed 800x480 panel,
+ * so the pipeline maps onto the simple KMS helpers, with the overlay and
+ * cursor layers added as extra planes on its crtc. Buffers come from the
+ * CMA GEM helpers and fbdev emulation from the CMA fb helpers.
+ *
+ * The scanout registers are not double-buffered in hardware. Each commit
+ * queues its register writes, and the vblank interrupt latches them all
+ * at once and then completes the commit's vblank event.
+ *
+ * Optionally the primary surface is fed by a VDMA instead, gslcd_vdma.c.
+ *
+ * A core with a gamma LUT exposes it as the crtc's GAMMA_LUT property.
+ * The table is written as soon as the commit runs, so the frame being
+ * scanned out at that moment may show the old and the new table.
+ */
+
+#include <linux/module.h>
+#include <linux/interrupt.h>
+#include <linux/of_device.h>
+#include <linux/platform_device.h>
+
+#include <drm/drmP.h>
+#include <drm/drm_atomic.h>
+#include <drm/drm_atomic_helper.h>
+#include <drm/drm_crtc.h>
+#include <drm/drm_crtc_helper.h>
+#include <drm/drm_fb_helper.h>
+#include <drm/drm_fb_cma_helper.h>
+#include <drm/drm_gem_cma_helper.h>
+
+#include "gslcd_drv.h"
+
+#define DRIVER_NAME	"gslcd"
+
+static const uint32_t gslcd_formats[] = {
+	DRM_FORMAT_RGB888,
+	DRM_FORMAT_RGB565,
+	DRM_FORMAT_XRGB8888,
+};
+
+/* 800x480 @ 60 Hz */
+static const struct drm_display_mode gslcd_mode = {
+	DRM_MODE("800x480", DRM_MODE_TYPE_DRIVER | DRM_MODE_TYPE_PREFERRED,
+		 33260, GSLCD_XRES, 840, 968, 1056, 0,
+		 GSLCD_YRES, 490, 492, 525, 0,
+		 DRM_MODE_FLAG_NHSYNC | DRM_MODE_FLAG_NVSYNC),
+	.width_mm = GSLCD_WIDTH_MM,
+	.height_mm = GSLCD_HEIGHT_MM,
+};
+
+static struct gslcd_drm_private *
+drm_pipe_to_gslcd_drm_private(struct drm_simple_display_pipe *pipe)
+{
+	return container_of(pipe, struct gslcd_drm_private, pipe);
+}
+
+/* ---------------------------------------------------------------------
+ * Queued register writes
+ */
+
+void gslcd_queue_reg(struct gslcd_drm_private *priv, u32 offset, u32 val)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	priv->queued[offset] = val;
+	__set_bit(offset, &priv->queued_mask);
+	spin_unlock_irqrestore(&priv->lock, flags);
+}
+
+/* Called with priv->lock held */
+static void gslcd_latch_regs(struct gslcd_drm_private *priv)
+{
+	unsigned int reg;
+
+	for_each_set_bit(reg, &priv->queued_mask, GSLCD_NUM_REGS)
+		gslcd_out32(priv, reg, priv->queued[reg]);
+	priv->queued_mask = 0;
+}
+
+static void gslcd_begin_update(struct gslcd_drm_private *priv)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	priv->updating = true;
+	spin_unlock_irqrestore(&priv->lock, flags);
+}
+
+/*
+ * Lets the vblank irq latch the commit's writes and arms its event. An
+ * irq landing in between latches the writes a frame before the event
+ * completes, never the other way around.
+ */
+static void gslcd_end_update(struct gslcd_drm_private *priv)
+{
+	struct drm_crtc *crtc = &priv->pipe.crtc;
+	struct drm_pending_vblank_event *event;
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	priv->updating = false;
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	event = crtc->state->event;
+	if (event) {
+		crtc->state->event = NULL;
+
+		spin_lock_irqsave(&crtc->dev->event_lock, flags);
+		if (crtc->state->active && drm_crtc_vblank_get(crtc) == 0)
+			drm_crtc_arm_vblank_event(crtc, event);
+		else
+			drm_crtc_send_vblank_event(crtc, event);
+		spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
+	}
+}
+
+/* ---------------------------------------------------------------------
+ * Connector, the panel is hardwired to the controller
+ */
+
+static int gslcd_connector_get_modes(struct drm_connector *connector)
+{
+	struct drm_display_mode *mode;
+
+	mode = drm_mode_duplicate(connector->dev, &gslcd_mode);
+	if (!mode)
+		return 0;
+
+	drm_mode_probed_add(connector, mode);
+
+	connector->display_info.width_mm = GSLCD_WIDTH_MM;
+	connector->display_info.height_mm = GSLCD_HEIGHT_MM;
+
+	return 1;
+}
+
+static const struct drm_connector_helper_funcs gslcd_connector_helper_funcs = {
+	.get_modes = gslcd_connector_get_modes,
+};
+
+static enum drm_connector_status
+gslcd_connector_detect(struct drm_connector *connector, bool force)
+{
+	return connector_status_connected;
+}
+
+static void gslcd_connector_destroy(struct drm_connector *connector)
+{
+	drm_connector_unregister(connector);
+	drm_connector_cleanup(connector);
+}
+
+static const struct drm_connector_funcs gslcd_connector_funcs = {
+	.dpms			= drm_atomic_helper_connector_dpms,
+	.detect			= gslcd_connector_detect,
+	.fill_modes		= drm_helper_probe_single_connector_modes,
+	.destroy		= gslcd_connector_destroy,
+	.reset			= drm_atomic_helper_connector_reset,
+	.atomic_duplicate_state	= drm_atomic_helper_connector_duplicate_state,
+	.atomic_destroy_state	= drm_atomic_helper_connector_destroy_state,
+};
+
+/* ---------------------------------------------------------------------
+ * Display pipe
+ */
+
+static dma_addr_t gslcd_fb_paddr(struct drm_plane_state *state)
+{
+	struct drm_framebuffer *fb = state->fb;
+	struct drm_gem_cma_object *gem = drm_fb_cma_get_gem_obj(fb, 0);
+
+	return gem->paddr + fb->offsets[0] +
+		state->src_y / (1 << 16) * fb->pitches[0] +
+		state->src_x / (1 << 16) * fb->format->cpp[0];
+}
+
+u32 gslcd_pix_fmt(struct drm_framebuffer *fb)
+{
+	switch (fb->format->format) {
+	case DRM_FORMAT_RGB565:
+		return GSLCD_PIX_FMT_RGB565;
+	case DRM_FORMAT_XRGB8888:
+		return GSLCD_PIX_FMT_XRGB8888;
+	case DRM_FORMAT_ARGB8888:
+		return GSLCD_PIX_FMT_ARGB8888;
+	default:
+		return GSLCD_PIX_FMT_RGB888;
+	}
+}
+
+static void gslcd_load_gamma(struct gslcd_drm_private *priv,
+			     struct drm_crtc_state *crtc_state)
+{
+	struct drm_color_lut *lut;
+	unsigned int i;
+
+	if (!crtc_state->gamma_lut) {
+		gslcd_out32(priv, GSLCD_REG_LUT_CTRL, 0);
+		return;
+	}
+
+	lut = crtc_state->gamma_lut->data;
+	for (i = 0; i < GSLCD_LUT_SIZE; i++)
+		gslcd_out32(priv, GSLCD_REG_LUT(i),
+			    (lut[i].red >> 8) << 16 |
+			    (lut[i].green >> 8) << 8 |
+			    lut[i].blue >> 8);
+	gslcd_out32(priv, GSLCD_REG_LUT_CTRL, GSLCD_LUT_CTRL_EN);
+}
+
+static int gslcd_pipe_check(struct drm_simple_display_pipe *pipe,
+			    struct drm_plane_state *plane_state,
+			    struct drm_crtc_state *crtc_state)
+{
+	struct gslcd_drm_private *priv = drm_pipe_to_gslcd_drm_private(pipe);
+	struct drm_framebuffer *fb = plane_state->fb;
+
+	/* The LCD core fetches whole lines back to back, the VDMA strides */
+	if (fb && !priv->vdma &&
+	    fb->pitches[0] != fb->width * fb->format->cpp[0])
+		return -EINVAL;
+
+	if (crtc_state->gamma_lut &&
+	    crtc_state->gamma_lut->length !=
+	    GSLCD_LUT_SIZE * sizeof(struct drm_color_lut))
+		return -EINVAL;
+
+	return 0;
+}
+
+static void gslcd_pipe_enable(struct drm_simple_display_pipe *pipe,
+			      struct drm_crtc_state *crtc_state)
+{
+	struct gslcd_drm_private *priv = drm_pipe_to_gslcd_drm_private(pipe);
+	struct drm_plane_state *plane_state = pipe->plane.state;
+	unsigned long flags;
+
+	if (priv->vdma)
+		gslcd_vdma_enable(priv);
+
+	if (priv->has_lut)
+		gslcd_load_gamma(priv, crtc_state);
+
+	if (plane_state->fb) {
+		gslcd_out32(priv, GSLCD_REG_PIX_FMT,
+			    gslcd_pix_fmt(plane_state->fb));
+		if (priv->vdma)
+			gslcd_vdma_flip(priv, gslcd_fb_paddr(plane_state),
+					plane_state->fb);
+		else
+			gslcd_out32(priv, GSLCD_REG_FB_PTR,
+				    gslcd_fb_paddr(plane_state));
+	}
+
+	/* Layer changes made while the crtc was off */
+	spin_lock_irqsave(&priv->lock, flags);
+	gslcd_latch_regs(priv);
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	gslcd_out32(priv, GSLCD_REG_IRQ_STATUS, GSLCD_IRQ_VBLANK);
+	gslcd_out32(priv, GSLCD_REG_IRQ_EN, GSLCD_IRQ_VBLANK);
+	gslcd_out32(priv, GSLCD_REG_EN, 0x1);
+
+	drm_crtc_vblank_on(&pipe->crtc);
+}
+
+static void gslcd_pipe_disable(struct drm_simple_display_pipe *pipe)
+{
+	struct gslcd_drm_private *priv = drm_pipe_to_gslcd_drm_private(pipe);
+
+	drm_crtc_vblank_off(&pipe->crtc);
+
+	gslcd_out32(priv, GSLCD_REG_EN, 0x0);
+	gslcd_out32(priv, GSLCD_REG_IRQ_EN, 0);
+
+	if (priv->vdma)
+		gslcd_vdma_disable(priv);
+}
+
+static void gslcd_pipe_update(struct drm_simple_display_pipe *pipe,
+			      struct drm_plane_state *old_state)
+{
+	struct gslcd_drm_private *priv = drm_pipe_to_gslcd_drm_private(pipe);
+	struct drm_plane_state *state = pipe->plane.state;
+	struct drm_crtc_state *crtc_state = pipe->crtc.state;
+
+	/* A modeset loads the table in gslcd_pipe_enable() */
+	if (priv->has_lut && crtc_state->active &&
+	    crtc_state->color_mgmt_changed &&
+	    !drm_atomic_crtc_needs_modeset(crtc_state))
+		gslcd_load_gamma(priv, crtc_state);
+
+	/*
+	 * The event is armed once all planes are queued, see commit_tail.
+	 * A VDMA takes the new frame on its own next frame boundary.
+	 */
+	if (state->fb && crtc_state->active) {
+		gslcd_queue_reg(priv, GSLCD_REG_PIX_FMT,
+				gslcd_pix_fmt(state->fb));
+		if (priv->vdma)
+			gslcd_vdma_flip(priv, gslcd_fb_paddr(state), state->fb);
+		else
+			gslcd_queue_reg(priv, GSLCD_REG_FB_PTR,
+					gslcd_fb_paddr(state));
+	}
+}
+
+static int gslcd_pipe_prepare_fb(struct drm_simple_display_pipe *pipe,
+				 struct drm_plane_state *plane_state)
+{
+	return drm_fb_cma_prepare_fb(&pipe->plane, plane_state);
+}
+
+static const struct drm_simple_display_pipe_funcs gslcd_pipe_funcs = {
+	.check		= gslcd_pipe_check,
+	.enable		= gslcd_pipe_enable,
+	.disable	= gslcd_pipe_disable,
+	.update		= gslcd_pipe_update,
+	.prepare_fb	= gslcd_pipe_prepare_fb,
+};
+
+/* ---------------------------------------------------------------------
+ * Vblank
+ */
+
+static irqreturn_t gslcd_irq_handler(int irq, void *data)
+{
+	struct drm_device *drm = data;
+	struct gslcd_drm_private *priv = drm->dev_private;
+	u32 status;
+
+	status = gslcd_in32(priv, GSLCD_REG_IRQ_STATUS);
+	if (!(status & GSLCD_IRQ_VBLANK))
+		return IRQ_NONE;
+
+	gslcd_out32(priv, GSLCD_REG_IRQ_STATUS, GSLCD_IRQ_VBLANK);
+
+	spin_lock(&priv->lock);
+	if (!priv->updating)
+		gslcd_latch_regs(priv);
+	spin_unlock(&priv->lock);
+
+	/* Completes the events of the commits latched above */
+	drm_crtc_handle_vblank(&priv->pipe.crtc);
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * The vblank interrupt stays unmasked while the crtc is on because it
+ * also latches flips. The DRM core just ignores it while vblank
+ * reporting is disabled.
+ */
+static int gslcd_enable_vblank(struct drm_device *drm, unsigned int crtc)
+{
+	return 0;
+}
+
+static void gslcd_disable_vblank(struct drm_device *drm, unsigned int crtc)
+{
+}
+
+/* ---------------------------------------------------------------------
+ * Device
+ */
+
+static void gslcd_output_poll_changed(struct drm_device *drm)
+{
+	struct gslcd_drm_private *priv = drm->dev_private;
+
+	drm_fbdev_cma_hotplug_event(priv->fbdev);
+}
+
+static const struct drm_mode_config_funcs gslcd_mode_config_funcs = {
+	.fb_create		= drm_fb_cma_create,
+	.output_poll_changed	= gslcd_output_poll_changed,
+	.atomic_check		= drm_atomic_helper_check,
+	.atomic_commit		= drm_atomic_helper_commit,
+};
+
+static void gslcd_atomic_commit_tail(struct drm_atomic_state *state)
+{
+	struct drm_device *drm = state->dev;
+	struct gslcd_drm_private *priv = drm->dev_private;
+
+	drm_atomic_helper_commit_modeset_disables(drm, state);
+	drm_atomic_helper_commit_modeset_enables(drm, state);
+
+	gslcd_begin_update(priv);
+	drm_atomic_helper_commit_planes(drm, state, 0);
+	gslcd_end_update(priv);
+
+	drm_atomic_helper_commit_hw_done(state);
+	drm_atomic_helper_wait_for_vblanks(drm, state);
+	drm_atomic_helper_cleanup_planes(drm, state);
+}
+
+static const struct drm_mode_config_helper_funcs gslcd_mode_config_helpers = {
+	.atomic_commit_tail	= gslcd_atomic_commit_tail,
+};
+
+static void gslcd_lastclose(struct drm_device *drm)
+{
+	struct gslcd_drm_private *priv = drm->dev_private;
+
+	drm_fbdev_cma_restore_mode(priv->fbdev);
+}
+
+DEFINE_DRM_GEM_CMA_FOPS(gslcd_fops);
+
+static struct drm_driver gslcd_driver = {
+	.driver_features	= DRIVER_GEM | DRIVER_MODESET |
+				  DRIVER_PRIME | DRIVER_ATOMIC,
+	.lastclose		= gslcd_lastclose,
+	.enable_vblank		= gslcd_enable_vblank,
+	.disable_vblank		= gslcd_disable_vblank,
+	.gem_free_object	= drm_gem_cma_free_object,
+	.gem_vm_ops		= &drm_gem_cma_vm_ops,
+	.dumb_create		= drm_gem_cma_dumb_create,
+	.dumb_map_offset	= drm_gem_cma_dumb_map_offset,
+	.dumb_destroy		= drm_gem_dumb_destroy,
+	.prime_handle_to_fd	= drm_gem_prime_handle_to_fd,
+	.prime_fd_to_handle	= drm_gem_prime_fd_to_handle,
+	.gem_prime_export	= drm_gem_prime_export,
+	.gem_prime_import	= drm_gem_prime_import,
+	.gem_prime_get_sg_table	= drm_gem_cma_prime_get_sg_table,
+	.gem_prime_import_sg_table = drm_gem_cma_prime_import_sg_table,
+	.gem_prime_vmap		= drm_gem_cma_prime_vmap,
+	.gem_prime_vunmap	= drm_gem_cma_prime_vunmap,
+	.gem_prime_mmap		= drm_gem_cma_prime_mmap,
+	.fops			= &gslcd_fops,
+	.name			= DRIVER_NAME,
+	.desc			= "Gameslab LCD controller",
+	.date			= "20170801",
+	.major			= 1,
+	.minor			= 0,
+};
+
+static int gslcd_modeset_init(struct drm_device *drm)
+{
+	struct gslcd_drm_private *priv = drm->dev_private;
+	int ret;
+
+	drm_mode_config_init(drm);
+	drm->mode_config.min_width	= GSLCD_XRES;
+	drm->mode_config.min_height	= GSLCD_YRES;
+	drm->mode_config.max_width	= GSLCD_XRES;
+	drm->mode_config.max_height	= GSLCD_YRES;
+	drm->mode_config.cursor_width	= GSLCD_CURSOR_MAX;
+	drm->mode_config.cursor_height	= GSLCD_CURSOR_MAX;
+	drm->mode_config.funcs		= &gslcd_mode_config_funcs;
+	drm->mode_config.helper_private	= &gslcd_mode_config_helpers;
+
+	drm_connector_helper_add(&priv->connector,
+				 &gslcd_connector_helper_funcs);
+	ret = drm_connector_init(drm, &priv->connector, &gslcd_connector_funcs,
+				 DRM_MODE_CONNECTOR_DPI);
+	if (ret) {
+		dev_err(drm->dev, "Cannot create connector\n");
+		goto err_config;
+	}
+
+	ret = drm_simple_display_pipe_init(drm, &priv->pipe, &gslcd_pipe_funcs,
+			gslcd_formats, ARRAY_SIZE(gslcd_formats),
+			&priv->connector);
+	if (ret) {
+		dev_err(drm->dev, "Cannot setup simple display pipe\n");
+		goto err_config;
+	}
+
+	if (priv->has_lut)
+		drm_crtc_enable_color_mgmt(&priv->pipe.crtc, 0, false,
+					   GSLCD_LUT_SIZE);
+
+	ret = gslcd_planes_init(drm);
+	if (ret) {
+		dev_err(drm->dev, "Cannot create overlay planes\n");
+		goto err_config;
+	}
+
+	drm_mode_config_reset(drm);
+
+	return 0;
+
+err_config:
+	drm_mode_config_cleanup(drm);
+	return ret;
+}
+
+static int gslcd_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct gslcd_drm_private *priv;
+	struct drm_device *drm;
+	struct resource *res;
+	int ret;
+
+	priv = devm_kzalloc(dev, sizeof(*priv), GFP_KERNEL);
+	if (!priv)
+		return -ENOMEM;
+
+	spin_lock_init(&priv->lock);
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	priv->regs = devm_ioremap_resource(dev, res);
+	if (IS_ERR(priv->regs))
+		return PTR_ERR(priv->regs);
+
+	priv->irq = platform_get_irq(pdev, 0);
+	if (priv->irq < 0) {
+		dev_err(dev, "Missing vblank irq\n");
+		return priv->irq;
+	}
+
+	/* Quiesce the controller until the first modeset */
+	gslcd_out32(priv, GSLCD_REG_IRQ_EN, 0);
+	gslcd_out32(priv, GSLCD_REG_IRQ_STATUS, GSLCD_IRQ_VBLANK);
+	gslcd_out32(priv, GSLCD_REG_EN, 0x0);
+	gslcd_out32(priv, GSLCD_REG_SOURCE, 0);
+	gslcd_out32(priv, GSLCD_REG_LAYER_CTRL(GSLCD_LAYER_OVERLAY), 0);
+	gslcd_out32(priv, GSLCD_REG_LAYER_CTRL(GSLCD_LAYER_CURSOR), 0);
+
+	priv->has_lut = of_property_read_bool(dev->of_node, "gamma-lut");
+	if (priv->has_lut)
+		gslcd_out32(priv, GSLCD_REG_LUT_CTRL, 0);
+
+	ret = dma_set_mask_and_coherent(dev, DMA_BIT_MASK(32));
+	if (ret)
+		return ret;
+
+	ret = gslcd_vdma_init(priv, dev);
+	if (ret)
+		return ret;
+
+	drm = drm_dev_alloc(&gslcd_driver, dev);
+	if (IS_ERR(drm)) {
+		gslcd_vdma_fini(priv);
+		return PTR_ERR(drm);
+	}
+
+	drm->dev_private = priv;
+	platform_set_drvdata(pdev, drm);
+
+	ret = drm_vblank_init(drm, 1);
+	if (ret) {
+		dev_err(dev, "Failed to initialise vblank\n");
+		goto err_free;
+	}
+
+	ret = gslcd_modeset_init(drm);
+	if (ret)
+		goto err_vblank;
+
+	ret = devm_request_irq(dev, priv->irq, gslcd_irq_handler, 0,
+			       DRIVER_NAME, drm);
+	if (ret) {
+		dev_err(dev, "Failed to request vblank irq\n");
+		goto err_modeset;
+	}
+
+	ret = drm_dev_register(drm, 0);
+	if (ret)
+		goto err_irq;
+
+	priv->fbdev = drm_fbdev_cma_init(drm, 24,
+					 drm->mode_config.num_connector);
+	if (IS_ERR(priv->fbdev)) {
+		dev_warn(dev, "Failed to init fbdev emulation\n");
+		priv->fbdev = NULL;
+	}
+
+	drm_kms_helper_poll_init(drm);
+
+	return 0;
+
+err_irq:
+	devm_free_irq(dev, priv->irq, drm);
+err_modeset:
+	drm_mode_config_cleanup(drm);
+err_vblank:
+	drm_vblank_cleanup(drm);
+err_free:
+	drm_dev_unref(drm);
+	gslcd_vdma_fini(priv);
+
+	return ret;
+}
+
+static int gslcd_remove(struct platform_device *pdev)
+{
+	struct drm_device *drm = platform_get_drvdata(pdev);
+	struct gslcd_drm_private *priv = drm->dev_private;
+
+	drm_dev_unregister(drm);
+
+	if (priv->fbdev)
+		drm_fbdev_cma_fini(priv->fbdev);
+
+	drm_kms_helper_poll_fini(drm);
+	drm_atomic_helper_shutdown(drm);
+	drm_mode_config_cleanup(drm);
+
+	gslcd_out32(priv, GSLCD_REG_IRQ_EN, 0);
+	devm_free_irq(&pdev->dev, priv->irq, drm);
+
+	drm_vblank_cleanup(drm);
+	drm_dev_unref(drm);
+	gslcd_vdma_fini(priv);
+
+	return 0;
+}
+
+static const struct of_device_id gslcd_of_match[] = {
+	{ .compatible = "gslcd", },
+	{ /* sentinel */ }
+};
+MODULE_DEVICE_TABLE(of, gslcd_of_match);
+
+static struct platform_driver gslcd_platform_driver = {
+	.probe		= gslcd_probe,
+	.remove		= gslcd_remove,
+	.driver	= {
+		.name		= DRIVER_NAME,
+		.of_match_table	= gslcd_of_match,
+	},
+};
+
+module_platform_driver(gslcd_platform_driver);
+
+MODULE_AUTHOR("Craig Bishop <craig@craigjb.com>");
+MODULE_DESCRIPTION("Gameslab LCD controller DRM/KMS driver");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,87 @@
+/*
+ * Gameslab LCD controller DRM/KMS driver
+ *
+ * 2017 (c) Craig Bishop
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+#ifndef __GSLCD_DRV_H__
+#define __GSLCD_DRV_H__
+
+#include <linux/io.h>
+#include <linux/spinlock.h>
+
+#include <drm/drm_simple_kms_helper.h>
+
+#include "gslcd_regs.h"
+
+struct gslcd_plane {
+	struct drm_plane		base;
+	unsigned int			layer;
+};
+
+struct gslcd_drm_private {
+	void __iomem			*regs;
+	int				irq;
+
+	struct drm_simple_display_pipe	pipe;
+	struct gslcd_plane		layers[GSLCD_NUM_LAYERS];
+	struct drm_property		*alpha_prop;
+	struct drm_connector		connector;
+	struct drm_fbdev_cma		*fbdev;
+	struct dma_chan			*vdma;	/* scanout, if any */
+	bool				has_lut; /* gamma LUT in the core */
+
+	/*
+	 * None of the scanout registers are double-buffered in hardware.
+	 * Writes are queued here and latched by the vblank irq, which
+	 * holds off while a commit is still queueing its planes.
+	 */
+	spinlock_t			lock;	/* protects the queued writes */
+	u32				queued[GSLCD_NUM_REGS];
+	unsigned long			queued_mask;
+	bool				updating;
+};
+
+static inline void gslcd_out32(struct gslcd_drm_private *priv, u32 offset,
+			       u32 val)
+{
+	iowrite32(val, priv->regs + (offset << 2));
+}
+
+static inline u32 gslcd_in32(struct gslcd_drm_private *priv, u32 offset)
+{
+	return ioread32(priv->regs + (offset << 2));
+}
+
+void gslcd_queue_reg(struct gslcd_drm_private *priv, u32 offset, u32 val);
+u32 gslcd_pix_fmt(struct drm_framebuffer *fb);
+
+int gslcd_planes_init(struct drm_device *drm);
+
+#ifdef CONFIG_DRM_GSLCD_VDMA
+int gslcd_vdma_init(struct gslcd_drm_private *priv, struct device *dev);
+void gslcd_vdma_fini(struct gslcd_drm_private *priv);
+void gslcd_vdma_flip(struct gslcd_drm_private *priv, dma_addr_t paddr,
+		     struct drm_framebuffer *fb);
+void gslcd_vdma_enable(struct gslcd_drm_private *priv);
+void gslcd_vdma_disable(struct gslcd_drm_private *priv);
+#else
+static inline int gslcd_vdma_init(struct gslcd_drm_private *priv,
+				  struct device *dev)
+{
+	return 0;
+}
+
+static inline void gslcd_vdma_fini(struct gslcd_drm_private *priv) { }
+static inline void gslcd_vdma_flip(struct gslcd_drm_private *priv,
+				   dma_addr_t paddr,
+				   struct drm_framebuffer *fb) { }
+static inline void gslcd_vdma_enable(struct gslcd_drm_private *priv) { }
+static inline void gslcd_vdma_disable(struct gslcd_drm_private *priv) { }
+#endif
+
+#endif /* __GSLCD_DRV_H__ */
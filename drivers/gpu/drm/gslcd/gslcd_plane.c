@@ -0,0 +1,271 @@
+/*
+ * Gameslab LCD controller overlay and cursor planes
+ *
+ * 2017 (c) Craig Bishop
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+/*
+ * Besides the primary surface the LCD core fetches two small layers and
+ * blends them on the fly, so a HUD or a cursor can move and change
+ * without redrawing the base frame. Layers don't scale but can be
+ * positioned anywhere, partially off screen included, and blend by
+ * per-pixel alpha on top of a plane-wide "alpha" property.
+ */
+
+#include <linux/slab.h>
+
+#include <drm/drmP.h>
+#include <drm/drm_atomic.h>
+#include <drm/drm_atomic_helper.h>
+#include <drm/drm_fb_cma_helper.h>
+#include <drm/drm_gem_cma_helper.h>
+#include <drm/drm_plane_helper.h>
+
+#include "gslcd_drv.h"
+
+struct gslcd_plane_state {
+	struct drm_plane_state		base;
+	unsigned int			alpha;
+};
+
+static const uint32_t gslcd_overlay_formats[] = {
+	DRM_FORMAT_ARGB8888,
+	DRM_FORMAT_XRGB8888,
+	DRM_FORMAT_RGB565,
+};
+
+static const uint32_t gslcd_cursor_formats[] = {
+	DRM_FORMAT_ARGB8888,
+};
+
+static inline struct gslcd_plane *to_gslcd_plane(struct drm_plane *plane)
+{
+	return container_of(plane, struct gslcd_plane, base);
+}
+
+static inline struct gslcd_plane_state *
+to_gslcd_plane_state(struct drm_plane_state *state)
+{
+	return container_of(state, struct gslcd_plane_state, base);
+}
+
+static int gslcd_plane_atomic_check(struct drm_plane *plane,
+				    struct drm_plane_state *state)
+{
+	struct drm_crtc_state *crtc_state;
+	struct drm_rect clip = { 0 };
+	int ret;
+
+	if (!state->crtc)
+		return 0;
+
+	crtc_state = drm_atomic_get_existing_crtc_state(state->state,
+							state->crtc);
+	if (WARN_ON(!crtc_state))
+		return -EINVAL;
+
+	if (crtc_state->enable) {
+		clip.x2 = crtc_state->adjusted_mode.hdisplay;
+		clip.y2 = crtc_state->adjusted_mode.vdisplay;
+	}
+
+	ret = drm_plane_helper_check_state(state, &clip,
+					   DRM_PLANE_HELPER_NO_SCALING,
+					   DRM_PLANE_HELPER_NO_SCALING,
+					   true, true);
+	if (ret)
+		return ret;
+
+	if (plane->type == DRM_PLANE_TYPE_CURSOR &&
+	    (state->crtc_w > GSLCD_CURSOR_MAX ||
+	     state->crtc_h > GSLCD_CURSOR_MAX))
+		return -EINVAL;
+
+	return 0;
+}
+
+static void gslcd_plane_atomic_update(struct drm_plane *plane,
+				      struct drm_plane_state *old_state)
+{
+	struct gslcd_drm_private *priv = plane->dev->dev_private;
+	struct drm_plane_state *state = plane->state;
+	struct drm_framebuffer *fb = state->fb;
+	unsigned int n = to_gslcd_plane(plane)->layer;
+	struct drm_gem_cma_object *gem;
+	dma_addr_t paddr;
+	u32 ctrl;
+
+	if (!state->visible) {
+		gslcd_queue_reg(priv, GSLCD_REG_LAYER_CTRL(n), 0);
+		return;
+	}
+
+	/* src is the part left after clipping to the screen */
+	gem = drm_fb_cma_get_gem_obj(fb, 0);
+	paddr = gem->paddr + fb->offsets[0] +
+		(state->src.y1 >> 16) * fb->pitches[0] +
+		(state->src.x1 >> 16) * fb->format->cpp[0];
+
+	ctrl = GSLCD_LAYER_CTRL_EN |
+	       GSLCD_LAYER_CTRL_FMT(gslcd_pix_fmt(fb)) |
+	       GSLCD_LAYER_CTRL_ALPHA(to_gslcd_plane_state(state)->alpha);
+
+	gslcd_queue_reg(priv, GSLCD_REG_LAYER_PTR(n), paddr);
+	gslcd_queue_reg(priv, GSLCD_REG_LAYER_PITCH(n), fb->pitches[0]);
+	gslcd_queue_reg(priv, GSLCD_REG_LAYER_POS(n),
+			state->dst.y1 << 16 | state->dst.x1);
+	gslcd_queue_reg(priv, GSLCD_REG_LAYER_SIZE(n),
+			drm_rect_height(&state->dst) << 16 |
+			drm_rect_width(&state->dst));
+	gslcd_queue_reg(priv, GSLCD_REG_LAYER_CTRL(n), ctrl);
+}
+
+static void gslcd_plane_atomic_disable(struct drm_plane *plane,
+				       struct drm_plane_state *old_state)
+{
+	struct gslcd_drm_private *priv = plane->dev->dev_private;
+	unsigned int n = to_gslcd_plane(plane)->layer;
+
+	gslcd_queue_reg(priv, GSLCD_REG_LAYER_CTRL(n), 0);
+}
+
+static const struct drm_plane_helper_funcs gslcd_plane_helper_funcs = {
+	.prepare_fb	= drm_fb_cma_prepare_fb,
+	.atomic_check	= gslcd_plane_atomic_check,
+	.atomic_update	= gslcd_plane_atomic_update,
+	.atomic_disable	= gslcd_plane_atomic_disable,
+};
+
+static void gslcd_plane_reset(struct drm_plane *plane)
+{
+	struct gslcd_plane_state *state;
+
+	if (plane->state) {
+		__drm_atomic_helper_plane_destroy_state(plane->state);
+		kfree(to_gslcd_plane_state(plane->state));
+		plane->state = NULL;
+	}
+
+	state = kzalloc(sizeof(*state), GFP_KERNEL);
+	if (!state)
+		return;
+
+	state->base.plane = plane;
+	state->base.rotation = DRM_ROTATE_0;
+	state->alpha = 255;
+	plane->state = &state->base;
+}
+
+static struct drm_plane_state *
+gslcd_plane_duplicate_state(struct drm_plane *plane)
+{
+	struct gslcd_plane_state *state;
+
+	if (WARN_ON(!plane->state))
+		return NULL;
+
+	state = kmalloc(sizeof(*state), GFP_KERNEL);
+	if (!state)
+		return NULL;
+
+	__drm_atomic_helper_plane_duplicate_state(plane, &state->base);
+	state->alpha = to_gslcd_plane_state(plane->state)->alpha;
+
+	return &state->base;
+}
+
+static void gslcd_plane_destroy_state(struct drm_plane *plane,
+				      struct drm_plane_state *state)
+{
+	__drm_atomic_helper_plane_destroy_state(state);
+	kfree(to_gslcd_plane_state(state));
+}
+
+static int gslcd_plane_set_property(struct drm_plane *plane,
+				    struct drm_plane_state *state,
+				    struct drm_property *property,
+				    uint64_t val)
+{
+	struct gslcd_drm_private *priv = plane->dev->dev_private;
+
+	if (property != priv->alpha_prop)
+		return -EINVAL;
+
+	to_gslcd_plane_state(state)->alpha = val;
+	return 0;
+}
+
+static int gslcd_plane_get_property(struct drm_plane *plane,
+				    const struct drm_plane_state *state,
+				    struct drm_property *property,
+				    uint64_t *val)
+{
+	struct gslcd_drm_private *priv = plane->dev->dev_private;
+
+	if (property != priv->alpha_prop)
+		return -EINVAL;
+
+	*val = container_of(state, struct gslcd_plane_state, base)->alpha;
+	return 0;
+}
+
+static const struct drm_plane_funcs gslcd_plane_funcs = {
+	.update_plane		= drm_atomic_helper_update_plane,
+	.disable_plane		= drm_atomic_helper_disable_plane,
+	.destroy		= drm_plane_cleanup,
+	.set_property		= drm_atomic_helper_plane_set_property,
+	.reset			= gslcd_plane_reset,
+	.atomic_duplicate_state	= gslcd_plane_duplicate_state,
+	.atomic_destroy_state	= gslcd_plane_destroy_state,
+	.atomic_set_property	= gslcd_plane_set_property,
+	.atomic_get_property	= gslcd_plane_get_property,
+};
+
+int gslcd_planes_init(struct drm_device *drm)
+{
+	struct gslcd_drm_private *priv = drm->dev_private;
+	struct drm_crtc *crtc = &priv->pipe.crtc;
+	struct gslcd_plane *overlay = &priv->layers[GSLCD_LAYER_OVERLAY];
+	struct gslcd_plane *cursor = &priv->layers[GSLCD_LAYER_CURSOR];
+	int ret;
+
+	priv->alpha_prop = drm_property_create_range(drm, 0, "alpha", 0, 255);
+	if (!priv->alpha_prop)
+		return -ENOMEM;
+
+	overlay->layer = GSLCD_LAYER_OVERLAY;
+	ret = drm_universal_plane_init(drm, &overlay->base,
+			drm_crtc_mask(crtc), &gslcd_plane_funcs,
+			gslcd_overlay_formats,
+			ARRAY_SIZE(gslcd_overlay_formats),
+			DRM_PLANE_TYPE_OVERLAY, NULL);
+	if (ret)
+		return ret;
+
+	drm_plane_helper_add(&overlay->base, &gslcd_plane_helper_funcs);
+	drm_object_attach_property(&overlay->base.base, priv->alpha_prop, 255);
+
+	cursor->layer = GSLCD_LAYER_CURSOR;
+	ret = drm_universal_plane_init(drm, &cursor->base,
+			drm_crtc_mask(crtc), &gslcd_plane_funcs,
+			gslcd_cursor_formats,
+			ARRAY_SIZE(gslcd_cursor_formats),
+			DRM_PLANE_TYPE_CURSOR, NULL);
+	if (ret)
+		return ret;
+
+	drm_plane_helper_add(&cursor->base, &gslcd_plane_helper_funcs);
+	drm_object_attach_property(&cursor->base.base, priv->alpha_prop, 255);
+
+	/*
+	 * The simple pipe creates its crtc without a cursor, hook ours up
+	 * so the legacy cursor ioctls work too.
+	 */
+	crtc->cursor = &cursor->base;
+
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Gameslab LCD controller register definitions
+ *
+ * 2017 (c) Craig Bishop
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+#ifndef __GSLCD_REGS_H__
+#define __GSLCD_REGS_H__
+
+/*
+ * Register offsets, in 32-bit words
+ */
+#define GSLCD_REG_EN		0
+#define GSLCD_REG_FB_PTR	1
+#define GSLCD_REG_IRQ_EN	2
+#define GSLCD_REG_IRQ_STATUS	3	/* write 1 to clear */
+#define GSLCD_REG_PIX_FMT	4
+#define GSLCD_REG_SOURCE	6
+#define GSLCD_REG_LUT_CTRL	7
+
+#define GSLCD_PIX_FMT_RGB888	0	/* packed 24bpp */
+#define GSLCD_PIX_FMT_RGB565	1
+#define GSLCD_PIX_FMT_XRGB8888	2
+#define GSLCD_PIX_FMT_ARGB8888	3	/* layers only */
+
+#define GSLCD_IRQ_VBLANK	BIT(0)
+
+/* Take the primary surface from the AXI4-Stream input, not FB_PTR */
+#define GSLCD_SOURCE_STREAM	BIT(0)
+
+/*
+ * Cores built with a gamma LUT map each 8-bit component of the blended
+ * output through a table of 0x00rrggbb words. It is not double-buffered.
+ */
+#define GSLCD_LUT_CTRL_EN	BIT(0)
+#define GSLCD_LUT_SIZE		256
+#define GSLCD_REG_LUT(n)	(256 + (n))
+
+/*
+ * Layers are blended over the primary surface in index order, layer 0
+ * is the overlay and layer 1 the cursor. Each has its own block of
+ * registers after the primary ones.
+ */
+#define GSLCD_NUM_LAYERS	2
+#define GSLCD_LAYER_BASE(n)	(8 + (n) * 8)
+
+#define GSLCD_REG_LAYER_CTRL(n)		(GSLCD_LAYER_BASE(n) + 0)
+#define GSLCD_REG_LAYER_PTR(n)		(GSLCD_LAYER_BASE(n) + 1)
+#define GSLCD_REG_LAYER_POS(n)		(GSLCD_LAYER_BASE(n) + 2) /* y << 16 | x */
+#define GSLCD_REG_LAYER_SIZE(n)		(GSLCD_LAYER_BASE(n) + 3) /* h << 16 | w */
+#define GSLCD_REG_LAYER_PITCH(n)	(GSLCD_LAYER_BASE(n) + 4) /* bytes */
+
+#define GSLCD_NUM_REGS		GSLCD_LAYER_BASE(GSLCD_NUM_LAYERS)
+
+#define GSLCD_LAYER_CTRL_EN		BIT(0)
+#define GSLCD_LAYER_CTRL_FMT(x)		((x) << 4)
+#define GSLCD_LAYER_CTRL_ALPHA(x)	((x) << 8)	/* plane alpha, 0-255 */
+
+#define GSLCD_LAYER_OVERLAY	0
+#define GSLCD_LAYER_CURSOR	1
+
+#define GSLCD_CURSOR_MAX	64
+
+/*
+ * The panel is a fixed 800x480, 108x65 mm
+ */
+#define GSLCD_XRES		800
+#define GSLCD_YRES		480
+#define GSLCD_WIDTH_MM		108
+#define GSLCD_HEIGHT_MM		65
+
+#endif /* __GSLCD_REGS_H__ */
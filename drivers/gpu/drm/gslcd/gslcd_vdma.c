@@ -0,0 +1,98 @@
+/*
+ * Gameslab LCD controller VDMA scanout
+ *
+ * 2017 (c) Craig Bishop
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+/*
+ * Instead of fetching the primary surface itself the LCD core can take it
+ * as an AXI4-Stream from a VDMA MM2S channel. The VDMA cycles through its
+ * frame stores in direct register mode and parks on the last one
+ * submitted, so a flip is just another interleaved descriptor: it never
+ * waits for scanout, and the switch happens on a frame boundary. Genlock
+ * keeps the read side off a store that a genlocked writer is filling.
+ */
+
+#include <linux/dmaengine.h>
+#include <linux/dma/xilinx_dma.h>
+#include <linux/slab.h>
+
+#include <drm/drmP.h>
+
+#include "gslcd_drv.h"
+
+int gslcd_vdma_init(struct gslcd_drm_private *priv, struct device *dev)
+{
+	struct dma_chan *chan;
+
+	chan = dma_request_chan(dev, "scanout");
+	if (IS_ERR(chan)) {
+		if (PTR_ERR(chan) == -ENODEV)
+			return 0;
+		if (PTR_ERR(chan) != -EPROBE_DEFER)
+			dev_err(dev, "Cannot get scanout VDMA channel\n");
+		return PTR_ERR(chan);
+	}
+
+	priv->vdma = chan;
+	dev_info(dev, "Scanning out through %s\n", dma_chan_name(chan));
+
+	return 0;
+}
+
+void gslcd_vdma_fini(struct gslcd_drm_private *priv)
+{
+	if (priv->vdma)
+		dma_release_channel(priv->vdma);
+}
+
+void gslcd_vdma_flip(struct gslcd_drm_private *priv, dma_addr_t paddr,
+		     struct drm_framebuffer *fb)
+{
+	struct dma_interleaved_template *xt;
+	struct dma_async_tx_descriptor *desc;
+	size_t width = GSLCD_XRES * fb->format->cpp[0];
+
+	xt = kzalloc(sizeof(*xt) + sizeof(xt->sgl[0]), GFP_KERNEL);
+	if (!xt)
+		return;
+
+	xt->dir = DMA_MEM_TO_DEV;
+	xt->src_start = paddr;
+	xt->numf = GSLCD_YRES;
+	xt->frame_size = 1;
+	xt->sgl[0].size = width;
+	xt->sgl[0].icg = fb->pitches[0] - width;
+
+	desc = dmaengine_prep_interleaved_dma(priv->vdma, xt, 0);
+	kfree(xt);
+	if (!desc) {
+		dev_err_ratelimited(fb->dev->dev, "Cannot queue VDMA frame\n");
+		return;
+	}
+
+	dmaengine_submit(desc);
+	dma_async_issue_pending(priv->vdma);
+}
+
+void gslcd_vdma_enable(struct gslcd_drm_private *priv)
+{
+	struct xilinx_vdma_config config = {
+		.gen_lock	= 1,
+		.park		= 1,
+		.park_frm	= -1,	/* the last frame submitted */
+	};
+
+	xilinx_vdma_channel_set_config(priv->vdma, &config);
+	gslcd_out32(priv, GSLCD_REG_SOURCE, GSLCD_SOURCE_STREAM);
+}
+
+void gslcd_vdma_disable(struct gslcd_drm_private *priv)
+{
+	dmaengine_terminate_sync(priv->vdma);
+	gslcd_out32(priv, GSLCD_REG_SOURCE, 0);
+}
@@ -17,6 +17,7 @@
 #include <linux/module.h>
 #include <linux/regulator/consumer.h>
 #include <linux/spi/spi.h>
+#include <linux/workqueue.h>
 #include <video/mipi_display.h>
 
 #define MIPI_DBI_MAX_SPI_READ_SPEED 2000000 /* 2MHz */
@@ -192,20 +193,99 @@ static int mipi_dbi_buf_copy(void *dst, struct drm_framebuffer *fb,
 	return ret;
 }
 
+/*
+ * Flushing is double buffered: dirty() converts the damaged region into
+ * the back buffer and hands the SPI transfer to a worker, so the next
+ * frame can be rendered and converted while the previous one is still
+ * on the bus. Damage that arrives before the worker has picked up the
+ * back buffer is merged into it, so a slow bus drops intermediate frames
+ * instead of queueing them.
+ *
+ * The state lives in devres because struct mipi_dbi is shared with the
+ * drivers; it is protected by &tinydrm_device->dirty_lock.
+ */
+struct mipi_dbi_flush {
+	struct device *dev;
+	struct mipi_dbi *mipi;
+	struct work_struct work;
+	void *buf[2];
+	unsigned int back;		/* buffer dirty() converts into */
+	struct drm_clip_rect clip;	/* region held by the back buffer */
+	bool pending;
+};
+
+static void mipi_dbi_flush_release(struct device *dev, void *res)
+{
+	struct mipi_dbi_flush *flush = res;
+
+	cancel_work_sync(&flush->work);
+}
+
+static struct mipi_dbi_flush *mipi_dbi_get_flush(struct device *dev)
+{
+	return devres_find(dev, mipi_dbi_flush_release, NULL, NULL);
+}
+
+static int mipi_dbi_send_clip(struct mipi_dbi *mipi, void *tr,
+			      struct drm_clip_rect *clip)
+{
+	mipi_dbi_command(mipi, MIPI_DCS_SET_COLUMN_ADDRESS,
+			 (clip->x1 >> 8) & 0xFF, clip->x1 & 0xFF,
+			 (clip->x2 >> 8) & 0xFF, (clip->x2 - 1) & 0xFF);
+	mipi_dbi_command(mipi, MIPI_DCS_SET_PAGE_ADDRESS,
+			 (clip->y1 >> 8) & 0xFF, clip->y1 & 0xFF,
+			 (clip->y2 >> 8) & 0xFF, (clip->y2 - 1) & 0xFF);
+
+	return mipi_dbi_command_buf(mipi, MIPI_DCS_WRITE_MEMORY_START, tr,
+			(clip->x2 - clip->x1) * (clip->y2 - clip->y1) * 2);
+}
+
+static void mipi_dbi_flush_work(struct work_struct *work)
+{
+	struct mipi_dbi_flush *flush = container_of(work, struct mipi_dbi_flush,
+						    work);
+	struct mipi_dbi *mipi = flush->mipi;
+	struct tinydrm_device *tdev = &mipi->tinydrm;
+	struct drm_clip_rect clip;
+	void *tr;
+	int ret;
+
+	mutex_lock(&tdev->dirty_lock);
+	if (!flush->pending || !mipi->enabled) {
+		flush->pending = false;
+		mutex_unlock(&tdev->dirty_lock);
+		return;
+	}
+
+	/* the back buffer becomes the front, dirty() moves on to the other */
+	tr = flush->buf[flush->back];
+	clip = flush->clip;
+	flush->back ^= 1;
+	flush->pending = false;
+	mutex_unlock(&tdev->dirty_lock);
+
+	/*
+	 * The work item is not reentrant, so nothing converts into @tr
+	 * until this transfer is done and the buffers are swapped again.
+	 */
+	ret = mipi_dbi_send_clip(mipi, tr, &clip);
+	if (ret)
+		dev_err_once(flush->dev, "Failed to update display %d\n",
+			     ret);
+}
+
 static int mipi_dbi_fb_dirty(struct drm_framebuffer *fb,
 			     struct drm_file *file_priv,
 			     unsigned int flags, unsigned int color,
 			     struct drm_clip_rect *clips,
 			     unsigned int num_clips)
 {
-	struct drm_gem_cma_object *cma_obj = drm_fb_cma_get_gem_obj(fb, 0);
 	struct tinydrm_device *tdev = fb->dev->dev_private;
 	struct mipi_dbi *mipi = mipi_dbi_from_tinydrm(tdev);
+	struct mipi_dbi_flush *flush = mipi_dbi_get_flush(fb->dev->dev);
 	bool swap = mipi->swap_bytes;
 	struct drm_clip_rect clip;
 	int ret = 0;
-	bool full;
-	void *tr;
 
 	mutex_lock(&tdev->dirty_lock);
 
@@ -216,31 +296,27 @@ static int mipi_dbi_fb_dirty(struct drm_framebuffer *fb,
 	if (tdev->pipe.plane.fb != fb)
 		goto out_unlock;
 
-	full = tinydrm_merge_clips(&clip, clips, num_clips, flags,
-				   fb->width, fb->height);
+	tinydrm_merge_clips(&clip, clips, num_clips, flags,
+			    fb->width, fb->height);
+
+	/* not picked up yet, send the union of both updates instead */
+	if (flush->pending) {
+		clip.x1 = min(clip.x1, flush->clip.x1);
+		clip.x2 = max(clip.x2, flush->clip.x2);
+		clip.y1 = min(clip.y1, flush->clip.y1);
+		clip.y2 = max(clip.y2, flush->clip.y2);
+	}
 
 	DRM_DEBUG("Flushing [FB:%d] x1=%u, x2=%u, y1=%u, y2=%u\n", fb->base.id,
 		  clip.x1, clip.x2, clip.y1, clip.y2);
 
-	if (!mipi->dc || !full || swap ||
-	    fb->format->format == DRM_FORMAT_XRGB8888) {
-		tr = mipi->tx_buf;
-		ret = mipi_dbi_buf_copy(mipi->tx_buf, fb, &clip, swap);
-		if (ret)
-			goto out_unlock;
-	} else {
-		tr = cma_obj->vaddr;
-	}
-
-	mipi_dbi_command(mipi, MIPI_DCS_SET_COLUMN_ADDRESS,
-			 (clip.x1 >> 8) & 0xFF, clip.x1 & 0xFF,
-			 (clip.x2 >> 8) & 0xFF, (clip.x2 - 1) & 0xFF);
-	mipi_dbi_command(mipi, MIPI_DCS_SET_PAGE_ADDRESS,
-			 (clip.y1 >> 8) & 0xFF, clip.y1 & 0xFF,
-			 (clip.y2 >> 8) & 0xFF, (clip.y2 - 1) & 0xFF);
+	ret = mipi_dbi_buf_copy(flush->buf[flush->back], fb, &clip, swap);
+	if (ret)
+		goto out_unlock;
 
-	ret = mipi_dbi_command_buf(mipi, MIPI_DCS_WRITE_MEMORY_START, tr,
-				(clip.x2 - clip.x1) * (clip.y2 - clip.y1) * 2);
+	flush->clip = clip;
+	flush->pending = true;
+	schedule_work(&flush->work);
 
 out_unlock:
 	mutex_unlock(&tdev->dirty_lock);
@@ -312,10 +388,17 @@ void mipi_dbi_pipe_disable(struct drm_simple_display_pipe *pipe)
 {
 	struct tinydrm_device *tdev = pipe_to_tinydrm(pipe);
 	struct mipi_dbi *mipi = mipi_dbi_from_tinydrm(tdev);
+	struct mipi_dbi_flush *flush = mipi_dbi_get_flush(tdev->drm->dev);
 
 	DRM_DEBUG_KMS("\n");
 
+	mutex_lock(&tdev->dirty_lock);
 	mipi->enabled = false;
+	flush->pending = false;
+	mutex_unlock(&tdev->dirty_lock);
+
+	/* the worker may be sending from tx_buf, which blanking reuses */
+	cancel_work_sync(&flush->work);
 
 	if (mipi->backlight)
 		tinydrm_disable_backlight(mipi->backlight);
@@ -356,6 +439,7 @@ int mipi_dbi_init(struct device *dev, struct mipi_dbi *mipi,
 {
 	size_t bufsize = mode->vdisplay * mode->hdisplay * sizeof(u16);
 	struct tinydrm_device *tdev = &mipi->tinydrm;
+	struct mipi_dbi_flush *flush;
 	int ret;
 
 	if (!mipi->command)
@@ -367,6 +451,23 @@ int mipi_dbi_init(struct device *dev, struct mipi_dbi *mipi,
 	if (!mipi->tx_buf)
 		return -ENOMEM;
 
+	flush = devres_alloc(mipi_dbi_flush_release, sizeof(*flush),
+			     GFP_KERNEL);
+	if (!flush)
+		return -ENOMEM;
+
+	flush->buf[1] = devm_kmalloc(dev, bufsize, GFP_KERNEL);
+	if (!flush->buf[1]) {
+		devres_free(flush);
+		return -ENOMEM;
+	}
+
+	flush->dev = dev;
+	flush->mipi = mipi;
+	flush->buf[0] = mipi->tx_buf;
+	INIT_WORK(&flush->work, mipi_dbi_flush_work);
+	devres_add(dev, flush);
+
 	ret = devm_tinydrm_init(dev, tdev, &mipi_dbi_fb_funcs, driver);
 	if (ret)
 		return ret;
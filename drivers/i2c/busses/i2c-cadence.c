@@ -15,6 +15,7 @@
 #include <linux/i2c.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/of.h>
@@ -119,6 +120,17 @@
 
 #define CDNS_I2C_BROKEN_HOLD_BIT	BIT(0)
 
+/*
+ * Short messages can be completed by spinning on the interrupt status
+ * instead of sleeping on the completion, which saves the wakeup latency for
+ * e.g. sensor register reads.  Transfers from atomic context are always
+ * polled.
+ */
+static unsigned int poll_max_bytes;
+module_param(poll_max_bytes, uint, 0644);
+MODULE_PARM_DESC(poll_max_bytes,
+		 "Poll for messages up to this many bytes (0: atomic context only)");
+
 #define cdns_i2c_readreg(offset)       readl_relaxed(id->membase + offset)
 #define cdns_i2c_writereg(val, offset) writel_relaxed(val, id->membase + offset)
 
@@ -129,6 +141,7 @@
  * @membase:		Base address of the I2C device
  * @adap:		I2C adapter instance
  * @p_msg:		Message pointer
+ * @p_chain_msg:	Read message to start from the ISR after the current write
  * @err_status:		Error status in Interrupt Status Register
  * @xfer_done:		Transfer complete status
  * @p_send_buf:		Pointer to transmit buffer
@@ -140,6 +153,8 @@
  * @input_clk:		Input clock to I2C controller
  * @i2c_clk:		Maximum I2C clock speed
  * @bus_hold_flag:	Flag used in repeated start for clearing HOLD bit
+ * @chain_hold_flag:	bus_hold_flag value for the chained read message
+ * @polling:		Current message is polled, interrupts stay disabled
  * @clk:		Pointer to struct clk
  * @clk_rate_change_nb:	Notifier block for clock rate changes
  * @quirks:		flag for broken hold bit usage in r1p10
@@ -149,6 +164,7 @@ struct cdns_i2c {
 	void __iomem *membase;
 	struct i2c_adapter adap;
 	struct i2c_msg *p_msg;
+	struct i2c_msg *p_chain_msg;
 	int err_status;
 	struct completion xfer_done;
 	unsigned char *p_send_buf;
@@ -160,6 +176,8 @@ struct cdns_i2c {
 	unsigned long input_clk;
 	unsigned int i2c_clk;
 	unsigned int bus_hold_flag;
+	unsigned int chain_hold_flag;
+	bool polling;
 	struct clk *clk;
 	struct notifier_block clk_rate_change_nb;
 	u32 quirks;
@@ -191,6 +209,8 @@ static inline bool cdns_is_holdquirk(struct cdns_i2c *id, bool hold_wrkaround)
 		(id->curr_recv_count == CDNS_I2C_FIFO_DEPTH + 1));
 }
 
+static void cdns_i2c_mrecv(struct cdns_i2c *id);
+
 /**
  * cdns_i2c_isr - Interrupt handler for the I2C device
  * @irq:	irq number for the I2C device
@@ -332,6 +352,18 @@ static irqreturn_t cdns_i2c_isr(int irq, void *ptr)
 					 CDNS_I2C_DATA_OFFSET);
 				id->send_count--;
 			}
+		} else if (id->p_chain_msg &&
+			   !(isr_status & CDNS_I2C_IXR_ERR_INTR_MASK)) {
+			/*
+			 * The write of a write+read pair is done and the bus is
+			 * still held, issue the repeated start for the read
+			 * right here instead of waking up the caller.
+			 */
+			id->p_msg = id->p_chain_msg;
+			id->p_chain_msg = NULL;
+			id->bus_hold_flag = id->chain_hold_flag;
+			cdns_i2c_mrecv(id);
+			return IRQ_HANDLED;
 		} else {
 			/*
 			 * Signal the completion of transaction and
@@ -413,7 +445,9 @@ static void cdns_i2c_mrecv(struct cdns_i2c *id)
 	/* Set the slave address in address register - triggers operation */
 	cdns_i2c_writereg(id->p_msg->addr & CDNS_I2C_ADDR_MASK,
 						CDNS_I2C_ADDR_OFFSET);
-	cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK, CDNS_I2C_IER_OFFSET);
+	if (!id->polling)
+		cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK,
+				  CDNS_I2C_IER_OFFSET);
 }
 
 /**
@@ -476,7 +510,9 @@ static void cdns_i2c_msend(struct cdns_i2c *id)
 	cdns_i2c_writereg(id->p_msg->addr & CDNS_I2C_ADDR_MASK,
 						CDNS_I2C_ADDR_OFFSET);
 
-	cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK, CDNS_I2C_IER_OFFSET);
+	if (!id->polling)
+		cdns_i2c_writereg(CDNS_I2C_ENABLED_INTR_MASK,
+				  CDNS_I2C_IER_OFFSET);
 }
 
 /**
@@ -508,12 +544,82 @@ static void cdns_i2c_master_reset(struct i2c_adapter *adap)
 	cdns_i2c_writereg(regval, CDNS_I2C_SR_OFFSET);
 }
 
+/**
+ * cdns_i2c_can_chain - Check whether a write+read pair can be fused
+ * @wr:		pointer to the write message
+ * @rd:		pointer to the read message following it
+ *
+ * The typical register read: a write that fits the FIFO, followed by a
+ * read of the same slave.  The read is then started from the ISR when the
+ * write completes, so the pair costs a single completion.
+ *
+ * Return: true if the pair can be fused
+ */
+static bool cdns_i2c_can_chain(struct i2c_msg *wr, struct i2c_msg *rd)
+{
+	return !(wr->flags & I2C_M_RD) && (rd->flags & I2C_M_RD) &&
+	       !(rd->flags & I2C_M_RECV_LEN) &&
+	       wr->addr == rd->addr &&
+	       (wr->flags & I2C_M_TEN) == (rd->flags & I2C_M_TEN) &&
+	       wr->len && wr->len <= CDNS_I2C_FIFO_DEPTH;
+}
+
+/**
+ * cdns_i2c_can_poll - Check whether a message should be polled
+ * @id:		pointer to the i2c device structure
+ * @msg:	pointer to the message, the chained read is counted too
+ *
+ * Return: true if the message is to be completed by polling
+ */
+static bool cdns_i2c_can_poll(struct cdns_i2c *id, struct i2c_msg *msg)
+{
+	unsigned int len = msg->len;
+
+	if (in_atomic() || irqs_disabled())
+		return true;
+
+	if (msg->flags & I2C_M_RECV_LEN)
+		return false;
+
+	if (id->p_chain_msg)
+		len += id->p_chain_msg->len;
+
+	return len <= poll_max_bytes;
+}
+
+/**
+ * cdns_i2c_poll - Complete a message by polling the interrupt status
+ * @id:		pointer to the i2c device structure
+ * @timeout:	timeout in jiffies
+ *
+ * Runs the interrupt handler by hand until it signals the completion.
+ * The timeout is tracked with ktime as jiffies may not advance here.
+ *
+ * Return: 0 on timeout, non-zero otherwise, like
+ * wait_for_completion_timeout()
+ */
+static unsigned long cdns_i2c_poll(struct cdns_i2c *id, unsigned long timeout)
+{
+	ktime_t expire = ktime_add_us(ktime_get(), jiffies_to_usecs(timeout));
+
+	while (!try_wait_for_completion(&id->xfer_done)) {
+		if (ktime_after(ktime_get(), expire))
+			return 0;
+
+		cdns_i2c_isr(id->irq, id);
+		cpu_relax();
+	}
+
+	return 1;
+}
+
 static int cdns_i2c_process_msg(struct cdns_i2c *id, struct i2c_msg *msg,
 		struct i2c_adapter *adap)
 {
 	unsigned long time_left;
 	u32 reg;
 
+	id->polling = cdns_i2c_can_poll(id, msg);
 	id->p_msg = msg;
 	id->err_status = 0;
 	reinit_completion(&id->xfer_done);
@@ -537,7 +643,11 @@ static int cdns_i2c_process_msg(struct cdns_i2c *id, struct i2c_msg *msg,
 		cdns_i2c_msend(id);
 
 	/* Wait for the signal of completion */
-	time_left = wait_for_completion_timeout(&id->xfer_done, adap->timeout);
+	if (id->polling)
+		time_left = cdns_i2c_poll(id, adap->timeout);
+	else
+		time_left = wait_for_completion_timeout(&id->xfer_done,
+							adap->timeout);
 	if (time_left == 0) {
 		cdns_i2c_master_reset(adap);
 		dev_err(id->adap.dev.parent,
@@ -611,8 +721,14 @@ static int cdns_i2c_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
 		id->bus_hold_flag = 0;
 	}
 
-	/* Process the msg one by one */
+	/* Process the msg one by one, write+read pairs in one go */
 	for (count = 0; count < num; count++, msgs++) {
+		id->p_chain_msg = NULL;
+		if (count < num - 1 && cdns_i2c_can_chain(msgs, msgs + 1)) {
+			id->p_chain_msg = msgs + 1;
+			id->chain_hold_flag = count + 1 < num - 1;
+		}
+
 		if (count == (num - 1))
 			id->bus_hold_flag = 0;
 
@@ -631,6 +747,12 @@ static int cdns_i2c_master_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs,
 			ret = -EIO;
 			goto out;
 		}
+
+		/* Skip the read if the ISR already did it */
+		if (id->p_msg != msgs) {
+			count++;
+			msgs++;
+		}
 	}
 
 	ret = num;
@@ -934,6 +1056,8 @@ static int cdns_i2c_probe(struct platform_device *pdev)
 	pm_runtime_set_autosuspend_delay(id->dev, CNDS_I2C_PM_TIMEOUT);
 	pm_runtime_use_autosuspend(id->dev);
 	pm_runtime_set_active(id->dev);
+	/* Only clk_enable/disable, and polled transfers may be atomic */
+	pm_runtime_irq_safe(id->dev);
 
 	id->clk_rate_change_nb.notifier_call = cdns_i2c_clk_notifier_cb;
 	if (clk_notifier_register(id->clk, &id->clk_rate_change_nb))
@@ -1012,6 +1136,7 @@ static struct platform_driver cdns_i2c_drv = {
 		.name  = DRIVER_NAME,
 		.of_match_table = cdns_i2c_of_match,
 		.pm = &cdns_i2c_dev_pm_ops,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe  = cdns_i2c_probe,
 	.remove = cdns_i2c_remove,
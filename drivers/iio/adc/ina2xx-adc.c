@@ -18,14 +18,20 @@
  * IIO driver for INA219-220-226-230-231
  *
  * Configurable 7-bit I2C slave address from 0x40 to 0x4F
+ *
+ * In buffered mode, samples are read by a kthread paced with an hrtimer,
+ * or, on INA226 and later with the ALERT pin wired to an interrupt, as
+ * each conversion completes. Every sample is also traced.
  */
 
-#include <linux/delay.h>
+#include <linux/hrtimer.h>
 #include <linux/i2c.h>
 #include <linux/iio/iio.h>
 #include <linux/iio/buffer.h>
 #include <linux/iio/kfifo_buf.h>
 #include <linux/iio/sysfs.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
 #include <linux/kthread.h>
 #include <linux/module.h>
 #include <linux/of_device.h>
@@ -34,6 +40,9 @@
 
 #include <linux/platform_data/ina2xx.h>
 
+#define CREATE_TRACE_POINTS
+#include "ina2xx_trace.h"
+
 /* INA2XX registers definition */
 #define INA2XX_CONFIG                   0x00
 #define INA2XX_SHUNT_VOLTAGE            0x01	/* readonly */
@@ -42,7 +51,8 @@
 #define INA2XX_CURRENT                  0x04	/* readonly */
 #define INA2XX_CALIBRATION              0x05
 
-#define INA226_ALERT_MASK		GENMASK(2, 1)
+#define INA226_MASK_ENABLE		0x06
+#define INA226_CNVR			BIT(10)
 #define INA266_CVRF			BIT(3)
 
 #define INA2XX_MAX_REGISTERS            8
@@ -120,6 +130,8 @@ struct ina2xx_chip_info {
 	int int_time_vbus; /* Bus voltage integration time uS */
 	int int_time_vshunt; /* Shunt voltage integration time uS */
 	bool allow_async_readout;
+	int irq; /* conversion ready alert, 0 if none */
+	s64 alert_ts;
 };
 
 static const struct ina2xx_config ina2xx_config[] = {
@@ -459,35 +471,47 @@ static const struct iio_chan_spec ina2xx_channels[] = {
 	IIO_CHAN_SOFT_TIMESTAMP(4),
 };
 
-static int ina2xx_work_buffer(struct iio_dev *indio_dev)
+static void ina2xx_trace_sample(struct iio_dev *indio_dev,
+				const unsigned short *data, s64 timestamp)
 {
 	struct ina2xx_chip_info *chip = iio_priv(indio_dev);
-	unsigned short data[8];
-	int bit, ret, i = 0;
-	s64 time_a, time_b;
-	unsigned int alert;
+	const struct ina2xx_config *config = chip->config;
+	int shunt_uv = 0, bus_uv = 0, power_uw = 0, current_ua = 0;
+	int bit, i = 0;
 
-	time_a = iio_get_time_ns(indio_dev);
+	if (!trace_ina2xx_sample_enabled())
+		return;
 
-	/*
-	 * Because the timer thread and the chip conversion clock
-	 * are asynchronous, the period difference will eventually
-	 * result in reading V[k-1] again, or skip V[k] at time Tk.
-	 * In order to resync the timer with the conversion process
-	 * we check the ConVersionReadyFlag.
-	 * On hardware that supports using the ALERT pin to toggle a
-	 * GPIO a triggered buffer could be used instead.
-	 * For now, we pay for that extra read of the ALERT register
-	 */
-	if (!chip->allow_async_readout)
-		do {
-			ret = regmap_read(chip->regmap, INA226_ALERT_MASK,
-					  &alert);
-			if (ret < 0)
-				return ret;
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 indio_dev->masklength) {
+		unsigned int val = data[i++];
 
-			alert &= INA266_CVRF;
-		} while (!alert);
+		switch (INA2XX_SHUNT_VOLTAGE + bit) {
+		case INA2XX_SHUNT_VOLTAGE:
+			shunt_uv = (s16) val * 1000 / config->shunt_div;
+			break;
+		case INA2XX_BUS_VOLTAGE:
+			bus_uv = (val >> config->bus_voltage_shift) *
+				 config->bus_voltage_lsb;
+			break;
+		case INA2XX_POWER:
+			power_uw = val * config->power_lsb;
+			break;
+		case INA2XX_CURRENT:
+			current_ua = (s16) val * 1000;
+			break;
+		}
+	}
+
+	trace_ina2xx_sample(indio_dev->name, timestamp, shunt_uv, bus_uv,
+			    power_uw, current_ua);
+}
+
+static int ina2xx_push_scan(struct iio_dev *indio_dev, s64 timestamp)
+{
+	struct ina2xx_chip_info *chip = iio_priv(indio_dev);
+	unsigned short data[8];
+	int bit, ret, i = 0;
 
 	/*
 	 * Single register reads: bulk_read will not work with ina226
@@ -506,12 +530,43 @@ static int ina2xx_work_buffer(struct iio_dev *indio_dev)
 		data[i++] = val;
 	}
 
-	time_b = iio_get_time_ns(indio_dev);
-
 	iio_push_to_buffers_with_timestamp(indio_dev,
-					   (unsigned int *)data, time_a);
+					   (unsigned int *)data, timestamp);
+	ina2xx_trace_sample(indio_dev, data, timestamp);
+
+	return 0;
+}
+
+static int ina2xx_work_buffer(struct iio_dev *indio_dev)
+{
+	struct ina2xx_chip_info *chip = iio_priv(indio_dev);
+	unsigned int alert;
+	int ret;
+	s64 time_a;
+
+	time_a = iio_get_time_ns(indio_dev);
+
+	/*
+	 * Because the timer thread and the chip conversion clock
+	 * are asynchronous, the period difference will eventually
+	 * result in reading V[k-1] again, or skip V[k] at time Tk.
+	 * In order to resync the timer with the conversion process
+	 * we check the ConVersionReadyFlag.
+	 * Hardware with the ALERT pin wired to an interrupt does not
+	 * get here, see ina2xx_alert_thread().
+	 * Otherwise, we pay for that extra read of the ALERT register
+	 */
+	if (!chip->allow_async_readout)
+		do {
+			ret = regmap_read(chip->regmap, INA226_MASK_ENABLE,
+					  &alert);
+			if (ret < 0)
+				return ret;
 
-	return (unsigned long)(time_b - time_a) / 1000;
+			alert &= INA266_CVRF;
+		} while (!alert);
+
+	return ina2xx_push_scan(indio_dev, time_a);
 };
 
 static int ina2xx_capture_thread(void *data)
@@ -519,7 +574,8 @@ static int ina2xx_capture_thread(void *data)
 	struct iio_dev *indio_dev = data;
 	struct ina2xx_chip_info *chip = iio_priv(indio_dev);
 	unsigned int sampling_us = SAMPLING_PERIOD(chip);
-	int buffer_us;
+	ktime_t next, now;
+	int ret;
 
 	/*
 	 * Poll a bit faster than the chip internal Fs, in case
@@ -528,19 +584,57 @@ static int ina2xx_capture_thread(void *data)
 	if (!chip->allow_async_readout)
 		sampling_us -= 200;
 
+	next = ktime_get();
+
 	do {
-		buffer_us = ina2xx_work_buffer(indio_dev);
-		if (buffer_us < 0)
-			return buffer_us;
+		ret = ina2xx_work_buffer(indio_dev);
+		if (ret < 0)
+			return ret;
 
-		if (sampling_us > buffer_us)
-			udelay(sampling_us - buffer_us);
+		/*
+		 * Sleep until the next period instead of spinning, the
+		 * CPU time would show up in the power being measured.
+		 * Start over if a read took longer than a period.
+		 */
+		now = ktime_get();
+		next = ktime_add_us(next, sampling_us);
+		if (ktime_before(next, now))
+			next = now;
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		schedule_hrtimeout(&next, HRTIMER_MODE_ABS);
 
 	} while (!kthread_should_stop());
 
 	return 0;
 }
 
+static irqreturn_t ina2xx_alert_irq(int irq, void *data)
+{
+	struct iio_dev *indio_dev = data;
+	struct ina2xx_chip_info *chip = iio_priv(indio_dev);
+
+	chip->alert_ts = iio_get_time_ns(indio_dev);
+
+	return IRQ_WAKE_THREAD;
+}
+
+static irqreturn_t ina2xx_alert_thread(int irq, void *data)
+{
+	struct iio_dev *indio_dev = data;
+	struct ina2xx_chip_info *chip = iio_priv(indio_dev);
+	unsigned int alert;
+
+	/* Reading the flags releases the ALERT pin */
+	if (regmap_read(chip->regmap, INA226_MASK_ENABLE, &alert) < 0 ||
+	    !(alert & INA266_CVRF))
+		return IRQ_NONE;
+
+	ina2xx_push_scan(indio_dev, chip->alert_ts);
+
+	return IRQ_HANDLED;
+}
+
 static int ina2xx_buffer_enable(struct iio_dev *indio_dev)
 {
 	struct ina2xx_chip_info *chip = iio_priv(indio_dev);
@@ -554,6 +648,16 @@ static int ina2xx_buffer_enable(struct iio_dev *indio_dev)
 	dev_dbg(&indio_dev->dev, "Async readout mode: %d\n",
 		chip->allow_async_readout);
 
+	if (chip->irq) {
+		int ret = regmap_write(chip->regmap, INA226_MASK_ENABLE,
+				       INA226_CNVR);
+		if (ret)
+			return ret;
+
+		enable_irq(chip->irq);
+		return 0;
+	}
+
 	chip->task = kthread_run(ina2xx_capture_thread, (void *)indio_dev,
 				 "%s:%d-%uus", indio_dev->name, indio_dev->id,
 				 sampling_us);
@@ -565,6 +669,11 @@ static int ina2xx_buffer_disable(struct iio_dev *indio_dev)
 {
 	struct ina2xx_chip_info *chip = iio_priv(indio_dev);
 
+	if (chip->irq) {
+		disable_irq(chip->irq);
+		return regmap_write(chip->regmap, INA226_MASK_ENABLE, 0);
+	}
+
 	if (chip->task) {
 		kthread_stop(chip->task);
 		chip->task = NULL;
@@ -707,6 +816,22 @@ static int ina2xx_probe(struct i2c_client *client,
 
 	iio_device_attach_buffer(indio_dev, buffer);
 
+	/* Without the ALERT pin, conversions are polled by a kthread */
+	if (client->irq > 0 && type == ina226) {
+		irq_set_status_flags(client->irq, IRQ_NOAUTOEN);
+		ret = devm_request_threaded_irq(&client->dev, client->irq,
+						ina2xx_alert_irq,
+						ina2xx_alert_thread,
+						IRQF_ONESHOT,
+						dev_name(&client->dev),
+						indio_dev);
+		if (ret) {
+			dev_err(&client->dev, "failed to request alert irq\n");
+			return ret;
+		}
+		chip->irq = client->irq;
+	}
+
 	return iio_device_register(indio_dev);
 }
 
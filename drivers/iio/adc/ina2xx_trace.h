@@ -0,0 +1,46 @@
+#if !defined(_INA2XX_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _INA2XX_TRACE_H_
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM ina2xx
+#define TRACE_INCLUDE_FILE ina2xx_trace
+
+/*
+ * A sample pushed to the buffer, converted to physical units so power
+ * can be read next to other events of the same capture. timestamp is
+ * the one in the buffer, channels not in the scan read as 0.
+ */
+TRACE_EVENT(ina2xx_sample,
+	    TP_PROTO(const char *name, s64 timestamp, int shunt_uv,
+		     int bus_uv, int power_uw, int current_ua),
+	    TP_ARGS(name, timestamp, shunt_uv, bus_uv, power_uw, current_ua),
+	    TP_STRUCT__entry(
+		    __string(name, name)
+		    __field(s64, timestamp)
+		    __field(int, shunt_uv)
+		    __field(int, bus_uv)
+		    __field(int, power_uw)
+		    __field(int, current_ua)
+		    ),
+	    TP_fast_assign(
+		    __assign_str(name, name);
+		    __entry->timestamp = timestamp;
+		    __entry->shunt_uv = shunt_uv;
+		    __entry->bus_uv = bus_uv;
+		    __entry->power_uw = power_uw;
+		    __entry->current_ua = current_ua;
+		    ),
+	    TP_printk("%s: timestamp=%lld, shunt=%duV, bus=%duV, power=%duW, current=%duA",
+		      __get_str(name), __entry->timestamp, __entry->shunt_uv,
+		      __entry->bus_uv, __entry->power_uw, __entry->current_ua)
+);
+
+#endif /* _INA2XX_TRACE_H_ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#include <trace/define_trace.h>
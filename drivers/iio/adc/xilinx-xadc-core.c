@@ -23,6 +23,7 @@
 #include <linux/platform_device.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
+#include <linux/thermal.h>
 
 #include <linux/iio/buffer.h>
 #include <linux/iio/events.h>
@@ -36,6 +37,11 @@
 
 static const unsigned int XADC_ZYNQ_UNMASK_TIMEOUT = 500;
 
+static unsigned int cache_max_age_ms;
+module_param(cache_max_age_ms, uint, 0644);
+MODULE_PARM_DESC(cache_max_age_ms,
+	"Serve raw channel reads from a snapshot of all conversion results up to this old (0 = always read the hardware)");
+
 /* ZYNQ register definitions */
 #define XADC_ZYNQ_REG_CFG	0x00
 #define XADC_ZYNQ_REG_INTSTS	0x04
@@ -102,6 +108,7 @@ static const unsigned int XADC_ZYNQ_UNMASK_TIMEOUT = 500;
 #define XADC_AXI_INT_ALARM_MASK		0x3c0f
 
 #define XADC_FLAGS_BUFFERED BIT(0)
+#define XADC_FLAGS_EOS_TRIGGER BIT(1)
 
 static void xadc_write_reg(struct xadc *xadc, unsigned int reg,
 	uint32_t val)
@@ -228,6 +235,78 @@ static int xadc_zynq_read_adc_reg(struct xadc *xadc, unsigned int reg,
 	return 0;
 }
 
+/*
+ * Each command pushed into the CFIFO produces one word in the DFIFO, the result
+ * of a read appearing with the word of the command that follows it. Both FIFOs
+ * are 15 entries deep, which with the trailing NOP bounds a single burst.
+ */
+#define XADC_ZYNQ_BURST_MAX 14
+
+static int xadc_zynq_read_adc_regs_burst(struct xadc *xadc,
+	const unsigned int *regs, uint16_t *vals, unsigned int n)
+{
+	uint32_t cmd[XADC_ZYNQ_BURST_MAX + 1];
+	uint32_t resp, tmp;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < n; i++)
+		cmd[i] = XADC_ZYNQ_CMD(XADC_ZYNQ_CMD_READ, regs[i], 0);
+	cmd[n] = XADC_ZYNQ_CMD(XADC_ZYNQ_CMD_NOP, 0, 0);
+
+	spin_lock_irq(&xadc->lock);
+	xadc_zynq_update_intmsk(xadc, XADC_ZYNQ_INT_DFIFO_GTH,
+			XADC_ZYNQ_INT_DFIFO_GTH);
+	xadc_zynq_drain_fifo(xadc);
+	reinit_completion(&xadc->completion);
+
+	xadc_zynq_write_fifo(xadc, cmd, n + 1);
+	xadc_read_reg(xadc, XADC_ZYNQ_REG_CFG, &tmp);
+	tmp &= ~XADC_ZYNQ_CFG_DFIFOTH_MASK;
+	tmp |= n << XADC_ZYNQ_CFG_DFIFOTH_OFFSET;
+	xadc_write_reg(xadc, XADC_ZYNQ_REG_CFG, tmp);
+
+	xadc_zynq_update_intmsk(xadc, XADC_ZYNQ_INT_DFIFO_GTH, 0);
+	spin_unlock_irq(&xadc->lock);
+	ret = wait_for_completion_interruptible_timeout(&xadc->completion, HZ);
+	if (ret == 0)
+		ret = -EIO;
+	if (ret < 0)
+		return ret;
+
+	/* The first word belongs to the command before the first read */
+	xadc_read_reg(xadc, XADC_ZYNQ_REG_DFIFO, &resp);
+	for (i = 0; i < n; i++) {
+		xadc_read_reg(xadc, XADC_ZYNQ_REG_DFIFO, &resp);
+		vals[i] = resp & 0xffff;
+	}
+
+	return 0;
+}
+
+/*
+ * Going through the FIFOs costs an interrupt round trip, so instead of paying
+ * it once per register queue up as many reads as the FIFOs can hold.
+ */
+static int xadc_zynq_read_adc_regs(struct xadc *xadc,
+	const unsigned int *regs, uint16_t *vals, unsigned int n)
+{
+	unsigned int len;
+	int ret;
+
+	while (n) {
+		len = min_t(unsigned int, n, XADC_ZYNQ_BURST_MAX);
+		ret = xadc_zynq_read_adc_regs_burst(xadc, regs, vals, len);
+		if (ret)
+			return ret;
+		regs += len;
+		vals += len;
+		n -= len;
+	}
+
+	return 0;
+}
+
 static unsigned int xadc_zynq_transform_alarm(unsigned int alarm)
 {
 	return ((alarm & 0x80) >> 4) |
@@ -418,11 +497,13 @@ static void xadc_zynq_update_alarm(struct xadc *xadc, unsigned int alarm)
 
 static const struct xadc_ops xadc_zynq_ops = {
 	.read = xadc_zynq_read_adc_reg,
+	.read_multi = xadc_zynq_read_adc_regs,
 	.write = xadc_zynq_write_adc_reg,
 	.setup = xadc_zynq_setup,
 	.get_dclk_rate = xadc_zynq_get_dclk_rate,
 	.interrupt_handler = xadc_zynq_interrupt_handler,
 	.update_alarm = xadc_zynq_update_alarm,
+	.flags = XADC_FLAGS_BUFFERED,
 };
 
 static int xadc_axi_read_adc_reg(struct xadc *xadc, unsigned int reg,
@@ -524,7 +605,7 @@ static const struct xadc_ops xadc_axi_ops = {
 	.get_dclk_rate = xadc_axi_get_dclk,
 	.update_alarm = xadc_axi_update_alarm,
 	.interrupt_handler = xadc_axi_interrupt_handler,
-	.flags = XADC_FLAGS_BUFFERED,
+	.flags = XADC_FLAGS_BUFFERED | XADC_FLAGS_EOS_TRIGGER,
 };
 
 static int _xadc_update_adc_reg(struct xadc *xadc, unsigned int reg,
@@ -570,6 +651,14 @@ static int xadc_update_scan_mode(struct iio_dev *indio_dev,
 	if (!xadc->data)
 		return -ENOMEM;
 
+	kfree(xadc->scan_regs);
+	xadc->scan_regs = kcalloc(n, sizeof(*xadc->scan_regs), GFP_KERNEL);
+	if (!xadc->scan_regs) {
+		kfree(xadc->data);
+		xadc->data = NULL;
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -606,7 +695,6 @@ static irqreturn_t xadc_trigger_handler(int irq, void *p)
 	struct iio_poll_func *pf = p;
 	struct iio_dev *indio_dev = pf->indio_dev;
 	struct xadc *xadc = iio_priv(indio_dev);
-	unsigned int chan;
 	int i, j;
 
 	if (!xadc->data)
@@ -614,13 +702,11 @@ static irqreturn_t xadc_trigger_handler(int irq, void *p)
 
 	j = 0;
 	for_each_set_bit(i, indio_dev->active_scan_mask,
-		indio_dev->masklength) {
-		chan = xadc_scan_index_to_channel(i);
-		xadc_read_adc_reg(xadc, chan, &xadc->data[j]);
-		j++;
-	}
+		indio_dev->masklength)
+		xadc->scan_regs[j++] = xadc_scan_index_to_channel(i);
 
-	iio_push_to_buffers(indio_dev, xadc->data);
+	if (xadc_read_adc_regs(xadc, xadc->scan_regs, xadc->data, j) == 0)
+		iio_push_to_buffers(indio_dev, xadc->data);
 
 out:
 	iio_trigger_notify_done(indio_dev->trig);
@@ -762,6 +848,11 @@ static int xadc_postdisable(struct iio_dev *indio_dev)
 	if (ret)
 		return ret;
 
+	/* Channels outside the buffered scan left stale results behind */
+	mutex_lock(&xadc->mutex);
+	xadc->status_cache_valid = false;
+	mutex_unlock(&xadc->mutex);
+
 	return xadc_power_adc_b(xadc, XADC_CONF1_SEQ_CONTINUOUS);
 }
 
@@ -810,6 +901,117 @@ static const struct iio_buffer_setup_ops xadc_buffer_ops = {
 	.postdisable = &xadc_postdisable,
 };
 
+/*
+ * The sequencer converts all channels continuously, so instead of going out to
+ * the hardware for every poll refresh all conversion results in one batch and
+ * hand out the snapshot until it is older than cache_max_age_ms.
+ */
+static int xadc_read_cached_adc_reg(struct xadc *xadc, unsigned int reg,
+	uint16_t *val)
+{
+	unsigned int regs[XADC_NUM_STATUS_REGS];
+	unsigned int max_age = READ_ONCE(cache_max_age_ms);
+	unsigned int i;
+	int ret = 0;
+
+	if (!max_age || reg >= XADC_NUM_STATUS_REGS)
+		return xadc_read_adc_reg(xadc, reg, val);
+
+	mutex_lock(&xadc->mutex);
+	if (!xadc->status_cache_valid ||
+	    time_after(jiffies, xadc->status_cache_stamp +
+				msecs_to_jiffies(max_age))) {
+		for (i = 0; i < XADC_NUM_STATUS_REGS; i++)
+			regs[i] = i;
+		ret = _xadc_read_adc_regs(xadc, regs, xadc->status_cache,
+			XADC_NUM_STATUS_REGS);
+		xadc->status_cache_valid = ret == 0;
+		xadc->status_cache_stamp = jiffies;
+	}
+	if (ret == 0)
+		*val = xadc->status_cache[reg];
+	mutex_unlock(&xadc->mutex);
+
+	return ret;
+}
+
+/* Temp in mC = (val * 503975) / 4096 - 273150, val being the 12 bit result */
+static int xadc_temp_to_mcelsius(uint16_t val)
+{
+	return (int)(((val >> 4) * 503975U) >> 12) - 273150;
+}
+
+static uint16_t xadc_mcelsius_to_temp(int temp)
+{
+	temp = clamp(temp, -273150, 230000);
+
+	return min_t(u32, DIV_ROUND_CLOSEST((u32)(temp + 273150) << 12, 503975),
+		     0xfff) << 4;
+}
+
+static int xadc_thermal_get_temp(void *data, int *temp)
+{
+	struct xadc *xadc = data;
+	uint16_t val;
+	int ret;
+
+	ret = xadc_read_cached_adc_reg(xadc, XADC_REG_TEMP, &val);
+	if (ret)
+		return ret;
+
+	*temp = xadc_temp_to_mcelsius(val);
+
+	return 0;
+}
+
+/*
+ * Arm the temperature alarm for the next trip point above the current
+ * temperature, so that crossing it reaches the thermal core right away
+ * instead of at its next poll. The alarm deasserts below the lower trip,
+ * falling through that one is picked up by polling.
+ */
+static int xadc_thermal_set_trips(void *data, int low, int high)
+{
+	const unsigned int max = XADC_THRESHOLD_TEMP_MAX;
+	const unsigned int min = XADC_THRESHOLD_TEMP_MIN;
+	struct xadc *xadc = data;
+	int ret;
+
+	mutex_lock(&xadc->mutex);
+
+	xadc->threshold[max] = xadc_mcelsius_to_temp(high);
+	xadc->threshold[min] = xadc_mcelsius_to_temp(low);
+
+	ret = _xadc_write_adc_reg(xadc, XADC_REG_THRESHOLD(min),
+		xadc->threshold[min]);
+	if (ret)
+		goto out_unlock;
+	ret = _xadc_write_adc_reg(xadc, XADC_REG_THRESHOLD(max),
+		xadc->threshold[max]);
+	if (ret)
+		goto out_unlock;
+
+	xadc->alarm_mask |= XADC_ALARM_TEMP_MASK;
+	ret = _xadc_update_alarms(xadc);
+
+out_unlock:
+	mutex_unlock(&xadc->mutex);
+
+	return ret;
+}
+
+static const struct thermal_zone_of_device_ops xadc_thermal_ops = {
+	.get_temp = xadc_thermal_get_temp,
+	.set_trips = xadc_thermal_set_trips,
+};
+
+static void xadc_thermal_worker(struct work_struct *work)
+{
+	struct xadc *xadc = container_of(work, struct xadc, thermal_work);
+
+	thermal_zone_device_update(xadc->tz, THERMAL_EVENT_UNSPECIFIED);
+}
+
 static int xadc_read_raw(struct iio_dev *indio_dev,
 	struct iio_chan_spec const *chan, int *val, int *val2, long info)
 {
@@ -822,7 +1024,7 @@ static int xadc_read_raw(struct iio_dev *indio_dev,
 	case IIO_CHAN_INFO_RAW:
 		if (iio_buffer_enabled(indio_dev))
 			return -EBUSY;
-		ret = xadc_read_adc_reg(xadc, chan->address, &val16);
+		ret = xadc_read_cached_adc_reg(xadc, chan->address, &val16);
 		if (ret < 0)
 			return ret;
 
@@ -1163,6 +1365,7 @@ static int xadc_probe(struct platform_device *pdev)
 	mutex_init(&xadc->mutex);
 	spin_lock_init(&xadc->lock);
 	INIT_DELAYED_WORK(&xadc->zynq_unmask_work, xadc_zynq_unmask_worker);
+	INIT_WORK(&xadc->thermal_work, xadc_thermal_worker);
 
 	mem = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	xadc->base = devm_ioremap_resource(&pdev->dev, mem);
@@ -1185,7 +1388,15 @@ static int xadc_probe(struct platform_device *pdev)
 			&xadc_buffer_ops);
 		if (ret)
 			goto err_device_free;
+	}
 
+	/*
+	 * The internal triggers are driven by the end of sequence interrupt,
+	 * which only the AXI interface has. On ZYNQ the sequencer keeps
+	 * converting in continuous mode and any external trigger (e.g. a
+	 * hrtimer) samples the latest results.
+	 */
+	if (xadc->ops->flags & XADC_FLAGS_EOS_TRIGGER) {
 		xadc->convst_trigger = xadc_alloc_trigger(indio_dev, "convst");
 		if (IS_ERR(xadc->convst_trigger)) {
 			ret = PTR_ERR(xadc->convst_trigger);
@@ -1258,23 +1469,37 @@ static int xadc_probe(struct platform_device *pdev)
 	/* Go to non-buffered mode */
 	xadc_postdisable(indio_dev);
 
+	/* A thermal zone is optional, there is none without device tree data */
+	xadc->tz = thermal_zone_of_sensor_register(&pdev->dev, 0, xadc,
+		&xadc_thermal_ops);
+	if (IS_ERR(xadc->tz)) {
+		ret = PTR_ERR(xadc->tz);
+		xadc->tz = NULL;
+		if (ret != -ENODEV)
+			goto err_free_irq;
+	}
+
 	ret = iio_device_register(indio_dev);
 	if (ret)
-		goto err_free_irq;
+		goto err_thermal_unregister;
 
 	platform_set_drvdata(pdev, indio_dev);
 
 	return 0;
 
+err_thermal_unregister:
+	if (xadc->tz)
+		thermal_zone_of_sensor_unregister(&pdev->dev, xadc->tz);
 err_free_irq:
 	free_irq(irq, indio_dev);
+	cancel_work_sync(&xadc->thermal_work);
 err_clk_disable_unprepare:
 	clk_disable_unprepare(xadc->clk);
 err_free_samplerate_trigger:
-	if (xadc->ops->flags & XADC_FLAGS_BUFFERED)
+	if (xadc->ops->flags & XADC_FLAGS_EOS_TRIGGER)
 		iio_trigger_free(xadc->samplerate_trigger);
 err_free_convst_trigger:
-	if (xadc->ops->flags & XADC_FLAGS_BUFFERED)
+	if (xadc->ops->flags & XADC_FLAGS_EOS_TRIGGER)
 		iio_trigger_free(xadc->convst_trigger);
 err_triggered_buffer_cleanup:
 	if (xadc->ops->flags & XADC_FLAGS_BUFFERED)
@@ -1292,15 +1517,20 @@ static int xadc_remove(struct platform_device *pdev)
 	int irq = platform_get_irq(pdev, 0);
 
 	iio_device_unregister(indio_dev);
-	if (xadc->ops->flags & XADC_FLAGS_BUFFERED) {
+	if (xadc->tz)
+		thermal_zone_of_sensor_unregister(&pdev->dev, xadc->tz);
+	if (xadc->ops->flags & XADC_FLAGS_EOS_TRIGGER) {
 		iio_trigger_free(xadc->samplerate_trigger);
 		iio_trigger_free(xadc->convst_trigger);
-		iio_triggered_buffer_cleanup(indio_dev);
 	}
+	if (xadc->ops->flags & XADC_FLAGS_BUFFERED)
+		iio_triggered_buffer_cleanup(indio_dev);
 	free_irq(irq, indio_dev);
+	cancel_work_sync(&xadc->thermal_work);
 	clk_disable_unprepare(xadc->clk);
 	cancel_delayed_work(&xadc->zynq_unmask_work);
 	kfree(xadc->data);
+	kfree(xadc->scan_regs);
 	kfree(indio_dev->channels);
 
 	return 0;
@@ -30,11 +30,18 @@ static const struct iio_chan_spec *xadc_event_to_channel(
 
 static void xadc_handle_event(struct iio_dev *indio_dev, unsigned int event)
 {
+	struct xadc *xadc = iio_priv(indio_dev);
 	const struct iio_chan_spec *chan;
 
-	/* Temperature threshold error, we don't handle this yet */
-	if (event == 0)
+	/*
+	 * The temperature alarm is driven by the trip window of the thermal
+	 * zone, the thermal core reevaluates the zone when it goes off.
+	 */
+	if (event == 0) {
+		if (xadc->tz)
+			schedule_work(&xadc->thermal_work);
 		return;
+	}
 
 	chan = xadc_event_to_channel(indio_dev, event);
 
@@ -122,27 +129,17 @@ int xadc_read_event_config(struct iio_dev *indio_dev,
 	return (bool)(xadc->alarm_mask & xadc_get_alarm_mask(chan));
 }
 
-int xadc_write_event_config(struct iio_dev *indio_dev,
-	const struct iio_chan_spec *chan, enum iio_event_type type,
-	enum iio_event_direction dir, int state)
+/* Apply alarm_mask to the interrupt mask and the alarm enables */
+int _xadc_update_alarms(struct xadc *xadc)
 {
-	unsigned int alarm = xadc_get_alarm_mask(chan);
-	struct xadc *xadc = iio_priv(indio_dev);
 	uint16_t cfg, old_cfg;
 	int ret;
 
-	mutex_lock(&xadc->mutex);
-
-	if (state)
-		xadc->alarm_mask |= alarm;
-	else
-		xadc->alarm_mask &= ~alarm;
-
 	xadc->ops->update_alarm(xadc, xadc->alarm_mask);
 
 	ret = _xadc_read_adc_reg(xadc, XADC_REG_CONF1, &cfg);
 	if (ret)
-		goto err_out;
+		return ret;
 
 	old_cfg = cfg;
 	cfg |= XADC_CONF1_ALARM_MASK;
@@ -152,7 +149,26 @@ int xadc_write_event_config(struct iio_dev *indio_dev,
 	if (old_cfg != cfg)
 		ret = _xadc_write_adc_reg(xadc, XADC_REG_CONF1, cfg);
 
-err_out:
+	return ret;
+}
+
+int xadc_write_event_config(struct iio_dev *indio_dev,
+	const struct iio_chan_spec *chan, enum iio_event_type type,
+	enum iio_event_direction dir, int state)
+{
+	unsigned int alarm = xadc_get_alarm_mask(chan);
+	struct xadc *xadc = iio_priv(indio_dev);
+	int ret;
+
+	mutex_lock(&xadc->mutex);
+
+	if (state)
+		xadc->alarm_mask |= alarm;
+	else
+		xadc->alarm_mask &= ~alarm;
+
+	ret = _xadc_update_alarms(xadc);
+
 	mutex_unlock(&xadc->mutex);
 
 	return ret;
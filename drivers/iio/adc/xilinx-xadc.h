@@ -16,10 +16,13 @@
 
 struct iio_dev;
 struct clk;
+struct xadc;
 struct xadc_ops;
 struct platform_device;
+struct thermal_zone_device;
 
 void xadc_handle_events(struct iio_dev *indio_dev, unsigned long events);
+int _xadc_update_alarms(struct xadc *xadc);
 
 int xadc_read_event_config(struct iio_dev *indio_dev,
 	const struct iio_chan_spec *chan, enum iio_event_type type,
@@ -42,6 +45,9 @@ enum xadc_external_mux_mode {
 	XADC_EXTERNAL_MUX_DUAL,
 };
 
+/* Conversion results, the channels read_raw can serve from the cache */
+#define XADC_NUM_STATUS_REGS	0x20
+
 struct xadc {
 	void __iomem *base;
 	struct clk *clk;
@@ -53,6 +59,11 @@ struct xadc {
 	unsigned int alarm_mask;
 
 	uint16_t *data;
+	unsigned int *scan_regs;
+
+	uint16_t status_cache[XADC_NUM_STATUS_REGS];
+	unsigned long status_cache_stamp;
+	bool status_cache_valid;
 
 	struct iio_trigger *trigger;
 	struct iio_trigger *convst_trigger;
@@ -64,6 +75,9 @@ struct xadc {
 	unsigned int zynq_intmask;
 	struct delayed_work zynq_unmask_work;
 
+	struct thermal_zone_device *tz;
+	struct work_struct thermal_work;
+
 	struct mutex mutex;
 	spinlock_t lock;
 
@@ -72,6 +86,8 @@ struct xadc {
 
 struct xadc_ops {
 	int (*read)(struct xadc *, unsigned int, uint16_t *);
+	int (*read_multi)(struct xadc *, const unsigned int *, uint16_t *,
+			unsigned int);
 	int (*write)(struct xadc *, unsigned int, uint16_t);
 	int (*setup)(struct platform_device *pdev, struct iio_dev *indio_dev,
 			int irq);
@@ -107,6 +123,32 @@ static inline int xadc_read_adc_reg(struct xadc *xadc, unsigned int reg,
 	return ret;
 }
 
+static inline int _xadc_read_adc_regs(struct xadc *xadc,
+	const unsigned int *regs, uint16_t *vals, unsigned int n)
+{
+	unsigned int i;
+	int ret = 0;
+
+	lockdep_assert_held(&xadc->mutex);
+	if (xadc->ops->read_multi)
+		return xadc->ops->read_multi(xadc, regs, vals, n);
+
+	for (i = 0; i < n && !ret; i++)
+		ret = _xadc_read_adc_reg(xadc, regs[i], &vals[i]);
+	return ret;
+}
+
+static inline int xadc_read_adc_regs(struct xadc *xadc,
+	const unsigned int *regs, uint16_t *vals, unsigned int n)
+{
+	int ret;
+
+	mutex_lock(&xadc->mutex);
+	ret = _xadc_read_adc_regs(xadc, regs, vals, n);
+	mutex_unlock(&xadc->mutex);
+	return ret;
+}
+
 static inline int xadc_write_adc_reg(struct xadc *xadc, unsigned int reg,
 	uint16_t val)
 {
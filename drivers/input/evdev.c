@@ -13,8 +13,11 @@
 #define EVDEV_MINOR_BASE	64
 #define EVDEV_MINORS		32
 #define EVDEV_MIN_BUFFER_SIZE	64U
+#define EVDEV_MAX_BUFFER_SIZE	8192U
 #define EVDEV_BUF_PACKETS	8
+#define EVDEV_MAX_BATCH_US	USEC_PER_SEC
 
+#include <linux/hrtimer.h>
 #include <linux/poll.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
@@ -59,8 +62,14 @@ struct evdev_client {
 	unsigned int clk_type;
 	bool revoked;
 	unsigned long *evmasks[EV_CNT];
+	/* wakeup batching, disabled while batch_time is 0 */
+	struct hrtimer batch_timer;
+	ktime_t batch_time;
+	unsigned int batch_packets;
+	unsigned int batch_queued;
+	bool batch_ready;
 	unsigned int bufsize;
-	struct input_event buffer[];
+	struct input_event *buffer;
 };
 
 static size_t evdev_get_mask_cnt(unsigned int type)
@@ -228,6 +237,132 @@ static int evdev_set_clk_type(struct evdev_client *client, unsigned int clkid)
 	return 0;
 }
 
+/*
+ * Account a completed packet against the client's batch, caller must hold
+ * client->buffer_lock. Returns true if the reader should be woken up.
+ */
+static bool __evdev_batch_packet(struct evdev_client *client)
+{
+	if (!client->batch_time || client->batch_ready)
+		return true;
+
+	client->batch_queued++;
+	if (client->batch_packets &&
+	    client->batch_queued >= client->batch_packets) {
+		client->batch_ready = true;
+		hrtimer_try_to_cancel(&client->batch_timer);
+		return true;
+	}
+
+	/* The first packet of a batch bounds how long the others may wait */
+	if (client->batch_queued == 1)
+		hrtimer_start(&client->batch_timer, client->batch_time,
+			      HRTIMER_MODE_REL);
+
+	return false;
+}
+
+static enum hrtimer_restart evdev_batch_timeout(struct hrtimer *timer)
+{
+	struct evdev_client *client =
+		container_of(timer, struct evdev_client, batch_timer);
+	unsigned long flags;
+	bool wakeup;
+
+	spin_lock_irqsave(&client->buffer_lock, flags);
+	wakeup = client->packet_head != client->tail;
+	if (wakeup)
+		client->batch_ready = true;
+	spin_unlock_irqrestore(&client->buffer_lock, flags);
+
+	if (wakeup) {
+		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+		wake_up_interruptible(&client->evdev->wait);
+	}
+
+	return HRTIMER_NORESTART;
+}
+
+/* Whether there is a packet for the reader and its batch is complete */
+static bool evdev_client_ready(struct evdev_client *client)
+{
+	return client->packet_head != client->tail &&
+		(!client->batch_time || client->batch_ready);
+}
+
+static struct input_event *evdev_alloc_buffer(unsigned int bufsize)
+{
+	size_t size = bufsize * sizeof(struct input_event);
+	struct input_event *buffer;
+
+	buffer = kzalloc(size, GFP_KERNEL | __GFP_NOWARN);
+	if (!buffer)
+		buffer = vzalloc(size);
+
+	return buffer;
+}
+
+static int evdev_set_batch(struct evdev_client *client,
+			   const struct input_batch *batch)
+{
+	struct input_event *buffer = NULL, *old = NULL;
+	unsigned int bufsize = 0;
+	unsigned long flags;
+
+	if (batch->reserved ||
+	    batch->max_delay_us > EVDEV_MAX_BATCH_US ||
+	    (!batch->max_delay_us && batch->max_packets) ||
+	    batch->buffer_size > EVDEV_MAX_BUFFER_SIZE)
+		return -EINVAL;
+
+	if (batch->buffer_size) {
+		bufsize = roundup_pow_of_two(max(batch->buffer_size,
+						 EVDEV_MIN_BUFFER_SIZE));
+		if (bufsize != client->bufsize) {
+			buffer = evdev_alloc_buffer(bufsize);
+			if (!buffer)
+				return -ENOMEM;
+		}
+	}
+
+	hrtimer_cancel(&client->batch_timer);
+
+	spin_lock_irqsave(&client->buffer_lock, flags);
+
+	client->batch_time = ns_to_ktime((u64)batch->max_delay_us *
+					 NSEC_PER_USEC);
+	client->batch_packets = batch->max_packets;
+	client->batch_queued = 0;
+	/* Whatever is queued already is handed out without further delay */
+	client->batch_ready = client->packet_head != client->tail;
+
+	if (buffer) {
+		old = client->buffer;
+		client->buffer = buffer;
+		client->bufsize = bufsize;
+
+		/*
+		 * Like a clock change, the resize drops pending events and
+		 * queues SYN_DROPPED, but only if the queue was not empty.
+		 */
+		if (client->head != client->tail) {
+			client->head = client->tail = client->packet_head = 0;
+			__evdev_queue_syn_dropped(client);
+		} else {
+			client->head = client->tail = client->packet_head = 0;
+		}
+	}
+
+	spin_unlock_irqrestore(&client->buffer_lock, flags);
+
+	if (client->batch_ready)
+		wake_up_interruptible(&client->evdev->wait);
+
+	kvfree(old);
+
+	return 0;
+}
+
 static void __pass_event(struct evdev_client *client,
 			 const struct input_event *event)
 {
@@ -251,7 +386,8 @@ static void __pass_event(struct evdev_client *client,
 
 	if (event->type == EV_SYN && event->code == SYN_REPORT) {
 		client->packet_head = client->head;
-		kill_fasync(&client->fasync, SIGIO, POLL_IN);
+		if (__evdev_batch_packet(client))
+			kill_fasync(&client->fasync, SIGIO, POLL_IN);
 	}
 }
 
@@ -290,6 +426,9 @@ static void evdev_pass_values(struct evdev_client *client,
 		__pass_event(client, &event);
 	}
 
+	if (client->batch_time && !client->batch_ready)
+		wakeup = false;
+
 	spin_unlock(&client->buffer_lock);
 
 	if (wakeup)
@@ -473,11 +612,13 @@ static int evdev_release(struct inode *inode, struct file *file)
 	mutex_unlock(&evdev->mutex);
 
 	evdev_detach_client(evdev, client);
+	hrtimer_cancel(&client->batch_timer);
 
 	for (i = 0; i < EV_CNT; ++i)
 		kfree(client->evmasks[i]);
 
-	kvfree(client);
+	kvfree(client->buffer);
+	kfree(client);
 
 	evdev_close_device(evdev);
 
@@ -497,19 +638,23 @@ static int evdev_open(struct inode *inode, struct file *file)
 {
 	struct evdev *evdev = container_of(inode->i_cdev, struct evdev, cdev);
 	unsigned int bufsize = evdev_compute_buffer_size(evdev->handle.dev);
-	unsigned int size = sizeof(struct evdev_client) +
-					bufsize * sizeof(struct input_event);
 	struct evdev_client *client;
 	int error;
 
-	client = kzalloc(size, GFP_KERNEL | __GFP_NOWARN);
-	if (!client)
-		client = vzalloc(size);
+	client = kzalloc(sizeof(*client), GFP_KERNEL);
 	if (!client)
 		return -ENOMEM;
 
+	client->buffer = evdev_alloc_buffer(bufsize);
+	if (!client->buffer) {
+		kfree(client);
+		return -ENOMEM;
+	}
+
 	client->bufsize = bufsize;
 	spin_lock_init(&client->buffer_lock);
+	hrtimer_init(&client->batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	client->batch_timer.function = evdev_batch_timeout;
 	client->evdev = evdev;
 	evdev_attach_client(evdev, client);
 
@@ -524,7 +669,8 @@ static int evdev_open(struct inode *inode, struct file *file)
 
  err_free_client:
 	evdev_detach_client(evdev, client);
-	kvfree(client);
+	kvfree(client->buffer);
+	kfree(client);
 	return error;
 }
 
@@ -576,6 +722,12 @@ static int evdev_fetch_next_event(struct evdev_client *client,
 	if (have_event) {
 		*event = client->buffer[client->tail++];
 		client->tail &= client->bufsize - 1;
+
+		/* Start a new batch once the reader caught up */
+		if (client->packet_head == client->tail) {
+			client->batch_queued = 0;
+			client->batch_ready = false;
+		}
 	}
 
 	spin_unlock_irq(&client->buffer_lock);
@@ -624,7 +776,7 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 
 		if (!(file->f_flags & O_NONBLOCK)) {
 			error = wait_event_interruptible(evdev->wait,
-					client->packet_head != client->tail ||
+					evdev_client_ready(client) ||
 					!evdev->exist || client->revoked);
 			if (error)
 				return error;
@@ -648,7 +800,7 @@ static unsigned int evdev_poll(struct file *file, poll_table *wait)
 	else
 		mask = POLLHUP | POLLERR;
 
-	if (client->packet_head != client->tail)
+	if (evdev_client_ready(client))
 		mask |= POLLIN | POLLRDNORM;
 
 	return mask;
@@ -1064,6 +1216,7 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 	struct input_dev *dev = evdev->handle.dev;
 	struct input_absinfo abs;
 	struct input_mask mask;
+	struct input_batch batch;
 	struct ff_effect effect;
 	int __user *ip = (int __user *)p;
 	unsigned int i, t, u, v;
@@ -1155,6 +1308,12 @@ static long evdev_do_ioctl(struct file *file, unsigned int cmd,
 
 		return evdev_set_clk_type(client, i);
 
+	case EVIOCSBATCH:
+		if (copy_from_user(&batch, p, sizeof(batch)))
+			return -EFAULT;
+
+		return evdev_set_batch(client, &batch);
+
 	case EVIOCGKEYCODE:
 		return evdev_handle_get_keycode(dev, p);
 
@@ -30,7 +30,8 @@
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
-#include <linux/jiffies.h>
+#include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/fixp-arith.h>
 
 MODULE_LICENSE("GPL");
@@ -51,16 +52,16 @@ struct ml_effect_state {
 	struct ff_effect *effect;
 	unsigned long flags;	/* effect state (STARTED, PLAYING, etc) */
 	int count;		/* loop count of the effect */
-	unsigned long play_at;	/* start time */
-	unsigned long stop_at;	/* stop time */
-	unsigned long adj_at;	/* last time the effect was sent */
+	ktime_t play_at;	/* start time */
+	ktime_t stop_at;	/* stop time */
+	ktime_t adj_at;		/* last time the effect was sent */
 };
 
 struct ml_device {
 	void *private;
 	struct ml_effect_state states[FF_MEMLESS_EFFECTS];
 	int gain;
-	struct timer_list timer;
+	struct tasklet_hrtimer timer;
 	struct input_dev *dev;
 
 	int (*play_effect)(struct input_dev *dev, void *data,
@@ -83,35 +84,45 @@ static const struct ff_envelope *get_envelope(const struct ff_effect *effect)
 	}
 }
 
+/*
+ * Set the start and stop time of an effect about to be played
+ */
+static void ml_set_play_time(struct ml_effect_state *state, ktime_t now)
+{
+	state->play_at = ktime_add_ms(now, state->effect->replay.delay);
+	state->stop_at = ktime_add_ms(state->play_at,
+				      state->effect->replay.length);
+}
+
 /*
  * Check for the next time envelope requires an update on memoryless devices
  */
-static unsigned long calculate_next_time(struct ml_effect_state *state)
+static ktime_t calculate_next_time(struct ml_effect_state *state)
 {
 	const struct ff_envelope *envelope = get_envelope(state->effect);
-	unsigned long attack_stop, fade_start, next_fade;
+	ktime_t attack_stop, fade_start, next_fade;
 
 	if (envelope->attack_length) {
-		attack_stop = state->play_at +
-			msecs_to_jiffies(envelope->attack_length);
-		if (time_before(state->adj_at, attack_stop))
-			return state->adj_at +
-					msecs_to_jiffies(FF_ENVELOPE_INTERVAL);
+		attack_stop = ktime_add_ms(state->play_at,
+					   envelope->attack_length);
+		if (ktime_before(state->adj_at, attack_stop))
+			return ktime_add_ms(state->adj_at,
+					    FF_ENVELOPE_INTERVAL);
 	}
 
 	if (state->effect->replay.length) {
 		if (envelope->fade_length) {
 			/* check when fading should start */
-			fade_start = state->stop_at -
-					msecs_to_jiffies(envelope->fade_length);
+			fade_start = ktime_sub_ms(state->stop_at,
+						  envelope->fade_length);
 
-			if (time_before(state->adj_at, fade_start))
+			if (ktime_before(state->adj_at, fade_start))
 				return fade_start;
 
 			/* already fading, advance to next checkpoint */
-			next_fade = state->adj_at +
-					msecs_to_jiffies(FF_ENVELOPE_INTERVAL);
-			if (time_before(next_fade, state->stop_at))
+			next_fade = ktime_add_ms(state->adj_at,
+						 FF_ENVELOPE_INTERVAL);
+			if (ktime_before(next_fade, state->stop_at))
 				return next_fade;
 		}
 
@@ -121,12 +132,17 @@ static unsigned long calculate_next_time(struct ml_effect_state *state)
 	return state->play_at;
 }
 
+/*
+ * Effects start and stop to the millisecond the application asked for,
+ * independent of HZ, so the timer is an hrtimer. It is a tasklet_hrtimer
+ * so that ->play_effect() is still called from softirq context.
+ */
 static void ml_schedule_timer(struct ml_device *ml)
 {
 	struct ml_effect_state *state;
-	unsigned long now = jiffies;
-	unsigned long earliest = 0;
-	unsigned long next_at;
+	ktime_t now = ktime_get();
+	ktime_t earliest = 0;
+	ktime_t next_at;
 	int events = 0;
 	int i;
 
@@ -144,17 +160,21 @@ static void ml_schedule_timer(struct ml_device *ml)
 		else
 			next_at = state->play_at;
 
-		if (time_before_eq(now, next_at) &&
-		    (++events == 1 || time_before(next_at, earliest)))
+		if (!ktime_after(now, next_at) &&
+		    (++events == 1 || ktime_before(next_at, earliest)))
 			earliest = next_at;
 	}
 
+	/*
+	 * With dev->event_lock held we cannot wait for a running callback,
+	 * which takes the lock itself and reschedules when it gets it.
+	 */
 	if (!events) {
 		pr_debug("no actions\n");
-		del_timer(&ml->timer);
+		hrtimer_try_to_cancel(&ml->timer.timer);
 	} else {
 		pr_debug("timer set\n");
-		mod_timer(&ml->timer, earliest);
+		tasklet_hrtimer_start(&ml->timer, earliest, HRTIMER_MODE_ABS);
 	}
 }
 
@@ -165,26 +185,27 @@ static int apply_envelope(struct ml_effect_state *state, int value,
 			  struct ff_envelope *envelope)
 {
 	struct ff_effect *effect = state->effect;
-	unsigned long now = jiffies;
+	ktime_t now = ktime_get();
 	int time_from_level;
 	int time_of_envelope;
 	int envelope_level;
 	int difference;
 
 	if (envelope->attack_length &&
-	    time_before(now,
-			state->play_at + msecs_to_jiffies(envelope->attack_length))) {
+	    ktime_before(now, ktime_add_ms(state->play_at,
+					   envelope->attack_length))) {
 		pr_debug("value = 0x%x, attack_level = 0x%x\n",
 			 value, envelope->attack_level);
-		time_from_level = jiffies_to_msecs(now - state->play_at);
+		time_from_level = ktime_ms_delta(now, state->play_at);
 		time_of_envelope = envelope->attack_length;
 		envelope_level = min_t(u16, envelope->attack_level, 0x7fff);
 
 	} else if (envelope->fade_length && effect->replay.length &&
-		   time_after(now,
-			      state->stop_at - msecs_to_jiffies(envelope->fade_length)) &&
-		   time_before(now, state->stop_at)) {
-		time_from_level = jiffies_to_msecs(state->stop_at - now);
+		   ktime_after(now,
+			       ktime_sub_ms(state->stop_at,
+					    envelope->fade_length)) &&
+		   ktime_before(now, state->stop_at)) {
+		time_from_level = ktime_ms_delta(state->stop_at, now);
 		time_of_envelope = envelope->fade_length;
 		envelope_level = min_t(u16, envelope->fade_level, 0x7fff);
 	} else
@@ -341,6 +362,7 @@ static int ml_get_combo_effect(struct ml_device *ml,
 {
 	struct ff_effect *effect;
 	struct ml_effect_state *state;
+	ktime_t now = ktime_get();
 	int effect_type;
 	int i;
 
@@ -356,7 +378,7 @@ static int ml_get_combo_effect(struct ml_device *ml,
 		if (!test_bit(FF_EFFECT_STARTED, &state->flags))
 			continue;
 
-		if (time_before(jiffies, state->play_at))
+		if (ktime_before(now, state->play_at))
 			continue;
 
 		/*
@@ -377,21 +399,17 @@ static int ml_get_combo_effect(struct ml_device *ml,
 			__clear_bit(FF_EFFECT_PLAYING, &state->flags);
 			__clear_bit(FF_EFFECT_STARTED, &state->flags);
 		} else if (effect->replay.length &&
-			   time_after_eq(jiffies, state->stop_at)) {
+			   !ktime_before(now, state->stop_at)) {
 
 			__clear_bit(FF_EFFECT_PLAYING, &state->flags);
 
-			if (--state->count <= 0) {
+			if (--state->count <= 0)
 				__clear_bit(FF_EFFECT_STARTED, &state->flags);
-			} else {
-				state->play_at = jiffies +
-					msecs_to_jiffies(effect->replay.delay);
-				state->stop_at = state->play_at +
-					msecs_to_jiffies(effect->replay.length);
-			}
+			else
+				ml_set_play_time(state, now);
 		} else {
 			__set_bit(FF_EFFECT_PLAYING, &state->flags);
-			state->adj_at = jiffies;
+			state->adj_at = now;
 			ml_combine_effects(combo_effect, state, ml->gain);
 		}
 	}
@@ -412,10 +430,11 @@ static void ml_play_effects(struct ml_device *ml)
 	ml_schedule_timer(ml);
 }
 
-static void ml_effect_timer(unsigned long timer_data)
+static enum hrtimer_restart ml_effect_timer(struct hrtimer *timer)
 {
-	struct input_dev *dev = (struct input_dev *)timer_data;
-	struct ml_device *ml = dev->ff->private;
+	struct ml_device *ml = container_of(timer, struct ml_device,
+					    timer.timer);
+	struct input_dev *dev = ml->dev;
 	unsigned long flags;
 
 	pr_debug("timer: updating effects\n");
@@ -423,6 +442,8 @@ static void ml_effect_timer(unsigned long timer_data)
 	spin_lock_irqsave(&dev->event_lock, flags);
 	ml_play_effects(ml);
 	spin_unlock_irqrestore(&dev->event_lock, flags);
+
+	return HRTIMER_NORESTART;
 }
 
 /*
@@ -454,10 +475,7 @@ static int ml_ff_playback(struct input_dev *dev, int effect_id, int value)
 
 		__set_bit(FF_EFFECT_STARTED, &state->flags);
 		state->count = value;
-		state->play_at = jiffies +
-				 msecs_to_jiffies(state->effect->replay.delay);
-		state->stop_at = state->play_at +
-				 msecs_to_jiffies(state->effect->replay.length);
+		ml_set_play_time(state, ktime_get());
 		state->adj_at = state->play_at;
 
 	} else {
@@ -484,10 +502,7 @@ static int ml_ff_upload(struct input_dev *dev,
 
 	if (test_bit(FF_EFFECT_STARTED, &state->flags)) {
 		__clear_bit(FF_EFFECT_PLAYING, &state->flags);
-		state->play_at = jiffies +
-				 msecs_to_jiffies(state->effect->replay.delay);
-		state->stop_at = state->play_at +
-				 msecs_to_jiffies(state->effect->replay.length);
+		ml_set_play_time(state, ktime_get());
 		state->adj_at = state->play_at;
 		ml_schedule_timer(ml);
 	}
@@ -501,6 +516,7 @@ static void ml_ff_destroy(struct ff_device *ff)
 {
 	struct ml_device *ml = ff->private;
 
+	tasklet_hrtimer_cancel(&ml->timer);
 	kfree(ml->private);
 }
 
@@ -526,7 +542,8 @@ int input_ff_create_memless(struct input_dev *dev, void *data,
 	ml->private = data;
 	ml->play_effect = play_effect;
 	ml->gain = 0xffff;
-	setup_timer(&ml->timer, ml_effect_timer, (unsigned long)dev);
+	tasklet_hrtimer_init(&ml->timer, ml_effect_timer,
+			     CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
 
 	set_bit(FF_GAIN, dev->ffbit);
 
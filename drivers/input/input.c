@@ -439,6 +439,32 @@ void input_event(struct input_dev *dev,
 }
 EXPORT_SYMBOL(input_event);
 
+/**
+ * input_events() - report a batch of input events
+ * @dev: device that generated the events
+ * @vals: the events, usually ending with a SYN_REPORT
+ * @count: number of events in @vals
+ *
+ * Equivalent to calling input_event() for each element of @vals, but
+ * takes the device event lock only once, so a complete packet reaches
+ * the handlers with a single lock round trip. Meant for sources that
+ * already hold a whole packet, such as uinput writes.
+ */
+void input_events(struct input_dev *dev,
+		  const struct input_value *vals, unsigned int count)
+{
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&dev->event_lock, flags);
+	for (i = 0; i < count; i++)
+		if (is_event_supported(vals[i].type, dev->evbit, EV_MAX))
+			input_handle_event(dev, vals[i].type, vals[i].code,
+					   vals[i].value);
+	spin_unlock_irqrestore(&dev->event_lock, flags);
+}
+EXPORT_SYMBOL(input_events);
+
 /**
  * input_inject_event() - send input event from input handler
  * @handle: input handle to send event through
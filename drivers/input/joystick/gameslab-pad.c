@@ -0,0 +1,288 @@
+/*
+ * Gameslab gamepad driver
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+/*
+ * The buttons and the D-pad are plain GPIO inputs, on the Gameslab all of
+ * them sit in PS GPIO banks. Every line gets a both-edge interrupt. The first
+ * edge samples all lines at once and reports the new state right away, then
+ * a short debounce timer is armed and restarted by every further edge. When
+ * it finally expires the lines are sampled again, so whatever the contacts
+ * settled on is reported even if the first sample caught a bounce.
+ *
+ * All lines are read through one gpiod_get_array_value() call, which the
+ * GPIO controller may serve with a single register read per bank, and every
+ * sample ends in at most one SYN_REPORT.
+ */
+
+#include <linux/gpio/consumer.h>
+#include <linux/hrtimer.h>
+#include <linux/input.h>
+#include <linux/interrupt.h>
+#include <linux/irq.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/property.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#define DRIVER_NAME	"gameslab-pad"
+
+#define GSPAD_DEBOUNCE_US_DEFAULT	2000
+
+/* D-pad lines, in the order they are listed in dpad-gpios */
+enum {
+	GSPAD_DPAD_UP,
+	GSPAD_DPAD_DOWN,
+	GSPAD_DPAD_LEFT,
+	GSPAD_DPAD_RIGHT,
+	GSPAD_DPAD_LINES,
+};
+
+struct gspad {
+	struct input_dev *input;
+
+	struct gpio_desc **descs;
+	int *values;
+	int *irqs;
+	unsigned int nbuttons;
+	unsigned int nlines;
+	bool has_dpad;
+
+	u32 *codes;
+
+	struct hrtimer debounce;
+	ktime_t debounce_time;
+	spinlock_t lock;
+};
+
+static void gspad_report(struct gspad *pad)
+{
+	const int *dpad = pad->values + pad->nbuttons;
+	unsigned int i;
+
+	if (gpiod_get_array_value(pad->nlines, pad->descs, pad->values))
+		return;
+
+	for (i = 0; i < pad->nbuttons; i++)
+		input_report_key(pad->input, pad->codes[i], pad->values[i]);
+
+	if (pad->has_dpad) {
+		input_report_abs(pad->input, ABS_HAT0X,
+				 dpad[GSPAD_DPAD_RIGHT] - dpad[GSPAD_DPAD_LEFT]);
+		input_report_abs(pad->input, ABS_HAT0Y,
+				 dpad[GSPAD_DPAD_DOWN] - dpad[GSPAD_DPAD_UP]);
+	}
+
+	/* The input core drops the report if nothing changed */
+	input_sync(pad->input);
+}
+
+static enum hrtimer_restart gspad_debounce_expired(struct hrtimer *timer)
+{
+	struct gspad *pad = container_of(timer, struct gspad, debounce);
+	unsigned long flags;
+
+	spin_lock_irqsave(&pad->lock, flags);
+	gspad_report(pad);
+	spin_unlock_irqrestore(&pad->lock, flags);
+
+	return HRTIMER_NORESTART;
+}
+
+static irqreturn_t gspad_irq(int irq, void *dev_id)
+{
+	struct gspad *pad = dev_id;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pad->lock, flags);
+	/* Report the leading edge at once, later edges only extend the wait */
+	if (!hrtimer_active(&pad->debounce))
+		gspad_report(pad);
+	hrtimer_start(&pad->debounce, pad->debounce_time, HRTIMER_MODE_REL);
+	spin_unlock_irqrestore(&pad->lock, flags);
+
+	return IRQ_HANDLED;
+}
+
+static int gspad_open(struct input_dev *input)
+{
+	struct gspad *pad = input_get_drvdata(input);
+	unsigned long flags;
+	unsigned int i;
+
+	for (i = 0; i < pad->nlines; i++)
+		enable_irq(pad->irqs[i]);
+
+	spin_lock_irqsave(&pad->lock, flags);
+	gspad_report(pad);
+	spin_unlock_irqrestore(&pad->lock, flags);
+
+	return 0;
+}
+
+static void gspad_close(struct input_dev *input)
+{
+	struct gspad *pad = input_get_drvdata(input);
+	unsigned int i;
+
+	for (i = 0; i < pad->nlines; i++)
+		disable_irq(pad->irqs[i]);
+
+	hrtimer_cancel(&pad->debounce);
+}
+
+static int gspad_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct gpio_descs *buttons, *dpad;
+	struct input_dev *input;
+	struct gspad *pad;
+	unsigned int i;
+	u32 debounce_us;
+	int ret;
+
+	pad = devm_kzalloc(dev, sizeof(*pad), GFP_KERNEL);
+	if (!pad)
+		return -ENOMEM;
+
+	buttons = devm_gpiod_get_array(dev, "button", GPIOD_IN);
+	if (IS_ERR(buttons)) {
+		ret = PTR_ERR(buttons);
+		if (ret != -EPROBE_DEFER)
+			dev_err(dev, "failed to get button gpios: %d\n", ret);
+		return ret;
+	}
+
+	dpad = devm_gpiod_get_array_optional(dev, "dpad", GPIOD_IN);
+	if (IS_ERR(dpad)) {
+		ret = PTR_ERR(dpad);
+		if (ret != -EPROBE_DEFER)
+			dev_err(dev, "failed to get dpad gpios: %d\n", ret);
+		return ret;
+	}
+	if (dpad && dpad->ndescs != GSPAD_DPAD_LINES) {
+		dev_err(dev, "dpad needs %d gpios, got %u\n",
+			GSPAD_DPAD_LINES, dpad->ndescs);
+		return -EINVAL;
+	}
+
+	pad->nbuttons = buttons->ndescs;
+	pad->has_dpad = dpad != NULL;
+	pad->nlines = pad->nbuttons + (dpad ? dpad->ndescs : 0);
+
+	pad->codes = devm_kcalloc(dev, pad->nbuttons, sizeof(*pad->codes),
+				  GFP_KERNEL);
+	pad->descs = devm_kcalloc(dev, pad->nlines, sizeof(*pad->descs),
+				  GFP_KERNEL);
+	pad->values = devm_kcalloc(dev, pad->nlines, sizeof(*pad->values),
+				   GFP_KERNEL);
+	pad->irqs = devm_kcalloc(dev, pad->nlines, sizeof(*pad->irqs),
+				 GFP_KERNEL);
+	if (!pad->codes || !pad->descs || !pad->values || !pad->irqs)
+		return -ENOMEM;
+
+	ret = device_property_read_u32_array(dev, "linux,codes", pad->codes,
+					     pad->nbuttons);
+	if (ret) {
+		dev_err(dev, "failed to read linux,codes: %d\n", ret);
+		return ret;
+	}
+
+	for (i = 0; i < pad->nbuttons; i++)
+		pad->descs[i] = buttons->desc[i];
+	for (i = pad->nbuttons; i < pad->nlines; i++)
+		pad->descs[i] = dpad->desc[i - pad->nbuttons];
+
+	/* All lines are sampled from the interrupt handler */
+	for (i = 0; i < pad->nlines; i++) {
+		if (gpiod_cansleep(pad->descs[i])) {
+			dev_err(dev, "gpio %u may sleep, not supported\n", i);
+			return -EINVAL;
+		}
+	}
+
+	if (device_property_read_u32(dev, "debounce-interval-us",
+				     &debounce_us))
+		debounce_us = GSPAD_DEBOUNCE_US_DEFAULT;
+	pad->debounce_time = ns_to_ktime((u64)debounce_us * NSEC_PER_USEC);
+
+	spin_lock_init(&pad->lock);
+	hrtimer_init(&pad->debounce, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	pad->debounce.function = gspad_debounce_expired;
+
+	input = devm_input_allocate_device(dev);
+	if (!input)
+		return -ENOMEM;
+
+	pad->input = input;
+	input->name = "Gameslab Gamepad";
+	input->phys = DRIVER_NAME "/input0";
+	input->id.bustype = BUS_HOST;
+	input->open = gspad_open;
+	input->close = gspad_close;
+	input_set_drvdata(input, pad);
+
+	for (i = 0; i < pad->nbuttons; i++)
+		input_set_capability(input, EV_KEY, pad->codes[i]);
+
+	if (pad->has_dpad) {
+		input_set_abs_params(input, ABS_HAT0X, -1, 1, 0, 0);
+		input_set_abs_params(input, ABS_HAT0Y, -1, 1, 0, 0);
+	}
+
+	for (i = 0; i < pad->nlines; i++) {
+		ret = gpiod_to_irq(pad->descs[i]);
+		if (ret < 0) {
+			dev_err(dev, "no irq for gpio %u: %d\n", i, ret);
+			return ret;
+		}
+		pad->irqs[i] = ret;
+
+		/* Enabled by gspad_open() */
+		irq_set_status_flags(pad->irqs[i], IRQ_NOAUTOEN);
+		ret = devm_request_irq(dev, pad->irqs[i], gspad_irq,
+				       IRQF_TRIGGER_RISING |
+				       IRQF_TRIGGER_FALLING,
+				       DRIVER_NAME, pad);
+		if (ret) {
+			dev_err(dev, "failed to request irq %d: %d\n",
+				pad->irqs[i], ret);
+			return ret;
+		}
+	}
+
+	ret = input_register_device(input);
+	if (ret) {
+		dev_err(dev, "failed to register input device: %d\n", ret);
+		return ret;
+	}
+
+	platform_set_drvdata(pdev, pad);
+
+	return 0;
+}
+
+static const struct of_device_id gspad_of_match[] = {
+	{ .compatible = "gameslab,gamepad" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, gspad_of_match);
+
+static struct platform_driver gspad_driver = {
+	.probe = gspad_probe,
+	.driver = {
+		.name = DRIVER_NAME,
+		.of_match_table = gspad_of_match,
+	},
+};
+module_platform_driver(gspad_driver);
+
+MODULE_DESCRIPTION("Gameslab gamepad driver");
+MODULE_LICENSE("GPL v2");
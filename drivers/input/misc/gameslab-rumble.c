@@ -0,0 +1,293 @@
+/*
+ * Gameslab rumble motor driver
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+/*
+ * The Gameslab has two eccentric rotating mass motors, a large one for the
+ * strong and a small one for the weak rumble magnitude, each driven through
+ * a low side switch by a PWM output. The motor speed follows the duty cycle.
+ *
+ * Effects are scheduled by ff-memless. ->play_effect() runs in atomic
+ * context while PWM and regulator calls may sleep, so the duty cycles are
+ * applied from a work item on the high priority workqueue, which runs
+ * right after the effect starts or stops.
+ */
+
+#include <linux/input.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/pwm.h>
+#include <linux/regulator/consumer.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#define DRIVER_NAME	"gameslab-rumble"
+
+enum {
+	GSRUMBLE_STRONG,
+	GSRUMBLE_WEAK,
+	GSRUMBLE_MOTORS,
+};
+
+static const char * const gsrumble_pwm_names[GSRUMBLE_MOTORS] = {
+	[GSRUMBLE_STRONG]	= "strong",
+	[GSRUMBLE_WEAK]		= "weak",
+};
+
+struct gsrumble {
+	struct input_dev *input;
+	struct pwm_device *pwm[GSRUMBLE_MOTORS];
+	struct regulator *vcc;
+	struct work_struct work;
+
+	/* Magnitudes, written under input->event_lock */
+	u16 level[GSRUMBLE_MOTORS];
+	bool suspended;
+
+	bool vcc_on;
+};
+
+static int gsrumble_set(struct pwm_device *pwm, u16 level)
+{
+	struct pwm_state state;
+
+	pwm_get_state(pwm, &state);
+	state.enabled = level != 0;
+	pwm_set_relative_duty_cycle(&state, level, 0xffff);
+
+	return pwm_apply_state(pwm, &state);
+}
+
+static void gsrumble_work(struct work_struct *work)
+{
+	struct gsrumble *rumble = container_of(work, struct gsrumble, work);
+	struct device *dev = rumble->input->dev.parent;
+	u16 level[GSRUMBLE_MOTORS];
+	bool on = false;
+	int error, i;
+
+	spin_lock_irq(&rumble->input->event_lock);
+	for (i = 0; i < GSRUMBLE_MOTORS; i++) {
+		level[i] = rumble->level[i];
+		on |= level[i] != 0;
+	}
+	spin_unlock_irq(&rumble->input->event_lock);
+
+	if (on && !rumble->vcc_on) {
+		error = regulator_enable(rumble->vcc);
+		if (error) {
+			dev_err(dev, "failed to enable vcc: %d\n", error);
+			return;
+		}
+		rumble->vcc_on = true;
+	}
+
+	for (i = 0; i < GSRUMBLE_MOTORS; i++) {
+		if (!rumble->pwm[i])
+			continue;
+
+		error = gsrumble_set(rumble->pwm[i], level[i]);
+		if (error)
+			dev_err(dev, "failed to set %s motor: %d\n",
+				gsrumble_pwm_names[i], error);
+	}
+
+	if (!on && rumble->vcc_on) {
+		regulator_disable(rumble->vcc);
+		rumble->vcc_on = false;
+	}
+}
+
+/* Called with input->event_lock held */
+static int gsrumble_play_effect(struct input_dev *input, void *data,
+				struct ff_effect *effect)
+{
+	struct gsrumble *rumble = input_get_drvdata(input);
+	u16 strong = effect->u.rumble.strong_magnitude;
+	u16 weak = effect->u.rumble.weak_magnitude;
+
+	/* With a single motor, it plays whichever magnitude is larger */
+	if (!rumble->pwm[GSRUMBLE_WEAK])
+		strong = max(strong, weak);
+
+	rumble->level[GSRUMBLE_STRONG] = strong;
+	rumble->level[GSRUMBLE_WEAK] = weak;
+
+	if (!rumble->suspended)
+		queue_work(system_highpri_wq, &rumble->work);
+
+	return 0;
+}
+
+static void gsrumble_stop(struct gsrumble *rumble)
+{
+	int i;
+
+	cancel_work_sync(&rumble->work);
+
+	for (i = 0; i < GSRUMBLE_MOTORS; i++)
+		if (rumble->pwm[i])
+			pwm_disable(rumble->pwm[i]);
+
+	if (rumble->vcc_on) {
+		regulator_disable(rumble->vcc);
+		rumble->vcc_on = false;
+	}
+}
+
+static void gsrumble_close(struct input_dev *input)
+{
+	struct gsrumble *rumble = input_get_drvdata(input);
+
+	gsrumble_stop(rumble);
+}
+
+static int gsrumble_get_pwm(struct device *dev, struct gsrumble *rumble,
+			    int motor, bool optional)
+{
+	const char *name = gsrumble_pwm_names[motor];
+	struct pwm_device *pwm;
+	struct pwm_state state;
+	int error;
+
+	if (optional &&
+	    of_property_match_string(dev->of_node, "pwm-names", name) < 0)
+		return 0;
+
+	pwm = devm_pwm_get(dev, name);
+	if (IS_ERR(pwm)) {
+		error = PTR_ERR(pwm);
+		if (error != -EPROBE_DEFER)
+			dev_err(dev, "failed to get %s PWM: %d\n", name, error);
+		return error;
+	}
+
+	/* Sync up the PWM state and make sure the motor is off */
+	pwm_init_state(pwm, &state);
+	state.enabled = false;
+	error = pwm_apply_state(pwm, &state);
+	if (error) {
+		dev_err(dev, "failed to apply initial %s PWM state: %d\n",
+			name, error);
+		return error;
+	}
+
+	rumble->pwm[motor] = pwm;
+	return 0;
+}
+
+static int gsrumble_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct gsrumble *rumble;
+	struct input_dev *input;
+	int error;
+
+	rumble = devm_kzalloc(dev, sizeof(*rumble), GFP_KERNEL);
+	if (!rumble)
+		return -ENOMEM;
+
+	error = gsrumble_get_pwm(dev, rumble, GSRUMBLE_STRONG, false);
+	if (error)
+		return error;
+
+	error = gsrumble_get_pwm(dev, rumble, GSRUMBLE_WEAK, true);
+	if (error)
+		return error;
+
+	rumble->vcc = devm_regulator_get(dev, "vcc");
+	if (IS_ERR(rumble->vcc)) {
+		error = PTR_ERR(rumble->vcc);
+		if (error != -EPROBE_DEFER)
+			dev_err(dev, "failed to get vcc regulator: %d\n",
+				error);
+		return error;
+	}
+
+	INIT_WORK(&rumble->work, gsrumble_work);
+
+	input = devm_input_allocate_device(dev);
+	if (!input)
+		return -ENOMEM;
+
+	rumble->input = input;
+	input->name = DRIVER_NAME;
+	input->phys = DRIVER_NAME "/input0";
+	input->id.bustype = BUS_HOST;
+	input->close = gsrumble_close;
+	input_set_drvdata(input, rumble);
+
+	input_set_capability(input, EV_FF, FF_RUMBLE);
+
+	error = input_ff_create_memless(input, NULL, gsrumble_play_effect);
+	if (error) {
+		dev_err(dev, "failed to create force feedback: %d\n", error);
+		return error;
+	}
+
+	error = input_register_device(input);
+	if (error) {
+		dev_err(dev, "failed to register input device: %d\n", error);
+		return error;
+	}
+
+	platform_set_drvdata(pdev, rumble);
+
+	return 0;
+}
+
+static int __maybe_unused gsrumble_suspend(struct device *dev)
+{
+	struct gsrumble *rumble = dev_get_drvdata(dev);
+
+	/* Make sure gsrumble_play_effect() no longer queues the work */
+	spin_lock_irq(&rumble->input->event_lock);
+	rumble->suspended = true;
+	spin_unlock_irq(&rumble->input->event_lock);
+
+	gsrumble_stop(rumble);
+
+	return 0;
+}
+
+static int __maybe_unused gsrumble_resume(struct device *dev)
+{
+	struct gsrumble *rumble = dev_get_drvdata(dev);
+
+	spin_lock_irq(&rumble->input->event_lock);
+	rumble->suspended = false;
+	spin_unlock_irq(&rumble->input->event_lock);
+
+	/* Resume whatever effect is still playing */
+	queue_work(system_highpri_wq, &rumble->work);
+
+	return 0;
+}
+
+static SIMPLE_DEV_PM_OPS(gsrumble_pm_ops, gsrumble_suspend, gsrumble_resume);
+
+static const struct of_device_id gsrumble_of_match[] = {
+	{ .compatible = "gameslab,rumble" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, gsrumble_of_match);
+
+static struct platform_driver gsrumble_driver = {
+	.probe		= gsrumble_probe,
+	.driver		= {
+		.name		= DRIVER_NAME,
+		.pm		= &gsrumble_pm_ops,
+		.of_match_table	= gsrumble_of_match,
+	},
+};
+module_platform_driver(gsrumble_driver);
+
+MODULE_DESCRIPTION("Gameslab rumble motor driver");
+MODULE_LICENSE("GPL v2");
+MODULE_ALIAS("platform:" DRIVER_NAME);
@@ -519,10 +519,19 @@ static int uinput_setup_device_legacy(struct uinput_device *udev,
 	return retval;
 }
 
+/*
+ * Events are handed to the input core in batches of this size, so that
+ * a whole packet written with one write() is dispatched under a single
+ * acquisition of the device event lock.
+ */
+#define UINPUT_INJECT_BATCH	32
+
 static ssize_t uinput_inject_events(struct uinput_device *udev,
 				    const char __user *buffer, size_t count)
 {
+	struct input_value vals[UINPUT_INJECT_BATCH];
 	struct input_event ev;
+	unsigned int n = 0;
 	size_t bytes = 0;
 
 	if (count != 0 && count < input_event_size())
@@ -535,13 +544,27 @@ static ssize_t uinput_inject_events(struct uinput_device *udev,
 		 * count to let userspace know that it got it's buffers
 		 * all wrong.
 		 */
-		if (input_event_from_user(buffer + bytes, &ev))
+		if (input_event_from_user(buffer + bytes, &ev)) {
+			if (n)
+				input_events(udev->dev, vals, n);
 			return -EFAULT;
+		}
 
-		input_event(udev->dev, ev.type, ev.code, ev.value);
+		vals[n].type = ev.type;
+		vals[n].code = ev.code;
+		vals[n].value = ev.value;
 		bytes += input_event_size();
+
+		if (++n == UINPUT_INJECT_BATCH ||
+		    (ev.type == EV_SYN && ev.code == SYN_REPORT)) {
+			input_events(udev->dev, vals, n);
+			n = 0;
+		}
 	}
 
+	if (n)
+		input_events(udev->dev, vals, n);
+
 	return bytes;
 }
 
@@ -106,6 +106,11 @@ struct edt_ft5x06_ts_data {
 	int offset;
 	int report_rate;
 	int max_support_points;
+	int last_points;
+
+	unsigned int poll_interval;
+	struct delayed_work poll_work;
+	bool polling;
 
 	char name[EDT_NAME_LEN];
 
@@ -168,14 +173,18 @@ static bool edt_ft5x06_ts_check_crc(struct edt_ft5x06_ts_data *tsdata,
 	return true;
 }
 
-static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
+/*
+ * Fetch a touch report and pass it on, returns the number of contacts that
+ * are down or a negative error code.
+ */
+static int edt_ft5x06_ts_report(struct edt_ft5x06_ts_data *tsdata)
 {
-	struct edt_ft5x06_ts_data *tsdata = dev_id;
 	struct device *dev = &tsdata->client->dev;
 	u8 cmd;
 	u8 rdbuf[63];
 	int i, type, x, y, id;
 	int offset, tplen, datalen, crclen;
+	int numpoints, count, down_count = 0;
 	int error;
 
 	switch (tsdata->version) {
@@ -194,11 +203,24 @@ static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
 		break;
 
 	default:
-		goto out;
+		return -EINVAL;
 	}
 
+	/*
+	 * The M06 frame is covered by a CRC and has to be read as a whole.
+	 * The M09 register map has the number of active points in front of
+	 * them, so only read as many points as were active last time, which
+	 * during a drag covers the whole report in one transfer, and fetch
+	 * any additional ones with a second transfer.
+	 */
+	if (tsdata->version == M09)
+		numpoints = clamp(tsdata->last_points, 1,
+				  tsdata->max_support_points);
+	else
+		numpoints = tsdata->max_support_points;
+
 	memset(rdbuf, 0, sizeof(rdbuf));
-	datalen = tplen * tsdata->max_support_points + offset + crclen;
+	datalen = tplen * numpoints + offset + crclen;
 
 	error = edt_ft5x06_ts_readwrite(tsdata->client,
 					sizeof(cmd), &cmd,
@@ -206,7 +228,29 @@ static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
 	if (error) {
 		dev_err_ratelimited(dev, "Unable to fetch data, error: %d\n",
 				    error);
-		goto out;
+		return error;
+	}
+
+	if (tsdata->version == M09) {
+		count = min_t(int, rdbuf[2] & 0x0f,
+			      tsdata->max_support_points);
+
+		if (count > numpoints) {
+			cmd = offset + tplen * numpoints;
+			error = edt_ft5x06_ts_readwrite(tsdata->client,
+						sizeof(cmd), &cmd,
+						tplen * (count - numpoints),
+						&rdbuf[datalen]);
+			if (error) {
+				dev_err_ratelimited(dev,
+					"Unable to fetch data, error: %d\n",
+					error);
+				return error;
+			}
+		}
+
+		tsdata->last_points = count;
+		numpoints = count;
 	}
 
 	/* M09 does not send header or CRC */
@@ -216,14 +260,14 @@ static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
 			dev_err_ratelimited(dev,
 					"Unexpected header: %02x%02x%02x!\n",
 					rdbuf[0], rdbuf[1], rdbuf[2]);
-			goto out;
+			return -EIO;
 		}
 
 		if (!edt_ft5x06_ts_check_crc(tsdata, rdbuf, datalen))
-			goto out;
+			return -EIO;
 	}
 
-	for (i = 0; i < tsdata->max_support_points; i++) {
+	for (i = 0; i < numpoints; i++) {
 		u8 *buf = &rdbuf[i * tplen + offset];
 		bool down;
 
@@ -249,15 +293,64 @@ static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
 
 		touchscreen_report_pos(tsdata->input, &tsdata->prop, x, y,
 				       true);
+		down_count++;
 	}
 
+	/* Points beyond the count were lifted */
+	if (tsdata->version == M09)
+		input_mt_drop_unused(tsdata->input);
+
 	input_mt_report_pointer_emulation(tsdata->input, true);
 	input_sync(tsdata->input);
 
-out:
+	return down_count;
+}
+
+static irqreturn_t edt_ft5x06_ts_isr(int irq, void *dev_id)
+{
+	struct edt_ft5x06_ts_data *tsdata = dev_id;
+
+	/*
+	 * With a poll interval set the interrupt stays off while a finger
+	 * is down, and the reports of a drag are fetched at that interval.
+	 */
+	if (edt_ft5x06_ts_report(tsdata) > 0 && tsdata->poll_interval) {
+		tsdata->polling = true;
+		disable_irq_nosync(irq);
+		queue_delayed_work(system_display_wq, &tsdata->poll_work,
+				   msecs_to_jiffies(tsdata->poll_interval));
+	}
+
 	return IRQ_HANDLED;
 }
 
+static void edt_ft5x06_ts_poll_work(struct work_struct *work)
+{
+	struct edt_ft5x06_ts_data *tsdata = container_of(work,
+			struct edt_ft5x06_ts_data, poll_work.work);
+
+	if (edt_ft5x06_ts_report(tsdata) > 0) {
+		queue_delayed_work(system_display_wq, &tsdata->poll_work,
+				   msecs_to_jiffies(tsdata->poll_interval));
+		return;
+	}
+
+	/* All fingers lifted, wait for the next touch interrupt */
+	tsdata->polling = false;
+	enable_irq(tsdata->client->irq);
+}
+
+/* Leave poll mode, the caller must have disabled the interrupt */
+static void edt_ft5x06_ts_stop_polling(struct edt_ft5x06_ts_data *tsdata)
+{
+	cancel_delayed_work_sync(&tsdata->poll_work);
+
+	if (tsdata->polling) {
+		tsdata->polling = false;
+		enable_irq(tsdata->client->irq);
+	}
+}
+
 static int edt_ft5x06_register_write(struct edt_ft5x06_ts_data *tsdata,
 				     u8 addr, u8 value)
 {
@@ -496,6 +589,7 @@ static int edt_ft5x06_factory_mode(struct edt_ft5x06_ts_data *tsdata)
 	int error;
 
 	disable_irq(client->irq);
+	edt_ft5x06_ts_stop_polling(tsdata);
 
 	if (!tsdata->raw_buffer) {
 		tsdata->raw_bufsize = tsdata->num_x * tsdata->num_y *
@@ -839,6 +933,10 @@ static void edt_ft5x06_ts_get_defaults(struct device *dev,
 		edt_ft5x06_register_write(tsdata, reg_addr->reg_offset, val);
 		tsdata->offset = val;
 	}
+
+	error = device_property_read_u32(dev, "poll-interval", &val);
+	if (!error)
+		tsdata->poll_interval = val;
 }
 
 static void
@@ -946,6 +1044,7 @@ static int edt_ft5x06_ts_probe(struct i2c_client *client,
 	}
 
 	mutex_init(&tsdata->mutex);
+	INIT_DELAYED_WORK(&tsdata->poll_work, edt_ft5x06_ts_poll_work);
 	tsdata->client = client;
 	tsdata->input = input;
 	tsdata->factory_mode = false;
@@ -1025,6 +1124,9 @@ static int edt_ft5x06_ts_remove(struct i2c_client *client)
 {
 	struct edt_ft5x06_ts_data *tsdata = i2c_get_clientdata(client);
 
+	disable_irq(client->irq);
+	edt_ft5x06_ts_stop_polling(tsdata);
+
 	edt_ft5x06_ts_teardown_debugfs(tsdata);
 	sysfs_remove_group(&client->dev.kobj, &edt_ft5x06_attr_group);
 
@@ -1034,6 +1136,11 @@ static int edt_ft5x06_ts_remove(struct i2c_client *client)
 static int __maybe_unused edt_ft5x06_ts_suspend(struct device *dev)
 {
 	struct i2c_client *client = to_i2c_client(dev);
+	struct edt_ft5x06_ts_data *tsdata = i2c_get_clientdata(client);
+
+	disable_irq(client->irq);
+	edt_ft5x06_ts_stop_polling(tsdata);
+	enable_irq(client->irq);
 
 	if (device_may_wakeup(dev))
 		enable_irq_wake(client->irq);
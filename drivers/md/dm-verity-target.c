@@ -473,6 +473,112 @@ static int verity_bv_zero(struct dm_verity *v, struct dm_verity_io *io,
 	return 0;
 }
 
+/*
+ * Verify up to v->mb_msgs data blocks, starting at block "b" of the io, with
+ * one interleaved crypto_shash_finup_mb() pass. Blocks are gathered while
+ * each of them lies within one bio_vec and isn't expected to be zero.
+ *
+ * Returns the number of blocks verified, 0 if block "b" has to go through
+ * the single block path, or a negative error.
+ */
+static int verity_verify_mb(struct dm_verity_io *io, unsigned b)
+{
+	struct dm_verity *v = io->v;
+	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	unsigned block_size = 1 << v->data_dev_block_bits;
+	struct bvec_iter starts[HASH_MAX_MB_MSGS];
+	struct page *pages[HASH_MAX_MB_MSGS];
+	unsigned offsets[HASH_MAX_MB_MSGS];
+	const u8 *data[HASH_MAX_MB_MSGS];
+	u8 *outs[HASH_MAX_MB_MSGS];
+	struct bvec_iter iter = io->iter;
+	SHASH_DESC_ON_STACK(desc, v->shash_tfm);
+	bool is_zero;
+	unsigned n, i;
+	int r;
+
+	for (n = 0; n < v->mb_msgs && b + n < io->n_blocks; n++) {
+		struct bio_vec bv = bio_iter_iovec(bio, iter);
+
+		if (bv.bv_len < block_size)
+			break;
+
+		r = verity_hash_for_block(v, io, io->block + b + n,
+					  verity_io_mb_want_digest(v, io, n),
+					  &is_zero);
+		if (unlikely(r < 0))
+			return r;
+
+		if (is_zero) {
+			if (n)
+				break;
+			/*
+			 * If we expect a zero block, don't validate, just
+			 * return zeros.
+			 */
+			r = verity_for_bv_block(v, io, &io->iter,
+						verity_bv_zero);
+			return r < 0 ? r : 1;
+		}
+
+		starts[n] = iter;
+		pages[n] = bv.bv_page;
+		offsets[n] = bv.bv_offset;
+		bio_advance_iter(bio, &iter, block_size);
+	}
+
+	if (!n)
+		return 0;
+
+	desc->tfm = v->shash_tfm;
+	desc->flags = 0;
+
+	r = crypto_shash_init(desc);
+	if (likely(!r) && v->salt_size)
+		r = crypto_shash_update(desc, v->salt, v->salt_size);
+	if (unlikely(r < 0)) {
+		DMERR("verity_verify_mb crypto op failed: %d", r);
+		return r;
+	}
+
+	for (i = 0; i < n; i++) {
+		data[i] = (u8 *)kmap_atomic(pages[i]) + offsets[i];
+		outs[i] = verity_io_mb_real_digest(v, io, i);
+	}
+
+	r = crypto_shash_finup_mb(desc, data, block_size, outs, n);
+
+	for (i = n; i-- > 0; )
+		kunmap_atomic((void *)(data[i] - offsets[i]));
+
+	if (unlikely(r < 0)) {
+		DMERR("verity_verify_mb crypto op failed: %d", r);
+		return r;
+	}
+
+	io->iter = iter;
+
+	for (i = 0; i < n; i++) {
+		if (likely(memcmp(verity_io_mb_real_digest(v, io, i),
+				  verity_io_mb_want_digest(v, io, i),
+				  v->digest_size) == 0))
+			continue;
+
+		/* FEC checks its result against the single block digest */
+		memcpy(verity_io_want_digest(v, io),
+		       verity_io_mb_want_digest(v, io, i), v->digest_size);
+
+		if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
+				      io->block + b + i, NULL, &starts[i]) == 0)
+			continue;
+		else if (verity_handle_err(v, DM_VERITY_BLOCK_TYPE_DATA,
+					   io->block + b + i))
+			return -EIO;
+	}
+
+	return n;
+}
+
 /*
  * Verify one "dm_verity_io" structure.
  */
@@ -488,6 +594,16 @@ static int verity_verify_io(struct dm_verity_io *io)
 		int r;
 		struct ahash_request *req = verity_io_hash_req(v, io);
 
+		if (v->shash_tfm) {
+			r = verity_verify_mb(io, b);
+			if (unlikely(r < 0))
+				return r;
+			if (r) {
+				b += r - 1;
+				continue;
+			}
+		}
+
 		r = verity_hash_for_block(v, io, io->block + b,
 					  verity_io_want_digest(v, io),
 					  &is_zero);
@@ -788,6 +904,9 @@ static void verity_dtr(struct dm_target *ti)
 	if (v->tfm)
 		crypto_free_ahash(v->tfm);
 
+	if (v->shash_tfm)
+		crypto_free_shash(v->shash_tfm);
+
 	kfree(v->alg_name);
 
 	if (v->hash_dev)
@@ -801,6 +920,32 @@ static void verity_dtr(struct dm_target *ti)
 	kfree(v);
 }
 
+/*
+ * Hash data blocks through the synchronous interface when the hash
+ * implementation interleaves several messages in one pass. This needs the
+ * salt in front of the data, so it isn't used for format 0 with a salt.
+ */
+static void verity_setup_mb(struct dm_verity *v)
+{
+	struct crypto_shash *shash;
+
+	if (v->salt_size && !v->version)
+		return;
+
+	shash = crypto_alloc_shash(v->alg_name, 0, 0);
+	if (IS_ERR(shash))
+		return;
+
+	if (crypto_shash_mb_max_msgs(shash) < 2 ||
+	    crypto_shash_digestsize(shash) != v->digest_size) {
+		crypto_free_shash(shash);
+		return;
+	}
+
+	v->shash_tfm = shash;
+	v->mb_msgs = crypto_shash_mb_max_msgs(shash);
+}
+
 static int verity_alloc_zero_digest(struct dm_verity *v)
 {
 	int r = -ENOMEM;
@@ -1049,6 +1194,8 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 		}
 	}
 
+	verity_setup_mb(v);
+
 	argv += 10;
 	argc -= 10;
 
@@ -1118,7 +1265,8 @@ static int verity_ctr(struct dm_target *ti, unsigned argc, char **argv)
 	}
 
 	ti->per_io_data_size = sizeof(struct dm_verity_io) +
-				v->ahash_reqsize + v->digest_size * 2;
+				v->ahash_reqsize + v->digest_size * 2 +
+				v->mb_msgs * v->digest_size * 2;
 
 	r = verity_fec_ctr(v);
 	if (r)
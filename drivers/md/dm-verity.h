@@ -38,6 +38,7 @@ struct dm_verity {
 	struct dm_bufio_client *bufio;
 	char *alg_name;
 	struct crypto_ahash *tfm;
+	struct crypto_shash *shash_tfm;	/* for interleaved data hashing */
 	u8 *root_digest;	/* digest of the root block */
 	u8 *salt;		/* salt: its size is salt_size */
 	u8 *zero_digest;	/* digest for a zero block */
@@ -53,6 +54,7 @@ struct dm_verity {
 	unsigned char version;
 	unsigned digest_size;	/* digest size for the current hash algorithm */
 	unsigned int ahash_reqsize;/* the size of temporary space for crypto */
+	unsigned mb_msgs;	/* data blocks hashed in one pass, 0 if no shash_tfm */
 	int hash_failed;	/* set to 1 if hash of any block failed */
 	enum verity_mode mode;	/* mode for handling verification errors */
 	unsigned corrupted_errs;/* Number of errors for corrupted blocks */
@@ -79,14 +81,17 @@ struct dm_verity_io {
 	struct work_struct work;
 
 	/*
-	 * Three variably-size fields follow this struct:
+	 * Five variably-size fields follow this struct:
 	 *
 	 * u8 hash_req[v->ahash_reqsize];
 	 * u8 real_digest[v->digest_size];
 	 * u8 want_digest[v->digest_size];
+	 * u8 mb_want_digest[v->mb_msgs][v->digest_size];
+	 * u8 mb_real_digest[v->mb_msgs][v->digest_size];
 	 *
-	 * To access them use: verity_io_hash_req(), verity_io_real_digest()
-	 * and verity_io_want_digest().
+	 * To access them use: verity_io_hash_req(), verity_io_real_digest(),
+	 * verity_io_want_digest(), verity_io_mb_want_digest() and
+	 * verity_io_mb_real_digest().
 	 */
 };
 
@@ -113,10 +118,24 @@ static inline u8 *verity_io_want_digest(struct dm_verity *v,
 	return (u8 *)(io + 1) + v->ahash_reqsize + v->digest_size;
 }
 
+static inline u8 *verity_io_mb_want_digest(struct dm_verity *v,
+					   struct dm_verity_io *io, unsigned i)
+{
+	return verity_io_want_digest(v, io) + v->digest_size * (1 + i);
+}
+
+static inline u8 *verity_io_mb_real_digest(struct dm_verity *v,
+					   struct dm_verity_io *io, unsigned i)
+{
+	return verity_io_want_digest(v, io) +
+		v->digest_size * (1 + v->mb_msgs + i);
+}
+
 static inline u8 *verity_io_digest_end(struct dm_verity *v,
 				       struct dm_verity_io *io)
 {
-	return verity_io_want_digest(v, io) + v->digest_size;
+	return verity_io_want_digest(v, io) +
+		v->digest_size * (1 + 2 * v->mb_msgs);
 }
 
 extern int verity_for_bv_block(struct dm_verity *v, struct dm_verity_io *io,
@@ -0,0 +1,731 @@
+/*
+ * Gameslab scaler and color converter mem2mem driver
+ *
+ * The PL scaler/CSC core takes a packed frame on an AXI stream, scales it
+ * to the output size and converts between YUV 4:2:2 and RGB on the way,
+ * and emits the result on a second stream. Two AXI DMA channels connect
+ * it to memory: "tx" (MM2S) feeds the input frame, "rx" (S2MM) writes the
+ * output frame. One frame is one job of the V4L2 mem2mem framework.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/dmaengine.h>
+#include <linux/io.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include <media/v4l2-common.h>
+#include <media/v4l2-device.h>
+#include <media/v4l2-ioctl.h>
+#include <media/v4l2-mem2mem.h>
+#include <media/videobuf2-dma-contig.h>
+
+#define GSSCALER_NAME		"gsscaler"
+
+#define REG_CTRL		0x00
+#define REG_IN_SIZE		0x04	/* height << 16 | width */
+#define REG_OUT_SIZE		0x08
+#define REG_IN_FMT		0x0c
+#define REG_OUT_FMT		0x10
+#define REG_HSTEP		0x14	/* 16.16 input pixels per output one */
+#define REG_VSTEP		0x18
+#define REG_CSC			0x1c
+
+#define CTRL_START		BIT(0)	/* process one frame, self clearing */
+#define CTRL_RESET		BIT(1)	/* drop a partial frame */
+
+#define FMT_YUYV		0
+#define FMT_UYVY		1
+#define FMT_RGB565		2
+#define FMT_BGR24		3
+#define FMT_XBGR32		4
+
+#define CSC_BT601		0
+#define CSC_BT709		1
+
+#define GSSCALER_MIN_SIZE	16
+#define GSSCALER_MAX_SIZE	2048
+#define GSSCALER_TIMEOUT_MSEC	100
+
+/* Pixel formats in memory, all packed into a single plane */
+struct gsscaler_fmt {
+	u32 fourcc;
+	u32 code;		/* REG_IN_FMT and REG_OUT_FMT value */
+	u32 bpp;		/* bytes per pixel */
+};
+
+/* The RGB formats match the gslcdfb frame buffer layouts */
+static const struct gsscaler_fmt gsscaler_formats[] = {
+	{ V4L2_PIX_FMT_YUYV, FMT_YUYV, 2 },
+	{ V4L2_PIX_FMT_UYVY, FMT_UYVY, 2 },
+	{ V4L2_PIX_FMT_RGB565, FMT_RGB565, 2 },
+	{ V4L2_PIX_FMT_BGR24, FMT_BGR24, 3 },
+	{ V4L2_PIX_FMT_XBGR32, FMT_XBGR32, 4 },
+};
+
+static const struct gsscaler_fmt *gsscaler_find_format(u32 fourcc)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(gsscaler_formats); i++)
+		if (gsscaler_formats[i].fourcc == fourcc)
+			return &gsscaler_formats[i];
+
+	return NULL;
+}
+
+enum {
+	GSSCALER_SRC = 0,
+	GSSCALER_DST = 1,
+};
+
+struct gsscaler_q_data {
+	unsigned int width;
+	unsigned int height;
+	unsigned int bytesperline;
+	unsigned int sizeimage;
+	const struct gsscaler_fmt *fmt;
+};
+
+struct gsscaler_dev {
+	struct v4l2_device v4l2_dev;
+	struct video_device vfd;
+	struct mutex dev_mutex;
+
+	void __iomem *regs;
+	struct dma_chan *tx_chan;	/* MM2S, frames into the core */
+	struct dma_chan *rx_chan;	/* S2MM, frames out of the core */
+
+	/*
+	 * Completes the running job, right away from the rx callback or
+	 * after GSSCALER_TIMEOUT_MSEC. Jobs only start and end in process
+	 * context, as the DMA driver allocates descriptors with GFP_KERNEL.
+	 */
+	struct delayed_work work;
+	struct gsscaler_ctx *curr_ctx;	/* context of the running job */
+	dma_cookie_t rx_cookie;
+
+	struct v4l2_m2m_dev *m2m_dev;
+};
+
+struct gsscaler_ctx {
+	struct v4l2_fh fh;
+	struct gsscaler_dev *dev;
+	struct gsscaler_q_data q_data[2];
+	enum v4l2_colorspace colorspace;
+	u32 sequence;
+};
+
+static inline struct gsscaler_ctx *file2ctx(struct file *file)
+{
+	return container_of(file->private_data, struct gsscaler_ctx, fh);
+}
+
+static struct gsscaler_q_data *get_q_data(struct gsscaler_ctx *ctx,
+					  enum v4l2_buf_type type)
+{
+	if (V4L2_TYPE_IS_OUTPUT(type))
+		return &ctx->q_data[GSSCALER_SRC];
+
+	return &ctx->q_data[GSSCALER_DST];
+}
+
+static void gsscaler_write(struct gsscaler_dev *dev, u32 reg, u32 val)
+{
+	iowrite32(val, dev->regs + reg);
+}
+
+/* -----------------------------------------------------------------------------
+ * mem2mem jobs
+ */
+
+static void gsscaler_job_done(struct gsscaler_dev *dev,
+			      enum vb2_buffer_state state)
+{
+	struct gsscaler_ctx *ctx = dev->curr_ctx;
+	struct vb2_v4l2_buffer *src, *dst;
+
+	dev->curr_ctx = NULL;
+
+	src = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
+	dst = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
+
+	dst->vb2_buf.timestamp = src->vb2_buf.timestamp;
+	dst->timecode = src->timecode;
+	dst->flags &= ~(V4L2_BUF_FLAG_TSTAMP_SRC_MASK |
+			V4L2_BUF_FLAG_TIMECODE);
+	dst->flags |= src->flags & (V4L2_BUF_FLAG_TSTAMP_SRC_MASK |
+				    V4L2_BUF_FLAG_TIMECODE);
+	dst->field = V4L2_FIELD_NONE;
+	dst->sequence = ctx->sequence++;
+
+	v4l2_m2m_buf_done(src, state);
+	v4l2_m2m_buf_done(dst, state);
+	v4l2_m2m_job_finish(dev->m2m_dev, ctx->fh.m2m_ctx);
+}
+
+static void gsscaler_dma_done(void *param)
+{
+	struct gsscaler_dev *dev = param;
+
+	mod_delayed_work(system_highpri_wq, &dev->work, 0);
+}
+
+static void gsscaler_work(struct work_struct *work)
+{
+	struct gsscaler_dev *dev = container_of(to_delayed_work(work),
+						struct gsscaler_dev, work);
+	enum vb2_buffer_state state = VB2_BUF_STATE_DONE;
+
+	if (!dev->curr_ctx)
+		return;
+
+	if (dmaengine_tx_status(dev->rx_chan, dev->rx_cookie, NULL) !=
+	    DMA_COMPLETE) {
+		v4l2_err(&dev->v4l2_dev, "frame timed out\n");
+		dmaengine_terminate_sync(dev->tx_chan);
+		dmaengine_terminate_sync(dev->rx_chan);
+		gsscaler_write(dev, REG_CTRL, CTRL_RESET);
+		state = VB2_BUF_STATE_ERROR;
+	}
+
+	gsscaler_job_done(dev, state);
+}
+
+static void gsscaler_device_run(void *priv)
+{
+	struct gsscaler_ctx *ctx = priv;
+	struct gsscaler_dev *dev = ctx->dev;
+	struct gsscaler_q_data *in = &ctx->q_data[GSSCALER_SRC];
+	struct gsscaler_q_data *out = &ctx->q_data[GSSCALER_DST];
+	struct dma_async_tx_descriptor *tx, *rx;
+	struct vb2_v4l2_buffer *src, *dst;
+	dma_cookie_t cookie;
+
+	src = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
+	dst = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
+	dev->curr_ctx = ctx;
+
+	gsscaler_write(dev, REG_IN_SIZE, in->height << 16 | in->width);
+	gsscaler_write(dev, REG_OUT_SIZE, out->height << 16 | out->width);
+	gsscaler_write(dev, REG_IN_FMT, in->fmt->code);
+	gsscaler_write(dev, REG_OUT_FMT, out->fmt->code);
+	gsscaler_write(dev, REG_HSTEP,
+		       DIV_ROUND_CLOSEST(in->width << 16, out->width));
+	gsscaler_write(dev, REG_VSTEP,
+		       DIV_ROUND_CLOSEST(in->height << 16, out->height));
+	gsscaler_write(dev, REG_CSC,
+		       ctx->colorspace == V4L2_COLORSPACE_REC709 ?
+		       CSC_BT709 : CSC_BT601);
+
+	/* Lines have no padding, so each frame is a single transfer */
+	rx = dmaengine_prep_slave_single(dev->rx_chan,
+			vb2_dma_contig_plane_dma_addr(&dst->vb2_buf, 0),
+			out->sizeimage, DMA_DEV_TO_MEM,
+			DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!rx)
+		goto err;
+
+	rx->callback = gsscaler_dma_done;
+	rx->callback_param = dev;
+	dev->rx_cookie = dmaengine_submit(rx);
+	if (dma_submit_error(dev->rx_cookie))
+		goto err;
+
+	tx = dmaengine_prep_slave_single(dev->tx_chan,
+			vb2_dma_contig_plane_dma_addr(&src->vb2_buf, 0),
+			in->sizeimage, DMA_MEM_TO_DEV, DMA_CTRL_ACK);
+	if (!tx)
+		goto err_terminate;
+
+	cookie = dmaengine_submit(tx);
+	if (dma_submit_error(cookie))
+		goto err_terminate;
+
+	/* Arm the watchdog first, the rx callback only brings it forward */
+	queue_delayed_work(system_highpri_wq, &dev->work,
+			   msecs_to_jiffies(GSSCALER_TIMEOUT_MSEC));
+
+	/* The receive side has to be ready before the core emits pixels */
+	dma_async_issue_pending(dev->rx_chan);
+	dma_async_issue_pending(dev->tx_chan);
+	gsscaler_write(dev, REG_CTRL, CTRL_START);
+	return;
+
+err_terminate:
+	dmaengine_terminate_sync(dev->rx_chan);
+err:
+	v4l2_err(&dev->v4l2_dev, "failed to prepare DMA transfers\n");
+	gsscaler_job_done(dev, VB2_BUF_STATE_ERROR);
+}
+
+static void gsscaler_job_abort(void *priv)
+{
+	/* A frame takes a few ms at most, let the running one complete */
+}
+
+static const struct v4l2_m2m_ops gsscaler_m2m_ops = {
+	.device_run	= gsscaler_device_run,
+	.job_abort	= gsscaler_job_abort,
+};
+
+/* -----------------------------------------------------------------------------
+ * V4L2 ioctls
+ */
+
+static int gsscaler_querycap(struct file *file, void *priv,
+			     struct v4l2_capability *cap)
+{
+	strlcpy(cap->driver, GSSCALER_NAME, sizeof(cap->driver));
+	strlcpy(cap->card, "Gameslab scaler/CSC", sizeof(cap->card));
+	strlcpy(cap->bus_info, "platform:" GSSCALER_NAME,
+		sizeof(cap->bus_info));
+	cap->device_caps = V4L2_CAP_VIDEO_M2M | V4L2_CAP_STREAMING;
+	cap->capabilities = cap->device_caps | V4L2_CAP_DEVICE_CAPS;
+
+	return 0;
+}
+
+static int gsscaler_enum_fmt(struct file *file, void *priv,
+			     struct v4l2_fmtdesc *f)
+{
+	if (f->index >= ARRAY_SIZE(gsscaler_formats))
+		return -EINVAL;
+
+	f->pixelformat = gsscaler_formats[f->index].fourcc;
+
+	return 0;
+}
+
+static int gsscaler_g_fmt(struct file *file, void *priv,
+			  struct v4l2_format *f)
+{
+	struct gsscaler_ctx *ctx = file2ctx(file);
+	struct gsscaler_q_data *q_data = get_q_data(ctx, f->type);
+	struct v4l2_pix_format *pix = &f->fmt.pix;
+
+	pix->width = q_data->width;
+	pix->height = q_data->height;
+	pix->pixelformat = q_data->fmt->fourcc;
+	pix->field = V4L2_FIELD_NONE;
+	pix->bytesperline = q_data->bytesperline;
+	pix->sizeimage = q_data->sizeimage;
+	pix->colorspace = ctx->colorspace;
+
+	return 0;
+}
+
+static int gsscaler_try_fmt(struct file *file, void *priv,
+			    struct v4l2_format *f)
+{
+	struct gsscaler_ctx *ctx = file2ctx(file);
+	struct v4l2_pix_format *pix = &f->fmt.pix;
+	const struct gsscaler_fmt *fmt;
+
+	fmt = gsscaler_find_format(pix->pixelformat);
+	if (!fmt) {
+		fmt = &gsscaler_formats[0];
+		pix->pixelformat = fmt->fourcc;
+	}
+
+	/* Pixel pairs share their chroma in YUV 4:2:2 */
+	v4l_bound_align_image(&pix->width, GSSCALER_MIN_SIZE,
+			      GSSCALER_MAX_SIZE, 1,
+			      &pix->height, GSSCALER_MIN_SIZE,
+			      GSSCALER_MAX_SIZE, 0, 0);
+
+	pix->field = V4L2_FIELD_NONE;
+	pix->bytesperline = pix->width * fmt->bpp;
+	pix->sizeimage = pix->bytesperline * pix->height;
+
+	/* The matrix follows the input, the output reports the same */
+	if (V4L2_TYPE_IS_OUTPUT(f->type)) {
+		if (pix->colorspace != V4L2_COLORSPACE_REC709)
+			pix->colorspace = V4L2_COLORSPACE_SMPTE170M;
+	} else {
+		pix->colorspace = ctx->colorspace;
+	}
+
+	return 0;
+}
+
+static int gsscaler_s_fmt(struct file *file, void *priv,
+			  struct v4l2_format *f)
+{
+	struct gsscaler_ctx *ctx = file2ctx(file);
+	struct v4l2_pix_format *pix = &f->fmt.pix;
+	struct gsscaler_q_data *q_data;
+	struct vb2_queue *vq;
+	int ret;
+
+	vq = v4l2_m2m_get_vq(ctx->fh.m2m_ctx, f->type);
+	if (vb2_is_busy(vq))
+		return -EBUSY;
+
+	ret = gsscaler_try_fmt(file, priv, f);
+	if (ret)
+		return ret;
+
+	q_data = get_q_data(ctx, f->type);
+	q_data->fmt = gsscaler_find_format(pix->pixelformat);
+	q_data->width = pix->width;
+	q_data->height = pix->height;
+	q_data->bytesperline = pix->bytesperline;
+	q_data->sizeimage = pix->sizeimage;
+
+	if (V4L2_TYPE_IS_OUTPUT(f->type))
+		ctx->colorspace = pix->colorspace;
+
+	return 0;
+}
+
+static const struct v4l2_ioctl_ops gsscaler_ioctl_ops = {
+	.vidioc_querycap		= gsscaler_querycap,
+
+	.vidioc_enum_fmt_vid_cap	= gsscaler_enum_fmt,
+	.vidioc_g_fmt_vid_cap		= gsscaler_g_fmt,
+	.vidioc_try_fmt_vid_cap		= gsscaler_try_fmt,
+	.vidioc_s_fmt_vid_cap		= gsscaler_s_fmt,
+
+	.vidioc_enum_fmt_vid_out	= gsscaler_enum_fmt,
+	.vidioc_g_fmt_vid_out		= gsscaler_g_fmt,
+	.vidioc_try_fmt_vid_out		= gsscaler_try_fmt,
+	.vidioc_s_fmt_vid_out		= gsscaler_s_fmt,
+
+	.vidioc_reqbufs			= v4l2_m2m_ioctl_reqbufs,
+	.vidioc_querybuf		= v4l2_m2m_ioctl_querybuf,
+	.vidioc_qbuf			= v4l2_m2m_ioctl_qbuf,
+	.vidioc_dqbuf			= v4l2_m2m_ioctl_dqbuf,
+	.vidioc_prepare_buf		= v4l2_m2m_ioctl_prepare_buf,
+	.vidioc_create_bufs		= v4l2_m2m_ioctl_create_bufs,
+	.vidioc_expbuf			= v4l2_m2m_ioctl_expbuf,
+
+	.vidioc_streamon		= v4l2_m2m_ioctl_streamon,
+	.vidioc_streamoff		= v4l2_m2m_ioctl_streamoff,
+};
+
+/* -----------------------------------------------------------------------------
+ * videobuf2 queue operations
+ */
+
+static int gsscaler_queue_setup(struct vb2_queue *vq,
+				unsigned int *nbuffers, unsigned int *nplanes,
+				unsigned int sizes[],
+				struct device *alloc_devs[])
+{
+	struct gsscaler_ctx *ctx = vb2_get_drv_priv(vq);
+	struct gsscaler_q_data *q_data = get_q_data(ctx, vq->type);
+
+	if (*nplanes)
+		return sizes[0] < q_data->sizeimage ? -EINVAL : 0;
+
+	*nplanes = 1;
+	sizes[0] = q_data->sizeimage;
+
+	return 0;
+}
+
+static int gsscaler_buf_prepare(struct vb2_buffer *vb)
+{
+	struct gsscaler_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+	struct gsscaler_q_data *q_data = get_q_data(ctx, vb->vb2_queue->type);
+
+	if (vb2_plane_size(vb, 0) < q_data->sizeimage)
+		return -EINVAL;
+
+	/* A short source frame would stall the core halfway */
+	if (V4L2_TYPE_IS_OUTPUT(vb->vb2_queue->type) &&
+	    vb2_get_plane_payload(vb, 0) < q_data->sizeimage)
+		return -EINVAL;
+
+	if (!V4L2_TYPE_IS_OUTPUT(vb->vb2_queue->type))
+		vb2_set_plane_payload(vb, 0, q_data->sizeimage);
+
+	return 0;
+}
+
+static void gsscaler_buf_queue(struct vb2_buffer *vb)
+{
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+	struct gsscaler_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+
+	v4l2_m2m_buf_queue(ctx->fh.m2m_ctx, vbuf);
+}
+
+static int gsscaler_start_streaming(struct vb2_queue *vq, unsigned int count)
+{
+	struct gsscaler_ctx *ctx = vb2_get_drv_priv(vq);
+
+	if (!V4L2_TYPE_IS_OUTPUT(vq->type))
+		ctx->sequence = 0;
+
+	return 0;
+}
+
+static void gsscaler_stop_streaming(struct vb2_queue *vq)
+{
+	struct gsscaler_ctx *ctx = vb2_get_drv_priv(vq);
+	struct vb2_v4l2_buffer *vbuf;
+
+	for (;;) {
+		if (V4L2_TYPE_IS_OUTPUT(vq->type))
+			vbuf = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
+		else
+			vbuf = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
+		if (!vbuf)
+			return;
+		v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_ERROR);
+	}
+}
+
+static const struct vb2_ops gsscaler_qops = {
+	.queue_setup	 = gsscaler_queue_setup,
+	.buf_prepare	 = gsscaler_buf_prepare,
+	.buf_queue	 = gsscaler_buf_queue,
+	.start_streaming = gsscaler_start_streaming,
+	.stop_streaming  = gsscaler_stop_streaming,
+	.wait_prepare	 = vb2_ops_wait_prepare,
+	.wait_finish	 = vb2_ops_wait_finish,
+};
+
+static int gsscaler_queue_init(void *priv, struct vb2_queue *src_vq,
+			       struct vb2_queue *dst_vq)
+{
+	struct gsscaler_ctx *ctx = priv;
+	int ret;
+
+	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	src_vq->io_modes = VB2_MMAP | VB2_DMABUF;
+	src_vq->drv_priv = ctx;
+	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	src_vq->ops = &gsscaler_qops;
+	src_vq->mem_ops = &vb2_dma_contig_memops;
+	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	src_vq->lock = &ctx->dev->dev_mutex;
+	src_vq->dev = ctx->dev->v4l2_dev.dev;
+
+	ret = vb2_queue_init(src_vq);
+	if (ret)
+		return ret;
+
+	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	dst_vq->io_modes = VB2_MMAP | VB2_DMABUF;
+	dst_vq->drv_priv = ctx;
+	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	dst_vq->ops = &gsscaler_qops;
+	dst_vq->mem_ops = &vb2_dma_contig_memops;
+	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	dst_vq->lock = &ctx->dev->dev_mutex;
+	dst_vq->dev = ctx->dev->v4l2_dev.dev;
+
+	return vb2_queue_init(dst_vq);
+}
+
+/* -----------------------------------------------------------------------------
+ * File operations
+ */
+
+static int gsscaler_open(struct file *file)
+{
+	struct gsscaler_dev *dev = video_drvdata(file);
+	struct gsscaler_q_data *q_data;
+	struct gsscaler_ctx *ctx;
+	int ret = 0;
+
+	if (mutex_lock_interruptible(&dev->dev_mutex))
+		return -ERESTARTSYS;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	v4l2_fh_init(&ctx->fh, video_devdata(file));
+	file->private_data = &ctx->fh;
+	ctx->dev = dev;
+
+	/* Default to converting a full panel of YUYV to the frame buffer */
+	q_data = &ctx->q_data[GSSCALER_SRC];
+	q_data->fmt = gsscaler_find_format(V4L2_PIX_FMT_YUYV);
+	q_data->width = 800;
+	q_data->height = 480;
+	q_data->bytesperline = q_data->width * q_data->fmt->bpp;
+	q_data->sizeimage = q_data->bytesperline * q_data->height;
+
+	q_data = &ctx->q_data[GSSCALER_DST];
+	q_data->fmt = gsscaler_find_format(V4L2_PIX_FMT_BGR24);
+	q_data->width = 800;
+	q_data->height = 480;
+	q_data->bytesperline = q_data->width * q_data->fmt->bpp;
+	q_data->sizeimage = q_data->bytesperline * q_data->height;
+
+	ctx->colorspace = V4L2_COLORSPACE_SMPTE170M;
+
+	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(dev->m2m_dev, ctx,
+					    gsscaler_queue_init);
+	if (IS_ERR(ctx->fh.m2m_ctx)) {
+		ret = PTR_ERR(ctx->fh.m2m_ctx);
+		v4l2_fh_exit(&ctx->fh);
+		kfree(ctx);
+		goto out_unlock;
+	}
+
+	v4l2_fh_add(&ctx->fh);
+
+out_unlock:
+	mutex_unlock(&dev->dev_mutex);
+	return ret;
+}
+
+static int gsscaler_release(struct file *file)
+{
+	struct gsscaler_dev *dev = video_drvdata(file);
+	struct gsscaler_ctx *ctx = file2ctx(file);
+
+	v4l2_fh_del(&ctx->fh);
+	v4l2_fh_exit(&ctx->fh);
+	mutex_lock(&dev->dev_mutex);
+	v4l2_m2m_ctx_release(ctx->fh.m2m_ctx);
+	mutex_unlock(&dev->dev_mutex);
+	kfree(ctx);
+
+	return 0;
+}
+
+static const struct v4l2_file_operations gsscaler_fops = {
+	.owner		= THIS_MODULE,
+	.open		= gsscaler_open,
+	.release	= gsscaler_release,
+	.poll		= v4l2_m2m_fop_poll,
+	.unlocked_ioctl	= video_ioctl2,
+	.mmap		= v4l2_m2m_fop_mmap,
+};
+
+static const struct video_device gsscaler_videodev = {
+	.name		= GSSCALER_NAME,
+	.vfl_dir	= VFL_DIR_M2M,
+	.fops		= &gsscaler_fops,
+	.ioctl_ops	= &gsscaler_ioctl_ops,
+	.minor		= -1,
+	.release	= video_device_release_empty,
+};
+
+/* -----------------------------------------------------------------------------
+ * Platform driver
+ */
+
+static int gsscaler_probe(struct platform_device *pdev)
+{
+	struct gsscaler_dev *dev;
+	struct resource *res;
+	int ret;
+
+	dev = devm_kzalloc(&pdev->dev, sizeof(*dev), GFP_KERNEL);
+	if (!dev)
+		return -ENOMEM;
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	dev->regs = devm_ioremap_resource(&pdev->dev, res);
+	if (IS_ERR(dev->regs))
+		return PTR_ERR(dev->regs);
+
+	mutex_init(&dev->dev_mutex);
+	INIT_DELAYED_WORK(&dev->work, gsscaler_work);
+
+	dev->tx_chan = dma_request_chan(&pdev->dev, "tx");
+	if (IS_ERR(dev->tx_chan)) {
+		ret = PTR_ERR(dev->tx_chan);
+		if (ret != -EPROBE_DEFER)
+			dev_err(&pdev->dev, "no tx DMA channel\n");
+		return ret;
+	}
+
+	dev->rx_chan = dma_request_chan(&pdev->dev, "rx");
+	if (IS_ERR(dev->rx_chan)) {
+		ret = PTR_ERR(dev->rx_chan);
+		if (ret != -EPROBE_DEFER)
+			dev_err(&pdev->dev, "no rx DMA channel\n");
+		goto err_tx;
+	}
+
+	gsscaler_write(dev, REG_CTRL, CTRL_RESET);
+
+	ret = v4l2_device_register(&pdev->dev, &dev->v4l2_dev);
+	if (ret)
+		goto err_rx;
+
+	dev->m2m_dev = v4l2_m2m_init(&gsscaler_m2m_ops);
+	if (IS_ERR(dev->m2m_dev)) {
+		v4l2_err(&dev->v4l2_dev, "Failed to init mem2mem device\n");
+		ret = PTR_ERR(dev->m2m_dev);
+		goto err_v4l2;
+	}
+
+	dev->vfd = gsscaler_videodev;
+	dev->vfd.lock = &dev->dev_mutex;
+	dev->vfd.v4l2_dev = &dev->v4l2_dev;
+	video_set_drvdata(&dev->vfd, dev);
+	platform_set_drvdata(pdev, dev);
+
+	ret = video_register_device(&dev->vfd, VFL_TYPE_GRABBER, -1);
+	if (ret) {
+		v4l2_err(&dev->v4l2_dev, "Failed to register video device\n");
+		goto err_m2m;
+	}
+
+	v4l2_info(&dev->v4l2_dev, "registered as /dev/video%d\n",
+		  dev->vfd.num);
+
+	return 0;
+
+err_m2m:
+	v4l2_m2m_release(dev->m2m_dev);
+err_v4l2:
+	v4l2_device_unregister(&dev->v4l2_dev);
+err_rx:
+	dma_release_channel(dev->rx_chan);
+err_tx:
+	dma_release_channel(dev->tx_chan);
+	return ret;
+}
+
+static int gsscaler_remove(struct platform_device *pdev)
+{
+	struct gsscaler_dev *dev = platform_get_drvdata(pdev);
+
+	video_unregister_device(&dev->vfd);
+	v4l2_m2m_release(dev->m2m_dev);
+	v4l2_device_unregister(&dev->v4l2_dev);
+	cancel_delayed_work_sync(&dev->work);
+	dma_release_channel(dev->rx_chan);
+	dma_release_channel(dev->tx_chan);
+
+	return 0;
+}
+
+static const struct of_device_id gsscaler_of_match[] = {
+	{ .compatible = "gsscaler", },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, gsscaler_of_match);
+
+static struct platform_driver gsscaler_driver = {
+	.probe		= gsscaler_probe,
+	.remove		= gsscaler_remove,
+	.driver		= {
+		.name		= GSSCALER_NAME,
+		.of_match_table	= gsscaler_of_match,
+	},
+};
+
+module_platform_driver(gsscaler_driver);
+
+MODULE_DESCRIPTION("Gameslab scaler and color converter mem2mem driver");
+MODULE_LICENSE("GPL v2");
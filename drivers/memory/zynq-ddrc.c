@@ -0,0 +1,242 @@
+/*
+ * Xilinx Zynq DDR controller QoS driver
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * The DDR controller arbitrates between four AXI ports:
+ *
+ *   port 0	the CPUs and the ACP, through the L2 cache
+ *   port 1	the central interconnect: GP ports, DMA, USB, GEM, ...
+ *   port 2	HP0 and HP1
+ *   port 3	HP2 and HP3
+ *
+ * Each port has a read and a write priority, which loads an aging counter
+ * when the port is granted: the lower the value, the sooner the port wins
+ * again. A read port can also send its reads to the high priority read
+ * queue (HPR), which is served ahead of the low priority one as long as
+ * it does not starve it. How many entries of the 32-entry CAM HPR gets is
+ * set up with the DRAM timing by the boot loader, and left alone here.
+ *
+ * A PL master that must not underrun, such as a scanout engine on an HP
+ * port, gets a low read priority and HPR. The settings come from DT and
+ * can be changed at runtime through sysfs, as they only affect the
+ * arbitration of new requests.
+ */
+
+#include <linux/bitops.h>
+#include <linux/device.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/spinlock.h>
+#include <linux/sysfs.h>
+
+#define ZYNQ_DDRC_CTRL_REG1		0x060
+#define ZYNQ_DDRC_LPR_NUM_ENTRIES	GENMASK(6, 1)
+#define ZYNQ_DDRC_AXI_PRI_WR(p)		(0x208 + (p) * 4)
+#define ZYNQ_DDRC_AXI_PRI_RD(p)		(0x218 + (p) * 4)
+#define ZYNQ_DDRC_AXI_PRI		GENMASK(9, 0)
+#define ZYNQ_DDRC_AXI_PRI_RD_HPR	BIT(19)
+
+#define ZYNQ_DDRC_NUM_PORTS		4
+#define ZYNQ_DDRC_CAM_ENTRIES		32
+
+struct zynq_ddrc {
+	void __iomem *base;
+	/* Serializes read-modify-write of the port registers */
+	spinlock_t lock;
+};
+
+static void zynq_ddrc_update(struct zynq_ddrc *ddrc, unsigned int reg,
+			     u32 mask, u32 val)
+{
+	unsigned long flags;
+	u32 tmp;
+
+	spin_lock_irqsave(&ddrc->lock, flags);
+	tmp = readl(ddrc->base + reg);
+	tmp &= ~mask;
+	tmp |= (val << __ffs(mask)) & mask;
+	writel(tmp, ddrc->base + reg);
+	spin_unlock_irqrestore(&ddrc->lock, flags);
+}
+
+struct zynq_ddrc_attribute {
+	struct device_attribute attr;
+	unsigned int reg;
+	u32 mask;
+};
+
+#define to_zynq_ddrc_attr(a)	\
+	container_of(a, struct zynq_ddrc_attribute, attr)
+
+static ssize_t zynq_ddrc_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct zynq_ddrc *ddrc = dev_get_drvdata(dev);
+	struct zynq_ddrc_attribute *dattr = to_zynq_ddrc_attr(attr);
+	u32 val = readl(ddrc->base + dattr->reg) & dattr->mask;
+
+	return sprintf(buf, "%u\n", val >> __ffs(dattr->mask));
+}
+
+static ssize_t zynq_ddrc_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct zynq_ddrc *ddrc = dev_get_drvdata(dev);
+	struct zynq_ddrc_attribute *dattr = to_zynq_ddrc_attr(attr);
+	u32 val;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	if (val > dattr->mask >> __ffs(dattr->mask))
+		return -EINVAL;
+
+	zynq_ddrc_update(ddrc, dattr->reg, dattr->mask, val);
+
+	return count;
+}
+
+#define ZYNQ_DDRC_ATTR(_name, _reg, _mask)				\
+	static struct zynq_ddrc_attribute zynq_ddrc_attr_##_name = {	\
+		.attr	= __ATTR(_name, 0644, zynq_ddrc_show,		\
+				 zynq_ddrc_store),			\
+		.reg	= _reg,						\
+		.mask	= _mask,					\
+	}
+
+#define ZYNQ_DDRC_PORT_ATTRS(_p)					\
+	ZYNQ_DDRC_ATTR(port##_p##_rd_priority, ZYNQ_DDRC_AXI_PRI_RD(_p),\
+		       ZYNQ_DDRC_AXI_PRI);				\
+	ZYNQ_DDRC_ATTR(port##_p##_wr_priority, ZYNQ_DDRC_AXI_PRI_WR(_p),\
+		       ZYNQ_DDRC_AXI_PRI);				\
+	ZYNQ_DDRC_ATTR(port##_p##_rd_hpr, ZYNQ_DDRC_AXI_PRI_RD(_p),	\
+		       ZYNQ_DDRC_AXI_PRI_RD_HPR)
+
+ZYNQ_DDRC_PORT_ATTRS(0);
+ZYNQ_DDRC_PORT_ATTRS(1);
+ZYNQ_DDRC_PORT_ATTRS(2);
+ZYNQ_DDRC_PORT_ATTRS(3);
+
+#define ZYNQ_DDRC_PORT_ATTR_PTRS(_p)				\
+	&zynq_ddrc_attr_port##_p##_rd_priority.attr.attr,	\
+	&zynq_ddrc_attr_port##_p##_wr_priority.attr.attr,	\
+	&zynq_ddrc_attr_port##_p##_rd_hpr.attr.attr
+
+static struct attribute *zynq_ddrc_attrs[] = {
+	ZYNQ_DDRC_PORT_ATTR_PTRS(0),
+	ZYNQ_DDRC_PORT_ATTR_PTRS(1),
+	ZYNQ_DDRC_PORT_ATTR_PTRS(2),
+	ZYNQ_DDRC_PORT_ATTR_PTRS(3),
+	NULL,
+};
+
+static const struct attribute_group zynq_ddrc_attr_group = {
+	.name	= "qos",
+	.attrs	= zynq_ddrc_attrs,
+};
+
+static void zynq_ddrc_of_priorities(struct device *dev,
+				    struct zynq_ddrc *ddrc,
+				    const char *prop, bool rd)
+{
+	u32 pri[ZYNQ_DDRC_NUM_PORTS];
+	unsigned int p;
+
+	if (!of_find_property(dev->of_node, prop, NULL))
+		return;
+
+	if (of_property_read_u32_array(dev->of_node, prop, pri,
+				       ARRAY_SIZE(pri))) {
+		dev_warn(dev, "%s needs one cell per port\n", prop);
+		return;
+	}
+
+	for (p = 0; p < ZYNQ_DDRC_NUM_PORTS; p++)
+		zynq_ddrc_update(ddrc, rd ? ZYNQ_DDRC_AXI_PRI_RD(p) :
+					    ZYNQ_DDRC_AXI_PRI_WR(p),
+				 ZYNQ_DDRC_AXI_PRI,
+				 min_t(u32, pri[p], ZYNQ_DDRC_AXI_PRI));
+}
+
+static int zynq_ddrc_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct zynq_ddrc *ddrc;
+	struct resource *res;
+	struct property *prop;
+	const __be32 *cur;
+	unsigned int hpr;
+	u32 port;
+
+	ddrc = devm_kzalloc(dev, sizeof(*ddrc), GFP_KERNEL);
+	if (!ddrc)
+		return -ENOMEM;
+
+	spin_lock_init(&ddrc->lock);
+
+	/* The PM code maps the controller too, but does not claim it */
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	ddrc->base = devm_ioremap_resource(dev, res);
+	if (IS_ERR(ddrc->base))
+		return PTR_ERR(ddrc->base);
+
+	platform_set_drvdata(pdev, ddrc);
+
+	zynq_ddrc_of_priorities(dev, ddrc, "xlnx,rd-port-priority", true);
+	zynq_ddrc_of_priorities(dev, ddrc, "xlnx,wr-port-priority", false);
+
+	of_property_for_each_u32(dev->of_node, "xlnx,hpr-rd-ports", prop,
+				 cur, port) {
+		if (port >= ZYNQ_DDRC_NUM_PORTS) {
+			dev_warn(dev, "invalid HPR port %u\n", port);
+			continue;
+		}
+		zynq_ddrc_update(ddrc, ZYNQ_DDRC_AXI_PRI_RD(port),
+				 ZYNQ_DDRC_AXI_PRI_RD_HPR, 1);
+	}
+
+	hpr = readl(ddrc->base + ZYNQ_DDRC_CTRL_REG1) &
+	      ZYNQ_DDRC_LPR_NUM_ENTRIES;
+	hpr = ZYNQ_DDRC_CAM_ENTRIES - (hpr >> __ffs(ZYNQ_DDRC_LPR_NUM_ENTRIES));
+	dev_info(dev, "%u of %u CAM entries for high priority reads\n",
+		 hpr, ZYNQ_DDRC_CAM_ENTRIES);
+
+	return sysfs_create_group(&dev->kobj, &zynq_ddrc_attr_group);
+}
+
+static int zynq_ddrc_remove(struct platform_device *pdev)
+{
+	sysfs_remove_group(&pdev->dev.kobj, &zynq_ddrc_attr_group);
+
+	return 0;
+}
+
+static const struct of_device_id zynq_ddrc_of_match[] = {
+	{ .compatible = "xlnx,zynq-ddrc-a05", },
+	{ },
+};
+MODULE_DEVICE_TABLE(of, zynq_ddrc_of_match);
+
+static struct platform_driver zynq_ddrc_driver = {
+	.probe = zynq_ddrc_probe,
+	.remove = zynq_ddrc_remove,
+	.driver = {
+		.name = "zynq-ddrc",
+		.of_match_table = zynq_ddrc_of_match,
+	},
+};
+module_platform_driver(zynq_ddrc_driver);
+
+MODULE_DESCRIPTION("Xilinx Zynq DDR controller QoS driver");
+MODULE_LICENSE("GPL v2");
@@ -21,6 +21,7 @@
 #include <linux/leds.h>
 #include <linux/scatterlist.h>
 #include <linux/log2.h>
+#include <linux/ktime.h>
 #include <linux/regulator/consumer.h>
 #include <linux/pm_runtime.h>
 #include <linux/pm_wakeup.h>
@@ -139,6 +140,63 @@ void mmc_command_done(struct mmc_host *host, struct mmc_request *mrq)
 }
 EXPORT_SYMBOL(mmc_command_done);
 
+static unsigned int mmc_stats_time_bucket(u64 ns)
+{
+	u32 us = div_u64(ns, NSEC_PER_USEC);
+
+	return us ? min_t(unsigned int, ilog2(us),
+			  MMC_STATS_TIME_BUCKETS - 1) : 0;
+}
+
+/*
+ * Requests are timed one at a time, commands sent during a transfer are not
+ * accounted for.
+ */
+static void mmc_stats_start(struct mmc_host *host, struct mmc_request *mrq)
+{
+	struct mmc_host_stats *stats = &host->stats;
+	u64 now = ktime_get_ns();
+
+	if (host->ongoing_mrq)
+		return;
+
+	if (stats->idle_start) {
+		stats->idle[mmc_stats_time_bucket(now - stats->idle_start)]++;
+		stats->idle_start = 0;
+	}
+
+	if (mrq->data) {
+		unsigned int sectors = (mrq->data->blksz *
+					mrq->data->blocks) >> 9;
+		int write = !!(mrq->data->flags & MMC_DATA_WRITE);
+
+		stats->size[write][sectors ? min_t(unsigned int,
+						   ilog2(sectors),
+						   MMC_STATS_SIZE_BUCKETS - 1)
+					   : 0]++;
+	}
+
+	stats->mrq = mrq;
+	stats->req_start = now;
+}
+
+static void mmc_stats_done(struct mmc_host *host, struct mmc_request *mrq)
+{
+	struct mmc_host_stats *stats = &host->stats;
+	u64 now;
+
+	if (mrq->data && mrq->data->error)
+		stats->data_errors++;
+
+	if (stats->mrq != mrq)
+		return;
+
+	now = ktime_get_ns();
+	stats->latency[mmc_stats_time_bucket(now - stats->req_start)]++;
+	stats->mrq = NULL;
+	stats->idle_start = now;
+}
+
 /**
  *	mmc_request_done - finish processing an MMC request
  *	@host: MMC host which completed request
@@ -184,6 +242,8 @@ void mmc_request_done(struct mmc_host *host, struct mmc_request *mrq)
 	if (!err || !cmd->retries || mmc_card_removed(host->card)) {
 		mmc_should_fail_request(host, mrq);
 
+		mmc_stats_done(host, mrq);
+
 		if (!host->ongoing_mrq)
 			led_trigger_event(host->led, LED_OFF);
 
@@ -213,6 +273,8 @@ void mmc_request_done(struct mmc_host *host, struct mmc_request *mrq)
 				mrq->stop->resp[0], mrq->stop->resp[1],
 				mrq->stop->resp[2], mrq->stop->resp[3]);
 		}
+	} else {
+		host->stats.retries++;
 	}
 	/*
 	 * Request starter must handle retries - see
@@ -357,6 +419,7 @@ static int mmc_start_request(struct mmc_host *host, struct mmc_request *mrq)
 		return err;
 
 	led_trigger_event(host->led, LED_FULL);
+	mmc_stats_start(host, mrq);
 	__mmc_start_request(host, mrq);
 
 	return 0;
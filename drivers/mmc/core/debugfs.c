@@ -236,6 +236,61 @@ static int mmc_clock_opt_set(void *data, u64 val)
 DEFINE_SIMPLE_ATTRIBUTE(mmc_clock_fops, mmc_clock_opt_get, mmc_clock_opt_set,
 	"%llu\n");
 
+static int mmc_stats_show(struct seq_file *s, void *data)
+{
+	struct mmc_host *host = s->private;
+	struct mmc_host_stats *stats = &host->stats;
+	int i;
+
+	/* Each bucket is listed by its lower bound */
+	seq_puts(s, "size (bytes)\treads\twrites\n");
+	for (i = 0; i < MMC_STATS_SIZE_BUCKETS; i++)
+		seq_printf(s, "%u\t\t%u\t%u\n", i ? 512 << i : 0,
+			   stats->size[0][i], stats->size[1][i]);
+
+	seq_puts(s, "\ntime (us)\tlatency\tidle\n");
+	for (i = 0; i < MMC_STATS_TIME_BUCKETS; i++)
+		seq_printf(s, "%u\t\t%u\t%u\n", i ? 1 << i : 0,
+			   stats->latency[i], stats->idle[i]);
+
+	seq_printf(s, "\ndata errors:\t%u\n", stats->data_errors);
+	seq_printf(s, "dma errors:\t%u\n", stats->dma_errors);
+	seq_printf(s, "retries:\t%u\n", stats->retries);
+
+	return 0;
+}
+
+static int mmc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmc_stats_show, inode->i_private);
+}
+
+/* Any write clears the statistics */
+static ssize_t mmc_stats_write(struct file *file, const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	struct seq_file *s = file->private_data;
+	struct mmc_host *host = s->private;
+	struct mmc_host_stats *stats = &host->stats;
+
+	memset(stats->size, 0, sizeof(stats->size));
+	memset(stats->latency, 0, sizeof(stats->latency));
+	memset(stats->idle, 0, sizeof(stats->idle));
+	stats->data_errors = 0;
+	stats->dma_errors = 0;
+	stats->retries = 0;
+
+	return count;
+}
+
+static const struct file_operations mmc_stats_fops = {
+	.open		= mmc_stats_open,
+	.read		= seq_read,
+	.write		= mmc_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 void mmc_add_host_debugfs(struct mmc_host *host)
 {
 	struct dentry *root;
@@ -258,6 +313,10 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 			&mmc_clock_fops))
 		goto err_node;
 
+	if (!debugfs_create_file("stats", S_IRUSR | S_IWUSR, root, host,
+			&mmc_stats_fops))
+		goto err_node;
+
 #ifdef CONFIG_FAIL_MMC_REQUEST
 	if (fail_request)
 		setup_fault_attr(&fail_default_attr, fail_request);
@@ -10,6 +10,7 @@
 #include <linux/slab.h>
 #include <linux/module.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
 #include <linux/scatterlist.h>
@@ -26,19 +27,10 @@
 #define MMC_QUEUE_BOUNCESZ	65536
 
 /*
- * Prepare a MMC request. This just filters out odd stuff.
+ * Number of blk-mq tags. Only two requests are ever on the host (one
+ * running, one prepared), the rest wait on mq->rq_list for the thread.
  */
-static int mmc_prep_request(struct request_queue *q, struct request *req)
-{
-	struct mmc_queue *mq = q->queuedata;
-
-	if (mq && (mmc_card_removed(mq->card) || mmc_access_rpmb(mq)))
-		return BLKPREP_KILL;
-
-	req->rq_flags |= RQF_DONTPREP;
-
-	return BLKPREP_OK;
-}
+#define MMC_QUEUE_DEPTH		64
 
 struct mmc_queue_req *mmc_queue_req_find(struct mmc_queue *mq,
 					 struct request *req)
@@ -83,14 +75,17 @@ static int mmc_queue_thread(void *d)
 
 		spin_lock_irq(q->queue_lock);
 		set_current_state(TASK_INTERRUPTIBLE);
-		req = blk_fetch_request(q);
+		req = list_first_entry_or_null(&mq->rq_list, struct request,
+					       queuelist);
+		if (req)
+			list_del_init(&req->queuelist);
 		mq->asleep = false;
 		cntx->is_waiting_last_req = false;
 		cntx->is_new_req = false;
 		if (!req) {
 			/*
-			 * Dispatch queue is empty so set flags for
-			 * mmc_request_fn() to wake us up.
+			 * Dispatch list is empty so set flags for
+			 * mmc_queue_rq() to wake us up.
 			 */
 			if (mq->qcnt)
 				cntx->is_waiting_last_req = true;
@@ -119,25 +114,31 @@ static int mmc_queue_thread(void *d)
 }
 
 /*
- * Generic MMC request handler.  This is called for any queue on a
- * particular host.  When the host is not busy, we look for a request
- * on any queue on this host, and attempt to issue it.  This may
- * not be the queue we were asked to process.
+ * blk-mq dispatch. Requests are only started and handed to the queue
+ * thread, which keeps feeding mmc_blk_issue_rq() so that the next request
+ * is already prepared (mapped by the host's pre_req) while the current one
+ * is on the bus.
  */
-static void mmc_request_fn(struct request_queue *q)
+static int mmc_queue_rq(struct blk_mq_hw_ctx *hctx,
+			const struct blk_mq_queue_data *bd)
 {
+	struct request *req = bd->rq;
+	struct request_queue *q = req->q;
 	struct mmc_queue *mq = q->queuedata;
-	struct request *req;
 	struct mmc_context_info *cntx;
+	unsigned long flags;
 
-	if (!mq) {
-		while ((req = blk_fetch_request(q)) != NULL) {
-			req->rq_flags |= RQF_QUIET;
-			__blk_end_request_all(req, -EIO);
-		}
-		return;
+	if (!mq || mmc_card_removed(mq->card) || mmc_access_rpmb(mq)) {
+		req->rq_flags |= RQF_QUIET;
+		return BLK_MQ_RQ_QUEUE_ERROR;
 	}
 
+	blk_mq_start_request(req);
+
+	spin_lock_irqsave(q->queue_lock, flags);
+
+	list_add_tail(&req->queuelist, &mq->rq_list);
+
 	cntx = &mq->card->host->context_info;
 
 	if (cntx->is_waiting_last_req) {
@@ -147,8 +148,16 @@ static void mmc_request_fn(struct request_queue *q)
 
 	if (mq->asleep)
 		wake_up_process(mq->thread);
+
+	spin_unlock_irqrestore(q->queue_lock, flags);
+
+	return BLK_MQ_RQ_QUEUE_OK;
 }
 
+static const struct blk_mq_ops mmc_mq_ops = {
+	.queue_rq	= mmc_queue_rq,
+};
+
 static struct scatterlist *mmc_alloc_sg(int sg_len)
 {
 	struct scatterlist *sg;
@@ -373,19 +382,37 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 		limit = (u64)dma_max_pfn(mmc_dev(host)) << PAGE_SHIFT;
 
 	mq->card = card;
-	mq->queue = blk_init_queue(mmc_request_fn, lock);
-	if (!mq->queue)
-		return -ENOMEM;
+	INIT_LIST_HEAD(&mq->rq_list);
+
+	memset(&mq->tag_set, 0, sizeof(mq->tag_set));
+	mq->tag_set.ops = &mmc_mq_ops;
+	mq->tag_set.nr_hw_queues = 1;
+	mq->tag_set.queue_depth = MMC_QUEUE_DEPTH;
+	mq->tag_set.numa_node = NUMA_NO_NODE;
+	mq->tag_set.flags = BLK_MQ_F_SHOULD_MERGE | BLK_MQ_F_SG_MERGE;
+
+	ret = blk_mq_alloc_tag_set(&mq->tag_set);
+	if (ret)
+		return ret;
 
+	mq->queue = blk_mq_init_queue(&mq->tag_set);
+	if (IS_ERR(mq->queue)) {
+		ret = PTR_ERR(mq->queue);
+		goto free_tag_set;
+	}
+
+	mq->queue->queue_lock = lock;
 	mq->mqrq = card->mqrq;
 	mq->qdepth = card->qdepth;
 	mq->queue->queuedata = mq;
 
-	blk_queue_prep_rq(mq->queue, mmc_prep_request);
 	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, mq->queue);
 	queue_flag_clear_unlocked(QUEUE_FLAG_ADD_RANDOM, mq->queue);
 	if (mmc_can_erase(card))
 		mmc_queue_setup_discard(mq->queue, card);
+	/* writes smaller than an erase unit are slow, let schedulers know */
+	if (card->pref_erase)
+		blk_queue_io_opt(mq->queue, card->pref_erase << 9);
 
 	if (card->bouncesz) {
 		blk_queue_bounce_limit(mq->queue, BLK_BOUNCE_ANY);
@@ -415,13 +442,17 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card,
 cleanup_queue:
 	mq->mqrq = NULL;
 	blk_cleanup_queue(mq->queue);
+free_tag_set:
+	blk_mq_free_tag_set(&mq->tag_set);
 	return ret;
 }
 
 void mmc_cleanup_queue(struct mmc_queue *mq)
 {
 	struct request_queue *q = mq->queue;
+	struct request *req;
 	unsigned long flags;
+	LIST_HEAD(list);
 
 	/* Make sure the queue isn't suspended, as that will deadlock */
 	mmc_queue_resume(mq);
@@ -429,12 +460,19 @@ void mmc_cleanup_queue(struct mmc_queue *mq)
 	/* Then terminate our worker thread */
 	kthread_stop(mq->thread);
 
-	/* Empty the queue */
+	/* Empty the queue, new requests are failed in mmc_queue_rq() */
 	spin_lock_irqsave(q->queue_lock, flags);
 	q->queuedata = NULL;
-	blk_start_queue(q);
+	list_splice_init(&mq->rq_list, &list);
 	spin_unlock_irqrestore(q->queue_lock, flags);
 
+	while (!list_empty(&list)) {
+		req = list_first_entry(&list, struct request, queuelist);
+		list_del_init(&req->queuelist);
+		req->rq_flags |= RQF_QUIET;
+		blk_mq_end_request(req, -EIO);
+	}
+
 	mq->mqrq = NULL;
 	mq->card = NULL;
 }
@@ -451,14 +489,11 @@ EXPORT_SYMBOL(mmc_cleanup_queue);
 void mmc_queue_suspend(struct mmc_queue *mq)
 {
 	struct request_queue *q = mq->queue;
-	unsigned long flags;
 
 	if (!mq->suspended) {
 		mq->suspended |= true;
 
-		spin_lock_irqsave(q->queue_lock, flags);
-		blk_stop_queue(q);
-		spin_unlock_irqrestore(q->queue_lock, flags);
+		blk_mq_stop_hw_queues(q);
 
 		down(&mq->thread_sem);
 	}
@@ -471,16 +506,13 @@ void mmc_queue_suspend(struct mmc_queue *mq)
 void mmc_queue_resume(struct mmc_queue *mq)
 {
 	struct request_queue *q = mq->queue;
-	unsigned long flags;
 
 	if (mq->suspended) {
 		mq->suspended = false;
 
 		up(&mq->thread_sem);
 
-		spin_lock_irqsave(q->queue_lock, flags);
-		blk_start_queue(q);
-		spin_unlock_irqrestore(q->queue_lock, flags);
+		blk_mq_start_stopped_hw_queues(q, true);
 	}
 }
 
@@ -3,6 +3,7 @@
 
 #include <linux/types.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/mmc/core.h>
 #include <linux/mmc/host.h>
 
@@ -45,6 +46,8 @@ struct mmc_queue {
 	bool			asleep;
 	struct mmc_blk_data	*blkdata;
 	struct request_queue	*queue;
+	struct blk_mq_tag_set	tag_set;
+	struct list_head	rq_list;	/* dispatched, not yet issued */
 	struct mmc_queue_req	*mqrq;
 	int			qdepth;
 	int			qcnt;
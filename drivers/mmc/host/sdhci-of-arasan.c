@@ -25,6 +25,7 @@
 #include <linux/of_device.h>
 #include <linux/phy/phy.h>
 #include <linux/regmap.h>
+#include <linux/regulator/consumer.h>
 #include "sdhci-pltfm.h"
 #include <linux/of.h>
 
@@ -262,6 +263,62 @@ static int sdhci_arasan_voltage_switch(struct mmc_host *mmc,
 	return -EINVAL;
 }
 
+static int sdhci_arasan_zynq_voltage_switch(struct mmc_host *mmc,
+					    struct mmc_ios *ios)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+	int ret;
+
+	/* Controllers with the 1.8V Signal Enable bit use the standard path */
+	if (host->version >= SDHCI_SPEC_300)
+		return sdhci_start_signal_voltage_switch(mmc, ios);
+
+	switch (ios->signal_voltage) {
+	case MMC_SIGNAL_VOLTAGE_330:
+		if (IS_ERR(mmc->supply.vqmmc))
+			return 0;
+		/* fall through */
+	case MMC_SIGNAL_VOLTAGE_180:
+		/*
+		 * The Zynq-7000 controller predates SDHCI v3.00 and has no
+		 * 1.8V Signal Enable, the IO levels are entirely up to the
+		 * board level shifter behind the vqmmc regulator.
+		 */
+		if (IS_ERR(mmc->supply.vqmmc))
+			return -EINVAL;
+
+		ret = mmc_regulator_set_vqmmc(mmc, ios);
+		if (ret) {
+			pr_warn("%s: Switching signalling voltage failed\n",
+				mmc_hostname(mmc));
+			return -EIO;
+		}
+
+		/* Regulator output should be stable within 5 ms */
+		usleep_range(5000, 5500);
+		return 0;
+	case MMC_SIGNAL_VOLTAGE_120:
+		/* We don't support 1V2 */
+		break;
+	}
+
+	return -EINVAL;
+}
+
+static int sdhci_arasan_zynq_execute_tuning(struct mmc_host *mmc, u32 opcode)
+{
+	struct sdhci_host *host = mmc_priv(mmc);
+
+	/*
+	 * Without the v3.00 tuning circuit SDR50 runs on the fixed
+	 * sampling clock, and SDR104 (which needs tuning) is not offered.
+	 */
+	if (host->version < SDHCI_SPEC_300)
+		return 0;
+
+	return sdhci_execute_tuning(mmc, opcode);
+}
+
 static struct sdhci_ops sdhci_arasan_ops = {
 	.set_clock = sdhci_arasan_set_clock,
 	.get_max_clock = sdhci_pltfm_clk_get_max_clock,
@@ -275,7 +332,8 @@ static struct sdhci_pltfm_data sdhci_arasan_pdata = {
 	.ops = &sdhci_arasan_ops,
 	.quirks = SDHCI_QUIRK_CAP_CLOCK_BASE_BROKEN,
 	.quirks2 = SDHCI_QUIRK2_PRESET_VALUE_BROKEN |
-			SDHCI_QUIRK2_CLOCK_DIV_ZERO_BROKEN,
+			SDHCI_QUIRK2_CLOCK_DIV_ZERO_BROKEN |
+			SDHCI_QUIRK2_FAST_COMPLETION,
 };
 
 #ifdef CONFIG_PM_SLEEP
@@ -538,6 +596,46 @@ static int sdhci_arasan_register_sdclk(struct sdhci_arasan_data *sdhci_arasan,
 	return ret;
 }
 
+/**
+ * sdhci_arasan_add_host - Add the host, sorting out UHS for level shifters
+ *
+ * On Zynq the 1.8V IO levels for UHS-I come from a level shifter on the board,
+ * modelled as the vqmmc regulator, and the UHS modes it can do are given with
+ * the usual sd-uhs-* properties.  Drop them again if there is no regulator
+ * that can do 1.8V, and drop the modes a pre-v3.00 controller cannot time
+ * (SDR104 needs tuning, DDR50 the Host Control 2 register).
+ *
+ * @sdhci_arasan:	Our private data structure.
+ * Returns 0 on success and error value on error
+ */
+static int sdhci_arasan_add_host(struct sdhci_arasan_data *sdhci_arasan)
+{
+	struct sdhci_host *host = sdhci_arasan->host;
+	struct mmc_host *mmc = host->mmc;
+	u32 uhs_caps = MMC_CAP_UHS_SDR12 | MMC_CAP_UHS_SDR25 |
+		       MMC_CAP_UHS_SDR50 | MMC_CAP_UHS_SDR104 |
+		       MMC_CAP_UHS_DDR50;
+	int ret;
+
+	ret = sdhci_setup_host(host);
+	if (ret)
+		return ret;
+
+	if (IS_ERR(mmc->supply.vqmmc) ||
+	    !regulator_is_supported_voltage(mmc->supply.vqmmc, 1700000,
+					    1950000)) {
+		mmc->caps &= ~uhs_caps;
+	} else if (host->version < SDHCI_SPEC_300) {
+		mmc->caps &= ~(MMC_CAP_UHS_SDR104 | MMC_CAP_UHS_DDR50);
+	}
+
+	ret = __sdhci_add_host(host);
+	if (ret)
+		sdhci_cleanup_host(host);
+
+	return ret;
+}
+
 /**
  * sdhci_arasan_unregister_sdclk - Undoes sdhci_arasan_register_sdclk()
  *
@@ -665,7 +763,17 @@ static int sdhci_arasan_probe(struct platform_device *pdev)
 					sdhci_arasan_voltage_switch;
 	}
 
-	ret = sdhci_add_host(host);
+	if (of_device_is_compatible(pdev->dev.of_node,
+				    "arasan,sdhci-8.9a")) {
+		host->mmc_host_ops.start_signal_voltage_switch =
+					sdhci_arasan_zynq_voltage_switch;
+		host->mmc_host_ops.execute_tuning =
+					sdhci_arasan_zynq_execute_tuning;
+
+		ret = sdhci_arasan_add_host(sdhci_arasan);
+	} else {
+		ret = sdhci_add_host(host);
+	}
 	if (ret)
 		goto err_add_host;
 
@@ -713,6 +821,7 @@ static struct platform_driver sdhci_arasan_driver = {
 		.name = "sdhci-arasan",
 		.of_match_table = sdhci_arasan_of_match,
 		.pm = &sdhci_arasan_dev_pm_ops,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe = sdhci_arasan_probe,
 	.remove = sdhci_arasan_remove,
@@ -45,10 +45,14 @@
 
 #define MAX_TUNING_LOOP 40
 
+/* Longest time spent polling for a command response in sdhci_request() */
+#define SDHCI_POLL_CMD_US	20
+
 static unsigned int debug_quirks = 0;
 static unsigned int debug_quirks2;
 
 static void sdhci_finish_data(struct sdhci_host *);
+static void sdhci_cmd_irq(struct sdhci_host *host, u32 intmask);
 
 static void sdhci_enable_preset_value(struct sdhci_host *host, bool enable);
 
@@ -239,6 +243,7 @@ static void sdhci_set_default_irqs(struct sdhci_host *host)
 
 	sdhci_writel(host, host->ier, SDHCI_INT_ENABLE);
 	sdhci_writel(host, host->ier, SDHCI_SIGNAL_ENABLE);
+	host->resp_irq_masked = false;
 }
 
 static void sdhci_init(struct sdhci_host *host, int soft)
@@ -547,13 +552,39 @@ static void sdhci_adma_mark_end(void *desc)
 	dma_desc->cmd |= cpu_to_le16(ADMA2_END);
 }
 
+static void *sdhci_adma_table(struct sdhci_host *host, unsigned int set)
+{
+	return host->adma_table + set * host->adma_table_sz;
+}
+
+static dma_addr_t sdhci_adma_table_addr(struct sdhci_host *host,
+					unsigned int set)
+{
+	return host->adma_addr + set * host->adma_table_sz;
+}
+
+static void *sdhci_align_buffer(struct sdhci_host *host, unsigned int set)
+{
+	return host->align_buffer + set * host->align_buffer_sz;
+}
+
+static dma_addr_t sdhci_align_addr(struct sdhci_host *host, unsigned int set)
+{
+	return host->align_addr + set * host->align_buffer_sz;
+}
+
+static size_t sdhci_adma_size(struct sdhci_host *host)
+{
+	return SDHCI_ADMA_SETS * (host->align_buffer_sz + host->adma_table_sz);
+}
+
 static void sdhci_adma_table_pre(struct sdhci_host *host,
-	struct mmc_data *data, int sg_count)
+	struct mmc_data *data, int sg_count, unsigned int set)
 {
 	struct scatterlist *sg;
 	unsigned long flags;
 	dma_addr_t addr, align_addr;
-	void *desc, *align;
+	void *table, *desc, *align;
 	char *buffer;
 	int len, offset, i;
 
@@ -562,14 +593,13 @@ static void sdhci_adma_table_pre(struct sdhci_host *host,
 	 * We currently guess that it is LE.
 	 */
 
-	host->sg_count = sg_count;
+	table = sdhci_adma_table(host, set);
+	desc = table;
+	align = sdhci_align_buffer(host, set);
 
-	desc = host->adma_table;
-	align = host->align_buffer;
+	align_addr = sdhci_align_addr(host, set);
 
-	align_addr = host->align_addr;
-
-	for_each_sg(data->sg, sg, host->sg_count, i) {
+	for_each_sg(data->sg, sg, sg_count, i) {
 		addr = sg_dma_address(sg);
 		len = sg_dma_len(sg);
 
@@ -616,12 +646,12 @@ static void sdhci_adma_table_pre(struct sdhci_host *host,
 		 * If this triggers then we have a calculation bug
 		 * somewhere. :/
 		 */
-		WARN_ON((desc - host->adma_table) >= host->adma_table_sz);
+		WARN_ON((desc - table) >= host->adma_table_sz);
 	}
 
 	if (host->quirks & SDHCI_QUIRK_NO_ENDATTR_IN_NOPDESC) {
 		/* Mark the last descriptor as the terminating descriptor */
-		if (desc != host->adma_table) {
+		if (desc != table) {
 			desc -= host->desc_sz;
 			sdhci_adma_mark_end(desc);
 		}
@@ -654,7 +684,7 @@ static void sdhci_adma_table_post(struct sdhci_host *host,
 			dma_sync_sg_for_cpu(mmc_dev(host->mmc), data->sg,
 					    data->sg_len, DMA_FROM_DEVICE);
 
-			align = host->align_buffer;
+			align = sdhci_align_buffer(host, host->adma_set);
 
 			for_each_sg(data->sg, sg, host->sg_count, i) {
 				if (sg_dma_address(sg) & SDHCI_ADMA2_MASK) {
@@ -769,6 +799,7 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 {
 	u8 ctrl;
 	struct mmc_data *data = cmd->data;
+	bool prebuilt = false;
 
 	if (sdhci_data_line_cmd(cmd))
 		sdhci_set_timeout(host, cmd);
@@ -787,6 +818,11 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 	host->data_early = 0;
 	host->data->bytes_xfered = 0;
 
+	if (host->adma_pre_data == data) {
+		host->adma_pre_data = NULL;
+		prebuilt = true;
+	}
+
 	if (host->flags & (SDHCI_USE_SDMA | SDHCI_USE_ADMA)) {
 		struct scatterlist *sg;
 		unsigned int length_mask, offset_mask;
@@ -848,12 +884,21 @@ static void sdhci_prepare_data(struct sdhci_host *host, struct mmc_command *cmd)
 			WARN_ON(1);
 			host->flags &= ~SDHCI_REQ_USE_DMA;
 		} else if (host->flags & SDHCI_USE_ADMA) {
-			sdhci_adma_table_pre(host, data, sg_cnt);
+			dma_addr_t adma_addr;
+
+			/* Use the table sdhci_pre_req() built, if any */
+			if (prebuilt)
+				host->adma_set ^= 1;
+			else
+				sdhci_adma_table_pre(host, data, sg_cnt,
+						     host->adma_set);
+			host->sg_count = sg_cnt;
 
-			sdhci_writel(host, host->adma_addr, SDHCI_ADMA_ADDRESS);
+			adma_addr = sdhci_adma_table_addr(host, host->adma_set);
+			sdhci_writel(host, adma_addr, SDHCI_ADMA_ADDRESS);
 			if (host->flags & SDHCI_USE_64_BIT_DMA)
 				sdhci_writel(host,
-					     (u64)host->adma_addr >> 32,
+					     (u64)adma_addr >> 32,
 					     SDHCI_ADMA_ADDRESS_HI);
 		} else {
 			WARN_ON(sg_cnt != 1);
@@ -986,6 +1031,10 @@ static void __sdhci_finish_mrq(struct sdhci_host *host, struct mmc_request *mrq)
 
 	WARN_ON(i >= SDHCI_MAX_MRQS);
 
+	/* sdhci_irq() hands requests finished there to the irq thread */
+	if ((host->quirks2 & SDHCI_QUIRK2_FAST_COMPLETION) && in_irq())
+		return;
+
 	tasklet_schedule(&host->finish_tasklet);
 }
 
@@ -1083,6 +1132,16 @@ static void sdhci_del_timer(struct sdhci_host *host, struct mmc_request *mrq)
 		del_timer(&host->timer);
 }
 
+static void sdhci_set_resp_irq(struct sdhci_host *host, bool enable)
+{
+	if (host->resp_irq_masked == !enable)
+		return;
+
+	host->resp_irq_masked = !enable;
+	sdhci_writel(host, enable ? host->ier : host->ier & ~SDHCI_INT_RESPONSE,
+		     SDHCI_SIGNAL_ENABLE);
+}
+
 void sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 {
 	int flags;
@@ -1169,6 +1228,13 @@ void sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 	    cmd->opcode == MMC_SEND_TUNING_BLOCK_HS200)
 		flags |= SDHCI_CMD_DATA;
 
+	/*
+	 * The response of a data command is still latched in the interrupt
+	 * status and gets handled together with the data interrupt.
+	 */
+	if (host->quirks2 & SDHCI_QUIRK2_FAST_COMPLETION)
+		sdhci_set_resp_irq(host, !cmd->data && !host->poll_cmd);
+
 	sdhci_writew(host, SDHCI_MAKE_CMD(cmd->opcode, flags), SDHCI_COMMAND);
 }
 EXPORT_SYMBOL_GPL(sdhci_send_command);
@@ -1497,9 +1563,41 @@ EXPORT_SYMBOL_GPL(sdhci_set_power);
  *                                                                           *
 \*****************************************************************************/
 
+/*
+ * A CMD23 or CMD13 on a fast bus completes within a few microseconds, less
+ * than it takes to get through an interrupt.
+ */
+static bool sdhci_can_poll_cmd(struct sdhci_host *host,
+			       struct mmc_command *cmd)
+{
+	return (host->quirks2 & SDHCI_QUIRK2_FAST_COMPLETION) &&
+	       !cmd->data && !(cmd->flags & MMC_RSP_BUSY) &&
+	       (cmd->flags & MMC_RSP_PRESENT) && host->clock >= 25000000;
+}
+
+static bool sdhci_poll_cmd(struct sdhci_host *host)
+{
+	int timeout = SDHCI_POLL_CMD_US;
+	u32 intmask;
+
+	do {
+		intmask = sdhci_readl(host, SDHCI_INT_STATUS) &
+			  SDHCI_INT_CMD_MASK;
+		if (intmask) {
+			sdhci_writel(host, intmask, SDHCI_INT_STATUS);
+			sdhci_cmd_irq(host, intmask);
+			return true;
+		}
+		udelay(1);
+	} while (--timeout);
+
+	return false;
+}
+
 static void sdhci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct sdhci_host *host;
+	struct mmc_command *cmd;
 	int present;
 	unsigned long flags;
 
@@ -1528,9 +1626,19 @@ static void sdhci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 		sdhci_finish_mrq(host, mrq);
 	} else {
 		if (mrq->sbc && !(host->flags & SDHCI_AUTO_CMD23))
-			sdhci_send_command(host, mrq->sbc);
+			cmd = mrq->sbc;
 		else
-			sdhci_send_command(host, mrq->cmd);
+			cmd = mrq->cmd;
+
+		host->poll_cmd = sdhci_can_poll_cmd(host, cmd);
+		sdhci_send_command(host, cmd);
+
+		if (host->poll_cmd) {
+			host->poll_cmd = false;
+			/* Fall back to the interrupt if it takes too long */
+			if (host->cmd != cmd || !sdhci_poll_cmd(host))
+				sdhci_set_resp_irq(host, true);
+		}
 	}
 
 	mmiowb();
@@ -2221,6 +2329,13 @@ static void sdhci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
 {
 	struct sdhci_host *host = mmc_priv(mmc);
 	struct mmc_data *data = mrq->data;
+	unsigned long flags;
+
+	/* A prepared request that was never issued gives its set back */
+	spin_lock_irqsave(&host->lock, flags);
+	if (host->adma_pre_data == data)
+		host->adma_pre_data = NULL;
+	spin_unlock_irqrestore(&host->lock, flags);
 
 	if (data->host_cookie != COOKIE_UNMAPPED)
 		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
@@ -2232,11 +2347,37 @@ static void sdhci_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
 static void sdhci_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct sdhci_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	unsigned long flags;
+	unsigned int set;
+	int sg_count;
 
-	mrq->data->host_cookie = COOKIE_UNMAPPED;
+	data->host_cookie = COOKIE_UNMAPPED;
 
-	if (host->flags & SDHCI_REQ_USE_DMA)
-		sdhci_pre_dma_transfer(host, mrq->data, COOKIE_PRE_MAPPED);
+	if (!(host->flags & SDHCI_REQ_USE_DMA))
+		return;
+
+	sg_count = sdhci_pre_dma_transfer(host, data, COOKIE_PRE_MAPPED);
+	if (sg_count <= 0 || !(host->flags & SDHCI_USE_ADMA))
+		return;
+
+	/*
+	 * Build the ADMA table into the set the current request is not
+	 * using, so prepare_data() only has to switch to it. There is only
+	 * one spare set: if the previous request was prebuilt but has not
+	 * reached prepare_data() yet (e.g. still sending CMD23), leave the
+	 * table to be built when this request is issued.
+	 */
+	spin_lock_irqsave(&host->lock, flags);
+	if (host->adma_pre_data) {
+		spin_unlock_irqrestore(&host->lock, flags);
+		return;
+	}
+	host->adma_pre_data = data;
+	set = host->adma_set ^ 1;
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	sdhci_adma_table_pre(host, data, sg_count, set);
 }
 
 static inline bool sdhci_has_requests(struct sdhci_host *host)
@@ -2505,7 +2646,7 @@ static void sdhci_cmd_irq(struct sdhci_host *host, u32 intmask)
 #ifdef CONFIG_MMC_DEBUG
 static void sdhci_adma_show_error(struct sdhci_host *host)
 {
-	void *desc = host->adma_table;
+	void *desc = sdhci_adma_table(host, host->adma_set);
 
 	sdhci_dumpregs(host);
 
@@ -2605,6 +2746,7 @@ static void sdhci_data_irq(struct sdhci_host *host, u32 intmask)
 	else if (intmask & SDHCI_INT_ADMA_ERROR) {
 		pr_err("%s: ADMA error\n", mmc_hostname(host->mmc));
 		sdhci_adma_show_error(host);
+		host->mmc->stats.dma_errors++;
 		host->data->error = -EIO;
 		if (host->ops->adma_workaround)
 			host->ops->adma_workaround(host, intmask);
@@ -2755,6 +2897,17 @@ cont:
 
 		intmask = sdhci_readl(host, SDHCI_INT_STATUS);
 	} while (intmask && --max_loops);
+
+	if (host->quirks2 & SDHCI_QUIRK2_FAST_COMPLETION) {
+		int i;
+
+		for (i = 0; i < SDHCI_MAX_MRQS; i++) {
+			if (host->mrqs_done[i]) {
+				result = IRQ_WAKE_THREAD;
+				break;
+			}
+		}
+	}
 out:
 	spin_unlock(&host->lock);
 
@@ -2770,9 +2923,15 @@ out:
 static irqreturn_t sdhci_thread_irq(int irq, void *dev_id)
 {
 	struct sdhci_host *host = dev_id;
+	bool completed = false;
 	unsigned long flags;
 	u32 isr;
 
+	if (host->quirks2 & SDHCI_QUIRK2_FAST_COMPLETION) {
+		while (!sdhci_request_done(host))
+			completed = true;
+	}
+
 	spin_lock_irqsave(&host->lock, flags);
 	isr = host->thread_isr;
 	host->thread_isr = 0;
@@ -2794,7 +2953,7 @@ static irqreturn_t sdhci_thread_irq(int irq, void *dev_id)
 		spin_unlock_irqrestore(&host->lock, flags);
 	}
 
-	return isr ? IRQ_HANDLED : IRQ_NONE;
+	return isr || completed ? IRQ_HANDLED : IRQ_NONE;
 }
 
 /*****************************************************************************\
@@ -3311,26 +3470,36 @@ int sdhci_setup_host(struct sdhci_host *host)
 			host->desc_sz = SDHCI_ADMA2_32_DESC_SZ;
 		}
 
+		/*
+		 * The bounce buffers of all sets come first, then the
+		 * descriptor tables, each padded to keep the next one aligned.
+		 */
+		host->adma_table_sz = ALIGN(host->adma_table_sz,
+					    SDHCI_ADMA2_DESC_ALIGN);
 		host->align_buffer_sz = SDHCI_MAX_SEGS * SDHCI_ADMA2_ALIGN;
-		buf = dma_alloc_coherent(mmc_dev(mmc), host->align_buffer_sz +
-					 host->adma_table_sz, &dma, GFP_KERNEL);
+		buf = dma_alloc_coherent(mmc_dev(mmc), sdhci_adma_size(host),
+					 &dma, GFP_KERNEL);
 		if (!buf) {
 			pr_warn("%s: Unable to allocate ADMA buffers - falling back to standard DMA\n",
 				mmc_hostname(mmc));
 			host->flags &= ~SDHCI_USE_ADMA;
-		} else if ((dma + host->align_buffer_sz) &
+		} else if ((dma + SDHCI_ADMA_SETS * host->align_buffer_sz) &
 			   (SDHCI_ADMA2_DESC_ALIGN - 1)) {
 			pr_warn("%s: unable to allocate aligned ADMA descriptor\n",
 				mmc_hostname(mmc));
 			host->flags &= ~SDHCI_USE_ADMA;
-			dma_free_coherent(mmc_dev(mmc), host->align_buffer_sz +
-					  host->adma_table_sz, buf, dma);
+			dma_free_coherent(mmc_dev(mmc), sdhci_adma_size(host),
+					  buf, dma);
 		} else {
 			host->align_buffer = buf;
 			host->align_addr = dma;
 
-			host->adma_table = buf + host->align_buffer_sz;
-			host->adma_addr = dma + host->align_buffer_sz;
+			host->adma_table = buf + SDHCI_ADMA_SETS *
+					   host->align_buffer_sz;
+			host->adma_addr = dma + SDHCI_ADMA_SETS *
+					  host->align_buffer_sz;
+			host->adma_set = 0;
+			host->adma_pre_data = NULL;
 		}
 	}
 
@@ -3694,9 +3863,8 @@ unreg:
 		regulator_disable(mmc->supply.vqmmc);
 undma:
 	if (host->align_buffer)
-		dma_free_coherent(mmc_dev(mmc), host->align_buffer_sz +
-				  host->adma_table_sz, host->align_buffer,
-				  host->align_addr);
+		dma_free_coherent(mmc_dev(mmc), sdhci_adma_size(host),
+				  host->align_buffer, host->align_addr);
 	host->adma_table = NULL;
 	host->align_buffer = NULL;
 
@@ -3712,9 +3880,8 @@ void sdhci_cleanup_host(struct sdhci_host *host)
 		regulator_disable(mmc->supply.vqmmc);
 
 	if (host->align_buffer)
-		dma_free_coherent(mmc_dev(mmc), host->align_buffer_sz +
-				  host->adma_table_sz, host->align_buffer,
-				  host->align_addr);
+		dma_free_coherent(mmc_dev(mmc), sdhci_adma_size(host),
+				  host->align_buffer, host->align_addr);
 	host->adma_table = NULL;
 	host->align_buffer = NULL;
 }
@@ -3850,9 +4017,8 @@ void sdhci_remove_host(struct sdhci_host *host, int dead)
 		regulator_disable(mmc->supply.vqmmc);
 
 	if (host->align_buffer)
-		dma_free_coherent(mmc_dev(mmc), host->align_buffer_sz +
-				  host->adma_table_sz, host->align_buffer,
-				  host->align_addr);
+		dma_free_coherent(mmc_dev(mmc), sdhci_adma_size(host),
+				  host->align_buffer, host->align_addr);
 
 	host->adma_table = NULL;
 	host->align_buffer = NULL;
@@ -329,6 +329,13 @@ struct sdhci_adma2_64_desc {
  */
 #define SDHCI_MAX_SEGS		128
 
+/*
+ * Number of ADMA descriptor table/bounce buffer sets, so that the table for
+ * the next request can be built in sdhci_pre_req() while the current one is
+ * still in use by the controller.
+ */
+#define SDHCI_ADMA_SETS		2
+
 /* Allow for a a command request and a data request at the same time */
 #define SDHCI_MAX_MRQS		2
 
@@ -435,6 +442,12 @@ struct sdhci_host {
 #define SDHCI_QUIRK2_ACMD23_BROKEN			(1<<14)
 /* Broken Clock divider zero in controller */
 #define SDHCI_QUIRK2_CLOCK_DIV_ZERO_BROKEN		(1<<15)
+/*
+ * Take one interrupt per data request (the command response is picked up
+ * with the data interrupt), poll for short command responses and complete
+ * requests from the irq thread instead of the finish tasklet.
+ */
+#define SDHCI_QUIRK2_FAST_COMPLETION			(1<<16)
 
 	int irq;		/* Device IRQ */
 	void __iomem *ioaddr;	/* Mapped address */
@@ -482,6 +495,8 @@ struct sdhci_host {
 	bool bus_on;		/* Bus power prevents runtime suspend */
 	bool preset_enabled;	/* Preset is enabled */
 	bool pending_reset;	/* Cmd/data reset is pending */
+	bool resp_irq_masked;	/* Command response does not signal */
+	bool poll_cmd;		/* Response of next command is polled */
 
 	struct mmc_request *mrqs_done[SDHCI_MAX_MRQS];	/* Requests done */
 	struct mmc_command *cmd;	/* Current command */
@@ -494,14 +509,17 @@ struct sdhci_host {
 
 	int sg_count;		/* Mapped sg entries */
 
-	void *adma_table;	/* ADMA descriptor table */
-	void *align_buffer;	/* Bounce buffer */
+	void *adma_table;	/* ADMA descriptor tables */
+	void *align_buffer;	/* Bounce buffers */
+
+	size_t adma_table_sz;	/* ADMA descriptor table size, per set */
+	size_t align_buffer_sz;	/* Bounce buffer size, per set */
 
-	size_t adma_table_sz;	/* ADMA descriptor table size */
-	size_t align_buffer_sz;	/* Bounce buffer size */
+	dma_addr_t adma_addr;	/* Mapped ADMA descr. tables */
+	dma_addr_t align_addr;	/* Mapped bounce buffers */
 
-	dma_addr_t adma_addr;	/* Mapped ADMA descr. table */
-	dma_addr_t align_addr;	/* Mapped bounce buffer */
+	unsigned int adma_set;	/* ADMA set in use by the current request */
+	struct mmc_data *adma_pre_data;	/* Data built into the other set */
 
 	unsigned int desc_sz;	/* ADMA descriptor size */
 
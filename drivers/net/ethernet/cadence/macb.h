@@ -10,7 +10,13 @@
 #ifndef _MACB_H
 #define _MACB_H
 
+#include <linux/hrtimer.h>
 #include <linux/phy.h>
+#include <linux/u64_stats_sync.h>
+#ifdef CONFIG_MACB_USE_HWSTAMP
+#include <linux/net_tstamp.h>
+#include <linux/ptp_clock_kernel.h>
+#endif
 
 #define MACB_GREGS_NBR 16
 #define MACB_GREGS_VERSION 2
@@ -76,6 +82,7 @@
 #define GEM_USRIO		0x000c /* User IO */
 #define GEM_DMACFG		0x0010 /* DMA Configuration */
 #define GEM_JML			0x0048 /* Jumbo Max Length */
+#define GEM_INTMOD		0x005c /* Interrupt Moderation */
 #define GEM_HRB			0x0080 /* Hash Bottom */
 #define GEM_HRT			0x0084 /* Hash Top */
 #define GEM_SA1B		0x0088 /* Specific1 Bottom */
@@ -154,14 +161,21 @@
 #define GEM_DCFG5		0x0290 /* Design Config 5 */
 #define GEM_DCFG6		0x0294 /* Design Config 6 */
 #define GEM_DCFG7		0x0298 /* Design Config 7 */
+#define GEM_DCFG8		0x029C /* Design Config 8 */
 
 #define GEM_ISR(hw_q)		(0x0400 + ((hw_q) << 2))
 #define GEM_TBQP(hw_q)		(0x0440 + ((hw_q) << 2))
 #define GEM_TBQPH(hw_q)		(0x04C8)
 #define GEM_RBQP(hw_q)		(0x0480 + ((hw_q) << 2))
+#define GEM_RBQS(hw_q)		(0x04A0 + ((hw_q) << 2))
+#define GEM_SCRT1(i)		(0x0500 + ((i) << 2)) /* Screening Type 1 */
+#define GEM_SCRT2(i)		(0x0540 + ((i) << 2)) /* Screening Type 2 */
 #define GEM_IER(hw_q)		(0x0600 + ((hw_q) << 2))
 #define GEM_IDR(hw_q)		(0x0620 + ((hw_q) << 2))
 #define GEM_IMR(hw_q)		(0x0640 + ((hw_q) << 2))
+#define GEM_ETHT(i)		(0x06E0 + ((i) << 2)) /* Type 2 EtherType */
+#define GEM_T2CMPW0(i)		(0x0700 + ((i) << 3)) /* Type 2 Compare Word 0 */
+#define GEM_T2CMPW1(i)		(0x0704 + ((i) << 3)) /* Type 2 Compare Word 1 */
 
 /* Bitfields in NCR */
 #define MACB_LB_OFFSET		0 /* reserved */
@@ -413,6 +427,12 @@
 #define MACB_REV_OFFSET				0
 #define MACB_REV_SIZE				16
 
+/* Bitfields in INTMOD, in units of 800 ns */
+#define GEM_RX_INTMOD_OFFSET			0
+#define GEM_RX_INTMOD_SIZE			8
+#define GEM_TX_INTMOD_OFFSET			16
+#define GEM_TX_INTMOD_SIZE			8
+
 /* Bitfields in DCFG1. */
 #define GEM_IRQCOR_OFFSET			23
 #define GEM_IRQCOR_SIZE				1
@@ -425,12 +445,86 @@
 #define GEM_TX_PKT_BUFF_OFFSET			21
 #define GEM_TX_PKT_BUFF_SIZE			1
 
+/* Bitfields in DCFG5. */
+#define GEM_TSU_OFFSET				8
+#define GEM_TSU_SIZE				1
+
 /* Bitfields in DCFG6. */
 #define GEM_PBUF_LSO_OFFSET			27
 #define GEM_PBUF_LSO_SIZE			1
 #define GEM_DAW64_OFFSET			23
 #define GEM_DAW64_SIZE				1
 
+/* Bitfields in DCFG8. */
+#define GEM_T1SCR_OFFSET			24
+#define GEM_T1SCR_SIZE				8
+#define GEM_T2SCR_OFFSET			16
+#define GEM_T2SCR_SIZE				8
+#define GEM_SCR2ETH_OFFSET			8
+#define GEM_SCR2ETH_SIZE			8
+#define GEM_SCR2CMP_OFFSET			0
+#define GEM_SCR2CMP_SIZE			8
+
+/* Bitfields in SCRT1 and SCRT2 */
+#define GEM_SCRQUEUE_OFFSET			0 /* Queue for matches */
+#define GEM_SCRQUEUE_SIZE			4
+
+/* Bitfields in SCRT1 */
+#define GEM_DSTCM_OFFSET			4 /* IP DS/TC field match */
+#define GEM_DSTCM_SIZE				8
+#define GEM_UDPM_OFFSET				12 /* UDP destination port */
+#define GEM_UDPM_SIZE				16
+#define GEM_DSTCEN_OFFSET			28
+#define GEM_DSTCEN_SIZE				1
+#define GEM_UDPEN_OFFSET			29
+#define GEM_UDPEN_SIZE				1
+
+/* Bitfields in SCRT2 */
+#define GEM_VLANPR_OFFSET			4 /* VLAN priority */
+#define GEM_VLANPR_SIZE				3
+#define GEM_VLANEN_OFFSET			8
+#define GEM_VLANEN_SIZE				1
+#define GEM_ETHT2IDX_OFFSET			9 /* EtherType register index */
+#define GEM_ETHT2IDX_SIZE			3
+#define GEM_ETHTEN_OFFSET			12
+#define GEM_ETHTEN_SIZE				1
+#define GEM_CMPA_OFFSET				13 /* Compare register indexes */
+#define GEM_CMPA_SIZE				5
+#define GEM_CMPAEN_OFFSET			18
+#define GEM_CMPAEN_SIZE				1
+#define GEM_CMPB_OFFSET				19
+#define GEM_CMPB_SIZE				5
+#define GEM_CMPBEN_OFFSET			24
+#define GEM_CMPBEN_SIZE				1
+#define GEM_CMPC_OFFSET				25
+#define GEM_CMPC_SIZE				5
+#define GEM_CMPCEN_OFFSET			30
+#define GEM_CMPCEN_SIZE				1
+
+/* Bitfields in ETHT */
+#define GEM_ETHTCMP_OFFSET			0
+#define GEM_ETHTCMP_SIZE			16
+
+/* Bitfields in T2CMPW0 */
+#define GEM_T2MASK_OFFSET			0
+#define GEM_T2MASK_SIZE				16
+#define GEM_T2CMP_OFFSET			16
+#define GEM_T2CMP_SIZE				16
+
+/* Bitfields in T2CMPW1 */
+#define GEM_T2OFST_OFFSET			0 /* Offset in the frame */
+#define GEM_T2OFST_SIZE				7
+#define GEM_T2CMPOFST_OFFSET			7 /* What the offset counts from */
+#define GEM_T2CMPOFST_SIZE			2
+#define GEM_T2DISMSK_OFFSET			9 /* 32 bit compare, no mask */
+#define GEM_T2DISMSK_SIZE			1
+
+/* T2CMPOFST values */
+#define GEM_T2COMPOFST_SOF			0
+#define GEM_T2COMPOFST_ETYPE			1
+#define GEM_T2COMPOFST_IPHDR			2
+#define GEM_T2COMPOFST_TCPUDP			3
+
 /* Bitfields in TISUBN */
 #define GEM_SUBNSINCR_OFFSET			0
 #define GEM_SUBNSINCR_SIZE			16
@@ -442,6 +536,8 @@
 /* Bitfields in ADJ */
 #define GEM_ADDSUB_OFFSET			31
 #define GEM_ADDSUB_SIZE				1
+#define GEM_ITDT_OFFSET				0 /* Nanoseconds to add or subtract */
+#define GEM_ITDT_SIZE				30
 /* Constants for CLK */
 #define MACB_CLK_DIV8				0
 #define MACB_CLK_DIV16				1
@@ -470,6 +566,7 @@
 #define MACB_CAPS_USRIO_DISABLED		0x00000010
 #define MACB_CAPS_JUMBO				0x00000020
 #define MACB_CAPS_GEM_HAS_PTP			0x00000040
+#define MACB_CAPS_INT_MODERATION		0x00000080
 #define MACB_CAPS_FIFO_MODE			0x10000000
 #define MACB_CAPS_GIGABIT_MODE_AVAILABLE	0x20000000
 #define MACB_CAPS_SG_DISABLED			0x40000000
@@ -511,6 +608,7 @@
 #define macb_writel(port, reg, value)	(port)->macb_reg_writel((port), MACB_##reg, (value))
 #define gem_readl(port, reg)		(port)->macb_reg_readl((port), GEM_##reg)
 #define gem_writel(port, reg, value)	(port)->macb_reg_writel((port), GEM_##reg, (value))
+#define gem_writel_n(port, reg, i, value)	(port)->macb_reg_writel((port), GEM_##reg(i), (value))
 #define queue_readl(queue, reg)		(queue)->bp->macb_reg_readl((queue)->bp, (queue)->reg)
 #define queue_writel(queue, reg, value)	(queue)->bp->macb_reg_writel((queue)->bp, (queue)->reg, (value))
 
@@ -654,14 +752,55 @@ struct macb_dma_desc_64 {
  * @size: size of the DMA mapped buffer
  * @mapped_as_page: true when buffer was mapped with skb_frag_dma_map(),
  *                  false when buffer was mapped with dma_map_single()
+ * @page: RX page an XDP_TX frame is sent from, instead of an skb
  */
 struct macb_tx_skb {
 	struct sk_buff		*skb;
+	struct page		*page;
 	dma_addr_t		mapping;
 	size_t			size;
 	bool			mapped_as_page;
 };
 
+/* struct macb_rx_page - page backing a GEM receive descriptor
+ * @page: page split in two halves, each one a build_skb() fragment
+ * @dma: DMA address of the whole page, mapped once
+ * @offset: offset of the half currently given to the hardware
+ * @clean: the CPU has not written to that half since it was last synced
+ */
+struct macb_rx_page {
+	struct page		*page;
+	dma_addr_t		dma;
+	unsigned int		offset;
+	bool			clean;
+};
+
+/* struct gem_rx_fs - an ethtool -N rule and the screener it lives in
+ * @fs: the rule as given by ethtool
+ * @used: the location holds a rule
+ * @type2: programmed in a type 2 screener, else a type 1 one
+ * @scr: screener index within its type
+ * @scr_val: screener register value
+ * @etht: EtherType register used, or -1
+ * @ncmp: number of compare registers used, in @cmp
+ * @cmp_w0: compare register word 0 values
+ * @cmp_w1: compare register word 1 values
+ */
+#define GEM_T2_MAX_CMP	3
+
+struct gem_rx_fs {
+	struct ethtool_rx_flow_spec	fs;
+	bool				used;
+	bool				type2;
+	u8				scr;
+	u32				scr_val;
+	s8				etht;
+	u8				ncmp;
+	u8				cmp[GEM_T2_MAX_CMP];
+	u32				cmp_w0[GEM_T2_MAX_CMP];
+	u32				cmp_w1[GEM_T2_MAX_CMP];
+};
+
 /* Hardware-collected statistics. Used when updating the network
  * device stats by a periodic timer.
  */
@@ -838,13 +977,59 @@ static const struct gem_statistic gem_statistics[] = {
 
 #define GEM_STATS_LEN ARRAY_SIZE(gem_statistics)
 
+/* Software statistics kept per queue */
+#define MACB_POLL_HIST_LEN	8	/* packets per poll, by fls() */
+
+struct queue_stats {
+	u64	napi_polls;
+	u64	poll_hist[MACB_POLL_HIST_LEN];
+	u64	rx_refill_failures;
+	u64	tx_ring_full;
+	u64	irqs;
+	u64	irq_time_ns;
+
+	/* Writers are NAPI for the RX counters, bp->lock for the rest */
+	struct u64_stats_sync	rx_syncp;
+	struct u64_stats_sync	syncp;
+};
+
+struct queue_statistic {
+	char stat_string[ETH_GSTRING_LEN];
+	int offset;
+};
+
+#define QUEUE_STAT_TITLE(name, title) {			\
+	.stat_string = title,				\
+	.offset = offsetof(struct queue_stats, name)	\
+}
+
+/* Reported as q<queue>_<title> */
+static const struct queue_statistic queue_statistics[] = {
+	QUEUE_STAT_TITLE(napi_polls, "napi_polls"),
+	QUEUE_STAT_TITLE(poll_hist[0], "polls_0_packets"),
+	QUEUE_STAT_TITLE(poll_hist[1], "polls_1_packets"),
+	QUEUE_STAT_TITLE(poll_hist[2], "polls_2_3_packets"),
+	QUEUE_STAT_TITLE(poll_hist[3], "polls_4_7_packets"),
+	QUEUE_STAT_TITLE(poll_hist[4], "polls_8_15_packets"),
+	QUEUE_STAT_TITLE(poll_hist[5], "polls_16_31_packets"),
+	QUEUE_STAT_TITLE(poll_hist[6], "polls_32_63_packets"),
+	QUEUE_STAT_TITLE(poll_hist[7], "polls_64_packets"),
+	QUEUE_STAT_TITLE(rx_refill_failures, "rx_refill_failures"),
+	QUEUE_STAT_TITLE(tx_ring_full, "tx_ring_full"),
+	QUEUE_STAT_TITLE(irqs, "irqs"),
+	QUEUE_STAT_TITLE(irq_time_ns, "irq_time_ns"),
+};
+
+#define QUEUE_STATS_LEN ARRAY_SIZE(queue_statistics)
+
 struct macb;
+struct macb_queue;
 
 struct macb_or_gem_ops {
 	int	(*mog_alloc_rx_buffers)(struct macb *bp);
 	void	(*mog_free_rx_buffers)(struct macb *bp);
 	void	(*mog_init_rings)(struct macb *bp);
-	int	(*mog_rx)(struct macb *bp, int budget);
+	int	(*mog_rx)(struct macb_queue *queue, int budget);
 };
 
 /* MACB-PTP interface: adapt to platform needs. */
@@ -881,12 +1066,25 @@ struct macb_queue {
 	unsigned int		IMR;
 	unsigned int		TBQP;
 	unsigned int		TBQPH;
+	unsigned int		RBQS;
+	unsigned int		RBQP;
 
 	unsigned int		tx_head, tx_tail;
 	struct macb_dma_desc	*tx_ring;
 	struct macb_tx_skb	*tx_skb;
 	dma_addr_t		tx_ring_dma;
 	struct work_struct	tx_error_task;
+
+	unsigned int		rx_tail;
+	unsigned int		rx_prepared_head;
+	struct macb_dma_desc	*rx_ring;
+	struct macb_rx_page	*rx_page;
+	struct sk_buff		*rx_skb;	/* frame being assembled */
+	dma_addr_t		rx_ring_dma;
+	struct napi_struct	napi;
+	struct hrtimer		rx_coalesce_timer;	/* without INTMOD */
+
+	struct queue_stats	stats;
 };
 
 struct macb {
@@ -897,10 +1095,11 @@ struct macb {
 	u32	(*macb_reg_readl)(struct macb *bp, int offset);
 	void	(*macb_reg_writel)(struct macb *bp, int offset, u32 value);
 
-	unsigned int		rx_tail;
-	unsigned int		rx_prepared_head;
-	struct macb_dma_desc	*rx_ring;
-	struct sk_buff		**rx_skbuff;
+	unsigned int		rx_frag_size;
+	unsigned int		rx_page_order;
+	unsigned int		rx_copybreak;
+	unsigned int		rx_headroom;
+	struct bpf_prog		*xdp_prog;
 	void			*rx_buffers;
 	size_t			rx_buffer_size;
 
@@ -918,13 +1117,22 @@ struct macb {
 	struct clk		*tx_clk;
 	struct clk		*rx_clk;
 	struct net_device	*dev;
-	struct napi_struct	napi;
+	unsigned int		rx_coalesce_usecs;
+	unsigned int		tx_coalesce_usecs;
+
+	/* RX flow steering into the queues, under RTNL */
+	struct gem_rx_fs	*rx_fs;		/* indexed by rule location */
+	unsigned int		rx_fs_count;
+	u8			num_t1_scr, num_t2_scr;
+	u8			num_etht, num_t2cmp;
+	u32			t1_scr_used, t2_scr_used, t2cmp_used;
+	u16			etht_val[8];
+	u8			etht_refs[8];
 	union {
 		struct macb_stats	macb;
 		struct gem_stats	gem;
 	}			hw_stats;
 
-	dma_addr_t		rx_ring_dma;
 	dma_addr_t		rx_buffers_dma;
 
 	struct macb_or_gem_ops	macbgem_ops;
@@ -954,6 +1162,17 @@ struct macb {
 	u32			wol;
 
 	struct macb_ptp_info	*ptp_info;	/* macb-ptp interface */
+#ifdef CONFIG_MACB_USE_HWSTAMP
+	struct ptp_clock	*ptp_clock;
+	struct ptp_clock_info	ptp_clock_info;
+	spinlock_t		tsu_clk_lock;	/* TSU timer registers */
+	unsigned int		tsu_rate;
+	s32			tsu_ppb;	/* rate applied by tsu_adj_work */
+	s64			tsu_adj_rem;	/* ppb * ns not applied yet */
+	ktime_t			tsu_adj_last;
+	struct delayed_work	tsu_adj_work;
+	struct hwtstamp_config	tstamp_config;
+#endif
 #ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
 	enum macb_hw_dma_cap hw_dma_cap;
 #endif
@@ -969,4 +1188,36 @@ static inline bool gem_has_ptp(struct macb *bp)
 	return !!(bp->caps & MACB_CAPS_GEM_HAS_PTP);
 }
 
+#ifdef CONFIG_MACB_USE_HWSTAMP
+extern struct macb_ptp_info gem_ptp_info;
+
+void gem_ptp_do_tx_prep(struct macb *bp, struct sk_buff *skb);
+void gem_ptp_do_txstamp(struct macb *bp, struct sk_buff *skb);
+void gem_ptp_do_rxstamp(struct macb *bp, struct sk_buff *skb);
+
+/* Mark PTP event frames to be timestamped on completion */
+static inline void gem_ptp_tx_prep(struct macb *bp, struct sk_buff *skb)
+{
+	if (unlikely(skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP) &&
+	    bp->tstamp_config.tx_type == HWTSTAMP_TX_ON)
+		gem_ptp_do_tx_prep(bp, skb);
+}
+
+static inline void gem_ptp_txstamp(struct macb *bp, struct sk_buff *skb)
+{
+	if (unlikely(skb_shinfo(skb)->tx_flags & SKBTX_IN_PROGRESS))
+		gem_ptp_do_txstamp(bp, skb);
+}
+
+static inline void gem_ptp_rxstamp(struct macb *bp, struct sk_buff *skb)
+{
+	if (unlikely(bp->tstamp_config.rx_filter != HWTSTAMP_FILTER_NONE))
+		gem_ptp_do_rxstamp(bp, skb);
+}
+#else
+static inline void gem_ptp_tx_prep(struct macb *bp, struct sk_buff *skb) { }
+static inline void gem_ptp_txstamp(struct macb *bp, struct sk_buff *skb) { }
+static inline void gem_ptp_rxstamp(struct macb *bp, struct sk_buff *skb) { }
+#endif
+
 #endif /* _MACB_H */
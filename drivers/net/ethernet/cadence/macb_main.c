@@ -21,6 +21,8 @@
 #include <linux/gpio.h>
 #include <linux/gpio/consumer.h>
 #include <linux/interrupt.h>
+#include <linux/bpf.h>
+#include <linux/filter.h>
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/dma-mapping.h>
@@ -32,13 +34,16 @@
 #include <linux/of_gpio.h>
 #include <linux/of_mdio.h>
 #include <linux/of_net.h>
+#include <linux/if_vlan.h>
 #include <linux/ip.h>
 #include <linux/udp.h>
 #include <linux/tcp.h>
+#include <trace/events/xdp.h>
 #include "macb.h"
 
 #define MACB_RX_BUFFER_SIZE	128
 #define RX_BUFFER_MULTIPLE	64  /* bytes */
+#define GEM_RX_COPYBREAK	256 /* bytes, frames up to this are copied */
 
 #define DEFAULT_RX_RING_SIZE	512 /* must be power of 2 */
 #define MIN_RX_RING_SIZE	64
@@ -62,6 +67,12 @@
 					| MACB_BIT(TXERR))
 #define MACB_TX_INT_FLAGS	(MACB_TX_ERR_FLAGS | MACB_BIT(TCOMP))
 
+/* Interrupt moderation, the INTMOD timer has 8 bits of 800 ns */
+#define MACB_DEFAULT_RX_COALESCE_USECS	24
+#define GEM_MAX_COALESCE_USECS		(255 * 4 / 5)
+/* Without INTMOD an hrtimer delays the RX NAPI poll instead */
+#define MACB_MAX_SW_COALESCE_USECS	1000
+
 /* Max length of transmit frame must be a multiple of 8 bytes */
 #define MACB_TX_LEN_ALIGN	8
 #define MACB_MAX_TX_LEN		((unsigned int)((1 << MACB_TX_FRMLEN_SIZE) - 1) & ~((unsigned int)(MACB_TX_LEN_ALIGN - 1)))
@@ -144,17 +155,18 @@ static unsigned int macb_rx_ring_wrap(struct macb *bp, unsigned int index)
 	return index & (bp->rx_ring_size - 1);
 }
 
-static struct macb_dma_desc *macb_rx_desc(struct macb *bp, unsigned int index)
+static struct macb_dma_desc *macb_rx_desc(struct macb_queue *queue,
+					  unsigned int index)
 {
-	index = macb_rx_ring_wrap(bp, index);
-	index = macb_adj_dma_desc_idx(bp, index);
-	return &bp->rx_ring[index];
+	index = macb_rx_ring_wrap(queue->bp, index);
+	index = macb_adj_dma_desc_idx(queue->bp, index);
+	return &queue->rx_ring[index];
 }
 
-static void *macb_rx_buffer(struct macb *bp, unsigned int index)
+static void *macb_rx_buffer(struct macb_queue *queue, unsigned int index)
 {
-	return bp->rx_buffers + bp->rx_buffer_size *
-	       macb_rx_ring_wrap(bp, index);
+	return queue->bp->rx_buffers + queue->bp->rx_buffer_size *
+	       macb_rx_ring_wrap(queue->bp, index);
 }
 
 /* I/O accessors */
@@ -595,6 +607,11 @@ static void macb_tx_unmap(struct macb *bp, struct macb_tx_skb *tx_skb)
 		dev_kfree_skb_any(tx_skb->skb);
 		tx_skb->skb = NULL;
 	}
+
+	if (tx_skb->page) {
+		put_page(tx_skb->page);
+		tx_skb->page = NULL;
+	}
 }
 
 static void macb_set_addr(struct macb *bp, struct macb_dma_desc *desc, dma_addr_t addr)
@@ -640,8 +657,8 @@ static void macb_tx_error_task(struct work_struct *work)
 		    (unsigned int)(queue - bp->queues),
 		    queue->tx_tail, queue->tx_head);
 
-	/* Prevent the queue IRQ handlers from running: each of them may call
-	 * macb_tx_interrupt(), which in turn may call netif_wake_subqueue().
+	/* Prevent the queue IRQ handlers and macb_poll() from running: the
+	 * latter calls macb_tx_complete(), which may call netif_wake_subqueue().
 	 * As explained below, we have to halt the transmission before updating
 	 * TBQP registers so we call netif_tx_stop_all_queues() to notify the
 	 * network engine about the macb/gem being halted.
@@ -671,8 +688,10 @@ static void macb_tx_error_task(struct work_struct *work)
 		skb = tx_skb->skb;
 
 		if (ctrl & MACB_BIT(TX_USED)) {
-			/* skb is set for the last buffer of the frame */
-			while (!skb) {
+			/* skb is set for the last buffer of the frame, page
+			 * for a single buffer XDP_TX frame
+			 */
+			while (!skb && !tx_skb->page) {
 				macb_tx_unmap(bp, tx_skb);
 				tail++;
 				tx_skb = macb_tx_skb(queue, tail);
@@ -683,11 +702,11 @@ static void macb_tx_error_task(struct work_struct *work)
 			 * since it's the only one written back by the hardware
 			 */
 			if (!(ctrl & MACB_BIT(TX_BUF_EXHAUSTED))) {
-				netdev_vdbg(bp->dev, "txerr skb %u (data %p) TX complete\n",
-					    macb_tx_ring_wrap(bp, tail),
-					    skb->data);
+				netdev_vdbg(bp->dev, "txerr %u TX complete\n",
+					    macb_tx_ring_wrap(bp, tail));
 				bp->dev->stats.tx_packets++;
-				bp->dev->stats.tx_bytes += skb->len;
+				bp->dev->stats.tx_bytes += skb ? skb->len :
+							  tx_skb->size;
 			}
 		} else {
 			/* "Buffers exhausted mid-frame" errors may only happen
@@ -721,6 +740,8 @@ static void macb_tx_error_task(struct work_struct *work)
 	/* Make TX ring reflect state of hardware */
 	queue->tx_head = 0;
 	queue->tx_tail = 0;
+	netdev_tx_reset_queue(netdev_get_tx_queue(bp->dev,
+						  queue - bp->queues));
 
 	/* Housework before enabling TX IRQ */
 	macb_writel(bp, TSR, macb_readl(bp, TSR));
@@ -733,21 +754,24 @@ static void macb_tx_error_task(struct work_struct *work)
 	spin_unlock_irqrestore(&bp->lock, flags);
 }
 
-static void macb_tx_interrupt(struct macb_queue *queue)
+/* Reclaim transmitted frames, called from macb_poll() */
+static void macb_tx_complete(struct macb_queue *queue)
 {
 	unsigned int tail;
 	unsigned int head;
+	unsigned int packets = 0;
+	unsigned int bytes = 0;
+	unsigned long flags;
 	u32 status;
 	struct macb *bp = queue->bp;
 	u16 queue_index = queue - bp->queues;
 
+	spin_lock_irqsave(&bp->lock, flags);
+
 	status = macb_readl(bp, TSR);
 	macb_writel(bp, TSR, status);
 
-	if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
-		queue_writel(queue, ISR, MACB_BIT(TCOMP));
-
-	netdev_vdbg(bp->dev, "macb_tx_interrupt status = 0x%03lx\n",
+	netdev_vdbg(bp->dev, "macb_tx_complete status = 0x%03lx\n",
 		    (unsigned long)status);
 
 	head = queue->tx_head;
@@ -755,6 +779,7 @@ static void macb_tx_interrupt(struct macb_queue *queue)
 		struct macb_tx_skb	*tx_skb;
 		struct sk_buff		*skb;
 		struct macb_dma_desc	*desc;
+		bool			xdp = false;
 		u32			ctrl;
 
 		desc = macb_tx_desc(queue, tail);
@@ -782,92 +807,168 @@ static void macb_tx_interrupt(struct macb_queue *queue)
 					    skb->data);
 				bp->dev->stats.tx_packets++;
 				bp->dev->stats.tx_bytes += skb->len;
+				packets++;
+				bytes += skb->len;
+			} else if (tx_skb->page) {
+				/* XDP_TX frames are not accounted to BQL */
+				bp->dev->stats.tx_packets++;
+				bp->dev->stats.tx_bytes += tx_skb->size;
+				xdp = true;
 			}
 
+			if (skb)
+				gem_ptp_txstamp(bp, skb);
+
 			/* Now we can safely release resources */
 			macb_tx_unmap(bp, tx_skb);
 
-			/* skb is set only for the last buffer of the frame.
+			/* skb is set only for the last buffer of the frame,
+			 * page for XDP_TX ones, which are a single buffer.
 			 * WARNING: at this point skb has been freed by
 			 * macb_tx_unmap().
 			 */
-			if (skb)
+			if (skb || xdp)
 				break;
 		}
 	}
 
 	queue->tx_tail = tail;
+	netdev_tx_completed_queue(netdev_get_tx_queue(bp->dev, queue_index),
+				  packets, bytes);
 	if (__netif_subqueue_stopped(bp->dev, queue_index) &&
 	    CIRC_CNT(queue->tx_head, queue->tx_tail,
 		     bp->tx_ring_size) <= MACB_TX_WAKEUP_THRESH(bp))
 		netif_wake_subqueue(bp->dev, queue_index);
+
+	spin_unlock_irqrestore(&bp->lock, flags);
+}
+
+/* A frame finished after the last macb_tx_complete() pass */
+static bool macb_tx_complete_pending(struct macb_queue *queue)
+{
+	bool pending = false;
+	unsigned long flags;
+
+	spin_lock_irqsave(&queue->bp->lock, flags);
+	if (queue->tx_tail != queue->tx_head) {
+		/* Make hw descriptor updates visible to CPU */
+		rmb();
+
+		if (macb_tx_desc(queue, queue->tx_tail)->ctrl &
+		    MACB_BIT(TX_USED))
+			pending = true;
+	}
+	spin_unlock_irqrestore(&queue->bp->lock, flags);
+
+	return pending;
 }
 
-static void gem_rx_refill(struct macb *bp)
+static inline size_t gem_rx_page_size(struct macb *bp)
 {
+	return PAGE_SIZE << bp->rx_page_order;
+}
+
+/* Give the stack the half the hardware just filled and keep the page for
+ * the other half, as long as the stack has let go of that one.
+ */
+static bool gem_rx_page_reuse(struct macb *bp, struct macb_rx_page *rx)
+{
+	if (page_ref_count(rx->page) != 1 || page_is_pfmemalloc(rx->page))
+		return false;
+
+	page_ref_inc(rx->page);
+	rx->offset ^= bp->rx_frag_size;
+
+	return true;
+}
+
+static void gem_rx_refill(struct macb_queue *queue)
+{
+	struct macb		*bp = queue->bp;
 	unsigned int		entry;
-	struct sk_buff		*skb;
+	struct macb_rx_page	*rx;
+	struct page		*page;
 	dma_addr_t		paddr;
 	struct macb_dma_desc *desc;
 
-	while (CIRC_SPACE(bp->rx_prepared_head, bp->rx_tail,
+	while (CIRC_SPACE(queue->rx_prepared_head, queue->rx_tail,
 			  bp->rx_ring_size) > 0) {
-		entry = macb_rx_ring_wrap(bp, bp->rx_prepared_head);
+		entry = macb_rx_ring_wrap(bp, queue->rx_prepared_head);
 
 		/* Make hw descriptor updates visible to CPU */
 		rmb();
 
-		bp->rx_prepared_head++;
-		desc = macb_rx_desc(bp, entry);
+		queue->rx_prepared_head++;
+		desc = macb_rx_desc(queue, entry);
 
-		if (!bp->rx_skbuff[entry]) {
-			/* allocate sk_buff for this free entry in ring */
-			skb = netdev_alloc_skb(bp->dev, bp->rx_buffer_size);
-			if (unlikely(!skb)) {
+		rx = &queue->rx_page[entry];
+		if (!rx->page) {
+			/* allocate a page for this free entry in ring */
+			page = dev_alloc_pages(bp->rx_page_order);
+			if (unlikely(!page)) {
 				netdev_err(bp->dev,
-					   "Unable to allocate sk_buff\n");
+					   "Unable to allocate RX page\n");
+				u64_stats_update_begin(&queue->stats.rx_syncp);
+				queue->stats.rx_refill_failures++;
+				u64_stats_update_end(&queue->stats.rx_syncp);
+				queue->rx_prepared_head--;
 				break;
 			}
 
-			/* now fill corresponding descriptor entry */
-			paddr = dma_map_single(&bp->pdev->dev, skb->data,
-					       bp->rx_buffer_size,
-					       DMA_FROM_DEVICE);
+			/* the half given to the hardware is synced below */
+			paddr = dma_map_page_attrs(&bp->pdev->dev, page, 0,
+						   gem_rx_page_size(bp),
+						   DMA_FROM_DEVICE,
+						   DMA_ATTR_SKIP_CPU_SYNC);
 			if (dma_mapping_error(&bp->pdev->dev, paddr)) {
-				dev_kfree_skb(skb);
+				__free_pages(page, bp->rx_page_order);
+				u64_stats_update_begin(&queue->stats.rx_syncp);
+				queue->stats.rx_refill_failures++;
+				u64_stats_update_end(&queue->stats.rx_syncp);
+				queue->rx_prepared_head--;
 				break;
 			}
 
-			bp->rx_skbuff[entry] = skb;
-
-			if (entry == bp->rx_ring_size - 1)
-				paddr |= MACB_BIT(RX_WRAP);
-			macb_set_addr(bp, desc, paddr);
-			desc->ctrl = 0;
+			rx->page = page;
+			rx->dma = paddr;
+			rx->offset = 0;
+			rx->clean = false;
+		}
 
-			/* properly align Ethernet header */
-			skb_reserve(skb, NET_IP_ALIGN);
-		} else {
-			desc->addr &= ~MACB_BIT(RX_USED);
-			desc->ctrl = 0;
+		/* The stack may have written to a recycled half */
+		if (!rx->clean) {
+			dma_sync_single_range_for_device(&bp->pdev->dev,
+							 rx->dma,
+							 rx->offset +
+							 bp->rx_headroom,
+							 bp->rx_buffer_size,
+							 DMA_FROM_DEVICE);
+			rx->clean = true;
 		}
+
+		/* now fill corresponding descriptor entry */
+		paddr = rx->dma + rx->offset + bp->rx_headroom;
+		if (entry == bp->rx_ring_size - 1)
+			paddr |= MACB_BIT(RX_WRAP);
+		macb_set_addr(bp, desc, paddr);
+		desc->ctrl = 0;
 	}
 
 	/* Make descriptor updates visible to hardware */
 	wmb();
 
 	netdev_vdbg(bp->dev, "rx ring: prepared head %d, tail %d\n",
-		    bp->rx_prepared_head, bp->rx_tail);
+		    queue->rx_prepared_head, queue->rx_tail);
 }
 
 /* Mark DMA descriptors from begin up to and not including end as unused */
-static void discard_partial_frame(struct macb *bp, unsigned int begin,
+static void discard_partial_frame(struct macb_queue *queue, unsigned int begin,
 				  unsigned int end)
 {
 	unsigned int frag;
 
 	for (frag = begin; frag != end; frag++) {
-		struct macb_dma_desc *desc = macb_rx_desc(bp, frag);
+		struct macb_dma_desc *desc = macb_rx_desc(queue, frag);
 
 		desc->addr &= ~MACB_BIT(RX_USED);
 	}
@@ -881,58 +982,286 @@ static void discard_partial_frame(struct macb *bp, unsigned int begin,
 	 */
 }
 
-static int gem_rx(struct macb *bp, int budget)
+/* Queue a frame an XDP program bounced back on the TX queue of its RX queue */
+static bool gem_xdp_tx(struct macb_queue *queue, struct macb_rx_page *rx,
+		       struct xdp_buff *xdp)
 {
+	struct macb *bp = queue->bp;
+	unsigned int len = xdp->data_end - xdp->data;
+	struct macb_tx_skb *tx_skb;
+	struct macb_dma_desc *desc;
+	unsigned int entry;
+	unsigned long flags;
+	dma_addr_t mapping;
+	u32 ctrl;
+
+	mapping = dma_map_page(&bp->pdev->dev, rx->page,
+			       xdp->data - page_address(rx->page), len,
+			       DMA_TO_DEVICE);
+	if (dma_mapping_error(&bp->pdev->dev, mapping))
+		return false;
+
+	spin_lock_irqsave(&bp->lock, flags);
+
+	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 2) {
+		spin_unlock_irqrestore(&bp->lock, flags);
+		dma_unmap_page(&bp->pdev->dev, mapping, len, DMA_TO_DEVICE);
+		return false;
+	}
+
+	entry = macb_tx_ring_wrap(bp, queue->tx_head);
+	tx_skb = &queue->tx_skb[entry];
+	tx_skb->skb = NULL;
+	tx_skb->page = rx->page;
+	tx_skb->mapping = mapping;
+	tx_skb->size = len;
+	tx_skb->mapped_as_page = true;
+
+	/* Set end of TX queue, then hand over the frame */
+	desc = macb_tx_desc(queue, entry + 1);
+	desc->ctrl = MACB_BIT(TX_USED);
+
+	ctrl = len | MACB_BIT(TX_LAST);
+	if (unlikely(entry == (bp->tx_ring_size - 1)))
+		ctrl |= MACB_BIT(TX_WRAP);
+	desc = macb_tx_desc(queue, entry);
+	macb_set_addr(bp, desc, mapping);
+	wmb();
+	desc->ctrl = ctrl;
+	queue->tx_head++;
+
+	/* Make newly initialized descriptor visible to hardware */
+	wmb();
+	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
+
+	spin_unlock_irqrestore(&bp->lock, flags);
+
+	return true;
+}
+
+/* The half the hardware filled has been passed on, by skb or XDP_TX */
+static void gem_rx_page_release(struct macb *bp, struct macb_rx_page *rx)
+{
+	rx->clean = false;
+	if (!gem_rx_page_reuse(bp, rx)) {
+		dma_unmap_page_attrs(&bp->pdev->dev, rx->dma,
+				     gem_rx_page_size(bp), DMA_FROM_DEVICE,
+				     DMA_ATTR_SKIP_CPU_SYNC);
+		rx->page = NULL;
+	}
+}
+
+/* Add one buffer of a frame spread over several descriptors to the skb
+ * being assembled: the first buffer becomes its head, the others page
+ * fragments. Returns the skb once the last buffer is in, NULL while the
+ * frame is incomplete or when it is dropped.
+ */
+static struct sk_buff *gem_rx_frag(struct macb_queue *queue,
+				   struct macb_rx_page *rx, u32 ctrl)
+{
+	struct macb *bp = queue->bp;
+	struct sk_buff *skb = queue->rx_skb;
+	unsigned int len = bp->rx_buffer_size;
+	unsigned int off = rx->offset + bp->rx_headroom;
+
+	if (ctrl & MACB_BIT(RX_SOF)) {
+		if (unlikely(skb)) {
+			/* the end of the previous frame went missing */
+			dev_kfree_skb_any(skb);
+			bp->dev->stats.rx_dropped++;
+		}
+
+		dma_sync_single_range_for_cpu(&bp->pdev->dev, rx->dma, off,
+					      len, DMA_FROM_DEVICE);
+		skb = build_skb(page_address(rx->page) + rx->offset,
+				bp->rx_frag_size);
+		queue->rx_skb = skb;
+		if (unlikely(!skb)) {
+			bp->dev->stats.rx_dropped++;
+			return NULL;
+		}
+
+		/* the first buffer starts with the NET_IP_ALIGN padding */
+		skb_reserve(skb, bp->rx_headroom + NET_IP_ALIGN);
+		skb_put(skb, len - NET_IP_ALIGN);
+		gem_rx_page_release(bp, rx);
+		return NULL;
+	}
+
+	/* the rest of a frame whose head was dropped stays in the ring */
+	if (!skb)
+		return NULL;
+
+	if (ctrl & MACB_BIT(RX_EOF)) {
+		len = ctrl & bp->rx_frm_len_mask;
+		if (len <= skb->len || len - skb->len > bp->rx_buffer_size)
+			goto drop;
+		len -= skb->len;
+	}
+
+	if (skb_shinfo(skb)->nr_frags == MAX_SKB_FRAGS)
+		goto drop;
+
+	dma_sync_single_range_for_cpu(&bp->pdev->dev, rx->dma, off, len,
+				      DMA_FROM_DEVICE);
+	skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags, rx->page, off, len,
+			bp->rx_frag_size);
+	gem_rx_page_release(bp, rx);
+
+	if (!(ctrl & MACB_BIT(RX_EOF)))
+		return NULL;
+
+	queue->rx_skb = NULL;
+	return skb;
+
+drop:
+	dev_kfree_skb_any(skb);
+	queue->rx_skb = NULL;
+	bp->dev->stats.rx_dropped++;
+	return NULL;
+}
+
+static int gem_rx(struct macb_queue *queue, int budget)
+{
+	struct macb		*bp = queue->bp;
 	unsigned int		len;
 	unsigned int		entry;
+	unsigned int		data_off;
+	struct macb_rx_page	*rx;
 	struct sk_buff		*skb;
 	struct macb_dma_desc	*desc;
+	struct bpf_prog		*xdp_prog;
+	struct xdp_buff		xdp;
+	void			*va;
 	int			count = 0;
+	u32			act;
+
+	rcu_read_lock();
+	xdp_prog = READ_ONCE(bp->xdp_prog);
 
 	while (count < budget) {
 		u32 ctrl;
-		dma_addr_t addr;
 		bool rxused;
 
-		entry = macb_rx_ring_wrap(bp, bp->rx_tail);
-		desc = macb_rx_desc(bp, entry);
+		entry = macb_rx_ring_wrap(bp, queue->rx_tail);
+		desc = macb_rx_desc(queue, entry);
 
 		/* Make hw descriptor updates visible to CPU */
 		rmb();
 
 		rxused = (desc->addr & MACB_BIT(RX_USED)) ? true : false;
-		addr = macb_get_addr(bp, desc);
 		ctrl = desc->ctrl;
 
 		if (!rxused)
 			break;
 
-		bp->rx_tail++;
+		queue->rx_tail++;
 		count++;
 
-		if (!(ctrl & MACB_BIT(RX_SOF) && ctrl & MACB_BIT(RX_EOF))) {
+		rx = &queue->rx_page[entry];
+		if (unlikely(!rx->page)) {
 			netdev_err(bp->dev,
-				   "not whole frame pointed by descriptor\n");
+				   "inconsistent Rx descriptor chain\n");
 			bp->dev->stats.rx_dropped++;
 			break;
 		}
-		skb = bp->rx_skbuff[entry];
-		if (unlikely(!skb)) {
-			netdev_err(bp->dev,
-				   "inconsistent Rx descriptor chain\n");
+
+		/* Without XDP, jumbo frames span several buffers */
+		if (!(ctrl & MACB_BIT(RX_SOF) && ctrl & MACB_BIT(RX_EOF))) {
+			if (unlikely(xdp_prog)) {
+				netdev_err(bp->dev,
+					   "not whole frame pointed by descriptor\n");
+				bp->dev->stats.rx_dropped++;
+				break;
+			}
+
+			skb = gem_rx_frag(queue, rx, ctrl);
+			if (!skb)
+				continue;
+			goto deliver;
+		}
+
+		if (unlikely(queue->rx_skb)) {
+			/* the end of the previous frame went missing */
+			dev_kfree_skb_any(queue->rx_skb);
+			queue->rx_skb = NULL;
 			bp->dev->stats.rx_dropped++;
-			break;
 		}
-		/* now everything is ready for receiving packet */
-		bp->rx_skbuff[entry] = NULL;
+
 		len = ctrl & bp->rx_frm_len_mask;
 
 		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
 
+		/* only the received bytes need to be seen by the CPU */
+		dma_sync_single_range_for_cpu(&bp->pdev->dev, rx->dma,
+					      rx->offset + bp->rx_headroom,
+					      NET_IP_ALIGN + len,
+					      DMA_FROM_DEVICE);
+
+		/* the hardware put the Ethernet header after NET_IP_ALIGN */
+		va = page_address(rx->page) + rx->offset;
+		data_off = bp->rx_headroom + NET_IP_ALIGN;
+
+		if (xdp_prog) {
+			xdp.data_hard_start = va;
+			xdp.data = va + data_off;
+			xdp.data_end = xdp.data + len;
+
+			act = bpf_prog_run_xdp(xdp_prog, &xdp);
+
+			/* the program may have written to the buffer */
+			rx->clean = false;
+
+			switch (act) {
+			case XDP_PASS:
+				data_off = xdp.data - va;
+				len = xdp.data_end - xdp.data;
+				break;
+			case XDP_TX:
+				if (likely(gem_xdp_tx(queue, rx, &xdp))) {
+					gem_rx_page_release(bp, rx);
+					continue;
+				}
+				/* fall through */
+			default:
+				if (act != XDP_TX)
+					bpf_warn_invalid_xdp_action(act);
+				/* fall through */
+			case XDP_ABORTED:
+				trace_xdp_exception(bp->dev, xdp_prog, act);
+				/* fall through */
+			case XDP_DROP:
+				/* the buffer goes straight back to the ring */
+				continue;
+			}
+		}
+
+		if (len <= bp->rx_copybreak) {
+			/* copy small frames, the buffer stays where it is */
+			skb = napi_alloc_skb(&queue->napi, len);
+			if (unlikely(!skb)) {
+				bp->dev->stats.rx_dropped++;
+				continue;
+			}
+			memcpy(skb_put(skb, len), va + data_off, len);
+			goto deliver;
+		}
+
+		skb = build_skb(va, bp->rx_frag_size);
+		if (unlikely(!skb)) {
+			/* leave the buffer in place for the next frame */
+			bp->dev->stats.rx_dropped++;
+			continue;
+		}
+
+		skb_reserve(skb, data_off);
 		skb_put(skb, len);
-		dma_unmap_single(&bp->pdev->dev, addr,
-				 bp->rx_buffer_size, DMA_FROM_DEVICE);
 
+		/* now everything is ready for receiving packet */
+		gem_rx_page_release(bp, rx);
+
+deliver:
+		gem_ptp_rxstamp(bp, skb);
 		skb->protocol = eth_type_trans(skb, bp->dev);
 		skb_checksum_none_assert(skb);
 		if (bp->dev->features & NETIF_F_RXCSUM &&
@@ -952,24 +1281,27 @@ static int gem_rx(struct macb *bp, int budget)
 			       skb->data, 32, true);
 #endif
 
-		netif_receive_skb(skb);
+		napi_gro_receive(&queue->napi, skb);
 	}
 
-	gem_rx_refill(bp);
+	rcu_read_unlock();
+
+	gem_rx_refill(queue);
 
 	return count;
 }
 
-static int macb_rx_frame(struct macb *bp, unsigned int first_frag,
+static int macb_rx_frame(struct macb_queue *queue, unsigned int first_frag,
 			 unsigned int last_frag)
 {
+	struct macb *bp = queue->bp;
 	unsigned int len;
 	unsigned int frag;
 	unsigned int offset;
 	struct sk_buff *skb;
 	struct macb_dma_desc *desc;
 
-	desc = macb_rx_desc(bp, last_frag);
+	desc = macb_rx_desc(queue, last_frag);
 	len = desc->ctrl & bp->rx_frm_len_mask;
 
 	netdev_vdbg(bp->dev, "macb_rx_frame frags %u - %u (len %u)\n",
@@ -988,7 +1320,7 @@ static int macb_rx_frame(struct macb *bp, unsigned int first_frag,
 	if (!skb) {
 		bp->dev->stats.rx_dropped++;
 		for (frag = first_frag; ; frag++) {
-			desc = macb_rx_desc(bp, frag);
+			desc = macb_rx_desc(queue, frag);
 			desc->addr &= ~MACB_BIT(RX_USED);
 			if (frag == last_frag)
 				break;
@@ -1016,10 +1348,10 @@ static int macb_rx_frame(struct macb *bp, unsigned int first_frag,
 			frag_len = len - offset;
 		}
 		skb_copy_to_linear_data_offset(skb, offset,
-					       macb_rx_buffer(bp, frag),
+					       macb_rx_buffer(queue, frag),
 					       frag_len);
 		offset += bp->rx_buffer_size;
-		desc = macb_rx_desc(bp, frag);
+		desc = macb_rx_desc(queue, frag);
 		desc->addr &= ~MACB_BIT(RX_USED);
 
 		if (frag == last_frag)
@@ -1036,37 +1368,39 @@ static int macb_rx_frame(struct macb *bp, unsigned int first_frag,
 	bp->dev->stats.rx_bytes += skb->len;
 	netdev_vdbg(bp->dev, "received skb of length %u, csum: %08x\n",
 		    skb->len, skb->csum);
-	netif_receive_skb(skb);
+	napi_gro_receive(&queue->napi, skb);
 
 	return 0;
 }
 
-static inline void macb_init_rx_ring(struct macb *bp)
+static inline void macb_init_rx_ring(struct macb_queue *queue)
 {
+	struct macb *bp = queue->bp;
 	dma_addr_t addr;
 	struct macb_dma_desc *desc = NULL;
 	int i;
 
 	addr = bp->rx_buffers_dma;
 	for (i = 0; i < bp->rx_ring_size; i++) {
-		desc = macb_rx_desc(bp, i);
+		desc = macb_rx_desc(queue, i);
 		macb_set_addr(bp, desc, addr);
 		desc->ctrl = 0;
 		addr += bp->rx_buffer_size;
 	}
 	desc->addr |= MACB_BIT(RX_WRAP);
-	bp->rx_tail = 0;
+	queue->rx_tail = 0;
 }
 
-static int macb_rx(struct macb *bp, int budget)
+static int macb_rx(struct macb_queue *queue, int budget)
 {
+	struct macb *bp = queue->bp;
 	bool reset_rx_queue = false;
 	int received = 0;
 	unsigned int tail;
 	int first_frag = -1;
 
-	for (tail = bp->rx_tail; budget > 0; tail++) {
-		struct macb_dma_desc *desc = macb_rx_desc(bp, tail);
+	for (tail = queue->rx_tail; budget > 0; tail++) {
+		struct macb_dma_desc *desc = macb_rx_desc(queue, tail);
 		u32 ctrl;
 
 		/* Make hw descriptor updates visible to CPU */
@@ -1079,7 +1413,7 @@ static int macb_rx(struct macb *bp, int budget)
 
 		if (ctrl & MACB_BIT(RX_SOF)) {
 			if (first_frag != -1)
-				discard_partial_frame(bp, first_frag, tail);
+				discard_partial_frame(queue, first_frag, tail);
 			first_frag = tail;
 		}
 
@@ -1091,7 +1425,7 @@ static int macb_rx(struct macb *bp, int budget)
 				continue;
 			}
 
-			dropped = macb_rx_frame(bp, first_frag, tail);
+			dropped = macb_rx_frame(queue, first_frag, tail);
 			first_frag = -1;
 			if (unlikely(dropped < 0)) {
 				reset_rx_queue = true;
@@ -1115,8 +1449,8 @@ static int macb_rx(struct macb *bp, int budget)
 		ctrl = macb_readl(bp, NCR);
 		macb_writel(bp, NCR, ctrl & ~MACB_BIT(RE));
 
-		macb_init_rx_ring(bp);
-		macb_writel(bp, RBQP, bp->rx_ring_dma);
+		macb_init_rx_ring(queue);
+		queue_writel(queue, RBQP, queue->rx_ring_dma);
 
 		macb_writel(bp, NCR, ctrl | MACB_BIT(RE));
 
@@ -1125,40 +1459,67 @@ static int macb_rx(struct macb *bp, int budget)
 	}
 
 	if (first_frag != -1)
-		bp->rx_tail = first_frag;
+		queue->rx_tail = first_frag;
 	else
-		bp->rx_tail = tail;
+		queue->rx_tail = tail;
 
 	return received;
 }
 
 static int macb_poll(struct napi_struct *napi, int budget)
 {
-	struct macb *bp = container_of(napi, struct macb, napi);
+	struct macb_queue *queue = container_of(napi, struct macb_queue, napi);
+	struct macb *bp = queue->bp;
 	int work_done;
 	u32 status;
 
+	/* TX reclaim does not count against the budget */
+	macb_tx_complete(queue);
+
 	status = macb_readl(bp, RSR);
 	macb_writel(bp, RSR, status);
 
 	work_done = 0;
 
-	netdev_vdbg(bp->dev, "poll: status = %08lx, budget = %d\n",
+	netdev_vdbg(bp->dev, "poll: queue = %u, status = %08lx, budget = %d\n",
+		    (unsigned int)(queue - bp->queues),
 		    (unsigned long)status, budget);
 
-	work_done = bp->macbgem_ops.mog_rx(bp, budget);
+	work_done = bp->macbgem_ops.mog_rx(queue, budget);
+
+	u64_stats_update_begin(&queue->stats.rx_syncp);
+	queue->stats.napi_polls++;
+	queue->stats.poll_hist[min(fls(work_done), MACB_POLL_HIST_LEN - 1)]++;
+	u64_stats_update_end(&queue->stats.rx_syncp);
+
 	if (work_done < budget) {
-		napi_complete_done(napi, work_done);
+		/* While a socket busy polls this queue, NAPI stays owned by
+		 * the busy poller and interrupts must stay masked. The last
+		 * poll when busy polling stops completes and re-enables them.
+		 * Until then, don't let GRO sit on frames the socket waits for.
+		 */
+		if (!napi_complete_done(napi, work_done)) {
+			if (test_bit(NAPI_STATE_IN_BUSY_POLL, &napi->state))
+				napi_gro_flush(napi, false);
+			return work_done;
+		}
 
-		/* Packets received while interrupts were disabled */
+		/* Packets received while interrupts were disabled. RSR is
+		 * shared by all queues, so this may poll once for nothing.
+		 */
 		status = macb_readl(bp, RSR);
 		if (status) {
 			if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
-				macb_writel(bp, ISR, MACB_BIT(RCOMP));
+				queue_writel(queue, ISR, MACB_BIT(RCOMP));
 			napi_reschedule(napi);
 		} else {
-			macb_writel(bp, IER, MACB_RX_INT_FLAGS);
+			queue_writel(queue, IER, MACB_RX_INT_FLAGS);
 		}
+
+		/* Frames sent while TCOMP was masked */
+		queue_writel(queue, IER, MACB_BIT(TCOMP));
+		if (macb_tx_complete_pending(queue))
+			napi_reschedule(napi);
 	}
 
 	/* TODO: Handle errors */
@@ -1166,18 +1527,30 @@ static int macb_poll(struct napi_struct *napi, int budget)
 	return work_done;
 }
 
+static enum hrtimer_restart macb_rx_coalesce_timer(struct hrtimer *timer)
+{
+	struct macb_queue *queue = container_of(timer, struct macb_queue,
+						rx_coalesce_timer);
+
+	napi_schedule(&queue->napi);
+
+	return HRTIMER_NORESTART;
+}
+
 static irqreturn_t macb_interrupt(int irq, void *dev_id)
 {
 	struct macb_queue *queue = dev_id;
 	struct macb *bp = queue->bp;
 	struct net_device *dev = bp->dev;
 	u32 status, ctrl;
+	u64 start;
 
 	status = queue_readl(queue, ISR);
 
 	if (unlikely(!status))
 		return IRQ_NONE;
 
+	start = ktime_get_ns();
 	spin_lock(&bp->lock);
 
 	while (status) {
@@ -1204,9 +1577,16 @@ static irqreturn_t macb_interrupt(int irq, void *dev_id)
 			if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
 				queue_writel(queue, ISR, MACB_BIT(RCOMP));
 
-			if (napi_schedule_prep(&bp->napi)) {
+			if (bp->rx_coalesce_usecs &&
+			    !(bp->caps & MACB_CAPS_INT_MODERATION)) {
+				/* Let more frames arrive before polling */
+				hrtimer_start(&queue->rx_coalesce_timer,
+					      ns_to_ktime(bp->rx_coalesce_usecs *
+							  NSEC_PER_USEC),
+					      HRTIMER_MODE_REL);
+			} else if (napi_schedule_prep(&queue->napi)) {
 				netdev_vdbg(bp->dev, "scheduling RX softirq\n");
-				__napi_schedule(&bp->napi);
+				__napi_schedule(&queue->napi);
 			}
 		}
 
@@ -1220,8 +1600,17 @@ static irqreturn_t macb_interrupt(int irq, void *dev_id)
 			break;
 		}
 
-		if (status & MACB_BIT(TCOMP))
-			macb_tx_interrupt(queue);
+		if (status & MACB_BIT(TCOMP)) {
+			/* Reclaim in macb_poll() like RX */
+			queue_writel(queue, IDR, MACB_BIT(TCOMP));
+			if (bp->caps & MACB_CAPS_ISR_CLEAR_ON_WRITE)
+				queue_writel(queue, ISR, MACB_BIT(TCOMP));
+
+			if (napi_schedule_prep(&queue->napi)) {
+				netdev_vdbg(bp->dev, "scheduling TX softirq\n");
+				__napi_schedule(&queue->napi);
+			}
+		}
 
 		/* Link change detection isn't possible with RMII, so we'll
 		 * add that if/when we get our hands on a full-blown MII PHY.
@@ -1268,6 +1657,10 @@ static irqreturn_t macb_interrupt(int irq, void *dev_id)
 		status = queue_readl(queue, ISR);
 	}
 
+	u64_stats_update_begin(&queue->stats.syncp);
+	queue->stats.irqs++;
+	queue->stats.irq_time_ns += ktime_get_ns() - start;
+	u64_stats_update_end(&queue->stats.syncp);
 	spin_unlock(&bp->lock);
 
 	return IRQ_HANDLED;
@@ -1504,14 +1897,19 @@ static inline int macb_clear_csum(struct sk_buff *skb)
 	if (skb->ip_summed != CHECKSUM_PARTIAL)
 		return 0;
 
+	/* Only UDP packets with UDP data len <=2 need the checksum field
+	 * initialized - at least Zynq otherwise calculates wrong UDP header
+	 * checksums for them. Leave the others alone, so that the headers
+	 * of cloned TCP skbs need not be copied.
+	 */
+	if (skb->csum_offset != offsetof(struct udphdr, check) ||
+	    skb->len - skb_transport_offset(skb) > sizeof(struct udphdr) + 2)
+		return 0;
+
 	/* make sure we can modify the header */
 	if (unlikely(skb_cow_head(skb, 0)))
 		return -1;
 
-	/* initialize checksum field
-	 * This is required - at least for Zynq, which otherwise calculates
-	 * wrong UDP header checksums for UDP packets with UDP data len <=2
-	 */
 	*(__sum16 *)(skb_checksum_start(skb) + skb->csum_offset) = 0;
 	return 0;
 }
@@ -1521,6 +1919,7 @@ static int macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	u16 queue_index = skb_get_queue_mapping(skb);
 	struct macb *bp = netdev_priv(dev);
 	struct macb_queue *queue = &bp->queues[queue_index];
+	struct netdev_queue *txq;
 	unsigned long flags;
 	unsigned int desc_cnt, nr_frags, frag_size, f;
 	unsigned int hdrlen;
@@ -1575,6 +1974,11 @@ static int macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	if (CIRC_SPACE(queue->tx_head, queue->tx_tail,
 		       bp->tx_ring_size) < desc_cnt) {
 		netif_stop_subqueue(dev, queue_index);
+		u64_stats_update_begin(&queue->stats.syncp);
+		queue->stats.tx_ring_full++;
+		u64_stats_update_end(&queue->stats.syncp);
+		/* flush what a batch left pending */
+		macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
 		spin_unlock_irqrestore(&bp->lock, flags);
 		netdev_dbg(bp->dev, "tx_head = %u, tx_tail = %u\n",
 			   queue->tx_head, queue->tx_tail);
@@ -1583,24 +1987,39 @@ static int macb_start_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	if (macb_clear_csum(skb)) {
 		dev_kfree_skb_any(skb);
-		goto unlock;
+		goto kick;
 	}
 
+	gem_ptp_tx_prep(bp, skb);
+
 	/* Map socket buffer for DMA transfer */
 	if (!macb_tx_map(bp, queue, skb, hdrlen)) {
 		dev_kfree_skb_any(skb);
-		goto unlock;
+		goto kick;
 	}
 
 	/* Make newly initialized descriptor visible to hardware */
 	wmb();
 
+	txq = netdev_get_tx_queue(dev, queue_index);
+	netdev_tx_sent_queue(txq, skb->len);
 	skb_tx_timestamp(skb);
 
-	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
-
-	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1)
+	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1) {
 		netif_stop_subqueue(dev, queue_index);
+		u64_stats_update_begin(&queue->stats.syncp);
+		queue->stats.tx_ring_full++;
+		u64_stats_update_end(&queue->stats.syncp);
+	}
+
+	/* Software GSO hands over the segments of a TCP super-packet in
+	 * one go: start transmission only once for the whole batch.
+	 */
+	if (skb->xmit_more && !netif_xmit_stopped(txq))
+		goto unlock;
+
+kick:
+	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
 
 unlock:
 	spin_unlock_irqrestore(&bp->lock, flags);
@@ -1610,6 +2029,8 @@ unlock:
 
 static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 {
+	size_t max;
+
 	if (!macb_is_gem(bp)) {
 		bp->rx_buffer_size = MACB_RX_BUFFER_SIZE;
 	} else {
@@ -1622,6 +2043,16 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 			bp->rx_buffer_size =
 				roundup(bp->rx_buffer_size, RX_BUFFER_MULTIPLE);
 		}
+
+		/* Jumbo frames are spread over several buffers rather than
+		 * needing high order pages, unless XDP wants them whole.
+		 * A page still holds two buffers with their build_skb() room.
+		 */
+		max = PAGE_SIZE / 2 - NET_SKB_PAD -
+		      SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+		max = rounddown(max, RX_BUFFER_MULTIPLE);
+		if (!bp->xdp_prog && bp->rx_buffer_size > max)
+			bp->rx_buffer_size = max;
 	}
 
 	netdev_dbg(bp->dev, "mtu [%u] rx_buffer_size [%zu]\n",
@@ -1630,31 +2061,37 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 
 static void gem_free_rx_buffers(struct macb *bp)
 {
-	struct sk_buff		*skb;
-	struct macb_dma_desc	*desc;
-	dma_addr_t		addr;
+	struct macb_queue	*queue;
+	struct macb_rx_page	*rx;
+	unsigned int q;
 	int i;
 
-	if (!bp->rx_skbuff)
-		return;
-
-	for (i = 0; i < bp->rx_ring_size; i++) {
-		skb = bp->rx_skbuff[i];
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		if (queue->rx_skb) {
+			dev_kfree_skb_any(queue->rx_skb);
+			queue->rx_skb = NULL;
+		}
 
-		if (!skb)
+		if (!queue->rx_page)
 			continue;
 
-		desc = macb_rx_desc(bp, i);
-		addr = macb_get_addr(bp, desc);
+		for (i = 0; i < bp->rx_ring_size; i++) {
+			rx = &queue->rx_page[i];
 
-		dma_unmap_single(&bp->pdev->dev, addr, bp->rx_buffer_size,
-				 DMA_FROM_DEVICE);
-		dev_kfree_skb_any(skb);
-		skb = NULL;
-	}
+			if (!rx->page)
+				continue;
 
-	kfree(bp->rx_skbuff);
-	bp->rx_skbuff = NULL;
+			dma_unmap_page_attrs(&bp->pdev->dev, rx->dma,
+					     gem_rx_page_size(bp),
+					     DMA_FROM_DEVICE,
+					     DMA_ATTR_SKIP_CPU_SYNC);
+			put_page(rx->page);
+			rx->page = NULL;
+		}
+
+		kfree(queue->rx_page);
+		queue->rx_page = NULL;
+	}
 }
 
 static void macb_free_rx_buffers(struct macb *bp)
@@ -1673,13 +2110,13 @@ static void macb_free_consistent(struct macb *bp)
 	unsigned int q;
 
 	bp->macbgem_ops.mog_free_rx_buffers(bp);
-	if (bp->rx_ring) {
-		dma_free_coherent(&bp->pdev->dev, RX_RING_BYTES(bp),
-				  bp->rx_ring, bp->rx_ring_dma);
-		bp->rx_ring = NULL;
-	}
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		if (queue->rx_ring) {
+			dma_free_coherent(&bp->pdev->dev, RX_RING_BYTES(bp),
+					  queue->rx_ring, queue->rx_ring_dma);
+			queue->rx_ring = NULL;
+		}
 		kfree(queue->tx_skb);
 		queue->tx_skb = NULL;
 		if (queue->tx_ring) {
@@ -1692,16 +2129,30 @@ static void macb_free_consistent(struct macb *bp)
 
 static int gem_alloc_rx_buffers(struct macb *bp)
 {
-	int size;
+	struct macb_queue *queue;
+	unsigned int frag_size;
+	unsigned int q;
 
-	size = bp->rx_ring_size * sizeof(struct sk_buff *);
-	bp->rx_skbuff = kzalloc(size, GFP_KERNEL);
-	if (!bp->rx_skbuff)
-		return -ENOMEM;
-	else
-		netdev_dbg(bp->dev,
-			   "Allocated %d RX struct sk_buff entries at %p\n",
-			   bp->rx_ring_size, bp->rx_skbuff);
+	/* XDP programs may grow the frame at its head */
+	bp->rx_headroom = bp->xdp_prog ? XDP_PACKET_HEADROOM : NET_SKB_PAD;
+
+	/* Each page holds two frames, each with room for build_skb() */
+	frag_size = SKB_DATA_ALIGN(bp->rx_headroom + bp->rx_buffer_size) +
+		    SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	bp->rx_page_order = get_order(2 * frag_size);
+	bp->rx_frag_size = gem_rx_page_size(bp) / 2;
+
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		queue->rx_page = kcalloc(bp->rx_ring_size,
+					 sizeof(*queue->rx_page), GFP_KERNEL);
+		if (!queue->rx_page)
+			return -ENOMEM;
+		else
+			netdev_dbg(bp->dev,
+				   "Allocated %d RX page entries of order %u for queue %u at %p\n",
+				   bp->rx_ring_size, bp->rx_page_order, q,
+				   queue->rx_page);
+	}
 	return 0;
 }
 
@@ -1740,19 +2191,21 @@ static int macb_alloc_consistent(struct macb *bp)
 			   queue->tx_ring);
 
 		size = bp->tx_ring_size * sizeof(struct macb_tx_skb);
-		queue->tx_skb = kmalloc(size, GFP_KERNEL);
+		queue->tx_skb = kzalloc(size, GFP_KERNEL);
 		if (!queue->tx_skb)
 			goto out_err;
-	}
 
-	size = RX_RING_BYTES(bp);
-	bp->rx_ring = dma_alloc_coherent(&bp->pdev->dev, size,
-					 &bp->rx_ring_dma, GFP_KERNEL);
-	if (!bp->rx_ring)
-		goto out_err;
-	netdev_dbg(bp->dev,
-		   "Allocated RX ring of %d bytes at %08lx (mapped %p)\n",
-		   size, (unsigned long)bp->rx_ring_dma, bp->rx_ring);
+		size = RX_RING_BYTES(bp);
+		queue->rx_ring = dma_alloc_coherent(&bp->pdev->dev, size,
+						    &queue->rx_ring_dma,
+						    GFP_KERNEL);
+		if (!queue->rx_ring)
+			goto out_err;
+		netdev_dbg(bp->dev,
+			   "Allocated RX ring for queue %u of %d bytes at %08lx (mapped %p)\n",
+			   q, size, (unsigned long)queue->rx_ring_dma,
+			   queue->rx_ring);
+	}
 
 	if (bp->macbgem_ops.mog_alloc_rx_buffers(bp))
 		goto out_err;
@@ -1780,12 +2233,13 @@ static void gem_init_rings(struct macb *bp)
 		desc->ctrl |= MACB_BIT(TX_WRAP);
 		queue->tx_head = 0;
 		queue->tx_tail = 0;
-	}
+		netdev_tx_reset_queue(netdev_get_tx_queue(bp->dev, q));
 
-	bp->rx_tail = 0;
-	bp->rx_prepared_head = 0;
+		queue->rx_tail = 0;
+		queue->rx_prepared_head = 0;
 
-	gem_rx_refill(bp);
+		gem_rx_refill(queue);
+	}
 }
 
 static void macb_init_rings(struct macb *bp)
@@ -1793,7 +2247,7 @@ static void macb_init_rings(struct macb *bp)
 	int i;
 	struct macb_dma_desc *desc = NULL;
 
-	macb_init_rx_ring(bp);
+	macb_init_rx_ring(&bp->queues[0]);
 
 	for (i = 0; i < bp->tx_ring_size; i++) {
 		desc = macb_tx_desc(&bp->queues[0], i);
@@ -1802,6 +2256,7 @@ static void macb_init_rings(struct macb *bp)
 	}
 	bp->queues[0].tx_head = 0;
 	bp->queues[0].tx_tail = 0;
+	netdev_tx_reset_queue(netdev_get_tx_queue(bp->dev, 0));
 	desc->ctrl |= MACB_BIT(TX_WRAP);
 }
 
@@ -1932,6 +2387,61 @@ static void macb_configure_dma(struct macb *bp)
 	}
 }
 
+static void gem_set_coalesce(struct macb *bp)
+{
+	gem_writel(bp, INTMOD,
+		   GEM_BF(RX_INTMOD, DIV_ROUND_UP(bp->rx_coalesce_usecs * 5, 4)) |
+		   GEM_BF(TX_INTMOD, DIV_ROUND_UP(bp->tx_coalesce_usecs * 5, 4)));
+}
+
+/* RX flow steering. Rules matching only a UDP destination port and/or the
+ * DS field use type 1 screeners, the others type 2 screeners, which can
+ * check an EtherType, the VLAN priority and up to three compare registers.
+ * Frames no screener matches go to queue 0.
+ */
+static unsigned int macb_hw_queue(struct macb *bp, unsigned int q)
+{
+	unsigned int hw_q;
+
+	for (hw_q = 0; hw_q < MACB_MAX_QUEUES; ++hw_q)
+		if ((bp->queue_mask & (1 << hw_q)) && !q--)
+			break;
+
+	return hw_q;
+}
+
+static void gem_write_rx_fs(struct macb *bp, struct gem_rx_fs *item,
+			    bool enable)
+{
+	unsigned int i;
+
+	if (!item->type2) {
+		gem_writel_n(bp, SCRT1, item->scr, enable ? item->scr_val : 0);
+		return;
+	}
+
+	if (enable) {
+		if (item->etht >= 0)
+			gem_writel_n(bp, ETHT, item->etht,
+				     GEM_BF(ETHTCMP, bp->etht_val[item->etht]));
+		for (i = 0; i < item->ncmp; i++) {
+			gem_writel_n(bp, T2CMPW0, item->cmp[i], item->cmp_w0[i]);
+			gem_writel_n(bp, T2CMPW1, item->cmp[i], item->cmp_w1[i]);
+		}
+	}
+
+	gem_writel_n(bp, SCRT2, item->scr, enable ? item->scr_val : 0);
+}
+
+static void gem_enable_rx_fs(struct macb *bp, bool enable)
+{
+	unsigned int i;
+
+	for (i = 0; i < bp->rx_fs_count; i++)
+		if (bp->rx_fs[i].used)
+			gem_write_rx_fs(bp, &bp->rx_fs[i], enable);
+}
+
 static void macb_init_hw(struct macb *bp)
 {
 	struct macb_queue *queue;
@@ -1962,6 +2472,8 @@ static void macb_init_hw(struct macb *bp)
 	macb_writel(bp, NCFGR, config);
 	if ((bp->caps & MACB_CAPS_JUMBO) && bp->jumbo_max_len)
 		gem_writel(bp, JML, bp->jumbo_max_len);
+	if (bp->caps & MACB_CAPS_INT_MODERATION)
+		gem_set_coalesce(bp);
 	bp->speed = SPEED_10;
 	bp->duplex = DUPLEX_HALF;
 	bp->rx_frm_len_mask = MACB_RX_FRMLEN_MASK;
@@ -1970,13 +2482,17 @@ static void macb_init_hw(struct macb *bp)
 
 	macb_configure_dma(bp);
 
-	/* Initialize TX and RX buffers */
-	macb_writel(bp, RBQP, lower_32_bits(bp->rx_ring_dma));
+	/* Initialize TX and RX buffers, the upper address bits are shared */
 #ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
 	if (bp->hw_dma_cap == HW_DMA_CAP_64B)
-		macb_writel(bp, RBQPH, upper_32_bits(bp->rx_ring_dma));
+		macb_writel(bp, RBQPH, upper_32_bits(bp->queues[0].rx_ring_dma));
 #endif
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		queue_writel(queue, RBQP, lower_32_bits(queue->rx_ring_dma));
+		/* queue0 takes its buffer size from DMACFG */
+		if (q)
+			queue_writel(queue, RBQS,
+				     bp->rx_buffer_size / RX_BUFFER_MULTIPLE);
 		queue_writel(queue, TBQP, lower_32_bits(queue->tx_ring_dma));
 #ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
 		if (bp->hw_dma_cap == HW_DMA_CAP_64B)
@@ -1990,6 +2506,9 @@ static void macb_init_hw(struct macb *bp)
 			     MACB_BIT(HRESP));
 	}
 
+	if (bp->rx_fs)
+		gem_enable_rx_fs(bp, bp->dev->features & NETIF_F_NTUPLE);
+
 	/* Enable TX and RX */
 	macb_writel(bp, NCR, MACB_BIT(RE) | MACB_BIT(TE) | MACB_BIT(MPE));
 }
@@ -2117,6 +2636,8 @@ static int macb_open(struct net_device *dev)
 {
 	struct macb *bp = netdev_priv(dev);
 	size_t bufsz = dev->mtu + ETH_HLEN + ETH_FCS_LEN + NET_IP_ALIGN;
+	struct macb_queue *queue;
+	unsigned int q;
 	int err;
 
 	netdev_dbg(bp->dev, "open\n");
@@ -2138,7 +2659,14 @@ static int macb_open(struct net_device *dev)
 		return err;
 	}
 
-	napi_enable(&bp->napi);
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		napi_enable(&queue->napi);
+		/* spread the queues, and their NAPI polls, over the CPUs */
+		if (bp->num_queues > 1)
+			irq_set_affinity_hint(queue->irq,
+					      cpumask_of(cpumask_local_spread(q,
+							 NUMA_NO_NODE)));
+	}
 
 	bp->macbgem_ops.mog_init_rings(bp);
 	macb_init_hw(bp);
@@ -2157,10 +2685,17 @@ static int macb_open(struct net_device *dev)
 static int macb_close(struct net_device *dev)
 {
 	struct macb *bp = netdev_priv(dev);
+	struct macb_queue *queue;
 	unsigned long flags;
+	unsigned int q;
 
 	netif_tx_stop_all_queues(dev);
-	napi_disable(&bp->napi);
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		napi_disable(&queue->napi);
+		hrtimer_cancel(&queue->rx_coalesce_timer);
+		if (bp->num_queues > 1)
+			irq_set_affinity_hint(queue->irq, NULL);
+	}
 
 	if (dev->phydev)
 		phy_stop(dev->phydev);
@@ -2250,18 +2785,39 @@ static struct net_device_stats *gem_get_stats(struct macb *bp)
 static void gem_get_ethtool_stats(struct net_device *dev,
 				  struct ethtool_stats *stats, u64 *data)
 {
+	struct queue_stats stats;
+	struct macb_queue *queue;
+	unsigned int i, q, start, rx_start;
 	struct macb *bp;
 
 	bp = netdev_priv(dev);
 	gem_update_stats(bp);
 	memcpy(data, &bp->ethtool_stats, sizeof(u64) * GEM_STATS_LEN);
+	data += GEM_STATS_LEN;
+
+	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
+		do {
+			rx_start = u64_stats_fetch_begin_irq(
+					&queue->stats.rx_syncp);
+			start = u64_stats_fetch_begin_irq(&queue->stats.syncp);
+			stats = queue->stats;
+		} while (u64_stats_fetch_retry_irq(&queue->stats.rx_syncp,
+						   rx_start) ||
+			 u64_stats_fetch_retry_irq(&queue->stats.syncp, start));
+
+		for (i = 0; i < QUEUE_STATS_LEN; i++)
+			*data++ = *(u64 *)((u8 *)&stats +
+					   queue_statistics[i].offset);
+	}
 }
 
 static int gem_get_sset_count(struct net_device *dev, int sset)
 {
+	struct macb *bp = netdev_priv(dev);
+
 	switch (sset) {
 	case ETH_SS_STATS:
-		return GEM_STATS_LEN;
+		return GEM_STATS_LEN + bp->num_queues * QUEUE_STATS_LEN;
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -2269,13 +2825,20 @@ static int gem_get_sset_count(struct net_device *dev, int sset)
 
 static void gem_get_ethtool_strings(struct net_device *dev, u32 sset, u8 *p)
 {
-	unsigned int i;
+	struct macb *bp = netdev_priv(dev);
+	unsigned int i, q;
 
 	switch (sset) {
 	case ETH_SS_STATS:
 		for (i = 0; i < GEM_STATS_LEN; i++, p += ETH_GSTRING_LEN)
 			memcpy(p, gem_statistics[i].stat_string,
 			       ETH_GSTRING_LEN);
+
+		for (q = 0; q < bp->num_queues; ++q)
+			for (i = 0; i < QUEUE_STATS_LEN; i++,
+			     p += ETH_GSTRING_LEN)
+				snprintf(p, ETH_GSTRING_LEN, "q%u_%s", q,
+					 queue_statistics[i].stat_string);
 		break;
 	}
 }
@@ -2459,6 +3022,409 @@ static int macb_get_ts_info(struct net_device *netdev,
 	return ethtool_op_get_ts_info(netdev, info);
 }
 
+static int macb_get_coalesce(struct net_device *netdev,
+			     struct ethtool_coalesce *ec)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	ec->rx_coalesce_usecs = bp->rx_coalesce_usecs;
+	ec->tx_coalesce_usecs = bp->tx_coalesce_usecs;
+
+	return 0;
+}
+
+static int macb_set_coalesce(struct net_device *netdev,
+			     struct ethtool_coalesce *ec)
+{
+	struct macb *bp = netdev_priv(netdev);
+	bool hw = bp->caps & MACB_CAPS_INT_MODERATION;
+	struct ethtool_coalesce supported = {
+		.cmd = ec->cmd,
+		.rx_coalesce_usecs = ec->rx_coalesce_usecs,
+		.tx_coalesce_usecs = ec->tx_coalesce_usecs,
+	};
+
+	/* Neither mode can count frames, only time */
+	if (memcmp(ec, &supported, sizeof(supported)))
+		return -EOPNOTSUPP;
+
+	if (hw) {
+		if (ec->rx_coalesce_usecs > GEM_MAX_COALESCE_USECS ||
+		    ec->tx_coalesce_usecs > GEM_MAX_COALESCE_USECS)
+			return -EINVAL;
+	} else {
+		if (ec->rx_coalesce_usecs > MACB_MAX_SW_COALESCE_USECS ||
+		    ec->tx_coalesce_usecs)
+			return -EINVAL;
+	}
+
+	bp->rx_coalesce_usecs = ec->rx_coalesce_usecs;
+	bp->tx_coalesce_usecs = ec->tx_coalesce_usecs;
+
+	if (hw && netif_running(netdev))
+		gem_set_coalesce(bp);
+
+	return 0;
+}
+
+static int gem_get_tunable(struct net_device *netdev,
+			   const struct ethtool_tunable *tuna, void *data)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	switch (tuna->id) {
+	case ETHTOOL_RX_COPYBREAK:
+		*(u32 *)data = bp->rx_copybreak;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int gem_set_tunable(struct net_device *netdev,
+			   const struct ethtool_tunable *tuna,
+			   const void *data)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	switch (tuna->id) {
+	case ETHTOOL_RX_COPYBREAK:
+		bp->rx_copybreak = *(u32 *)data;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int gem_rx_fs_free_idx(u32 used, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		if (!(used & (1 << i)))
+			return i;
+
+	return -ENOSPC;
+}
+
+static int gem_rx_fs_add_cmp(struct gem_rx_fs *item, u32 from, u32 offset,
+			     u32 w0, bool dismsk)
+{
+	if (item->ncmp == GEM_T2_MAX_CMP)
+		return -EINVAL;
+
+	item->cmp_w0[item->ncmp] = w0;
+	item->cmp_w1[item->ncmp] = GEM_BF(T2CMPOFST, from) |
+				   GEM_BF(T2OFST, offset) |
+				   (dismsk ? GEM_BIT(T2DISMSK) : 0);
+	item->ncmp++;
+
+	return 0;
+}
+
+#define GEM_RX_FS_CMP16(value, mask) \
+	(GEM_BF(T2CMP, value) | GEM_BF(T2MASK, mask))
+
+/* Match an IPv4 TCP or UDP flow with compare registers */
+static int gem_rx_fs_build_cmp(struct gem_rx_fs *item, u8 proto)
+{
+	const struct ethtool_tcpip4_spec *v = &item->fs.h_u.tcp_ip4_spec;
+	const struct ethtool_tcpip4_spec *m = &item->fs.m_u.tcp_ip4_spec;
+	int err;
+
+	if (m->tos ||
+	    (m->ip4src && m->ip4src != htonl(0xffffffff)) ||
+	    (m->ip4dst && m->ip4dst != htonl(0xffffffff)) ||
+	    (m->psrc && m->psrc != htons(0xffff)) ||
+	    (m->pdst && m->pdst != htons(0xffff)))
+		return -EINVAL;
+
+	/* protocol, after the TTL */
+	err = gem_rx_fs_add_cmp(item, GEM_T2COMPOFST_ETYPE, 8,
+				GEM_RX_FS_CMP16(proto, 0x00ff), false);
+	if (!err && m->ip4src)
+		err = gem_rx_fs_add_cmp(item, GEM_T2COMPOFST_ETYPE, 12,
+					ntohl(v->ip4src), true);
+	if (!err && m->ip4dst)
+		err = gem_rx_fs_add_cmp(item, GEM_T2COMPOFST_ETYPE, 16,
+					ntohl(v->ip4dst), true);
+	if (!err && m->psrc && m->pdst)
+		err = gem_rx_fs_add_cmp(item, GEM_T2COMPOFST_IPHDR, 0,
+					ntohs(v->psrc) << 16 | ntohs(v->pdst),
+					true);
+	else if (!err && m->psrc)
+		err = gem_rx_fs_add_cmp(item, GEM_T2COMPOFST_IPHDR, 0,
+					GEM_RX_FS_CMP16(ntohs(v->psrc), 0xffff),
+					false);
+	else if (!err && m->pdst)
+		err = gem_rx_fs_add_cmp(item, GEM_T2COMPOFST_IPHDR, 2,
+					GEM_RX_FS_CMP16(ntohs(v->pdst), 0xffff),
+					false);
+
+	return err;
+}
+
+/* Turn an ethtool rule into screener settings, *etht is 0 if not needed */
+static int gem_rx_fs_build(struct macb *bp, struct gem_rx_fs *item,
+			   u16 *etht)
+{
+	const struct ethtool_rx_flow_spec *fs = &item->fs;
+	const struct ethtool_tcpip4_spec *v = &fs->h_u.udp_ip4_spec;
+	const struct ethtool_tcpip4_spec *m = &fs->m_u.udp_ip4_spec;
+	const struct ethtool_usrip4_spec *uv = &fs->h_u.usr_ip4_spec;
+	const struct ethtool_usrip4_spec *um = &fs->m_u.usr_ip4_spec;
+	const struct ethhdr *em = &fs->m_u.ether_spec;
+	u32 val;
+	int err;
+
+	*etht = 0;
+	val = GEM_BF(SCRQUEUE, macb_hw_queue(bp, fs->ring_cookie));
+
+	if (fs->flow_type & FLOW_EXT) {
+		if (fs->m_ext.vlan_etype || fs->m_ext.data[0] ||
+		    fs->m_ext.data[1] ||
+		    fs->m_ext.vlan_tci != htons(VLAN_PRIO_MASK))
+			return -EINVAL;
+		val |= GEM_BIT(VLANEN) |
+		       GEM_BF(VLANPR, (ntohs(fs->h_ext.vlan_tci) &
+				       VLAN_PRIO_MASK) >> VLAN_PRIO_SHIFT);
+		item->type2 = true;
+	}
+
+	switch (fs->flow_type & ~FLOW_EXT) {
+	case ETHER_FLOW:
+		if (!is_zero_ether_addr(em->h_dest) ||
+		    !is_zero_ether_addr(em->h_source))
+			return -EINVAL;
+		if (em->h_proto == htons(0xffff))
+			*etht = ntohs(fs->h_u.ether_spec.h_proto);
+		else if (em->h_proto || !item->type2)
+			return -EINVAL;
+		item->type2 = true;
+		break;
+	case IPV4_USER_FLOW:
+		if (item->type2 || uv->ip_ver != ETH_RX_NFC_IP4 ||
+		    um->ip4src || um->ip4dst || um->l4_4_bytes || um->proto ||
+		    um->tos != 0xff)
+			return -EINVAL;
+		val |= GEM_BIT(DSTCEN) | GEM_BF(DSTCM, uv->tos);
+		break;
+	case UDP_V4_FLOW:
+		if (!item->type2 && !m->ip4src && !m->ip4dst && !m->psrc &&
+		    m->pdst == htons(0xffff) && (!m->tos || m->tos == 0xff)) {
+			val |= GEM_BIT(UDPEN) | GEM_BF(UDPM, ntohs(v->pdst));
+			if (m->tos)
+				val |= GEM_BIT(DSTCEN) | GEM_BF(DSTCM, v->tos);
+			break;
+		}
+		/* fall through */
+	case TCP_V4_FLOW:
+		err = gem_rx_fs_build_cmp(item, (fs->flow_type & ~FLOW_EXT) ==
+					  TCP_V4_FLOW ? IPPROTO_TCP :
+					  IPPROTO_UDP);
+		if (err)
+			return err;
+		*etht = ETH_P_IP;
+		item->type2 = true;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	item->scr_val = val;
+
+	return 0;
+}
+
+/* EtherType registers are shared by the rules matching the same type */
+static int gem_rx_fs_get_etht(struct macb *bp, u16 etht)
+{
+	unsigned int i;
+
+	for (i = 0; i < bp->num_etht; i++) {
+		if (bp->etht_refs[i] && bp->etht_val[i] == etht) {
+			bp->etht_refs[i]++;
+			return i;
+		}
+	}
+
+	for (i = 0; i < bp->num_etht; i++) {
+		if (!bp->etht_refs[i]) {
+			bp->etht_val[i] = etht;
+			bp->etht_refs[i] = 1;
+			return i;
+		}
+	}
+
+	return -ENOSPC;
+}
+
+static int gem_rx_fs_alloc(struct macb *bp, struct gem_rx_fs *item, u16 etht)
+{
+	static const u32 cmp_bf[GEM_T2_MAX_CMP] = {
+		GEM_BIT(CMPAEN), GEM_BIT(CMPBEN), GEM_BIT(CMPCEN),
+	};
+	static const u8 cmp_offset[GEM_T2_MAX_CMP] = {
+		GEM_CMPA_OFFSET, GEM_CMPB_OFFSET, GEM_CMPC_OFFSET,
+	};
+	u32 cmp_used = bp->t2cmp_used;
+	unsigned int i;
+	int idx;
+
+	item->etht = -1;
+
+	if (!item->type2) {
+		idx = gem_rx_fs_free_idx(bp->t1_scr_used, bp->num_t1_scr);
+		if (idx < 0)
+			return idx;
+		bp->t1_scr_used |= 1 << idx;
+		item->scr = idx;
+		return 0;
+	}
+
+	idx = gem_rx_fs_free_idx(bp->t2_scr_used, bp->num_t2_scr);
+	if (idx < 0)
+		return idx;
+	item->scr = idx;
+
+	for (i = 0; i < item->ncmp; i++) {
+		idx = gem_rx_fs_free_idx(cmp_used, bp->num_t2cmp);
+		if (idx < 0)
+			return idx;
+		cmp_used |= 1 << idx;
+		item->cmp[i] = idx;
+		item->scr_val |= cmp_bf[i] | (idx << cmp_offset[i]);
+	}
+
+	if (etht) {
+		idx = gem_rx_fs_get_etht(bp, etht);
+		if (idx < 0)
+			return idx;
+		item->etht = idx;
+		item->scr_val |= GEM_BIT(ETHTEN) | GEM_BF(ETHT2IDX, idx);
+	}
+
+	bp->t2_scr_used |= 1 << item->scr;
+	bp->t2cmp_used = cmp_used;
+
+	return 0;
+}
+
+static void gem_rx_fs_free(struct macb *bp, struct gem_rx_fs *item)
+{
+	unsigned int i;
+
+	gem_write_rx_fs(bp, item, false);
+
+	if (item->type2) {
+		bp->t2_scr_used &= ~(1 << item->scr);
+		for (i = 0; i < item->ncmp; i++)
+			bp->t2cmp_used &= ~(1 << item->cmp[i]);
+		if (item->etht >= 0)
+			bp->etht_refs[item->etht]--;
+	} else {
+		bp->t1_scr_used &= ~(1 << item->scr);
+	}
+
+	memset(item, 0, sizeof(*item));
+}
+
+static int gem_add_rx_fs(struct macb *bp, struct ethtool_rx_flow_spec *fs)
+{
+	struct gem_rx_fs new = { .fs = *fs };
+	struct gem_rx_fs *item;
+	u16 etht;
+	int err;
+
+	if (fs->location >= bp->rx_fs_count ||
+	    fs->ring_cookie == RX_CLS_FLOW_DISC ||
+	    fs->ring_cookie >= bp->num_queues)
+		return -EINVAL;
+
+	err = gem_rx_fs_build(bp, &new, &etht);
+	if (err)
+		return err;
+
+	/* a rule at the same location is replaced, but only once the new one
+	 * got its screeners, so that a failure leaves the old one in place
+	 */
+	err = gem_rx_fs_alloc(bp, &new, etht);
+	if (err)
+		return err;
+
+	item = &bp->rx_fs[fs->location];
+	if (item->used)
+		gem_rx_fs_free(bp, item);
+
+	new.used = true;
+	*item = new;
+	gem_write_rx_fs(bp, item, bp->dev->features & NETIF_F_NTUPLE);
+
+	return 0;
+}
+
+static int gem_get_rxnfc(struct net_device *netdev, struct ethtool_rxnfc *cmd,
+			 u32 *rule_locs)
+{
+	struct macb *bp = netdev_priv(netdev);
+	unsigned int i, n = 0;
+
+	switch (cmd->cmd) {
+	case ETHTOOL_GRXRINGS:
+		cmd->data = bp->num_queues;
+		return 0;
+	case ETHTOOL_GRXCLSRLCNT:
+		if (!bp->rx_fs)
+			return -EOPNOTSUPP;
+		for (i = 0; i < bp->rx_fs_count; i++)
+			if (bp->rx_fs[i].used)
+				n++;
+		cmd->rule_cnt = n;
+		cmd->data = bp->rx_fs_count;
+		return 0;
+	case ETHTOOL_GRXCLSRULE:
+		if (cmd->fs.location >= bp->rx_fs_count ||
+		    !bp->rx_fs[cmd->fs.location].used)
+			return -EINVAL;
+		cmd->fs = bp->rx_fs[cmd->fs.location].fs;
+		return 0;
+	case ETHTOOL_GRXCLSRLALL:
+		for (i = 0; i < bp->rx_fs_count; i++) {
+			if (!bp->rx_fs[i].used)
+				continue;
+			if (n == cmd->rule_cnt)
+				return -EMSGSIZE;
+			rule_locs[n++] = i;
+		}
+		cmd->rule_cnt = n;
+		cmd->data = bp->rx_fs_count;
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static int gem_set_rxnfc(struct net_device *netdev, struct ethtool_rxnfc *cmd)
+{
+	struct macb *bp = netdev_priv(netdev);
+
+	if (!bp->rx_fs)
+		return -EOPNOTSUPP;
+
+	switch (cmd->cmd) {
+	case ETHTOOL_SRXCLSRLINS:
+		return gem_add_rx_fs(bp, &cmd->fs);
+	case ETHTOOL_SRXCLSRLDEL:
+		if (cmd->fs.location >= bp->rx_fs_count ||
+		    !bp->rx_fs[cmd->fs.location].used)
+			return -EINVAL;
+		gem_rx_fs_free(bp, &bp->rx_fs[cmd->fs.location]);
+		return 0;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 static const struct ethtool_ops macb_ethtool_ops = {
 	.get_regs_len		= macb_get_regs_len,
 	.get_regs		= macb_get_regs,
@@ -2470,6 +3436,8 @@ static const struct ethtool_ops macb_ethtool_ops = {
 	.set_link_ksettings     = phy_ethtool_set_link_ksettings,
 	.get_ringparam		= macb_get_ringparam,
 	.set_ringparam		= macb_set_ringparam,
+	.get_coalesce		= macb_get_coalesce,
+	.set_coalesce		= macb_set_coalesce,
 };
 
 static const struct ethtool_ops gem_ethtool_ops = {
@@ -2484,6 +3452,12 @@ static const struct ethtool_ops gem_ethtool_ops = {
 	.set_link_ksettings     = phy_ethtool_set_link_ksettings,
 	.get_ringparam		= macb_get_ringparam,
 	.set_ringparam		= macb_set_ringparam,
+	.get_coalesce		= macb_get_coalesce,
+	.set_coalesce		= macb_set_coalesce,
+	.get_tunable		= gem_get_tunable,
+	.set_tunable		= gem_set_tunable,
+	.get_rxnfc		= gem_get_rxnfc,
+	.set_rxnfc		= gem_set_rxnfc,
 };
 
 static int macb_ioctl(struct net_device *dev, struct ifreq *rq, int cmd)
@@ -2541,9 +3515,51 @@ static int macb_set_features(struct net_device *netdev,
 		gem_writel(bp, NCFGR, netcfg);
 	}
 
+	/* RX flow steering */
+	if ((changed & NETIF_F_NTUPLE) && bp->rx_fs)
+		gem_enable_rx_fs(bp, features & NETIF_F_NTUPLE);
+
 	return 0;
 }
 
+static int gem_xdp_setup(struct net_device *dev, struct bpf_prog *prog)
+{
+	struct macb *bp = netdev_priv(dev);
+	/* the RX headroom changes, so the buffers have to be rebuilt */
+	bool reset = netif_running(dev) && !bp->xdp_prog != !prog;
+	struct bpf_prog *old_prog;
+
+	if (reset)
+		macb_close(dev);
+
+	old_prog = xchg(&bp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (reset)
+		return macb_open(dev);
+
+	return 0;
+}
+
+static int gem_xdp(struct net_device *dev, struct netdev_xdp *xdp)
+{
+	struct macb *bp = netdev_priv(dev);
+
+	if (!macb_is_gem(bp))
+		return -EOPNOTSUPP;
+
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return gem_xdp_setup(dev, xdp->prog);
+	case XDP_QUERY_PROG:
+		xdp->prog_attached = !!bp->xdp_prog;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
 static const struct net_device_ops macb_netdev_ops = {
 	.ndo_open		= macb_open,
 	.ndo_stop		= macb_close,
@@ -2559,6 +3575,7 @@ static const struct net_device_ops macb_netdev_ops = {
 #endif
 	.ndo_set_features	= macb_set_features,
 	.ndo_features_check	= macb_features_check,
+	.ndo_xdp		= gem_xdp,
 };
 
 /* Configure peripheral capabilities according to device tree
@@ -2581,6 +3598,15 @@ static void macb_configure_caps(struct macb *bp,
 		dcfg = gem_readl(bp, DCFG2);
 		if ((dcfg & (GEM_BIT(RX_PKT_BUFF) | GEM_BIT(TX_PKT_BUFF))) == 0)
 			bp->caps |= MACB_CAPS_FIFO_MODE;
+#ifdef CONFIG_MACB_USE_HWSTAMP
+		if (gem_has_ptp(bp)) {
+			if (!GEM_BFEXT(TSU, gem_readl(bp, DCFG5)))
+				dev_err(&bp->pdev->dev,
+					"GEM doesn't support hardware ptp.\n");
+			else
+				bp->ptp_info = &gem_ptp_info;
+		}
+#endif
 	}
 
 	dev_dbg(&bp->pdev->dev, "Cadence caps 0x%08x\n", bp->caps);
@@ -2711,12 +3737,16 @@ static int macb_init(struct platform_device *pdev)
 
 		queue = &bp->queues[q];
 		queue->bp = bp;
+		u64_stats_init(&queue->stats.rx_syncp);
+		u64_stats_init(&queue->stats.syncp);
 		if (hw_q) {
 			queue->ISR  = GEM_ISR(hw_q - 1);
 			queue->IER  = GEM_IER(hw_q - 1);
 			queue->IDR  = GEM_IDR(hw_q - 1);
 			queue->IMR  = GEM_IMR(hw_q - 1);
 			queue->TBQP = GEM_TBQP(hw_q - 1);
+			queue->RBQP = GEM_RBQP(hw_q - 1);
+			queue->RBQS = GEM_RBQS(hw_q - 1);
 #ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
 			if (bp->hw_dma_cap == HW_DMA_CAP_64B)
 				queue->TBQPH = GEM_TBQPH(hw_q - 1);
@@ -2728,6 +3758,7 @@ static int macb_init(struct platform_device *pdev)
 			queue->IDR  = MACB_IDR;
 			queue->IMR  = MACB_IMR;
 			queue->TBQP = MACB_TBQP;
+			queue->RBQP = MACB_RBQP;
 #ifdef CONFIG_ARCH_DMA_ADDR_T_64BIT
 			if (bp->hw_dma_cap == HW_DMA_CAP_64B)
 				queue->TBQPH = MACB_TBQPH;
@@ -2750,11 +3781,16 @@ static int macb_init(struct platform_device *pdev)
 		}
 
 		INIT_WORK(&queue->tx_error_task, macb_tx_error_task);
+		netif_napi_add(dev, &queue->napi, macb_poll, 64);
+		hrtimer_init(&queue->rx_coalesce_timer, CLOCK_MONOTONIC,
+			     HRTIMER_MODE_REL);
+		queue->rx_coalesce_timer.function = macb_rx_coalesce_timer;
 		q++;
 	}
 
 	dev->netdev_ops = &macb_netdev_ops;
-	netif_napi_add(dev, &bp->napi, macb_poll, 64);
+	if (bp->caps & MACB_CAPS_INT_MODERATION)
+		bp->rx_coalesce_usecs = MACB_DEFAULT_RX_COALESCE_USECS;
 
 	/* setup appropriated routines according to adapter type */
 	if (macb_is_gem(bp)) {
@@ -2763,6 +3799,7 @@ static int macb_init(struct platform_device *pdev)
 		bp->macbgem_ops.mog_free_rx_buffers = gem_free_rx_buffers;
 		bp->macbgem_ops.mog_init_rings = gem_init_rings;
 		bp->macbgem_ops.mog_rx = gem_rx;
+		bp->rx_copybreak = GEM_RX_COPYBREAK;
 		dev->ethtool_ops = &gem_ethtool_ops;
 	} else {
 		bp->max_tx_length = MACB_MAX_TX_LEN;
@@ -2785,6 +3822,24 @@ static int macb_init(struct platform_device *pdev)
 		dev->hw_features |= NETIF_F_HW_CSUM | NETIF_F_RXCSUM;
 	if (bp->caps & MACB_CAPS_SG_DISABLED)
 		dev->hw_features &= ~NETIF_F_SG;
+
+	/* Screeners steer RX flows into the priority queues */
+	if (macb_is_gem(bp) && bp->num_queues > 1) {
+		val = gem_readl(bp, DCFG8);
+		bp->num_t1_scr = min_t(u8, GEM_BFEXT(T1SCR, val), 16);
+		bp->num_t2_scr = min_t(u8, GEM_BFEXT(T2SCR, val), 16);
+		bp->num_etht = min_t(u8, GEM_BFEXT(SCR2ETH, val), 8);
+		bp->num_t2cmp = min_t(u8, GEM_BFEXT(SCR2CMP, val), 32);
+		bp->rx_fs_count = bp->num_t1_scr + bp->num_t2_scr;
+		if (bp->rx_fs_count) {
+			bp->rx_fs = devm_kcalloc(&pdev->dev, bp->rx_fs_count,
+						 sizeof(*bp->rx_fs),
+						 GFP_KERNEL);
+			if (!bp->rx_fs)
+				return -ENOMEM;
+			dev->hw_features |= NETIF_F_NTUPLE;
+		}
+	}
 	dev->features = dev->hw_features;
 
 	if (!(bp->caps & MACB_CAPS_USRIO_DISABLED)) {
@@ -2823,16 +3878,17 @@ static int macb_init(struct platform_device *pdev)
 static int at91ether_start(struct net_device *dev)
 {
 	struct macb *lp = netdev_priv(dev);
+	struct macb_queue *q = &lp->queues[0];
 	struct macb_dma_desc *desc;
 	dma_addr_t addr;
 	u32 ctl;
 	int i;
 
-	lp->rx_ring = dma_alloc_coherent(&lp->pdev->dev,
-					 (AT91ETHER_MAX_RX_DESCR *
-					  macb_dma_desc_get_size(lp)),
-					 &lp->rx_ring_dma, GFP_KERNEL);
-	if (!lp->rx_ring)
+	q->rx_ring = dma_alloc_coherent(&lp->pdev->dev,
+					(AT91ETHER_MAX_RX_DESCR *
+					 macb_dma_desc_get_size(lp)),
+					&q->rx_ring_dma, GFP_KERNEL);
+	if (!q->rx_ring)
 		return -ENOMEM;
 
 	lp->rx_buffers = dma_alloc_coherent(&lp->pdev->dev,
@@ -2843,14 +3899,14 @@ static int at91ether_start(struct net_device *dev)
 		dma_free_coherent(&lp->pdev->dev,
 				  AT91ETHER_MAX_RX_DESCR *
 				  macb_dma_desc_get_size(lp),
-				  lp->rx_ring, lp->rx_ring_dma);
-		lp->rx_ring = NULL;
+				  q->rx_ring, q->rx_ring_dma);
+		q->rx_ring = NULL;
 		return -ENOMEM;
 	}
 
 	addr = lp->rx_buffers_dma;
 	for (i = 0; i < AT91ETHER_MAX_RX_DESCR; i++) {
-		desc = macb_rx_desc(lp, i);
+		desc = macb_rx_desc(q, i);
 		macb_set_addr(lp, desc, addr);
 		desc->ctrl = 0;
 		addr += AT91ETHER_MAX_RBUFF_SZ;
@@ -2860,10 +3916,10 @@ static int at91ether_start(struct net_device *dev)
 	desc->addr |= MACB_BIT(RX_WRAP);
 
 	/* Reset buffer index */
-	lp->rx_tail = 0;
+	q->rx_tail = 0;
 
 	/* Program address of descriptor list in Rx Buffer Queue register */
-	macb_writel(lp, RBQP, lp->rx_ring_dma);
+	macb_writel(lp, RBQP, q->rx_ring_dma);
 
 	/* Enable Receive and Transmit */
 	ctl = macb_readl(lp, NCR);
@@ -2910,6 +3966,7 @@ static int at91ether_open(struct net_device *dev)
 static int at91ether_close(struct net_device *dev)
 {
 	struct macb *lp = netdev_priv(dev);
+	struct macb_queue *q = &lp->queues[0];
 	u32 ctl;
 
 	/* Disable Receiver and Transmitter */
@@ -2930,8 +3987,8 @@ static int at91ether_close(struct net_device *dev)
 	dma_free_coherent(&lp->pdev->dev,
 			  AT91ETHER_MAX_RX_DESCR *
 			  macb_dma_desc_get_size(lp),
-			  lp->rx_ring, lp->rx_ring_dma);
-	lp->rx_ring = NULL;
+			  q->rx_ring, q->rx_ring_dma);
+	q->rx_ring = NULL;
 
 	dma_free_coherent(&lp->pdev->dev,
 			  AT91ETHER_MAX_RX_DESCR * AT91ETHER_MAX_RBUFF_SZ,
@@ -2980,14 +4037,15 @@ static int at91ether_start_xmit(struct sk_buff *skb, struct net_device *dev)
 static void at91ether_rx(struct net_device *dev)
 {
 	struct macb *lp = netdev_priv(dev);
+	struct macb_queue *q = &lp->queues[0];
 	struct macb_dma_desc *desc;
 	unsigned char *p_recv;
 	struct sk_buff *skb;
 	unsigned int pktlen;
 
-	desc = macb_rx_desc(lp, lp->rx_tail);
+	desc = macb_rx_desc(q, q->rx_tail);
 	while (desc->addr & MACB_BIT(RX_USED)) {
-		p_recv = lp->rx_buffers + lp->rx_tail * AT91ETHER_MAX_RBUFF_SZ;
+		p_recv = lp->rx_buffers + q->rx_tail * AT91ETHER_MAX_RBUFF_SZ;
 		pktlen = MACB_BF(RX_FRMLEN, desc->ctrl);
 		skb = netdev_alloc_skb(dev, pktlen + 2);
 		if (skb) {
@@ -3009,12 +4067,12 @@ static void at91ether_rx(struct net_device *dev)
 		desc->addr &= ~MACB_BIT(RX_USED);
 
 		/* wrap after last buffer */
-		if (lp->rx_tail == AT91ETHER_MAX_RX_DESCR - 1)
-			lp->rx_tail = 0;
+		if (q->rx_tail == AT91ETHER_MAX_RX_DESCR - 1)
+			q->rx_tail = 0;
 		else
-			lp->rx_tail++;
+			q->rx_tail++;
 
-		desc = macb_rx_desc(lp, lp->rx_tail);
+		desc = macb_rx_desc(q, q->rx_tail);
 	}
 }
 
@@ -3120,6 +4178,8 @@ static int at91ether_init(struct platform_device *pdev)
 	int err;
 	u32 reg;
 
+	bp->queues[0].bp = bp;
+
 	dev->netdev_ops = &at91ether_netdev_ops;
 	dev->ethtool_ops = &macb_ethtool_ops;
 
@@ -3186,7 +4246,8 @@ static const struct macb_config np4_config = {
 };
 
 static const struct macb_config zynqmp_config = {
-	.caps = MACB_CAPS_GIGABIT_MODE_AVAILABLE | MACB_CAPS_JUMBO,
+	.caps = MACB_CAPS_GIGABIT_MODE_AVAILABLE | MACB_CAPS_JUMBO |
+		MACB_CAPS_INT_MODERATION,
 	.dma_burst_length = 16,
 	.clk_init = macb_clk_init,
 	.init = macb_init,
@@ -3194,7 +4255,8 @@ static const struct macb_config zynqmp_config = {
 };
 
 static const struct macb_config zynq_config = {
-	.caps = MACB_CAPS_GIGABIT_MODE_AVAILABLE | MACB_CAPS_NO_GIGABIT_HALF,
+	.caps = MACB_CAPS_GIGABIT_MODE_AVAILABLE | MACB_CAPS_NO_GIGABIT_HALF |
+		MACB_CAPS_GEM_HAS_PTP,
 	.dma_burst_length = 16,
 	.clk_init = macb_clk_init,
 	.init = macb_init,
@@ -3434,6 +4496,8 @@ static int macb_remove(struct platform_device *pdev)
 			gpiod_set_value(bp->reset_gpio, 0);
 
 		unregister_netdev(dev);
+		if (bp->xdp_prog)
+			bpf_prog_put(bp->xdp_prog);
 		clk_disable_unprepare(bp->tx_clk);
 		clk_disable_unprepare(bp->hclk);
 		clk_disable_unprepare(bp->pclk);
@@ -3498,6 +4562,7 @@ static struct platform_driver macb_driver = {
 		.name		= "macb",
 		.of_match_table	= of_match_ptr(macb_dt_ids),
 		.pm	= &macb_pm_ops,
+		.probe_type	= PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
@@ -0,0 +1,441 @@
+/*
+ * 1588 PTP support for Cadence GEM
+ *
+ * The timestamp unit of the Zynq GEM has no descriptor timestamps: it
+ * latches the time of the last PTP event frame sent and received, with a
+ * separate set of registers for the peer delay messages. The driver reads
+ * them back when a frame is completed or received, which is right as long
+ * as event messages are not sent or received back to back, far from the
+ * rates PTP uses.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include <linux/clk.h>
+#include <linux/device.h>
+#include <linux/etherdevice.h>
+#include <linux/ip.h>
+#include <linux/net_tstamp.h>
+#include <linux/ptp_classify.h>
+#include <linux/ptp_clock_kernel.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+
+#include "macb.h"
+
+#define GEM_PTP_TIMER_NAME	"gem-ptp-timer"
+
+/* The increment of the timer can only be trimmed by 1/256 ns per clock
+ * cycle, several hundred ppm at the usual TSU rates. It keeps the nominal
+ * value and frequency adjustments are applied as small time steps.
+ */
+#define GEM_PTP_MAX_ADJ		250000	/* ppb */
+#define GEM_PTP_ADJ_PERIOD	msecs_to_jiffies(10)
+
+/* PTP event message types */
+#define GEM_PTP_SYNC		0
+#define GEM_PTP_DELAY_REQ	1
+#define GEM_PTP_PDELAY_REQ	2
+#define GEM_PTP_PDELAY_RESP	3
+
+static s32 gem_get_ptp_max_adj(void)
+{
+	return GEM_PTP_MAX_ADJ;
+}
+
+static unsigned int gem_get_tsu_rate(struct macb *bp)
+{
+	return clk_get_rate(bp->pclk);
+}
+
+/* Timer increment for a TSU clock rate: the alternative increment is used
+ * once every NIT + 1 cycles to reach a fractional nanosecond period.
+ */
+static u32 gem_tsu_incr(unsigned int rate)
+{
+	u32 period = DIV_ROUND_CLOSEST_ULL(256ULL * NSEC_PER_SEC, rate);
+	u32 ns = period >> 8, frac = period & 0xff;
+
+	if (!frac)
+		return MACB_BF(TI_CNS, ns);
+
+	if (frac <= 128)
+		return MACB_BF(TI_CNS, ns) | MACB_BF(TI_ACNS, ns + 1) |
+		       MACB_BF(TI_NIT, DIV_ROUND_CLOSEST(256, frac) - 1);
+
+	return MACB_BF(TI_CNS, ns + 1) | MACB_BF(TI_ACNS, ns) |
+	       MACB_BF(TI_NIT, DIV_ROUND_CLOSEST(256, 256 - frac) - 1);
+}
+
+/* Called with tsu_clk_lock held, |delta| below a second */
+static void gem_tsu_step(struct macb *bp, s64 delta)
+{
+	u32 adj = 0;
+
+	if (delta < 0) {
+		adj |= GEM_BIT(ADDSUB);
+		delta = -delta;
+	}
+	adj |= GEM_BF(ITDT, delta);
+
+	gem_writel(bp, TA, adj);
+}
+
+/* Called with tsu_clk_lock held: apply what is due at the current rate */
+static void gem_tsu_adj_step(struct macb *bp)
+{
+	ktime_t now = ktime_get();
+	s64 step;
+
+	bp->tsu_adj_rem += (s64)bp->tsu_ppb *
+			   ktime_to_ns(ktime_sub(now, bp->tsu_adj_last));
+	bp->tsu_adj_last = now;
+
+	step = div_s64(bp->tsu_adj_rem, NSEC_PER_SEC);
+	if (step) {
+		gem_tsu_step(bp, step);
+		bp->tsu_adj_rem -= step * NSEC_PER_SEC;
+	}
+}
+
+static void gem_tsu_adj_work(struct work_struct *work)
+{
+	struct macb *bp = container_of(to_delayed_work(work), struct macb,
+				       tsu_adj_work);
+	unsigned long flags;
+	s32 ppb;
+
+	spin_lock_irqsave(&bp->tsu_clk_lock, flags);
+	gem_tsu_adj_step(bp);
+	ppb = bp->tsu_ppb;
+	spin_unlock_irqrestore(&bp->tsu_clk_lock, flags);
+
+	if (ppb)
+		schedule_delayed_work(&bp->tsu_adj_work, GEM_PTP_ADJ_PERIOD);
+}
+
+static int gem_tsu_get_time(struct ptp_clock_info *ptp, struct timespec64 *ts)
+{
+	struct macb *bp = container_of(ptp, struct macb, ptp_clock_info);
+	unsigned long flags;
+	u32 first, secs;
+
+	spin_lock_irqsave(&bp->tsu_clk_lock, flags);
+	first = gem_readl(bp, TSL);
+	ts->tv_nsec = gem_readl(bp, TN);
+	secs = gem_readl(bp, TSL);
+	/* the nanoseconds wrapped between the two reads */
+	if (secs != first)
+		ts->tv_nsec = gem_readl(bp, TN);
+	spin_unlock_irqrestore(&bp->tsu_clk_lock, flags);
+
+	ts->tv_sec = secs;
+
+	return 0;
+}
+
+static int gem_tsu_set_time(struct ptp_clock_info *ptp,
+			    const struct timespec64 *ts)
+{
+	struct macb *bp = container_of(ptp, struct macb, ptp_clock_info);
+	unsigned long flags;
+
+	spin_lock_irqsave(&bp->tsu_clk_lock, flags);
+	/* clear the nanoseconds first, so that they cannot wrap before the
+	 * seconds are written
+	 */
+	gem_writel(bp, TN, 0);
+	gem_writel(bp, TSL, lower_32_bits(ts->tv_sec));
+	gem_writel(bp, TN, ts->tv_nsec);
+	bp->tsu_adj_rem = 0;
+	bp->tsu_adj_last = ktime_get();
+	spin_unlock_irqrestore(&bp->tsu_clk_lock, flags);
+
+	return 0;
+}
+
+static int gem_ptp_adjfine(struct ptp_clock_info *ptp, long scaled_ppm)
+{
+	struct macb *bp = container_of(ptp, struct macb, ptp_clock_info);
+	unsigned long flags;
+	s32 ppb;
+
+	/* scaled_ppm is in ppm with a 16 bit binary fractional field */
+	ppb = div_s64((s64)scaled_ppm * 1000, 1 << 16);
+
+	spin_lock_irqsave(&bp->tsu_clk_lock, flags);
+	gem_tsu_adj_step(bp);
+	bp->tsu_ppb = ppb;
+	spin_unlock_irqrestore(&bp->tsu_clk_lock, flags);
+
+	if (ppb)
+		schedule_delayed_work(&bp->tsu_adj_work, GEM_PTP_ADJ_PERIOD);
+
+	return 0;
+}
+
+static int gem_ptp_adjtime(struct ptp_clock_info *ptp, s64 delta)
+{
+	struct macb *bp = container_of(ptp, struct macb, ptp_clock_info);
+	struct timespec64 now;
+	unsigned long flags;
+
+	if (delta > -NSEC_PER_SEC && delta < NSEC_PER_SEC) {
+		spin_lock_irqsave(&bp->tsu_clk_lock, flags);
+		gem_tsu_step(bp, delta);
+		spin_unlock_irqrestore(&bp->tsu_clk_lock, flags);
+		return 0;
+	}
+
+	gem_tsu_get_time(ptp, &now);
+	now = timespec64_add(now, ns_to_timespec64(delta));
+
+	return gem_tsu_set_time(ptp, &now);
+}
+
+static int gem_ptp_enable(struct ptp_clock_info *ptp,
+			  struct ptp_clock_request *rq, int on)
+{
+	return -EOPNOTSUPP;
+}
+
+static const struct ptp_clock_info gem_ptp_caps_template = {
+	.owner		= THIS_MODULE,
+	.name		= GEM_PTP_TIMER_NAME,
+	.max_adj	= 0,
+	.n_alarm	= 0,
+	.n_ext_ts	= 0,
+	.n_per_out	= 0,
+	.n_pins		= 0,
+	.pps		= 0,
+	.adjfine	= gem_ptp_adjfine,
+	.adjtime	= gem_ptp_adjtime,
+	.gettime64	= gem_tsu_get_time,
+	.settime64	= gem_tsu_set_time,
+	.enable		= gem_ptp_enable,
+};
+
+static void gem_ptp_init(struct net_device *dev)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct timespec64 now;
+
+	bp->ptp_clock_info = gem_ptp_caps_template;
+	bp->ptp_clock_info.max_adj = bp->ptp_info->get_ptp_max_adj();
+
+	spin_lock_init(&bp->tsu_clk_lock);
+	INIT_DELAYED_WORK(&bp->tsu_adj_work, gem_tsu_adj_work);
+	bp->tsu_ppb = 0;
+
+	bp->tsu_rate = bp->ptp_info->get_tsu_rate(bp);
+	gem_writel(bp, TI, gem_tsu_incr(bp->tsu_rate));
+
+	ktime_get_real_ts64(&now);
+	gem_tsu_set_time(&bp->ptp_clock_info, &now);
+
+	bp->ptp_clock = ptp_clock_register(&bp->ptp_clock_info, &bp->pdev->dev);
+	if (IS_ERR(bp->ptp_clock)) {
+		netdev_err(dev, "ptp_clock_register failed\n");
+		bp->ptp_clock = NULL;
+		return;
+	}
+
+	netdev_info(dev, "%s ptp clock registered, TSU at %u Hz\n",
+		    GEM_PTP_TIMER_NAME, bp->tsu_rate);
+}
+
+static void gem_ptp_remove(struct net_device *dev)
+{
+	struct macb *bp = netdev_priv(dev);
+
+	if (bp->ptp_clock)
+		ptp_clock_unregister(bp->ptp_clock);
+	bp->ptp_clock = NULL;
+
+	bp->tsu_ppb = 0;
+	cancel_delayed_work_sync(&bp->tsu_adj_work);
+}
+
+static int gem_get_ts_info(struct net_device *dev,
+			   struct ethtool_ts_info *info)
+{
+	struct macb *bp = netdev_priv(dev);
+
+	info->so_timestamping =
+		SOF_TIMESTAMPING_TX_SOFTWARE |
+		SOF_TIMESTAMPING_RX_SOFTWARE |
+		SOF_TIMESTAMPING_SOFTWARE |
+		SOF_TIMESTAMPING_TX_HARDWARE |
+		SOF_TIMESTAMPING_RX_HARDWARE |
+		SOF_TIMESTAMPING_RAW_HARDWARE;
+	info->tx_types =
+		(1 << HWTSTAMP_TX_OFF) |
+		(1 << HWTSTAMP_TX_ON);
+	info->rx_filters =
+		(1 << HWTSTAMP_FILTER_NONE) |
+		(1 << HWTSTAMP_FILTER_PTP_V1_L4_EVENT) |
+		(1 << HWTSTAMP_FILTER_PTP_V2_EVENT);
+	info->phc_index = bp->ptp_clock ? ptp_clock_index(bp->ptp_clock) : -1;
+
+	return 0;
+}
+
+static int gem_get_hwtst(struct net_device *dev, struct ifreq *rq)
+{
+	struct macb *bp = netdev_priv(dev);
+
+	if (copy_to_user(rq->ifr_data, &bp->tstamp_config,
+			 sizeof(bp->tstamp_config)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int gem_set_hwtst(struct net_device *dev, struct ifreq *rq, int cmd)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct hwtstamp_config config;
+
+	if (copy_from_user(&config, rq->ifr_data, sizeof(config)))
+		return -EFAULT;
+
+	/* reserved for future extensions */
+	if (config.flags)
+		return -EINVAL;
+
+	switch (config.tx_type) {
+	case HWTSTAMP_TX_OFF:
+	case HWTSTAMP_TX_ON:
+		break;
+	default:
+		return -ERANGE;
+	}
+
+	/* The TSU timestamps all event messages and nothing else */
+	switch (config.rx_filter) {
+	case HWTSTAMP_FILTER_NONE:
+		break;
+	case HWTSTAMP_FILTER_PTP_V1_L4_EVENT:
+	case HWTSTAMP_FILTER_PTP_V1_L4_SYNC:
+	case HWTSTAMP_FILTER_PTP_V1_L4_DELAY_REQ:
+		config.rx_filter = HWTSTAMP_FILTER_PTP_V1_L4_EVENT;
+		break;
+	case HWTSTAMP_FILTER_PTP_V2_L4_EVENT:
+	case HWTSTAMP_FILTER_PTP_V2_L4_SYNC:
+	case HWTSTAMP_FILTER_PTP_V2_L4_DELAY_REQ:
+	case HWTSTAMP_FILTER_PTP_V2_L2_EVENT:
+	case HWTSTAMP_FILTER_PTP_V2_L2_SYNC:
+	case HWTSTAMP_FILTER_PTP_V2_L2_DELAY_REQ:
+	case HWTSTAMP_FILTER_PTP_V2_EVENT:
+	case HWTSTAMP_FILTER_PTP_V2_SYNC:
+	case HWTSTAMP_FILTER_PTP_V2_DELAY_REQ:
+		config.rx_filter = HWTSTAMP_FILTER_PTP_V2_EVENT;
+		break;
+	default:
+		return -ERANGE;
+	}
+
+	bp->tstamp_config = config;
+
+	if (copy_to_user(rq->ifr_data, &config, sizeof(config)))
+		return -EFAULT;
+
+	return 0;
+}
+
+struct macb_ptp_info gem_ptp_info = {
+	.ptp_init	 = gem_ptp_init,
+	.ptp_remove	 = gem_ptp_remove,
+	.get_ptp_max_adj = gem_get_ptp_max_adj,
+	.get_tsu_rate	 = gem_get_tsu_rate,
+	.get_ts_info	 = gem_get_ts_info,
+	.get_hwtst	 = gem_get_hwtst,
+	.set_hwtst	 = gem_set_hwtst,
+};
+
+/* Message type of a frame the TSU timestamps (PTP event messages over
+ * UDP/IPv4 or raw Ethernet), -1 for others. skb->data points to the MAC
+ * header.
+ */
+static int gem_ptp_msgtype(struct sk_buff *skb)
+{
+	unsigned int type = ptp_classify_raw(skb);
+	unsigned int offset;
+	u8 msgtype;
+
+	if (type & PTP_CLASS_VLAN)
+		return -1;
+
+	switch (type & PTP_CLASS_PMASK) {
+	case PTP_CLASS_IPV4:
+		offset = ETH_HLEN + IPV4_HLEN(skb->data) + UDP_HLEN;
+		break;
+	case PTP_CLASS_L2:
+		offset = ETH_HLEN;
+		break;
+	default:
+		return -1;
+	}
+
+	if (type & PTP_CLASS_V1)
+		offset += OFF_PTP_CONTROL;
+
+	if (skb_headlen(skb) < offset + 1)
+		return -1;
+
+	if (type & PTP_CLASS_V1) {
+		/* control field: the event messages are sync and delay_req */
+		msgtype = skb->data[offset];
+		return msgtype <= GEM_PTP_DELAY_REQ ? msgtype : -1;
+	}
+
+	msgtype = skb->data[offset] & 0x0f;
+	return msgtype <= GEM_PTP_PDELAY_RESP ? msgtype : -1;
+}
+
+static ktime_t gem_ptp_event_time(struct macb *bp, int sec_reg, int nsec_reg)
+{
+	u32 secs = bp->macb_reg_readl(bp, sec_reg);
+
+	return ktime_set(secs, bp->macb_reg_readl(bp, nsec_reg));
+}
+
+void gem_ptp_do_tx_prep(struct macb *bp, struct sk_buff *skb)
+{
+	if (gem_ptp_msgtype(skb) >= 0)
+		skb_shinfo(skb)->tx_flags |= SKBTX_IN_PROGRESS;
+}
+
+void gem_ptp_do_txstamp(struct macb *bp, struct sk_buff *skb)
+{
+	struct skb_shared_hwtstamps hwts = {};
+	int msgtype = gem_ptp_msgtype(skb);
+
+	if (msgtype < 0)
+		return;
+
+	if (msgtype >= GEM_PTP_PDELAY_REQ)
+		hwts.hwtstamp = gem_ptp_event_time(bp, GEM_PEFTSL, GEM_PEFTN);
+	else
+		hwts.hwtstamp = gem_ptp_event_time(bp, GEM_EFTSL, GEM_EFTN);
+
+	skb_tstamp_tx(skb, &hwts);
+}
+
+void gem_ptp_do_rxstamp(struct macb *bp, struct sk_buff *skb)
+{
+	struct skb_shared_hwtstamps *hwts = skb_hwtstamps(skb);
+	int msgtype = gem_ptp_msgtype(skb);
+
+	if (msgtype < 0)
+		return;
+
+	if (msgtype >= GEM_PTP_PDELAY_REQ)
+		hwts->hwtstamp = gem_ptp_event_time(bp, GEM_PEFRSL, GEM_PEFRN);
+	else
+		hwts->hwtstamp = gem_ptp_event_time(bp, GEM_EFRSL, GEM_EFRN);
+}
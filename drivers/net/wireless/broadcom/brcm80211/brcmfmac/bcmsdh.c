@@ -621,6 +621,8 @@ static int brcmf_sdiod_sglist_rw(struct brcmf_sdio_dev *sdiodev, uint fn,
 
 		mmc_set_data_timeout(&mmc_dat, sdiodev->func[fn]->card);
 		mmc_wait_for_req(sdiodev->func[fn]->card->host, &mmc_req);
+		sdiodev->cmd53_sg++;
+		sdiodev->cmd53_sg_bytes += req_sz;
 
 		ret = mmc_cmd.error ? mmc_cmd.error : mmc_dat.error;
 		if (ret == -ENOMEDIUM) {
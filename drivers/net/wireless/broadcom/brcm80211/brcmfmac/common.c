@@ -47,6 +47,10 @@ static int brcmf_sdiod_txglomsz = BRCMF_DEFAULT_TXGLOM_SIZE;
 module_param_named(txglomsz, brcmf_sdiod_txglomsz, int, 0);
 MODULE_PARM_DESC(txglomsz, "Maximum tx packet chain size [SDIO]");
 
+static int brcmf_sdiod_txglom_hold_us;
+module_param_named(txglom_hold_us, brcmf_sdiod_txglom_hold_us, int, 0);
+MODULE_PARM_DESC(txglom_hold_us, "Max time to hold tx frames for a glom chain [SDIO]");
+
 /* Debug level configuration. See debug.h for bits, sysfs modifiable */
 int brcmf_msg_level;
 module_param_named(debug, brcmf_msg_level, int, S_IRUSR | S_IWUSR);
@@ -291,8 +295,10 @@ struct brcmf_mp_device *brcmf_get_module_param(struct device *dev,
 	settings->ignore_probe_fail = !!brcmf_ignore_probe_fail;
 #endif
 
-	if (bus_type == BRCMF_BUSTYPE_SDIO)
+	if (bus_type == BRCMF_BUSTYPE_SDIO) {
 		settings->bus.sdio.txglomsz = brcmf_sdiod_txglomsz;
+		settings->bus.sdio.txglom_hold_us = brcmf_sdiod_txglom_hold_us;
+	}
 
 	/* See if there is any device specific platform data configured */
 	found = false;
@@ -231,6 +231,14 @@ static netdev_tx_t brcmf_netdev_start_xmit(struct sk_buff *skb,
 	if (eh->h_proto == htons(ETH_P_PAE))
 		atomic_inc(&ifp->pend_8021x_cnt);
 
+	/* Game traffic goes out as voice, and keeps low latency mode on */
+	if (ifp->low_latency && ifp->ll_mark && skb->mark == ifp->ll_mark) {
+		skb->priority = PRIO_8021D_VO;
+		ifp->ll_last_tx = jiffies;
+		if (!ifp->ll_active)
+			mod_delayed_work(system_wq, &ifp->ll_work, 0);
+	}
+
 	/* determine the priority */
 	if ((skb->priority == 0) || (skb->priority > 7))
 		skb->priority = cfg80211_classify8021d(skb, NULL);
@@ -452,6 +460,127 @@ static const struct net_device_ops brcmf_netdev_ops_pri = {
 	.ndo_set_rx_mode = brcmf_netdev_set_multicast_list
 };
 
+/*
+ * Low latency mode: power save off and short A-MPDUs, so that frames of an
+ * online game neither wait for the next beacon nor for an aggregate to
+ * fill up. With ll_mark set it only lasts while frames with that skb mark
+ * are sent and ends BRCMF_LL_IDLE after the last one, when the game is
+ * gone. Those frames are also sent at voice priority.
+ */
+#define BRCMF_LL_IDLE		(5 * HZ)
+#define BRCMF_LL_AMPDU_MPDU	4
+
+static void brcmf_ll_apply(struct brcmf_if *ifp, bool on)
+{
+	struct brcmf_cfg80211_info *cfg = ifp->drvr->config;
+	s32 pm;
+
+	if (on) {
+		brcmf_fil_cmd_int_set(ifp, BRCMF_C_SET_PM, PM_OFF);
+		if (brcmf_fil_iovar_int_get(ifp, "ampdu_mpdu",
+					    &ifp->ll_ampdu_mpdu) ||
+		    brcmf_fil_iovar_int_set(ifp, "ampdu_mpdu",
+					    BRCMF_LL_AMPDU_MPDU))
+			ifp->ll_ampdu_mpdu = 0;
+	} else {
+		if (ifp->ll_ampdu_mpdu)
+			brcmf_fil_iovar_int_set(ifp, "ampdu_mpdu",
+						ifp->ll_ampdu_mpdu);
+		pm = cfg->pwr_save ? PM_FAST : PM_OFF;
+		if (ifp->vif->wdev.iftype == NL80211_IFTYPE_P2P_CLIENT)
+			pm = PM_OFF;
+		brcmf_fil_cmd_int_set(ifp, BRCMF_C_SET_PM, pm);
+	}
+
+	ifp->ll_active = on;
+	brcmf_dbg(INFO, "%s: low latency %s\n", brcmf_ifname(ifp),
+		  on ? "on" : "off");
+}
+
+static void brcmf_ll_worker(struct work_struct *work)
+{
+	struct brcmf_if *ifp = container_of(work, struct brcmf_if,
+					    ll_work.work);
+	unsigned long idle_at;
+	bool on = ifp->low_latency;
+
+	if (on && ifp->ll_mark) {
+		idle_at = READ_ONCE(ifp->ll_last_tx) + BRCMF_LL_IDLE;
+		on = time_before(jiffies, idle_at);
+		if (on)
+			schedule_delayed_work(&ifp->ll_work, idle_at - jiffies);
+	}
+
+	if (on != ifp->ll_active)
+		brcmf_ll_apply(ifp, on);
+}
+
+static ssize_t low_latency_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct brcmf_if *ifp = netdev_priv(to_net_dev(dev));
+
+	return sprintf(buf, "%d\n", ifp->low_latency);
+}
+
+static ssize_t low_latency_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct brcmf_if *ifp = netdev_priv(to_net_dev(dev));
+	bool enable;
+	int ret;
+
+	ret = strtobool(buf, &enable);
+	if (ret)
+		return ret;
+
+	ifp->ll_last_tx = jiffies;
+	ifp->low_latency = enable;
+	mod_delayed_work(system_wq, &ifp->ll_work, 0);
+
+	return count;
+}
+static DEVICE_ATTR_RW(low_latency);
+
+static ssize_t low_latency_mark_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct brcmf_if *ifp = netdev_priv(to_net_dev(dev));
+
+	return sprintf(buf, "0x%x\n", ifp->ll_mark);
+}
+
+static ssize_t low_latency_mark_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct brcmf_if *ifp = netdev_priv(to_net_dev(dev));
+	u32 mark;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &mark);
+	if (ret)
+		return ret;
+
+	ifp->ll_last_tx = jiffies;
+	ifp->ll_mark = mark;
+	mod_delayed_work(system_wq, &ifp->ll_work, 0);
+
+	return count;
+}
+static DEVICE_ATTR_RW(low_latency_mark);
+
+static struct attribute *brcmf_if_attrs[] = {
+	&dev_attr_low_latency.attr,
+	&dev_attr_low_latency_mark.attr,
+	NULL,
+};
+
+static const struct attribute_group brcmf_if_attr_group = {
+	.attrs = brcmf_if_attrs,
+};
+
 int brcmf_net_attach(struct brcmf_if *ifp, bool rtnl_locked)
 {
 	struct brcmf_pub *drvr = ifp->drvr;
@@ -474,6 +603,8 @@ int brcmf_net_attach(struct brcmf_if *ifp, bool rtnl_locked)
 
 	INIT_WORK(&ifp->multicast_work, _brcmf_set_multicast_list);
 	INIT_WORK(&ifp->ndoffload_work, _brcmf_update_ndtable);
+	INIT_DELAYED_WORK(&ifp->ll_work, brcmf_ll_worker);
+	ndev->sysfs_groups[0] = &brcmf_if_attr_group;
 
 	if (rtnl_locked)
 		err = register_netdevice(ndev);
@@ -679,6 +810,7 @@ static void brcmf_del_if(struct brcmf_pub *drvr, s32 bsscfgidx,
 		if (ifp->ndev->netdev_ops == &brcmf_netdev_ops_pri) {
 			cancel_work_sync(&ifp->multicast_work);
 			cancel_work_sync(&ifp->ndoffload_work);
+			cancel_delayed_work_sync(&ifp->ll_work);
 		}
 		brcmf_net_detach(ifp->ndev, rtnl_locked);
 	} else {
@@ -179,6 +179,12 @@ enum brcmf_netif_stop_reason {
  * @netif_stop_lock: spinlock for update netif_stop from multiple sources.
  * @pend_8021x_cnt: tracks outstanding number of 802.1x frames.
  * @pend_8021x_wait: used for signalling change in count.
+ * @low_latency: low latency mode requested through sysfs.
+ * @ll_mark: skb mark of the game traffic, 0 for none.
+ * @ll_active: low latency settings are applied to the firmware.
+ * @ll_last_tx: jiffies of the last marked frame sent.
+ * @ll_ampdu_mpdu: firmware ampdu_mpdu to restore, 0 if unknown.
+ * @ll_work: worker object applying and restoring low latency settings.
  */
 struct brcmf_if {
 	struct brcmf_pub *drvr;
@@ -196,6 +202,12 @@ struct brcmf_if {
 	wait_queue_head_t pend_8021x_wait;
 	struct in6_addr ipv6_addr_tbl[NDOL_MAX_ENTRIES];
 	u8 ipv6addr_idx;
+	bool low_latency;
+	u32 ll_mark;
+	bool ll_active;
+	unsigned long ll_last_tx;
+	u32 ll_ampdu_mpdu;
+	struct delayed_work ll_work;
 };
 
 int brcmf_netdev_wait_pend8021x(struct brcmf_if *ifp);
@@ -22,6 +22,7 @@
 #include <linux/pci_ids.h>
 #include <linux/netdevice.h>
 #include <linux/interrupt.h>
+#include <linux/hrtimer.h>
 #include <linux/sched/signal.h>
 #include <linux/mmc/sdio.h>
 #include <linux/mmc/sdio_ids.h>
@@ -418,6 +419,9 @@ struct brcmf_sdio_count {
 	uint rxglomfail;	/* Failed deglom attempts */
 	uint rxglomframes;	/* Number of glom frames (superframes) */
 	uint rxglompkts;	/* Number of packets from glom frames */
+	uint txglomframes;	/* Number of tx glom frames (superframes) */
+	uint txglompkts;	/* Number of packets sent in tx glom frames */
+	uint txglomheld;	/* Number of times tx was held for a glom */
 	uint f2rxhdrs;		/* Number of header reads */
 	uint f2rxdata;		/* Number of frame data reads */
 	uint f2txdata;		/* Number of f2 frame writes */
@@ -519,6 +523,9 @@ struct brcmf_sdio {
 
 	u8 tx_hdrlen;		/* sdio bus header length for tx packet */
 	bool txglom;		/* host tx glomming enable flag */
+	uint txq_depth_avg;	/* tx queue depth when sending, x16 */
+	ktime_t txglom_hold;	/* tx held back for a glom until then */
+	struct hrtimer txglom_timer;
 	u16 head_align;		/* buffer pointer alignment */
 	u16 sgentry_align;	/* scatter-gather buffer alignment */
 };
@@ -2276,13 +2283,59 @@ done:
 	return ret;
 }
 
+static bool brcmf_sdio_txglom_held(struct brcmf_sdio *bus)
+{
+	return bus->txglom_hold && ktime_before(ktime_get(), bus->txglom_hold);
+}
+
+/*
+ * With fewer frames queued than during the recent sends, more are likely
+ * on their way. Holding the queue back for up to txglom_hold_us lets them
+ * go out in the same glom chain, one CMD53 and one interrupt instead of
+ * several small ones.
+ */
+static bool brcmf_sdio_txglom_hold(struct brcmf_sdio *bus, uint qlen,
+				   uint glom_num)
+{
+	uint hold_us = bus->sdiodev->settings->bus.sdio.txglom_hold_us;
+
+	if (!hold_us || qlen >= glom_num || qlen >= bus->txq_depth_avg / 16) {
+		bus->txglom_hold = 0;
+		return false;
+	}
+
+	if (!bus->txglom_hold) {
+		bus->txglom_hold = ktime_add_us(ktime_get(), hold_us);
+		hrtimer_start(&bus->txglom_timer, ns_to_ktime(hold_us * 1000ULL),
+			      HRTIMER_MODE_REL);
+		bus->sdcnt.txglomheld++;
+		return true;
+	}
+
+	if (brcmf_sdio_txglom_held(bus))
+		return true;
+
+	bus->txglom_hold = 0;
+	return false;
+}
+
+static enum hrtimer_restart brcmf_sdio_txglom_timer(struct hrtimer *timer)
+{
+	struct brcmf_sdio *bus = container_of(timer, struct brcmf_sdio,
+					      txglom_timer);
+
+	brcmf_sdio_trigger_dpc(bus);
+
+	return HRTIMER_NORESTART;
+}
+
 static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 {
 	struct sk_buff *pkt;
 	struct sk_buff_head pktq;
 	u32 intstatus = 0;
 	int ret = 0, prec_out, i;
-	uint cnt = 0;
+	uint cnt = 0, qlen;
 	u8 tx_prec_map, pkt_num;
 
 	brcmf_dbg(TRACE, "Enter\n");
@@ -2295,8 +2348,13 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 		if (bus->txglom)
 			pkt_num = min_t(u8, bus->tx_max - bus->tx_seq,
 					bus->sdiodev->txglomsz);
-		pkt_num = min_t(u32, pkt_num,
-				brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol));
+		qlen = brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol);
+		if (!qlen)
+			break;
+		if (bus->txglom && brcmf_sdio_txglom_hold(bus, qlen, pkt_num))
+			break;
+		bus->txq_depth_avg += qlen * 2 - bus->txq_depth_avg / 8;
+		pkt_num = min_t(u32, pkt_num, qlen);
 		__skb_queue_head_init(&pktq);
 		spin_lock_bh(&bus->txq_lock);
 		for (i = 0; i < pkt_num; i++) {
@@ -2313,6 +2371,10 @@ static uint brcmf_sdio_sendfromq(struct brcmf_sdio *bus, uint maxframes)
 		ret = brcmf_sdio_txpkt(bus, &pktq, SDPCM_DATA_CHANNEL);
 
 		cnt += i;
+		if (i > 1) {
+			bus->sdcnt.txglomframes++;
+			bus->sdcnt.txglompkts += i;
+		}
 
 		/* In poll mode, need to check for other events */
 		if (!bus->intr) {
@@ -2666,7 +2728,7 @@ static void brcmf_sdio_dpc(struct brcmf_sdio *bus)
 		   atomic_read(&bus->ipend) > 0 ||
 		   (!atomic_read(&bus->fcstate) &&
 		    brcmu_pktq_mlen(&bus->txq, ~bus->flowcontrol) &&
-		    data_ok(bus))) {
+		    data_ok(bus) && !brcmf_sdio_txglom_held(bus))) {
 		bus->dpc_triggered = true;
 	}
 }
@@ -3093,6 +3155,9 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 		   "fc_rcvd:      %u\nfc_xoff:      %u\n"
 		   "fc_xon:       %u\nrxglomfail:   %u\n"
 		   "rxglomframes: %u\nrxglompkts:   %u\n"
+		   "txglomframes: %u\ntxglompkts:   %u\n"
+		   "txglomheld:   %u\ntxqdepthavg:  %u\n"
+		   "cmd53_sg:     %u\ncmd53_sgbyte: %lu\n"
 		   "f2rxhdrs:     %u\nf2rxdata:     %u\n"
 		   "f2txdata:     %u\nf1regdata:    %u\n"
 		   "tickcnt:      %u\ntx_ctlerrs:   %lu\n"
@@ -3107,6 +3172,9 @@ static int brcmf_debugfs_sdio_count_read(struct seq_file *seq, void *data)
 		   sdcnt->fc_rcvd, sdcnt->fc_xoff,
 		   sdcnt->fc_xon, sdcnt->rxglomfail,
 		   sdcnt->rxglomframes, sdcnt->rxglompkts,
+		   sdcnt->txglomframes, sdcnt->txglompkts,
+		   sdcnt->txglomheld, sdiodev->bus->txq_depth_avg / 16,
+		   sdiodev->cmd53_sg, sdiodev->cmd53_sg_bytes,
 		   sdcnt->f2rxhdrs, sdcnt->f2rxdata,
 		   sdcnt->f2txdata, sdcnt->f1regdata,
 		   sdcnt->tickcnt, sdcnt->tx_ctlerrs,
@@ -4111,6 +4179,8 @@ struct brcmf_sdio *brcmf_sdio_probe(struct brcmf_sdio_dev *sdiodev)
 	bus->rxbound = BRCMF_RXBOUND;
 	bus->txminmax = BRCMF_TXMINMAX;
 	bus->tx_seq = SDPCM_SEQ_WRAP - 1;
+	hrtimer_init(&bus->txglom_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	bus->txglom_timer.function = brcmf_sdio_txglom_timer;
 
 	/* single-threaded workqueue */
 	wq = alloc_ordered_workqueue("brcmf_wq/%s", WQ_MEM_RECLAIM,
@@ -4246,6 +4316,7 @@ void brcmf_sdio_remove(struct brcmf_sdio *bus)
 
 		brcmf_detach(bus->sdiodev->dev);
 
+		hrtimer_cancel(&bus->txglom_timer);
 		cancel_work_sync(&bus->datawork);
 		if (bus->brcmf_wq)
 			destroy_workqueue(bus->brcmf_wq);
@@ -195,6 +195,8 @@ struct brcmf_sdio_dev {
 	ushort max_segment_count;
 	uint max_segment_size;
 	uint txglomsz;
+	uint cmd53_sg;		/* Count of sg CMD53 requests */
+	ulong cmd53_sg_bytes;	/* Bytes moved by them */
 	struct sg_table sgtable;
 	char fw_name[BRCMF_FW_NAME_LEN];
 	char nvram_name[BRCMF_FW_NAME_LEN];
@@ -23,6 +23,7 @@
 #include <linux/console.h>
 #include <linux/ctype.h>
 #include <linux/cpu.h>
+#include <linux/log2.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
@@ -199,6 +200,46 @@ int __of_attach_node_sysfs(struct device_node *np)
 	return 0;
 }
 
+/*
+ * Cache of of_find_node_by_phandle(), indexed by the low bits of the
+ * phandle.  An entry is only a hint checked against the phandle of the node,
+ * a miss falls back to walking all the nodes.  Nodes are dropped from the
+ * cache when they are detached, so the cache never points to a freed node.
+ * Protected by devtree_lock.
+ */
+static struct device_node **phandle_cache;
+static u32 phandle_cache_mask;
+
+/* Called with devtree_lock held */
+void __of_phandle_cache_remove(struct device_node *np)
+{
+	if (phandle_cache && np->phandle &&
+	    phandle_cache[np->phandle & phandle_cache_mask] == np)
+		phandle_cache[np->phandle & phandle_cache_mask] = NULL;
+}
+
+static void __init of_phandle_cache_init(void)
+{
+	struct device_node *np, **cache;
+	unsigned long flags;
+	u32 count = 0, size;
+
+	for_each_of_allnodes(np)
+		if (np->phandle)
+			count++;
+
+	/* Leave room for the phandles of overlays */
+	size = roundup_pow_of_two(max(2 * count, 64U));
+	cache = kcalloc(size, sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return;
+
+	raw_spin_lock_irqsave(&devtree_lock, flags);
+	phandle_cache = cache;
+	phandle_cache_mask = size - 1;
+	raw_spin_unlock_irqrestore(&devtree_lock, flags);
+}
+
 void __init of_core_init(void)
 {
 	struct device_node *np;
@@ -215,6 +256,8 @@ void __init of_core_init(void)
 		__of_attach_node_sysfs(np);
 	mutex_unlock(&of_mutex);
 
+	of_phandle_cache_init();
+
 	/* Symlink in /proc as required by userspace ABI */
 	if (of_root)
 		proc_symlink("device-tree", NULL, "/sys/firmware/devicetree/base");
@@ -1104,9 +1147,18 @@ struct device_node *of_find_node_by_phandle(phandle handle)
 		return NULL;
 
 	raw_spin_lock_irqsave(&devtree_lock, flags);
+	if (phandle_cache) {
+		np = phandle_cache[handle & phandle_cache_mask];
+		if (np && np->phandle == handle)
+			goto out;
+	}
+
 	for_each_of_allnodes(np)
 		if (np->phandle == handle)
 			break;
+	if (np && phandle_cache)
+		phandle_cache[handle & phandle_cache_mask] = np;
+out:
 	of_node_get(np);
 	raw_spin_unlock_irqrestore(&devtree_lock, flags);
 	return np;
@@ -284,6 +284,7 @@ void __of_detach_node(struct device_node *np)
 	}
 
 	of_node_set_flag(np, OF_DETACHED);
+	__of_phandle_cache_remove(np);
 }
 
 /**
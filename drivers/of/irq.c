@@ -22,6 +22,7 @@
 
 #include <linux/device.h>
 #include <linux/errno.h>
+#include <linux/interrupt.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/of.h>
@@ -393,6 +394,45 @@ int of_irq_to_resource(struct device_node *dev, int index, struct resource *r)
 }
 EXPORT_SYMBOL_GPL(of_irq_to_resource);
 
+/*
+ * Apply the handling policy a consumer node can give its interrupts:
+ * "interrupt-affinity" holds one CPU phandle per interrupt, as for the
+ * PMUs, and routes it to that CPU. "irq-thread-priority" holds the
+ * SCHED_FIFO priority of the threaded handler, one cell per interrupt or
+ * a single cell for all of them.
+ */
+static void of_irq_apply_policy(struct device_node *dev, int index,
+				unsigned int irq)
+{
+	struct device_node *cpu_np, *np;
+	int count, cpu;
+	u32 prio;
+
+	count = of_property_count_u32_elems(dev, "irq-thread-priority");
+	if (count == 1)
+		index = 0;
+	if (count > 0 && !of_property_read_u32_index(dev, "irq-thread-priority",
+						     index, &prio))
+		irq_set_thread_priority(irq, prio);
+
+	if (irq_is_percpu(irq))
+		return;
+
+	cpu_np = of_parse_phandle(dev, "interrupt-affinity", index);
+	if (!cpu_np)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		np = of_get_cpu_node(cpu, NULL);
+		of_node_put(np);
+		if (np == cpu_np) {
+			irq_set_affinity(irq, cpumask_of(cpu));
+			break;
+		}
+	}
+	of_node_put(cpu_np);
+}
+
 /**
  * of_irq_get - Decode a node's IRQ and return it as a Linux IRQ number
  * @dev: pointer to device tree node
@@ -416,7 +456,11 @@ int of_irq_get(struct device_node *dev, int index)
 	if (!domain)
 		return -EPROBE_DEFER;
 
-	return irq_create_of_mapping(&oirq);
+	rc = irq_create_of_mapping(&oirq);
+	if (rc > 0)
+		of_irq_apply_policy(dev, index, rc);
+
+	return rc;
 }
 EXPORT_SYMBOL_GPL(of_irq_get);
 
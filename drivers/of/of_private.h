@@ -93,6 +93,7 @@ extern void __of_update_property_sysfs(struct device_node *np,
 extern void __of_attach_node(struct device_node *np);
 extern int __of_attach_node_sysfs(struct device_node *np);
 extern void __of_detach_node(struct device_node *np);
+extern void __of_phandle_cache_remove(struct device_node *np);
 extern void __of_detach_node_sysfs(struct device_node *np);
 
 extern void __of_sysfs_remove_bin_file(struct device_node *np,
@@ -0,0 +1,518 @@
+/*
+ * Driver for the Xilinx AXI Performance Monitor
+ *
+ * The AXI Performance Monitor (APM) is soft IP in the programmable logic
+ * that snoops up to eight AXI interfaces, its "slots", for example the HP
+ * ports between PL masters and the DDR controller. Each of its metric
+ * counters counts one metric, such as read bytes or total read latency,
+ * on one slot. Every counter is exposed as a perf event counter, so perf
+ * can tell the DDR traffic of each PL master apart from that of the CPUs:
+ *
+ *   perf stat -a -e axi_apm_43c00000/rd_bytes,slot=0/ ...
+ *
+ * The metric counters are 32 bits wide and wrap. The overflow interrupt
+ * is often not wired up, so the counters are polled from an hrtimer
+ * instead, often enough that none can wrap twice between two reads.
+ *
+ * Only the advanced mode of the core, which has the metric counters, and
+ * its first ten counters, which sit at regularly spaced offsets, are
+ * supported.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/bitops.h>
+#include <linux/clk.h>
+#include <linux/cpuhotplug.h>
+#include <linux/hrtimer.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/of.h>
+#include <linux/perf_event.h>
+#include <linux/platform_device.h>
+
+#define APM_MSR(n)		(0x044 + ((n) / 4) * 4)	/* Metric Selector */
+#define APM_MSR_SHIFT(n)	(((n) % 4) * 8)
+#define APM_MC(n)		(0x100 + (n) * 0x10)	/* Metric Counter */
+#define APM_CR			0x300			/* Control */
+#define APM_CR_MCNTR_ENABLE	BIT(0)
+#define APM_CR_MCNTR_RESET	BIT(1)
+
+#define APM_MAX_COUNTERS	10
+#define APM_MAX_SLOTS		8
+
+/*
+ * perf_event_attr.config is written to a counter's metric selector byte
+ * as is: the metric in bits 0-4 and the slot in bits 5-7.
+ */
+#define APM_CONFIG_METRIC(c)	((c) & 0x1f)
+#define APM_CONFIG_SLOT(c)	(((c) >> 5) & 0x7)
+#define APM_CONFIG_MASK		0xff
+
+/*
+ * Metrics 0x0-0xb count up. The ones after those hold minima or maxima,
+ * or only exist in other modes of the core, and cannot be accumulated.
+ */
+#define APM_METRIC_MAX		0xb
+
+/* At 1.2 GB/s, the peak of an HP port, a byte counter wraps in 3.5 s */
+#define APM_POLL_PERIOD_MS	500
+
+struct apm_pmu {
+	struct pmu pmu;
+	void __iomem *base;
+	struct hlist_node node;
+	cpumask_t cpu;
+
+	unsigned int num_counters;
+	unsigned int num_slots;
+	struct perf_event *events[APM_MAX_COUNTERS];
+
+	struct hrtimer hrtimer;
+};
+
+#define to_apm_pmu(p)	container_of((p), struct apm_pmu, pmu)
+
+static unsigned int apm_pmu_num_active_counters(struct apm_pmu *apm)
+{
+	unsigned int i, cnt = 0;
+
+	for (i = 0; i < apm->num_counters; i++)
+		if (apm->events[i])
+			cnt++;
+
+	return cnt;
+}
+
+static void apm_pmu_select(struct apm_pmu *apm, int idx, u32 config)
+{
+	u32 val = readl_relaxed(apm->base + APM_MSR(idx));
+
+	val &= ~(APM_CONFIG_MASK << APM_MSR_SHIFT(idx));
+	val |= config << APM_MSR_SHIFT(idx);
+	writel_relaxed(val, apm->base + APM_MSR(idx));
+}
+
+static void apm_pmu_counters_enable(struct apm_pmu *apm, bool enable)
+{
+	writel_relaxed(enable ? APM_CR_MCNTR_ENABLE : 0, apm->base + APM_CR);
+}
+
+static void apm_pmu_event_read(struct perf_event *event)
+{
+	struct apm_pmu *apm = to_apm_pmu(event->pmu);
+	struct hw_perf_event *hw = &event->hw;
+	u64 prev_count, new_count;
+
+	do {
+		prev_count = local64_read(&hw->prev_count);
+		new_count = readl_relaxed(apm->base + APM_MC(hw->idx));
+	} while (local64_xchg(&hw->prev_count, new_count) != prev_count);
+
+	local64_add((new_count - prev_count) & GENMASK_ULL(31, 0),
+		    &event->count);
+}
+
+static enum hrtimer_restart apm_pmu_poll(struct hrtimer *hrtimer)
+{
+	struct apm_pmu *apm = container_of(hrtimer, struct apm_pmu, hrtimer);
+	unsigned long flags;
+	unsigned int i;
+
+	local_irq_save(flags);
+	for (i = 0; i < apm->num_counters; i++) {
+		struct perf_event *event = apm->events[i];
+
+		if (event && !(event->hw.state & PERF_HES_STOPPED))
+			apm_pmu_event_read(event);
+	}
+	local_irq_restore(flags);
+
+	hrtimer_forward_now(hrtimer, ms_to_ktime(APM_POLL_PERIOD_MS));
+	return HRTIMER_RESTART;
+}
+
+/*
+ * The counters cannot be started and stopped one by one, they all run
+ * while any is in use. A stopped event just stops taking their deltas.
+ */
+static void apm_pmu_event_start(struct perf_event *event, int flags)
+{
+	struct apm_pmu *apm = to_apm_pmu(event->pmu);
+	struct hw_perf_event *hw = &event->hw;
+
+	if (WARN_ON_ONCE(!(hw->state & PERF_HES_STOPPED)))
+		return;
+
+	if (flags & PERF_EF_RELOAD)
+		WARN_ON_ONCE(!(hw->state & PERF_HES_UPTODATE));
+
+	local64_set(&hw->prev_count,
+		    readl_relaxed(apm->base + APM_MC(hw->idx)));
+	hw->state = 0;
+}
+
+static void apm_pmu_event_stop(struct perf_event *event, int flags)
+{
+	struct hw_perf_event *hw = &event->hw;
+
+	if (hw->state & PERF_HES_STOPPED)
+		return;
+
+	apm_pmu_event_read(event);
+	hw->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int apm_pmu_event_add(struct perf_event *event, int flags)
+{
+	struct apm_pmu *apm = to_apm_pmu(event->pmu);
+	struct hw_perf_event *hw = &event->hw;
+	unsigned int idx;
+
+	for (idx = 0; idx < apm->num_counters; idx++)
+		if (!apm->events[idx])
+			break;
+
+	if (idx == apm->num_counters)
+		return -EAGAIN;
+
+	/*
+	 * Pin the timer, so that the counters are polled by the chosen
+	 * event->cpu (this is the same one as presented in "cpumask"
+	 * attribute).
+	 */
+	if (apm_pmu_num_active_counters(apm) == 0) {
+		apm_pmu_counters_enable(apm, true);
+		hrtimer_start(&apm->hrtimer, ms_to_ktime(APM_POLL_PERIOD_MS),
+			      HRTIMER_MODE_REL_PINNED);
+	}
+
+	apm->events[idx] = event;
+	hw->idx = idx;
+	apm_pmu_select(apm, idx, hw->config_base);
+
+	hw->state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (flags & PERF_EF_START)
+		apm_pmu_event_start(event, 0);
+
+	return 0;
+}
+
+static void apm_pmu_event_del(struct perf_event *event, int flags)
+{
+	struct apm_pmu *apm = to_apm_pmu(event->pmu);
+	struct hw_perf_event *hw = &event->hw;
+
+	apm_pmu_event_stop(event, PERF_EF_UPDATE);
+
+	apm->events[hw->idx] = NULL;
+	hw->idx = -1;
+
+	if (apm_pmu_num_active_counters(apm) == 0) {
+		hrtimer_cancel(&apm->hrtimer);
+		apm_pmu_counters_enable(apm, false);
+	}
+}
+
+static bool apm_pmu_group_is_valid(struct perf_event *event)
+{
+	struct apm_pmu *apm = to_apm_pmu(event->pmu);
+	struct perf_event *leader = event->group_leader;
+	struct perf_event *sibling;
+	unsigned int num_hw = 0;
+
+	if (leader->pmu == event->pmu)
+		num_hw++;
+	else if (!is_software_event(leader))
+		return false;
+
+	list_for_each_entry(sibling, &leader->sibling_list, group_entry) {
+		if (sibling->pmu == event->pmu)
+			num_hw++;
+		else if (!is_software_event(sibling))
+			return false;
+	}
+
+	return num_hw <= apm->num_counters;
+}
+
+static int apm_pmu_event_init(struct perf_event *event)
+{
+	struct apm_pmu *apm = to_apm_pmu(event->pmu);
+	struct hw_perf_event *hw = &event->hw;
+	u64 config = event->attr.config;
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	if (is_sampling_event(event) ||
+	    event->attach_state & PERF_ATTACH_TASK)
+		return -EINVAL;
+
+	if (event->attr.exclude_user   ||
+	    event->attr.exclude_kernel ||
+	    event->attr.exclude_hv     ||
+	    event->attr.exclude_idle   ||
+	    event->attr.exclude_host   ||
+	    event->attr.exclude_guest)
+		return -EINVAL;
+
+	if (event->cpu < 0)
+		return -EINVAL;
+
+	if (config & ~APM_CONFIG_MASK ||
+	    APM_CONFIG_METRIC(config) > APM_METRIC_MAX ||
+	    APM_CONFIG_SLOT(config) >= apm->num_slots)
+		return -EINVAL;
+
+	hw->config_base = config;
+
+	if (!apm_pmu_group_is_valid(event))
+		return -EINVAL;
+
+	event->cpu = cpumask_first(&apm->cpu);
+
+	return 0;
+}
+
+PMU_FORMAT_ATTR(metric,	"config:0-4");
+PMU_FORMAT_ATTR(slot,	"config:5-7");
+
+static struct attribute *apm_pmu_format_attrs[] = {
+	&format_attr_metric.attr,
+	&format_attr_slot.attr,
+	NULL,
+};
+
+static struct attribute_group apm_pmu_format_attr_group = {
+	.name = "format",
+	.attrs = apm_pmu_format_attrs,
+};
+
+#define APM_EVENT_ATTR(_name, _metric)					\
+	PMU_EVENT_ATTR_STRING(_name, apm_event_attr_##_name,		\
+			      "metric=" __stringify(_metric))
+
+APM_EVENT_ATTR(wr_trans,	0x0);
+APM_EVENT_ATTR(rd_trans,	0x1);
+APM_EVENT_ATTR(wr_bytes,	0x2);
+APM_EVENT_ATTR(rd_bytes,	0x3);
+APM_EVENT_ATTR(wr_beats,	0x4);
+APM_EVENT_ATTR(rd_latency,	0x5);
+APM_EVENT_ATTR(wr_latency,	0x6);
+APM_EVENT_ATTR(slv_wr_idle,	0x7);
+APM_EVENT_ATTR(mst_rd_idle,	0x8);
+APM_EVENT_ATTR(bvalids,		0x9);
+APM_EVENT_ATTR(wlasts,		0xa);
+APM_EVENT_ATTR(rlasts,		0xb);
+
+static struct attribute *apm_pmu_event_attrs[] = {
+	&apm_event_attr_wr_trans.attr.attr,
+	&apm_event_attr_rd_trans.attr.attr,
+	&apm_event_attr_wr_bytes.attr.attr,
+	&apm_event_attr_rd_bytes.attr.attr,
+	&apm_event_attr_wr_beats.attr.attr,
+	&apm_event_attr_rd_latency.attr.attr,
+	&apm_event_attr_wr_latency.attr.attr,
+	&apm_event_attr_slv_wr_idle.attr.attr,
+	&apm_event_attr_mst_rd_idle.attr.attr,
+	&apm_event_attr_bvalids.attr.attr,
+	&apm_event_attr_wlasts.attr.attr,
+	&apm_event_attr_rlasts.attr.attr,
+	NULL,
+};
+
+static struct attribute_group apm_pmu_event_attr_group = {
+	.name = "events",
+	.attrs = apm_pmu_event_attrs,
+};
+
+static ssize_t apm_pmu_cpumask_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct apm_pmu *apm = to_apm_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, &apm->cpu);
+}
+
+static struct device_attribute apm_pmu_cpumask_attr =
+		__ATTR(cpumask, S_IRUGO, apm_pmu_cpumask_show, NULL);
+
+static struct attribute *apm_pmu_cpumask_attrs[] = {
+	&apm_pmu_cpumask_attr.attr,
+	NULL,
+};
+
+static struct attribute_group apm_pmu_cpumask_attr_group = {
+	.attrs = apm_pmu_cpumask_attrs,
+};
+
+static const struct attribute_group *apm_pmu_attr_groups[] = {
+	&apm_pmu_format_attr_group,
+	&apm_pmu_event_attr_group,
+	&apm_pmu_cpumask_attr_group,
+	NULL,
+};
+
+static int apm_pmu_online_cpu(unsigned int cpu, struct hlist_node *node)
+{
+	struct apm_pmu *apm = hlist_entry_safe(node, struct apm_pmu, node);
+
+	/* If there is not a CPU/PMU association pick this CPU */
+	if (cpumask_empty(&apm->cpu))
+		cpumask_set_cpu(cpu, &apm->cpu);
+
+	return 0;
+}
+
+static int apm_pmu_offline_cpu(unsigned int cpu, struct hlist_node *node)
+{
+	struct apm_pmu *apm = hlist_entry_safe(node, struct apm_pmu, node);
+	unsigned int target;
+
+	if (!cpumask_test_and_clear_cpu(cpu, &apm->cpu))
+		return 0;
+
+	target = cpumask_any_but(cpu_online_mask, cpu);
+	if (target >= nr_cpu_ids)
+		return 0;
+
+	perf_pmu_migrate_context(&apm->pmu, cpu, target);
+	cpumask_set_cpu(target, &apm->cpu);
+
+	return 0;
+}
+
+static int apm_pmu_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct device_node *np = dev->of_node;
+	struct apm_pmu *apm;
+	struct resource *res;
+	struct clk *clk;
+	u32 val;
+	char *name;
+	int ret;
+
+	if (!of_property_read_bool(np, "xlnx,enable-advanced")) {
+		dev_err(dev, "only the advanced mode is supported\n");
+		return -ENODEV;
+	}
+
+	apm = devm_kzalloc(dev, sizeof(*apm), GFP_KERNEL);
+	if (!apm)
+		return -ENOMEM;
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	apm->base = devm_ioremap_resource(dev, res);
+	if (IS_ERR(apm->base))
+		return PTR_ERR(apm->base);
+
+	name = devm_kasprintf(dev, GFP_KERNEL, "axi_apm_%llx",
+			      (unsigned long long)res->start);
+	if (!name)
+		return -ENOMEM;
+
+	ret = of_property_read_u32(np, "xlnx,num-of-counters", &val);
+	if (ret || val == 0) {
+		dev_err(dev, "missing xlnx,num-of-counters\n");
+		return -EINVAL;
+	}
+	apm->num_counters = min_t(u32, val, APM_MAX_COUNTERS);
+
+	if (of_property_read_u32(np, "xlnx,num-monitor-slots", &val) ||
+	    val == 0)
+		val = 1;
+	apm->num_slots = min_t(u32, val, APM_MAX_SLOTS);
+
+	/* The AXI-Lite clock must run for the registers to respond */
+	clk = devm_clk_get(dev, "s_axi_aclk");
+	if (IS_ERR(clk)) {
+		ret = PTR_ERR(clk);
+		if (ret != -ENOENT)
+			return ret;
+	} else {
+		ret = clk_prepare_enable(clk);
+		if (ret)
+			return ret;
+	}
+
+	apm_pmu_counters_enable(apm, false);
+
+	hrtimer_init(&apm->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	apm->hrtimer.function = apm_pmu_poll;
+
+	apm->pmu = (struct pmu) {
+		.task_ctx_nr	= perf_invalid_context,
+
+		.event_init	= apm_pmu_event_init,
+		.add		= apm_pmu_event_add,
+		.del		= apm_pmu_event_del,
+		.start		= apm_pmu_event_start,
+		.stop		= apm_pmu_event_stop,
+		.read		= apm_pmu_event_read,
+
+		.attr_groups	= apm_pmu_attr_groups,
+	};
+
+	/* Add this instance to the list used by the offline callback */
+	ret = cpuhp_state_add_instance(CPUHP_AP_PERF_XILINX_APM_ONLINE,
+				       &apm->node);
+	if (ret) {
+		dev_err(dev, "Error %d registering hotplug\n", ret);
+		goto out_clk;
+	}
+
+	ret = perf_pmu_register(&apm->pmu, name, -1);
+	if (ret) {
+		dev_err(dev, "Failed to register PMU (%d)\n", ret);
+		goto out_cpuhp;
+	}
+
+	dev_info(dev, "Registered %s, %u counters, %u slots\n",
+		 name, apm->num_counters, apm->num_slots);
+
+	return 0;
+
+out_cpuhp:
+	cpuhp_state_remove_instance_nocalls(CPUHP_AP_PERF_XILINX_APM_ONLINE,
+					    &apm->node);
+out_clk:
+	if (!IS_ERR(clk))
+		clk_disable_unprepare(clk);
+	return ret;
+}
+
+static const struct of_device_id apm_pmu_of_match[] = {
+	{ .compatible = "xlnx,axi-perf-monitor", },
+	{ }
+};
+
+static struct platform_driver apm_pmu_driver = {
+	.driver = {
+		.name = "xilinx-apm-pmu",
+		.of_match_table = apm_pmu_of_match,
+		.suppress_bind_attrs = true,
+	},
+	.probe = apm_pmu_probe,
+};
+
+static int __init register_apm_pmu_driver(void)
+{
+	int ret;
+
+	/* Install a hook to update the reader CPU in case it goes offline */
+	ret = cpuhp_setup_state_multi(CPUHP_AP_PERF_XILINX_APM_ONLINE,
+				      "perf/xilinx/apm:online",
+				      apm_pmu_online_cpu,
+				      apm_pmu_offline_cpu);
+	if (ret)
+		return ret;
+
+	return platform_driver_register(&apm_pmu_driver);
+}
+device_initcall(register_apm_pmu_driver);
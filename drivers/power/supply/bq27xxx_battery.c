@@ -54,6 +54,7 @@
 #include <linux/power_supply.h>
 #include <linux/slab.h>
 #include <linux/of.h>
+#include <asm/unaligned.h>
 
 #include <linux/power/bq27xxx_battery.h>
 
@@ -787,6 +788,11 @@ module_param_cb(poll_interval, &param_ops_poll_interval, &poll_interval, 0644);
 MODULE_PARM_DESC(poll_interval,
 		 "battery poll interval in seconds - 0 disables polling");
 
+static unsigned int irq_cache_time = 30;
+module_param(irq_cache_time, uint, 0644);
+MODULE_PARM_DESC(irq_cache_time,
+		 "seconds property reads are served from the cache on gauges with an interrupt");
+
 /*
  * Common code for BQ27xxx devices
  */
@@ -794,11 +800,78 @@ MODULE_PARM_DESC(poll_interval,
 static inline int bq27xxx_read(struct bq27xxx_device_info *di, int reg_index,
 			       bool single)
 {
+	u8 reg;
+	u64 mask;
+
 	/* Reports EINVAL for invalid/missing registers */
 	if (!di || di->regs[reg_index] == INVALID_REG_ADDR)
 		return -EINVAL;
 
-	return di->bus.read(di, di->regs[reg_index], single);
+	reg = di->regs[reg_index];
+
+	/* Served from the burst read of the current update, if it has it */
+	if (reg < BQ27XXX_SNAPSHOT_SIZE - 1) {
+		mask = (single ? 1ULL : 3ULL) << reg;
+		if ((di->snapshot_valid & mask) == mask)
+			return single ? di->snapshot[reg] :
+			       get_unaligned_le16(&di->snapshot[reg]);
+	}
+
+	return di->bus.read(di, reg, single);
+}
+
+/* Registers read on every update, see bq27xxx_battery_update() */
+static const enum bq27xxx_reg_index bq27xxx_update_regs[] = {
+	BQ27XXX_REG_FLAGS,
+	BQ27XXX_REG_TEMP,
+	BQ27XXX_REG_TTE,
+	BQ27XXX_REG_TTECP,
+	BQ27XXX_REG_TTF,
+	BQ27XXX_REG_NAC,
+	BQ27XXX_REG_FCC,
+	BQ27XXX_REG_SOC,
+	BQ27XXX_REG_AE,
+	BQ27XXX_REG_CYCT,
+	BQ27XXX_REG_AP,
+	BQ27XXX_REG_VOLT,
+	BQ27XXX_REG_AI,
+};
+
+/*
+ * Read the registers needed by an update in as few bursts as possible,
+ * each burst covering the wanted registers within BQ27XXX_BULK_MAX bytes.
+ * Registers of a failed burst are read one by one later.
+ */
+static void bq27xxx_battery_prefetch(struct bq27xxx_device_info *di)
+{
+	u64 want = 0, valid = 0, mask;
+	int i, reg, start, end;
+
+	if (!di->bus.read_bulk)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(bq27xxx_update_regs); i++) {
+		reg = di->regs[bq27xxx_update_regs[i]];
+		if (reg < BQ27XXX_SNAPSHOT_SIZE - 1)
+			want |= 3ULL << reg;
+	}
+
+	while (want) {
+		start = __ffs64(want);
+		end = start;
+		for (reg = start; reg < start + BQ27XXX_BULK_MAX &&
+		     reg < BQ27XXX_SNAPSHOT_SIZE; reg++)
+			if (want & BIT_ULL(reg))
+				end = reg;
+
+		mask = GENMASK_ULL(end, start);
+		if (!di->bus.read_bulk(di, start, &di->snapshot[start],
+				       end - start + 1))
+			valid |= mask;
+		want &= ~mask;
+	}
+
+	di->snapshot_valid = valid;
 }
 
 /*
@@ -1075,6 +1148,9 @@ void bq27xxx_battery_update(struct bq27xxx_device_info *di)
 	bool has_ci_flag = di->chip == BQ27000 || di->chip == BQ27010;
 	bool has_singe_flag = di->chip == BQ27000 || di->chip == BQ27010;
 
+	mutex_lock(&di->update_lock);
+	bq27xxx_battery_prefetch(di);
+
 	cache.flags = bq27xxx_read(di, BQ27XXX_REG_FLAGS, has_singe_flag);
 	if ((cache.flags & 0xff) == 0xff)
 		cache.flags = -1; /* read error */
@@ -1106,12 +1182,18 @@ void bq27xxx_battery_update(struct bq27xxx_device_info *di)
 			cache.cycle_count = bq27xxx_battery_read_cyct(di);
 		if (di->regs[BQ27XXX_REG_AP] != INVALID_REG_ADDR)
 			cache.power_avg = bq27xxx_battery_read_pwr_avg(di);
+		cache.voltage = bq27xxx_read(di, BQ27XXX_REG_VOLT, false);
+		cache.current_now = bq27xxx_read(di, BQ27XXX_REG_AI, false);
+		cache.charge_now = bq27xxx_battery_read_nac(di);
 
 		/* We only have to read charge design full once */
 		if (di->charge_design_full <= 0)
 			di->charge_design_full = bq27xxx_battery_read_dcap(di);
 	}
 
+	di->snapshot_valid = 0;
+	mutex_unlock(&di->update_lock);
+
 	if (di->cache.capacity != cache.capacity)
 		power_supply_changed(di->bat);
 
@@ -1143,17 +1225,15 @@ static int bq27xxx_battery_current(struct bq27xxx_device_info *di,
 				   union power_supply_propval *val)
 {
 	int curr;
-	int flags;
 
-	curr = bq27xxx_read(di, BQ27XXX_REG_AI, false);
+	curr = di->cache.current_now;
 	if (curr < 0) {
 		dev_err(di->dev, "error reading current\n");
 		return curr;
 	}
 
 	if (di->chip == BQ27000 || di->chip == BQ27010) {
-		flags = bq27xxx_read(di, BQ27XXX_REG_FLAGS, true);
-		if (flags & BQ27000_FLAG_CHGS) {
+		if (di->cache.flags & BQ27000_FLAG_CHGS) {
 			dev_dbg(di->dev, "negative current!\n");
 			curr = -curr;
 		}
@@ -1234,7 +1314,7 @@ static int bq27xxx_battery_voltage(struct bq27xxx_device_info *di,
 {
 	int volt;
 
-	volt = bq27xxx_read(di, BQ27XXX_REG_VOLT, false);
+	volt = di->cache.voltage;
 	if (volt < 0) {
 		dev_err(di->dev, "error reading voltage\n");
 		return volt;
@@ -1262,9 +1342,19 @@ static int bq27xxx_battery_get_property(struct power_supply *psy,
 {
 	int ret = 0;
 	struct bq27xxx_device_info *di = power_supply_get_drvdata(psy);
+	unsigned long cache_time = 5 * HZ;
+
+	/*
+	 * With the interrupt, state of charge changes refresh the cache
+	 * themselves. Only voltage and current age, so keep them longer
+	 * instead of reading the gauge for every property.
+	 */
+	if (di->irq_updates)
+		cache_time = max_t(unsigned long, cache_time,
+				   irq_cache_time * HZ);
 
 	mutex_lock(&di->lock);
-	if (time_is_before_jiffies(di->last_update + 5 * HZ)) {
+	if (time_is_before_jiffies(di->last_update + cache_time)) {
 		cancel_delayed_work_sync(&di->work);
 		bq27xxx_battery_poll(&di->work.work);
 	}
@@ -1310,7 +1400,7 @@ static int bq27xxx_battery_get_property(struct power_supply *psy,
 		val->intval = POWER_SUPPLY_TECHNOLOGY_LION;
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_NOW:
-		ret = bq27xxx_simple_value(bq27xxx_battery_read_nac(di), val);
+		ret = bq27xxx_simple_value(di->cache.charge_now, val);
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_FULL:
 		ret = bq27xxx_simple_value(di->cache.charge_full, val);
@@ -1355,6 +1445,7 @@ int bq27xxx_battery_setup(struct bq27xxx_device_info *di)
 
 	INIT_DELAYED_WORK(&di->work, bq27xxx_battery_poll);
 	mutex_init(&di->lock);
+	mutex_init(&di->update_lock);
 	di->regs = bq27xxx_regs[di->chip];
 
 	psy_desc = devm_kzalloc(di->dev, sizeof(*psy_desc), GFP_KERNEL);
@@ -14,6 +14,7 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/gpio/consumer.h>
 #include <linux/i2c.h>
 #include <linux/interrupt.h>
 #include <linux/module.h>
@@ -68,14 +69,63 @@ static int bq27xxx_battery_i2c_read(struct bq27xxx_device_info *di, u8 reg,
 	return ret;
 }
 
+static int bq27xxx_battery_i2c_read_bulk(struct bq27xxx_device_info *di,
+					 u8 reg, u8 *data, int len)
+{
+	struct i2c_client *client = to_i2c_client(di->dev);
+	struct i2c_msg msg[2];
+	int ret;
+
+	if (!client->adapter)
+		return -ENODEV;
+
+	msg[0].addr = client->addr;
+	msg[0].flags = 0;
+	msg[0].buf = &reg;
+	msg[0].len = sizeof(reg);
+	msg[1].addr = client->addr;
+	msg[1].flags = I2C_M_RD;
+	msg[1].buf = data;
+	msg[1].len = len;
+
+	ret = i2c_transfer(client->adapter, msg, ARRAY_SIZE(msg));
+	if (ret < 0)
+		return ret;
+	if (ret != ARRAY_SIZE(msg))
+		return -EIO;
+
+	return 0;
+}
+
 static int bq27xxx_battery_i2c_probe(struct i2c_client *client,
 				     const struct i2c_device_id *id)
 {
 	struct bq27xxx_device_info *di;
+	struct gpio_desc *int_gpio;
+	unsigned long irqflags = IRQF_ONESHOT;
+	int irq = client->irq;
 	int ret;
 	char *name;
 	int num;
 
+	/*
+	 * Without an interrupt in the firmware description, the GPOUT pin
+	 * may be wired to a GPIO. The gauge pulses it low when the state of
+	 * charge changes.
+	 */
+	if (!irq) {
+		int_gpio = devm_gpiod_get_optional(&client->dev, "int",
+						   GPIOD_IN);
+		if (IS_ERR(int_gpio))
+			return PTR_ERR(int_gpio);
+		if (int_gpio) {
+			irq = gpiod_to_irq(int_gpio);
+			if (irq < 0)
+				return irq;
+			irqflags |= IRQF_TRIGGER_FALLING;
+		}
+	}
+
 	/* Get new ID for the new battery device */
 	mutex_lock(&battery_mutex);
 	num = idr_alloc(&battery_id, client, 0, 0, GFP_KERNEL);
@@ -96,6 +146,7 @@ static int bq27xxx_battery_i2c_probe(struct i2c_client *client,
 	di->chip = id->driver_data;
 	di->name = name;
 	di->bus.read = bq27xxx_battery_i2c_read;
+	di->bus.read_bulk = bq27xxx_battery_i2c_read_bulk;
 
 	ret = bq27xxx_battery_setup(di);
 	if (ret)
@@ -106,17 +157,18 @@ static int bq27xxx_battery_i2c_probe(struct i2c_client *client,
 
 	i2c_set_clientdata(client, di);
 
-	if (client->irq) {
-		ret = devm_request_threaded_irq(&client->dev, client->irq,
+	if (irq) {
+		ret = devm_request_threaded_irq(&client->dev, irq,
 				NULL, bq27xxx_battery_irq_handler_thread,
-				IRQF_ONESHOT,
+				irqflags,
 				di->name, di);
 		if (ret) {
 			dev_err(&client->dev,
 				"Unable to register IRQ %d error %d\n",
-				client->irq, ret);
+				irq, ret);
 			return ret;
 		}
+		di->irq_updates = true;
 	}
 
 	return 0;
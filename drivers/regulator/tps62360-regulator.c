@@ -285,6 +285,63 @@ static int tps62360_init_dcdc(struct tps62360_chip *tps,
 	return ret;
 }
 
+/*
+ * Program the VSET registers that do not drive the output with preset
+ * voltages, typically those of the OPPs of the supplied CPU or fabric.
+ * The LRU lookup in set_voltage_sel then finds them, and switching
+ * between them only toggles the vsel gpios, with no I2C transfer in the
+ * frequency transition path. Registers without a known value are marked
+ * as such, so that a stale reset value is never taken for a match.
+ */
+static int tps62360_preset_vsets(struct tps62360_chip *tps,
+		struct tps62360_regulator_platform_data *pdata)
+{
+	unsigned int data;
+	int i, ret, sel, vset;
+	int n = 0;
+
+	for (i = 0; i < 4; ++i)
+		tps->curr_vset_vsel[i] = -1;
+
+	ret = regmap_read(tps->regmap, REG_VSET0 + tps->curr_vset_id, &data);
+	if (ret < 0) {
+		dev_err(tps->dev, "%s(): register %d read failed with err %d\n",
+			__func__, REG_VSET0 + tps->curr_vset_id, ret);
+		return ret;
+	}
+	tps->curr_vset_vsel[tps->curr_vset_id] = data & tps->voltage_reg_mask;
+
+	for (i = 0; i < pdata->num_dvs_presets; ++i) {
+		if (pdata->dvs_preset_uV[i] < tps->desc.min_uV)
+			goto err_range;
+		sel = DIV_ROUND_UP(pdata->dvs_preset_uV[i] - tps->desc.min_uV,
+				   tps->desc.uV_step);
+		if (sel >= tps->desc.n_voltages)
+			goto err_range;
+		if (sel == tps->curr_vset_vsel[tps->curr_vset_id])
+			continue;
+
+		/* lru_index[0] is the register driving the output */
+		vset = tps->lru_index[++n];
+		ret = regmap_update_bits(tps->regmap, REG_VSET0 + vset,
+				tps->voltage_reg_mask, sel);
+		if (ret < 0) {
+			dev_err(tps->dev,
+				"%s(): register %d update failed with err %d\n",
+				__func__, REG_VSET0 + vset, ret);
+			return ret;
+		}
+		tps->curr_vset_vsel[vset] = sel;
+	}
+
+	return 0;
+
+err_range:
+	dev_err(tps->dev, "%s(): preset %u uV is out of range\n",
+		__func__, pdata->dvs_preset_uV[i]);
+	return -EINVAL;
+}
+
 static const struct regmap_config tps62360_regmap_config = {
 	.reg_bits		= 8,
 	.val_bits		= 8,
@@ -298,6 +355,7 @@ static struct tps62360_regulator_platform_data *
 {
 	struct tps62360_regulator_platform_data *pdata;
 	struct device_node *np = dev->of_node;
+	int ret;
 
 	pdata = devm_kzalloc(dev, sizeof(*pdata), GFP_KERNEL);
 	if (!pdata)
@@ -325,6 +383,15 @@ static struct tps62360_regulator_platform_data *
 	if (of_find_property(np, "ti,enable-vout-discharge", NULL))
 		pdata->en_discharge = true;
 
+	ret = of_property_count_u32_elems(np, "ti,dvs-preset-microvolt");
+	if (ret > 0) {
+		pdata->num_dvs_presets = min_t(int, ret,
+					ARRAY_SIZE(pdata->dvs_preset_uV));
+		of_property_read_u32_array(np, "ti,dvs-preset-microvolt",
+					   pdata->dvs_preset_uV,
+					   pdata->num_dvs_presets);
+	}
+
 	return pdata;
 }
 
@@ -468,6 +535,12 @@ static int tps62360_probe(struct i2c_client *client,
 		return ret;
 	}
 
+	if (tps->valid_gpios) {
+		ret = tps62360_preset_vsets(tps, pdata);
+		if (ret < 0)
+			return ret;
+	}
+
 	config.dev = &client->dev;
 	config.init_data = pdata->reg_init_data;
 	config.driver_data = tps;
@@ -15,6 +15,7 @@
  * GNU General Public License for more details.
  */
 
+#include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/io.h>
 #include <linux/init.h>
@@ -25,6 +26,13 @@
 #include <linux/regmap.h>
 #include <linux/types.h>
 
+/*
+ * How long reset() holds a reset. The PL resets in FPGA_RST_CTRL are
+ * sampled by logic running from FCLK, so this has to cover a few cycles
+ * of the slowest FCLK a design would plausibly use.
+ */
+#define ZYNQ_RESET_PULSE_US	1
+
 struct zynq_reset_data {
 	struct regmap *slcr;
 	struct reset_controller_dev rcdev;
@@ -88,7 +96,22 @@ static int zynq_reset_status(struct reset_controller_dev *rcdev,
 	return !!(reg & BIT(offset));
 }
 
+static int zynq_reset_reset(struct reset_controller_dev *rcdev,
+			    unsigned long id)
+{
+	int ret;
+
+	ret = zynq_reset_assert(rcdev, id);
+	if (ret)
+		return ret;
+
+	udelay(ZYNQ_RESET_PULSE_US);
+
+	return zynq_reset_deassert(rcdev, id);
+}
+
 static const struct reset_control_ops zynq_reset_ops = {
+	.reset		= zynq_reset_reset,
 	.assert		= zynq_reset_assert,
 	.deassert	= zynq_reset_deassert,
 	.status		= zynq_reset_status,
@@ -16,6 +16,7 @@
 #include <linux/gpio.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of_irq.h>
 #include <linux/of_address.h>
@@ -102,12 +103,29 @@
 /* Default number of chip select lines */
 #define CDNS_SPI_DEFAULT_NUM_CS		4
 
+/*
+ * Short transfers are completed by polling, as long as they are expected to
+ * be done within the busy-wait budget.  This saves the interrupt and the
+ * wakeup of the message pump for e.g. small sensor reads.
+ */
+static unsigned int poll_max_bytes = 32;
+module_param(poll_max_bytes, uint, 0644);
+MODULE_PARM_DESC(poll_max_bytes,
+		 "Poll for transfers up to this many bytes (0 disables polling)");
+
+static unsigned int poll_budget_us = 100;
+module_param(poll_budget_us, uint, 0644);
+MODULE_PARM_DESC(poll_budget_us,
+		 "Longest busy-wait for a polled transfer in microseconds");
+
 /**
  * struct cdns_spi - This definition defines spi driver instance
  * @regs:		Virtual address of the SPI controller registers
  * @ref_clk:		Pointer to the peripheral clock
  * @pclk:		Pointer to the APB clock
  * @speed_hz:		Current SPI bus clock speed in Hz
+ * @req_speed_hz:	Clock speed requested for @speed_hz
+ * @ctrl_reg:		Shadow of the configuration register
  * @txbuf:		Pointer	to the TX buffer
  * @rxbuf:		Pointer to the RX buffer
  * @tx_bytes:		Number of bytes left to transfer
@@ -120,6 +138,8 @@ struct cdns_spi {
 	struct clk *ref_clk;
 	struct clk *pclk;
 	u32 speed_hz;
+	u32 req_speed_hz;
+	u32 ctrl_reg;
 	const u8 *txbuf;
 	u8 *rxbuf;
 	int tx_bytes;
@@ -171,6 +191,21 @@ static void cdns_spi_init_hw(struct cdns_spi *xspi)
 	cdns_spi_write(xspi, CDNS_SPI_ISR, CDNS_SPI_IXR_ALL);
 	cdns_spi_write(xspi, CDNS_SPI_CR, ctrl_reg);
 	cdns_spi_write(xspi, CDNS_SPI_ER, CDNS_SPI_ER_ENABLE);
+	xspi->ctrl_reg = ctrl_reg;
+}
+
+/*
+ * Back-to-back messages to the same device usually share the mode, clock
+ * and chip select, so the configuration register is only written when it
+ * changes.  The shadow saves reading it back before each update.
+ */
+static void cdns_spi_write_cr(struct cdns_spi *xspi, u32 ctrl_reg)
+{
+	if (ctrl_reg == xspi->ctrl_reg)
+		return;
+
+	cdns_spi_write(xspi, CDNS_SPI_CR, ctrl_reg);
+	xspi->ctrl_reg = ctrl_reg;
 }
 
 /**
@@ -181,9 +216,7 @@ static void cdns_spi_init_hw(struct cdns_spi *xspi)
 static void cdns_spi_chipselect(struct spi_device *spi, bool is_high)
 {
 	struct cdns_spi *xspi = spi_master_get_devdata(spi->master);
-	u32 ctrl_reg;
-
-	ctrl_reg = cdns_spi_read(xspi, CDNS_SPI_CR);
+	u32 ctrl_reg = xspi->ctrl_reg;
 
 	if (is_high) {
 		/* Deselect the slave */
@@ -200,7 +233,7 @@ static void cdns_spi_chipselect(struct spi_device *spi, bool is_high)
 				     CDNS_SPI_CR_SSCTRL;
 	}
 
-	cdns_spi_write(xspi, CDNS_SPI_CR, ctrl_reg);
+	cdns_spi_write_cr(xspi, ctrl_reg);
 }
 
 /**
@@ -214,7 +247,7 @@ static void cdns_spi_config_clock_mode(struct spi_device *spi)
 	struct cdns_spi *xspi = spi_master_get_devdata(spi->master);
 	u32 ctrl_reg, new_ctrl_reg;
 
-	new_ctrl_reg = cdns_spi_read(xspi, CDNS_SPI_CR);
+	new_ctrl_reg = xspi->ctrl_reg;
 	ctrl_reg = new_ctrl_reg;
 
 	/* Set the SPI clock phase and clock polarity */
@@ -232,7 +265,7 @@ static void cdns_spi_config_clock_mode(struct spi_device *spi)
 		 * transitions. To workaround the issue toggle the ER register.
 		 */
 		cdns_spi_write(xspi, CDNS_SPI_ER, CDNS_SPI_ER_DISABLE);
-		cdns_spi_write(xspi, CDNS_SPI_CR, new_ctrl_reg);
+		cdns_spi_write_cr(xspi, new_ctrl_reg);
 		cdns_spi_write(xspi, CDNS_SPI_ER, CDNS_SPI_ER_ENABLE);
 	}
 }
@@ -258,9 +291,13 @@ static void cdns_spi_config_clock_freq(struct spi_device *spi,
 	u32 ctrl_reg, baud_rate_val;
 	unsigned long frequency;
 
+	/* The divisor only needs working out when the request changes */
+	if (xspi->req_speed_hz == transfer->speed_hz)
+		return;
+
 	frequency = clk_get_rate(xspi->ref_clk);
 
-	ctrl_reg = cdns_spi_read(xspi, CDNS_SPI_CR);
+	ctrl_reg = xspi->ctrl_reg;
 
 	/* Set the clock frequency */
 	if (xspi->speed_hz != transfer->speed_hz) {
@@ -275,7 +312,8 @@ static void cdns_spi_config_clock_freq(struct spi_device *spi,
 
 		xspi->speed_hz = frequency / (2 << baud_rate_val);
 	}
-	cdns_spi_write(xspi, CDNS_SPI_CR, ctrl_reg);
+	xspi->req_speed_hz = transfer->speed_hz;
+	cdns_spi_write_cr(xspi, ctrl_reg);
 }
 
 /**
@@ -306,20 +344,23 @@ static int cdns_spi_setup_transfer(struct spi_device *spi,
 /**
  * cdns_spi_fill_tx_fifo - Fills the TX FIFO with as many bytes as possible
  * @xspi:	Pointer to the cdns_spi structure
+ *
+ * The controller has no DMA request interface (on Zynq it is not wired to
+ * the PL330), so every FIFO worth of data goes through here and
+ * cdns_spi_irq().  Keep the per byte work down to the register access.
  */
 static void cdns_spi_fill_tx_fifo(struct cdns_spi *xspi)
 {
-	unsigned long trans_cnt = 0;
+	int trans_cnt = min(xspi->tx_bytes, CDNS_SPI_FIFO_DEPTH);
+
+	xspi->tx_bytes -= trans_cnt;
 
-	while ((trans_cnt < CDNS_SPI_FIFO_DEPTH) &&
-	       (xspi->tx_bytes > 0)) {
-		if (xspi->txbuf)
+	if (xspi->txbuf) {
+		while (trans_cnt--)
 			cdns_spi_write(xspi, CDNS_SPI_TXD, *xspi->txbuf++);
-		else
+	} else {
+		while (trans_cnt--)
 			cdns_spi_write(xspi, CDNS_SPI_TXD, 0);
-
-		xspi->tx_bytes--;
-		trans_cnt++;
 	}
 }
 
@@ -356,20 +397,19 @@ static irqreturn_t cdns_spi_irq(int irq, void *dev_id)
 		spi_finalize_current_transfer(master);
 		status = IRQ_HANDLED;
 	} else if (intr_status & CDNS_SPI_IXR_TXOW) {
-		unsigned long trans_cnt;
+		int trans_cnt;
 
 		trans_cnt = xspi->rx_bytes - xspi->tx_bytes;
+		xspi->rx_bytes -= trans_cnt;
 
 		/* Read out the data from the RX FIFO */
-		while (trans_cnt) {
-			u8 data;
-
-			data = cdns_spi_read(xspi, CDNS_SPI_RXD);
-			if (xspi->rxbuf)
-				*xspi->rxbuf++ = data;
-
-			xspi->rx_bytes--;
-			trans_cnt--;
+		if (xspi->rxbuf) {
+			while (trans_cnt--)
+				*xspi->rxbuf++ = cdns_spi_read(xspi,
+							       CDNS_SPI_RXD);
+		} else {
+			while (trans_cnt--)
+				cdns_spi_read(xspi, CDNS_SPI_RXD);
 		}
 
 		if (xspi->tx_bytes) {
@@ -387,6 +427,71 @@ static irqreturn_t cdns_spi_irq(int irq, void *dev_id)
 	return status;
 }
 
+/**
+ * cdns_spi_poll_transfer - Complete a short transfer without interrupts
+ * @xspi:	Pointer to the cdns_spi structure
+ *
+ * Drains the RX FIFO as the bytes come in.  If the budget runs out the
+ * remaining bytes are left to cdns_spi_irq().
+ *
+ * Return:	0 when done, -EIO on mode fault, -ETIMEDOUT when the budget ran out
+ */
+static int cdns_spi_poll_transfer(struct cdns_spi *xspi)
+{
+	ktime_t timeout = ktime_add_us(ktime_get(), poll_budget_us);
+	u32 intr_status;
+
+	while (xspi->rx_bytes) {
+		intr_status = cdns_spi_read(xspi, CDNS_SPI_ISR);
+
+		if (intr_status & CDNS_SPI_IXR_MODF) {
+			cdns_spi_write(xspi, CDNS_SPI_ISR, CDNS_SPI_IXR_MODF);
+			return -EIO;
+		}
+
+		if (intr_status & CDNS_SPI_IXR_RXNEMTY) {
+			u8 data = cdns_spi_read(xspi, CDNS_SPI_RXD);
+
+			if (xspi->rxbuf)
+				*xspi->rxbuf++ = data;
+			xspi->rx_bytes--;
+			continue;
+		}
+
+		if (ktime_after(ktime_get(), timeout))
+			return -ETIMEDOUT;
+
+		cpu_relax();
+	}
+
+	/* Drop the TX FIFO watermark status raised during the transfer */
+	cdns_spi_write(xspi, CDNS_SPI_ISR, CDNS_SPI_IXR_ALL);
+
+	return 0;
+}
+
+/**
+ * cdns_spi_can_poll - Check whether a transfer should be polled
+ * @xspi:	Pointer to the cdns_spi structure
+ * @transfer:	Pointer to the spi_transfer structure
+ *
+ * Return:	true if the transfer fits the FIFO and the busy-wait budget
+ */
+static bool cdns_spi_can_poll(struct cdns_spi *xspi,
+			      struct spi_transfer *transfer)
+{
+	u64 ns;
+
+	if (transfer->len > min_t(unsigned int, poll_max_bytes,
+				  CDNS_SPI_FIFO_DEPTH))
+		return false;
+
+	/* Expected time on the wire */
+	ns = div_u64((u64)transfer->len * 8 * NSEC_PER_SEC, xspi->speed_hz);
+
+	return ns <= (u64)poll_budget_us * NSEC_PER_USEC;
+}
+
 static int cdns_prepare_message(struct spi_master *master,
 				struct spi_message *msg)
 {
@@ -403,8 +508,10 @@ static int cdns_prepare_message(struct spi_master *master,
  *
  * This function fills the TX FIFO, starts the SPI transfer and
  * returns a positive transfer count so that core will wait for completion.
+ * Short transfers are polled to completion instead, see cdns_spi_can_poll().
  *
- * Return:	Number of bytes transferred in the last transfer
+ * Return:	Number of bytes transferred in the last transfer, 0 if the
+ *		transfer was polled to completion or error value on error
  */
 static int cdns_transfer_one(struct spi_master *master,
 			     struct spi_device *spi,
@@ -421,6 +528,14 @@ static int cdns_transfer_one(struct spi_master *master,
 
 	cdns_spi_fill_tx_fifo(xspi);
 
+	if (cdns_spi_can_poll(xspi, transfer)) {
+		int ret = cdns_spi_poll_transfer(xspi);
+
+		/* Taking longer than expected, let the interrupt finish it */
+		if (ret != -ETIMEDOUT)
+			return ret;
+	}
+
 	cdns_spi_write(xspi, CDNS_SPI_IER, CDNS_SPI_IXR_DEFAULT);
 	return transfer->len;
 }
@@ -626,6 +741,7 @@ static int cdns_spi_probe(struct platform_device *pdev)
 	/* Set to default valid value */
 	master->max_speed_hz = clk_get_rate(xspi->ref_clk) / 4;
 	xspi->speed_hz = master->max_speed_hz;
+	xspi->req_speed_hz = master->max_speed_hz;
 
 	master->bits_per_word_mask = SPI_BPW_MASK(8);
 
@@ -777,6 +893,7 @@ static struct platform_driver cdns_spi_driver = {
 		.name = CDNS_SPI_NAME,
 		.of_match_table = cdns_spi_of_match,
 		.pm = &cdns_spi_dev_pm_ops,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 };
 
@@ -0,0 +1,927 @@
+/*
+ * Xilinx Zynq Quad-SPI controller driver (master mode only)
+ *
+ * The controller runs in flash memory interface mode.  Generic transfers
+ * go through the 32 bit wide FIFOs; flash reads use the linear
+ * (memory-mapped) mode and, for large buffers, the PL330 to copy from the
+ * linear window.
+ *
+ * This program is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License version 2 as published by the
+ * Free Software Foundation; either version 2 of the License, or (at your
+ * option) any later version.
+ */
+
+#include <linux/clk.h>
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
+#include <linux/interrupt.h>
+#include <linux/io.h>
+#include <linux/iopoll.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/sizes.h>
+#include <linux/spi/spi.h>
+
+/* Name of this driver */
+#define ZYNQ_QSPI_NAME		"zynq-qspi"
+
+/* Register offset definitions */
+#define ZYNQ_QSPI_CR		0x00 /* Configuration Register, RW */
+#define ZYNQ_QSPI_ISR		0x04 /* Interrupt Status Register, RW */
+#define ZYNQ_QSPI_IER		0x08 /* Interrupt Enable Register, WO */
+#define ZYNQ_QSPI_IDR		0x0c /* Interrupt Disable Register, WO */
+#define ZYNQ_QSPI_IMR		0x10 /* Interrupt Enabled Mask Register, RO */
+#define ZYNQ_QSPI_ER		0x14 /* Enable/Disable Register, RW */
+#define ZYNQ_QSPI_DR		0x18 /* Delay Register, RW */
+#define ZYNQ_QSPI_TXD0		0x1c /* Data Transmit Register, 4 bytes, WO */
+#define ZYNQ_QSPI_RXD		0x20 /* Data Receive Register, RO */
+#define ZYNQ_QSPI_TX_THLD	0x28 /* TX FIFO Watermark Register, RW */
+#define ZYNQ_QSPI_RX_THLD	0x2c /* RX FIFO Watermark Register, RW */
+#define ZYNQ_QSPI_LPBK		0x38 /* Loopback Clock Delay Register, RW */
+#define ZYNQ_QSPI_TXD1		0x80 /* Data Transmit Register, 1 byte, WO */
+#define ZYNQ_QSPI_TXD2		0x84 /* Data Transmit Register, 2 bytes, WO */
+#define ZYNQ_QSPI_TXD3		0x88 /* Data Transmit Register, 3 bytes, WO */
+#define ZYNQ_QSPI_LQSPI_CR	0xa0 /* Linear Mode Configuration Register, RW */
+
+/*
+ * QSPI Configuration Register bit Masks
+ *
+ * This register contains various control bits that affect the operation
+ * of the QSPI controller
+ */
+#define ZYNQ_QSPI_CR_IFMODE	0x80000000 /* Flash Memory Interface Mode */
+#define ZYNQ_QSPI_CR_HOLDB_DR	0x00080000 /* Drive HOLD_B and WP_B */
+#define ZYNQ_QSPI_CR_MANSTRT	0x00010000 /* Manual TX Start */
+#define ZYNQ_QSPI_CR_MANSTRTEN	0x00008000 /* Manual TX Enable Mask */
+#define ZYNQ_QSPI_CR_SSFORCE	0x00004000 /* Manual SS Enable Mask */
+#define ZYNQ_QSPI_CR_PCS	0x00000400 /* Peripheral Chip Select */
+#define ZYNQ_QSPI_CR_FWIDTH	0x000000c0 /* FIFO Width, must be 32 bit */
+#define ZYNQ_QSPI_CR_BAUD_DIV	0x00000038 /* Baud Rate Divisor Mask */
+#define ZYNQ_QSPI_CR_CPHA	0x00000004 /* Clock Phase Control */
+#define ZYNQ_QSPI_CR_CPOL	0x00000002 /* Clock Polarity Control */
+#define ZYNQ_QSPI_CR_MSTREN	0x00000001 /* Master Enable Mask */
+#define ZYNQ_QSPI_CR_DEFAULT	(ZYNQ_QSPI_CR_IFMODE | \
+					ZYNQ_QSPI_CR_HOLDB_DR | \
+					ZYNQ_QSPI_CR_SSFORCE | \
+					ZYNQ_QSPI_CR_PCS | \
+					ZYNQ_QSPI_CR_FWIDTH | \
+					ZYNQ_QSPI_CR_MSTREN)
+
+/*
+ * QSPI Configuration Register - Baud rate
+ *
+ * The serial clock is the reference clock divided by 2 << divisor.
+ */
+#define ZYNQ_QSPI_BAUD_DIV_MAX		7 /* Baud rate divisor maximum */
+#define ZYNQ_QSPI_BAUD_DIV_SHIFT	3 /* Baud rate divisor shift in CR */
+
+/*
+ * QSPI Interrupt Registers bit Masks
+ *
+ * All the four interrupt registers (Status/Mask/Enable/Disable) have the same
+ * bit definitions.
+ */
+#define ZYNQ_QSPI_IXR_RXOVR	0x00000001 /* QSPI RX FIFO Overflow */
+#define ZYNQ_QSPI_IXR_TXNFULL	0x00000004 /* QSPI TX FIFO below watermark */
+#define ZYNQ_QSPI_IXR_TXFULL	0x00000008 /* QSPI TX FIFO Full */
+#define ZYNQ_QSPI_IXR_RXNEMTY	0x00000010 /* QSPI RX FIFO Not Empty */
+#define ZYNQ_QSPI_IXR_ALL	0x0000007d /* QSPI all interrupts */
+
+/*
+ * QSPI Enable Register bit Masks
+ *
+ * This register is used to enable or disable the QSPI controller
+ */
+#define ZYNQ_QSPI_ER_ENABLE	0x00000001 /* QSPI Enable Bit Mask */
+#define ZYNQ_QSPI_ER_DISABLE	0x0 /* QSPI Disable Bit Mask */
+
+/* Loopback clock, needed for the RX sampling point above 40 MHz */
+#define ZYNQ_QSPI_LPBK_USE_LPBK	0x00000020
+#define ZYNQ_QSPI_LPBK_MIN_HZ	40000000
+
+/*
+ * Linear Mode Configuration Register bit Masks
+ *
+ * In linear mode AXI reads of the linear window are turned into flash read
+ * commands by the controller, with 24 bit addresses.
+ */
+#define ZYNQ_QSPI_LQSPI_CR_LINEAR	0x80000000 /* Linear Mode Enable */
+#define ZYNQ_QSPI_LQSPI_CR_DUMMY_SHIFT	8 /* Dummy bytes shift */
+#define ZYNQ_QSPI_LQSPI_CR_DUMMY_MAX	7 /* Dummy bytes maximum */
+
+/* QSPI FIFO depth in 32 bit words, for both directions */
+#define ZYNQ_QSPI_FIFO_DEPTH	63
+
+/* Flash reads shorter than this are copied by the CPU */
+#define ZYNQ_QSPI_DMA_MIN_LEN	SZ_1K
+
+/* Longest wait for a word in flight to show up in the RX FIFO */
+#define ZYNQ_QSPI_RX_TIMEOUT_US	1000
+
+/**
+ * struct zynq_qspi - This definition defines QSPI driver instance
+ * @regs:		Virtual address of the QSPI controller registers
+ * @linear:		Virtual address of the linear window, NULL if unused
+ * @linear_phys:	Physical address of the linear window
+ * @linear_size:	Size of the linear window in bytes
+ * @ref_clk:		Pointer to the peripheral clock
+ * @pclk:		Pointer to the APB clock
+ * @speed_hz:		Current QSPI bus clock speed in Hz
+ * @txbuf:		Pointer	to the TX buffer
+ * @rxbuf:		Pointer to the RX buffer
+ * @tx_bytes:		Number of bytes left to transfer
+ * @rx_bytes:		Number of bytes left to receive
+ * @linear_mode:	Controller is set up for linear mode reads
+ * @rx_chan:		Memcpy DMA channel for linear mode reads, if any
+ * @dma_done:		Completion of a linear mode DMA read
+ */
+struct zynq_qspi {
+	void __iomem *regs;
+	void __iomem *linear;
+	phys_addr_t linear_phys;
+	resource_size_t linear_size;
+	struct clk *ref_clk;
+	struct clk *pclk;
+	u32 speed_hz;
+	const u8 *txbuf;
+	u8 *rxbuf;
+	int tx_bytes;
+	int rx_bytes;
+	bool linear_mode;
+	struct dma_chan *rx_chan;
+	struct completion dma_done;
+};
+
+/* Macros for the QSPI controller read/write */
+static inline u32 zynq_qspi_read(struct zynq_qspi *xqspi, u32 offset)
+{
+	return readl_relaxed(xqspi->regs + offset);
+}
+
+static inline void zynq_qspi_write(struct zynq_qspi *xqspi, u32 offset,
+				   u32 val)
+{
+	writel_relaxed(val, xqspi->regs + offset);
+}
+
+/**
+ * zynq_qspi_init_hw - Initialize the hardware and configure the controller
+ * @xqspi:	Pointer to the zynq_qspi structure
+ *
+ * This function disables linear mode and all the interrupts, drains the RX
+ * FIFO, and sets the controller up for flash memory interface mode with a
+ * 32 bit FIFO, manual slave select and automatic start.  The TX watermark
+ * is set to 1 so that the watermark interrupt means an empty TX FIFO.
+ */
+static void zynq_qspi_init_hw(struct zynq_qspi *xqspi)
+{
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ER, ZYNQ_QSPI_ER_DISABLE);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_IDR, ZYNQ_QSPI_IXR_ALL);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_LQSPI_CR, 0);
+
+	/* Clear the RX FIFO */
+	while (zynq_qspi_read(xqspi, ZYNQ_QSPI_ISR) & ZYNQ_QSPI_IXR_RXNEMTY)
+		zynq_qspi_read(xqspi, ZYNQ_QSPI_RXD);
+
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ISR, ZYNQ_QSPI_IXR_ALL);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_CR, ZYNQ_QSPI_CR_DEFAULT);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_TX_THLD, 1);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_RX_THLD, 1);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ER, ZYNQ_QSPI_ER_ENABLE);
+
+	xqspi->linear_mode = false;
+}
+
+/**
+ * zynq_qspi_chipselect - Select or deselect the chip select line
+ * @spi:	Pointer to the spi_device structure
+ * @is_high:	Select(0) or deselect (1) the chip select line
+ */
+static void zynq_qspi_chipselect(struct spi_device *spi, bool is_high)
+{
+	struct zynq_qspi *xqspi = spi_master_get_devdata(spi->master);
+	u32 ctrl_reg;
+
+	ctrl_reg = zynq_qspi_read(xqspi, ZYNQ_QSPI_CR);
+
+	if (is_high)
+		ctrl_reg |= ZYNQ_QSPI_CR_PCS;
+	else
+		ctrl_reg &= ~ZYNQ_QSPI_CR_PCS;
+
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_CR, ctrl_reg);
+}
+
+/**
+ * zynq_qspi_config_clock_mode - Sets clock polarity and phase
+ * @spi:	Pointer to the spi_device structure
+ */
+static void zynq_qspi_config_clock_mode(struct spi_device *spi)
+{
+	struct zynq_qspi *xqspi = spi_master_get_devdata(spi->master);
+	u32 ctrl_reg, new_ctrl_reg;
+
+	new_ctrl_reg = zynq_qspi_read(xqspi, ZYNQ_QSPI_CR);
+	ctrl_reg = new_ctrl_reg;
+
+	new_ctrl_reg &= ~(ZYNQ_QSPI_CR_CPHA | ZYNQ_QSPI_CR_CPOL);
+	if (spi->mode & SPI_CPHA)
+		new_ctrl_reg |= ZYNQ_QSPI_CR_CPHA;
+	if (spi->mode & SPI_CPOL)
+		new_ctrl_reg |= ZYNQ_QSPI_CR_CPOL;
+
+	/* As on the Cadence SPI, the clock change needs an ER toggle */
+	if (new_ctrl_reg != ctrl_reg) {
+		zynq_qspi_write(xqspi, ZYNQ_QSPI_ER, ZYNQ_QSPI_ER_DISABLE);
+		zynq_qspi_write(xqspi, ZYNQ_QSPI_CR, new_ctrl_reg);
+		zynq_qspi_write(xqspi, ZYNQ_QSPI_ER, ZYNQ_QSPI_ER_ENABLE);
+	}
+}
+
+/**
+ * zynq_qspi_config_clock_freq - Sets clock frequency
+ * @xqspi:	Pointer to the zynq_qspi structure
+ * @speed_hz:	Requested bus clock in Hz
+ *
+ * Sets the highest frequency not above the requested one, and switches
+ * the RX sampling over to the loopback clock at high speeds.
+ */
+static void zynq_qspi_config_clock_freq(struct zynq_qspi *xqspi,
+					u32 speed_hz)
+{
+	u32 ctrl_reg, baud_rate_val;
+	unsigned long frequency;
+
+	if (xqspi->speed_hz == speed_hz)
+		return;
+
+	frequency = clk_get_rate(xqspi->ref_clk);
+
+	baud_rate_val = 0;
+	while ((baud_rate_val < ZYNQ_QSPI_BAUD_DIV_MAX) &&
+	       (frequency / (2 << baud_rate_val)) > speed_hz)
+		baud_rate_val++;
+
+	ctrl_reg = zynq_qspi_read(xqspi, ZYNQ_QSPI_CR);
+	ctrl_reg &= ~ZYNQ_QSPI_CR_BAUD_DIV;
+	ctrl_reg |= baud_rate_val << ZYNQ_QSPI_BAUD_DIV_SHIFT;
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_CR, ctrl_reg);
+
+	xqspi->speed_hz = speed_hz;
+
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_LPBK,
+			frequency / (2 << baud_rate_val) > ZYNQ_QSPI_LPBK_MIN_HZ ?
+			ZYNQ_QSPI_LPBK_USE_LPBK : 0);
+}
+
+/**
+ * zynq_qspi_set_linear - Switch between linear and FIFO (I/O) mode
+ * @xqspi:	Pointer to the zynq_qspi structure
+ * @lqspi_cr:	Linear mode configuration, 0 to go back to I/O mode
+ *
+ * In linear mode the controller drives the chip select itself, so the
+ * manual slave select is dropped while it is active.
+ */
+static void zynq_qspi_set_linear(struct zynq_qspi *xqspi, u32 lqspi_cr)
+{
+	u32 ctrl_reg = zynq_qspi_read(xqspi, ZYNQ_QSPI_CR);
+
+	if (lqspi_cr)
+		ctrl_reg &= ~(ZYNQ_QSPI_CR_SSFORCE | ZYNQ_QSPI_CR_PCS);
+	else
+		ctrl_reg |= ZYNQ_QSPI_CR_SSFORCE | ZYNQ_QSPI_CR_PCS;
+
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ER, ZYNQ_QSPI_ER_DISABLE);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_LQSPI_CR, lqspi_cr);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_CR, ctrl_reg);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ER, ZYNQ_QSPI_ER_ENABLE);
+
+	xqspi->linear_mode = !!lqspi_cr;
+}
+
+/**
+ * zynq_qspi_fill_tx_fifo - Fills the TX FIFO with as many bytes as possible
+ * @xqspi:	Pointer to the zynq_qspi structure
+ *
+ * Whole words go through TXD0, a trailing partial word through TXD1-3,
+ * which only send the given number of bytes.  No more than the FIFO depth
+ * is queued so the RX FIFO can never overflow.
+ */
+static void zynq_qspi_fill_tx_fifo(struct zynq_qspi *xqspi)
+{
+	static const u32 txd[] = {
+		ZYNQ_QSPI_TXD1, ZYNQ_QSPI_TXD2, ZYNQ_QSPI_TXD3, ZYNQ_QSPI_TXD0
+	};
+	int words = ZYNQ_QSPI_FIFO_DEPTH;
+	unsigned int size;
+	u32 data;
+
+	while (xqspi->tx_bytes && words--) {
+		size = min(xqspi->tx_bytes, 4);
+
+		if (xqspi->txbuf) {
+			data = 0xffffffff;
+			memcpy(&data, xqspi->txbuf, size);
+			xqspi->txbuf += size;
+		} else {
+			data = 0;
+		}
+
+		zynq_qspi_write(xqspi, txd[size - 1], data);
+		xqspi->tx_bytes -= size;
+	}
+}
+
+/**
+ * zynq_qspi_drain_rx_fifo - Read back the words sent by the last fill
+ * @xqspi:	Pointer to the zynq_qspi structure
+ *
+ * A partial word is received in the upper bytes of RXD.
+ *
+ * Return:	0 on success, -ETIMEDOUT if a word did not arrive
+ */
+static int zynq_qspi_drain_rx_fifo(struct zynq_qspi *xqspi)
+{
+	unsigned int size;
+	u32 status, data;
+	int ret;
+
+	while (xqspi->rx_bytes > xqspi->tx_bytes) {
+		ret = readl_relaxed_poll_timeout_atomic(xqspi->regs +
+							ZYNQ_QSPI_ISR, status,
+							status &
+							ZYNQ_QSPI_IXR_RXNEMTY,
+							0,
+							ZYNQ_QSPI_RX_TIMEOUT_US);
+		if (ret)
+			return ret;
+
+		size = min(xqspi->rx_bytes, 4);
+		data = zynq_qspi_read(xqspi, ZYNQ_QSPI_RXD);
+
+		if (xqspi->rxbuf) {
+			memcpy(xqspi->rxbuf, (u8 *)&data + 4 - size, size);
+			xqspi->rxbuf += size;
+		}
+		xqspi->rx_bytes -= size;
+	}
+
+	return 0;
+}
+
+/**
+ * zynq_qspi_irq - Interrupt service routine of the QSPI controller
+ * @irq:	IRQ number
+ * @dev_id:	Pointer to the spi_master structure
+ *
+ * This function handles the TX FIFO empty interrupt only.  It reads the
+ * received data from the RX FIFO and refills the TX FIFO if there is any
+ * data remaining to be transferred.
+ *
+ * Return:	IRQ_HANDLED when handled; IRQ_NONE otherwise.
+ */
+static irqreturn_t zynq_qspi_irq(int irq, void *dev_id)
+{
+	struct spi_master *master = dev_id;
+	struct zynq_qspi *xqspi = spi_master_get_devdata(master);
+	u32 intr_status;
+
+	intr_status = zynq_qspi_read(xqspi, ZYNQ_QSPI_ISR);
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ISR, intr_status);
+
+	if (!(intr_status & ZYNQ_QSPI_IXR_TXNFULL) ||
+	    !(zynq_qspi_read(xqspi, ZYNQ_QSPI_IMR) & ZYNQ_QSPI_IXR_TXNFULL))
+		return IRQ_NONE;
+
+	if (zynq_qspi_drain_rx_fifo(xqspi)) {
+		dev_err(&master->dev, "RX FIFO timeout\n");
+		master->cur_msg->status = -EIO;
+	} else if (xqspi->tx_bytes) {
+		/* There is more data to send */
+		zynq_qspi_fill_tx_fifo(xqspi);
+		return IRQ_HANDLED;
+	}
+
+	/* Transfer is completed */
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_IDR, ZYNQ_QSPI_IXR_TXNFULL);
+	spi_finalize_current_transfer(master);
+
+	return IRQ_HANDLED;
+}
+
+/**
+ * zynq_qspi_pio - Run a transfer through the FIFOs without interrupts
+ * @xqspi:	Pointer to the zynq_qspi structure
+ * @tx:		TX buffer or NULL
+ * @rx:		RX buffer or NULL
+ * @len:	Number of bytes to transfer
+ *
+ * Used for flash reads that the linear mode cannot serve.  The chip
+ * select must already be asserted.
+ *
+ * Return:	0 on success, -ETIMEDOUT if the controller stalled
+ */
+static int zynq_qspi_pio(struct zynq_qspi *xqspi, const u8 *tx, u8 *rx,
+			 int len)
+{
+	int ret;
+
+	xqspi->txbuf = tx;
+	xqspi->rxbuf = rx;
+	xqspi->tx_bytes = len;
+	xqspi->rx_bytes = len;
+
+	while (xqspi->rx_bytes) {
+		zynq_qspi_fill_tx_fifo(xqspi);
+		ret = zynq_qspi_drain_rx_fifo(xqspi);
+		if (ret)
+			return ret;
+		cond_resched();
+	}
+
+	return 0;
+}
+
+static int zynq_qspi_prepare_message(struct spi_master *master,
+				     struct spi_message *msg)
+{
+	struct zynq_qspi *xqspi = spi_master_get_devdata(master);
+
+	if (xqspi->linear_mode)
+		zynq_qspi_set_linear(xqspi, 0);
+
+	zynq_qspi_config_clock_mode(msg->spi);
+	return 0;
+}
+
+/**
+ * zynq_qspi_transfer_one - Initiates the QSPI transfer
+ * @master:	Pointer to spi_master structure
+ * @spi:	Pointer to the spi_device structure
+ * @transfer:	Pointer to the spi_transfer structure which provides
+ *		information about next transfer parameters
+ *
+ * This function fills the TX FIFO, starts the QSPI transfer and
+ * returns a positive transfer count so that core will wait for completion.
+ * In flash memory interface mode the controller picks the dual or quad
+ * data phase from the instruction at the start of the message.
+ *
+ * Return:	Number of bytes transferred in the last transfer
+ */
+static int zynq_qspi_transfer_one(struct spi_master *master,
+				  struct spi_device *spi,
+				  struct spi_transfer *transfer)
+{
+	struct zynq_qspi *xqspi = spi_master_get_devdata(master);
+
+	xqspi->txbuf = transfer->tx_buf;
+	xqspi->rxbuf = transfer->rx_buf;
+	xqspi->tx_bytes = transfer->len;
+	xqspi->rx_bytes = transfer->len;
+
+	zynq_qspi_config_clock_freq(xqspi, transfer->speed_hz);
+
+	zynq_qspi_fill_tx_fifo(xqspi);
+
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_IER, ZYNQ_QSPI_IXR_TXNFULL);
+	return transfer->len;
+}
+
+/**
+ * zynq_qspi_linear_cr - Linear mode configuration for a flash read
+ * @xqspi:	Pointer to the zynq_qspi structure
+ * @msg:	Pointer to the spi_flash_read_message structure
+ *
+ * The linear mode only knows 24 bit addresses, single line instruction
+ * and address phases, and the read commands below.
+ *
+ * Return:	LQSPI_CR value, or 0 if the read cannot use linear mode
+ */
+static u32 zynq_qspi_linear_cr(struct zynq_qspi *xqspi,
+			       struct spi_flash_read_message *msg)
+{
+	if (!xqspi->linear || msg->addr_width != 3 ||
+	    msg->opcode_nbits > SPI_NBITS_SINGLE ||
+	    msg->addr_nbits > SPI_NBITS_SINGLE ||
+	    msg->dummy_bytes > ZYNQ_QSPI_LQSPI_CR_DUMMY_MAX ||
+	    msg->from + msg->len > xqspi->linear_size)
+		return 0;
+
+	switch (msg->read_opcode) {
+	case 0x03: /* Read */
+	case 0x0b: /* Fast read */
+	case 0x3b: /* Dual output fast read */
+	case 0x6b: /* Quad output fast read */
+		break;
+	default:
+		return 0;
+	}
+
+	return ZYNQ_QSPI_LQSPI_CR_LINEAR |
+	       msg->dummy_bytes << ZYNQ_QSPI_LQSPI_CR_DUMMY_SHIFT |
+	       msg->read_opcode;
+}
+
+static void zynq_qspi_dma_callback(void *param)
+{
+	struct zynq_qspi *xqspi = param;
+
+	complete(&xqspi->dma_done);
+}
+
+/**
+ * zynq_qspi_dma_xfer - Copy from the linear window with the DMA engine
+ * @xqspi:	Pointer to the zynq_qspi structure
+ * @dma_dst:	Destination bus address
+ * @dma_src:	Source address in the linear window
+ * @len:	Number of bytes to copy
+ *
+ * Return:	0 on success and error value on error
+ */
+static int zynq_qspi_dma_xfer(struct zynq_qspi *xqspi, dma_addr_t dma_dst,
+			      dma_addr_t dma_src, size_t len)
+{
+	struct dma_async_tx_descriptor *tx;
+	dma_cookie_t cookie;
+
+	tx = dmaengine_prep_dma_memcpy(xqspi->rx_chan, dma_dst, dma_src, len,
+				       DMA_CTRL_ACK | DMA_PREP_INTERRUPT);
+	if (!tx)
+		return -EIO;
+
+	tx->callback = zynq_qspi_dma_callback;
+	tx->callback_param = xqspi;
+	reinit_completion(&xqspi->dma_done);
+
+	cookie = dmaengine_submit(tx);
+	if (dma_submit_error(cookie))
+		return -EIO;
+
+	dma_async_issue_pending(xqspi->rx_chan);
+
+	/* Even the slowest bus clock moves more than a byte per millisecond */
+	if (!wait_for_completion_timeout(&xqspi->dma_done,
+					 msecs_to_jiffies(len))) {
+		dmaengine_terminate_sync(xqspi->rx_chan);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+/**
+ * zynq_qspi_linear_read - Read the flash through the linear window
+ * @xqspi:	Pointer to the zynq_qspi structure
+ * @msg:	Pointer to the spi_flash_read_message structure
+ *
+ * Return:	0 on success and error value on error
+ */
+static int zynq_qspi_linear_read(struct zynq_qspi *xqspi,
+				 struct spi_flash_read_message *msg)
+{
+	dma_addr_t dma_src = xqspi->linear_phys + msg->from;
+	struct scatterlist *sg;
+	int i, ret;
+
+	if (!msg->cur_msg_mapped) {
+		memcpy_fromio(msg->buf, xqspi->linear + msg->from, msg->len);
+		return 0;
+	}
+
+	for_each_sg(msg->rx_sg.sgl, sg, msg->rx_sg.nents, i) {
+		ret = zynq_qspi_dma_xfer(xqspi, sg_dma_address(sg), dma_src,
+					 sg_dma_len(sg));
+		if (ret)
+			return ret;
+		dma_src += sg_dma_len(sg);
+	}
+
+	return 0;
+}
+
+/**
+ * zynq_qspi_io_read - Read the flash through the FIFOs
+ * @spi:	Pointer to the spi_device structure
+ * @msg:	Pointer to the spi_flash_read_message structure
+ *
+ * Fallback for reads that do not fit the linear mode, e.g. 4 byte
+ * addressing or a flash larger than the linear window.
+ *
+ * Return:	0 on success and error value on error
+ */
+static int zynq_qspi_io_read(struct spi_device *spi,
+			     struct spi_flash_read_message *msg)
+{
+	struct zynq_qspi *xqspi = spi_master_get_devdata(spi->master);
+	u8 cmd[1 + 4 + ZYNQ_QSPI_LQSPI_CR_DUMMY_MAX];
+	unsigned int cmd_len = 1 + msg->addr_width + msg->dummy_bytes;
+	int i, ret;
+
+	if (msg->addr_width > 4 || cmd_len > sizeof(cmd))
+		return -EINVAL;
+
+	cmd[0] = msg->read_opcode;
+	for (i = 0; i < msg->addr_width; i++)
+		cmd[1 + i] = msg->from >> (8 * (msg->addr_width - 1 - i));
+	memset(&cmd[1 + msg->addr_width], 0xff, msg->dummy_bytes);
+
+	if (xqspi->linear_mode)
+		zynq_qspi_set_linear(xqspi, 0);
+	zynq_qspi_config_clock_mode(spi);
+
+	zynq_qspi_chipselect(spi, false);
+	ret = zynq_qspi_pio(xqspi, cmd, NULL, cmd_len);
+	if (!ret)
+		ret = zynq_qspi_pio(xqspi, NULL, msg->buf, msg->len);
+	zynq_qspi_chipselect(spi, true);
+
+	return ret;
+}
+
+/**
+ * zynq_qspi_flash_read - Accelerated flash read
+ * @spi:	Pointer to the spi_device structure
+ * @msg:	Pointer to the spi_flash_read_message structure
+ *
+ * Reads go through the linear window whenever the command allows it,
+ * copied by the DMA engine if the core could map the buffer.  The
+ * controller stays in linear mode until the next message, so back to back
+ * reads do not reprogram it.
+ *
+ * Return:	0 on success and error value on error
+ */
+static int zynq_qspi_flash_read(struct spi_device *spi,
+				struct spi_flash_read_message *msg)
+{
+	struct zynq_qspi *xqspi = spi_master_get_devdata(spi->master);
+	u32 lqspi_cr;
+	int ret;
+
+	zynq_qspi_config_clock_freq(xqspi, spi->max_speed_hz);
+
+	lqspi_cr = zynq_qspi_linear_cr(xqspi, msg);
+	if (!lqspi_cr) {
+		ret = zynq_qspi_io_read(spi, msg);
+	} else {
+		if (!xqspi->linear_mode ||
+		    zynq_qspi_read(xqspi, ZYNQ_QSPI_LQSPI_CR) != lqspi_cr) {
+			zynq_qspi_config_clock_mode(spi);
+			zynq_qspi_set_linear(xqspi, lqspi_cr);
+		}
+		ret = zynq_qspi_linear_read(xqspi, msg);
+	}
+
+	if (ret)
+		return ret;
+
+	msg->retlen = msg->len;
+	return 0;
+}
+
+static bool zynq_qspi_flash_can_dma(struct spi_device *spi,
+				    struct spi_flash_read_message *msg)
+{
+	struct zynq_qspi *xqspi = spi_master_get_devdata(spi->master);
+
+	return msg->len >= ZYNQ_QSPI_DMA_MIN_LEN && virt_addr_valid(msg->buf) &&
+	       zynq_qspi_linear_cr(xqspi, msg);
+}
+
+/**
+ * zynq_qspi_setup_linear - Map the linear window and get a DMA channel
+ * @pdev:	Pointer to the platform_device structure
+ * @master:	Pointer to the spi_master structure
+ *
+ * The linear window is the optional second memory resource.  Without it
+ * flash reads go through the FIFOs, without a DMA channel the CPU copies
+ * from the window.
+ */
+static void zynq_qspi_setup_linear(struct platform_device *pdev,
+				   struct spi_master *master)
+{
+	struct zynq_qspi *xqspi = spi_master_get_devdata(master);
+	struct resource *res;
+	dma_cap_mask_t mask;
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 1);
+	if (!res)
+		return;
+
+	xqspi->linear = devm_ioremap_resource(&pdev->dev, res);
+	if (IS_ERR(xqspi->linear)) {
+		dev_warn(&pdev->dev, "linear window not mapped: %ld\n",
+			 PTR_ERR(xqspi->linear));
+		xqspi->linear = NULL;
+		return;
+	}
+	xqspi->linear_phys = res->start;
+	xqspi->linear_size = resource_size(res);
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMCPY, mask);
+
+	xqspi->rx_chan = dma_request_chan_by_mask(&mask);
+	if (IS_ERR(xqspi->rx_chan)) {
+		dev_info(&pdev->dev, "no memcpy DMA, using CPU reads\n");
+		xqspi->rx_chan = NULL;
+		return;
+	}
+
+	init_completion(&xqspi->dma_done);
+	master->dma_rx = xqspi->rx_chan;
+	master->spi_flash_can_dma = zynq_qspi_flash_can_dma;
+}
+
+/**
+ * zynq_qspi_probe - Probe method for the QSPI driver
+ * @pdev:	Pointer to the platform_device structure
+ *
+ * This function initializes the driver data structures and the hardware.
+ *
+ * Return:	0 on success and error value on error
+ */
+static int zynq_qspi_probe(struct platform_device *pdev)
+{
+	int ret = 0, irq;
+	struct spi_master *master;
+	struct zynq_qspi *xqspi;
+	struct resource *res;
+
+	master = spi_alloc_master(&pdev->dev, sizeof(*xqspi));
+	if (!master)
+		return -ENOMEM;
+
+	xqspi = spi_master_get_devdata(master);
+	master->dev.of_node = pdev->dev.of_node;
+	platform_set_drvdata(pdev, master);
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	xqspi->regs = devm_ioremap_resource(&pdev->dev, res);
+	if (IS_ERR(xqspi->regs)) {
+		ret = PTR_ERR(xqspi->regs);
+		goto remove_master;
+	}
+
+	xqspi->pclk = devm_clk_get(&pdev->dev, "pclk");
+	if (IS_ERR(xqspi->pclk)) {
+		dev_err(&pdev->dev, "pclk clock not found.\n");
+		ret = PTR_ERR(xqspi->pclk);
+		goto remove_master;
+	}
+
+	xqspi->ref_clk = devm_clk_get(&pdev->dev, "ref_clk");
+	if (IS_ERR(xqspi->ref_clk)) {
+		dev_err(&pdev->dev, "ref_clk clock not found.\n");
+		ret = PTR_ERR(xqspi->ref_clk);
+		goto remove_master;
+	}
+
+	ret = clk_prepare_enable(xqspi->pclk);
+	if (ret) {
+		dev_err(&pdev->dev, "Unable to enable APB clock.\n");
+		goto remove_master;
+	}
+
+	ret = clk_prepare_enable(xqspi->ref_clk);
+	if (ret) {
+		dev_err(&pdev->dev, "Unable to enable device clock.\n");
+		goto clk_dis_apb;
+	}
+
+	/* QSPI controller initializations */
+	zynq_qspi_init_hw(xqspi);
+
+	irq = platform_get_irq(pdev, 0);
+	if (irq <= 0) {
+		ret = -ENXIO;
+		dev_err(&pdev->dev, "irq number is invalid\n");
+		goto clk_dis_all;
+	}
+
+	ret = devm_request_irq(&pdev->dev, irq, zynq_qspi_irq,
+			       0, pdev->name, master);
+	if (ret != 0) {
+		ret = -ENXIO;
+		dev_err(&pdev->dev, "request_irq failed\n");
+		goto clk_dis_all;
+	}
+
+	zynq_qspi_setup_linear(pdev, master);
+
+	master->prepare_message = zynq_qspi_prepare_message;
+	master->transfer_one = zynq_qspi_transfer_one;
+	master->set_cs = zynq_qspi_chipselect;
+	master->spi_flash_read = zynq_qspi_flash_read;
+	master->num_chipselect = 1;
+	master->mode_bits = SPI_CPOL | SPI_CPHA | SPI_RX_DUAL | SPI_RX_QUAD;
+
+	/* Set to default valid value */
+	master->max_speed_hz = clk_get_rate(xqspi->ref_clk) / 2;
+	master->bits_per_word_mask = SPI_BPW_MASK(8);
+
+	ret = spi_register_master(master);
+	if (ret) {
+		dev_err(&pdev->dev, "spi_register_master failed\n");
+		goto dma_release;
+	}
+
+	return ret;
+
+dma_release:
+	if (xqspi->rx_chan)
+		dma_release_channel(xqspi->rx_chan);
+clk_dis_all:
+	clk_disable_unprepare(xqspi->ref_clk);
+clk_dis_apb:
+	clk_disable_unprepare(xqspi->pclk);
+remove_master:
+	spi_master_put(master);
+	return ret;
+}
+
+/**
+ * zynq_qspi_remove - Remove method for the QSPI driver
+ * @pdev:	Pointer to the platform_device structure
+ *
+ * This function is called if a device is physically removed from the system or
+ * if the driver module is being unloaded. It frees all resources allocated to
+ * the device.
+ *
+ * Return:	0 on success and error value on error
+ */
+static int zynq_qspi_remove(struct platform_device *pdev)
+{
+	struct spi_master *master = platform_get_drvdata(pdev);
+	struct zynq_qspi *xqspi = spi_master_get_devdata(master);
+
+	spi_unregister_master(master);
+
+	zynq_qspi_write(xqspi, ZYNQ_QSPI_ER, ZYNQ_QSPI_ER_DISABLE);
+
+	if (xqspi->rx_chan)
+		dma_release_channel(xqspi->rx_chan);
+
+	clk_disable_unprepare(xqspi->ref_clk);
+	clk_disable_unprepare(xqspi->pclk);
+
+	return 0;
+}
+
+/**
+ * zynq_qspi_suspend - Suspend method for the QSPI driver
+ * @dev:	Address of the platform_device structure
+ *
+ * Return:	0 on success and error value on error
+ */
+static int __maybe_unused zynq_qspi_suspend(struct device *dev)
+{
+	struct spi_master *master = dev_get_drvdata(dev);
+
+	return spi_master_suspend(master);
+}
+
+/**
+ * zynq_qspi_resume - Resume method for the QSPI driver
+ * @dev:	Address of the platform_device structure
+ *
+ * The controller may have lost its state, so it is set up from scratch.
+ *
+ * Return:	0 on success and error value on error
+ */
+static int __maybe_unused zynq_qspi_resume(struct device *dev)
+{
+	struct spi_master *master = dev_get_drvdata(dev);
+	struct zynq_qspi *xqspi = spi_master_get_devdata(master);
+
+	zynq_qspi_init_hw(xqspi);
+	xqspi->speed_hz = 0;
+
+	return spi_master_resume(master);
+}
+
+static SIMPLE_DEV_PM_OPS(zynq_qspi_dev_pm_ops, zynq_qspi_suspend,
+			 zynq_qspi_resume);
+
+static const struct of_device_id zynq_qspi_of_match[] = {
+	{ .compatible = "xlnx,zynq-qspi-1.0" },
+	{ /* end of table */ }
+};
+MODULE_DEVICE_TABLE(of, zynq_qspi_of_match);
+
+/* zynq_qspi_driver - This structure defines the QSPI platform driver */
+static struct platform_driver zynq_qspi_driver = {
+	.probe	= zynq_qspi_probe,
+	.remove	= zynq_qspi_remove,
+	.driver = {
+		.name = ZYNQ_QSPI_NAME,
+		.of_match_table = zynq_qspi_of_match,
+		.pm = &zynq_qspi_dev_pm_ops,
+	},
+};
+
+module_platform_driver(zynq_qspi_driver);
+
+MODULE_DESCRIPTION("Xilinx Zynq QSPI driver");
+MODULE_LICENSE("GPL");
@@ -26,8 +26,12 @@
 #include <linux/tty.h>
 #include <linux/tty_flip.h>
 #include <linux/clk.h>
+#include <linux/delay.h>
 #include <linux/irq.h>
+#include <linux/irq_work.h>
 #include <linux/io.h>
+#include <linux/kfifo.h>
+#include <linux/kthread.h>
 #include <linux/of.h>
 #include <linux/module.h>
 #include <linux/pm_runtime.h>
@@ -38,17 +42,20 @@
 #define CDNS_UART_MINOR		0	/* works best with devtmpfs */
 #define CDNS_UART_NR_PORTS	2
 #define CDNS_UART_FIFO_SIZE	64	/* FIFO size */
+/* Highest adaptive RX trigger level, leaves room for the IRQ latency */
+#define CDNS_UART_RX_TRIG_MAX	(CDNS_UART_FIFO_SIZE - 8)
 #define CDNS_UART_REGISTER_SPACE	0x1000
 
 /* Rx Trigger level */
 static int rx_trigger_level = 56;
 module_param(rx_trigger_level, uint, S_IRUGO);
-MODULE_PARM_DESC(rx_trigger_level, "Rx trigger level, 1-63 bytes");
+MODULE_PARM_DESC(rx_trigger_level,
+		 "Default Rx trigger level, 1-63 bytes, per port in sysfs");
 
 /* Rx Timeout */
 static int rx_timeout = 10;
 module_param(rx_timeout, uint, S_IRUGO);
-MODULE_PARM_DESC(rx_timeout, "Rx timeout, 1-255");
+MODULE_PARM_DESC(rx_timeout, "Default Rx timeout, 1-255, per port in sysfs");
 
 /* Register offsets for the UART. */
 #define CDNS_UART_CR		0x00  /* Control Register */
@@ -144,6 +151,10 @@ MODULE_PARM_DESC(rx_timeout, "Rx timeout, 1-255");
 	 * and we still handle parity errors in the desired way.
 	 */
 
+#define CDNS_UART_RX_ERRORS	(CDNS_UART_IXR_PARITY | \
+				 CDNS_UART_IXR_FRAMING | \
+				 CDNS_UART_IXR_OVERRUN)
+
 #define CDNS_UART_RX_IRQS	(CDNS_UART_IXR_FRAMING | \
 				 CDNS_UART_IXR_OVERRUN | \
 				 CDNS_UART_IXR_RXTRIG |	 \
@@ -186,6 +197,10 @@ MODULE_PARM_DESC(rx_timeout, "Rx timeout, 1-255");
  * @pclk:		APB clock
  * @baud:		Current baud rate
  * @clk_rate_change_nb:	Notifier block for clock changes
+ * @rx_trigger_level:	RX FIFO trigger level, the floor in adaptive mode
+ * @rx_timeout:		RX timeout in character times
+ * @rx_trig_adaptive:	Raise the trigger level under sustained traffic
+ * @rx_trig_cur:	RX FIFO trigger level currently programmed
  */
 struct cdns_uart {
 	struct uart_port	*port;
@@ -194,6 +209,10 @@ struct cdns_uart {
 	unsigned int		baud;
 	struct notifier_block	clk_rate_change_nb;
 	u32			quirks;
+	unsigned int		rx_trigger_level;
+	unsigned int		rx_timeout;
+	unsigned int		rx_trig_adaptive;
+	unsigned int		rx_trig_cur;
 };
 struct cdns_platform_data {
 	u32 quirks;
@@ -201,6 +220,40 @@ struct cdns_platform_data {
 #define to_cdns_uart(_nb) container_of(_nb, struct cdns_uart, \
 		clk_rate_change_nb);
 
+/**
+ * cdns_uart_rx_burst - Move error free bytes from the RX FIFO in bulk
+ * @port: Pointer to the UART port
+ *
+ * The FIFO has no fill level register, but while the trigger status is set
+ * at least rx_trig_cur bytes can be read without polling the status
+ * in between.  Bytes go to the tty layer a FIFO worth at a time.
+ */
+static void cdns_uart_rx_burst(struct uart_port *port)
+{
+	struct cdns_uart *cdns_uart = port->private_data;
+	unsigned char buf[CDNS_UART_FIFO_SIZE];
+	unsigned int status, count, len = 0;
+
+	while (!((status = readl(port->membase + CDNS_UART_SR)) &
+		 CDNS_UART_SR_RXEMPTY)) {
+		count = 1;
+		if (status & CDNS_UART_SR_RXTRIG)
+			count = cdns_uart->rx_trig_cur;
+
+		if (len + count > sizeof(buf)) {
+			tty_insert_flip_string(&port->state->port, buf, len);
+			len = 0;
+		}
+
+		port->icount.rx += count;
+		while (count--)
+			buf[len++] = readl_relaxed(port->membase +
+						   CDNS_UART_FIFO);
+	}
+
+	tty_insert_flip_string(&port->state->port, buf, len);
+}
+
 /**
  * cdns_uart_handle_rx - Handle the received bytes along with Rx errors.
  * @dev_id: Id of the UART port
@@ -220,6 +273,17 @@ static void cdns_uart_handle_rx(void *dev_id, unsigned int isrstatus)
 
 	is_rxbs_support = cdns_uart->quirks & CDNS_UART_RXBS_SUPPORT;
 
+	/*
+	 * Without errors, a pending break or a sysrq sequence there is no
+	 * per byte status to track.  The RXBS variant reports errors per
+	 * byte, so it always takes the slow path.
+	 */
+	if (!is_rxbs_support && !(isrstatus & CDNS_UART_RX_ERRORS) &&
+	    !(port->read_status_mask & CDNS_UART_IXR_BRK) && !port->sysrq) {
+		cdns_uart_rx_burst(port);
+		goto push;
+	}
+
 	while ((readl(port->membase + CDNS_UART_SR) &
 		CDNS_UART_SR_RXEMPTY) != CDNS_UART_SR_RXEMPTY) {
 		if (is_rxbs_support)
@@ -292,11 +356,36 @@ static void cdns_uart_handle_rx(void *dev_id, unsigned int isrstatus)
 		tty_insert_flip_char(&port->state->port, data, status);
 		isrstatus = 0;
 	}
+push:
 	spin_unlock(&port->lock);
 	tty_flip_buffer_push(&port->state->port);
 	spin_lock(&port->lock);
 }
 
+/**
+ * cdns_uart_tx_burst - Fill the empty TX FIFO in bulk
+ * @port: Pointer to the UART port
+ *
+ * Like the RX side, an empty FIFO takes a FIFO worth of bytes without
+ * polling the status in between.  They are written straight from the
+ * circular buffer.
+ */
+static void cdns_uart_tx_burst(struct uart_port *port)
+{
+	struct circ_buf *xmit = &port->state->xmit;
+	unsigned int count;
+
+	count = min_t(unsigned int, port->fifosize,
+		      uart_circ_chars_pending(xmit));
+	port->icount.tx += count;
+
+	while (count--) {
+		writel_relaxed(xmit->buf[xmit->tail],
+			       port->membase + CDNS_UART_FIFO);
+		xmit->tail = (xmit->tail + 1) & (UART_XMIT_SIZE - 1);
+	}
+}
+
 /**
  * cdns_uart_handle_tx - Handle the bytes to be Txed.
  * @dev_id: Id of the UART port
@@ -311,6 +400,14 @@ static void cdns_uart_handle_tx(void *dev_id)
 		writel(CDNS_UART_IXR_TXEMPTY, port->membase + CDNS_UART_IDR);
 	} else {
 		numbytes = port->fifosize;
+
+		/* An empty FIFO is filled blind, else until it reports full */
+		if (readl(port->membase + CDNS_UART_SR) &
+		    CDNS_UART_SR_TXEMPTY) {
+			cdns_uart_tx_burst(port);
+			numbytes = 0;
+		}
+
 		while (numbytes && !uart_circ_empty(&port->state->xmit) &&
 		       !(readl(port->membase + CDNS_UART_SR) & CDNS_UART_SR_TXFULL)) {
 			/*
@@ -341,6 +438,37 @@ static void cdns_uart_handle_tx(void *dev_id)
 	}
 }
 
+/**
+ * cdns_uart_adapt_rx_trigger - Follow the RX traffic with the trigger level
+ * @port: Pointer to the UART port
+ * @isrstatus: The interrupt status register value as read
+ *
+ * A trigger interrupt means the data keeps coming, so the level is doubled
+ * to take more bytes per interrupt.  A timeout means the burst is over,
+ * and the level drops back to the configured one for latency.
+ */
+static void cdns_uart_adapt_rx_trigger(struct uart_port *port,
+				       unsigned int isrstatus)
+{
+	struct cdns_uart *cdns_uart = port->private_data;
+	unsigned int level = cdns_uart->rx_trig_cur;
+
+	if (!cdns_uart->rx_trig_adaptive)
+		return;
+
+	if (isrstatus & CDNS_UART_IXR_TOUT)
+		level = cdns_uart->rx_trigger_level;
+	else if (isrstatus & CDNS_UART_IXR_RXTRIG)
+		level = max(min_t(unsigned int, level * 2,
+				  CDNS_UART_RX_TRIG_MAX),
+			    cdns_uart->rx_trigger_level);
+
+	if (level != cdns_uart->rx_trig_cur) {
+		cdns_uart->rx_trig_cur = level;
+		writel(level, port->membase + CDNS_UART_RXWM);
+	}
+}
+
 /**
  * cdns_uart_isr - Interrupt handler
  * @irq: Irq number
@@ -365,8 +493,10 @@ static irqreturn_t cdns_uart_isr(int irq, void *dev_id)
 		cdns_uart_handle_tx(dev_id);
 		isrstatus &= ~CDNS_UART_IXR_TXEMPTY;
 	}
-	if (isrstatus & CDNS_UART_IXR_MASK)
+	if (isrstatus & CDNS_UART_IXR_MASK) {
 		cdns_uart_handle_rx(dev_id, isrstatus);
+		cdns_uart_adapt_rx_trigger(port, isrstatus);
+	}
 
 	spin_unlock(&port->lock);
 	return IRQ_HANDLED;
@@ -548,7 +678,7 @@ static int cdns_uart_clk_notifier_cb(struct notifier_block *nb,
 		 * enable bit and RX enable bit to enable the transmitter and
 		 * receiver.
 		 */
-		writel(rx_timeout, port->membase + CDNS_UART_RXTOUT);
+		writel(cdns_uart->rx_timeout, port->membase + CDNS_UART_RXTOUT);
 		ctrl_reg = readl(port->membase + CDNS_UART_CR);
 		ctrl_reg &= ~(CDNS_UART_CR_TX_DIS | CDNS_UART_CR_RX_DIS);
 		ctrl_reg |= CDNS_UART_CR_TX_EN | CDNS_UART_CR_RX_EN;
@@ -675,6 +805,7 @@ static void cdns_uart_break_ctl(struct uart_port *port, int ctl)
 static void cdns_uart_set_termios(struct uart_port *port,
 				struct ktermios *termios, struct ktermios *old)
 {
+	struct cdns_uart *cdns_uart = port->private_data;
 	unsigned int cval = 0;
 	unsigned int baud, minbaud, maxbaud;
 	unsigned long flags;
@@ -730,7 +861,7 @@ static void cdns_uart_set_termios(struct uart_port *port,
 	ctrl_reg |= CDNS_UART_CR_TX_EN | CDNS_UART_CR_RX_EN;
 	writel(ctrl_reg, port->membase + CDNS_UART_CR);
 
-	writel(rx_timeout, port->membase + CDNS_UART_RXTOUT);
+	writel(cdns_uart->rx_timeout, port->membase + CDNS_UART_RXTOUT);
 
 	port->read_status_mask = CDNS_UART_IXR_TXEMPTY | CDNS_UART_IXR_RXTRIG |
 			CDNS_UART_IXR_OVERRUN | CDNS_UART_IXR_TOUT;
@@ -846,15 +977,16 @@ static int cdns_uart_startup(struct uart_port *port)
 
 	/*
 	 * Set the RX FIFO Trigger level to use most of the FIFO, but it
-	 * can be tuned with a module parameter
+	 * can be tuned per port in sysfs
 	 */
-	writel(rx_trigger_level, port->membase + CDNS_UART_RXWM);
+	cdns_uart->rx_trig_cur = cdns_uart->rx_trigger_level;
+	writel(cdns_uart->rx_trig_cur, port->membase + CDNS_UART_RXWM);
 
 	/*
 	 * Receive Timeout register is enabled but it
-	 * can be tuned with a module parameter
+	 * can be tuned per port in sysfs
 	 */
-	writel(rx_timeout, port->membase + CDNS_UART_RXTOUT);
+	writel(cdns_uart->rx_timeout, port->membase + CDNS_UART_RXTOUT);
 
 	/* Clear out any pending interrupts before enabling them */
 	writel(readl(port->membase + CDNS_UART_ISR),
@@ -1078,6 +1210,93 @@ static void cdns_uart_pm(struct uart_port *port, unsigned int state,
 	}
 }
 
+/*
+ * Per port RX tuning in sysfs: the trigger level, the timeout and whether
+ * the trigger level adapts to the traffic.  A low trigger level suits a
+ * console, a high one bulk links.
+ */
+static struct uart_port *cdns_uart_attr_port(struct device *dev)
+{
+	struct tty_port *tport = dev_get_drvdata(dev);
+	struct uart_state *state = container_of(tport, struct uart_state, port);
+
+	return state->uart_port;
+}
+
+/* Set an RX tuning field and reprogram the port if it is open */
+static ssize_t cdns_uart_store_rx_attr(struct device *dev, const char *buf,
+				       size_t count, unsigned int *field,
+				       unsigned int min, unsigned int max)
+{
+	struct tty_port *tport = dev_get_drvdata(dev);
+	struct uart_port *port = cdns_uart_attr_port(dev);
+	struct cdns_uart *cdns_uart = port->private_data;
+	unsigned long flags;
+	unsigned int val;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &val);
+	if (ret)
+		return ret;
+	if (val < min || val > max)
+		return -EINVAL;
+
+	mutex_lock(&tport->mutex);
+	spin_lock_irqsave(&port->lock, flags);
+
+	*field = val;
+	cdns_uart->rx_trig_cur = cdns_uart->rx_trigger_level;
+
+	/* The clocks are only on while the port is open */
+	if (tty_port_initialized(tport)) {
+		writel(cdns_uart->rx_trig_cur, port->membase + CDNS_UART_RXWM);
+		writel(cdns_uart->rx_timeout, port->membase + CDNS_UART_RXTOUT);
+	}
+
+	spin_unlock_irqrestore(&port->lock, flags);
+	mutex_unlock(&tport->mutex);
+
+	return count;
+}
+
+#define CDNS_UART_RX_ATTR(_name, _field, _min, _max)			\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct cdns_uart *cdns_uart =					\
+		cdns_uart_attr_port(dev)->private_data;			\
+									\
+	return snprintf(buf, PAGE_SIZE, "%u\n", cdns_uart->_field);	\
+}									\
+									\
+static ssize_t _name##_store(struct device *dev,			\
+			     struct device_attribute *attr,		\
+			     const char *buf, size_t count)		\
+{									\
+	struct cdns_uart *cdns_uart =					\
+		cdns_uart_attr_port(dev)->private_data;			\
+									\
+	return cdns_uart_store_rx_attr(dev, buf, count,			\
+				       &cdns_uart->_field, _min, _max);	\
+}									\
+static DEVICE_ATTR_RW(_name)
+
+CDNS_UART_RX_ATTR(rx_trigger_level, rx_trigger_level,
+		  1, CDNS_UART_FIFO_SIZE - 1);
+CDNS_UART_RX_ATTR(rx_timeout, rx_timeout, 1, 255);
+CDNS_UART_RX_ATTR(rx_trigger_adaptive, rx_trig_adaptive, 0, 1);
+
+static struct attribute *cdns_uart_dev_attrs[] = {
+	&dev_attr_rx_trigger_level.attr,
+	&dev_attr_rx_timeout.attr,
+	&dev_attr_rx_trigger_adaptive.attr,
+	NULL,
+};
+
+static struct attribute_group cdns_uart_dev_attr_group = {
+	.attrs = cdns_uart_dev_attrs,
+};
+
 static const struct uart_ops cdns_uart_ops = {
 	.set_mctrl	= cdns_uart_set_mctrl,
 	.get_mctrl	= cdns_uart_get_mctrl,
@@ -1210,6 +1429,124 @@ OF_EARLYCON_DECLARE(cdns, "cdns,uart-r1p8", cdns_early_console_setup);
 OF_EARLYCON_DECLARE(cdns, "cdns,uart-r1p12", cdns_early_console_setup);
 OF_EARLYCON_DECLARE(cdns, "xlnx,zynqmp-uart", cdns_early_console_setup);
 
+/*
+ * Asynchronous console
+ *
+ * With async_console set, the console write only queues the text, with
+ * the line ends already expanded, and a kthread feeds it to the TX FIFO
+ * while sleeping in between.  printk() then never waits for the UART, at
+ * the cost of a kernel message reaching the console a bit later.  When
+ * the queue is full the text is dropped and the number of bytes lost is
+ * reported once there is room again.  Oopses and panics flush the queue
+ * and are written synchronously.
+ */
+static bool async_console;
+module_param(async_console, bool, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(async_console, "Queue the console output and write it from a kthread");
+
+#define CDNS_UART_CONSOLE_QUEUE	16384
+
+static DEFINE_KFIFO(cdns_uart_console_queue, char, CDNS_UART_CONSOLE_QUEUE);
+static DECLARE_WAIT_QUEUE_HEAD(cdns_uart_console_wait);
+static struct task_struct *cdns_uart_console_task;
+static unsigned int cdns_uart_console_dropped;
+
+static void cdns_uart_console_wake(struct irq_work *work)
+{
+	wake_up(&cdns_uart_console_wait);
+}
+
+static struct irq_work cdns_uart_console_work = {
+	.func = cdns_uart_console_wake,
+};
+
+/**
+ * cdns_uart_console_drain - write queued console text to the TX FIFO
+ * @port: Handle to the uart port structure
+ * @wait: Wait for the TX FIFO to empty out, instead of when it is full
+ *
+ * Called with the port lock held.
+ *
+ * Return: true if the queue is empty
+ */
+static bool cdns_uart_console_drain(struct uart_port *port, bool wait)
+{
+	unsigned int ctrl;
+	char c;
+
+	ctrl = readl(port->membase + CDNS_UART_CR);
+	ctrl &= ~CDNS_UART_CR_TX_DIS;
+	ctrl |= CDNS_UART_CR_TX_EN;
+	writel(ctrl, port->membase + CDNS_UART_CR);
+
+	while (!kfifo_is_empty(&cdns_uart_console_queue)) {
+		if (readl(port->membase + CDNS_UART_SR) & CDNS_UART_SR_TXFULL) {
+			if (!wait)
+				return false;
+			cdns_uart_console_wait_tx(port);
+		}
+		if (kfifo_get(&cdns_uart_console_queue, &c))
+			writel(c, port->membase + CDNS_UART_FIFO);
+	}
+
+	return true;
+}
+
+static int cdns_uart_console_thread(void *data)
+{
+	struct uart_port *port = data;
+	unsigned long flags;
+	bool empty;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible(cdns_uart_console_wait,
+				!kfifo_is_empty(&cdns_uart_console_queue) ||
+				kthread_should_stop());
+
+		spin_lock_irqsave(&port->lock, flags);
+		empty = cdns_uart_console_drain(port, false);
+		spin_unlock_irqrestore(&port->lock, flags);
+
+		/* Half of the FIFO goes out in about 3 ms at 115200 baud */
+		if (!empty)
+			usleep_range(2000, 4000);
+	}
+
+	return 0;
+}
+
+/* Queue console text, the line ends are expanded as uart_console_write does */
+static void cdns_uart_console_queue_text(const char *s, unsigned int count)
+{
+	char msg[40];
+	int len;
+
+	if (cdns_uart_console_dropped) {
+		len = scnprintf(msg, sizeof(msg),
+				"\r\n** %u console bytes dropped\r\n",
+				cdns_uart_console_dropped);
+		if (kfifo_avail(&cdns_uart_console_queue) < len + count)
+			goto drop;
+		kfifo_in(&cdns_uart_console_queue, msg, len);
+		cdns_uart_console_dropped = 0;
+	}
+
+	for (; count; s++, count--) {
+		if (kfifo_avail(&cdns_uart_console_queue) < 2)
+			goto drop;
+		if (*s == '\n')
+			kfifo_put(&cdns_uart_console_queue, '\r');
+		kfifo_put(&cdns_uart_console_queue, *s);
+	}
+
+	irq_work_queue(&cdns_uart_console_work);
+	return;
+
+drop:
+	cdns_uart_console_dropped += count;
+	irq_work_queue(&cdns_uart_console_work);
+}
+
 /**
  * cdns_uart_console_write - perform write operation
  * @co: Console handle
@@ -1224,6 +1561,13 @@ static void cdns_uart_console_write(struct console *co, const char *s,
 	unsigned int imr, ctrl;
 	int locked = 1;
 
+	/* The console lock serializes the writers of the queue */
+	if (async_console && cdns_uart_console_task && !oops_in_progress &&
+	    !port->sysrq) {
+		cdns_uart_console_queue_text(s, count);
+		return;
+	}
+
 	if (port->sysrq)
 		locked = 0;
 	else if (oops_in_progress)
@@ -1244,6 +1588,8 @@ static void cdns_uart_console_write(struct console *co, const char *s,
 	ctrl |= CDNS_UART_CR_TX_EN;
 	writel(ctrl, port->membase + CDNS_UART_CR);
 
+	/* What is still queued comes first */
+	cdns_uart_console_drain(port, true);
 	uart_console_write(port, s, count, cdns_uart_console_putchar);
 	cdns_uart_console_wait_tx(port);
 
@@ -1311,6 +1657,26 @@ static int __init cdns_uart_console_init(void)
 
 console_initcall(cdns_uart_console_init);
 
+/* Needs the kthreads, the console itself is registered long before */
+static int __init cdns_uart_console_async_init(void)
+{
+	struct task_struct *task;
+
+	if (cdns_uart_console.index < 0 ||
+	    !cdns_uart_port[cdns_uart_console.index].membase)
+		return 0;
+
+	task = kthread_run(cdns_uart_console_thread,
+			   &cdns_uart_port[cdns_uart_console.index],
+			   "cdns_uart_console");
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+	cdns_uart_console_task = task;
+
+	return 0;
+}
+late_initcall(cdns_uart_console_async_init);
+
 #endif /* CONFIG_SERIAL_XILINX_PS_UART_CONSOLE */
 
 static struct uart_driver cdns_uart_uart_driver = {
@@ -1379,6 +1745,7 @@ static int cdns_uart_suspend(struct device *device)
 static int cdns_uart_resume(struct device *device)
 {
 	struct uart_port *port = dev_get_drvdata(device);
+	struct cdns_uart *cdns_uart = port->private_data;
 	unsigned long flags = 0;
 	u32 ctrl_reg;
 	struct tty_struct *tty;
@@ -1394,8 +1761,6 @@ static int cdns_uart_resume(struct device *device)
 	}
 
 	if (console_suspend_enabled && !may_wake) {
-		struct cdns_uart *cdns_uart = port->private_data;
-
 		clk_enable(cdns_uart->pclk);
 		clk_enable(cdns_uart->uartclk);
 
@@ -1410,7 +1775,7 @@ static int cdns_uart_resume(struct device *device)
 			cpu_relax();
 
 		/* restore rx timeout value */
-		writel(rx_timeout, port->membase + CDNS_UART_RXTOUT);
+		writel(cdns_uart->rx_timeout, port->membase + CDNS_UART_RXTOUT);
 		/* Enable Tx/Rx */
 		ctrl_reg = readl(port->membase + CDNS_UART_CR);
 		ctrl_reg &= ~(CDNS_UART_CR_TX_DIS | CDNS_UART_CR_RX_DIS);
@@ -1423,7 +1788,7 @@ static int cdns_uart_resume(struct device *device)
 	} else {
 		spin_lock_irqsave(&port->lock, flags);
 		/* restore original rx trigger level */
-		writel(rx_trigger_level, port->membase + CDNS_UART_RXWM);
+		writel(cdns_uart->rx_trig_cur, port->membase + CDNS_UART_RXWM);
 		/* enable RX timeout interrupt */
 		writel(CDNS_UART_IXR_TOUT, port->membase + CDNS_UART_IER);
 		spin_unlock_irqrestore(&port->lock, flags);
@@ -1499,6 +1864,11 @@ static int cdns_uart_probe(struct platform_device *pdev)
 		cdns_uart_data->quirks = data->quirks;
 	}
 
+	cdns_uart_data->rx_trigger_level = clamp(rx_trigger_level, 1,
+						 CDNS_UART_FIFO_SIZE - 1);
+	cdns_uart_data->rx_timeout = clamp(rx_timeout, 1, 255);
+	cdns_uart_data->rx_trig_cur = cdns_uart_data->rx_trigger_level;
+
 	cdns_uart_data->pclk = devm_clk_get(&pdev->dev, "pclk");
 	if (IS_ERR(cdns_uart_data->pclk)) {
 		cdns_uart_data->pclk = devm_clk_get(&pdev->dev, "aper_clk");
@@ -1575,6 +1945,7 @@ static int cdns_uart_probe(struct platform_device *pdev)
 	port->dev = &pdev->dev;
 	port->uartclk = clk_get_rate(cdns_uart_data->uartclk);
 	port->private_data = cdns_uart_data;
+	port->attr_group = &cdns_uart_dev_attr_group;
 	cdns_uart_data->port = port;
 	platform_set_drvdata(pdev, port);
 
@@ -23,6 +23,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
+#include <linux/uaccess.h>
 
 #include <linux/of.h>
 #include <linux/of_platform.h>
@@ -39,6 +40,7 @@ struct uio_dmem_genirq_platdata {
 	unsigned int dmem_region_start;
 	unsigned int num_dmem_regions;
 	void *dmem_region_vaddr[MAX_UIO_MAPS];
+	unsigned long dmem_attrs;
 	struct mutex alloc_lock;
 	unsigned int refcnt;
 };
@@ -58,8 +60,9 @@ static int uio_dmem_genirq_open(struct uio_info *info, struct inode *inode)
 		if (!uiomem->size)
 			break;
 
-		addr = dma_alloc_coherent(&priv->pdev->dev, uiomem->size,
-				(dma_addr_t *)&uiomem->addr, GFP_KERNEL);
+		addr = dma_alloc_attrs(&priv->pdev->dev, uiomem->size,
+				(dma_addr_t *)&uiomem->addr, GFP_KERNEL,
+				priv->dmem_attrs);
 		if (!addr) {
 			uiomem->addr = DMEM_MAP_ERROR;
 		}
@@ -92,9 +95,9 @@ static int uio_dmem_genirq_release(struct uio_info *info, struct inode *inode)
 		if (!uiomem->size)
 			break;
 		if (priv->dmem_region_vaddr[dmem_region]) {
-			dma_free_coherent(&priv->pdev->dev, uiomem->size,
+			dma_free_attrs(&priv->pdev->dev, uiomem->size,
 					priv->dmem_region_vaddr[dmem_region],
-					uiomem->addr);
+					uiomem->addr, priv->dmem_attrs);
 		}
 		uiomem->addr = DMEM_MAP_ERROR;
 		++dmem_region;
@@ -144,6 +147,53 @@ static int uio_dmem_genirq_irqcontrol(struct uio_info *dev_info, s32 irq_on)
 	return 0;
 }
 
+static long uio_dmem_genirq_ioctl(struct uio_info *dev_info, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct uio_dmem_genirq_platdata *priv = dev_info->priv;
+	struct uio_dmem_sync sync;
+	struct uio_mem *uiomem;
+	dma_addr_t addr;
+	long ret = 0;
+
+	if (cmd != UIO_DMEM_IOCTL_SYNC_FOR_CPU &&
+	    cmd != UIO_DMEM_IOCTL_SYNC_FOR_DEVICE)
+		return -ENOTTY;
+
+	if (copy_from_user(&sync, (void __user *)arg, sizeof(sync)))
+		return -EFAULT;
+
+	if (sync.map < priv->dmem_region_start ||
+	    sync.map >= priv->dmem_region_start + priv->num_dmem_regions ||
+	    sync.map >= MAX_UIO_MAPS)
+		return -EINVAL;
+
+	uiomem = &dev_info->mem[sync.map];
+	if (sync.offset > uiomem->size || sync.size > uiomem->size - sync.offset)
+		return -EINVAL;
+
+	/* Uncached buffers are always in sync */
+	if (uiomem->memtype != UIO_MEM_PHYS_CACHED)
+		return 0;
+
+	mutex_lock(&priv->alloc_lock);
+	if (uiomem->addr == DMEM_MAP_ERROR) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	addr = uiomem->addr + sync.offset;
+	if (cmd == UIO_DMEM_IOCTL_SYNC_FOR_CPU)
+		dma_sync_single_for_cpu(&priv->pdev->dev, addr, sync.size,
+					DMA_BIDIRECTIONAL);
+	else
+		dma_sync_single_for_device(&priv->pdev->dev, addr, sync.size,
+					   DMA_BIDIRECTIONAL);
+out:
+	mutex_unlock(&priv->alloc_lock);
+	return ret;
+}
+
 static int uio_dmem_genirq_probe(struct platform_device *pdev)
 {
 	struct uio_dmem_genirq_pdata *pdata = dev_get_platdata(&pdev->dev);
@@ -232,6 +282,14 @@ static int uio_dmem_genirq_probe(struct platform_device *pdev)
 	priv->dmem_region_start = uiomem - &uioinfo->mem[0];
 	priv->num_dmem_regions = pdata->num_dynamic_regions;
 
+	/*
+	 * Cached buffers are not mapped by the kernel, so that the only
+	 * mapping left is the cacheable linear one, matching the mapping
+	 * userspace gets. The CPU caches are then handled through ioctls.
+	 */
+	if (pdata->cached)
+		priv->dmem_attrs = DMA_ATTR_NO_KERNEL_MAPPING;
+
 	for (i = 0; i < pdata->num_dynamic_regions; ++i) {
 		if (uiomem >= &uioinfo->mem[MAX_UIO_MAPS]) {
 			dev_warn(&pdev->dev, "device has more than "
@@ -239,7 +297,8 @@ static int uio_dmem_genirq_probe(struct platform_device *pdev)
 					" dynamic and fixed memory regions.\n");
 			break;
 		}
-		uiomem->memtype = UIO_MEM_PHYS;
+		uiomem->memtype = pdata->cached ? UIO_MEM_PHYS_CACHED :
+						  UIO_MEM_PHYS;
 		uiomem->addr = DMEM_MAP_ERROR;
 		uiomem->size = pdata->dynamic_region_sizes[i];
 		++uiomem;
@@ -263,6 +322,7 @@ static int uio_dmem_genirq_probe(struct platform_device *pdev)
 	uioinfo->irqcontrol = uio_dmem_genirq_irqcontrol;
 	uioinfo->open = uio_dmem_genirq_open;
 	uioinfo->release = uio_dmem_genirq_release;
+	uioinfo->ioctl = uio_dmem_genirq_ioctl;
 	uioinfo->priv = priv;
 
 	/* Enable Runtime PM for this device:
@@ -300,6 +360,7 @@ static int uio_dmem_genirq_remove(struct platform_device *pdev)
 
 	priv->uioinfo->handler = NULL;
 	priv->uioinfo->irqcontrol = NULL;
+	priv->uioinfo->ioctl = NULL;
 
 	/* kfree uioinfo for OF */
 	if (pdev->dev.of_node)
@@ -84,6 +84,9 @@ enum ci_hw_regs {
  * @ci: pointer to the controller
  * @lock: pointer to controller's spinlock
  * @td_pool: pointer to controller's TD pool
+ * @pending_td: last completed TD, freed once the next one completes
+ * @td_cache: TDs kept for reuse by the next requests on this endpoint
+ * @td_cached: number of TDs in @td_cache
  */
 struct ci_hw_ep {
 	struct usb_ep				ep;
@@ -103,6 +106,8 @@ struct ci_hw_ep {
 	spinlock_t				*lock;
 	struct dma_pool				*td_pool;
 	struct td_node				*pending_td;
+	struct list_head			td_cache;
+	unsigned int				td_cached;
 };
 
 enum ci_role {
@@ -18,6 +18,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/pm_runtime.h>
+#include <linux/scatterlist.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 #include <linux/usb/otg-fsm.h>
@@ -339,22 +340,77 @@ static int hw_usb_reset(struct ci_hdrc *ci)
  * UTIL block
  *****************************************************************************/
 
-static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
-			  unsigned length)
+/**
+ * td_node_get: gets a cleared TD for a request, from the cache if possible
+ * @hwep: endpoint
+ *
+ * Streaming gadgets keep queuing requests of the same size, the TDs of the
+ * completed ones are reused so that building a chain doesn't go through the
+ * allocators for every TD.
+ */
+static struct td_node *td_node_get(struct ci_hw_ep *hwep)
 {
-	int i;
-	u32 temp;
-	struct td_node *lastnode, *node = kzalloc(sizeof(struct td_node),
-						  GFP_ATOMIC);
+	struct td_node *node;
 
+	if (hwep->td_cached) {
+		node = list_first_entry(&hwep->td_cache, struct td_node, td);
+		list_del(&node->td);
+		hwep->td_cached--;
+		memset(node->ptr, 0, sizeof(*node->ptr));
+		return node;
+	}
+
+	node = kzalloc(sizeof(struct td_node), GFP_ATOMIC);
 	if (node == NULL)
-		return -ENOMEM;
+		return NULL;
 
 	node->ptr = dma_pool_zalloc(hwep->td_pool, GFP_ATOMIC, &node->dma);
 	if (node->ptr == NULL) {
 		kfree(node);
-		return -ENOMEM;
+		return NULL;
+	}
+
+	return node;
+}
+
+/**
+ * td_node_put: releases a TD the hardware is done with
+ * @hwep: endpoint
+ * @node: TD, already off its request's list
+ */
+static void td_node_put(struct ci_hw_ep *hwep, struct td_node *node)
+{
+	if (hwep->td_cached < TD_CACHE_MAX) {
+		list_add(&node->td, &hwep->td_cache);
+		hwep->td_cached++;
+		return;
+	}
+
+	dma_pool_free(hwep->td_pool, node->ptr, node->dma);
+	kfree(node);
+}
+
+static void td_cache_drain(struct ci_hw_ep *hwep)
+{
+	struct td_node *node, *tmpnode;
+
+	list_for_each_entry_safe(node, tmpnode, &hwep->td_cache, td) {
+		list_del(&node->td);
+		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
+		kfree(node);
 	}
+	hwep->td_cached = 0;
+}
+
+static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
+			  dma_addr_t dma, unsigned length)
+{
+	int i;
+	u32 temp;
+	struct td_node *lastnode, *node = td_node_get(hwep);
+
+	if (node == NULL)
+		return -ENOMEM;
 
 	node->ptr->token = cpu_to_le32(length << __ffs(TD_TOTAL_BYTES));
 	node->ptr->token &= cpu_to_le32(TD_TOTAL_BYTES);
@@ -368,7 +424,7 @@ static int add_td_to_list(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
 		node->ptr->token |= cpu_to_le32(mul << __ffs(TD_MULTO));
 	}
 
-	temp = (u32) (hwreq->req.dma + hwreq->req.actual);
+	temp = (u32) dma;
 	if (length) {
 		node->ptr->page[0] = cpu_to_le32(temp);
 		for (i = 1; i < TD_PAGE_COUNT; i++) {
@@ -402,6 +458,69 @@ static inline u8 _usb_addr(struct ci_hw_ep *ep)
 	return ((ep->dir == TX) ? USB_ENDPOINT_DIR_MASK : 0) | ep->num;
 }
 
+/**
+ * add_tds_for_range: builds the TDs for one DMA contiguous buffer
+ * @hwep:   endpoint
+ * @hwreq:  request
+ * @dma:    bus address of the buffer
+ * @length: length of the buffer
+ *
+ * This function returns an error code
+ */
+static int add_tds_for_range(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq,
+			     dma_addr_t dma, unsigned length)
+{
+	int pages = TD_PAGE_COUNT;
+	unsigned done = 0;
+	int ret;
+
+	/*
+	 * The first buffer could be not page aligned.
+	 * In that case we have to span into one extra td.
+	 */
+	if (dma % PAGE_SIZE)
+		pages--;
+
+	while (done < length) {
+		unsigned count = min(length - done,
+					(unsigned)(pages * CI_HDRC_PAGE_SIZE));
+
+		ret = add_td_to_list(hwep, hwreq, dma + done, count);
+		if (ret < 0)
+			return ret;
+
+		done += count;
+	}
+
+	return 0;
+}
+
+/**
+ * add_tds_for_sg: builds the TDs for a scatter-gather request
+ * @hwep:   endpoint
+ * @hwreq:  request
+ *
+ * Every entry gets TDs of its own, so the entries don't need to be page
+ * aligned. All of them but the last must be a multiple of wMaxPacketSize
+ * though, the controller ends each TD with a short packet otherwise.
+ *
+ * This function returns an error code
+ */
+static int add_tds_for_sg(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
+{
+	struct scatterlist *s;
+	int i, ret;
+
+	for_each_sg(hwreq->req.sg, s, hwreq->req.num_mapped_sgs, i) {
+		ret = add_tds_for_range(hwep, hwreq, sg_dma_address(s),
+					sg_dma_len(s));
+		if (ret < 0)
+			return ret;
+	}
+
+	return 0;
+}
+
 /**
  * _hardware_enqueue: configures a request at hardware level
  * @hwep:   endpoint
@@ -413,8 +532,6 @@ static int _hardware_enqueue(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
 {
 	struct ci_hdrc *ci = hwep->ci;
 	int ret = 0;
-	unsigned rest = hwreq->req.length;
-	int pages = TD_PAGE_COUNT;
 	struct td_node *firstnode, *lastnode;
 
 	/* don't queue twice */
@@ -428,32 +545,19 @@ static int _hardware_enqueue(struct ci_hw_ep *hwep, struct ci_hw_req *hwreq)
 	if (ret)
 		return ret;
 
-	/*
-	 * The first buffer could be not page aligned.
-	 * In that case we have to span into one extra td.
-	 */
-	if (hwreq->req.dma % PAGE_SIZE)
-		pages--;
-
-	if (rest == 0) {
-		ret = add_td_to_list(hwep, hwreq, 0);
-		if (ret < 0)
-			goto done;
-	}
-
-	while (rest > 0) {
-		unsigned count = min(hwreq->req.length - hwreq->req.actual,
-					(unsigned)(pages * CI_HDRC_PAGE_SIZE));
-		ret = add_td_to_list(hwep, hwreq, count);
-		if (ret < 0)
-			goto done;
-
-		rest -= count;
-	}
+	if (hwreq->req.length == 0)
+		ret = add_td_to_list(hwep, hwreq, 0, 0);
+	else if (hwreq->req.num_mapped_sgs)
+		ret = add_tds_for_sg(hwep, hwreq);
+	else
+		ret = add_tds_for_range(hwep, hwreq, hwreq->req.dma,
+					hwreq->req.length);
+	if (ret < 0)
+		goto done;
 
 	if (hwreq->req.zero && hwreq->req.length && hwep->dir == TX
 	    && (hwreq->req.length % hwep->ep.maxpacket == 0)) {
-		ret = add_td_to_list(hwep, hwreq, 0);
+		ret = add_td_to_list(hwep, hwreq, 0, 0);
 		if (ret < 0)
 			goto done;
 	}
@@ -522,9 +626,8 @@ static void free_pending_td(struct ci_hw_ep *hwep)
 {
 	struct td_node *pending = hwep->pending_td;
 
-	dma_pool_free(hwep->td_pool, pending->ptr, pending->dma);
 	hwep->pending_td = NULL;
-	kfree(pending);
+	td_node_put(hwep, pending);
 }
 
 static int reprime_dtd(struct ci_hdrc *ci, struct ci_hw_ep *hwep,
@@ -639,10 +742,8 @@ __acquires(hwep->lock)
 						     struct ci_hw_req, queue);
 
 		list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-			dma_pool_free(hwep->td_pool, node->ptr, node->dma);
 			list_del_init(&node->td);
-			node->ptr = NULL;
-			kfree(node);
+			td_node_put(hwep, node);
 		}
 
 		list_del_init(&hwreq->queue);
@@ -978,22 +1079,35 @@ __acquires(hwep->lock)
 {
 	struct ci_hw_req *hwreq, *hwreqtemp;
 	struct ci_hw_ep *hweptemp = hwep;
+	LIST_HEAD(done);
 	int retval = 0;
 
+	/*
+	 * Take every finished request off the queue first and give them
+	 * back in one go, a chain of several requests completing on one
+	 * interrupt then costs a single unlock. Requests the gadget queues
+	 * from its completion are appended to the running chain.
+	 */
 	list_for_each_entry_safe(hwreq, hwreqtemp, &hwep->qh.queue,
 			queue) {
 		retval = _hardware_dequeue(hwep, hwreq);
 		if (retval < 0)
 			break;
-		list_del_init(&hwreq->queue);
-		if (hwreq->req.complete != NULL) {
-			spin_unlock(hwep->lock);
+		list_move_tail(&hwreq->queue, &done);
+	}
+
+	if (!list_empty(&done)) {
+		spin_unlock(hwep->lock);
+		list_for_each_entry_safe(hwreq, hwreqtemp, &done, queue) {
+			list_del_init(&hwreq->queue);
+			if (hwreq->req.complete == NULL)
+				continue;
 			if ((hwep->type == USB_ENDPOINT_XFER_CONTROL) &&
 					hwreq->req.length)
 				hweptemp = hwep->ci->ep0in;
 			usb_gadget_giveback_request(&hweptemp->ep, &hwreq->req);
-			spin_lock(hwep->lock);
 		}
+		spin_lock(hwep->lock);
 	}
 
 	if (retval == -EBUSY)
@@ -1370,10 +1484,8 @@ static void ep_free_request(struct usb_ep *ep, struct usb_request *req)
 	spin_lock_irqsave(hwep->lock, flags);
 
 	list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
 		list_del_init(&node->td);
-		node->ptr = NULL;
-		kfree(node);
+		td_node_put(hwep, node);
 	}
 
 	kfree(hwreq);
@@ -1424,9 +1536,8 @@ static int ep_dequeue(struct usb_ep *ep, struct usb_request *req)
 	hw_ep_flush(hwep->ci, hwep->num, hwep->dir);
 
 	list_for_each_entry_safe(node, tmpnode, &hwreq->tds, td) {
-		dma_pool_free(hwep->td_pool, node->ptr, node->dma);
 		list_del(&node->td);
-		kfree(node);
+		td_node_put(hwep, node);
 	}
 
 	/* pop request */
@@ -1678,6 +1789,7 @@ static int init_eps(struct ci_hdrc *ci)
 			usb_ep_set_maxpacket_limit(&hwep->ep, (unsigned short)~0);
 
 			INIT_LIST_HEAD(&hwep->qh.queue);
+			INIT_LIST_HEAD(&hwep->td_cache);
 			hwep->qh.ptr = dma_pool_zalloc(ci->qh_pool, GFP_KERNEL,
 						       &hwep->qh.dma);
 			if (hwep->qh.ptr == NULL)
@@ -1712,6 +1824,7 @@ static void destroy_eps(struct ci_hdrc *ci)
 
 		if (hwep->pending_td)
 			free_pending_td(hwep);
+		td_cache_drain(hwep);
 		dma_pool_free(ci->qh_pool, hwep->qh.ptr, hwep->qh.dma);
 	}
 }
@@ -1896,6 +2009,7 @@ static int udc_start(struct ci_hdrc *ci)
 	ci->gadget.ops          = &usb_gadget_ops;
 	ci->gadget.speed        = USB_SPEED_UNKNOWN;
 	ci->gadget.max_speed    = USB_SPEED_HIGH;
+	ci->gadget.sg_supported = 1;
 	ci->gadget.name         = ci->platdata->name;
 	ci->gadget.otg_caps	= otg_caps;
 
@@ -18,6 +18,7 @@
 #define CTRL_PAYLOAD_MAX   64
 #define RX        0  /* similar to USB_DIR_OUT but can be used as an index */
 #define TX        1  /* similar to USB_DIR_IN  but can be used as an index */
+#define TD_CACHE_MAX      32  /* TDs kept per endpoint for the next requests */
 
 /* DMA layout of transfer descriptors */
 struct ci_hw_td {
@@ -1858,6 +1858,28 @@ void usb_hcd_giveback_urb(struct usb_hcd *hcd, struct urb *urb, int status)
 }
 EXPORT_SYMBOL_GPL(usb_hcd_giveback_urb);
 
+/**
+ * usb_hcd_giveback_urb_direct - return URB from HCD without deferral
+ * @hcd: host controller returning the URB
+ * @urb: urb being returned to the USB device driver.
+ * @status: completion status code for the URB.
+ * Context: in_interrupt()
+ *
+ * Like usb_hcd_giveback_urb(), but calls the completion function right
+ * away even when the HCD otherwise gives URBs back from a tasklet. Meant
+ * for latency sensitive interrupt transfers; the HCD must have released
+ * its locks, since the completion function may resubmit the URB.
+ */
+void usb_hcd_giveback_urb_direct(struct usb_hcd *hcd, struct urb *urb,
+				 int status)
+{
+	if (likely(!urb->unlinked))
+		urb->unlinked = status;
+
+	__usb_hcd_giveback_urb(urb);
+}
+EXPORT_SYMBOL_GPL(usb_hcd_giveback_urb_direct);
+
 /*-------------------------------------------------------------------------*/
 
 /* Cancel all URBs pending on this endpoint and wait for the endpoint's
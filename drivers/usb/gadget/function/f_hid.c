@@ -14,6 +14,7 @@
 #include <linux/hid.h>
 #include <linux/idr.h>
 #include <linux/cdev.h>
+#include <linux/input.h>
 #include <linux/mutex.h>
 #include <linux/poll.h>
 #include <linux/uaccess.h>
@@ -26,6 +27,11 @@
 
 #define HIDG_MINORS	4
 
+/* Report of the input bridge: 16 buttons and a hat switch */
+#define HIDG_INPUT_REPORT_LENGTH	3
+#define HIDG_INPUT_BUTTONS		16
+#define HIDG_INPUT_HAT_NULL		8
+
 static int major, minors;
 static struct class *hidg_class;
 static DEFINE_IDA(hidg_ida);
@@ -47,6 +53,7 @@ struct f_hidg {
 	unsigned short			report_desc_length;
 	char				*report_desc;
 	unsigned short			report_length;
+	unsigned char			interval;
 
 	/* recv report */
 	struct list_head		completed_out_req;
@@ -60,6 +67,17 @@ struct f_hidg {
 	wait_queue_head_t		write_queue;
 	struct usb_request		*req;
 
+	/* input bridge, reports sent from the input event callback */
+	char				*input_name;
+	struct input_handler		input_handler;
+	struct input_handle		input_handle;
+	bool				input_connected;
+	struct usb_request		*input_req;	/* NULL when disabled */
+	bool				input_busy;	/* input_req queued */
+	bool				input_dirty;	/* report not sent */
+	u8				input_report[HIDG_INPUT_REPORT_LENGTH];
+	int				input_hat[2];	/* ABS_HAT0X/Y */
+
 	int				minor;
 	struct cdev			cdev;
 	struct usb_function		func;
@@ -452,6 +470,186 @@ static int f_hidg_open(struct inode *inode, struct file *fd)
 	return 0;
 }
 
+/*-------------------------------------------------------------------------*/
+/*                              Input bridge                               */
+
+/*
+ * With the input attribute set, the function forwards the events of the
+ * named input device, such as the built-in gamepad, as reports of the
+ * descriptor below. Reports are queued on the IN endpoint right from the
+ * input event callback, with no round trip through userspace. While one
+ * is in flight, later changes are coalesced into the next report, sent
+ * from the completion.
+ */
+static const u8 hidg_input_report_desc[] = {
+	0x05, 0x01,		/* Usage Page (Generic Desktop) */
+	0x09, 0x05,		/* Usage (Game Pad) */
+	0xa1, 0x01,		/* Collection (Application) */
+	0x05, 0x09,		/*   Usage Page (Button) */
+	0x19, 0x01,		/*   Usage Minimum (1) */
+	0x29, 0x10,		/*   Usage Maximum (16) */
+	0x15, 0x00,		/*   Logical Minimum (0) */
+	0x25, 0x01,		/*   Logical Maximum (1) */
+	0x75, 0x01,		/*   Report Size (1) */
+	0x95, 0x10,		/*   Report Count (16) */
+	0x81, 0x02,		/*   Input (Data, Var, Abs) */
+	0x05, 0x01,		/*   Usage Page (Generic Desktop) */
+	0x09, 0x39,		/*   Usage (Hat Switch) */
+	0x15, 0x00,		/*   Logical Minimum (0) */
+	0x25, 0x07,		/*   Logical Maximum (7) */
+	0x35, 0x00,		/*   Physical Minimum (0) */
+	0x46, 0x3b, 0x01,	/*   Physical Maximum (315) */
+	0x65, 0x14,		/*   Unit (Degrees) */
+	0x75, 0x04,		/*   Report Size (4) */
+	0x95, 0x01,		/*   Report Count (1) */
+	0x81, 0x42,		/*   Input (Data, Var, Abs, Null) */
+	0x65, 0x00,		/*   Unit (None) */
+	0x81, 0x03,		/*   Input (Const, Var, Abs) */
+	0xc0,			/* End Collection */
+};
+
+/* Hat switch value, indexed by ABS_HAT0Y + 1 and ABS_HAT0X + 1 */
+static const u8 hidg_input_hat[3][3] = {
+	{ 7, 0, 1 },
+	{ 6, HIDG_INPUT_HAT_NULL, 2 },
+	{ 5, 4, 3 },
+};
+
+/* Called with write_spinlock held */
+static void hidg_input_send(struct f_hidg *hidg)
+{
+	struct usb_request *req = hidg->input_req;
+
+	if (!req || hidg->input_busy || !hidg->input_dirty)
+		return;
+
+	memcpy(req->buf, hidg->input_report, HIDG_INPUT_REPORT_LENGTH);
+	req->length = HIDG_INPUT_REPORT_LENGTH;
+	req->zero = 0;
+
+	if (usb_ep_queue(hidg->in_ep, req, GFP_ATOMIC))
+		return;
+
+	hidg->input_busy = true;
+	hidg->input_dirty = false;
+}
+
+static void hidg_input_complete(struct usb_ep *ep, struct usb_request *req)
+{
+	struct f_hidg *hidg = req->context;
+	unsigned long flags;
+
+	spin_lock_irqsave(&hidg->write_spinlock, flags);
+	hidg->input_busy = false;
+	if (req->status == 0)
+		hidg_input_send(hidg);
+	spin_unlock_irqrestore(&hidg->write_spinlock, flags);
+}
+
+static void hidg_input_event(struct input_handle *handle, unsigned int type,
+			     unsigned int code, int value)
+{
+	struct f_hidg *hidg = handle->private;
+	u8 *report = hidg->input_report;
+	unsigned long flags;
+	unsigned int bit;
+
+	spin_lock_irqsave(&hidg->write_spinlock, flags);
+
+	switch (type) {
+	case EV_KEY:
+		if (code < BTN_GAMEPAD ||
+		    code >= BTN_GAMEPAD + HIDG_INPUT_BUTTONS)
+			break;
+		bit = code - BTN_GAMEPAD;
+		if (value)
+			report[bit / 8] |= BIT(bit % 8);
+		else
+			report[bit / 8] &= ~BIT(bit % 8);
+		break;
+	case EV_ABS:
+		if (code != ABS_HAT0X && code != ABS_HAT0Y)
+			break;
+		hidg->input_hat[code - ABS_HAT0X] = clamp(value, -1, 1);
+		report[2] = hidg_input_hat[hidg->input_hat[1] + 1]
+					  [hidg->input_hat[0] + 1];
+		break;
+	case EV_SYN:
+		if (code != SYN_REPORT)
+			break;
+		hidg->input_dirty = true;
+		hidg_input_send(hidg);
+		break;
+	}
+
+	spin_unlock_irqrestore(&hidg->write_spinlock, flags);
+}
+
+static int hidg_input_connect(struct input_handler *handler,
+			      struct input_dev *dev,
+			      const struct input_device_id *id)
+{
+	struct f_hidg *hidg = container_of(handler, struct f_hidg,
+					   input_handler);
+	struct input_handle *handle = &hidg->input_handle;
+	int ret;
+
+	if (hidg->input_connected || !dev->name ||
+	    strcmp(dev->name, hidg->input_name))
+		return -ENODEV;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "hidg";
+	handle->private = hidg;
+
+	ret = input_register_handle(handle);
+	if (ret)
+		return ret;
+
+	ret = input_open_device(handle);
+	if (ret) {
+		input_unregister_handle(handle);
+		return ret;
+	}
+
+	hidg->input_connected = true;
+
+	return 0;
+}
+
+static void hidg_input_disconnect(struct input_handle *handle)
+{
+	struct f_hidg *hidg = handle->private;
+
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	hidg->input_connected = false;
+}
+
+static const struct input_device_id hidg_input_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static int hidg_input_register(struct f_hidg *hidg)
+{
+	struct input_handler *handler = &hidg->input_handler;
+
+	hidg->input_report[2] = HIDG_INPUT_HAT_NULL;
+
+	handler->event = hidg_input_event;
+	handler->connect = hidg_input_connect;
+	handler->disconnect = hidg_input_disconnect;
+	handler->name = "hidg";
+	handler->id_table = hidg_input_ids;
+
+	return input_register_handler(handler);
+}
+
 /*-------------------------------------------------------------------------*/
 /*                                usb_function                             */
 
@@ -619,6 +817,12 @@ static void hidg_disable(struct usb_function *f)
 	}
 
 	hidg->req = NULL;
+
+	/* Disabling the endpoint gave the request back */
+	if (hidg->input_req) {
+		free_ep_req(hidg->in_ep, hidg->input_req);
+		hidg->input_req = NULL;
+	}
 	spin_unlock_irqrestore(&hidg->write_spinlock, flags);
 }
 
@@ -627,6 +831,7 @@ static int hidg_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 	struct usb_composite_dev		*cdev = f->config->cdev;
 	struct f_hidg				*hidg = func_to_hidg(f);
 	struct usb_request			*req_in = NULL;
+	struct usb_request			*input_req = NULL;
 	unsigned long				flags;
 	int i, status = 0;
 
@@ -654,6 +859,17 @@ static int hidg_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 			status = -ENOMEM;
 			goto disable_ep_in;
 		}
+
+		if (hidg->input_name) {
+			input_req = hidg_alloc_ep_req(hidg->in_ep,
+						      HIDG_INPUT_REPORT_LENGTH);
+			if (!input_req) {
+				status = -ENOMEM;
+				goto free_req_in;
+			}
+			input_req->complete = hidg_input_complete;
+			input_req->context = hidg;
+		}
 	}
 
 
@@ -702,6 +918,14 @@ static int hidg_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 		spin_lock_irqsave(&hidg->write_spinlock, flags);
 		hidg->req = req_in;
 		hidg->write_pending = 0;
+
+		if (hidg->input_req)
+			free_ep_req(hidg->in_ep, hidg->input_req);
+		hidg->input_req = input_req;
+		hidg->input_busy = false;
+		/* Let the host know the current state */
+		hidg->input_dirty = true;
+		hidg_input_send(hidg);
 		spin_unlock_irqrestore(&hidg->write_spinlock, flags);
 
 		wake_up(&hidg->write_queue);
@@ -710,6 +934,8 @@ static int hidg_set_alt(struct usb_function *f, unsigned intf, unsigned alt)
 disable_out_ep:
 	usb_ep_disable(hidg->out_ep);
 free_req_in:
+	if (input_req)
+		free_ep_req(hidg->in_ep, input_req);
 	if (req_in)
 		free_ep_req(hidg->in_ep, req_in);
 
@@ -778,6 +1004,20 @@ static int hidg_bind(struct usb_configuration *c, struct usb_function *f)
 				cpu_to_le16(hidg->report_length);
 	hidg_hs_out_ep_desc.wMaxPacketSize = cpu_to_le16(hidg->report_length);
 	hidg_fs_out_ep_desc.wMaxPacketSize = cpu_to_le16(hidg->report_length);
+
+	/* interval is in frames, high speed polls every 2^(bInterval-1) */
+	if (hidg->interval) {
+		hidg_fs_in_ep_desc.bInterval = hidg->interval;
+		hidg_hs_in_ep_desc.bInterval = fls(hidg->interval) + 3;
+	} else {
+		hidg_fs_in_ep_desc.bInterval = 10;
+		hidg_hs_in_ep_desc.bInterval = 4;
+	}
+	hidg_fs_out_ep_desc.bInterval = hidg_fs_in_ep_desc.bInterval;
+	hidg_hs_out_ep_desc.bInterval = hidg_hs_in_ep_desc.bInterval;
+	hidg_ss_in_ep_desc.bInterval = hidg_hs_in_ep_desc.bInterval;
+	hidg_ss_out_ep_desc.bInterval = hidg_hs_in_ep_desc.bInterval;
+
 	/*
 	 * We can use hidg_desc struct here but we should not relay
 	 * that its content won't change after returning from this function.
@@ -823,7 +1063,15 @@ static int hidg_bind(struct usb_configuration *c, struct usb_function *f)
 		goto del;
 	}
 
+	if (hidg->input_name) {
+		status = hidg_input_register(hidg);
+		if (status)
+			goto destroy;
+	}
+
 	return 0;
+destroy:
+	device_destroy(hidg_class, dev);
 del:
 	cdev_del(&hidg->cdev);
 fail_free_descs:
@@ -913,6 +1161,7 @@ CONFIGFS_ATTR(f_hid_opts_, name)
 F_HID_OPT(subclass, 8, 255);
 F_HID_OPT(protocol, 8, 255);
 F_HID_OPT(report_length, 16, 65535);
+F_HID_OPT(interval, 8, 255);
 
 static ssize_t f_hid_opts_report_desc_show(struct config_item *item, char *page)
 {
@@ -959,6 +1208,48 @@ end:
 
 CONFIGFS_ATTR(f_hid_opts_, report_desc);
 
+static ssize_t f_hid_opts_input_show(struct config_item *item, char *page)
+{
+	struct f_hid_opts *opts = to_f_hid_opts(item);
+	int result;
+
+	mutex_lock(&opts->lock);
+	result = sprintf(page, "%s\n", opts->input ? : "");
+	mutex_unlock(&opts->lock);
+
+	return result;
+}
+
+static ssize_t f_hid_opts_input_store(struct config_item *item,
+				      const char *page, size_t len)
+{
+	struct f_hid_opts *opts = to_f_hid_opts(item);
+	int ret = -EBUSY;
+	char *name = NULL;
+
+	mutex_lock(&opts->lock);
+
+	if (opts->refcnt)
+		goto end;
+
+	/* An empty name turns the bridge off */
+	if (len && page[0] != '\n') {
+		name = kstrndup(page, strcspn(page, "\n"), GFP_KERNEL);
+		if (!name) {
+			ret = -ENOMEM;
+			goto end;
+		}
+	}
+	kfree(opts->input);
+	opts->input = name;
+	ret = len;
+end:
+	mutex_unlock(&opts->lock);
+	return ret;
+}
+
+CONFIGFS_ATTR(f_hid_opts_, input);
+
 static ssize_t f_hid_opts_dev_show(struct config_item *item, char *page)
 {
 	struct f_hid_opts *opts = to_f_hid_opts(item);
@@ -973,6 +1264,8 @@ static struct configfs_attribute *hid_attrs[] = {
 	&f_hid_opts_attr_protocol,
 	&f_hid_opts_attr_report_length,
 	&f_hid_opts_attr_report_desc,
+	&f_hid_opts_attr_interval,
+	&f_hid_opts_attr_input,
 	&f_hid_opts_attr_dev,
 	NULL,
 };
@@ -1004,6 +1297,7 @@ static void hidg_free_inst(struct usb_function_instance *f)
 
 	if (opts->report_desc_alloc)
 		kfree(opts->report_desc);
+	kfree(opts->input);
 
 	kfree(opts);
 }
@@ -1055,6 +1349,7 @@ static void hidg_free(struct usb_function *f)
 	hidg = func_to_hidg(f);
 	opts = container_of(f->fi, struct f_hid_opts, func_inst);
 	kfree(hidg->report_desc);
+	kfree(hidg->input_name);
 	kfree(hidg);
 	mutex_lock(&opts->lock);
 	--opts->refcnt;
@@ -1065,6 +1360,9 @@ static void hidg_unbind(struct usb_configuration *c, struct usb_function *f)
 {
 	struct f_hidg *hidg = func_to_hidg(f);
 
+	if (hidg->input_name)
+		input_unregister_handler(&hidg->input_handler);
+
 	device_destroy(hidg_class, MKDEV(major, hidg->minor));
 	cdev_del(&hidg->cdev);
 
@@ -1091,7 +1389,25 @@ static struct usb_function *hidg_alloc(struct usb_function_instance *fi)
 	hidg->bInterfaceProtocol = opts->protocol;
 	hidg->report_length = opts->report_length;
 	hidg->report_desc_length = opts->report_desc_length;
-	if (opts->report_desc) {
+	hidg->interval = opts->interval;
+	if (opts->input) {
+		/* The bridge sends its own reports, poll every frame */
+		hidg->input_name = kstrdup(opts->input, GFP_KERNEL);
+		hidg->report_desc = kmemdup(hidg_input_report_desc,
+					    sizeof(hidg_input_report_desc),
+					    GFP_KERNEL);
+		if (!hidg->input_name || !hidg->report_desc) {
+			kfree(hidg->input_name);
+			kfree(hidg->report_desc);
+			kfree(hidg);
+			mutex_unlock(&opts->lock);
+			return ERR_PTR(-ENOMEM);
+		}
+		hidg->report_desc_length = sizeof(hidg_input_report_desc);
+		hidg->report_length = HIDG_INPUT_REPORT_LENGTH;
+		if (!hidg->interval)
+			hidg->interval = 1;
+	} else if (opts->report_desc) {
 		hidg->report_desc = kmemdup(opts->report_desc,
 					    opts->report_desc_length,
 					    GFP_KERNEL);
@@ -209,6 +209,7 @@
 #include <linux/kthread.h>
 #include <linux/sched/signal.h>
 #include <linux/limits.h>
+#include <linux/pagemap.h>
 #include <linux/rwsem.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
@@ -449,6 +450,21 @@ static int ep0_queue(struct fsg_common *common)
 
 /* Completion handlers. These always run in_irq. */
 
+/* Drop the page cache pages a zerocopy read left in the buffer */
+static void fsg_buffhd_put_pages(struct fsg_buffhd *bh)
+{
+	unsigned int i;
+
+	if (!bh->num_pages)
+		return;
+
+	for (i = 0; i < bh->num_pages; i++)
+		put_page(sg_page(&bh->sg[i]));
+	bh->num_pages = 0;
+	bh->inreq->sg = NULL;
+	bh->inreq->num_sgs = 0;
+}
+
 static void bulk_in_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct fsg_common	*common = ep->driver_data;
@@ -463,6 +479,7 @@ static void bulk_in_complete(struct usb_ep *ep, struct usb_request *req)
 	/* Hold the lock while we update the request and buffer states */
 	smp_wmb();
 	spin_lock(&common->lock);
+	fsg_buffhd_put_pages(bh);
 	bh->inreq_busy = 0;
 	bh->state = BUF_STATE_EMPTY;
 	wakeup_thread(common);
@@ -643,6 +660,80 @@ static int sleep_thread(struct fsg_common *common, bool can_freeze)
 
 /*-------------------------------------------------------------------------*/
 
+/*
+ * Zerocopy reads need a controller that takes scatter-gather requests and
+ * a LUN whose blocks are a multiple of the bulk-in maxpacket size, so that
+ * only the last page of a buffer may end with a short packet.
+ */
+static bool fsg_can_zerocopy(struct fsg_common *common, struct fsg_lun *curlun)
+{
+	if (!curlun->zerocopy || !common->gadget->sg_supported || !common->fsg)
+		return false;
+	if (!curlun->filp->f_mapping->a_ops->readpage)
+		return false;
+
+	return curlun->blksize %
+		usb_endpoint_maxp(common->fsg->bulk_in->desc) == 0;
+}
+
+/*
+ * Point the buffer's request at the page cache pages holding the range
+ * instead of copying them into bh->buf. The pages are held until the
+ * request completes.
+ *
+ * Return: Number of bytes the request covers or a negative error code.
+ */
+static ssize_t fsg_zerocopy_read(struct fsg_lun *curlun,
+				 struct fsg_buffhd *bh, loff_t file_offset,
+				 unsigned int amount)
+{
+	struct file		*filp = curlun->filp;
+	struct address_space	*mapping = filp->f_mapping;
+	pgoff_t			last = (file_offset + amount - 1) >> PAGE_SHIFT;
+	unsigned int		done = 0;
+	struct page		*page;
+
+	sg_init_table(bh->sg, FSG_BUF_PAGES);
+	while (done < amount) {
+		loff_t		pos = file_offset + done;
+		pgoff_t		index = pos >> PAGE_SHIFT;
+		unsigned int	offset = pos & ~PAGE_MASK;
+		unsigned int	len = min_t(unsigned int, amount - done,
+					    PAGE_SIZE - offset);
+
+		/* Keep the readahead going, as vfs_read() would */
+		page = find_get_page(mapping, index);
+		if (!page) {
+			page_cache_sync_readahead(mapping, &filp->f_ra, filp,
+						  index, last + 1 - index);
+		} else {
+			if (PageReadahead(page))
+				page_cache_async_readahead(mapping,
+							   &filp->f_ra, filp,
+							   page, index,
+							   last + 1 - index);
+			put_page(page);
+		}
+
+		page = read_mapping_page(mapping, index, filp);
+		if (IS_ERR(page)) {
+			if (!done)
+				return PTR_ERR(page);
+			break;
+		}
+		mark_page_accessed(page);
+
+		sg_set_page(&bh->sg[bh->num_pages++], page, len, offset);
+		done += len;
+	}
+
+	sg_mark_end(&bh->sg[bh->num_pages - 1]);
+	bh->inreq->sg = bh->sg;
+	bh->inreq->num_sgs = bh->num_pages;
+
+	return done;
+}
+
 static int do_read(struct fsg_common *common)
 {
 	struct fsg_lun		*curlun = common->curlun;
@@ -719,10 +810,15 @@ static int do_read(struct fsg_common *common)
 		}
 
 		/* Perform the read */
-		file_offset_tmp = file_offset;
-		nread = vfs_read(curlun->filp,
-				 (char __user *)bh->buf,
-				 amount, &file_offset_tmp);
+		if (fsg_can_zerocopy(common, curlun)) {
+			nread = fsg_zerocopy_read(curlun, bh, file_offset,
+						  amount);
+		} else {
+			file_offset_tmp = file_offset;
+			nread = vfs_read(curlun->filp,
+					 (char __user *)bh->buf,
+					 amount, &file_offset_tmp);
+		}
 		VLDBG(curlun, "file read %u @ %llu -> %d\n", amount,
 		      (unsigned long long)file_offset, (int)nread);
 		if (signal_pending(current))
@@ -2416,6 +2512,7 @@ static void handle_exception(struct fsg_common *common)
 
 	for (i = 0; i < common->fsg_num_buffers; ++i) {
 		bh = &common->buffhds[i];
+		fsg_buffhd_put_pages(bh);
 		bh->state = BUF_STATE_EMPTY;
 	}
 	common->next_buffhd_to_fill = &common->buffhds[0];
@@ -2605,6 +2702,14 @@ static ssize_t nofua_show(struct device *dev, struct device_attribute *attr,
 	return fsg_show_nofua(curlun, buf);
 }
 
+static ssize_t zerocopy_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct fsg_lun		*curlun = fsg_lun_from_dev(dev);
+
+	return fsg_show_zerocopy(curlun, buf);
+}
+
 static ssize_t file_show(struct device *dev, struct device_attribute *attr,
 			 char *buf)
 {
@@ -2631,6 +2736,15 @@ static ssize_t nofua_store(struct device *dev, struct device_attribute *attr,
 	return fsg_store_nofua(curlun, buf, count);
 }
 
+static ssize_t zerocopy_store(struct device *dev,
+			      struct device_attribute *attr,
+			      const char *buf, size_t count)
+{
+	struct fsg_lun		*curlun = fsg_lun_from_dev(dev);
+
+	return fsg_store_zerocopy(curlun, buf, count);
+}
+
 static ssize_t file_store(struct device *dev, struct device_attribute *attr,
 			  const char *buf, size_t count)
 {
@@ -2641,6 +2755,7 @@ static ssize_t file_store(struct device *dev, struct device_attribute *attr,
 }
 
 static DEVICE_ATTR_RW(nofua);
+static DEVICE_ATTR_RW(zerocopy);
 /* mode wil be set in fsg_lun_attr_is_visible() */
 static DEVICE_ATTR(ro, 0, ro_show, ro_store);
 static DEVICE_ATTR(file, 0, file_show, file_store);
@@ -2818,6 +2933,7 @@ static struct attribute *fsg_lun_dev_attrs[] = {
 	&dev_attr_ro.attr,
 	&dev_attr_file.attr,
 	&dev_attr_nofua.attr,
+	&dev_attr_zerocopy.attr,
 	NULL
 };
 
@@ -3220,6 +3336,20 @@ static ssize_t fsg_lun_opts_nofua_store(struct config_item *item,
 
 CONFIGFS_ATTR(fsg_lun_opts_, nofua);
 
+static ssize_t fsg_lun_opts_zerocopy_show(struct config_item *item,
+					  char *page)
+{
+	return fsg_show_zerocopy(to_fsg_lun_opts(item)->lun, page);
+}
+
+static ssize_t fsg_lun_opts_zerocopy_store(struct config_item *item,
+					   const char *page, size_t len)
+{
+	return fsg_store_zerocopy(to_fsg_lun_opts(item)->lun, page, len);
+}
+
+CONFIGFS_ATTR(fsg_lun_opts_, zerocopy);
+
 static ssize_t fsg_lun_opts_inquiry_string_show(struct config_item *item,
 						char *page)
 {
@@ -3240,6 +3370,7 @@ static struct configfs_attribute *fsg_lun_attrs[] = {
 	&fsg_lun_opts_attr_removable,
 	&fsg_lun_opts_attr_cdrom,
 	&fsg_lun_opts_attr_nofua,
+	&fsg_lun_opts_attr_zerocopy,
 	&fsg_lun_opts_attr_inquiry_string,
 	NULL,
 };
@@ -122,6 +122,22 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
 /* Delay for the transmit to wait before sending an unfilled NTB frame. */
 #define TX_TIMEOUT_NSECS	300000
 
+/*
+ * Larger NTBs let the host and us bundle more datagrams per transfer, at
+ * the cost of bigger receive buffers. NTB16 can't describe more than 64k.
+ */
+static unsigned int ntb_in_size = NTB_DEFAULT_IN_SIZE;
+module_param(ntb_in_size, uint, S_IRUGO);
+MODULE_PARM_DESC(ntb_in_size, "largest NTB sent to the host, in bytes");
+
+static unsigned int ntb_out_size = NTB_OUT_SIZE;
+module_param(ntb_out_size, uint, S_IRUGO);
+MODULE_PARM_DESC(ntb_out_size, "largest NTB accepted from the host, in bytes");
+
+static unsigned int tx_timeout_us = TX_TIMEOUT_NSECS / NSEC_PER_USEC;
+module_param(tx_timeout_us, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(tx_timeout_us, "delay before sending an unfilled NTB");
+
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
 
@@ -538,7 +554,7 @@ static inline void ncm_reset_values(struct f_ncm *ncm)
 	ncm->port.header_len = 0;
 
 	ncm->port.fixed_out_len = le32_to_cpu(ntb_parameters.dwNtbOutMaxSize);
-	ncm->port.fixed_in_len = NTB_DEFAULT_IN_SIZE;
+	ncm->port.fixed_in_len = le32_to_cpu(ntb_parameters.dwNtbInMaxSize);
 }
 
 /*
@@ -1114,7 +1130,8 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		}
 
 		/* Delay the timer. */
-		hrtimer_start(&ncm->task_timer, TX_TIMEOUT_NSECS,
+		hrtimer_start(&ncm->task_timer,
+			      READ_ONCE(tx_timeout_us) * NSEC_PER_USEC,
 			      HRTIMER_MODE_REL);
 
 		/* Add the datagram position entries */
@@ -1422,6 +1439,11 @@ static int ncm_bind(struct usb_configuration *c, struct usb_function *f)
 	if (!can_support_ecm(cdev->gadget))
 		return -EINVAL;
 
+	ntb_parameters.dwNtbInMaxSize = cpu_to_le32(clamp_t(unsigned int,
+			ntb_in_size, USB_CDC_NCM_NTB_MIN_IN_SIZE, U16_MAX));
+	ntb_parameters.dwNtbOutMaxSize = cpu_to_le32(clamp_t(unsigned int,
+			ntb_out_size, USB_CDC_NCM_NTB_MIN_OUT_SIZE, U16_MAX));
+
 	ncm_opts = container_of(f->fi, struct f_ncm_opts, func_inst);
 	/*
 	 * in drivers/usb/gadget/configfs.c:configfs_composite_bind()
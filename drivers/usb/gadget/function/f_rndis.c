@@ -70,6 +70,17 @@
  *   - MS-Windows drivers sometimes emit undocumented requests.
  */
 
+/*
+ * Packets the host may bundle in one bulk-out transfer. Hosts that do it
+ * cost one request completion for several frames, the receive buffers
+ * grow to match.
+ */
+#define RNDIS_MAX_OUT_PKTS	8
+
+static unsigned int max_out_pkts = 4;
+module_param(max_out_pkts, uint, S_IRUGO);
+MODULE_PARM_DESC(max_out_pkts, "RNDIS packets per bulk-out transfer (1-8)");
+
 struct f_rndis {
 	struct gether			port;
 	u8				ctrl_id, data_id;
@@ -794,6 +805,7 @@ rndis_bind(struct usb_configuration *c, struct usb_function *f)
 	rndis->port.close = rndis_close;
 
 	rndis_set_param_medium(rndis->params, RNDIS_MEDIUM_802_3, 0);
+	rndis_set_param_max_pkts(rndis->params, rndis->port.max_out_frames);
 	rndis_set_host_mac(rndis->params, rndis->ethaddr);
 
 	if (rndis->manufacturer && rndis->vendorID &&
@@ -978,6 +990,8 @@ static struct usb_function *rndis_alloc(struct usb_function_instance *fi)
 
 	/* RNDIS has special (and complex) framing */
 	rndis->port.header_len = sizeof(struct rndis_packet_msg_type);
+	rndis->port.max_out_frames = clamp_t(unsigned int, max_out_pkts, 1,
+					     RNDIS_MAX_OUT_PKTS);
 	rndis->port.wrap = rndis_add_header;
 	rndis->port.unwrap = rndis_rm_hdr;
 
@@ -167,6 +167,7 @@ typedef struct rndis_params {
 	u32			medium;
 	u32			speed;
 	u32			media_state;
+	u32			max_pkts_per_xfer;
 
 	const u8		*host_mac;
 	u16			*filter;
@@ -189,6 +190,7 @@ int  rndis_set_param_vendor(struct rndis_params *params, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium(struct rndis_params *params, u32 medium,
 			     u32 speed);
+int  rndis_set_param_max_pkts(struct rndis_params *params, u32 max_pkts);
 void rndis_add_hdr(struct sk_buff *skb);
 int rndis_rm_hdr(struct gether *port, struct sk_buff *skb,
 			struct sk_buff_head *list);
@@ -331,6 +331,12 @@ ssize_t fsg_show_nofua(struct fsg_lun *curlun, char *buf)
 }
 EXPORT_SYMBOL_GPL(fsg_show_nofua);
 
+ssize_t fsg_show_zerocopy(struct fsg_lun *curlun, char *buf)
+{
+	return sprintf(buf, "%u\n", curlun->zerocopy);
+}
+EXPORT_SYMBOL_GPL(fsg_show_zerocopy);
+
 ssize_t fsg_show_file(struct fsg_lun *curlun, struct rw_semaphore *filesem,
 		      char *buf)
 {
@@ -435,6 +441,23 @@ ssize_t fsg_store_nofua(struct fsg_lun *curlun, const char *buf, size_t count)
 }
 EXPORT_SYMBOL_GPL(fsg_store_nofua);
 
+ssize_t fsg_store_zerocopy(struct fsg_lun *curlun, const char *buf,
+			   size_t count)
+{
+	bool		zerocopy;
+	int		ret;
+
+	ret = strtobool(buf, &zerocopy);
+	if (ret)
+		return ret;
+
+	/* Only taken into account by the next READ command */
+	curlun->zerocopy = zerocopy;
+
+	return count;
+}
+EXPORT_SYMBOL_GPL(fsg_store_zerocopy);
+
 ssize_t fsg_store_file(struct fsg_lun *curlun, struct rw_semaphore *filesem,
 		       const char *buf, size_t count)
 {
@@ -2,6 +2,7 @@
 #define USB_STORAGE_COMMON_H
 
 #include <linux/device.h>
+#include <linux/scatterlist.h>
 #include <linux/usb/storage.h>
 #include <scsi/scsi.h>
 #include <asm/unaligned.h>
@@ -107,6 +108,7 @@ struct fsg_lun {
 	unsigned int	registered:1;
 	unsigned int	info_valid:1;
 	unsigned int	nofua:1;
+	unsigned int	zerocopy:1;
 
 	u32		sense_data;
 	u32		sense_data_info;
@@ -128,6 +130,8 @@ static inline bool fsg_lun_is_open(struct fsg_lun *curlun)
 
 /* Default size of buffer length. */
 #define FSG_BUFLEN	((u32)16384)
+/* Page cache pages a buffer may point to, the first one can be partial */
+#define FSG_BUF_PAGES	(DIV_ROUND_UP(FSG_BUFLEN, PAGE_SIZE) + 1)
 
 /* Maximal number of LUNs supported in mass storage function */
 #define FSG_MAX_LUNS	16
@@ -152,6 +156,14 @@ struct fsg_buffhd {
 
 	struct usb_request		*inreq;
 	int				inreq_busy;
+
+	/*
+	 * With zerocopy reads the inreq points to page cache pages
+	 * instead of buf, they are held until it completes.
+	 */
+	struct scatterlist		sg[FSG_BUF_PAGES];
+	unsigned int			num_pages;
+
 	struct usb_request		*outreq;
 	int				outreq_busy;
 };
@@ -215,6 +227,7 @@ int fsg_lun_fsync_sub(struct fsg_lun *curlun);
 void store_cdrom_address(u8 *dest, int msf, u32 addr);
 ssize_t fsg_show_ro(struct fsg_lun *curlun, char *buf);
 ssize_t fsg_show_nofua(struct fsg_lun *curlun, char *buf);
+ssize_t fsg_show_zerocopy(struct fsg_lun *curlun, char *buf);
 ssize_t fsg_show_file(struct fsg_lun *curlun, struct rw_semaphore *filesem,
 		      char *buf);
 ssize_t fsg_show_inquiry_string(struct fsg_lun *curlun, char *buf);
@@ -223,6 +236,8 @@ ssize_t fsg_show_removable(struct fsg_lun *curlun, char *buf);
 ssize_t fsg_store_ro(struct fsg_lun *curlun, struct rw_semaphore *filesem,
 		     const char *buf, size_t count);
 ssize_t fsg_store_nofua(struct fsg_lun *curlun, const char *buf, size_t count);
+ssize_t fsg_store_zerocopy(struct fsg_lun *curlun, const char *buf,
+			   size_t count);
 ssize_t fsg_store_file(struct fsg_lun *curlun, struct rw_semaphore *filesem,
 		       const char *buf, size_t count);
 ssize_t fsg_store_cdrom(struct fsg_lun *curlun, struct rw_semaphore *filesem,
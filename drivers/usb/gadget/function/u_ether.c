@@ -210,6 +210,8 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 */
 	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
 	size += dev->port_usb->header_len;
+	if (dev->port_usb->max_out_frames > 1)
+		size *= dev->port_usb->max_out_frames;
 
 	if (g->quirk_ep_out_aligned_size) {
 		size += out->maxpacket - 1;
@@ -75,6 +75,8 @@ struct gether {
 	u32				fixed_out_len;
 	u32				fixed_in_len;
 	bool				supports_multi_frame;
+	/* frames the host may bundle in one bulk-out transfer (RNDIS) */
+	u32				max_out_frames;
 	struct sk_buff			*(*wrap)(struct gether *port,
 						struct sk_buff *skb);
 	int				(*unwrap)(struct gether *port,
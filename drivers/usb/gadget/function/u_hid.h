@@ -24,9 +24,11 @@ struct f_hid_opts {
 	unsigned char			subclass;
 	unsigned char			protocol;
 	unsigned short			report_length;
+	unsigned char			interval;	/* frames, 0: default */
 	unsigned short			report_desc_length;
 	unsigned char			*report_desc;
 	bool				report_desc_alloc;
+	char				*input;		/* input device name */
 
 	/*
 	 * Protect the data form concurrent access by read/write
@@ -300,6 +300,7 @@ dbg_port(struct ehci_hcd *ehci, const char *label, int port, u32 status)
 
 static int debug_async_open(struct inode *, struct file *);
 static int debug_bandwidth_open(struct inode *, struct file *);
+static int debug_intr_latency_open(struct inode *, struct file *);
 static int debug_periodic_open(struct inode *, struct file *);
 static int debug_registers_open(struct inode *, struct file *);
 
@@ -322,6 +323,14 @@ static const struct file_operations debug_bandwidth_fops = {
 	.llseek		= default_llseek,
 };
 
+static const struct file_operations debug_intr_latency_fops = {
+	.owner		= THIS_MODULE,
+	.open		= debug_intr_latency_open,
+	.read		= debug_output,
+	.release	= debug_close,
+	.llseek		= default_llseek,
+};
+
 static const struct file_operations debug_periodic_fops = {
 	.owner		= THIS_MODULE,
 	.open		= debug_periodic_open,
@@ -627,6 +636,47 @@ static unsigned output_buf_tds_dir(char *buf, struct ehci_hcd *ehci,
 			qh->ps.c_usecs, temp, 0x7ff & (scratch >> 16));
 }
 
+/*
+ * Interrupt endpoints and, with intr_low_latency, the time from the IRQ
+ * to the return of the completion handler of their URBs
+ */
+static ssize_t fill_intr_latency_buffer(struct debug_buffer *buf)
+{
+	struct ehci_hcd		*ehci;
+	struct ehci_qh		*qh;
+	unsigned		temp, size;
+	char			*next;
+	u64			avg;
+
+	ehci = hcd_to_ehci(bus_to_hcd(buf->bus));
+	next = buf->output_buf;
+	size = buf->alloc_size;
+
+	temp = scnprintf(next, size,
+			"device ep  uperiod givebacks avg(ns) max(ns)\n");
+	size -= temp;
+	next += temp;
+
+	spin_lock_irq(&ehci->lock);
+	list_for_each_entry(qh, &ehci->intr_qh_list, intr_node) {
+		avg = qh->intr_givebacks ?
+			div64_u64(qh->intr_lat_total, qh->intr_givebacks) : 0;
+		temp = scnprintf(next, size,
+				"%-6s %2d%-3s %7u %9lu %7llu %7u\n",
+				qh->ps.udev->devpath,
+				usb_endpoint_num(&qh->ps.ep->desc),
+				usb_endpoint_dir_in(&qh->ps.ep->desc) ?
+					"in" : "out",
+				qh->ps.bw_uperiod, qh->intr_givebacks,
+				avg, qh->intr_lat_max);
+		size -= temp;
+		next += temp;
+	}
+	spin_unlock_irq(&ehci->lock);
+
+	return buf->alloc_size - size;
+}
+
 #define DBG_SCHED_LIMIT 64
 static ssize_t fill_periodic_buffer(struct debug_buffer *buf)
 {
@@ -1012,6 +1062,14 @@ static int debug_bandwidth_open(struct inode *inode, struct file *file)
 	return file->private_data ? 0 : -ENOMEM;
 }
 
+static int debug_intr_latency_open(struct inode *inode, struct file *file)
+{
+	file->private_data = alloc_buffer(inode->i_private,
+			fill_intr_latency_buffer);
+
+	return file->private_data ? 0 : -ENOMEM;
+}
+
 static int debug_periodic_open(struct inode *inode, struct file *file)
 {
 	struct debug_buffer *buf;
@@ -1049,6 +1107,10 @@ static inline void create_debug_files(struct ehci_hcd *ehci)
 						&debug_bandwidth_fops))
 		goto file_error;
 
+	if (!debugfs_create_file("intr_latency", S_IRUGO, ehci->debug_dir, bus,
+						&debug_intr_latency_fops))
+		goto file_error;
+
 	if (!debugfs_create_file("periodic", S_IRUGO, ehci->debug_dir, bus,
 						&debug_periodic_fops))
 		goto file_error;
@@ -102,6 +102,11 @@ static bool ignore_oc;
 module_param (ignore_oc, bool, S_IRUGO);
 MODULE_PARM_DESC (ignore_oc, "ignore bogus hardware overcurrent indications");
 
+/* for gamepads and the like, skip the giveback tasklet for interrupt URBs */
+static bool intr_low_latency;
+module_param (intr_low_latency, bool, S_IRUGO);
+MODULE_PARM_DESC (intr_low_latency, "complete interrupt URBs from the IRQ handler");
+
 #define	INTR_MASK (STS_IAA | STS_FATAL | STS_PCD | STS_ERR | STS_INT)
 
 /*-------------------------------------------------------------------------*/
@@ -715,6 +720,9 @@ static irqreturn_t ehci_irq (struct usb_hcd *hcd)
 	 */
 	spin_lock_irqsave(&ehci->lock, flags);
 
+	if (intr_low_latency)
+		ehci->irq_stamp = ktime_get();
+
 	status = ehci_readl(ehci, &ehci->regs->status);
 
 	/* e.g. cardbus physical eject */
@@ -842,6 +850,7 @@ dead:
 
 	if (bh)
 		ehci_work (ehci);
+	ehci->irq_stamp = 0;
 	spin_unlock_irqrestore(&ehci->lock, flags);
 	if (pcd_status)
 		usb_hcd_poll_rh_status(hcd);
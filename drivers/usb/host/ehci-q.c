@@ -277,6 +277,29 @@ ehci_urb_done(struct ehci_hcd *ehci, struct urb *urb, int status)
 #endif
 
 	usb_hcd_unlink_urb_from_ep(ehci_to_hcd(ehci), urb);
+
+	if (urb->hcpriv && urb->hcpriv == ehci->intr_direct_qh) {
+		struct ehci_qh	*qh = urb->hcpriv;
+		u32		lat;
+
+		/*
+		 * scan_intr() copes with the lock being dropped here, and the
+		 * qh stays in QH_STATE_COMPLETING meanwhile.
+		 */
+		spin_unlock(&ehci->lock);
+		usb_hcd_giveback_urb_direct(ehci_to_hcd(ehci), urb, status);
+		spin_lock(&ehci->lock);
+
+		if (ehci->irq_stamp) {
+			lat = ktime_to_ns(ktime_sub(ktime_get(),
+						    ehci->irq_stamp));
+			qh->intr_givebacks++;
+			qh->intr_lat_total += lat;
+			qh->intr_lat_max = max(qh->intr_lat_max, lat);
+		}
+		return;
+	}
+
 	usb_hcd_giveback_urb(ehci_to_hcd(ehci), urb, status);
 }
 
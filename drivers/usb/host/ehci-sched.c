@@ -1009,7 +1009,10 @@ static void scan_intr(struct ehci_hcd *ehci)
 			 * gets unlinked then ehci->qh_scan_next is adjusted
 			 * in qh_unlink_periodic().
 			 */
+			if (intr_low_latency)
+				ehci->intr_direct_qh = qh;
 			temp = qh_completions(ehci, qh);
+			ehci->intr_direct_qh = NULL;
 			if (unlikely(temp))
 				start_unlink_intr(ehci, qh);
 			else if (unlikely(list_empty(&qh->qtd_list) &&
@@ -149,6 +149,8 @@ struct ehci_hcd {			/* one per controller */
 	bool			async_unlinking:1;
 	bool			shutdown:1;
 	struct ehci_qh		*qh_scan_next;
+	struct ehci_qh		*intr_direct_qh; /* URBs given back at once */
+	ktime_t			irq_stamp;	/* 0 outside ehci_irq() */
 
 	/* async schedule support */
 	struct ehci_qh		*async;
@@ -451,6 +453,11 @@ struct ehci_qh {
 	unsigned		clearing_tt:1;	/* Clear-TT-Buf in progress */
 	unsigned		dequeue_during_giveback:1;
 	unsigned		should_be_inactive:1;
+
+	/* intr_low_latency: irq to completion handler return, in ns */
+	unsigned long		intr_givebacks;
+	u64			intr_lat_total;
+	u32			intr_lat_max;
 };
 
 /*-------------------------------------------------------------------------*/
@@ -0,0 +1,112 @@
+/*
+ * NEON inner loops for 24bpp packed pixel frame buffers
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file COPYING in the main directory of this archive for
+ * more details.
+ */
+
+#include <linux/kernel.h>
+#include <linux/types.h>
+#include "cfb24-neon.h"
+
+#ifndef __ARM_NEON__
+#error You should compile this file with '-mfloat-abi=softfp -mfpu=neon'
+#endif
+
+/*
+ * The loops below are plain C written so that GCC (through -ftree-vectorize)
+ * turns the 3-byte stride accesses into vld3/vst3 and the row copies into
+ * 16-byte vld1/vst1, the same way arch/arm/lib/xor-neon.c gets its NEON code.
+ */
+#pragma GCC optimize "tree-vectorize"
+
+/* Chunk of a scanline expanded from a monochrome bitmap at a time */
+#define EXPAND_CHUNK	256
+
+void cfb24_neon_fill(u8 *dst, unsigned int pitch, unsigned int width,
+		     unsigned int height, u32 color)
+{
+	u8 c0 = color, c1 = color >> 8, c2 = color >> 16;
+	unsigned int x;
+
+	while (height--) {
+		u8 *d = dst;
+
+		for (x = 0; x < width; x++) {
+			d[3 * x + 0] = c0;
+			d[3 * x + 1] = c1;
+			d[3 * x + 2] = c2;
+		}
+		dst += pitch;
+	}
+}
+
+void cfb24_neon_xor(u8 *dst, unsigned int pitch, unsigned int width,
+		    unsigned int height, u32 color)
+{
+	u8 c0 = color, c1 = color >> 8, c2 = color >> 16;
+	unsigned int x;
+
+	while (height--) {
+		u8 *d = dst;
+
+		for (x = 0; x < width; x++) {
+			d[3 * x + 0] ^= c0;
+			d[3 * x + 1] ^= c1;
+			d[3 * x + 2] ^= c2;
+		}
+		dst += pitch;
+	}
+}
+
+/*
+ * Rows are copied front to back, the caller orders the rows (through the
+ * sign of pitch) and never passes rows that overlap each other.
+ */
+void cfb24_neon_copy(u8 *dst, const u8 *src, int pitch, unsigned int bytes,
+		     unsigned int height)
+{
+	unsigned int i;
+
+	while (height--) {
+		u8 * __restrict d = dst;
+		const u8 * __restrict s = src;
+
+		for (i = 0; i < bytes; i++)
+			d[i] = s[i];
+		dst += pitch;
+		src += pitch;
+	}
+}
+
+void cfb24_neon_expand(u8 *dst, unsigned int pitch, const u8 *bits,
+		       unsigned int spitch, unsigned int width,
+		       unsigned int height, u32 fg, u32 bg)
+{
+	u8 b0 = bg, b1 = bg >> 8, b2 = bg >> 16;
+	u8 x0 = (fg ^ bg), x1 = (fg ^ bg) >> 8, x2 = (fg ^ bg) >> 16;
+	u8 mask[EXPAND_CHUNK];
+	unsigned int x, n, i;
+
+	while (height--) {
+		for (x = 0; x < width; x += n) {
+			u8 *d = dst + 3 * x;
+
+			n = min_t(unsigned int, width - x, EXPAND_CHUNK);
+
+			/* Unpack the bitmap to one all-ones/zero byte per pixel */
+			for (i = 0; i < n; i++)
+				mask[i] = -((bits[(x + i) >> 3] >>
+					     (7 - ((x + i) & 7))) & 1);
+
+			for (i = 0; i < n; i++) {
+				d[3 * i + 0] = b0 ^ (x0 & mask[i]);
+				d[3 * i + 1] = b1 ^ (x1 & mask[i]);
+				d[3 * i + 2] = b2 ^ (x2 & mask[i]);
+			}
+		}
+		dst += pitch;
+		bits += spitch;
+	}
+}
@@ -0,0 +1,131 @@
+/*
+ *  NEON accelerated drawing for frame buffers with 24bpp packed pixels
+ *
+ *  This file is subject to the terms and conditions of the GNU General Public
+ *  License.  See the file COPYING in the main directory of this archive for
+ *  more details.
+ *
+ * NOTES:
+ *
+ *  Only the 24bpp cases the generic cfb helpers are slowest at are handled
+ *  here: solid and XOR fills, copies and monochrome expansion. Anything
+ *  else, and any call where kernel mode NEON is not allowed, falls back to
+ *  cfb_fillrect()/cfb_copyarea()/cfb_imageblit().
+ */
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/fb.h>
+#include <linux/hardirq.h>
+#include <asm/neon.h>
+#include "cfb24-neon.h"
+
+static bool cfb24_neon_usable(struct fb_info *p)
+{
+	return p->var.bits_per_pixel == 24 && !in_interrupt();
+}
+
+static u32 cfb24_neon_color(struct fb_info *p, u32 color)
+{
+	if (p->fix.visual == FB_VISUAL_TRUECOLOR ||
+	    p->fix.visual == FB_VISUAL_DIRECTCOLOR)
+		return ((u32 *)p->pseudo_palette)[color];
+
+	return color;
+}
+
+static u8 *cfb24_neon_pixel(struct fb_info *p, u32 x, u32 y)
+{
+	return (u8 __force *)p->screen_base + y * p->fix.line_length + x * 3;
+}
+
+void cfb24_neon_fillrect(struct fb_info *p, const struct fb_fillrect *rect)
+{
+	u32 color;
+	u8 *dst;
+
+	if (p->state != FBINFO_STATE_RUNNING)
+		return;
+
+	if (!cfb24_neon_usable(p)) {
+		cfb_fillrect(p, rect);
+		return;
+	}
+
+	color = cfb24_neon_color(p, rect->color);
+	dst = cfb24_neon_pixel(p, rect->dx, rect->dy);
+
+	kernel_neon_begin();
+	if (rect->rop == ROP_XOR)
+		cfb24_neon_xor(dst, p->fix.line_length, rect->width,
+			       rect->height, color);
+	else
+		cfb24_neon_fill(dst, p->fix.line_length, rect->width,
+				rect->height, color);
+	kernel_neon_end();
+}
+EXPORT_SYMBOL(cfb24_neon_fillrect);
+
+void cfb24_neon_copyarea(struct fb_info *p, const struct fb_copyarea *area)
+{
+	u32 bytes = area->width * 3;
+	u32 pitch = p->fix.line_length;
+	u32 row;
+	u8 *dst, *src;
+
+	if (p->state != FBINFO_STATE_RUNNING)
+		return;
+
+	if (!cfb24_neon_usable(p)) {
+		cfb_copyarea(p, area);
+		return;
+	}
+
+	dst = cfb24_neon_pixel(p, area->dx, area->dy);
+	src = cfb24_neon_pixel(p, area->sx, area->sy);
+
+	/* Moves within the same rows may overlap inside a row */
+	if (area->dy == area->sy) {
+		for (row = 0; row < area->height; row++)
+			memmove(dst + row * pitch, src + row * pitch, bytes);
+		return;
+	}
+
+	kernel_neon_begin();
+	if (area->dy < area->sy) {
+		cfb24_neon_copy(dst, src, pitch, bytes, area->height);
+	} else {
+		/* Copy bottom up so the source is read before it is written */
+		row = area->height - 1;
+		cfb24_neon_copy(dst + row * pitch, src + row * pitch, -pitch,
+				bytes, area->height);
+	}
+	kernel_neon_end();
+}
+EXPORT_SYMBOL(cfb24_neon_copyarea);
+
+void cfb24_neon_imageblit(struct fb_info *p, const struct fb_image *image)
+{
+	u32 fg, bg;
+
+	if (p->state != FBINFO_STATE_RUNNING)
+		return;
+
+	if (image->depth != 1 || !cfb24_neon_usable(p)) {
+		cfb_imageblit(p, image);
+		return;
+	}
+
+	fg = cfb24_neon_color(p, image->fg_color);
+	bg = cfb24_neon_color(p, image->bg_color);
+
+	kernel_neon_begin();
+	cfb24_neon_expand(cfb24_neon_pixel(p, image->dx, image->dy),
+			  p->fix.line_length, (const u8 *)image->data,
+			  (image->width + 7) / 8, image->width, image->height,
+			  fg, bg);
+	kernel_neon_end();
+}
+EXPORT_SYMBOL(cfb24_neon_imageblit);
+
+MODULE_DESCRIPTION("NEON accelerated drawing for 24bpp frame buffers");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,26 @@
+/*
+ * NEON helpers for 24bpp packed pixel frame buffers
+ *
+ * These are built with -mfpu=neon and must only be called between
+ * kernel_neon_begin() and kernel_neon_end().
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License.  See the file COPYING in the main directory of this archive for
+ * more details.
+ */
+#ifndef _CFB24_NEON_H
+#define _CFB24_NEON_H
+
+#include <linux/types.h>
+
+void cfb24_neon_fill(u8 *dst, unsigned int pitch, unsigned int width,
+		     unsigned int height, u32 color);
+void cfb24_neon_xor(u8 *dst, unsigned int pitch, unsigned int width,
+		    unsigned int height, u32 color);
+void cfb24_neon_copy(u8 *dst, const u8 *src, int pitch, unsigned int bytes,
+		     unsigned int height);
+void cfb24_neon_expand(u8 *dst, unsigned int pitch, const u8 *bits,
+		       unsigned int spitch, unsigned int width,
+		       unsigned int height, u32 fg, u32 bg);
+
+#endif /* _CFB24_NEON_H */
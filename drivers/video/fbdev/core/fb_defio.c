@@ -82,7 +82,7 @@ int fb_deferred_io_fsync(struct file *file, loff_t start, loff_t end, int datasy
 	cancel_delayed_work_sync(&info->deferred_work);
 
 	/* Run it immediately */
-	schedule_delayed_work(&info->deferred_work, 0);
+	queue_delayed_work(system_display_wq, &info->deferred_work, 0);
 	inode_unlock(inode);
 
 	return 0;
@@ -142,7 +142,8 @@ page_already_added:
 	mutex_unlock(&fbdefio->lock);
 
 	/* come back after delay to process the deferred IO */
-	schedule_delayed_work(&info->deferred_work, fbdefio->delay);
+	queue_delayed_work(system_display_wq, &info->deferred_work,
+			   fbdefio->delay);
 	return VM_FAULT_LOCKED;
 }
 
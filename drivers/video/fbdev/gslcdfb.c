@@ -38,6 +38,29 @@
 #include <linux/of_address.h>
 #include <linux/io.h>
 #include <linux/slab.h>
+#include <linux/interrupt.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/ktime.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/dmaengine.h>
+#include <linux/completion.h>
+#include <linux/dma-buf.h>
+#include <linux/scatterlist.h>
+#include <linux/fcntl.h>
+#include <linux/clk.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_runtime.h>
+#include <linux/sched.h>
+#include <linux/sched/deadline.h>
+#include <linux/sched/task.h>
+#include <linux/backlight.h>
+#include <video/gslcdfb.h>
+
+#define CREATE_TRACE_POINTS
+#include "gslcdfb_trace.h"
 
 #ifdef CONFIG_PPC_DCR
 #include <asm/dcr.h>
@@ -51,162 +74,1900 @@
  */
 #define REG_OFF_EN 0
 #define REG_OFF_FB_PTR 1
+#define REG_OFF_IRQ_EN 2
+#define REG_OFF_IRQ_STATUS 3	/* write 1 to clear */
+#define REG_OFF_PIX_FMT 4
+#define REG_OFF_SCALE 5
+#define REG_OFF_LUT_CTRL 7
+#define REG_OFF_LUT 256		/* LUT_ENTRIES words, 0x00rrggbb */
+
+#define PIX_FMT_RGB888		0	/* packed 24bpp */
+#define PIX_FMT_RGB565		1
+#define PIX_FMT_XRGB8888	2
+
+#define EN_SCANOUT	BIT(0)
+#define EN_SELF_REFRESH	BIT(1)	/* stop fetching, the panel holds the frame */
+
+#define IRQ_VBLANK	BIT(0)
+
+#define SCALE_2X	BIT(0)	/* fetch half-size lines, double pixels */
+
+#define LUT_CTRL_EN	BIT(0)	/* map the pixels through the LUT */
+
+#define VSYNC_TIMEOUT_MSEC	50
+
+/*
+ * Flips further apart than this many frames are a renderer that went
+ * idle, not one that missed a vblank.
+ */
+#define MISSED_VBLANK_MAX	8
+
+/*
+ * Copies smaller than this are cheaper on the CPU than setting up the CDMA
+ */
+#define BLIT_DMA_MIN_BYTES	(16 * 1024)
+#define BLIT_TIMEOUT_MSEC	100
+
+/*
+ * The hardware supports 800x480, or 400x240 pixel doubled, @ 16, 24 or 32bpp.
+ * 24bpp is packed, 3 bytes per pixel, 32bpp ignores the top byte of each
+ * pixel.
+ */
+struct gslcdfb_format {
+	const char *name;		/* simple-framebuffer style format */
+	u32 bits_per_pixel;
+	u32 pix_fmt;			/* REG_OFF_PIX_FMT value */
+	struct fb_bitfield red, green, blue;
+};
+
+static const struct gslcdfb_format gslcdfb_formats[] = {
+	{ "r5g6b5", 16, PIX_FMT_RGB565,
+	  { 11, 5, 0 }, { 5, 6, 0 }, { 0, 5, 0 } },
+	{ "r8g8b8", 24, PIX_FMT_RGB888,
+	  { 16, 8, 0 }, { 8, 8, 0 }, { 0, 8, 0 } },
+	{ "x8r8g8b8", 32, PIX_FMT_XRGB8888,
+	  { 16, 8, 0 }, { 8, 8, 0 }, { 0, 8, 0 } },
+};
+
+static const struct gslcdfb_format *gslcdfb_find_format(u32 bits_per_pixel)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(gslcdfb_formats); i++)
+		if (gslcdfb_formats[i].bits_per_pixel == bits_per_pixel)
+			return &gslcdfb_formats[i];
+
+	return NULL;
+}
+
+static unsigned int bpp = 24;
+module_param(bpp, uint, 0444);
+MODULE_PARM_DESC(bpp, "Initial bits per pixel (16, 24 or 32, default 24)");
+
+#define PALETTE_ENTRIES_NO	16	/* passed to fb_alloc_cmap() */
+
+/*
+ * Cores built with a gamma LUT map each 8-bit component of the pixels
+ * they scan out through a 256 entry table per channel, after expanding
+ * RGB565 to 8 bits per component. The LUT is loaded with FBIOPUTCMAP of
+ * a full 256 entry color map. Shorter color maps, such as the console
+ * palette, only set the pseudo palette and leave the LUT alone.
+ */
+#define LUT_ENTRIES		256
+
+#if IS_ENABLED(CONFIG_FB_CFB24_NEON)
+#define gslcd_fb_fillrect	cfb24_neon_fillrect
+#define gslcd_fb_copyarea	cfb24_neon_copyarea
+#define gslcd_fb_imageblit	cfb24_neon_imageblit
+#else
+#define gslcd_fb_fillrect	cfb_fillrect
+#define gslcd_fb_copyarea	cfb_copyarea
+#define gslcd_fb_imageblit	cfb_imageblit
+#endif
+
+/*
+ * The virtual screen is num_buffers screens tall, so userspace can draw
+ * into an off-screen buffer and flip to it with FBIOPAN_DISPLAY.
+ */
+#define NUM_BUFFERS_MAX		3
+
+static unsigned int num_buffers = 2;
+module_param(num_buffers, uint, 0444);
+MODULE_PARM_DESC(num_buffers,
+	"Number of screen buffers in the virtual frame buffer (1-3, default 2)");
+
+/*
+ * In shadow mode userspace and fbcon draw into a cacheable vmalloc buffer
+ * and only the dirty pages and lines are copied to the write-combined
+ * scanout buffer, once per vblank at most.
+ */
+static bool shadow;
+module_param(shadow, bool, 0444);
+MODULE_PARM_DESC(shadow,
+	"Draw into a cacheable shadow buffer and flush dirty regions at vblank");
+
+/*
+ * In cached mode the frame buffer is cacheable kernel memory, for software
+ * renderers that read back what they draw. Userspace brackets its access
+ * with GSLCDFB_IOCTL_SYNC, kernel drawing cleans the lines it touches.
+ */
+static bool cached;
+module_param(cached, bool, 0444);
+MODULE_PARM_DESC(cached,
+	"Map the frame buffer cacheable, userspace syncs with GSLCDFB_IOCTL_SYNC");
+
+/* ML300/403 reference design framebuffer driver platform data struct */
+struct gslcdfb_platform_data {
+	u32 screen_height_mm;   /* Physical dimensions of screen in mm */
+	u32 screen_width_mm;
+	u32 xres, yres;         /* resolution of screen in pixels */
+	u32 xvirt, yvirt;       /* resolution of memory buffer */
+	u32 bpp;                /* initial bits per pixel */
+
+	/* Physical address of framebuffer memory; If non-zero, driver
+	* will use provided memory address instead of allocating one from
+	* the consistent pool. */
+	u32 fb_phys;
+	u32 fb_size;            /* size of the memory at fb_phys */
+};
+
+/*
+ * Default gslcdfb configuration
+ */
+static struct gslcdfb_platform_data gslcd_fb_default_pdata = {
+    .screen_height_mm = 65,
+    .screen_width_mm = 108,
+	.xres = 800,
+	.yres = 480,
+	.xvirt = 800,
+	.yvirt = 480,
+	.bpp = 24,
+};
+
+/*
+ * Here are the default fb_fix_screeninfo and fb_var_screeninfo structures
+ */
+static struct fb_fix_screeninfo gslcd_fb_fix = {
+	.id =		"gslcd",
+	.type =		FB_TYPE_PACKED_PIXELS,
+	.visual =	FB_VISUAL_TRUECOLOR,
+	.ypanstep =	1,
+	.accel =	FB_ACCEL_NONE
+};
+
+static struct fb_var_screeninfo gslcd_fb_var = {
+	.transp =	{ 0, 0, 0 },
+
+	.activate =	FB_ACTIVATE_NOW
+};
+
+
+/* A dma-buf from another device flipped onto the screen */
+struct gslcdfb_import {
+	struct list_head list;		/* entry in the retired list */
+	struct dma_buf	*dmabuf;
+	struct dma_buf_attachment *attach;
+	struct sg_table	*sgt;
+};
+
+struct gslcdfb_drvdata {
+
+	struct fb_info	info;		/* FB driver info record */
+
+	phys_addr_t	regs_phys;	/* phys. address of the control
+						registers */
+	void __iomem	*regs;		/* virt. address of the control
+						registers */
+
+	void		*fb_virt;	/* virt. address of the frame buffer */
+	dma_addr_t	fb_phys;	/* phys. address of the frame buffer */
+	int		fb_alloced;	/* Flag, was the fb memory alloced? */
+	bool		cached;		/* fb memory is cacheable */
+
+	u32		pseudo_palette[PALETTE_ENTRIES_NO];
+					/* Fake palette of 16 colors */
+	bool		has_lut;	/* core has a gamma LUT */
+	bool		lut_loaded;	/* LUT set with FBIOPUTCMAP */
+
+	int		irq;		/* vblank irq, negative if none */
+	spinlock_t	lock;		/* protects the vblank state below */
+	wait_queue_head_t vsync_wait;	/* waiters for the next vblank */
+	unsigned long	vsync_count;	/* number of vblanks seen */
+	dma_addr_t	flip_ptr;	/* fb pointer to latch at vblank */
+	bool		flip_pending;	/* flip_ptr is valid */
+	struct gslcdfb_import *flip_import; /* dma-buf behind flip_ptr */
+	struct gslcdfb_import *shown_import; /* dma-buf on screen */
+	struct list_head retired_imports; /* off screen, to be released */
+	struct work_struct import_work;	/* releases retired imports */
+	bool		irq_enabled;	/* vblank irq is unmasked */
+	u64		vblank_ns;	/* last vblank, 0 after masking */
+	u64		flip_ns;	/* last latched flip */
+	u32		frame_ns;	/* measured refresh period */
+	struct task_struct *dl_task;	/* deadline task aligned to vblank */
+	struct cpuidle_wakeup *idle_wakeup; /* vblank hint for cpuidle */
+
+	bool		psr;		/* panel self-refresh is usable */
+	bool		psr_active;	/* scanout fetches are stopped */
+	struct delayed_work psr_work;	/* enters self-refresh when idle */
+
+	struct fb_ops	ops;		/* per device copy of gslcdfb_ops */
+	void		*shadow;	/* cacheable buffer in shadow mode */
+	struct fb_deferred_io defio;	/* dirty page tracking of shadow */
+	u32		dirty_y1;	/* lines [y1, y2) drawn by the kernel, */
+	u32		dirty_y2;	/* protected by lock */
+
+	struct dma_chan	*blit_chan;	/* CDMA channel for blits, or NULL */
+
+	u32		panel_xres;	/* native panel resolution */
+	u32		panel_yres;
+
+	struct clk	*clk;		/* PL pixel clock, or NULL */
+	bool		blanked;	/* gave up the runtime PM reference */
+
+	struct backlight_device *backlight; /* dimmed with content, or NULL */
+	struct delayed_work cabc_work;	/* samples the frame on screen */
+	u32		cabc_level;	/* backlight scale, 1024 is none */
+	u32		cabc_gain;	/* pixel gain in the LUT, 1024 is none */
+	int		cabc_base;	/* brightness the user asked for */
+	int		cabc_set;	/* brightness we last applied */
+	struct list_head cabc_node;	/* on gslcd_fb_cabc_devs */
+};
+
+static void gslcd_fb_out32(struct gslcdfb_drvdata *drvdata, u32 offset,
+				u32 val)
+{
+    iowrite32(val, drvdata->regs + (offset << 2));
+}
+
+static u32 gslcd_fb_in32(struct gslcdfb_drvdata *drvdata, u32 offset)
+{
+    return ioread32(drvdata->regs + (offset << 2));
+}
+
+static int
+gslcd_fb_setcolreg(unsigned regno, unsigned red, unsigned green, unsigned blue,
+	unsigned transp, struct fb_info *fbi)
+{
+	u32 *palette = fbi->pseudo_palette;
+
+	if (regno >= PALETTE_ENTRIES_NO)
+		return -EINVAL;
+
+	if (fbi->var.grayscale) {
+		/* Convert color to grayscale.
+		 * grayscale = 0.30*R + 0.59*G + 0.11*B */
+		red = green = blue =
+			(red * 77 + green * 151 + blue * 28 + 127) >> 8;
+	}
+
+	/* fbi->fix.visual is always FB_VISUAL_TRUECOLOR */
+
+	/* Truncate each 16-bit color to the width of its bitfield */
+	red >>= 16 - fbi->var.red.length;
+	green >>= 16 - fbi->var.green.length;
+	blue >>= 16 - fbi->var.blue.length;
+	palette[regno] = (red << fbi->var.red.offset) |
+			 (green << fbi->var.green.offset) |
+			 (blue << fbi->var.blue.offset);
+
+	return 0;
+}
+
+#define to_gslcdfb_drvdata(_info) \
+	container_of(_info, struct gslcdfb_drvdata, info)
+
+/*
+ * Load @cmap into the LUT, with the pixels scaled by @gain first, see
+ * the content adaptive backlight. Without a gain and a color map of its
+ * own the LUT is bypassed. Called with the fb_info lock held.
+ */
+static void gslcd_fb_load_lut(struct gslcdfb_drvdata *drvdata,
+			      const struct fb_cmap *cmap, u32 gain)
+{
+	unsigned int i, j;
+
+	if (gain == 1024 && !drvdata->lut_loaded) {
+		gslcd_fb_out32(drvdata, REG_OFF_LUT_CTRL, 0);
+		return;
+	}
+
+	/* The table is not double buffered, one frame may mix old and new */
+	for (i = 0; i < LUT_ENTRIES; i++) {
+		j = min((i * gain + 512) >> 10, LUT_ENTRIES - 1);
+		gslcd_fb_out32(drvdata, REG_OFF_LUT + i,
+			       (cmap->red[j] >> 8) << 16 |
+			       (cmap->green[j] >> 8) << 8 |
+			       cmap->blue[j] >> 8);
+	}
+	gslcd_fb_out32(drvdata, REG_OFF_LUT_CTRL, LUT_CTRL_EN);
+}
+
+static int gslcd_fb_setcmap(struct fb_cmap *cmap, struct fb_info *fbi)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	u16 *transp = cmap->transp;
+	int i, rc;
+
+	if (!drvdata->has_lut || cmap->start || cmap->len != LUT_ENTRIES) {
+		for (i = 0; i < cmap->len; i++) {
+			rc = gslcd_fb_setcolreg(cmap->start + i, cmap->red[i],
+						cmap->green[i], cmap->blue[i],
+						transp ? transp[i] : 0xffff,
+						fbi);
+			if (rc)
+				return rc;
+		}
+		return 0;
+	}
+
+	drvdata->lut_loaded = true;
+	gslcd_fb_load_lut(drvdata, cmap, drvdata->cabc_gain);
+
+	return 0;
+}
+
+/*
+ * The vblank interrupt is only unmasked while a flip is pending or
+ * someone is waiting for vsync. Called with drvdata->lock held.
+ */
+static void gslcd_fb_enable_vblank(struct gslcdfb_drvdata *drvdata)
+{
+	if (!drvdata->irq_enabled) {
+		gslcd_fb_out32(drvdata, REG_OFF_IRQ_STATUS, IRQ_VBLANK);
+		gslcd_fb_out32(drvdata, REG_OFF_IRQ_EN, IRQ_VBLANK);
+		drvdata->irq_enabled = true;
+	}
+}
+
+static void gslcd_fb_disable_vblank(struct gslcdfb_drvdata *drvdata)
+{
+	if (drvdata->irq_enabled) {
+		gslcd_fb_out32(drvdata, REG_OFF_IRQ_EN, 0);
+		drvdata->irq_enabled = false;
+		drvdata->vblank_ns = 0;
+		cpuidle_wakeup_event(drvdata->idle_wakeup, 0, 0);
+	}
+}
+
+/*
+ * Release an imported buffer, which is no longer scanned out or never
+ * will be, from process context. Called with drvdata->lock held.
+ */
+static void gslcd_fb_retire_import(struct gslcdfb_drvdata *drvdata,
+				   struct gslcdfb_import *import)
+{
+	if (import) {
+		list_add_tail(&import->list, &drvdata->retired_imports);
+		schedule_work(&drvdata->import_work);
+	}
+}
+
+/*
+ * Queue ptr for the next vblank, replacing a flip still pending. import
+ * is the dma-buf behind ptr, NULL for the frame buffer. Called with
+ * drvdata->lock held.
+ */
+static void gslcd_fb_queue_flip(struct gslcdfb_drvdata *drvdata,
+				dma_addr_t ptr, struct gslcdfb_import *import)
+{
+	/* A replaced flip never reached the screen */
+	gslcd_fb_retire_import(drvdata, drvdata->flip_import);
+	drvdata->flip_import = import;
+	drvdata->flip_ptr = ptr;
+	drvdata->flip_pending = true;
+}
+
+/*
+ * The refresh period is measured between back to back vblank interrupts,
+ * and a flip latched more than one period after the previous one means
+ * the renderer missed vblanks in between. Called with drvdata->lock held.
+ */
+static void gslcd_fb_track_vblank(struct gslcdfb_drvdata *drvdata,
+				  bool flipped)
+{
+	u64 now = ktime_get_ns();
+	u32 frames;
+
+	if (drvdata->vblank_ns)
+		drvdata->frame_ns = now - drvdata->vblank_ns;
+	drvdata->vblank_ns = now;
+	cpuidle_wakeup_event(drvdata->idle_wakeup, now, drvdata->frame_ns);
+
+	if (!flipped)
+		return;
+
+	if (drvdata->frame_ns && drvdata->flip_ns) {
+		frames = div_u64(now - drvdata->flip_ns + drvdata->frame_ns / 2,
+				 drvdata->frame_ns);
+		if (frames > 1 && frames <= MISSED_VBLANK_MAX)
+			trace_gslcdfb_vblank_missed(drvdata->vsync_count,
+						    frames - 1);
+	}
+	drvdata->flip_ns = now;
+}
+
+static irqreturn_t gslcd_fb_irq(int irq, void *dev_id)
+{
+	struct gslcdfb_drvdata *drvdata = dev_id;
+	bool flipped = false;
+	u32 status;
+
+	spin_lock(&drvdata->lock);
+
+	status = gslcd_fb_in32(drvdata, REG_OFF_IRQ_STATUS);
+	if (!(status & IRQ_VBLANK)) {
+		spin_unlock(&drvdata->lock);
+		return IRQ_NONE;
+	}
+
+	gslcd_fb_out32(drvdata, REG_OFF_IRQ_STATUS, IRQ_VBLANK);
+
+	/* Latch the new scanout pointer while the panel is in blanking */
+	if (drvdata->flip_pending) {
+		gslcd_fb_out32(drvdata, REG_OFF_FB_PTR, drvdata->flip_ptr);
+		drvdata->flip_pending = false;
+		/* Scanout of the previous buffer ended with this vblank */
+		gslcd_fb_retire_import(drvdata, drvdata->shown_import);
+		drvdata->shown_import = drvdata->flip_import;
+		drvdata->flip_import = NULL;
+		flipped = true;
+	}
+
+	drvdata->vsync_count++;
+	trace_gslcdfb_vblank(drvdata->vsync_count, flipped, drvdata->flip_ptr);
+	gslcd_fb_track_vblank(drvdata, flipped);
+	wake_up_interruptible_all(&drvdata->vsync_wait);
+
+	/* The task is no longer a deadline task, or has exited */
+	if (drvdata->dl_task && sched_dl_task_align(drvdata->dl_task)) {
+		put_task_struct(drvdata->dl_task);
+		drvdata->dl_task = NULL;
+	}
+
+	/*
+	 * Waiters re-enable the interrupt for every vblank they want, an
+	 * aligned deadline task wants all of them.
+	 */
+	if (!drvdata->dl_task)
+		gslcd_fb_disable_vblank(drvdata);
+
+	spin_unlock(&drvdata->lock);
+
+	return IRQ_HANDLED;
+}
+
+static int gslcd_fb_wait_for_vsync(struct gslcdfb_drvdata *drvdata)
+{
+	unsigned long count, flags;
+	int ret;
+
+	if (drvdata->irq < 0)
+		return -ENODEV;
+
+	spin_lock_irqsave(&drvdata->lock, flags);
+	count = drvdata->vsync_count;
+	gslcd_fb_enable_vblank(drvdata);
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+
+	trace_gslcdfb_wait_vsync_begin(count);
+
+	ret = wait_event_interruptible_timeout(drvdata->vsync_wait,
+				count != READ_ONCE(drvdata->vsync_count),
+				msecs_to_jiffies(VSYNC_TIMEOUT_MSEC));
+	if (ret == 0)
+		ret = -ETIMEDOUT;
+	else if (ret > 0)
+		ret = 0;
+
+	trace_gslcdfb_wait_vsync_end(READ_ONCE(drvdata->vsync_count), ret);
+
+	return ret;
+}
+
+/* ---------------------------------------------------------------------
+ * Panel self-refresh
+ *
+ * A static frame still costs a full DDR fetch every refresh. Bitstreams
+ * with the "self-refresh" property can stop fetching and have the panel
+ * hold the last frame. The driver enters self-refresh once nothing changed
+ * the frame for psr_frames refresh periods, and leaves it before the next
+ * change reaches the scanout buffer.
+ *
+ * Changes are seen through flips, mode sets, shadow flushes and cached
+ * mode syncs. Writes to a write-combined mapping are not seen at all, so
+ * self-refresh is only used in the shadow and cached modes.
+ */
+
+static unsigned int psr_frames = 60;
+module_param(psr_frames, uint, 0644);
+MODULE_PARM_DESC(psr_frames,
+	"Unchanged frames before the panel self-refreshes (0: never, default 60)");
+
+/* Leave self-refresh. Called with drvdata->lock held. */
+static void gslcd_fb_psr_exit(struct gslcdfb_drvdata *drvdata)
+{
+	if (drvdata->psr_active) {
+		gslcd_fb_out32(drvdata, REG_OFF_EN, EN_SCANOUT);
+		drvdata->psr_active = false;
+		trace_gslcdfb_self_refresh(false);
+	}
+}
+
+/* (Re)start the idle countdown, from any context */
+static void gslcd_fb_psr_arm(struct gslcdfb_drvdata *drvdata)
+{
+	unsigned int frames = READ_ONCE(psr_frames);
+	u32 frame_ns = READ_ONCE(drvdata->frame_ns) ? : NSEC_PER_SEC / 60;
+
+	if (drvdata->psr && frames)
+		mod_delayed_work(system_display_wq, &drvdata->psr_work,
+				 nsecs_to_jiffies((u64)frames * frame_ns));
+}
+
+/* The frame is about to change, fetch it again */
+static void gslcd_fb_psr_kick(struct gslcdfb_drvdata *drvdata)
+{
+	unsigned long flags;
+
+	if (!drvdata->psr)
+		return;
+
+	spin_lock_irqsave(&drvdata->lock, flags);
+	gslcd_fb_psr_exit(drvdata);
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+
+	gslcd_fb_psr_arm(drvdata);
+}
+
+static void gslcd_fb_psr_work(struct work_struct *work)
+{
+	struct gslcdfb_drvdata *drvdata = container_of(to_delayed_work(work),
+			struct gslcdfb_drvdata, psr_work);
+	unsigned long flags;
+
+	/* A flip waiting for vblank re-armed the countdown */
+	spin_lock_irqsave(&drvdata->lock, flags);
+	if (READ_ONCE(psr_frames) && !drvdata->blanked &&
+	    !drvdata->psr_active && !drvdata->flip_pending) {
+		gslcd_fb_out32(drvdata, REG_OFF_EN,
+			       EN_SCANOUT | EN_SELF_REFRESH);
+		drvdata->psr_active = true;
+		trace_gslcdfb_self_refresh(true);
+	}
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+}
+
+static int
+gslcd_fb_blank(int blank_mode, struct fb_info *fbi)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	unsigned long flags;
+	bool put;
+
+	/*
+	 * Unblanked, the display holds a runtime PM reference. Dropping it
+	 * gates the pixel clock, which also stops the core's DDR fetches.
+	 */
+	switch (blank_mode) {
+	case FB_BLANK_UNBLANK:
+		if (drvdata->blanked)
+			pm_runtime_get_sync(fbi->device);
+		/* turn on panel, fetching until the countdown runs out */
+		spin_lock_irqsave(&drvdata->lock, flags);
+		gslcd_fb_out32(drvdata, REG_OFF_EN, EN_SCANOUT);
+		drvdata->psr_active = false;
+		drvdata->blanked = false;
+		spin_unlock_irqrestore(&drvdata->lock, flags);
+		gslcd_fb_psr_arm(drvdata);
+		if (drvdata->backlight)
+			queue_delayed_work(system_display_wq,
+					   &drvdata->cabc_work, 0);
+		break;
+
+	case FB_BLANK_NORMAL:
+	case FB_BLANK_VSYNC_SUSPEND:
+	case FB_BLANK_HSYNC_SUSPEND:
+	case FB_BLANK_POWERDOWN:
+		/* turn off panel, self-refresh with it */
+		spin_lock_irqsave(&drvdata->lock, flags);
+		gslcd_fb_out32(drvdata, REG_OFF_EN, 0x0);
+		drvdata->psr_active = false;
+		put = !drvdata->blanked;
+		drvdata->blanked = true;
+		spin_unlock_irqrestore(&drvdata->lock, flags);
+		if (put)
+			pm_runtime_put(fbi->device);
+	default:
+		break;
+
+	}
+	return 0; /* success */
+}
+
+static int
+gslcd_fb_pan_display(struct fb_var_screeninfo *var, struct fb_info *fbi)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	unsigned long flags;
+	dma_addr_t ptr;
+
+	/* The scanout pointer can only move by whole lines */
+	if (var->xoffset)
+		return -EINVAL;
+
+	if (var->yoffset + fbi->var.yres > fbi->var.yres_virtual)
+		return -EINVAL;
+
+	ptr = drvdata->fb_phys + var->yoffset * fbi->fix.line_length;
+
+	/* Without a vblank irq the flip takes effect immediately */
+	if (drvdata->irq < 0) {
+		trace_gslcdfb_pan(var->yoffset, ptr, false);
+		gslcd_fb_psr_kick(drvdata);
+		gslcd_fb_out32(drvdata, REG_OFF_FB_PTR, ptr);
+		return 0;
+	}
+
+	trace_gslcdfb_pan(var->yoffset, ptr, true);
+
+	spin_lock_irqsave(&drvdata->lock, flags);
+	gslcd_fb_psr_exit(drvdata);
+	gslcd_fb_queue_flip(drvdata, ptr, NULL);
+	gslcd_fb_enable_vblank(drvdata);
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+
+	gslcd_fb_psr_arm(drvdata);
+
+	return 0;
+}
+
+static int
+gslcd_fb_check_var(struct fb_var_screeninfo *var, struct fb_info *fbi)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	const struct gslcdfb_format *fmt;
+	u32 line_length, max_yvirt;
+
+	fmt = gslcdfb_find_format(var->bits_per_pixel);
+	if (!fmt)
+		return -EINVAL;
+
+	/*
+	 * The panel resolution is fixed, but the core can scan out a half
+	 * resolution buffer with every pixel doubled. Anything that fits
+	 * in half the panel gets the scaled mode.
+	 */
+	if (var->xres <= drvdata->panel_xres / 2 &&
+	    var->yres <= drvdata->panel_yres / 2) {
+		var->xres = drvdata->panel_xres / 2;
+		var->yres = drvdata->panel_yres / 2;
+	} else {
+		var->xres = drvdata->panel_xres;
+		var->yres = drvdata->panel_yres;
+	}
+	var->xres_virtual = var->xres;
+	var->xoffset = 0;
+
+	/* Keep as many virtual lines as fit in the allocated memory */
+	line_length = var->xres_virtual * (fmt->bits_per_pixel / 8);
+	max_yvirt = fbi->fix.smem_len / line_length;
+	if (var->yres_virtual < var->yres)
+		var->yres_virtual = var->yres;
+	if (var->yres_virtual > max_yvirt)
+		var->yres_virtual = max_yvirt;
+	if (var->yoffset + var->yres > var->yres_virtual)
+		return -EINVAL;
+
+	var->red = fmt->red;
+	var->green = fmt->green;
+	var->blue = fmt->blue;
+	var->transp = gslcd_fb_var.transp;
+	var->nonstd = 0;
+	var->grayscale = 0;
+
+	return 0;
+}
+
+static int gslcd_fb_set_par(struct fb_info *fbi)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	const struct gslcdfb_format *fmt;
+	unsigned long flags;
+	u32 scale;
+
+	fmt = gslcdfb_find_format(fbi->var.bits_per_pixel);
+	if (!fmt)
+		return -EINVAL;
+
+	fbi->fix.line_length = fbi->var.xres_virtual *
+			       (fmt->bits_per_pixel / 8);
+	scale = fbi->var.xres < drvdata->panel_xres ? SCALE_2X : 0;
+
+	/* A mode change drops any queued flip and takes effect at once */
+	spin_lock_irqsave(&drvdata->lock, flags);
+	gslcd_fb_psr_exit(drvdata);
+	drvdata->flip_pending = false;
+	gslcd_fb_retire_import(drvdata, drvdata->flip_import);
+	gslcd_fb_retire_import(drvdata, drvdata->shown_import);
+	drvdata->flip_import = NULL;
+	drvdata->shown_import = NULL;
+	gslcd_fb_out32(drvdata, REG_OFF_SCALE, scale);
+	gslcd_fb_out32(drvdata, REG_OFF_PIX_FMT, fmt->pix_fmt);
+	gslcd_fb_out32(drvdata, REG_OFF_FB_PTR, drvdata->fb_phys +
+		       fbi->var.yoffset * fbi->fix.line_length);
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+
+	gslcd_fb_psr_arm(drvdata);
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Cached mode
+ */
+
+/*
+ * Make lines [y, y + height) coherent, for the LCD core and CDMA to read
+ * when to_device is set, for the CPU to read otherwise. A no-op unless
+ * the frame buffer is cacheable.
+ */
+static void gslcd_fb_sync_lines(struct gslcdfb_drvdata *drvdata,
+				u32 y, u32 height, bool to_device)
+{
+	struct fb_info *fbi = &drvdata->info;
+	unsigned long offset = y * fbi->fix.line_length;
+	unsigned long len = height * fbi->fix.line_length;
+
+	if (!drvdata->cached || offset >= fbi->fix.smem_len)
+		return;
+
+	len = min_t(unsigned long, len, fbi->fix.smem_len - offset);
+	if (to_device) {
+		gslcd_fb_psr_kick(drvdata);
+		dma_sync_single_for_device(fbi->device,
+					   drvdata->fb_phys + offset, len,
+					   DMA_BIDIRECTIONAL);
+	} else {
+		dma_sync_single_for_cpu(fbi->device,
+					drvdata->fb_phys + offset, len,
+					DMA_BIDIRECTIONAL);
+	}
+}
+
+static int gslcd_fb_ioctl_sync(struct gslcdfb_drvdata *drvdata,
+			       struct gslcdfb_sync __user *argp)
+{
+	struct fb_info *fbi = &drvdata->info;
+	struct gslcdfb_sync sync;
+
+	if (copy_from_user(&sync, argp, sizeof(sync)))
+		return -EFAULT;
+
+	if (sync.flags & ~GSLCDFB_SYNC_VALID_FLAGS_MASK ||
+	    !(sync.flags & GSLCDFB_SYNC_RW))
+		return -EINVAL;
+
+	if (sync.height > fbi->var.yres_virtual ||
+	    sync.y > fbi->var.yres_virtual - sync.height)
+		return -EINVAL;
+
+	/* The hardware only writes through blits, the CPU never leaves */
+	if (sync.flags & GSLCDFB_SYNC_END) {
+		if (sync.flags & GSLCDFB_SYNC_WRITE)
+			gslcd_fb_sync_lines(drvdata, sync.y, sync.height, true);
+	} else {
+		if (sync.flags & GSLCDFB_SYNC_READ)
+			gslcd_fb_sync_lines(drvdata, sync.y, sync.height, false);
+	}
+
+	return 0;
+}
+
+static int gslcd_fb_cached_mmap(struct fb_info *fbi,
+				struct vm_area_struct *vma)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+
+	/* Keep the default cacheable protection */
+	return vm_iomap_memory(vma, virt_to_phys(drvdata->fb_virt),
+			       PAGE_ALIGN(fbi->fix.smem_len));
+}
+
+static void
+gslcd_fb_cached_fillrect(struct fb_info *fbi, const struct fb_fillrect *rect)
+{
+	gslcd_fb_fillrect(fbi, rect);
+	gslcd_fb_sync_lines(to_gslcdfb_drvdata(fbi), rect->dy, rect->height,
+			    true);
+}
+
+static void
+gslcd_fb_cached_imageblit(struct fb_info *fbi, const struct fb_image *image)
+{
+	gslcd_fb_imageblit(fbi, image);
+	gslcd_fb_sync_lines(to_gslcdfb_drvdata(fbi), image->dy, image->height,
+			    true);
+}
+
+static ssize_t gslcd_fb_cached_write(struct fb_info *fbi,
+				     const char __user *buf, size_t count,
+				     loff_t *ppos)
+{
+	u32 line_length = fbi->fix.line_length;
+	unsigned long pos = *ppos;
+	ssize_t ret;
+
+	ret = fb_sys_write(fbi, buf, count, ppos);
+	if (ret > 0)
+		gslcd_fb_sync_lines(to_gslcdfb_drvdata(fbi), pos / line_length,
+			DIV_ROUND_UP(pos + ret, line_length) - pos / line_length,
+			true);
+
+	return ret;
+}
+
+/* ---------------------------------------------------------------------
+ * CDMA blits
+ */
+
+static void gslcd_fb_blit_done(void *param)
+{
+	complete(param);
+}
+
+/*
+ * Copy a rectangle of the scanout buffer with the CDMA engine. Full width
+ * copies are merged into as few descriptors as the overlap allows, other
+ * copies take one descriptor per row. Moves down are queued bottom up so
+ * every source row is read before it is overwritten; the channel runs
+ * descriptors in order. Returns 0 once the copy is complete, or an error
+ * if the caller has to fall back to the CPU.
+ */
+static int gslcd_fb_dma_blit(struct gslcdfb_drvdata *drvdata,
+			     u32 sx, u32 sy, u32 dx, u32 dy,
+			     u32 width, u32 height, bool can_sleep)
+{
+	DECLARE_COMPLETION_ONSTACK(done);
+	struct fb_info *fbi = &drvdata->info;
+	struct dma_chan *chan = drvdata->blit_chan;
+	struct dma_async_tx_descriptor *tx;
+	u32 pitch = fbi->fix.line_length;
+	u32 cpp = fbi->var.bits_per_pixel / 8;
+	u32 bytes = width * cpp;
+	dma_addr_t src, dst;
+	dma_cookie_t cookie = -EINVAL;
+	unsigned long flags;
+	u32 i, n, row, rows;
+
+	/* Overlap within a row needs a backwards copy */
+	if (!chan || sy == dy || !width || !height)
+		return -EINVAL;
+
+	if (bytes * height < BLIT_DMA_MIN_BYTES)
+		return -EINVAL;
+
+	src = drvdata->fb_phys + sy * pitch + sx * cpp;
+	dst = drvdata->fb_phys + dy * pitch + dx * cpp;
+
+	gslcd_fb_sync_lines(drvdata, sy, height, true);
+
+	if (bytes == pitch)
+		rows = dy < sy ? height : min(height, dy - sy);
+	else
+		rows = 1;
+
+	for (i = 0; i < height; i += n) {
+		n = min(rows, height - i);
+		row = dy > sy ? height - i - n : i;
+
+		flags = DMA_CTRL_ACK;
+		if (i + n == height)
+			flags |= DMA_PREP_INTERRUPT;
+
+		tx = dmaengine_prep_dma_memcpy(chan, dst + row * pitch,
+					       src + row * pitch,
+					       (n - 1) * pitch + bytes, flags);
+		if (!tx)
+			goto err_terminate;
+
+		if (i + n == height && can_sleep) {
+			tx->callback = gslcd_fb_blit_done;
+			tx->callback_param = &done;
+		}
+
+		cookie = dmaengine_submit(tx);
+		if (dma_submit_error(cookie))
+			goto err_terminate;
+	}
+
+	if (!can_sleep) {
+		/*
+		 * Stop the channel before the CPU redoes the copy. No callback
+		 * was set, so the async variant leaves nothing to synchronize.
+		 */
+		if (dma_sync_wait(chan, cookie) != DMA_COMPLETE) {
+			dmaengine_terminate_async(chan);
+			return -EIO;
+		}
+	} else {
+		dma_async_issue_pending(chan);
+		if (!wait_for_completion_timeout(&done,
+				msecs_to_jiffies(BLIT_TIMEOUT_MSEC))) {
+			dmaengine_terminate_sync(chan);
+			return -ETIMEDOUT;
+		}
+	}
+
+	/* Drop stale cache lines over what the CDMA wrote */
+	gslcd_fb_sync_lines(drvdata, dy, height, false);
+
+	return 0;
+
+err_terminate:
+	/* Nothing was issued yet, drop whatever got queued */
+	if (can_sleep)
+		dmaengine_terminate_sync(chan);
+	else
+		dmaengine_terminate_async(chan);
+
+	return -ENOMEM;
+}
+
+static void
+gslcd_fb_accel_copyarea(struct fb_info *fbi, const struct fb_copyarea *area)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+
+	/*
+	 * fbcon may call in atomic context, so poll for completion. That
+	 * needs the CDMA interrupt to be able to run.
+	 */
+	if (fbi->state == FBINFO_STATE_RUNNING && !irqs_disabled() &&
+	    !gslcd_fb_dma_blit(drvdata, area->sx, area->sy, area->dx, area->dy,
+			       area->width, area->height, false))
+		return;
+
+	gslcd_fb_copyarea(fbi, area);
+	gslcd_fb_sync_lines(drvdata, area->dy, area->height, true);
+}
+
+static int gslcd_fb_ioctl_blit(struct gslcdfb_drvdata *drvdata,
+			       struct gslcdfb_blit __user *argp)
+{
+	struct fb_info *fbi = &drvdata->info;
+	struct fb_copyarea area;
+	struct gslcdfb_blit blit;
+
+	if (copy_from_user(&blit, argp, sizeof(blit)))
+		return -EFAULT;
+
+	if (blit.width > fbi->var.xres_virtual ||
+	    blit.height > fbi->var.yres_virtual ||
+	    blit.sx > fbi->var.xres_virtual - blit.width ||
+	    blit.dx > fbi->var.xres_virtual - blit.width ||
+	    blit.sy > fbi->var.yres_virtual - blit.height ||
+	    blit.dy > fbi->var.yres_virtual - blit.height)
+		return -EINVAL;
+
+	if (!drvdata->shadow &&
+	    !gslcd_fb_dma_blit(drvdata, blit.sx, blit.sy, blit.dx, blit.dy,
+			       blit.width, blit.height, true))
+		return 0;
+
+	area.sx = blit.sx;
+	area.sy = blit.sy;
+	area.dx = blit.dx;
+	area.dy = blit.dy;
+	area.width = blit.width;
+	area.height = blit.height;
+
+	fbi->fbops->fb_copyarea(fbi, &area);
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * dma-buf export of the scanout memory
+ *
+ * Exported buffers pin the module through the dma-buf owner, and manual
+ * unbind is disabled, so the memory outlives every dma-buf. A buffer
+ * covers either the whole virtual screen or a single screen of it, so
+ * that importers such as the UVC gadget can take the frame being
+ * scanned out without a copy.
+ */
+
+struct gslcdfb_export {
+	struct gslcdfb_drvdata *drvdata;
+	u32 offset;		/* of the buffer in the frame buffer */
+};
+
+static struct sg_table *
+gslcd_fb_dmabuf_map(struct dma_buf_attachment *attach,
+		    enum dma_data_direction dir)
+{
+	struct gslcdfb_export *export = attach->dmabuf->priv;
+	phys_addr_t phys = export->drvdata->fb_phys + export->offset;
+	struct sg_table *sgt;
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return ERR_PTR(-ENOMEM);
+
+	if (sg_alloc_table(sgt, 1, GFP_KERNEL)) {
+		kfree(sgt);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	sg_set_page(sgt->sgl, pfn_to_page(PHYS_PFN(phys)),
+		    attach->dmabuf->size, offset_in_page(phys));
+
+	/* The CPU only maps the buffer write-combined, nothing to flush */
+	if (!dma_map_sg_attrs(attach->dev, sgt->sgl, sgt->orig_nents, dir,
+			      DMA_ATTR_SKIP_CPU_SYNC)) {
+		sg_free_table(sgt);
+		kfree(sgt);
+		return ERR_PTR(-EIO);
+	}
+
+	return sgt;
+}
+
+static void gslcd_fb_dmabuf_unmap(struct dma_buf_attachment *attach,
+				  struct sg_table *sgt,
+				  enum dma_data_direction dir)
+{
+	dma_unmap_sg_attrs(attach->dev, sgt->sgl, sgt->orig_nents, dir,
+			   DMA_ATTR_SKIP_CPU_SYNC);
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+static void gslcd_fb_dmabuf_release(struct dma_buf *dmabuf)
+{
+	kfree(dmabuf->priv);
+}
+
+static void *gslcd_fb_dmabuf_kmap(struct dma_buf *dmabuf,
+				  unsigned long pgnum)
+{
+	struct gslcdfb_export *export = dmabuf->priv;
+
+	return export->drvdata->fb_virt + export->offset + pgnum * PAGE_SIZE;
+}
+
+static void *gslcd_fb_dmabuf_vmap(struct dma_buf *dmabuf)
+{
+	struct gslcdfb_export *export = dmabuf->priv;
+
+	return export->drvdata->fb_virt + export->offset;
+}
+
+/*
+ * Screens are yres * line_length apart, which is rarely a multiple of
+ * the page size. A mapping is made of whole pages of the buffer, so only
+ * buffers starting on a page can be mapped, up to their last whole page.
+ */
+static int gslcd_fb_dmabuf_mmap(struct dma_buf *dmabuf,
+				struct vm_area_struct *vma)
+{
+	struct gslcdfb_export *export = dmabuf->priv;
+	size_t size = round_down(dmabuf->size, PAGE_SIZE);
+
+	if (!PAGE_ALIGNED(export->offset) ||
+	    vma->vm_pgoff + vma_pages(vma) > size >> PAGE_SHIFT)
+		return -EINVAL;
+
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
+	return vm_iomap_memory(vma, export->drvdata->fb_phys + export->offset,
+			       size);
+}
+
+static const struct dma_buf_ops gslcd_fb_dmabuf_ops = {
+	.map_dma_buf	= gslcd_fb_dmabuf_map,
+	.unmap_dma_buf	= gslcd_fb_dmabuf_unmap,
+	.release	= gslcd_fb_dmabuf_release,
+	.map		= gslcd_fb_dmabuf_kmap,
+	.map_atomic	= gslcd_fb_dmabuf_kmap,
+	.vmap		= gslcd_fb_dmabuf_vmap,
+	.mmap		= gslcd_fb_dmabuf_mmap,
+};
+
+/* Export size bytes at offset, returns the new fd */
+static int gslcd_fb_export(struct gslcdfb_drvdata *drvdata, u32 offset,
+			   u32 size, u32 flags)
+{
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct gslcdfb_export *export;
+	struct dma_buf *dmabuf;
+	int fd;
+
+	if (flags & ~(O_CLOEXEC | O_ACCMODE))
+		return -EINVAL;
+
+	/*
+	 * Importers would bypass the shadow buffer, and could not keep a
+	 * cacheable buffer coherent
+	 */
+	if (drvdata->shadow || drvdata->cached)
+		return -EBUSY;
+
+	/* Memory without struct pages (a no-map region) can't be exported */
+	if (!pfn_valid(PHYS_PFN(drvdata->fb_phys)))
+		return -ENODEV;
+
+	export = kzalloc(sizeof(*export), GFP_KERNEL);
+	if (!export)
+		return -ENOMEM;
+
+	export->drvdata = drvdata;
+	export->offset = offset;
+
+	exp_info.ops = &gslcd_fb_dmabuf_ops;
+	exp_info.size = size;
+	exp_info.flags = O_RDWR;
+	exp_info.priv = export;
+
+	dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf)) {
+		kfree(export);
+		return PTR_ERR(dmabuf);
+	}
+
+	/* From here on the release callback frees export */
+	fd = dma_buf_fd(dmabuf, flags);
+	if (fd < 0)
+		dma_buf_put(dmabuf);
+
+	return fd;
+}
+
+static int gslcd_fb_ioctl_export(struct gslcdfb_drvdata *drvdata,
+				 struct gslcdfb_dmabuf __user *argp)
+{
+	struct gslcdfb_dmabuf args;
+	int fd;
+
+	if (copy_from_user(&args, argp, sizeof(args)))
+		return -EFAULT;
+
+	args.size = PAGE_ALIGN(drvdata->info.fix.smem_len);
+	fd = gslcd_fb_export(drvdata, 0, args.size, args.flags);
+	if (fd < 0)
+		return fd;
+
+	args.fd = fd;
+	if (copy_to_user(argp, &args, sizeof(args)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int
+gslcd_fb_ioctl_export_screen(struct gslcdfb_drvdata *drvdata,
+			     struct gslcdfb_screen_dmabuf __user *argp)
+{
+	struct fb_info *info = &drvdata->info;
+	struct gslcdfb_screen_dmabuf args;
+	u32 screens;
+	int fd;
+
+	if (copy_from_user(&args, argp, sizeof(args)))
+		return -EFAULT;
+
+	/* The layout follows the mode, which set_par may change later */
+	screens = info->var.yres_virtual / info->var.yres;
+	if (args.screen >= screens)
+		return -EINVAL;
+
+	args.size = info->var.yres * info->fix.line_length;
+	fd = gslcd_fb_export(drvdata, args.screen * args.size, args.size,
+			     args.flags);
+	if (fd < 0)
+		return fd;
+
+	args.fd = fd;
+	if (copy_to_user(argp, &args, sizeof(args)))
+		return -EFAULT;
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * dma-buf import for scanout
+ *
+ * Buffers of other devices, such as V4L2 capture buffers, can be put on
+ * screen without a copy. The vblank interrupt retires the buffer it
+ * flipped away from, and a work releases it.
+ */
+
+static void gslcd_fb_put_import(struct gslcdfb_import *import)
+{
+	dma_buf_unmap_attachment(import->attach, import->sgt, DMA_TO_DEVICE);
+	dma_buf_detach(import->dmabuf, import->attach);
+	dma_buf_put(import->dmabuf);
+	kfree(import);
+}
+
+static void gslcd_fb_import_work(struct work_struct *work)
+{
+	struct gslcdfb_drvdata *drvdata = container_of(work,
+			struct gslcdfb_drvdata, import_work);
+	struct gslcdfb_import *import, *tmp;
+	unsigned long flags;
+	LIST_HEAD(retired);
+
+	spin_lock_irqsave(&drvdata->lock, flags);
+	list_splice_init(&drvdata->retired_imports, &retired);
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+
+	list_for_each_entry_safe(import, tmp, &retired, list)
+		gslcd_fb_put_import(import);
+}
+
+static struct gslcdfb_import *
+gslcd_fb_get_import(struct gslcdfb_drvdata *drvdata, int fd, u32 offset,
+		    dma_addr_t *ptr)
+{
+	struct fb_info *fbi = &drvdata->info;
+	u32 frame = fbi->var.yres * fbi->fix.line_length;
+	struct gslcdfb_import *import;
+	struct scatterlist *sg;
+	dma_addr_t next;
+	size_t size = 0;
+	unsigned int i;
+	int ret;
+
+	import = kzalloc(sizeof(*import), GFP_KERNEL);
+	if (!import)
+		return ERR_PTR(-ENOMEM);
+
+	import->dmabuf = dma_buf_get(fd);
+	if (IS_ERR(import->dmabuf)) {
+		ret = PTR_ERR(import->dmabuf);
+		goto err_free;
+	}
+
+	import->attach = dma_buf_attach(import->dmabuf, fbi->device);
+	if (IS_ERR(import->attach)) {
+		ret = PTR_ERR(import->attach);
+		goto err_put;
+	}
+
+	import->sgt = dma_buf_map_attachment(import->attach, DMA_TO_DEVICE);
+	if (IS_ERR(import->sgt)) {
+		ret = PTR_ERR(import->sgt);
+		goto err_detach;
+	}
+
+	/* The core fetches one linear range of bus addresses */
+	next = sg_dma_address(import->sgt->sgl);
+	for_each_sg(import->sgt->sgl, sg, import->sgt->nents, i) {
+		if (sg_dma_address(sg) != next)
+			break;
+		size += sg_dma_len(sg);
+		next += sg_dma_len(sg);
+	}
+
+	if (offset > size || frame > size - offset) {
+		ret = -EINVAL;
+		goto err_unmap;
+	}
+
+	*ptr = sg_dma_address(import->sgt->sgl) + offset;
+
+	return import;
+
+err_unmap:
+	dma_buf_unmap_attachment(import->attach, import->sgt, DMA_TO_DEVICE);
+err_detach:
+	dma_buf_detach(import->dmabuf, import->attach);
+err_put:
+	dma_buf_put(import->dmabuf);
+err_free:
+	kfree(import);
+	return ERR_PTR(ret);
+}
+
+static int gslcd_fb_ioctl_flip_dmabuf(struct gslcdfb_drvdata *drvdata,
+				      struct gslcdfb_flip_dmabuf __user *argp)
+{
+	struct fb_info *fbi = &drvdata->info;
+	struct gslcdfb_import *import = NULL;
+	struct gslcdfb_flip_dmabuf args;
+	unsigned long flags;
+	dma_addr_t ptr;
+
+	if (copy_from_user(&args, argp, sizeof(args)))
+		return -EFAULT;
+
+	/* Without a vblank there is no telling when a buffer is released */
+	if (drvdata->irq < 0)
+		return -ENODEV;
+
+	if (args.fd >= 0) {
+		import = gslcd_fb_get_import(drvdata, args.fd, args.offset,
+					     &ptr);
+		if (IS_ERR(import))
+			return PTR_ERR(import);
+	} else if (args.fd == -1) {
+		ptr = drvdata->fb_phys +
+		      fbi->var.yoffset * fbi->fix.line_length;
+	} else {
+		return -EINVAL;
+	}
+
+	spin_lock_irqsave(&drvdata->lock, flags);
+	gslcd_fb_psr_exit(drvdata);
+	gslcd_fb_queue_flip(drvdata, ptr, import);
+	gslcd_fb_enable_vblank(drvdata);
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+
+	gslcd_fb_psr_arm(drvdata);
+
+	return 0;
+}
+
+/* ---------------------------------------------------------------------
+ * Shadow buffer mode
+ */
+
+static void gslcd_fb_flush(struct gslcdfb_drvdata *drvdata,
+			   unsigned long offset, unsigned long len)
+{
+	memcpy_toio((void __iomem *)drvdata->fb_virt + offset,
+		    drvdata->shadow + offset, len);
+}
+
+static void gslcd_fb_deferred_io(struct fb_info *fbi,
+				 struct list_head *pagelist)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	unsigned long len = fbi->fix.smem_len;
+	unsigned long flags, offset;
+	unsigned int pages = 0;
+	struct page *page;
+	u32 y1, y2;
+
+	spin_lock_irqsave(&drvdata->lock, flags);
+	y1 = drvdata->dirty_y1;
+	y2 = drvdata->dirty_y2;
+	drvdata->dirty_y1 = U32_MAX;
+	drvdata->dirty_y2 = 0;
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+
+	gslcd_fb_psr_kick(drvdata);
+
+	/* Copy during blanking when there is a vblank irq to wait for */
+	gslcd_fb_wait_for_vsync(drvdata);
+
+	/* Pages written through mmap */
+	list_for_each_entry(page, pagelist, lru) {
+		offset = page->index << PAGE_SHIFT;
+		if (offset < len)
+			gslcd_fb_flush(drvdata, offset,
+				       min(len - offset, PAGE_SIZE));
+		pages++;
+	}
+
+	/* Lines drawn by the kernel */
+	if (y1 < y2) {
+		offset = y1 * fbi->fix.line_length;
+		if (offset < len)
+			gslcd_fb_flush(drvdata, offset,
+				min_t(unsigned long, len - offset,
+				      (y2 - y1) * fbi->fix.line_length));
+	}
+
+	trace_gslcdfb_shadow_flush(pages, y1 < y2 ? y1 : 0, y1 < y2 ? y2 : 0);
+}
+
+static void gslcd_fb_damage(struct fb_info *fbi, u32 y, u32 height)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	unsigned long flags;
+
+	spin_lock_irqsave(&drvdata->lock, flags);
+	drvdata->dirty_y1 = min(drvdata->dirty_y1, y);
+	drvdata->dirty_y2 = max(drvdata->dirty_y2, y + height);
+	spin_unlock_irqrestore(&drvdata->lock, flags);
+
+	queue_delayed_work(system_display_wq, &fbi->deferred_work,
+			   drvdata->defio.delay);
+}
+
+static void
+gslcd_fb_shadow_fillrect(struct fb_info *fbi, const struct fb_fillrect *rect)
+{
+	gslcd_fb_fillrect(fbi, rect);
+	gslcd_fb_damage(fbi, rect->dy, rect->height);
+}
+
+static void
+gslcd_fb_shadow_copyarea(struct fb_info *fbi, const struct fb_copyarea *area)
+{
+	gslcd_fb_copyarea(fbi, area);
+	gslcd_fb_damage(fbi, area->dy, area->height);
+}
+
+static void
+gslcd_fb_shadow_imageblit(struct fb_info *fbi, const struct fb_image *image)
+{
+	gslcd_fb_imageblit(fbi, image);
+	gslcd_fb_damage(fbi, image->dy, image->height);
+}
+
+static ssize_t gslcd_fb_shadow_write(struct fb_info *fbi,
+				     const char __user *buf, size_t count,
+				     loff_t *ppos)
+{
+	u32 line_length = fbi->fix.line_length;
+	unsigned long pos = *ppos;
+	ssize_t ret;
+
+	ret = fb_sys_write(fbi, buf, count, ppos);
+	if (ret > 0)
+		gslcd_fb_damage(fbi, pos / line_length,
+			DIV_ROUND_UP(pos + ret, line_length) - pos / line_length);
+
+	return ret;
+}
+
+static int gslcd_fb_shadow_init(struct gslcdfb_drvdata *drvdata)
+{
+	struct fb_info *fbi = &drvdata->info;
+
+	drvdata->shadow = vzalloc(PAGE_ALIGN(fbi->fix.smem_len));
+	if (!drvdata->shadow)
+		return -ENOMEM;
+
+	/* Start from what is on screen, it may be a bootloader splash */
+	memcpy_fromio(drvdata->shadow, (void __iomem *)drvdata->fb_virt,
+		      fbi->fix.smem_len);
+
+	drvdata->dirty_y1 = U32_MAX;
+	drvdata->dirty_y2 = 0;
+
+	drvdata->ops.fb_read = fb_sys_read;
+	drvdata->ops.fb_write = gslcd_fb_shadow_write;
+	drvdata->ops.fb_fillrect = gslcd_fb_shadow_fillrect;
+	drvdata->ops.fb_copyarea = gslcd_fb_shadow_copyarea;
+	drvdata->ops.fb_imageblit = gslcd_fb_shadow_imageblit;
+
+	fbi->screen_base = (void __iomem *)drvdata->shadow;
+	fbi->flags |= FBINFO_VIRTFB;
+
+	/* Flush at most once a frame */
+	drvdata->defio.delay = max(HZ / 60, 1);
+	drvdata->defio.deferred_io = gslcd_fb_deferred_io;
+	fbi->fbdefio = &drvdata->defio;
+	fb_deferred_io_init(fbi);
+
+	return 0;
+}
+
+static void gslcd_fb_shadow_cleanup(struct gslcdfb_drvdata *drvdata)
+{
+	fb_deferred_io_cleanup(&drvdata->info);
+	vfree(drvdata->shadow);
+}
 
 /*
- * The hardware supports 800x480 @ 24bpp. Each pixel is 3 bytes.
+ * The vblank irq drops the binding of a task that exits or leaves
+ * SCHED_DEADLINE, but only once the next vblank comes.
  */
-#define BYTES_PER_PIXEL	3
-#define BITS_PER_PIXEL	(BYTES_PER_PIXEL * 8)
+static bool gslcd_fb_dl_task_gone(struct task_struct *p)
+{
+	return (p->flags & PF_EXITING) || p->policy != SCHED_DEADLINE;
+}
 
-#define RED_SHIFT	16
-#define GREEN_SHIFT	8
-#define BLUE_SHIFT	0
+static int gslcd_fb_ioctl_align_deadline(struct gslcdfb_drvdata *drvdata,
+					  u32 __user *argp)
+{
+	struct task_struct *put = NULL;
+	unsigned long flags;
+	int ret = 0;
+	u32 enable;
+
+	if (get_user(enable, argp))
+		return -EFAULT;
+	if (enable > 1)
+		return -EINVAL;
+	if (drvdata->irq < 0)
+		return -ENODEV;
+	if (enable && current->policy != SCHED_DEADLINE)
+		return -EINVAL;
 
-#define PALETTE_ENTRIES_NO	16	/* passed to fb_alloc_cmap() */
+	spin_lock_irqsave(&drvdata->lock, flags);
+	if (enable && drvdata->dl_task && drvdata->dl_task != current &&
+	    gslcd_fb_dl_task_gone(drvdata->dl_task)) {
+		put = drvdata->dl_task;
+		drvdata->dl_task = NULL;
+	}
+	if (enable) {
+		if (drvdata->dl_task && drvdata->dl_task != current) {
+			ret = -EBUSY;
+		} else if (!drvdata->dl_task) {
+			get_task_struct(current);
+			drvdata->dl_task = current;
+			gslcd_fb_enable_vblank(drvdata);
+		}
+	} else if (drvdata->dl_task == current) {
+		put = drvdata->dl_task;
+		drvdata->dl_task = NULL;
+	}
+	spin_unlock_irqrestore(&drvdata->lock, flags);
 
-/* ML300/403 reference design framebuffer driver platform data struct */
-struct gslcdfb_platform_data {
-	u32 screen_height_mm;   /* Physical dimensions of screen in mm */
-	u32 screen_width_mm;
-	u32 xres, yres;         /* resolution of screen in pixels */
-	u32 xvirt, yvirt;       /* resolution of memory buffer */
+	if (put)
+		put_task_struct(put);
 
-	/* Physical address of framebuffer memory; If non-zero, driver
-	* will use provided memory address instead of allocating one from
-	* the consistent pool. */
-	u32 fb_phys;
+	return ret;
+}
+
+static int
+gslcd_fb_ioctl(struct fb_info *fbi, unsigned int cmd, unsigned long arg)
+{
+	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	u32 crtc;
+
+	switch (cmd) {
+	case FBIO_WAITFORVSYNC:
+		if (get_user(crtc, (u32 __user *)arg))
+			return -EFAULT;
+		if (crtc != 0)
+			return -ENODEV;
+		return gslcd_fb_wait_for_vsync(drvdata);
+	case GSLCDFB_IOCTL_BLIT:
+		return gslcd_fb_ioctl_blit(drvdata, (void __user *)arg);
+	case GSLCDFB_IOCTL_EXPORT_DMABUF:
+		return gslcd_fb_ioctl_export(drvdata, (void __user *)arg);
+	case GSLCDFB_IOCTL_EXPORT_SCREEN:
+		return gslcd_fb_ioctl_export_screen(drvdata,
+						    (void __user *)arg);
+	case GSLCDFB_IOCTL_SYNC:
+		return gslcd_fb_ioctl_sync(drvdata, (void __user *)arg);
+	case GSLCDFB_IOCTL_FLIP_DMABUF:
+		return gslcd_fb_ioctl_flip_dmabuf(drvdata, (void __user *)arg);
+	case GSLCDFB_IOCTL_ALIGN_DEADLINE:
+		return gslcd_fb_ioctl_align_deadline(drvdata,
+						     (u32 __user *)arg);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static struct fb_ops gslcdfb_ops =
+{
+	.owner			= THIS_MODULE,
+	.fb_check_var		= gslcd_fb_check_var,
+	.fb_set_par		= gslcd_fb_set_par,
+	.fb_setcolreg		= gslcd_fb_setcolreg,
+	.fb_setcmap		= gslcd_fb_setcmap,
+	.fb_blank		= gslcd_fb_blank,
+	.fb_pan_display		= gslcd_fb_pan_display,
+	.fb_ioctl		= gslcd_fb_ioctl,
+	.fb_fillrect		= gslcd_fb_fillrect,
+	.fb_copyarea		= gslcd_fb_accel_copyarea,
+	.fb_imageblit		= gslcd_fb_imageblit,
 };
 
-/*
- * Default gslcdfb configuration
+/* ---------------------------------------------------------------------
+ * Content adaptive backlight
+ *
+ * The backlight is the biggest power consumer after DDR, and a frame
+ * without bright pixels does not need it at the level the user set. The
+ * frame on screen is sampled on a sparse grid every CABC_PERIOD_MSEC,
+ * and the backlight is scaled down to the linear light of its brightest
+ * content, at most by cabc_max_dim percent. Where the core has a gamma
+ * LUT, the pixels are boosted through it by as much as the backlight is
+ * dimmed, ahead of the color map loaded with FBIOPUTCMAP, so that the
+ * picture looks the same; only the highlights ignored by the measurement
+ * clip. Without a LUT the picture gets darker by the reduction.
+ * Brightening is applied at once, dimming is ramped so that it goes
+ * unnoticed. The frame is only sampled while the reduction is enabled.
  */
-static struct gslcdfb_platform_data gslcd_fb_default_pdata = {
-    .screen_height_mm = 65,
-    .screen_width_mm = 108,
-	.xres = 800,
-	.yres = 480,
-	.xvirt = 800,
-	.yvirt = 480,
+
+static unsigned int cabc_max_dim;
+static LIST_HEAD(gslcd_fb_cabc_devs);
+static DEFINE_MUTEX(gslcd_fb_cabc_mutex);
+
+/* Start sampling, or restore the backlight, once the limit changes */
+static int gslcd_fb_cabc_set_max_dim(const char *val,
+				     const struct kernel_param *kp)
+{
+	struct gslcdfb_drvdata *drvdata;
+	int ret;
+
+	ret = param_set_uint(val, kp);
+	if (ret)
+		return ret;
+
+	mutex_lock(&gslcd_fb_cabc_mutex);
+	list_for_each_entry(drvdata, &gslcd_fb_cabc_devs, cabc_node)
+		mod_delayed_work(system_display_wq, &drvdata->cabc_work, 0);
+	mutex_unlock(&gslcd_fb_cabc_mutex);
+
+	return 0;
+}
+
+static const struct kernel_param_ops gslcd_fb_cabc_max_dim_ops = {
+	.set	= gslcd_fb_cabc_set_max_dim,
+	.get	= param_get_uint,
+};
+
+module_param_cb(cabc_max_dim, &gslcd_fb_cabc_max_dim_ops, &cabc_max_dim,
+		0644);
+MODULE_PARM_DESC(cabc_max_dim,
+	"Maximum content adaptive backlight reduction in percent (0: off)");
+
+#define CABC_PERIOD_MSEC	100
+#define CABC_SAMPLE_STEP	8	/* every 8th pixel of every 8th line */
+#define CABC_BINS		32
+#define CABC_IGNORE_PERMILLE	20	/* highlights that may be dimmed */
+#define CABC_RAMP_STEP		16	/* of 1024, per period */
+#define CABC_MAX_GAIN		4096	/* of 1024, for a nearly black frame */
+
+/* Linear light at the top of each luma bin, (n / 32) ^ 2.2 * 1024 */
+static const u16 gslcd_fb_cabc_linear[CABC_BINS] = {
+	0, 2, 6, 11, 17, 26, 36, 49, 63, 79, 98, 118, 141, 166, 193, 223,
+	255, 289, 325, 364, 405, 449, 495, 544, 595, 649, 705, 763, 825, 888,
+	955, 1024,
 };
 
+static u32 gslcd_fb_cabc_luma(const struct fb_var_screeninfo *var,
+			      const u8 *p)
+{
+	u32 px = 0, r, g, b;
+	unsigned int i;
+
+	for (i = 0; i < var->bits_per_pixel / 8; i++)
+		px |= (u32)p[i] << (i * 8);
+
+	r = (px >> var->red.offset) << (8 - var->red.length) & 0xff;
+	g = (px >> var->green.offset) << (8 - var->green.length) & 0xff;
+	b = (px >> var->blue.offset) << (8 - var->blue.length) & 0xff;
+
+	return (2 * r + 5 * g + b) >> 3;
+}
+
+/* The backlight scale the frame on screen needs, of 1024 */
+static u32 gslcd_fb_cabc_measure(struct gslcdfb_drvdata *drvdata)
+{
+	const struct fb_var_screeninfo *var = &drvdata->info.var;
+	u32 line_length = drvdata->info.fix.line_length;
+	unsigned int cpp = var->bits_per_pixel / 8;
+	u32 hist[CABC_BINS] = { 0 };
+	u32 samples = 0, ignore;
+	const u8 *base, *line;
+	unsigned int x, y;
+	int i;
+
+	base = drvdata->shadow ? drvdata->shadow : drvdata->fb_virt;
+	base += var->yoffset * line_length;
+
+	for (y = 0; y < var->yres; y += CABC_SAMPLE_STEP) {
+		line = base + y * line_length;
+		for (x = 0; x < var->xres; x += CABC_SAMPLE_STEP) {
+			hist[gslcd_fb_cabc_luma(var, line + x * cpp) >> 3]++;
+			samples++;
+		}
+	}
+
+	ignore = samples * CABC_IGNORE_PERMILLE / 1000;
+	for (i = CABC_BINS - 1; i > 0; i--) {
+		if (hist[i] > ignore)
+			break;
+		ignore -= hist[i];
+	}
+
+	return gslcd_fb_cabc_linear[i];
+}
+
 /*
- * Here are the default fb_fix_screeninfo and fb_var_screeninfo structures
+ * The pixel gain that makes up for a backlight scaled by @level, both of
+ * 1024: the inverse of the luma whose linear light is @level.
  */
-static struct fb_fix_screeninfo gslcd_fb_fix = {
-	.id =		"gslcd",
-	.type =		FB_TYPE_PACKED_PIXELS,
-	.visual =	FB_VISUAL_TRUECOLOR,
-	.accel =	FB_ACCEL_NONE
-};
+static u32 gslcd_fb_cabc_gain(u32 level)
+{
+	const u16 *lin = gslcd_fb_cabc_linear;
+	u32 luma;
+	int i;
 
-static struct fb_var_screeninfo gslcd_fb_var = {
-	.bits_per_pixel =	BITS_PER_PIXEL,
+	if (level >= 1024)
+		return 1024;
+	if (level <= lin[0])
+		return CABC_MAX_GAIN;
 
-	.red =		{ RED_SHIFT, 8, 0 },
-	.green =	{ GREEN_SHIFT, 8, 0 },
-	.blue =		{ BLUE_SHIFT, 8, 0 },
-	.transp =	{ 0, 0, 0 },
+	for (i = 1; lin[i] < level; i++)
+		;
 
-	.activate =	FB_ACTIVATE_NOW
-};
+	/* Entry i is the light at luma (i + 1) / 32, luma in 1/8192ths */
+	luma = (i << 8) + ((level - lin[i - 1]) << 8) / (lin[i] - lin[i - 1]);
 
+	return min_t(u32, (32 << 8 << 10) / luma, CABC_MAX_GAIN);
+}
 
-struct gslcdfb_drvdata {
+static void gslcd_fb_cabc_work(struct work_struct *work)
+{
+	struct gslcdfb_drvdata *drvdata = container_of(work,
+			struct gslcdfb_drvdata, cabc_work.work);
+	struct backlight_device *bd = drvdata->backlight;
+	u32 max_dim = min(READ_ONCE(cabc_max_dim), 100U);
+	u32 target = 1024, gain;
+	int brightness;
+
+	if (drvdata->blanked)
+		return;
+
+	/* Anything we did not set ourselves is the user's new choice */
+	if (bd->props.brightness != drvdata->cabc_set)
+		drvdata->cabc_base = bd->props.brightness;
+
+	if (max_dim)
+		target = max(gslcd_fb_cabc_measure(drvdata),
+			     1024 - max_dim * 1024 / 100);
+
+	if (drvdata->cabc_level > target + CABC_RAMP_STEP)
+		drvdata->cabc_level -= CABC_RAMP_STEP;
+	else
+		drvdata->cabc_level = target;
 
-	struct fb_info	info;		/* FB driver info record */
+	brightness = DIV_ROUND_CLOSEST(drvdata->cabc_base *
+				       drvdata->cabc_level, 1024);
+	if (brightness != bd->props.brightness) {
+		drvdata->cabc_set = brightness;
+		backlight_device_set_brightness(bd, brightness);
+	}
 
-	phys_addr_t	regs_phys;	/* phys. address of the control
-						registers */
-	void __iomem	*regs;		/* virt. address of the control
-						registers */
+	gain = gslcd_fb_cabc_gain(drvdata->cabc_level);
+	if (drvdata->has_lut && gain != drvdata->cabc_gain &&
+	    lock_fb_info(&drvdata->info)) {
+		drvdata->cabc_gain = gain;
+		gslcd_fb_load_lut(drvdata, &drvdata->info.cmap, gain);
+		unlock_fb_info(&drvdata->info);
+	}
 
-	void		*fb_virt;	/* virt. address of the frame buffer */
-	dma_addr_t	fb_phys;	/* phys. address of the frame buffer */
-	int		fb_alloced;	/* Flag, was the fb memory alloced? */
+	/* Disabled and back at full brightness: nothing left to do */
+	if (!max_dim && drvdata->cabc_level == 1024)
+		return;
 
-	u32		pseudo_palette[PALETTE_ENTRIES_NO];
-					/* Fake palette of 16 colors */
-};
+	queue_delayed_work(system_display_wq, &drvdata->cabc_work,
+			   msecs_to_jiffies(CABC_PERIOD_MSEC));
+}
 
-static void gslcd_fb_out32(struct gslcdfb_drvdata *drvdata, u32 offset,
-				u32 val)
+/* The panel's backlight is optional, given by a "backlight" phandle */
+static int gslcd_fb_cabc_init(struct device *dev,
+			      struct gslcdfb_drvdata *drvdata)
 {
-    iowrite32(val, drvdata->regs + (offset << 2));
+	struct device_node *np;
+
+	np = of_parse_phandle(dev->of_node, "backlight", 0);
+	if (!np)
+		return 0;
+
+	drvdata->backlight = of_find_backlight_by_node(np);
+	of_node_put(np);
+	if (!drvdata->backlight)
+		return -EPROBE_DEFER;
+
+	INIT_DELAYED_WORK(&drvdata->cabc_work, gslcd_fb_cabc_work);
+	drvdata->cabc_level = 1024;
+	drvdata->cabc_gain = 1024;
+	drvdata->cabc_base = drvdata->backlight->props.brightness;
+	drvdata->cabc_set = drvdata->cabc_base;
+
+	return 0;
 }
 
-static u32 gslcd_fb_in32(struct gslcdfb_drvdata *drvdata, u32 offset)
+/* Once the frame buffer is set up */
+static void gslcd_fb_cabc_start(struct gslcdfb_drvdata *drvdata)
 {
-    return ioread32(drvdata->regs + (offset << 2));
+	if (!drvdata->backlight)
+		return;
+
+	mutex_lock(&gslcd_fb_cabc_mutex);
+	list_add(&drvdata->cabc_node, &gslcd_fb_cabc_devs);
+	mutex_unlock(&gslcd_fb_cabc_mutex);
+
+	queue_delayed_work(system_display_wq, &drvdata->cabc_work, 0);
 }
 
-static int
-gslcd_fb_setcolreg(unsigned regno, unsigned red, unsigned green, unsigned blue,
-	unsigned transp, struct fb_info *fbi)
+static void gslcd_fb_cabc_fini(struct gslcdfb_drvdata *drvdata)
 {
-	u32 *palette = fbi->pseudo_palette;
+	if (!drvdata->backlight)
+		return;
+
+	mutex_lock(&gslcd_fb_cabc_mutex);
+	list_del(&drvdata->cabc_node);
+	mutex_unlock(&gslcd_fb_cabc_mutex);
+
+	cancel_delayed_work_sync(&drvdata->cabc_work);
+	if (drvdata->cabc_gain != 1024 && lock_fb_info(&drvdata->info)) {
+		drvdata->cabc_gain = 1024;
+		gslcd_fb_load_lut(drvdata, &drvdata->info.cmap, 1024);
+		unlock_fb_info(&drvdata->info);
+	}
+	if (drvdata->backlight->props.brightness == drvdata->cabc_set)
+		backlight_device_set_brightness(drvdata->backlight,
+						drvdata->cabc_base);
+	put_device(&drvdata->backlight->dev);
+}
 
-	if (regno >= PALETTE_ENTRIES_NO)
-		return -EINVAL;
+/* ---------------------------------------------------------------------
+ * Bus independent setup/teardown
+ */
 
-	if (fbi->var.grayscale) {
-		/* Convert color to grayscale.
-		 * grayscale = 0.30*R + 0.59*G + 0.11*B */
-		red = green = blue =
-			(red * 77 + green * 151 + blue * 28 + 127) >> 8;
+static int gslcd_fb_power_init(struct device *dev,
+			       struct gslcdfb_drvdata *drvdata)
+{
+	int rc;
+
+	/* Without a clock in the DT the pixel clock is assumed always on */
+	drvdata->clk = devm_clk_get(dev, "pixel");
+	if (IS_ERR(drvdata->clk)) {
+		rc = PTR_ERR(drvdata->clk);
+		if (rc == -EPROBE_DEFER)
+			return rc;
+		drvdata->clk = NULL;
 	}
 
-	/* fbi->fix.visual is always FB_VISUAL_TRUECOLOR */
+	rc = clk_prepare_enable(drvdata->clk);
+	if (rc)
+		return rc;
 
-	/* We only handle 8 bits of each color. */
-	red >>= 8;
-	green >>= 8;
-	blue >>= 8;
-	palette[regno] = (red << RED_SHIFT) | (green << GREEN_SHIFT) |
-			 (blue << BLUE_SHIFT);
+	/* The display starts unblanked, holding a reference */
+	pm_runtime_set_active(dev);
+	pm_runtime_get_noresume(dev);
+	pm_runtime_enable(dev);
 
 	return 0;
 }
 
-#define to_gslcdfb_drvdata(_info) \
-	container_of(_info, struct gslcdfb_drvdata, info)
-
-static int
-gslcd_fb_blank(int blank_mode, struct fb_info *fbi)
+static void gslcd_fb_power_fini(struct device *dev,
+				struct gslcdfb_drvdata *drvdata)
 {
-	struct gslcdfb_drvdata *drvdata = to_gslcdfb_drvdata(fbi);
+	pm_runtime_disable(dev);
+	if (!drvdata->blanked)
+		pm_runtime_put_noidle(dev);
+	if (!pm_runtime_status_suspended(dev))
+		clk_disable_unprepare(drvdata->clk);
+	pm_runtime_set_suspended(dev);
+}
 
-	switch (blank_mode) {
-	case FB_BLANK_UNBLANK:
-		/* turn on panel */
-		gslcd_fb_out32(drvdata, REG_OFF_EN, 0x1);
-		break;
+static void *gslcd_fb_alloc_cached(struct device *dev,
+				   struct gslcdfb_drvdata *drvdata, size_t size)
+{
+	void *virt;
 
-	case FB_BLANK_NORMAL:
-	case FB_BLANK_VSYNC_SUSPEND:
-	case FB_BLANK_HSYNC_SUSPEND:
-	case FB_BLANK_POWERDOWN:
-		/* turn off panel */
-		gslcd_fb_out32(drvdata, REG_OFF_EN, 0x0);
-	default:
-		break;
+	virt = alloc_pages_exact(size, GFP_KERNEL | __GFP_ZERO);
+	if (!virt)
+		return NULL;
 
+	drvdata->fb_phys = dma_map_single(dev, virt, size, DMA_BIDIRECTIONAL);
+	if (dma_mapping_error(dev, drvdata->fb_phys)) {
+		free_pages_exact(virt, size);
+		return NULL;
 	}
-	return 0; /* success */
+
+	drvdata->cached = true;
+
+	return virt;
 }
 
-static struct fb_ops gslcdfb_ops =
+static void gslcd_fb_free(struct device *dev, struct gslcdfb_drvdata *drvdata,
+			  size_t size)
 {
-	.owner			= THIS_MODULE,
-	.fb_setcolreg		= gslcd_fb_setcolreg,
-	.fb_blank		= gslcd_fb_blank,
-	.fb_fillrect		= cfb_fillrect,
-	.fb_copyarea		= cfb_copyarea,
-	.fb_imageblit		= cfb_imageblit,
-};
-
-/* ---------------------------------------------------------------------
- * Bus independent setup/teardown
- */
+	if (drvdata->cached) {
+		dma_unmap_single(dev, drvdata->fb_phys, size,
+				 DMA_BIDIRECTIONAL);
+		free_pages_exact(drvdata->fb_virt, size);
+	} else if (drvdata->fb_alloced) {
+		dma_free_writecombine(dev, size, drvdata->fb_virt,
+				      drvdata->fb_phys);
+	} else {
+		iounmap(drvdata->fb_virt);
+	}
+}
 
 static int gslcdfb_assign(struct platform_device *pdev,
 			   struct gslcdfb_drvdata *drvdata,
@@ -214,7 +1975,9 @@ static int gslcdfb_assign(struct platform_device *pdev,
 {
 	int rc;
 	struct device *dev = &pdev->dev;
-	int fbsize = pdata->xvirt * pdata->yvirt * BYTES_PER_PIXEL;
+	const struct gslcdfb_format *fmt = gslcdfb_find_format(pdata->bpp);
+	int fbsize = pdata->xvirt * pdata->yvirt * (fmt->bits_per_pixel / 8);
+	int visible, cmap_len, i;
 
     struct resource *res;
     res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -227,11 +1990,23 @@ static int gslcdfb_assign(struct platform_device *pdev,
 	/* Allocate the framebuffer memory */
 	if (pdata->fb_phys) {
 		drvdata->fb_phys = pdata->fb_phys;
-		drvdata->fb_virt = ioremap(pdata->fb_phys, fbsize);
+		drvdata->fb_virt = (void __force *)ioremap_wc(pdata->fb_phys,
+							      fbsize);
 	} else {
 		drvdata->fb_alloced = 1;
-		drvdata->fb_virt = dma_alloc_writecombine(dev, PAGE_ALIGN(fbsize),
-					&drvdata->fb_phys, GFP_KERNEL);
+
+		/* Shadow mode already draws into cacheable memory */
+		if (cached && !shadow) {
+			drvdata->fb_virt = gslcd_fb_alloc_cached(dev, drvdata,
+							PAGE_ALIGN(fbsize));
+			if (!drvdata->fb_virt)
+				dev_warn(dev, "no contiguous cacheable memory, using write-combined\n");
+		}
+
+		if (!drvdata->fb_virt)
+			drvdata->fb_virt = dma_alloc_writecombine(dev,
+						PAGE_ALIGN(fbsize),
+						&drvdata->fb_phys, GFP_KERNEL);
 	}
 
 	if (!drvdata->fb_virt) {
@@ -239,11 +2014,67 @@ static int gslcdfb_assign(struct platform_device *pdev,
 		return -ENOMEM;
 	}
 
-	/* Clear (turn to black) the framebuffer */
-	memset_io((void __iomem *)drvdata->fb_virt, 0, fbsize);
+	if (pdata->fb_phys) {
+		/*
+		 * The bootloader is already scanning out the first screen,
+		 * keep it and only clear the off-screen buffers.
+		 */
+		visible = pdata->xvirt * pdata->yres *
+			  (fmt->bits_per_pixel / 8);
+		memset_io((void __iomem *)drvdata->fb_virt + visible, 0,
+			  fbsize - visible);
+	} else {
+		/* Clear (turn to black) the framebuffer */
+		memset_io((void __iomem *)drvdata->fb_virt, 0, fbsize);
+
+		/* Tell the hardware where the frame buffer is */
+		gslcd_fb_out32(drvdata, REG_OFF_FB_PTR, drvdata->fb_phys);
+		gslcd_fb_out32(drvdata, REG_OFF_PIX_FMT, fmt->pix_fmt);
+		gslcd_fb_out32(drvdata, REG_OFF_SCALE, 0);
+	}
+
+	/* Hook up the vblank interrupt, flips are immediate without it */
+	spin_lock_init(&drvdata->lock);
+	init_waitqueue_head(&drvdata->vsync_wait);
+	INIT_DELAYED_WORK(&drvdata->psr_work, gslcd_fb_psr_work);
+	INIT_LIST_HEAD(&drvdata->retired_imports);
+	INIT_WORK(&drvdata->import_work, gslcd_fb_import_work);
+	gslcd_fb_out32(drvdata, REG_OFF_IRQ_EN, 0);
+	gslcd_fb_out32(drvdata, REG_OFF_IRQ_STATUS, IRQ_VBLANK);
+
+	drvdata->irq = platform_get_irq(pdev, 0);
+	if (drvdata->irq >= 0) {
+		rc = devm_request_irq(dev, drvdata->irq, gslcd_fb_irq, 0,
+				      DRIVER_NAME, drvdata);
+		if (rc) {
+			dev_err(dev, "Could not request vblank irq\n");
+			goto err_irq;
+		}
+		/* Optional, idle states are just chosen less carefully */
+		drvdata->idle_wakeup = cpuidle_wakeup_register();
+	} else {
+		dev_info(dev, "no vblank irq, vsync is not available\n");
+	}
+
+	/* A CDMA channel for blits is optional, the CPU copies without it */
+	drvdata->blit_chan = dma_request_chan(dev, "blit");
+	if (IS_ERR(drvdata->blit_chan)) {
+		rc = PTR_ERR(drvdata->blit_chan);
+		drvdata->blit_chan = NULL;
+		if (rc == -EPROBE_DEFER)
+			goto err_dma;
+	} else if (!dma_has_cap(DMA_MEMCPY,
+				drvdata->blit_chan->device->cap_mask)) {
+		dev_warn(dev, "blit channel does not support memcpy\n");
+		dma_release_channel(drvdata->blit_chan);
+		drvdata->blit_chan = NULL;
+	}
 
-	/* Tell the hardware where the frame buffer is */
-	gslcd_fb_out32(drvdata, REG_OFF_FB_PTR, drvdata->fb_phys);
+	rc = gslcd_fb_power_init(dev, drvdata);
+	if (rc) {
+		dev_err(dev, "Could not enable pixel clock\n");
+		goto err_cmap;
+	}
 
 	/* Turn on the display */
 	gslcd_fb_out32(drvdata, REG_OFF_EN, 0x1);
@@ -251,28 +2082,72 @@ static int gslcdfb_assign(struct platform_device *pdev,
 	/* Fill struct fb_info */
 	drvdata->info.device = dev;
 	drvdata->info.screen_base = (void __iomem *)drvdata->fb_virt;
-	drvdata->info.fbops = &gslcdfb_ops;
+	drvdata->ops = gslcdfb_ops;
+	drvdata->info.fbops = &drvdata->ops;
 	drvdata->info.fix = gslcd_fb_fix;
 	drvdata->info.fix.smem_start = drvdata->fb_phys;
 	drvdata->info.fix.smem_len = fbsize;
-	drvdata->info.fix.line_length = pdata->xvirt * BYTES_PER_PIXEL;
+	drvdata->info.fix.line_length = pdata->xvirt * (fmt->bits_per_pixel / 8);
 
 	drvdata->info.pseudo_palette = drvdata->pseudo_palette;
-	drvdata->info.flags = FBINFO_DEFAULT;
+	drvdata->info.flags = FBINFO_DEFAULT | FBINFO_HWACCEL_YPAN;
 	drvdata->info.var = gslcd_fb_var;
+	drvdata->info.var.bits_per_pixel = fmt->bits_per_pixel;
+	drvdata->info.var.red = fmt->red;
+	drvdata->info.var.green = fmt->green;
+	drvdata->info.var.blue = fmt->blue;
 	drvdata->info.var.height = pdata->screen_height_mm;
 	drvdata->info.var.width = pdata->screen_width_mm;
 	drvdata->info.var.xres = pdata->xres;
 	drvdata->info.var.yres = pdata->yres;
 	drvdata->info.var.xres_virtual = pdata->xvirt;
 	drvdata->info.var.yres_virtual = pdata->yvirt;
+	drvdata->panel_xres = pdata->xres;
+	drvdata->panel_yres = pdata->yres;
+
+	if (shadow) {
+		rc = gslcd_fb_shadow_init(drvdata);
+		if (rc) {
+			dev_err(dev, "Could not allocate shadow buffer\n");
+			goto err_power;
+		}
+	} else if (drvdata->cached) {
+		drvdata->ops.fb_read = fb_sys_read;
+		drvdata->ops.fb_write = gslcd_fb_cached_write;
+		drvdata->ops.fb_fillrect = gslcd_fb_cached_fillrect;
+		drvdata->ops.fb_imageblit = gslcd_fb_cached_imageblit;
+		drvdata->ops.fb_mmap = gslcd_fb_cached_mmap;
+		drvdata->info.flags |= FBINFO_VIRTFB;
+
+		/* The clear above went to the cache */
+		gslcd_fb_sync_lines(drvdata, 0, pdata->yvirt, true);
+	}
 
-	/* Allocate a colour map */
-	rc = fb_alloc_cmap(&drvdata->info.cmap, PALETTE_ENTRIES_NO, 0);
+	/*
+	 * fbcon scrolls by panning down the virtual screen and moves the
+	 * text back to the top once it reaches the bottom. Reading the
+	 * write-combined buffer is slow, so unless the buffer is cacheable
+	 * or the CDMA does the move, it redraws the text there instead.
+	 */
+	if (drvdata->shadow || drvdata->cached)
+		drvdata->info.flags |= FBINFO_READS_FAST;
+	else if (drvdata->blit_chan)
+		drvdata->info.flags |= FBINFO_HWACCEL_COPYAREA;
+
+	/* Allocate a colour map, the LUT starts out bypassed */
+	drvdata->has_lut = of_property_read_bool(dev->of_node, "gamma-lut");
+	cmap_len = drvdata->has_lut ? LUT_ENTRIES : PALETTE_ENTRIES_NO;
+	rc = fb_alloc_cmap(&drvdata->info.cmap, cmap_len, 0);
 	if (rc) {
 		dev_err(dev, "Fail to allocate colormap (%d entries)\n",
-			PALETTE_ENTRIES_NO);
-		goto err_cmap;
+			cmap_len);
+		goto err_shadow;
+	}
+	if (drvdata->has_lut) {
+		gslcd_fb_out32(drvdata, REG_OFF_LUT_CTRL, 0);
+		for (i = 0; i < LUT_ENTRIES; i++)
+			drvdata->info.cmap.red[i] = drvdata->info.cmap.green[i] =
+				drvdata->info.cmap.blue[i] = i << 8 | i;
 	}
 
 	/* Register new frame buffer */
@@ -282,6 +2157,13 @@ static int gslcdfb_assign(struct platform_device *pdev,
 		goto err_regfb;
 	}
 
+	/* Only the shadow and cached modes see every change to the frame */
+	if (of_property_read_bool(dev->of_node, "self-refresh") &&
+	    (drvdata->shadow || drvdata->cached)) {
+		drvdata->psr = true;
+		gslcd_fb_psr_arm(drvdata);
+	}
+
     /* Put a banner in the log (for DEBUG) */
     dev_dbg(dev, "regs: phys=%pa, virt=%p\n",
         &drvdata->regs_phys, drvdata->regs);
@@ -295,12 +2177,25 @@ static int gslcdfb_assign(struct platform_device *pdev,
 err_regfb:
 	fb_dealloc_cmap(&drvdata->info.cmap);
 
+err_shadow:
+	if (drvdata->shadow)
+		gslcd_fb_shadow_cleanup(drvdata);
+
+err_power:
+	gslcd_fb_out32(drvdata, REG_OFF_EN, 0x0);
+	gslcd_fb_power_fini(dev, drvdata);
+
 err_cmap:
-	if (drvdata->fb_alloced)
-		dma_free_writecombine(dev, PAGE_ALIGN(fbsize), drvdata->fb_virt,
-			drvdata->fb_phys);
-	else
-		iounmap(drvdata->fb_virt);
+	if (drvdata->blit_chan)
+		dma_release_channel(drvdata->blit_chan);
+
+err_dma:
+	if (drvdata->irq >= 0)
+		devm_free_irq(dev, drvdata->irq, drvdata);
+
+err_irq:
+	cpuidle_wakeup_unregister(drvdata->idle_wakeup);
+	gslcd_fb_free(dev, drvdata, PAGE_ALIGN(fbsize));
 
 	/* Turn off the display */
 	gslcd_fb_out32(drvdata, REG_OFF_EN, 0x0);
@@ -316,41 +2211,180 @@ static int gslcdfb_release(struct device *dev)
 	gslcd_fb_blank(VESA_POWERDOWN, &drvdata->info);
 #endif
 
+	gslcd_fb_cabc_fini(drvdata);
+
 	unregister_framebuffer(&drvdata->info);
 
+	if (drvdata->shadow)
+		gslcd_fb_shadow_cleanup(drvdata);
+
+	/* Nothing kicks it any more, fetch for the final shutdown */
+	drvdata->psr = false;
+	cancel_delayed_work_sync(&drvdata->psr_work);
+
 	fb_dealloc_cmap(&drvdata->info.cmap);
 
-	if (drvdata->fb_alloced)
-		dma_free_coherent(dev, PAGE_ALIGN(drvdata->info.fix.smem_len),
-				  drvdata->fb_virt, drvdata->fb_phys);
-	else
-		iounmap(drvdata->fb_virt);
+	if (drvdata->blit_chan)
+		dma_release_channel(drvdata->blit_chan);
+
+	/* Mask the vblank irq, it is released by devres */
+	gslcd_fb_out32(drvdata, REG_OFF_IRQ_EN, 0);
+	if (drvdata->dl_task) {
+		synchronize_irq(drvdata->irq);
+		put_task_struct(drvdata->dl_task);
+	}
+	cpuidle_wakeup_unregister(drvdata->idle_wakeup);
+
+	gslcd_fb_free(dev, drvdata, PAGE_ALIGN(drvdata->info.fix.smem_len));
 
 	/* Turn off the display */
 	gslcd_fb_out32(drvdata, REG_OFF_EN, 0x0);
 
+	/* Nothing is scanned out any more, drop imported buffers */
+	spin_lock_irq(&drvdata->lock);
+	gslcd_fb_retire_import(drvdata, drvdata->flip_import);
+	gslcd_fb_retire_import(drvdata, drvdata->shown_import);
+	spin_unlock_irq(&drvdata->lock);
+	flush_work(&drvdata->import_work);
+
+	gslcd_fb_power_fini(dev, drvdata);
+
+	return 0;
+}
+
+static int __maybe_unused gslcdfb_runtime_suspend(struct device *dev)
+{
+	struct gslcdfb_drvdata *drvdata = dev_get_drvdata(dev);
+
+	clk_disable_unprepare(drvdata->clk);
+
 	return 0;
 }
 
+static int __maybe_unused gslcdfb_runtime_resume(struct device *dev)
+{
+	struct gslcdfb_drvdata *drvdata = dev_get_drvdata(dev);
+
+	return clk_prepare_enable(drvdata->clk);
+}
+
+static const struct dev_pm_ops gslcdfb_pm_ops = {
+	SET_RUNTIME_PM_OPS(gslcdfb_runtime_suspend, gslcdfb_runtime_resume,
+			   NULL)
+};
+
 /* ---------------------------------------------------------------------
  * OF bus binding
  */
 
+/*
+ * A bootloader that already shows a splash screen describes it with a
+ * "memory-region" holding the buffer it scans out, plus the "width",
+ * "height" and "format" it uses, as for simple-framebuffer. The driver
+ * then takes the buffer over as is instead of allocating and clearing one.
+ */
+static int gslcdfb_of_parse_splash(struct platform_device *pdev,
+				   struct gslcdfb_platform_data *pdata)
+{
+	struct device_node *node = pdev->dev.of_node;
+	const struct gslcdfb_format *fmt = NULL;
+	struct device_node *np;
+	struct resource res;
+	const char *format;
+	int i, rc;
+
+	np = of_parse_phandle(node, "memory-region", 0);
+	if (!np)
+		return 0;
+
+	rc = of_address_to_resource(np, 0, &res);
+	of_node_put(np);
+	if (rc) {
+		dev_err(&pdev->dev, "invalid memory-region\n");
+		return rc;
+	}
+
+	of_property_read_u32(node, "width", &pdata->xres);
+	of_property_read_u32(node, "height", &pdata->yres);
+	pdata->xvirt = pdata->xres;
+
+	if (!of_property_read_string(node, "format", &format)) {
+		for (i = 0; i < ARRAY_SIZE(gslcdfb_formats); i++)
+			if (!strcmp(format, gslcdfb_formats[i].name))
+				fmt = &gslcdfb_formats[i];
+		if (!fmt) {
+			dev_err(&pdev->dev, "unsupported format %s\n", format);
+			return -EINVAL;
+		}
+		pdata->bpp = fmt->bits_per_pixel;
+	}
+
+	pdata->fb_phys = res.start;
+	pdata->fb_size = resource_size(&res);
+
+	return 0;
+}
+
 static int gslcdfb_of_probe(struct platform_device *pdev)
 {
 	struct gslcdfb_platform_data pdata;
 	struct gslcdfb_drvdata *drvdata;
+	unsigned int buffers, max_buffers;
+	int rc;
 
 	/* Copy with the default pdata (not a ptr reference!) */
 	pdata = gslcd_fb_default_pdata;
 
+	if (gslcdfb_find_format(bpp))
+		pdata.bpp = bpp;
+	else
+		dev_warn(&pdev->dev, "invalid bpp %u, using %u\n",
+			bpp, pdata.bpp);
+
+	rc = gslcdfb_of_parse_splash(pdev, &pdata);
+	if (rc)
+		return rc;
+
+	buffers = num_buffers;
+	if (buffers < 1 || buffers > NUM_BUFFERS_MAX) {
+		dev_warn(&pdev->dev, "invalid num_buffers %u, using 1\n",
+			buffers);
+		buffers = 1;
+	}
+
+	/* A bootloader buffer may not have room for all of them */
+	if (pdata.fb_phys) {
+		max_buffers = pdata.fb_size /
+			(pdata.xvirt * pdata.yres * (pdata.bpp / 8));
+		if (!max_buffers) {
+			dev_err(&pdev->dev, "memory-region is too small\n");
+			return -EINVAL;
+		}
+		buffers = min(buffers, max_buffers);
+	}
+	pdata.yvirt = pdata.yres * buffers;
+
 	/* Allocate the driver data region */
 	drvdata = devm_kzalloc(&pdev->dev, sizeof(*drvdata), GFP_KERNEL);
 	if (!drvdata)
 		return -ENOMEM;
 
     dev_set_drvdata(&pdev->dev, drvdata);
-	return gslcdfb_assign(pdev, drvdata, &pdata);
+
+	rc = gslcd_fb_cabc_init(&pdev->dev, drvdata);
+	if (rc)
+		return rc;
+
+	rc = gslcdfb_assign(pdev, drvdata, &pdata);
+	if (rc) {
+		if (drvdata->backlight)
+			put_device(&drvdata->backlight->dev);
+		return rc;
+	}
+
+	gslcd_fb_cabc_start(drvdata);
+
+	return 0;
 }
 
 static int gslcdfb_of_remove(struct platform_device *op)
@@ -371,6 +2405,9 @@ static struct platform_driver gslcdfb_of_driver = {
 	.driver = {
 		.name = DRIVER_NAME,
 		.of_match_table = gslcdfb_of_match,
+		.pm = &gslcdfb_pm_ops,
+		/* exported dma-bufs reference the scanout memory */
+		.suppress_bind_attrs = true,
 	},
 };
 
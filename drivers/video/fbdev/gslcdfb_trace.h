@@ -0,0 +1,131 @@
+#if !defined(_GSLCDFB_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _GSLCDFB_TRACE_H_
+
+#include <linux/types.h>
+#include <linux/tracepoint.h>
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM gslcdfb
+#define TRACE_INCLUDE_FILE gslcdfb_trace
+
+/* A pan was requested, queued until the next vblank when queued is set */
+TRACE_EVENT(gslcdfb_pan,
+	    TP_PROTO(u32 yoffset, u32 ptr, bool queued),
+	    TP_ARGS(yoffset, ptr, queued),
+	    TP_STRUCT__entry(
+		    __field(u32, yoffset)
+		    __field(u32, ptr)
+		    __field(bool, queued)
+		    ),
+	    TP_fast_assign(
+		    __entry->yoffset = yoffset;
+		    __entry->ptr = ptr;
+		    __entry->queued = queued;
+		    ),
+	    TP_printk("yoffset=%u, ptr=0x%08x, queued=%d", __entry->yoffset,
+		      __entry->ptr, __entry->queued)
+);
+
+/*
+ * Vblank interrupt. When flipped is set, ptr was written to the hardware
+ * and the next frame scanned out starts at it.
+ */
+TRACE_EVENT(gslcdfb_vblank,
+	    TP_PROTO(unsigned long seq, bool flipped, u32 ptr),
+	    TP_ARGS(seq, flipped, ptr),
+	    TP_STRUCT__entry(
+		    __field(unsigned long, seq)
+		    __field(bool, flipped)
+		    __field(u32, ptr)
+		    ),
+	    TP_fast_assign(
+		    __entry->seq = seq;
+		    __entry->flipped = flipped;
+		    __entry->ptr = ptr;
+		    ),
+	    TP_printk("seq=%lu, flipped=%d, ptr=0x%08x", __entry->seq,
+		      __entry->flipped, __entry->ptr)
+);
+
+/*
+ * A flip was latched one or more frames later than the one before it,
+ * so the previous frame stayed on screen for missed extra refreshes.
+ * Meant as a snapshot trigger for always-on tracing of frame hitches.
+ */
+TRACE_EVENT(gslcdfb_vblank_missed,
+	    TP_PROTO(unsigned long seq, u32 missed),
+	    TP_ARGS(seq, missed),
+	    TP_STRUCT__entry(
+		    __field(unsigned long, seq)
+		    __field(u32, missed)
+		    ),
+	    TP_fast_assign(
+		    __entry->seq = seq;
+		    __entry->missed = missed;
+		    ),
+	    TP_printk("seq=%lu, missed=%u", __entry->seq, __entry->missed)
+);
+
+TRACE_EVENT(gslcdfb_wait_vsync_begin,
+	    TP_PROTO(unsigned long seq),
+	    TP_ARGS(seq),
+	    TP_STRUCT__entry(
+		    __field(unsigned long, seq)
+		    ),
+	    TP_fast_assign(
+		    __entry->seq = seq;
+		    ),
+	    TP_printk("seq=%lu", __entry->seq)
+);
+
+TRACE_EVENT(gslcdfb_wait_vsync_end,
+	    TP_PROTO(unsigned long seq, int ret),
+	    TP_ARGS(seq, ret),
+	    TP_STRUCT__entry(
+		    __field(unsigned long, seq)
+		    __field(int, ret)
+		    ),
+	    TP_fast_assign(
+		    __entry->seq = seq;
+		    __entry->ret = ret;
+		    ),
+	    TP_printk("seq=%lu, ret=%d", __entry->seq, __entry->ret)
+);
+
+/* Dirty regions of the shadow buffer copied to the scanout buffer */
+TRACE_EVENT(gslcdfb_shadow_flush,
+	    TP_PROTO(unsigned int pages, u32 y1, u32 y2),
+	    TP_ARGS(pages, y1, y2),
+	    TP_STRUCT__entry(
+		    __field(unsigned int, pages)
+		    __field(u32, y1)
+		    __field(u32, y2)
+		    ),
+	    TP_fast_assign(
+		    __entry->pages = pages;
+		    __entry->y1 = y1;
+		    __entry->y2 = y2;
+		    ),
+	    TP_printk("pages=%u, lines=[%u, %u)", __entry->pages,
+		      __entry->y1, __entry->y2)
+);
+
+/* Scanout fetches stopped or resumed for panel self-refresh */
+TRACE_EVENT(gslcdfb_self_refresh,
+	    TP_PROTO(bool active),
+	    TP_ARGS(active),
+	    TP_STRUCT__entry(
+		    __field(bool, active)
+		    ),
+	    TP_fast_assign(
+		    __entry->active = active;
+		    ),
+	    TP_printk("active=%d", __entry->active)
+);
+
+#endif /* _GSLCDFB_TRACE_H_ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#include <trace/define_trace.h>
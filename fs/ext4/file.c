@@ -435,6 +435,9 @@ static int ext4_file_open(struct inode * inode, struct file * filp)
 		if (ret < 0)
 			return ret;
 	}
+	/* DAX reads do not go through the page cache */
+	if (!IS_DAX(inode))
+		filp->f_mode |= FMODE_NOWAIT;
 	return dquot_file_open(inode, filp);
 }
 
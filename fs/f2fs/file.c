@@ -452,6 +452,8 @@ static int f2fs_file_open(struct inode *inode, struct file *filp)
 		return -EPERM;
 	}
 	dput(dir);
+	if (!ret)
+		filp->f_mode |= FMODE_NOWAIT;
 	return ret;
 }
 
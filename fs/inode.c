@@ -730,6 +730,12 @@ static enum lru_status inode_lru_isolate(struct list_head *item,
 		return LRU_ROTATE;
 	}
 
+	/* Dropping the inode would drop the page cache it keeps resident */
+	if (inode->i_data.nrpages && mapping_keep_resident(&inode->i_data)) {
+		spin_unlock(&inode->i_lock);
+		return LRU_ROTATE;
+	}
+
 	if (inode_has_buffers(inode) || inode->i_data.nrpages) {
 		__iget(inode);
 		spin_unlock(&inode->i_lock);
@@ -141,6 +141,8 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 	struct file *new_file;
 	loff_t old_pos = 0;
 	loff_t new_pos = 0;
+	loff_t data_pos = -1;
+	bool skip_hole = false;
 	int error = 0;
 
 	if (len == 0)
@@ -163,7 +165,15 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 	/* Couldn't clone, so now we try to copy the data */
 	error = 0;
 
-	/* FIXME: copy up sparse files efficiently */
+	/*
+	 * Holes of the lower file are left as holes in the upper file, if
+	 * the lower fs can tell where they are. Sizing the upper file first
+	 * covers a hole at the end.
+	 */
+	if ((old_file->f_mode & FMODE_LSEEK) && old_file->f_op->llseek &&
+	    !do_truncate(new->dentry, len, 0, new_file))
+		skip_hole = true;
+
 	while (len) {
 		size_t this_len = OVL_COPY_UP_CHUNK_SIZE;
 		long bytes;
@@ -176,6 +186,24 @@ static int ovl_copy_up_data(struct path *old, struct path *new, loff_t len)
 			break;
 		}
 
+		/*
+		 * Ask for the next data only once past the last one found;
+		 * a lower fs without hole support just reports all of the
+		 * file as data.
+		 */
+		if (skip_hole && data_pos < old_pos) {
+			data_pos = vfs_llseek(old_file, old_pos, SEEK_DATA);
+			if (data_pos > old_pos) {
+				len -= min_t(loff_t, len, data_pos - old_pos);
+				old_pos = new_pos = data_pos;
+				continue;
+			} else if (data_pos == -ENXIO) {
+				break;
+			} else if (data_pos < 0) {
+				skip_hole = false;
+			}
+		}
+
 		bytes = do_splice_direct(old_file, &old_pos,
 					 new_file, &new_pos,
 					 this_len, SPLICE_F_MOVE);
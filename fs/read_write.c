@@ -678,7 +678,16 @@ static ssize_t do_iter_readv_writev(struct file *filp, struct iov_iter *iter,
 	struct kiocb kiocb;
 	ssize_t ret;
 
-	if (flags & ~(RWF_HIPRI | RWF_DSYNC | RWF_SYNC))
+	if (flags & ~(RWF_HIPRI | RWF_DSYNC | RWF_SYNC | RWF_NOWAIT))
+		return -EOPNOTSUPP;
+
+	/*
+	 * Only buffered reads know how to avoid blocking, and only on files
+	 * whose ->read_iter() is the generic page cache read path.
+	 */
+	if ((flags & RWF_NOWAIT) &&
+	    (type != READ || (filp->f_flags & O_DIRECT) ||
+	     !(filp->f_mode & FMODE_NOWAIT)))
 		return -EOPNOTSUPP;
 
 	init_sync_kiocb(&kiocb, filp);
@@ -688,6 +697,8 @@ static ssize_t do_iter_readv_writev(struct file *filp, struct iov_iter *iter,
 		kiocb.ki_flags |= IOCB_DSYNC;
 	if (flags & RWF_SYNC)
 		kiocb.ki_flags |= (IOCB_DSYNC | IOCB_SYNC);
+	if (flags & RWF_NOWAIT)
+		kiocb.ki_flags |= IOCB_NOWAIT;
 	kiocb.ki_pos = *ppos;
 
 	if (type == READ)
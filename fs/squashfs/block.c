@@ -79,6 +79,61 @@ static struct buffer_head *get_block_length(struct super_block *sb,
 }
 
 
+/*
+ * Wait for the buffers of a block to be read in, and decompress them or
+ * copy them if the block is uncompressed.  The buffers are released in
+ * all cases.
+ */
+static int squashfs_read_bh(struct squashfs_sb_info *msblk,
+	struct buffer_head **bh, int b, int offset, int length, int compressed,
+	struct squashfs_page_actor *output)
+{
+	int bytes, in, avail, pg_offset = 0, k = 0, i;
+	void *data;
+
+	for (i = 0; i < b; i++) {
+		wait_on_buffer(bh[i]);
+		if (!buffer_uptodate(bh[i]))
+			goto block_release;
+	}
+
+	if (compressed)
+		return squashfs_decompress(msblk, bh, b, offset, length, output);
+
+	/*
+	 * Block is uncompressed.
+	 */
+	data = squashfs_first_page(output);
+
+	for (bytes = length; k < b; k++) {
+		in = min(bytes, msblk->devblksize - offset);
+		bytes -= in;
+		while (in) {
+			if (pg_offset == PAGE_SIZE) {
+				data = squashfs_next_page(output);
+				pg_offset = 0;
+			}
+			avail = min_t(int, in, PAGE_SIZE - pg_offset);
+			memcpy(data + pg_offset, bh[k]->b_data + offset, avail);
+			in -= avail;
+			pg_offset += avail;
+			offset += avail;
+		}
+		offset = 0;
+		put_bh(bh[k]);
+	}
+	squashfs_finish_page(output);
+
+	return length;
+
+block_release:
+	for (; k < b; k++)
+		put_bh(bh[k]);
+
+	return -EIO;
+}
+
+
 /*
  * Read and decompress a metadata block or datablock.  Length is non-zero
  * if a datablock is being read (the size is stored elsewhere in the
@@ -95,7 +150,7 @@ int squashfs_read_data(struct super_block *sb, u64 index, int length,
 	struct buffer_head **bh;
 	int offset = index & ((1 << msblk->devblksize_log2) - 1);
 	u64 cur_index = index >> msblk->devblksize_log2;
-	int bytes, compressed, b = 0, k = 0, avail, i;
+	int bytes, compressed, b = 0, k = 0;
 
 	bh = kcalloc(((output->length + msblk->devblksize - 1)
 		>> msblk->devblksize_log2) + 1, sizeof(*bh), GFP_KERNEL);
@@ -160,45 +215,10 @@ int squashfs_read_data(struct super_block *sb, u64 index, int length,
 		ll_rw_block(REQ_OP_READ, 0, b - 1, bh + 1);
 	}
 
-	for (i = 0; i < b; i++) {
-		wait_on_buffer(bh[i]);
-		if (!buffer_uptodate(bh[i]))
-			goto block_release;
-	}
-
-	if (compressed) {
-		length = squashfs_decompress(msblk, bh, b, offset, length,
-			output);
-		if (length < 0)
-			goto read_failure;
-	} else {
-		/*
-		 * Block is uncompressed.
-		 */
-		int in, pg_offset = 0;
-		void *data = squashfs_first_page(output);
-
-		for (bytes = length; k < b; k++) {
-			in = min(bytes, msblk->devblksize - offset);
-			bytes -= in;
-			while (in) {
-				if (pg_offset == PAGE_SIZE) {
-					data = squashfs_next_page(output);
-					pg_offset = 0;
-				}
-				avail = min_t(int, in, PAGE_SIZE -
-						pg_offset);
-				memcpy(data + pg_offset, bh[k]->b_data + offset,
-						avail);
-				in -= avail;
-				pg_offset += avail;
-				offset += avail;
-			}
-			offset = 0;
-			put_bh(bh[k]);
-		}
-		squashfs_finish_page(output);
-	}
+	length = squashfs_read_bh(msblk, bh, b, offset, length, compressed,
+		output);
+	if (length < 0)
+		goto read_failure;
 
 	kfree(bh);
 	return length;
@@ -213,3 +233,75 @@ read_failure:
 	kfree(bh);
 	return -EIO;
 }
+
+
+/*
+ * Start reading a datablock, without waiting for it to be read in.  This is
+ * used by readahead to keep several datablocks in flight, while the ones
+ * that have arrived are being decompressed.  squashfs_read_data_end() waits
+ * for the datablock and decompresses it into req->output.
+ */
+int squashfs_read_data_start(struct super_block *sb, u64 index, int length,
+		struct squashfs_read_req *req)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	struct squashfs_page_actor *output = req->output;
+	int offset = index & ((1 << msblk->devblksize_log2) - 1);
+	u64 cur_index = index >> msblk->devblksize_log2;
+	int bytes = -offset, b;
+
+	req->index = index;
+	req->offset = offset;
+	req->compressed = SQUASHFS_COMPRESSED_BLOCK(length);
+	req->length = length = SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
+
+	TRACE("Readahead block @ 0x%llx, %scompressed size %d, src size %d\n",
+		index, req->compressed ? "" : "un", length, output->length);
+
+	if (length <= 0 || length > output->length ||
+			(index + length) > msblk->bytes_used)
+		goto read_failure;
+
+	req->bh = kcalloc(((output->length + msblk->devblksize - 1)
+		>> msblk->devblksize_log2) + 1, sizeof(*req->bh), GFP_KERNEL);
+	if (req->bh == NULL)
+		return -ENOMEM;
+
+	for (b = 0; bytes < length; b++, cur_index++) {
+		req->bh[b] = sb_getblk(sb, cur_index);
+		if (req->bh[b] == NULL)
+			goto block_release;
+		bytes += msblk->devblksize;
+	}
+	req->b = b;
+	ll_rw_block(REQ_OP_READ, 0, b, req->bh);
+
+	return 0;
+
+block_release:
+	while (b--)
+		put_bh(req->bh[b]);
+	kfree(req->bh);
+
+read_failure:
+	ERROR("squashfs_read_data failed to read block 0x%llx\n",
+					(unsigned long long) index);
+	return -EIO;
+}
+
+
+int squashfs_read_data_end(struct super_block *sb,
+		struct squashfs_read_req *req)
+{
+	int length = squashfs_read_bh(sb->s_fs_info, req->bh, req->b,
+		req->offset, req->length, req->compressed, req->output);
+
+	kfree(req->bh);
+	if (length < 0) {
+		ERROR("squashfs_read_data failed to read block 0x%llx\n",
+					(unsigned long long) req->index);
+		return -EIO;
+	}
+
+	return length;
+}
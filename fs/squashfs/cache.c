@@ -58,6 +58,141 @@
 #include "squashfs.h"
 #include "page_actor.h"
 
+/*
+ * Allocate the buffers of a cache entry, as a sequence of kmalloced
+ * PAGE_SIZE buffers to avoid vmalloc fragmentation issues.
+ */
+static void **squashfs_cache_alloc_data(struct squashfs_cache *cache,
+	gfp_t gfp)
+{
+	void **data = kcalloc(cache->pages, sizeof(void *), gfp);
+	int i;
+
+	if (data == NULL)
+		return NULL;
+
+	for (i = 0; i < cache->pages; i++) {
+		data[i] = kmalloc(PAGE_SIZE, gfp);
+		if (data[i] == NULL)
+			goto failed;
+	}
+
+	return data;
+
+failed:
+	while (i--)
+		kfree(data[i]);
+	kfree(data);
+	return NULL;
+}
+
+
+static void squashfs_cache_free_data(struct squashfs_cache *cache,
+	void **data)
+{
+	int i;
+
+	if (data == NULL)
+		return;
+
+	for (i = 0; i < cache->pages; i++)
+		kfree(data[i]);
+	kfree(data);
+}
+
+
+/*
+ * Add an entry to a cache that is below its maximum size.  This is
+ * opportunistic, the entry is only allocated if memory is free, and the
+ * shrinker takes it away again under memory pressure.  The round-robin
+ * strategy picks the new entry next.  Called with cache->growing set.
+ */
+static void squashfs_cache_grow(struct squashfs_cache *cache)
+{
+	struct squashfs_cache_entry *entry;
+	struct squashfs_page_actor *actor;
+	void **data;
+	int i;
+
+	data = squashfs_cache_alloc_data(cache, GFP_NOWAIT | __GFP_NOWARN);
+	if (data == NULL)
+		return;
+
+	actor = squashfs_page_actor_init(data, cache->pages, 0);
+	if (actor == NULL) {
+		squashfs_cache_free_data(cache, data);
+		return;
+	}
+
+	spin_lock(&cache->lock);
+	i = cache->entries++;
+	entry = &cache->entry[i];
+	entry->block = SQUASHFS_INVALID_BLK;
+	entry->refcount = 0;
+	entry->data = data;
+	entry->actor = actor;
+	cache->unused++;
+	cache->next_blk = i;
+	spin_unlock(&cache->lock);
+
+	TRACE("Grew %s cache to %d entries\n", cache->name, i + 1);
+}
+
+
+/*
+ * Shrinker of a cache that may grow, it frees the unused entries added
+ * on top of min_entries, starting from the last one.
+ */
+static unsigned long squashfs_cache_count(struct shrinker *shrink,
+	struct shrink_control *sc)
+{
+	struct squashfs_cache *cache = container_of(shrink,
+		struct squashfs_cache, shrinker);
+
+	return READ_ONCE(cache->entries) - cache->min_entries;
+}
+
+
+static unsigned long squashfs_cache_scan(struct shrinker *shrink,
+	struct shrink_control *sc)
+{
+	struct squashfs_cache *cache = container_of(shrink,
+		struct squashfs_cache, shrinker);
+	struct squashfs_cache_entry *entry;
+	struct squashfs_page_actor *actor;
+	unsigned long freed = 0;
+	void **data;
+
+	while (freed < sc->nr_to_scan) {
+		spin_lock(&cache->lock);
+		entry = &cache->entry[cache->entries - 1];
+		if (cache->entries == cache->min_entries || entry->refcount) {
+			spin_unlock(&cache->lock);
+			break;
+		}
+
+		data = entry->data;
+		actor = entry->actor;
+		entry->data = NULL;
+		entry->actor = NULL;
+		entry->block = SQUASHFS_INVALID_BLK;
+		cache->entries--;
+		cache->unused--;
+		if (cache->curr_blk >= cache->entries)
+			cache->curr_blk = 0;
+		if (cache->next_blk >= cache->entries)
+			cache->next_blk = 0;
+		spin_unlock(&cache->lock);
+
+		kfree(actor);
+		squashfs_cache_free_data(cache, data);
+		freed++;
+	}
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
@@ -65,7 +200,7 @@
 struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	struct squashfs_cache *cache, u64 block, int length)
 {
-	int i, n;
+	int i, n, grow = 1;
 	struct squashfs_cache_entry *entry;
 
 	spin_lock(&cache->lock);
@@ -80,6 +215,21 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		}
 
 		if (n == cache->entries) {
+			/*
+			 * Block not in cache.  If the cache may grow, try once
+			 * to add an entry for it rather than evicting one.
+			 */
+			if (grow && cache->entries < cache->max_entries &&
+					!cache->growing) {
+				grow = 0;
+				cache->growing = 1;
+				spin_unlock(&cache->lock);
+				squashfs_cache_grow(cache);
+				spin_lock(&cache->lock);
+				cache->growing = 0;
+				continue;
+			}
+
 			/*
 			 * Block not in cache, if all cache entries are used
 			 * go to sleep waiting for one to become available.
@@ -209,17 +359,16 @@ void squashfs_cache_put(struct squashfs_cache_entry *entry)
  */
 void squashfs_cache_delete(struct squashfs_cache *cache)
 {
-	int i, j;
+	int i;
 
 	if (cache == NULL)
 		return;
 
+	if (cache->max_entries > cache->min_entries)
+		unregister_shrinker(&cache->shrinker);
+
 	for (i = 0; i < cache->entries; i++) {
-		if (cache->entry[i].data) {
-			for (j = 0; j < cache->pages; j++)
-				kfree(cache->entry[i].data[j]);
-			kfree(cache->entry[i].data);
-		}
+		squashfs_cache_free_data(cache, cache->entry[i].data);
 		kfree(cache->entry[i].actor);
 	}
 
@@ -230,13 +379,13 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 
 /*
  * Initialise cache allocating the specified number of entries, each of
- * size block_size.  To avoid vmalloc fragmentation issues each entry
- * is allocated as a sequence of kmalloced PAGE_SIZE buffers.
+ * size block_size.  The cache may grow up to max_entries when memory is
+ * free.
  */
 struct squashfs_cache *squashfs_cache_init(char *name, int entries,
-	int block_size)
+	int max_entries, int block_size)
 {
-	int i, j;
+	int i;
 	struct squashfs_cache *cache = kzalloc(sizeof(*cache), GFP_KERNEL);
 
 	if (cache == NULL) {
@@ -244,7 +393,9 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		return NULL;
 	}
 
-	cache->entry = kcalloc(entries, sizeof(*(cache->entry)), GFP_KERNEL);
+	max_entries = max(entries, max_entries);
+	cache->entry = kcalloc(max_entries, sizeof(*(cache->entry)),
+		GFP_KERNEL);
 	if (cache->entry == NULL) {
 		ERROR("Failed to allocate %s cache\n", name);
 		goto cleanup;
@@ -254,6 +405,8 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	cache->next_blk = 0;
 	cache->unused = entries;
 	cache->entries = entries;
+	cache->min_entries = entries;
+	cache->max_entries = max_entries;
 	cache->block_size = block_size;
 	cache->pages = block_size >> PAGE_SHIFT;
 	cache->pages = cache->pages ? cache->pages : 1;
@@ -262,26 +415,21 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	spin_lock_init(&cache->lock);
 	init_waitqueue_head(&cache->wait_queue);
 
-	for (i = 0; i < entries; i++) {
+	for (i = 0; i < max_entries; i++) {
 		struct squashfs_cache_entry *entry = &cache->entry[i];
 
 		init_waitqueue_head(&cache->entry[i].wait_queue);
 		entry->cache = cache;
 		entry->block = SQUASHFS_INVALID_BLK;
-		entry->data = kcalloc(cache->pages, sizeof(void *), GFP_KERNEL);
+		if (i >= entries)
+			continue;
+
+		entry->data = squashfs_cache_alloc_data(cache, GFP_KERNEL);
 		if (entry->data == NULL) {
-			ERROR("Failed to allocate %s cache entry\n", name);
+			ERROR("Failed to allocate %s buffer\n", name);
 			goto cleanup;
 		}
 
-		for (j = 0; j < cache->pages; j++) {
-			entry->data[j] = kmalloc(PAGE_SIZE, GFP_KERNEL);
-			if (entry->data[j] == NULL) {
-				ERROR("Failed to allocate %s buffer\n", name);
-				goto cleanup;
-			}
-		}
-
 		entry->actor = squashfs_page_actor_init(entry->data,
 						cache->pages, 0);
 		if (entry->actor == NULL) {
@@ -290,9 +438,20 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		}
 	}
 
+	if (max_entries > entries) {
+		cache->shrinker.count_objects = squashfs_cache_count;
+		cache->shrinker.scan_objects = squashfs_cache_scan;
+		cache->shrinker.seeks = DEFAULT_SEEKS;
+		if (register_shrinker(&cache->shrinker)) {
+			/* Keep the cache at its initial size */
+			cache->max_entries = entries;
+		}
+	}
+
 	return cache;
 
 cleanup:
+	cache->max_entries = entries;
 	squashfs_cache_delete(cache);
 	return NULL;
 }
@@ -382,6 +541,24 @@ error:
 }
 
 
+/*
+ * Check whether <block> is in the cache, or being read into it, without
+ * reading it.
+ */
+bool squashfs_cache_cached(struct squashfs_cache *cache, u64 block)
+{
+	int i;
+	bool found = false;
+
+	spin_lock(&cache->lock);
+	for (i = 0; i < cache->entries && !found; i++)
+		found = cache->entry[i].block == block;
+	spin_unlock(&cache->lock);
+
+	return found;
+}
+
+
 /*
  * Look-up in the fragmment cache the fragment located at <start_block> in the
  * filesystem.  If necessary read and decompress it from disk.
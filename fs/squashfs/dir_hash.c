@@ -0,0 +1,350 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * dir_hash.c
+ */
+
+/*
+ * This file implements an in-memory name hash for large directories.
+ *
+ * Even with the directory index, a lookup decompresses the metadata block
+ * the name would be in and scans it linearly, and so does the lookup of
+ * every name that does not exist. For directories large enough to have
+ * an index, the first lookup instead reads the whole directory once and
+ * hashes all its names, so later lookups, positive and negative, are
+ * answered without touching the metadata. The filesystem is read only,
+ * so a hash never goes stale.
+ *
+ * Lookups use the hash under RCU. A shrinker drops hashes under memory
+ * pressure, giving recently used ones a second chance.
+ */
+
+#include <linux/fs.h>
+#include <linux/vfs.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/string.h>
+#include <linux/stringhash.h>
+#include <linux/log2.h>
+#include <linux/rcupdate.h>
+#include <linux/shrinker.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+
+struct squashfs_dir_hash_entry {
+	u64		ino;
+	unsigned int	ino_num;
+	u32		hash;
+	unsigned int	name;		/* offset into names */
+	unsigned int	len;
+};
+
+struct squashfs_dir_hash {
+	struct list_head		lru;
+	struct rcu_head			rcu;
+	struct squashfs_inode_info	*owner;
+	bool				referenced;
+	unsigned int			mask;		/* buckets - 1 */
+	u32				*buckets;	/* entry + 1, or 0 */
+	struct squashfs_dir_hash_entry	*entries;
+	char				*names;
+};
+
+/* Beyond this, a directory is most likely corrupt */
+#define SQUASHFS_DIR_HASH_MAX_SIZE	(16 << 20)
+
+static LIST_HEAD(squashfs_dir_hash_lru);
+static DEFINE_SPINLOCK(squashfs_dir_hash_lock);
+static unsigned long squashfs_dir_hash_count;
+
+
+/*
+ * Read all entries of dir into a hash. Returns NULL if memory is short or
+ * the directory is corrupt, in which case lookups fall back to scanning
+ * the directory, which reports any error.
+ */
+static struct squashfs_dir_hash *squashfs_dir_hash_build(struct inode *dir)
+{
+	struct super_block *sb = dir->i_sb;
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	u64 block = squashfs_i(dir)->start + msblk->directory_table;
+	int offset = squashfs_i(dir)->offset;
+	loff_t length = 3, size = i_size_read(dir);
+	struct squashfs_dir_header dirh;
+	struct squashfs_dir_entry *dire;
+	struct squashfs_dir_hash_entry *entries = NULL, *e;
+	struct squashfs_dir_hash *hash = NULL;
+	unsigned int limit, count = 0, names = 0, nbuckets, dir_count, len, i;
+	char *namebuf = NULL;
+	size_t off_entries, off_names;
+	int err;
+
+	if (size > SQUASHFS_DIR_HASH_MAX_SIZE)
+		return NULL;
+
+	/* Each entry takes at least its header and a one byte name */
+	limit = size / (sizeof(*dire) + 1);
+
+	dire = kmalloc(sizeof(*dire) + SQUASHFS_NAME_LEN + 1, GFP_KERNEL);
+	entries = kvmalloc_array(limit, sizeof(*entries), GFP_KERNEL);
+	namebuf = kvmalloc(size, GFP_KERNEL);
+	if (dire == NULL || entries == NULL || namebuf == NULL)
+		goto out;
+
+	while (length < size) {
+		err = squashfs_read_metadata(sb, &dirh, &block, &offset,
+				sizeof(dirh));
+		if (err < 0)
+			goto out;
+
+		length += sizeof(dirh);
+
+		dir_count = le32_to_cpu(dirh.count) + 1;
+		if (dir_count > SQUASHFS_DIR_COUNT)
+			goto out;
+
+		while (dir_count--) {
+			err = squashfs_read_metadata(sb, dire, &block, &offset,
+					sizeof(*dire));
+			if (err < 0)
+				goto out;
+
+			len = le16_to_cpu(dire->size) + 1;
+			if (len > SQUASHFS_NAME_LEN)
+				goto out;
+
+			err = squashfs_read_metadata(sb, dire->name, &block,
+					&offset, len);
+			if (err < 0)
+				goto out;
+
+			length += sizeof(*dire) + len;
+
+			if (count == limit || names + len > size)
+				goto out;
+
+			e = &entries[count++];
+			e->ino = SQUASHFS_MKINODE(le32_to_cpu(dirh.start_block),
+					le16_to_cpu(dire->offset));
+			e->ino_num = le32_to_cpu(dirh.inode_number) +
+					(short) le16_to_cpu(dire->inode_number);
+			e->hash = full_name_hash(NULL, dire->name, len);
+			e->name = names;
+			e->len = len;
+			memcpy(namebuf + names, dire->name, len);
+			names += len;
+		}
+	}
+
+	/* At most half full, so probe sequences stay short */
+	nbuckets = roundup_pow_of_two(max(count, 1U) * 2);
+	off_entries = ALIGN(sizeof(*hash) + nbuckets * sizeof(u32),
+			__alignof__(*entries));
+	off_names = off_entries + count * sizeof(*entries);
+
+	hash = kvzalloc(off_names + names, GFP_KERNEL);
+	if (hash == NULL)
+		goto out;
+
+	hash->mask = nbuckets - 1;
+	hash->buckets = (u32 *) (hash + 1);
+	hash->entries = (void *) hash + off_entries;
+	hash->names = (void *) hash + off_names;
+	memcpy(hash->entries, entries, count * sizeof(*entries));
+	memcpy(hash->names, namebuf, names);
+
+	for (i = 0; i < count; i++) {
+		unsigned int b = entries[i].hash & hash->mask;
+
+		while (hash->buckets[b])
+			b = (b + 1) & hash->mask;
+		hash->buckets[b] = i + 1;
+	}
+
+out:
+	kvfree(namebuf);
+	kvfree(entries);
+	kfree(dire);
+	return hash;
+}
+
+
+static void squashfs_dir_hash_free(struct rcu_head *head)
+{
+	kvfree(container_of(head, struct squashfs_dir_hash, rcu));
+}
+
+
+/* Called with squashfs_dir_hash_lock held */
+static void squashfs_dir_hash_unlink(struct squashfs_dir_hash *hash)
+{
+	RCU_INIT_POINTER(hash->owner->dir_hash, NULL);
+	list_del(&hash->lru);
+	squashfs_dir_hash_count--;
+	call_rcu(&hash->rcu, squashfs_dir_hash_free);
+}
+
+
+static void squashfs_dir_hash_install(struct squashfs_inode_info *sqi,
+	struct squashfs_dir_hash *hash)
+{
+	spin_lock(&squashfs_dir_hash_lock);
+	if (rcu_access_pointer(sqi->dir_hash)) {
+		/* A concurrent lookup built it first */
+		spin_unlock(&squashfs_dir_hash_lock);
+		kvfree(hash);
+		return;
+	}
+
+	hash->owner = sqi;
+	list_add(&hash->lru, &squashfs_dir_hash_lru);
+	squashfs_dir_hash_count++;
+	rcu_assign_pointer(sqi->dir_hash, hash);
+	spin_unlock(&squashfs_dir_hash_lock);
+}
+
+
+/*
+ * Look up name in the hash of dir, building the hash on first use.
+ * Returns 0 and the location of the inode if the name exists, -ENOENT if
+ * it does not, or -EAGAIN if there is no hash and the caller has to scan
+ * the directory.
+ */
+int squashfs_dir_hash_lookup(struct inode *dir, const char *name, int len,
+	long long *ino, unsigned int *ino_num)
+{
+	struct squashfs_inode_info *sqi = squashfs_i(dir);
+	struct squashfs_dir_hash *hash;
+	struct squashfs_dir_hash_entry *e;
+	u32 h = full_name_hash(NULL, name, len);
+	unsigned int b, i;
+	int ret = -ENOENT;
+
+	/* Small directories have no index, and are cheap to scan */
+	if (sqi->dir_idx_cnt == 0)
+		return -EAGAIN;
+
+	rcu_read_lock();
+	hash = rcu_dereference(sqi->dir_hash);
+	if (hash == NULL) {
+		rcu_read_unlock();
+
+		hash = squashfs_dir_hash_build(dir);
+		if (hash == NULL)
+			return -EAGAIN;
+		squashfs_dir_hash_install(sqi, hash);
+
+		rcu_read_lock();
+		hash = rcu_dereference(sqi->dir_hash);
+		if (hash == NULL) {
+			rcu_read_unlock();
+			return -EAGAIN;
+		}
+	}
+
+	if (!READ_ONCE(hash->referenced))
+		WRITE_ONCE(hash->referenced, true);
+
+	for (b = h & hash->mask; (i = hash->buckets[b]);
+			b = (b + 1) & hash->mask) {
+		e = &hash->entries[i - 1];
+		if (e->hash == h && e->len == len &&
+				!memcmp(hash->names + e->name, name, len)) {
+			*ino = e->ino;
+			*ino_num = e->ino_num;
+			ret = 0;
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
+
+/* Drop the hash of a directory inode being destroyed */
+void squashfs_dir_hash_evict(struct inode *inode)
+{
+	struct squashfs_inode_info *sqi = squashfs_i(inode);
+	struct squashfs_dir_hash *hash;
+
+	if (!S_ISDIR(inode->i_mode) || !rcu_access_pointer(sqi->dir_hash))
+		return;
+
+	spin_lock(&squashfs_dir_hash_lock);
+	hash = rcu_dereference_protected(sqi->dir_hash,
+			lockdep_is_held(&squashfs_dir_hash_lock));
+	if (hash)
+		squashfs_dir_hash_unlink(hash);
+	spin_unlock(&squashfs_dir_hash_lock);
+}
+
+
+static unsigned long squashfs_dir_hash_shrink_count(struct shrinker *shrink,
+	struct shrink_control *sc)
+{
+	return READ_ONCE(squashfs_dir_hash_count);
+}
+
+
+static unsigned long squashfs_dir_hash_shrink_scan(struct shrinker *shrink,
+	struct shrink_control *sc)
+{
+	struct squashfs_dir_hash *hash, *prev;
+	unsigned long nr = sc->nr_to_scan, freed = 0;
+
+	spin_lock(&squashfs_dir_hash_lock);
+	list_for_each_entry_safe_reverse(hash, prev, &squashfs_dir_hash_lru,
+			lru) {
+		if (nr-- == 0)
+			break;
+
+		if (hash->referenced) {
+			hash->referenced = false;
+			list_move(&hash->lru, &squashfs_dir_hash_lru);
+			continue;
+		}
+
+		squashfs_dir_hash_unlink(hash);
+		freed++;
+	}
+	spin_unlock(&squashfs_dir_hash_lock);
+
+	return freed;
+}
+
+
+static struct shrinker squashfs_dir_hash_shrinker = {
+	.count_objects = squashfs_dir_hash_shrink_count,
+	.scan_objects = squashfs_dir_hash_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+
+int __init squashfs_dir_hash_init(void)
+{
+	return register_shrinker(&squashfs_dir_hash_shrinker);
+}
+
+
+void squashfs_dir_hash_exit(void)
+{
+	unregister_shrinker(&squashfs_dir_hash_shrinker);
+}
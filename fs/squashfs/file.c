@@ -420,10 +420,40 @@ static int squashfs_readpage_fragment(struct page *page)
 {
 	struct inode *inode = page->mapping->host;
 	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
-	struct squashfs_cache_entry *buffer = squashfs_get_fragment(inode->i_sb,
+	struct squashfs_cache_entry *buffer;
+	int res;
+
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	/*
+	 * A fragment that is not cached is decompressed directly into the
+	 * page cache, leaving the fragment cache alone.  That is only worth it
+	 * for a fragment read once, fragment_hint remembers the last fragment
+	 * read that way and the next read of it goes through the cache.  The
+	 * hint may be stale or torn, it only costs an extra decompression.
+	 */
+	if (!squashfs_cache_cached(msblk->fragment_cache,
+				squashfs_i(inode)->fragment_block) &&
+			READ_ONCE(msblk->fragment_hint) !=
+				squashfs_i(inode)->fragment_block) {
+		WRITE_ONCE(msblk->fragment_hint,
+			squashfs_i(inode)->fragment_block);
+		res = squashfs_readpage_tail(page,
+			squashfs_i(inode)->fragment_block,
+			squashfs_i(inode)->fragment_size,
+			squashfs_i(inode)->fragment_offset,
+			i_size_read(inode) & (msblk->block_size - 1));
+		if (res)
+			ERROR("Unable to read page, block %llx, size %x\n",
+				squashfs_i(inode)->fragment_block,
+				squashfs_i(inode)->fragment_size);
+		return res;
+	}
+#endif
+
+	buffer = squashfs_get_fragment(inode->i_sb,
 		squashfs_i(inode)->fragment_block,
 		squashfs_i(inode)->fragment_size);
-	int res = buffer->error;
+	res = buffer->error;
 
 	if (res)
 		ERROR("Unable to read page, block %llx, size %x\n",
@@ -497,7 +527,157 @@ out:
 	return 0;
 }
 
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+/*
+ * Readahead of a run of pages from one block.  Datablocks the run covers
+ * completely are read asynchronously, anything else goes through
+ * squashfs_readpage().  The pages are locked in the page cache.
+ */
+static void squashfs_readahead_run(struct file *file, struct page **page,
+	int pages)
+{
+	struct inode *inode = page[0]->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int index = page[0]->index >> (msblk->block_log - PAGE_SHIFT);
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	int last = (i_size_read(inode) - 1) >> PAGE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
+	int start_index = page[0]->index & ~mask;
+	int end_index = min(start_index | mask, last);
+	int i;
+
+	if (page[0]->index == start_index &&
+			page[pages - 1]->index == end_index &&
+			(index < file_end || squashfs_i(inode)->fragment_block ==
+					SQUASHFS_INVALID_BLK)) {
+		u64 block = 0;
+		int bsize = read_blocklist(inode, index, &block);
+
+		if (bsize > 0 && !squashfs_readahead_block(inode, block, bsize,
+							page, pages))
+			return;
+	}
+
+	for (i = 0; i < pages; i++) {
+		squashfs_readpage(file, page[i]);
+		put_page(page[i]);
+	}
+}
+
+
+/*
+ * Read the readahead window a whole datablock at a time.  All the
+ * datablocks are submitted for reading before any of them is decompressed,
+ * decompression then runs asynchronously as each datablock arrives.  This
+ * keeps the device busy with the next datablocks while the CPUs decompress.
+ */
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned int nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	struct page **run;
+	int n = 0;
+
+	run = kmalloc_array(1 << shift, sizeof(*run), GFP_KERNEL);
+	if (run == NULL)
+		return -ENOMEM;
+
+	while (!list_empty(pages)) {
+		struct page *page = list_entry(pages->prev, struct page, lru);
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index,
+					readahead_gfp_mask(mapping))) {
+			put_page(page);
+			continue;
+		}
+
+		/* A run ends at a block boundary or at a hole in the window */
+		if (n && (page->index != run[n - 1]->index + 1 ||
+				(page->index >> shift) != (run[0]->index >> shift))) {
+			squashfs_readahead_run(file, run, n);
+			n = 0;
+		}
+		run[n++] = page;
+	}
+
+	if (n)
+		squashfs_readahead_run(file, run, n);
+
+	kfree(run);
+	return 0;
+}
+#endif
+
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+#ifdef CONFIG_SQUASHFS_FILE_DIRECT
+	.readpages = squashfs_readpages,
+#endif
+};
+
+
+/*
+ * SEEK_DATA and SEEK_HOLE, at block granularity. A block is a hole if
+ * its block list entry says it is sparse; the fragment holding the tail
+ * of the file is always data.
+ */
+static loff_t squashfs_llseek(struct file *file, loff_t offset, int whence)
+{
+	struct inode *inode = file->f_mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	loff_t size = i_size_read(inode);
+	int blocks = size >> msblk->block_log, index, bsize;
+	u64 block;
+
+	if (whence != SEEK_DATA && whence != SEEK_HOLE)
+		return generic_file_llseek(file, offset, whence);
+
+	if (offset < 0 || offset >= size)
+		return -ENXIO;
+
+	/* Without a fragment, a partial last block is in the block list */
+	if (squashfs_i(inode)->fragment_block == SQUASHFS_INVALID_BLK)
+		blocks = (size + msblk->block_size - 1) >> msblk->block_log;
+
+	for (index = offset >> msblk->block_log; index < blocks; index++) {
+		block = 0;
+		bsize = read_blocklist(inode, index, &block);
+		if (bsize < 0)
+			return bsize;
+
+		if ((bsize == 0) == (whence == SEEK_HOLE))
+			goto found;
+	}
+
+	if (whence == SEEK_HOLE)
+		/* There is an implicit hole at the end of the file */
+		return vfs_setpos(file, size, inode->i_sb->s_maxbytes);
+
+	/* Data can only be left in the tail fragment, past the blocks */
+	if (squashfs_i(inode)->fragment_block == SQUASHFS_INVALID_BLK)
+		return -ENXIO;
+	index = blocks;
+
+found:
+	offset = max_t(loff_t, offset, (loff_t) index << msblk->block_log);
+	return vfs_setpos(file, offset, inode->i_sb->s_maxbytes);
+}
+
+/* Reads go through generic_file_read_iter(), which honours IOCB_NOWAIT */
+static int squashfs_file_open(struct inode *inode, struct file *file)
+{
+	file->f_mode |= FMODE_NOWAIT;
+	return 0;
+}
+
+const struct file_operations squashfs_file_ops = {
+	.open		= squashfs_file_open,
+	.llseek		= squashfs_llseek,
+	.read_iter	= generic_file_read_iter,
+	.mmap		= generic_file_readonly_mmap,
+	.splice_read	= generic_file_splice_read,
 };
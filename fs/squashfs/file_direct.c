@@ -13,6 +13,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -174,3 +175,187 @@ out:
 	squashfs_cache_put(buffer);
 	return res;
 }
+
+
+/*
+ * Read the tail-end of a file, packed at <offset> in the fragment at <block>,
+ * by decompressing the fragment directly into the page cache.
+ */
+int squashfs_readpage_tail(struct page *target_page, u64 block, int bsize,
+	int offset, int bytes)
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+
+	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int pages = DIV_ROUND_UP(bytes, PAGE_SIZE);
+	int i, n, tail, res = -ENOMEM;
+	struct page **page;
+	struct squashfs_page_actor *actor;
+	void *pageaddr;
+
+	page = kcalloc(pages, sizeof(void *), GFP_KERNEL);
+	if (page == NULL)
+		return res;
+
+	/*
+	 * Grab the pages of the tail-end, those that can't be grabbed or are
+	 * already uptodate are skipped by the page actor.
+	 */
+	for (i = 0, n = start_index; i < pages; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+
+		if (page[i] && page[i] != target_page &&
+						PageUptodate(page[i])) {
+			unlock_page(page[i]);
+			put_page(page[i]);
+			page[i] = NULL;
+		}
+	}
+
+	actor = squashfs_page_actor_init_window(page, msblk->block_size, offset,
+		bytes);
+	if (actor == NULL)
+		goto mark_errored;
+
+	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+	squashfs_page_actor_free(actor);
+	if (res >= 0 && res < offset + bytes)
+		res = -EIO;
+	if (res < 0)
+		goto mark_errored;
+
+	/* Last page has trailing bytes from the next tail-end, or none */
+	tail = bytes % PAGE_SIZE;
+	if (tail && page[pages - 1]) {
+		pageaddr = kmap_atomic(page[pages - 1]);
+		memset(pageaddr + tail, 0, PAGE_SIZE - tail);
+		kunmap_atomic(pageaddr);
+	}
+
+	/* Mark pages as uptodate, unlock and release */
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL)
+			continue;
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		if (page[i] != target_page)
+			put_page(page[i]);
+	}
+
+	kfree(page);
+	return 0;
+
+mark_errored:
+	/* Target_page is dealt with by the caller */
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL || page[i] == target_page)
+			continue;
+		flush_dcache_page(page[i]);
+		SetPageError(page[i]);
+		unlock_page(page[i]);
+		put_page(page[i]);
+	}
+
+	kfree(page);
+	return res;
+}
+
+
+/*
+ * A datablock being read by readahead.  Once the datablock has been
+ * submitted the rest is done on the unbound workqueue, so that several
+ * datablocks can be decompressed at the same time on SMP, each using its
+ * own decompressor with SQUASHFS_DECOMP_MULTI_PERCPU.
+ */
+struct squashfs_readahead {
+	struct work_struct		work;
+	struct super_block		*sb;
+	struct squashfs_read_req	req;
+	struct page			**page;
+	int				pages;
+};
+
+
+static void squashfs_readahead_work(struct work_struct *work)
+{
+	struct squashfs_readahead *ra = container_of(work,
+		struct squashfs_readahead, work);
+	int i, bytes, res;
+	void *pageaddr;
+
+	res = squashfs_read_data_end(ra->sb, &ra->req);
+
+	/* Last page may have trailing bytes not filled */
+	bytes = res % PAGE_SIZE;
+	if (res > 0 && bytes) {
+		pageaddr = kmap_atomic(ra->page[ra->pages - 1]);
+		memset(pageaddr + bytes, 0, PAGE_SIZE - bytes);
+		kunmap_atomic(pageaddr);
+	}
+
+	/*
+	 * Mark pages as uptodate or errored, unlock and release.  An errored
+	 * page is read again by squashfs_readpage() when it is accessed.
+	 */
+	for (i = 0; i < ra->pages; i++) {
+		flush_dcache_page(ra->page[i]);
+		if (res < 0)
+			SetPageError(ra->page[i]);
+		else
+			SetPageUptodate(ra->page[i]);
+		unlock_page(ra->page[i]);
+		put_page(ra->page[i]);
+	}
+
+	kfree(ra->req.output);
+	kfree(ra->page);
+	kfree(ra);
+}
+
+
+/*
+ * Start readahead of a datablock into the locked page cache pages covering
+ * it.  Returns 0 if the datablock is being read, in which case the pages
+ * are unlocked and released when it has been decompressed.
+ */
+int squashfs_readahead_block(struct inode *inode, u64 block, int bsize,
+	struct page **page, int pages)
+{
+	struct squashfs_readahead *ra;
+	int res = -ENOMEM;
+
+	ra = kmalloc(sizeof(*ra), GFP_KERNEL);
+	if (ra == NULL)
+		return res;
+
+	ra->page = kmemdup(page, pages * sizeof(*page), GFP_KERNEL);
+	if (ra->page == NULL)
+		goto free_ra;
+
+	ra->req.output = squashfs_page_actor_init_special(ra->page, pages, 0);
+	if (ra->req.output == NULL)
+		goto free_page;
+
+	res = squashfs_read_data_start(inode->i_sb, block, bsize, &ra->req);
+	if (res)
+		goto free_actor;
+
+	ra->sb = inode->i_sb;
+	ra->pages = pages;
+	INIT_WORK(&ra->work, squashfs_readahead_work);
+	queue_work(system_unbound_wq, &ra->work);
+
+	return 0;
+
+free_actor:
+	kfree(ra->req.output);
+free_page:
+	kfree(ra->page);
+free_ra:
+	kfree(ra);
+	return res;
+}
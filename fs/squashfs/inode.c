@@ -166,7 +166,7 @@ int squashfs_read_inode(struct inode *inode, long long ino)
 
 		set_nlink(inode, 1);
 		inode->i_size = le32_to_cpu(sqsh_ino->file_size);
-		inode->i_fop = &generic_ro_fops;
+		inode->i_fop = &squashfs_file_ops;
 		inode->i_mode |= S_IFREG;
 		inode->i_blocks = ((inode->i_size - 1) >> 9) + 1;
 		squashfs_i(inode)->fragment_block = frag_blk;
@@ -211,7 +211,7 @@ int squashfs_read_inode(struct inode *inode, long long ino)
 		set_nlink(inode, le32_to_cpu(sqsh_ino->nlink));
 		inode->i_size = le64_to_cpu(sqsh_ino->file_size);
 		inode->i_op = &squashfs_inode_ops;
-		inode->i_fop = &generic_ro_fops;
+		inode->i_fop = &squashfs_file_ops;
 		inode->i_mode |= S_IFREG;
 		inode->i_blocks = (inode->i_size -
 				le64_to_cpu(sqsh_ino->sparse) + 511) >> 9;
@@ -246,6 +246,7 @@ int squashfs_read_inode(struct inode *inode, long long ino)
 		squashfs_i(inode)->offset = le16_to_cpu(sqsh_ino->offset);
 		squashfs_i(inode)->dir_idx_cnt = 0;
 		squashfs_i(inode)->parent = le32_to_cpu(sqsh_ino->parent_inode);
+		RCU_INIT_POINTER(squashfs_i(inode)->dir_hash, NULL);
 
 		TRACE("Directory inode %x:%x, start_block %llx, offset %x\n",
 				SQUASHFS_INODE_BLK(ino), offset,
@@ -273,6 +274,7 @@ int squashfs_read_inode(struct inode *inode, long long ino)
 		squashfs_i(inode)->dir_idx_offset = offset;
 		squashfs_i(inode)->dir_idx_cnt = le16_to_cpu(sqsh_ino->i_count);
 		squashfs_i(inode)->parent = le32_to_cpu(sqsh_ino->parent_inode);
+		RCU_INIT_POINTER(squashfs_i(inode)->dir_hash, NULL);
 
 		TRACE("Long directory inode %x:%x, start_block %llx, offset "
 				"%x\n", SQUASHFS_INODE_BLK(ino), offset,
@@ -148,7 +148,8 @@ static struct dentry *squashfs_lookup(struct inode *dir, struct dentry *dentry,
 	u64 block = squashfs_i(dir)->start + msblk->directory_table;
 	int offset = squashfs_i(dir)->offset;
 	int err, length;
-	unsigned int dir_count, size;
+	unsigned int dir_count, size, ino_num;
+	long long ino;
 
 	TRACE("Entered squashfs_lookup [%llx:%x]\n", block, offset);
 
@@ -163,6 +164,13 @@ static struct dentry *squashfs_lookup(struct inode *dir, struct dentry *dentry,
 		goto failed;
 	}
 
+	err = squashfs_dir_hash_lookup(dir, name, len, &ino, &ino_num);
+	if (err != -EAGAIN) {
+		if (err == 0)
+			inode = squashfs_iget(dir->i_sb, ino, ino_num);
+		goto exit_lookup;
+	}
+
 	length = get_dir_index_using_name(dir->i_sb, &block, &offset,
 				squashfs_i(dir)->dir_idx_start,
 				squashfs_i(dir)->dir_idx_offset,
@@ -210,8 +218,8 @@ static struct dentry *squashfs_lookup(struct inode *dir, struct dentry *dentry,
 				goto exit_lookup;
 
 			if (len == size && !strncmp(name, dire->name, len)) {
-				unsigned int blk, off, ino_num;
-				long long ino;
+				unsigned int blk, off;
+
 				blk = le32_to_cpu(dirh.start_block);
 				off = le16_to_cpu(dire->offset);
 				ino_num = le32_to_cpu(dirh.inode_number) +
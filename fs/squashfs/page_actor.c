@@ -13,8 +13,8 @@
 
 /*
  * This file contains implementations of page_actor for decompressing into
- * an intermediate buffer, and for decompressing directly into the
- * page cache.
+ * an intermediate buffer, for decompressing directly into the page cache,
+ * and for decompressing a part of a block into the page cache.
  *
  * Calling code should avoid sleeping between calls to squashfs_first_page()
  * and squashfs_finish_page().
@@ -50,6 +50,7 @@ struct squashfs_page_actor *squashfs_page_actor_init(void **buffer,
 
 	actor->length = length ? : pages * PAGE_SIZE;
 	actor->buffer = buffer;
+	actor->scratch = NULL;
 	actor->pages = pages;
 	actor->next_page = 0;
 	actor->squashfs_first_page = cache_first_page;
@@ -90,6 +91,7 @@ struct squashfs_page_actor *squashfs_page_actor_init_special(struct page **page,
 
 	actor->length = length ? : pages * PAGE_SIZE;
 	actor->page = page;
+	actor->scratch = NULL;
 	actor->pages = pages;
 	actor->next_page = 0;
 	actor->pageaddr = NULL;
@@ -98,3 +100,118 @@ struct squashfs_page_actor *squashfs_page_actor_init_special(struct page **page,
 	actor->squashfs_finish_page = direct_finish_page;
 	return actor;
 }
+
+/*
+ * Implementation of page_actor for decompressing the window [offset,
+ * offset + window) of a block into the page cache, used for tail-ends
+ * packed in fragments.  The rest of the block is decompressed into a
+ * scratch page and dropped, without going through the fragment cache.
+ * Output pages lining up with a page cache page are decompressed directly
+ * into it, which is the case for all of them if offset is page aligned.
+ * The others are decompressed into the scratch page and the part inside
+ * the window copied out while it is still hot.
+ */
+static void *window_map(struct squashfs_page_actor *actor)
+{
+	int pos = actor->next_page++ * PAGE_SIZE - actor->offset;
+
+	if (pos >= 0 && pos < actor->window && !(pos & (PAGE_SIZE - 1)) &&
+			actor->page[pos >> PAGE_SHIFT])
+		return actor->pageaddr = kmap_atomic(actor->page[pos >>
+								PAGE_SHIFT]);
+
+	actor->pageaddr = NULL;
+	return actor->scratch;
+}
+
+static void window_unmap(struct squashfs_page_actor *actor)
+{
+	int pos = (actor->next_page - 1) * PAGE_SIZE - actor->offset;
+	int start = max(pos, 0);
+	int end = min_t(int, pos + PAGE_SIZE, actor->window);
+
+	if (actor->pageaddr) {
+		kunmap_atomic(actor->pageaddr);
+		return;
+	}
+
+	/* Copy the part of the scratch page inside the window */
+	while (start < end) {
+		struct page *page = actor->page[start >> PAGE_SHIFT];
+		int in_page = start & (PAGE_SIZE - 1);
+		int avail = min_t(int, end - start, PAGE_SIZE - in_page);
+
+		if (page) {
+			void *pageaddr = kmap_atomic(page);
+
+			memcpy(pageaddr + in_page, actor->scratch + start - pos,
+				avail);
+			kunmap_atomic(pageaddr);
+		}
+		start += avail;
+	}
+}
+
+static void *window_first_page(struct squashfs_page_actor *actor)
+{
+	actor->next_page = 0;
+	return window_map(actor);
+}
+
+static void *window_next_page(struct squashfs_page_actor *actor)
+{
+	/* Past the end next_page is pages + 1, the last page is unmapped */
+	if (actor->next_page > actor->pages)
+		return NULL;
+
+	window_unmap(actor);
+	if (actor->next_page == actor->pages) {
+		actor->next_page++;
+		return NULL;
+	}
+
+	return window_map(actor);
+}
+
+static void window_finish_page(struct squashfs_page_actor *actor)
+{
+	if (actor->next_page <= actor->pages)
+		window_unmap(actor);
+}
+
+/*
+ * page[] holds the page cache pages of the window, a missing page can be
+ * NULL.  The block decompresses to length bytes.
+ */
+struct squashfs_page_actor *squashfs_page_actor_init_window(struct page **page,
+	int length, int offset, int window)
+{
+	struct squashfs_page_actor *actor = kmalloc(sizeof(*actor), GFP_KERNEL);
+
+	if (actor == NULL)
+		return NULL;
+
+	actor->scratch = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (actor->scratch == NULL) {
+		kfree(actor);
+		return NULL;
+	}
+
+	actor->length = length;
+	actor->page = page;
+	actor->pages = DIV_ROUND_UP(length, PAGE_SIZE);
+	actor->next_page = 0;
+	actor->pageaddr = NULL;
+	actor->offset = offset;
+	actor->window = window;
+	actor->squashfs_first_page = window_first_page;
+	actor->squashfs_next_page = window_next_page;
+	actor->squashfs_finish_page = window_finish_page;
+	return actor;
+}
+
+void squashfs_page_actor_free(struct squashfs_page_actor *actor)
+{
+	kfree(actor->scratch);
+	kfree(actor);
+}
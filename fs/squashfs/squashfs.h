@@ -28,15 +28,30 @@
 #define WARNING(s, args...)	pr_warn("SQUASHFS: "s, ## args)
 
 /* block.c */
+struct squashfs_read_req {
+	struct squashfs_page_actor	*output;
+	struct buffer_head		**bh;
+	u64				index;
+	int				b;
+	int				offset;
+	int				length;
+	int				compressed;
+};
+
 extern int squashfs_read_data(struct super_block *, u64, int, u64 *,
 				struct squashfs_page_actor *);
+extern int squashfs_read_data_start(struct super_block *, u64, int,
+				struct squashfs_read_req *);
+extern int squashfs_read_data_end(struct super_block *,
+				struct squashfs_read_req *);
 
 /* cache.c */
-extern struct squashfs_cache *squashfs_cache_init(char *, int, int);
+extern struct squashfs_cache *squashfs_cache_init(char *, int, int, int);
 extern void squashfs_cache_delete(struct squashfs_cache *);
 extern struct squashfs_cache_entry *squashfs_cache_get(struct super_block *,
 				struct squashfs_cache *, u64, int);
 extern void squashfs_cache_put(struct squashfs_cache_entry *);
+extern bool squashfs_cache_cached(struct squashfs_cache *, u64);
 extern int squashfs_copy_data(void *, struct squashfs_cache_entry *, int, int);
 extern int squashfs_read_metadata(struct super_block *, void *, u64 *,
 				int *, int);
@@ -73,11 +88,23 @@ void squashfs_copy_cache(struct page *, struct squashfs_cache_entry *, int,
 /* file_xxx.c */
 extern int squashfs_readpage_block(struct page *, u64, int);
 
+/* file_direct.c */
+extern int squashfs_readahead_block(struct inode *, u64, int, struct page **,
+				int);
+extern int squashfs_readpage_tail(struct page *, u64, int, int, int);
+
 /* id.c */
 extern int squashfs_get_id(struct super_block *, unsigned int, unsigned int *);
 extern __le64 *squashfs_read_id_index_table(struct super_block *, u64, u64,
 				unsigned short);
 
+/* dir_hash.c */
+extern int squashfs_dir_hash_lookup(struct inode *, const char *, int,
+				long long *, unsigned int *);
+extern void squashfs_dir_hash_evict(struct inode *);
+extern int squashfs_dir_hash_init(void);
+extern void squashfs_dir_hash_exit(void);
+
 /* inode.c */
 extern struct inode *squashfs_iget(struct super_block *, long long,
 				unsigned int);
@@ -98,6 +125,7 @@ extern const struct export_operations squashfs_export_ops;
 
 /* file.c */
 extern const struct address_space_operations squashfs_aops;
+extern const struct file_operations squashfs_file_ops;
 
 /* inode.c */
 extern const struct inode_operations squashfs_inode_ops;
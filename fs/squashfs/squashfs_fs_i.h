@@ -41,6 +41,7 @@ struct squashfs_inode_info {
 			int		dir_idx_offset;
 			int		dir_idx_cnt;
 			int		parent;
+			struct squashfs_dir_hash __rcu *dir_hash;
 		};
 	};
 	struct inode	vfs_inode;
@@ -28,6 +28,9 @@
 struct squashfs_cache {
 	char			*name;
 	int			entries;
+	int			min_entries;
+	int			max_entries;
+	int			growing;
 	int			curr_blk;
 	int			next_blk;
 	int			num_waiters;
@@ -37,6 +40,7 @@ struct squashfs_cache {
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache_entry *entry;
+	struct shrinker		shrinker;
 };
 
 struct squashfs_cache_entry {
@@ -60,6 +64,7 @@ struct squashfs_sb_info {
 	struct squashfs_cache			*block_cache;
 	struct squashfs_cache			*fragment_cache;
 	struct squashfs_cache			*read_page;
+	u64					fragment_hint;
 	int					next_meta_index;
 	__le64					*id_table;
 	__le64					*fragment_index;
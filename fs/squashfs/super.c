@@ -34,6 +34,8 @@
 #include <linux/slab.h>
 #include <linux/mutex.h>
 #include <linux/pagemap.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
 #include <linux/init.h>
 #include <linux/module.h>
 #include <linux/magic.h>
@@ -49,6 +51,80 @@
 static struct file_system_type squashfs_fs_type;
 static const struct super_operations squashfs_super_ops;
 
+/*
+ * The fragment and data caches hold at least fragment_cache and read_cache
+ * entries, and grow up to fragment_cache_max and read_cache_max entries
+ * while memory is free.
+ */
+struct squashfs_mount_opts {
+	int	fragment_cache;
+	int	fragment_cache_max;
+	int	read_cache;
+	int	read_cache_max;
+};
+
+enum {
+	Opt_fragment_cache, Opt_fragment_cache_max, Opt_read_cache,
+	Opt_read_cache_max, Opt_err
+};
+
+static const match_table_t squashfs_tokens = {
+	{Opt_fragment_cache, "fragment_cache=%u"},
+	{Opt_fragment_cache_max, "fragment_cache_max=%u"},
+	{Opt_read_cache, "read_cache=%u"},
+	{Opt_read_cache_max, "read_cache_max=%u"},
+	{Opt_err, NULL}
+};
+
+static int squashfs_parse_options(char *options,
+	struct squashfs_mount_opts *opts)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+	int token, option;
+
+	opts->fragment_cache = SQUASHFS_CACHED_FRAGMENTS;
+	opts->fragment_cache_max = 0;
+	opts->read_cache = squashfs_max_decompressors();
+	opts->read_cache_max = 0;
+
+	if (!options)
+		return 0;
+
+	while ((p = strsep(&options, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		token = match_token(p, squashfs_tokens, args);
+		if (token == Opt_err) {
+			ERROR("Unrecognized mount option \"%s\"\n", p);
+			return -EINVAL;
+		}
+
+		if (match_int(&args[0], &option) || option < 1) {
+			ERROR("Invalid value for mount option \"%s\"\n", p);
+			return -EINVAL;
+		}
+
+		switch (token) {
+		case Opt_fragment_cache:
+			opts->fragment_cache = option;
+			break;
+		case Opt_fragment_cache_max:
+			opts->fragment_cache_max = option;
+			break;
+		case Opt_read_cache:
+			opts->read_cache = option;
+			break;
+		case Opt_read_cache_max:
+			opts->read_cache_max = option;
+			break;
+		}
+	}
+
+	return 0;
+}
+
 static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 	major, short minor, short id)
 {
@@ -80,6 +156,7 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 {
 	struct squashfs_sb_info *msblk;
 	struct squashfs_super_block *sblk = NULL;
+	struct squashfs_mount_opts opts;
 	struct inode *root;
 	long long root_inode;
 	unsigned short flags;
@@ -89,6 +166,10 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 
 	TRACE("Entered squashfs_fill_superblock\n");
 
+	err = squashfs_parse_options(data, &opts);
+	if (err)
+		return err;
+
 	sb->s_fs_info = kzalloc(sizeof(*msblk), GFP_KERNEL);
 	if (sb->s_fs_info == NULL) {
 		ERROR("Failed to allocate squashfs_sb_info\n");
@@ -201,13 +282,13 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			SQUASHFS_CACHED_BLKS, 0, SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
 	/* Allocate read_page block */
-	msblk->read_page = squashfs_cache_init("data",
-		squashfs_max_decompressors(), msblk->block_size);
+	msblk->read_page = squashfs_cache_init("data", opts.read_cache,
+		opts.read_cache_max, msblk->block_size);
 	if (msblk->read_page == NULL) {
 		ERROR("Failed to allocate read_page block\n");
 		goto failed_mount;
@@ -277,7 +358,8 @@ handle_fragments:
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		opts.fragment_cache, opts.fragment_cache_max,
+		msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -378,6 +460,32 @@ static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 }
 
 
+static void squashfs_show_cache(struct seq_file *seq, char *option,
+	struct squashfs_cache *cache, int entries)
+{
+	if (cache == NULL)
+		return;
+
+	if (cache->min_entries != entries)
+		seq_printf(seq, ",%s=%d", option, cache->min_entries);
+	if (cache->max_entries != cache->min_entries)
+		seq_printf(seq, ",%s_max=%d", option, cache->max_entries);
+}
+
+
+static int squashfs_show_options(struct seq_file *seq, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	squashfs_show_cache(seq, "fragment_cache", msblk->fragment_cache,
+		SQUASHFS_CACHED_FRAGMENTS);
+	squashfs_show_cache(seq, "read_cache", msblk->read_page,
+		squashfs_max_decompressors());
+
+	return 0;
+}
+
+
 static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
@@ -444,8 +552,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_dir_hash_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_dir_hash_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -459,6 +574,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_dir_hash_exit();
 	destroy_inodecache();
 }
 
@@ -480,6 +596,7 @@ static void squashfs_i_callback(struct rcu_head *head)
 
 static void squashfs_destroy_inode(struct inode *inode)
 {
+	squashfs_dir_hash_evict(inode);
 	call_rcu(&inode->i_rcu, squashfs_i_callback);
 }
 
@@ -498,7 +615,8 @@ static const struct super_operations squashfs_super_ops = {
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
-	.remount_fs = squashfs_remount
+	.remount_fs = squashfs_remount,
+	.show_options = squashfs_show_options
 };
 
 module_init(init_squashfs_fs);
@@ -29,6 +29,7 @@
 #include <linux/ioctl.h>
 #include <linux/security.h>
 #include <linux/hugetlb.h>
+#include <linux/radix-tree.h>
 
 static struct kmem_cache *userfaultfd_ctx_cachep __read_mostly;
 
@@ -64,6 +65,10 @@ struct userfaultfd_ctx {
 	bool released;
 	/* mm with one ore more vmas attached to this userfaultfd_ctx */
 	struct mm_struct *mm;
+	/* protects wp_pages */
+	spinlock_t wp_lock;
+	/* bitmaps of the write protected pages */
+	struct radix_tree_root wp_pages;
 };
 
 struct userfaultfd_fork_ctx {
@@ -145,6 +150,139 @@ static void userfaultfd_ctx_get(struct userfaultfd_ctx *ctx)
 		BUG();
 }
 
+/*
+ * There is no spare pte bit to mark the pages write protected by
+ * UFFDIO_WRITEPROTECT, so they are recorded per context instead: one bit
+ * per page, in page sized bitmaps indexed by virtual address. A bitmap
+ * covers 128MB with 4K pages, so a tracked range needs one or two.
+ */
+#define UFFD_WP_CHUNK_PAGES	(PAGE_SIZE * BITS_PER_BYTE)
+
+static unsigned long *userfaultfd_wp_chunk(struct userfaultfd_ctx *ctx,
+					   unsigned long address,
+					   unsigned long *bit)
+{
+	unsigned long pgnr = address >> PAGE_SHIFT;
+
+	*bit = pgnr % UFFD_WP_CHUNK_PAGES;
+	return radix_tree_lookup(&ctx->wp_pages, pgnr / UFFD_WP_CHUNK_PAGES);
+}
+
+static bool __userfaultfd_wp_protected(struct userfaultfd_ctx *ctx,
+				       unsigned long address)
+{
+	unsigned long *chunk, bit;
+	bool ret;
+
+	spin_lock(&ctx->wp_lock);
+	chunk = userfaultfd_wp_chunk(ctx, address, &bit);
+	ret = chunk && test_bit(bit, chunk);
+	spin_unlock(&ctx->wp_lock);
+
+	return ret;
+}
+
+/*
+ * Whether the page at @address is write protected. Called with the pte
+ * lock held, so wp_lock nests inside it.
+ */
+bool userfaultfd_wp_protected(struct vm_area_struct *vma,
+			      unsigned long address)
+{
+	if (!userfaultfd_wp(vma))
+		return false;
+
+	return __userfaultfd_wp_protected(vma->vm_userfaultfd_ctx.ctx, address);
+}
+
+/* Allocate the bitmaps for [start, end), before marking pages in it */
+int userfaultfd_wp_prepare(struct vm_area_struct *vma, unsigned long start,
+			   unsigned long end)
+{
+	struct userfaultfd_ctx *ctx = vma->vm_userfaultfd_ctx.ctx;
+	unsigned long index, last;
+	void *chunk;
+	int ret;
+
+	index = (start >> PAGE_SHIFT) / UFFD_WP_CHUNK_PAGES;
+	last = ((end - 1) >> PAGE_SHIFT) / UFFD_WP_CHUNK_PAGES;
+	for (; index <= last; index++) {
+		spin_lock(&ctx->wp_lock);
+		chunk = radix_tree_lookup(&ctx->wp_pages, index);
+		spin_unlock(&ctx->wp_lock);
+		if (chunk)
+			continue;
+
+		chunk = (void *)get_zeroed_page(GFP_KERNEL);
+		if (!chunk)
+			return -ENOMEM;
+		ret = radix_tree_preload(GFP_KERNEL);
+		if (ret) {
+			free_page((unsigned long)chunk);
+			return ret;
+		}
+
+		spin_lock(&ctx->wp_lock);
+		ret = radix_tree_insert(&ctx->wp_pages, index, chunk);
+		spin_unlock(&ctx->wp_lock);
+		radix_tree_preload_end();
+
+		/* A concurrent UFFDIO_WRITEPROTECT got there first */
+		if (ret)
+			free_page((unsigned long)chunk);
+		if (ret && ret != -EEXIST)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Mark the page at @address, userfaultfd_wp_prepare() must cover it */
+void userfaultfd_wp_set(struct vm_area_struct *vma, unsigned long address)
+{
+	struct userfaultfd_ctx *ctx = vma->vm_userfaultfd_ctx.ctx;
+	unsigned long *chunk, bit;
+
+	spin_lock(&ctx->wp_lock);
+	chunk = userfaultfd_wp_chunk(ctx, address, &bit);
+	if (!WARN_ON_ONCE(!chunk))
+		set_bit(bit, chunk);
+	spin_unlock(&ctx->wp_lock);
+}
+
+static void __userfaultfd_wp_clear(struct userfaultfd_ctx *ctx,
+				   unsigned long start, unsigned long end)
+{
+	unsigned long *chunk, bit, nr;
+
+	spin_lock(&ctx->wp_lock);
+	while (start < end) {
+		chunk = userfaultfd_wp_chunk(ctx, start, &bit);
+		nr = min((end - start) >> PAGE_SHIFT, UFFD_WP_CHUNK_PAGES - bit);
+		if (chunk)
+			bitmap_clear(chunk, bit, nr);
+		start += nr << PAGE_SHIFT;
+	}
+	spin_unlock(&ctx->wp_lock);
+}
+
+void userfaultfd_wp_clear(struct vm_area_struct *vma, unsigned long start,
+			  unsigned long end)
+{
+	__userfaultfd_wp_clear(vma->vm_userfaultfd_ctx.ctx, start, end);
+}
+
+static void userfaultfd_wp_free(struct userfaultfd_ctx *ctx)
+{
+	struct radix_tree_iter iter;
+	void **slot;
+
+	radix_tree_for_each_slot(slot, &ctx->wp_pages, &iter, 0) {
+		free_page((unsigned long)*slot);
+		radix_tree_iter_delete(&ctx->wp_pages, &iter, slot);
+	}
+}
+
 /**
  * userfaultfd_ctx_put - Releases a reference to the internal userfaultfd
  * context.
@@ -164,6 +302,7 @@ static void userfaultfd_ctx_put(struct userfaultfd_ctx *ctx)
 		VM_BUG_ON(waitqueue_active(&ctx->event_wqh));
 		VM_BUG_ON(spin_is_locked(&ctx->fd_wqh.lock));
 		VM_BUG_ON(waitqueue_active(&ctx->fd_wqh));
+		userfaultfd_wp_free(ctx);
 		mmdrop(ctx->mm);
 		kmem_cache_free(userfaultfd_ctx_cachep, ctx);
 	}
@@ -310,6 +449,9 @@ static inline bool userfaultfd_must_wait(struct userfaultfd_ctx *ctx,
 	 */
 	if (pte_none(*pte))
 		ret = true;
+	if (!pte_write(*pte) && (reason & VM_UFFD_WP) &&
+	    __userfaultfd_wp_protected(ctx, address))
+		ret = true;
 	pte_unmap(pte);
 
 out:
@@ -718,6 +860,9 @@ bool userfaultfd_remove(struct vm_area_struct *vma,
 	struct userfaultfd_wait_queue ewq;
 
 	ctx = vma->vm_userfaultfd_ctx.ctx;
+	/* Pages faulted in again start out unprotected */
+	if (ctx && userfaultfd_wp(vma))
+		__userfaultfd_wp_clear(ctx, start, end);
 	if (!ctx || !(ctx->features & UFFD_FEATURE_EVENT_REMOVE))
 		return true;
 
@@ -756,6 +901,10 @@ int userfaultfd_unmap_prep(struct vm_area_struct *vma,
 		struct userfaultfd_unmap_ctx *unmap_ctx;
 		struct userfaultfd_ctx *ctx = vma->vm_userfaultfd_ctx.ctx;
 
+		if (ctx && userfaultfd_wp(vma))
+			__userfaultfd_wp_clear(ctx, max(start, vma->vm_start),
+					       min(end, vma->vm_end));
+
 		if (!ctx || !(ctx->features & UFFD_FEATURE_EVENT_UNMAP) ||
 		    has_unmap_ctx(ctx, unmaps, start, end))
 			continue;
@@ -1215,15 +1364,8 @@ static int userfaultfd_register(struct userfaultfd_ctx *ctx,
 	vm_flags = 0;
 	if (uffdio_register.mode & UFFDIO_REGISTER_MODE_MISSING)
 		vm_flags |= VM_UFFD_MISSING;
-	if (uffdio_register.mode & UFFDIO_REGISTER_MODE_WP) {
+	if (uffdio_register.mode & UFFDIO_REGISTER_MODE_WP)
 		vm_flags |= VM_UFFD_WP;
-		/*
-		 * FIXME: remove the below error constraint by
-		 * implementing the wprotect tracking mode.
-		 */
-		ret = -EINVAL;
-		goto out;
-	}
 
 	ret = validate_range(mm, uffdio_register.range.start,
 			     uffdio_register.range.len);
@@ -1273,6 +1415,12 @@ static int userfaultfd_register(struct userfaultfd_ctx *ctx,
 		ret = -EINVAL;
 		if (!vma_can_userfault(cur))
 			goto out_unlock;
+		/*
+		 * wprotect tracking relies on private anonymous memory
+		 * being mapped readonly until do_wp_page() runs.
+		 */
+		if ((vm_flags & VM_UFFD_WP) && !vma_is_anonymous(cur))
+			goto out_unlock;
 		/*
 		 * If this vma contains ending address, and huge pages
 		 * check alignment.
@@ -1358,6 +1506,9 @@ static int userfaultfd_register(struct userfaultfd_ctx *ctx,
 		 */
 		vma->vm_flags = new_flags;
 		vma->vm_userfaultfd_ctx.ctx = ctx;
+		/* Drop marks left behind by an earlier mapping */
+		if (vm_flags & VM_UFFD_WP)
+			__userfaultfd_wp_clear(ctx, start, vma_end);
 
 	skip:
 		prev = vma;
@@ -1368,14 +1519,18 @@ out_unlock:
 	up_write(&mm->mmap_sem);
 	mmput(mm);
 	if (!ret) {
+		__u64 ioctls = non_anon_pages ? UFFD_API_RANGE_IOCTLS_BASIC :
+			       UFFD_API_RANGE_IOCTLS;
+
+		if (vm_flags & VM_UFFD_WP)
+			ioctls |= (__u64)1 << _UFFDIO_WRITEPROTECT;
+
 		/*
 		 * Now that we scanned all vmas we can already tell
 		 * userland which ioctls methods are guaranteed to
 		 * succeed on this range.
 		 */
-		if (put_user(non_anon_pages ? UFFD_API_RANGE_IOCTLS_BASIC :
-			     UFFD_API_RANGE_IOCTLS,
-			     &user_uffdio_register->ioctls))
+		if (put_user(ioctls, &user_uffdio_register->ioctls))
 			ret = -EFAULT;
 	}
 out:
@@ -1476,7 +1631,11 @@ static int userfaultfd_unregister(struct userfaultfd_ctx *ctx,
 			start = vma->vm_start;
 		vma_end = min(end, vma->vm_end);
 
-		if (userfaultfd_missing(vma)) {
+		if (userfaultfd_wp(vma))
+			__userfaultfd_wp_clear(vma->vm_userfaultfd_ctx.ctx,
+					       start, vma_end);
+
+		if (userfaultfd_armed(vma)) {
 			/*
 			 * Wake any concurrent pending userfault while
 			 * we unregister, so they will not hang
@@ -1662,6 +1821,56 @@ out:
 	return ret;
 }
 
+static int userfaultfd_writeprotect(struct userfaultfd_ctx *ctx,
+				    unsigned long arg)
+{
+	int ret;
+	struct uffdio_writeprotect uffdio_wp;
+	struct uffdio_writeprotect __user *user_uffdio_wp;
+	struct userfaultfd_wake_range range;
+
+	user_uffdio_wp = (struct uffdio_writeprotect __user *) arg;
+
+	ret = -EFAULT;
+	if (copy_from_user(&uffdio_wp, user_uffdio_wp, sizeof(uffdio_wp)))
+		goto out;
+
+	ret = validate_range(ctx->mm, uffdio_wp.range.start,
+			     uffdio_wp.range.len);
+	if (ret)
+		goto out;
+	ret = -EINVAL;
+	if (uffdio_wp.mode & ~(UFFDIO_WRITEPROTECT_MODE_WP |
+			       UFFDIO_WRITEPROTECT_MODE_DONTWAKE))
+		goto out;
+	/* protecting does not resolve anything, there is nothing to wake */
+	if ((uffdio_wp.mode & UFFDIO_WRITEPROTECT_MODE_WP) &&
+	    (uffdio_wp.mode & UFFDIO_WRITEPROTECT_MODE_DONTWAKE))
+		goto out;
+
+	if (!mmget_not_zero(ctx->mm))
+		return -ENOSPC;
+	ret = mwriteprotect_range(ctx->mm, uffdio_wp.range.start,
+				  uffdio_wp.range.len,
+				  uffdio_wp.mode & UFFDIO_WRITEPROTECT_MODE_WP);
+	mmput(ctx->mm);
+	if (ret || (uffdio_wp.mode & UFFDIO_WRITEPROTECT_MODE_WP))
+		goto out;
+
+	/*
+	 * Unprotecting only drops the marks and leaves the ptes alone: a
+	 * write fault that was reported is retried once woken up and then
+	 * resolved by do_wp_page() as a normal COW or reuse.
+	 */
+	if (!(uffdio_wp.mode & UFFDIO_WRITEPROTECT_MODE_DONTWAKE)) {
+		range.start = uffdio_wp.range.start;
+		range.len = uffdio_wp.range.len;
+		wake_userfault(ctx, &range);
+	}
+out:
+	return ret;
+}
+
 static inline unsigned int uffd_ctx_features(__u64 user_features)
 {
 	/*
@@ -1739,6 +1948,9 @@ static long userfaultfd_ioctl(struct file *file, unsigned cmd,
 	case UFFDIO_ZEROPAGE:
 		ret = userfaultfd_zeropage(ctx, arg);
 		break;
+	case UFFDIO_WRITEPROTECT:
+		ret = userfaultfd_writeprotect(ctx, arg);
+		break;
 	}
 	return ret;
 }
@@ -1795,6 +2007,8 @@ static void init_once_userfaultfd_ctx(void *mem)
 	init_waitqueue_head(&ctx->event_wqh);
 	init_waitqueue_head(&ctx->fd_wqh);
 	seqcount_init(&ctx->refile_seq);
+	spin_lock_init(&ctx->wp_lock);
+	INIT_RADIX_TREE(&ctx->wp_pages, GFP_ATOMIC);
 }
 
 /**
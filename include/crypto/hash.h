@@ -18,6 +18,9 @@
 
 struct crypto_ahash;
 
+/* Upper bound of shash_alg.mb_max_msgs */
+#define HASH_MAX_MB_MSGS	4
+
 /**
  * DOC: Message Digest Algorithm Definitions
  *
@@ -159,6 +162,11 @@ struct shash_desc {
  * @final: see struct ahash_alg
  * @finup: see struct ahash_alg
  * @digest: see struct ahash_alg
+ * @finup_mb: Finish @num_msgs messages of @len bytes each, all of them
+ *	      continuing from the state in @desc, and store their digests in
+ *	      @outs. Implementations hash the messages in an interleaved way,
+ *	      which is faster than one after the other. The state in @desc is
+ *	      undefined afterwards. Optional.
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
  * @setkey: see struct ahash_alg
@@ -167,6 +175,8 @@ struct shash_desc {
  * @descsize: Size of the operational state for the message digest. This state
  * 	      size is the memory size that needs to be allocated for
  *	      shash_desc.__ctx
+ * @mb_max_msgs: Most messages @finup_mb takes in one call, at most
+ *		 HASH_MAX_MB_MSGS. 1 for algorithms without @finup_mb.
  * @base: internally used
  */
 struct shash_alg {
@@ -178,12 +188,16 @@ struct shash_alg {
 		     unsigned int len, u8 *out);
 	int (*digest)(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 	int (*export)(struct shash_desc *desc, void *out);
 	int (*import)(struct shash_desc *desc, const void *in);
 	int (*setkey)(struct crypto_shash *tfm, const u8 *key,
 		      unsigned int keylen);
 
 	unsigned int descsize;
+	unsigned int mb_max_msgs;
 
 	/* These fields must match hash_alg_common. */
 	unsigned int digestsize
@@ -750,6 +764,18 @@ static inline unsigned int crypto_shash_statesize(struct crypto_shash *tfm)
 	return crypto_shash_alg(tfm)->statesize;
 }
 
+/**
+ * crypto_shash_mb_max_msgs() - obtain the interleaving width of a hash
+ * @tfm: cipher handle
+ *
+ * Return: the number of messages crypto_shash_finup_mb() hashes in one
+ *	   interleaved pass; 1 if the implementation hashes them one by one
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs;
+}
+
 static inline u32 crypto_shash_get_flags(struct crypto_shash *tfm)
 {
 	return crypto_tfm_get_flags(crypto_shash_tfm(tfm));
@@ -916,6 +942,28 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_finup_mb() - calculate message digests of several buffers
+ * @desc: operational state handle that is already initialized
+ * @data: the buffers, each continuing the message in @desc
+ * @len: length of each of the buffers
+ * @outs: output buffers for the message digests, one per buffer
+ * @num_msgs: number of buffers
+ *
+ * Equivalent to copying @desc @num_msgs times and calling
+ * crypto_shash_finup() on each copy with one of the buffers, but hashes up
+ * to crypto_shash_mb_max_msgs() buffers in one interleaved pass. This suits
+ * hash trees, which hash many equally sized blocks with a common prefix
+ * (a salt). Any @num_msgs works; implementations without interleaving are
+ * called once per buffer. The state in @desc is undefined afterwards.
+ *
+ * Return: 0 if the message digests were created successfully; < 0 if an
+ *	   error occurred
+ */
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs);
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
@@ -23,6 +23,7 @@ struct module;
 
 struct cpuidle_device;
 struct cpuidle_driver;
+struct cpuidle_wakeup;
 
 
 /****************************
@@ -212,6 +213,27 @@ static inline void cpuidle_use_deepest_state(bool enable)
 }
 #endif
 
+/* Periodic interrupts, such as vblank, that governors can predict */
+#ifdef CONFIG_CPU_IDLE
+extern struct cpuidle_wakeup *cpuidle_wakeup_register(void);
+extern void cpuidle_wakeup_unregister(struct cpuidle_wakeup *wk);
+extern void cpuidle_wakeup_event(struct cpuidle_wakeup *wk, u64 now_ns,
+				 u64 period_ns);
+extern u64 cpuidle_wakeup_next(int cpu, u64 now_ns);
+#else
+static inline struct cpuidle_wakeup *cpuidle_wakeup_register(void)
+{return NULL; }
+static inline void cpuidle_wakeup_unregister(struct cpuidle_wakeup *wk)
+{
+}
+static inline void cpuidle_wakeup_event(struct cpuidle_wakeup *wk,
+					u64 now_ns, u64 period_ns)
+{
+}
+static inline u64 cpuidle_wakeup_next(int cpu, u64 now_ns)
+{return U64_MAX; }
+#endif
+
 /* kernel/sched/idle.c */
 extern void sched_idle_set_state(struct cpuidle_state *idle_state);
 extern void default_idle_call(void);
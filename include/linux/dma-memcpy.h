@@ -0,0 +1,58 @@
+/*
+ * Offload of large kernel memory copies to a DMA memcpy channel
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _LINUX_DMA_MEMCPY_H
+#define _LINUX_DMA_MEMCPY_H
+
+#include <linux/completion.h>
+#include <linux/dmaengine.h>
+#include <linux/string.h>
+
+/**
+ * struct dma_memcpy - One copy, in flight or done
+ * @done:	Completed once the copy is done, whoever did it
+ * @chan:	Channel doing the copy, NULL when the CPU did it
+ * @cookie:	Cookie of the DMA transfer
+ * @dst:	Bus address of the destination
+ * @src:	Bus address of the source
+ * @len:	Length of the copy
+ *
+ * Start the copy with dma_memcpy_start(), do something else, then call
+ * dma_memcpy_wait() before touching either buffer again. Copies too short
+ * to be worth a DMA transfer, or that no channel can do, are done by the
+ * CPU before dma_memcpy_start() returns.
+ */
+struct dma_memcpy {
+	struct completion	done;
+	struct dma_chan		*chan;
+	dma_cookie_t		cookie;
+	dma_addr_t		dst;
+	dma_addr_t		src;
+	size_t			len;
+};
+
+#ifdef CONFIG_DMA_MEMCPY_OFFLOAD
+void dma_memcpy_start(struct dma_memcpy *op, void *dst, const void *src,
+		      size_t len);
+int dma_memcpy_wait(struct dma_memcpy *op);
+#else
+static inline void dma_memcpy_start(struct dma_memcpy *op, void *dst,
+				    const void *src, size_t len)
+{
+	memcpy(dst, src, len);
+	op->chan = NULL;
+	init_completion(&op->done);
+	complete(&op->done);
+}
+
+static inline int dma_memcpy_wait(struct dma_memcpy *op)
+{
+	return 0;
+}
+#endif
+
+#endif /* _LINUX_DMA_MEMCPY_H */
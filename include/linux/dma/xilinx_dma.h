@@ -22,7 +22,8 @@
  * @master: Master that it syncs to
  * @frm_cnt_en: Enable frame count enable
  * @park: Whether wants to park
- * @park_frm: Frame to park on
+ * @park_frm: Frame to park on, -1 in direct register mode parks on the
+ *	      frame last submitted
  * @coalesc: Interrupt coalescing threshold
  * @delay: Delay counter
  * @reset: Reset Channel
@@ -57,5 +58,7 @@ enum xdma_ip_type {
 
 int xilinx_vdma_channel_set_config(struct dma_chan *dchan,
 					struct xilinx_vdma_config *cfg);
+int xilinx_dma_channel_set_coalesce(struct dma_chan *dchan,
+				    unsigned int coalesce, unsigned int delay);
 
 #endif
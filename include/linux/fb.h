@@ -617,6 +617,15 @@ extern int fb_blank(struct fb_info *info, int blank);
 extern void cfb_fillrect(struct fb_info *info, const struct fb_fillrect *rect); 
 extern void cfb_copyarea(struct fb_info *info, const struct fb_copyarea *area); 
 extern void cfb_imageblit(struct fb_info *info, const struct fb_image *image);
+/*
+ * NEON accelerated versions for 24bpp, falling back to the above
+ */
+extern void cfb24_neon_fillrect(struct fb_info *info,
+				const struct fb_fillrect *rect);
+extern void cfb24_neon_copyarea(struct fb_info *info,
+				const struct fb_copyarea *area);
+extern void cfb24_neon_imageblit(struct fb_info *info,
+				 const struct fb_image *image);
 /*
  * Drawing operations where framebuffer is in system RAM
  */
@@ -83,5 +83,13 @@ static inline int request_firmware_into_buf(const struct firmware **firmware_p,
 	return -EINVAL;
 }
 
+#endif
+
+#if defined(CONFIG_FW_LOADER) || (defined(CONFIG_FW_LOADER_MODULE) && defined(MODULE))
+void firmware_preload(void);
+#else
+static inline void firmware_preload(void)
+{
+}
 #endif
 #endif
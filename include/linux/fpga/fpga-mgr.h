@@ -17,11 +17,13 @@
  */
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
+#include <linux/workqueue.h>
 
 #ifndef _LINUX_FPGA_MGR_H
 #define _LINUX_FPGA_MGR_H
 
 struct fpga_manager;
+struct fpga_mgr_stats;
 struct sg_table;
 
 /**
@@ -63,6 +65,23 @@ enum fpga_mgr_states {
 	FPGA_MGR_STATE_OPERATING,
 };
 
+/**
+ * enum fpga_mgr_phase - phases of a load, for tracing and statistics
+ * @FPGA_MGR_PHASE_FIRMWARE: reading the image through the firmware loader
+ * @FPGA_MGR_PHASE_SETUP: copying, inflating and building sg tables
+ * @FPGA_MGR_PHASE_WRITE_INIT: the low level write_init op
+ * @FPGA_MGR_PHASE_WRITE: the low level write or write_sg op
+ * @FPGA_MGR_PHASE_WRITE_COMPLETE: the low level write_complete op
+ */
+enum fpga_mgr_phase {
+	FPGA_MGR_PHASE_FIRMWARE,
+	FPGA_MGR_PHASE_SETUP,
+	FPGA_MGR_PHASE_WRITE_INIT,
+	FPGA_MGR_PHASE_WRITE,
+	FPGA_MGR_PHASE_WRITE_COMPLETE,
+	FPGA_MGR_PHASE_NR,
+};
+
 /*
  * FPGA Manager flags
  * FPGA_MGR_PARTIAL_RECONFIG: do partial reconfiguration if supported
@@ -72,6 +91,12 @@ enum fpga_mgr_states {
 #define FPGA_MGR_EXTERNAL_CONFIG	BIT(1)
 #define FPGA_MGR_ENCRYPTED_BITSTREAM	BIT(2)
 
+/*
+ * FPGA Manager readback flags
+ * FPGA_MGR_READBACK_CAPTURE: capture flip-flop state before reading back
+ */
+#define FPGA_MGR_READBACK_CAPTURE	BIT(0)
+
 /**
  * struct fpga_image_info - information specific to a FPGA image
  * @flags: boolean flags as defined above
@@ -95,6 +120,8 @@ struct fpga_image_info {
  * @write: write count bytes of configuration data to the FPGA
  * @write_sg: write the scatter list of configuration data to the FPGA
  * @write_complete: set FPGA to operating state after writing is done
+ * @read: optional: read count bytes of configuration memory back, starting
+ *	   at the device specific frame address addr
  * @fpga_remove: optional: Set FPGA into a specific state during driver remove
  *
  * fpga_manager_ops are the low level functions implemented by a specific
@@ -111,9 +138,38 @@ struct fpga_manager_ops {
 	int (*write_sg)(struct fpga_manager *mgr, struct sg_table *sgt);
 	int (*write_complete)(struct fpga_manager *mgr,
 			      struct fpga_image_info *info);
+	int (*read)(struct fpga_manager *mgr, u32 addr, char *buf,
+		    size_t count, unsigned long flags);
 	void (*fpga_remove)(struct fpga_manager *mgr);
 };
 
+typedef void (*fpga_mgr_load_done_t)(struct fpga_manager *mgr, int ret,
+				     void *context);
+
+/**
+ * struct fpga_mgr_load - asynchronous firmware load
+ * @work: runs the load
+ * @flags: FPGA_MGR_LOAD_BUSY while a load is queued or running
+ * @result: result of the last load, -EINPROGRESS while busy
+ * @image_name: name of image file on the firmware search path
+ * @info: fpga image specific information
+ * @done: optional: called with the result once the load has finished
+ * @context: passed to @done
+ * @sysfs: load was started through sysfs, take a reference to the manager
+ * @sysfs_info: image information for loads started through sysfs
+ */
+struct fpga_mgr_load {
+	struct work_struct work;
+	unsigned long flags;
+	int result;
+	char *image_name;
+	struct fpga_image_info *info;
+	fpga_mgr_load_done_t done;
+	void *context;
+	bool sysfs;
+	struct fpga_image_info sysfs_info;
+};
+
 /**
  * struct fpga_manager - fpga manager structure
  * @name: name of low level fpga manager
@@ -122,6 +178,17 @@ struct fpga_manager_ops {
  * @state: state of fpga manager
  * @mops: pointer to struct of fpga manager ops
  * @priv: low level driver private date
+ * @load: asynchronous firmware load
+ * @pr_cache_lock: protects @pr_cache and @pr_cache_bytes
+ * @pr_cache: partial reconfiguration images, most recently used first
+ * @pr_cache_bytes: total size of the images in @pr_cache
+ * @stats: timing of the current and the last few loads
+ * @readback_lock: protects @readback_buf and @readback_len
+ * @readback_buf: last configuration memory snapshot taken through sysfs
+ * @readback_len: size of @readback_buf
+ * @restore_buf: copy of the last full image, rewritten after hibernation
+ * @restore_len: size of @restore_buf
+ * @restore_info: image information for @restore_buf
  */
 struct fpga_manager {
 	const char *name;
@@ -130,6 +197,17 @@ struct fpga_manager {
 	enum fpga_mgr_states state;
 	const struct fpga_manager_ops *mops;
 	void *priv;
+	struct fpga_mgr_load load;
+	struct mutex pr_cache_lock;
+	struct list_head pr_cache;
+	size_t pr_cache_bytes;
+	struct fpga_mgr_stats *stats;
+	struct mutex readback_lock;
+	char *readback_buf;
+	size_t readback_len;
+	char *restore_buf;
+	size_t restore_len;
+	struct fpga_image_info restore_info;
 };
 
 #define to_fpga_manager(d) container_of(d, struct fpga_manager, dev)
@@ -142,6 +220,13 @@ int fpga_mgr_buf_load_sg(struct fpga_manager *mgr, struct fpga_image_info *info,
 int fpga_mgr_firmware_load(struct fpga_manager *mgr,
 			   struct fpga_image_info *info,
 			   const char *image_name);
+int fpga_mgr_firmware_load_async(struct fpga_manager *mgr,
+				 struct fpga_image_info *info,
+				 const char *image_name,
+				 fpga_mgr_load_done_t done, void *context);
+
+int fpga_mgr_read(struct fpga_manager *mgr, u32 addr, char *buf,
+		  size_t count, unsigned long flags);
 
 struct fpga_manager *of_fpga_mgr_get(struct device_node *node);
 
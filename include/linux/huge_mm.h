@@ -255,8 +255,7 @@ static inline void split_huge_pmd_address(struct vm_area_struct *vma,
 static inline int hugepage_madvise(struct vm_area_struct *vma,
 				   unsigned long *vm_flags, int advice)
 {
-	BUG();
-	return 0;
+	return -EINVAL;
 }
 static inline void vma_adjust_trans_huge(struct vm_area_struct *vma,
 					 unsigned long start,
@@ -308,4 +307,18 @@ static inline struct page *follow_devmap_pud(struct vm_area_struct *vma,
 }
 #endif /* CONFIG_TRANSPARENT_HUGEPAGE */
 
+#ifdef CONFIG_ARCH_HAS_PFNMAP_HUGEPAGE
+/* MADV_HUGEPAGE and MADV_NOHUGEPAGE on the page tables of a VM_PFNMAP vma */
+extern int pfnmap_hugepage_madvise(struct vm_area_struct *vma,
+				   unsigned long start, unsigned long end,
+				   int advice);
+#else
+static inline int pfnmap_hugepage_madvise(struct vm_area_struct *vma,
+					  unsigned long start,
+					  unsigned long end, int advice)
+{
+	return -EINVAL;
+}
+#endif
+
 #endif /* _LINUX_HUGE_MM_H */
@@ -139,6 +139,15 @@ extern void (*late_time_init)(void);
 
 extern bool initcall_debug;
 
+#ifdef CONFIG_INITCALL_STATS
+void initcall_stats_add(initcall_t fn, const char *drv, const char *dev,
+			u64 ns, int ret, bool retry);
+#else
+static inline void initcall_stats_add(initcall_t fn, const char *drv,
+				      const char *dev, u64 ns, int ret,
+				      bool retry) { }
+#endif
+
 #endif
   
 #ifndef MODULE
@@ -383,6 +383,7 @@ int input_flush_device(struct input_handle *handle, struct file *file);
 
 void input_event(struct input_dev *dev, unsigned int type, unsigned int code, int value);
 void input_inject_event(struct input_handle *handle, unsigned int type, unsigned int code, int value);
+void input_events(struct input_dev *dev, const struct input_value *vals, unsigned int count);
 
 static inline void input_report_key(struct input_dev *dev, unsigned int code, int value)
 {
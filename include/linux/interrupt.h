@@ -389,6 +389,8 @@ static inline void enable_irq_lockdep_irqrestore(unsigned int irq, unsigned long
 	enable_irq(irq);
 }
 
+extern int irq_set_thread_priority(unsigned int irq, unsigned int prio);
+
 /* IRQ wakeup (PM) control: */
 extern int irq_set_irq_wake(unsigned int irq, unsigned int on);
 
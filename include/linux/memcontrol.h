@@ -194,6 +194,10 @@ struct mem_cgroup {
 	int	swappiness;
 	/* OOM-Killer disable */
 	int		oom_kill_disable;
+#ifdef CONFIG_ZSWAP
+	/* Swap out without compressing into zswap first */
+	bool		zswap_skip;
+#endif
 
 	/* handle for "memory.events" */
 	struct cgroup_file events_file;
@@ -209,6 +209,33 @@ struct mmc_supply {
 	struct regulator *vqmmc;	/* Optional Vccq supply */
 };
 
+#define MMC_STATS_SIZE_BUCKETS	11	/* 512 bytes to 512 KiB and up */
+#define MMC_STATS_TIME_BUCKETS	16	/* 1 us to 32 ms and up */
+
+/**
+ * struct mmc_host_stats - request statistics, shown in debugfs "stats"
+ * @mrq:	request being timed
+ * @req_start:	start time of @mrq in ns
+ * @idle_start:	completion time of the last request in ns
+ * @size:	data request sizes, reads and writes, power of two buckets
+ * @latency:	time from issue to completion, power of two us buckets
+ * @idle:	time the host was idle before a request, as @latency
+ * @data_errors: requests completed with a data error
+ * @dma_errors:	DMA (e.g. ADMA) errors reported by the host driver
+ * @retries:	requests retried by the core after a command error
+ */
+struct mmc_host_stats {
+	struct mmc_request	*mrq;
+	u64			req_start;
+	u64			idle_start;
+	u32			size[2][MMC_STATS_SIZE_BUCKETS];
+	u32			latency[MMC_STATS_TIME_BUCKETS];
+	u32			idle[MMC_STATS_TIME_BUCKETS];
+	u32			data_errors;
+	u32			dma_errors;
+	u32			retries;
+};
+
 struct mmc_host {
 	struct device		*parent;
 	struct device		class_dev;
@@ -372,6 +399,8 @@ struct mmc_host {
 
 	struct dentry		*debugfs_root;
 
+	struct mmc_host_stats	stats;		/* request statistics */
+
 	struct mmc_async_req	*areq;		/* active async req */
 	struct mmc_context_info	context_info;	/* async synchronization info */
 
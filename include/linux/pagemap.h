@@ -26,6 +26,7 @@ enum mapping_flags {
 	AS_EXITING	= 4, 	/* final truncate in progress */
 	/* writeback related tags are not used */
 	AS_NO_WRITEBACK_TAGS = 5,
+	AS_KEEP_RESIDENT = 6,	/* POSIX_FADV_KEEP_RESIDENT */
 };
 
 static inline void mapping_set_error(struct address_space *mapping, int error)
@@ -75,6 +76,21 @@ static inline int mapping_use_writeback_tags(struct address_space *mapping)
 	return !test_bit(AS_NO_WRITEBACK_TAGS, &mapping->flags);
 }
 
+static inline void mapping_set_keep_resident(struct address_space *mapping)
+{
+	set_bit(AS_KEEP_RESIDENT, &mapping->flags);
+}
+
+static inline void mapping_clear_keep_resident(struct address_space *mapping)
+{
+	clear_bit(AS_KEEP_RESIDENT, &mapping->flags);
+}
+
+static inline int mapping_keep_resident(struct address_space *mapping)
+{
+	return test_bit(AS_KEEP_RESIDENT, &mapping->flags);
+}
+
 static inline gfp_t mapping_gfp_mask(struct address_space * mapping)
 {
 	return mapping->gfp_mask;
@@ -60,6 +60,9 @@ enum brcmf_bus_type {
  *
  * @txglomsz:		SDIO txglom size. Use 0 if default of driver is to be
  *			used.
+ * @txglom_hold_us:	how long tx frames may be held back to build a glom
+ *			chain as deep as the tx queue has been recently. 0
+ *			sends whatever is queued right away.
  * @drive_strength:	is the preferred drive_strength to be used for the SDIO
  *			pins. If 0 then a default value will be used. This is
  *			the target drive strength, the exact drive strength
@@ -90,6 +93,7 @@ enum brcmf_bus_type {
  */
 struct brcmfmac_sdio_pd {
 	int		txglomsz;
+	unsigned int	txglom_hold_us;
 	unsigned int	drive_strength;
 	bool		oob_irq_supported;
 	unsigned int	oob_irq_nr;
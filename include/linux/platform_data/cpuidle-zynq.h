@@ -0,0 +1,16 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#ifndef __CPUIDLE_ZYNQ_H
+#define __CPUIDLE_ZYNQ_H
+
+struct cpuidle_zynq_data {
+	bool (*self_refresh_available)(void);
+	void (*prepare_self_refresh)(void);
+	void (*enter_self_refresh)(int cpu);
+};
+
+#endif
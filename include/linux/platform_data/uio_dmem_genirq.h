@@ -18,9 +18,14 @@
 
 #include <linux/uio_driver.h>
 
+/*
+ * With cached set the dynamic regions are mapped cached in userspace, which
+ * then syncs them with the UIO_DMEM_IOCTL_SYNC_* ioctls.
+ */
 struct uio_dmem_genirq_pdata {
 	struct uio_info	uioinfo;
 	unsigned int *dynamic_region_sizes;
 	unsigned int num_dynamic_regions;
+	bool cached;
 };
 #endif /* _UIO_DMEM_GENIRQ_H */
@@ -37,9 +37,17 @@ struct bq27xxx_platform_data {
 	int (*read)(struct device *dev, unsigned int);
 };
 
+/* Standard commands 0x00-0x3f can be read back to back in one burst */
+#define BQ27XXX_SNAPSHOT_SIZE	64
+
+/* Longest burst, fits the FIFO of common I2C controllers */
+#define BQ27XXX_BULK_MAX	16
+
 struct bq27xxx_device_info;
 struct bq27xxx_access_methods {
 	int (*read)(struct bq27xxx_device_info *di, u8 reg, bool single);
+	int (*read_bulk)(struct bq27xxx_device_info *di, u8 reg, u8 *data,
+			 int len);
 };
 
 struct bq27xxx_reg_cache {
@@ -54,6 +62,9 @@ struct bq27xxx_reg_cache {
 	int flags;
 	int power_avg;
 	int health;
+	int voltage;
+	int current_now;
+	int charge_now;
 };
 
 struct bq27xxx_device_info {
@@ -70,6 +81,10 @@ struct bq27xxx_device_info {
 	struct list_head list;
 	struct mutex lock;
 	u8 *regs;
+	struct mutex update_lock;
+	bool irq_updates;	/* the gauge interrupt triggers updates */
+	u64 snapshot_valid;
+	u8 snapshot[BQ27XXX_SNAPSHOT_SIZE];
 };
 
 void bq27xxx_battery_update(struct bq27xxx_device_info *di);
@@ -88,4 +88,14 @@ struct ns_common;
 int open_related_ns(struct ns_common *ns,
 		   struct ns_common *(*get_ns)(struct ns_common *ns));
 
+/* Architecture specific task state in /proc/<pid>/arch_status */
+#ifdef CONFIG_PROC_PID_ARCH_STATUS
+struct seq_file;
+struct pid_namespace;
+struct pid;
+struct task_struct;
+int proc_pid_arch_status(struct seq_file *m, struct pid_namespace *ns,
+			 struct pid *pid, struct task_struct *task);
+#endif
+
 #endif /* _LINUX_PROC_FS_H */
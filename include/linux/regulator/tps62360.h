@@ -39,6 +39,9 @@
  *              fixed logic.
  * @vsel0_def_state: Default state of vsel0. 1 if it is high else 0.
  * @vsel1_def_state: Default state of vsel1. 1 if it is high else 0.
+ * @dvs_preset_uV: Voltages to program into the idle VSET registers at
+ *                 probe, so that switching to them only needs the gpios.
+ * @num_dvs_presets: Number of valid entries in @dvs_preset_uV.
  */
 struct tps62360_regulator_platform_data {
 	struct regulator_init_data *reg_init_data;
@@ -48,6 +51,8 @@ struct tps62360_regulator_platform_data {
 	int vsel1_gpio;
 	int vsel0_def_state;
 	int vsel1_def_state;
+	u32 dvs_preset_uV[3];
+	int num_dvs_presets;
 };
 
 #endif /* __LINUX_REGULATOR_TPS62360_H */
@@ -521,6 +521,10 @@ struct task_struct {
 	struct sched_rt_entity		rt;
 #ifdef CONFIG_CGROUP_SCHED
 	struct task_group		*sched_task_group;
+#endif
+#ifdef CONFIG_SCHED_UTIL_MIN
+	/* Minimum utilization accounted on the runqueue at enqueue */
+	unsigned int			util_min;
 #endif
 	struct sched_dl_entity		dl;
 
@@ -28,4 +28,6 @@ static inline bool dl_time_before(u64 a, u64 b)
 	return (s64)(a - b) < 0;
 }
 
+extern int sched_dl_task_align(struct task_struct *p);
+
 #endif /* _LINUX_SCHED_DEADLINE_H */
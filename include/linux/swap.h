@@ -545,6 +545,15 @@ static inline int mem_cgroup_swappiness(struct mem_cgroup *mem)
 }
 #endif
 
+#if defined(CONFIG_MEMCG) && defined(CONFIG_ZSWAP)
+extern bool mem_cgroup_zswap_skip(struct page *page);
+#else
+static inline bool mem_cgroup_zswap_skip(struct page *page)
+{
+	return false;
+}
+#endif
+
 #ifdef CONFIG_MEMCG_SWAP
 extern void mem_cgroup_swapout(struct page *page, swp_entry_t entry);
 extern int mem_cgroup_try_charge_swap(struct page *page, swp_entry_t entry);
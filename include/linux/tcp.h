@@ -191,6 +191,7 @@ struct tcp_sock {
 	u32	tsoffset;	/* timestamp offset */
 
 	struct list_head tsq_node; /* anchor in tsq_tasklet.head list */
+	struct hrtimer	pacing_timer; /* internal pacing, see tcp_pace_kick() */
 
 	/* Data for direct copy to user */
 	struct {
@@ -80,6 +80,12 @@ struct udp_sock {
 						struct sk_buff *skb,
 						int nhoff);
 
+	/* udp_recvmsg() dequeues from here before splicing
+	 * sk_receive_queue, so readers and softirq producers rarely
+	 * contend for the same lock
+	 */
+	struct sk_buff_head	reader_queue ____cacheline_aligned_in_smp;
+
 	/* This field is dirtied by udp_recvmsg() */
 	int		forward_deficit;
 };
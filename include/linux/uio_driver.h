@@ -16,6 +16,7 @@
 
 #include <linux/fs.h>
 #include <linux/interrupt.h>
+#include <uapi/linux/uio_driver.h>
 
 struct module;
 struct uio_map;
@@ -93,6 +94,7 @@ struct uio_device {
  * @open:		open operation for this uio device
  * @release:		release operation for this uio device
  * @irqcontrol:		disable/enable irqs when 0/1 is written to /dev/uioX
+ * @ioctl:		ioctl operation for this uio device
  */
 struct uio_info {
 	struct uio_device	*uio_dev;
@@ -108,6 +110,8 @@ struct uio_info {
 	int (*open)(struct uio_info *info, struct inode *inode);
 	int (*release)(struct uio_info *info, struct inode *inode);
 	int (*irqcontrol)(struct uio_info *info, s32 irq_on);
+	long (*ioctl)(struct uio_info *info, unsigned int cmd,
+		      unsigned long arg);
 };
 
 extern int __must_check
@@ -131,6 +135,7 @@ extern void uio_event_notify(struct uio_info *info);
 #define UIO_MEM_PHYS	1
 #define UIO_MEM_LOGICAL	2
 #define UIO_MEM_VIRTUAL 3
+#define UIO_MEM_PHYS_CACHED	4
 
 /* defines for uio_port->porttype */
 #define UIO_PORT_NONE	0
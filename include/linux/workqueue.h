@@ -104,6 +104,9 @@ struct work_struct {
 #ifdef CONFIG_LOCKDEP
 	struct lockdep_map lockdep_map;
 #endif
+#ifdef CONFIG_WQ_LATENCY_HIST
+	u64 queued_ns;
+#endif
 };
 
 #define WORK_DATA_INIT()	ATOMIC_LONG_INIT((unsigned long)WORK_STRUCT_NO_POOL)
@@ -345,6 +348,10 @@ enum {
  * system_highpri_wq is similar to system_wq but for work items which
  * require WQ_HIGHPRI.
  *
+ * system_display_wq is a WQ_HIGHPRI workqueue for frame and input
+ * critical work, such as display flushes and touch polling, which must
+ * not queue behind housekeeping work on system_wq.
+ *
  * system_long_wq is similar to system_wq but may host long running
  * works.  Queue flushing might take relatively long.
  *
@@ -364,6 +371,7 @@ enum {
  */
 extern struct workqueue_struct *system_wq;
 extern struct workqueue_struct *system_highpri_wq;
+extern struct workqueue_struct *system_display_wq;
 extern struct workqueue_struct *system_long_wq;
 extern struct workqueue_struct *system_unbound_wq;
 extern struct workqueue_struct *system_freezable_wq;
@@ -0,0 +1,143 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fpga
+
+#if !defined(_TRACE_FPGA_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FPGA_H
+
+#include <linux/fpga/fpga-mgr.h>
+#include <linux/tracepoint.h>
+
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_FIRMWARE);
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_SETUP);
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_WRITE_INIT);
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_WRITE);
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_WRITE_COMPLETE);
+
+#define show_fpga_mgr_phase(phase)					\
+	__print_symbolic(phase,						\
+			 { FPGA_MGR_PHASE_FIRMWARE,	"firmware" },	\
+			 { FPGA_MGR_PHASE_SETUP,	"setup" },	\
+			 { FPGA_MGR_PHASE_WRITE_INIT,	"write_init" },	\
+			 { FPGA_MGR_PHASE_WRITE,	"write" },	\
+			 { FPGA_MGR_PHASE_WRITE_COMPLETE, "write_complete" })
+
+/*
+ * drivers/fpga/fpga-mgr.c
+ */
+
+TRACE_EVENT(fpga_mgr_load_begin,
+	TP_PROTO(struct fpga_manager *mgr, const char *image_name),
+	TP_ARGS(mgr, image_name),
+
+	TP_STRUCT__entry(
+		__string	( dev,		dev_name(&mgr->dev)	)
+		__string	( image,	image_name		)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&mgr->dev));
+		__assign_str(image, image_name);
+	),
+
+	TP_printk("%s image=%s", __get_str(dev), __get_str(image))
+);
+
+TRACE_EVENT(fpga_mgr_load_end,
+	TP_PROTO(struct fpga_manager *mgr, size_t bytes, u64 us, int ret),
+	TP_ARGS(mgr, bytes, us, ret),
+
+	TP_STRUCT__entry(
+		__string	( dev,		dev_name(&mgr->dev)	)
+		__field		( size_t,	bytes			)
+		__field		( u64,		us			)
+		__field		( int,		ret			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&mgr->dev));
+		__entry->bytes	= bytes;
+		__entry->us	= us;
+		__entry->ret	= ret;
+	),
+
+	TP_printk("%s bytes=%zu us=%llu ret=%d", __get_str(dev),
+		  __entry->bytes, __entry->us, __entry->ret)
+);
+
+DECLARE_EVENT_CLASS(fpga_mgr_phase,
+	TP_PROTO(struct fpga_manager *mgr, int phase, int ret),
+	TP_ARGS(mgr, phase, ret),
+
+	TP_STRUCT__entry(
+		__string	( dev,		dev_name(&mgr->dev)	)
+		__field		( int,		phase			)
+		__field		( int,		ret			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&mgr->dev));
+		__entry->phase	= phase;
+		__entry->ret	= ret;
+	),
+
+	TP_printk("%s phase=%s ret=%d", __get_str(dev),
+		  show_fpga_mgr_phase(__entry->phase), __entry->ret)
+);
+
+DEFINE_EVENT(fpga_mgr_phase, fpga_mgr_phase_begin,
+	TP_PROTO(struct fpga_manager *mgr, int phase, int ret),
+	TP_ARGS(mgr, phase, ret)
+);
+
+DEFINE_EVENT(fpga_mgr_phase, fpga_mgr_phase_end,
+	TP_PROTO(struct fpga_manager *mgr, int phase, int ret),
+	TP_ARGS(mgr, phase, ret)
+);
+
+/*
+ * drivers/fpga/zynq-fpga.c
+ */
+
+TRACE_EVENT(zynq_fpga_dma_queue,
+	TP_PROTO(struct device *dev, u32 addr, u32 len, bool last),
+	TP_ARGS(dev, addr, len, last),
+
+	TP_STRUCT__entry(
+		__string	( dev,		dev_name(dev)		)
+		__field		( u32,		addr			)
+		__field		( u32,		len			)
+		__field		( bool,		last			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->addr	= addr;
+		__entry->len	= len;
+		__entry->last	= last;
+	),
+
+	TP_printk("%s addr=0x%08x len=%u%s", __get_str(dev), __entry->addr,
+		  __entry->len, __entry->last ? " last" : "")
+);
+
+TRACE_EVENT(zynq_fpga_dma_done,
+	TP_PROTO(struct device *dev, u32 intr_status),
+	TP_ARGS(dev, intr_status),
+
+	TP_STRUCT__entry(
+		__string	( dev,		dev_name(dev)		)
+		__field		( u32,		intr_status		)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->intr_status = intr_status;
+	),
+
+	TP_printk("%s int_sts=0x%08x", __get_str(dev), __entry->intr_status)
+);
+
+#endif /* _TRACE_FPGA_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -18,4 +18,11 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/*
+ * Linux specific, for the whole file: keep its page cache resident unless
+ * memory gets really short, until POSIX_FADV_NOKEEP_RESIDENT.
+ */
+#define POSIX_FADV_KEEP_RESIDENT	8
+#define POSIX_FADV_NOKEEP_RESIDENT	9
+
 #endif	/* FADVISE_H_INCLUDED */
@@ -142,6 +142,7 @@ struct gpioevent_request {
 /**
  * struct gpioevent_data - The actual event being pushed to userspace
  * @timestamp: best estimate of time of event occurrence, in nanoseconds
+ * of CLOCK_MONOTONIC
  * @id: event identifier
  */
 struct gpioevent_data {
@@ -109,6 +109,23 @@ struct input_mask {
 	__u64 codes_ptr;
 };
 
+/**
+ * struct input_batch - used by EVIOCSBATCH ioctl
+ * @max_delay_us: longest time a completed packet may wait before the reader
+ *	is woken up, 0 disables batching
+ * @max_packets: wake the reader as soon as this many packets are queued,
+ *	0 to only bound the delay
+ * @buffer_size: number of events the client's buffer holds, rounded up to a
+ *	power of two, 0 to keep the current size
+ * @reserved: must be 0
+ */
+struct input_batch {
+	__u32 max_delay_us;
+	__u32 max_packets;
+	__u32 buffer_size;
+	__u32 reserved;
+};
+
 #define EVIOCGVERSION		_IOR('E', 0x01, int)			/* get driver version */
 #define EVIOCGID		_IOR('E', 0x02, struct input_id)	/* get device ID */
 #define EVIOCGREP		_IOR('E', 0x03, unsigned int[2])	/* get repeat settings */
@@ -222,6 +239,26 @@ struct input_mask {
 
 #define EVIOCSCLOCKID		_IOW('E', 0xa0, int)			/* Set clockid to be used for timestamps */
 
+/**
+ * EVIOCSBATCH - Batch wakeups of this client
+ *
+ * By default a reader is woken up on every SYN_REPORT. With batching enabled
+ * completed packets stay queued and the reader, poll() and SIGIO are only
+ * signalled once max_packets packets are queued or the first of them has
+ * waited max_delay_us, whichever comes first. A read() that finds packets
+ * still returns them right away. The argument is a "struct input_batch".
+ *
+ * buffer_size optionally resizes the client's buffer, so that it can hold a
+ * whole batch. Events still queued when the buffer is resized are dropped
+ * and SYN_DROPPED is queued instead.
+ *
+ * Like the event masks, batching only affects the file descriptor it is
+ * applied to. EINVAL is returned for out of range values or a non-zero
+ * max_packets without max_delay_us, ENOMEM if the buffer could not be
+ * resized.
+ */
+#define EVIOCSBATCH		_IOW('E', 0xa1, struct input_batch)	/* Set wakeup batching */
+
 /*
  * IDs.
  */
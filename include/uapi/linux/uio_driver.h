@@ -0,0 +1,37 @@
+#ifndef _UAPI_UIO_DRIVER_H
+#define _UAPI_UIO_DRIVER_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Userspace I/O device interface
+ */
+
+/*
+ * Reading this from /dev/uioX instead of a single __s32 returns, along
+ * with the total interrupt count, the number of interrupts since the
+ * previous read on the same file. One read then accounts for every
+ * interrupt that came in while userspace was busy.
+ */
+struct uio_event_count {
+	__s32 total;		/* interrupts since the device was registered */
+	__s32 pending;		/* interrupts since the previous read */
+};
+
+/*
+ * Sync part of a cached uio_dmem_genirq buffer, before the device reads
+ * it (FOR_DEVICE) or after the device wrote it (FOR_CPU). Buffers mapped
+ * uncached don't need it.
+ */
+struct uio_dmem_sync {
+	__u32 map;		/* index N of the buffer, mmap()ed at N * page size */
+	__u32 reserved;
+	__u64 offset;		/* start of the part to sync, in bytes */
+	__u64 size;		/* length of the part to sync, in bytes */
+};
+
+#define UIO_DMEM_IOCTL_SYNC_FOR_CPU	_IOW('u', 0x10, struct uio_dmem_sync)
+#define UIO_DMEM_IOCTL_SYNC_FOR_DEVICE	_IOW('u', 0x11, struct uio_dmem_sync)
+
+#endif /* _UAPI_UIO_DRIVER_H */
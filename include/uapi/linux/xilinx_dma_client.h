@@ -0,0 +1,31 @@
+#ifndef _UAPI_XILINX_DMA_CLIENT_H
+#define _UAPI_XILINX_DMA_CLIENT_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Xilinx AXI DMA userspace client ioctls
+ */
+
+#define XDMA_CLIENT_MEM_TO_DEV	0	/* MM2S, the "tx" channel */
+#define XDMA_CLIENT_DEV_TO_MEM	1	/* S2MM, the "rx" channel */
+
+/*
+ * Queue a transfer straight from or to userspace memory, either a whole
+ * dma-buf or, if dmabuf_fd is -1, len bytes of memory at addr. The
+ * memory stays mapped until the transfer completes, which signals the
+ * returned sync_file fence. Transfers on a channel complete in order.
+ */
+struct xdma_client_xfer {
+	__u32 dir;		/* XDMA_CLIENT_MEM_TO_DEV or _DEV_TO_MEM */
+	__s32 dmabuf_fd;	/* dma-buf to transfer, or -1 */
+	__u64 addr;		/* user memory, if no dma-buf */
+	__u64 len;		/* user memory length in bytes */
+	__u32 flags;		/* O_CLOEXEC for the fence fd */
+	__s32 fence_fd;		/* returned sync_file fd */
+};
+
+#define XDMA_CLIENT_IOCTL_XFER	_IOWR('x', 0x40, struct xdma_client_xfer)
+
+#endif /* _UAPI_XILINX_DMA_CLIENT_H */
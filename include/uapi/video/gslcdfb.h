@@ -0,0 +1,101 @@
+#ifndef _UAPI_GSLCDFB_H
+#define _UAPI_GSLCDFB_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+/*
+ * Gameslab LCD frame buffer (gslcdfb) specific ioctls
+ */
+
+/*
+ * Copy a rectangle within the virtual screen. Coordinates are in pixels
+ * of the current mode. The copy has completed when the ioctl returns.
+ */
+struct gslcdfb_blit {
+	__u32 sx, sy;		/* source top left */
+	__u32 dx, dy;		/* destination top left */
+	__u32 width, height;
+};
+
+#define GSLCDFB_IOCTL_BLIT	_IOW('F', 0x40, struct gslcdfb_blit)
+
+/*
+ * Export the scanout memory as a dma-buf. The buffer covers the whole
+ * virtual screen, screen n starts at n * yres * line_length.
+ */
+struct gslcdfb_dmabuf {
+	__u32 flags;		/* O_CLOEXEC and/or O_RDWR for the new fd */
+	__s32 fd;		/* returned dma-buf fd */
+	__u32 size;		/* returned dma-buf size in bytes */
+};
+
+#define GSLCDFB_IOCTL_EXPORT_DMABUF	_IOWR('F', 0x41, struct gslcdfb_dmabuf)
+
+/*
+ * Bracket CPU access to lines [y, y + height) of the virtual screen when
+ * the frame buffer is mapped cacheable, as DMA_BUF_IOCTL_SYNC does for a
+ * dma-buf. START before reading what the hardware wrote (blits), END
+ * after writing so the lines reach memory before scanout. The ioctl does
+ * nothing for the default write-combined mapping.
+ */
+struct gslcdfb_sync {
+	__u32 flags;
+	__u32 y;
+	__u32 height;
+};
+
+#define GSLCDFB_SYNC_READ	(1 << 0)
+#define GSLCDFB_SYNC_WRITE	(2 << 0)
+#define GSLCDFB_SYNC_RW		(GSLCDFB_SYNC_READ | GSLCDFB_SYNC_WRITE)
+#define GSLCDFB_SYNC_START	(0 << 2)
+#define GSLCDFB_SYNC_END	(1 << 2)
+#define GSLCDFB_SYNC_VALID_FLAGS_MASK \
+	(GSLCDFB_SYNC_RW | GSLCDFB_SYNC_END)
+
+#define GSLCDFB_IOCTL_SYNC	_IOW('F', 0x42, struct gslcdfb_sync)
+
+/*
+ * Start a new period of the calling SCHED_DEADLINE task at every vblank,
+ * so that its runtime is available as soon as scanout of a frame begins.
+ * The period set with sched_setattr() should be a bit shorter than the
+ * frame time, so that the previous period has ended by the vblank and the
+ * runtime can be refilled. Pass 1 to bind the caller, 0 to unbind it. One
+ * task can be bound at a time, the binding ends when the task exits or
+ * leaves SCHED_DEADLINE.
+ */
+#define GSLCDFB_IOCTL_ALIGN_DEADLINE	_IOW('F', 0x43, __u32)
+
+/*
+ * Scan out a dma-buf from another device, such as a V4L2 capture buffer,
+ * from the next vblank on. The buffer has to be contiguous for the LCD
+ * core and laid out in the current mode: the first line starts at offset
+ * and lines are line_length bytes apart. fd -1 goes back to the frame
+ * buffer at the current pan offset, as does FBIOPAN_DISPLAY. A buffer is
+ * held until the flip replacing it has taken effect.
+ */
+struct gslcdfb_flip_dmabuf {
+	__s32 fd;
+	__u32 offset;
+};
+
+#define GSLCDFB_IOCTL_FLIP_DMABUF	_IOW('F', 0x44, struct gslcdfb_flip_dmabuf)
+
+/*
+ * Export a single screen of the virtual screen as a dma-buf, screen n
+ * being the one shown at yoffset n * yres. Importers that only take
+ * whole buffers, such as V4L2 queues, can then be handed the frame on
+ * screen after FBIO_WAITFORVSYNC. The layout is the one of the mode at
+ * export time. Only a screen that starts on a page boundary can be
+ * mmap()ed, and only its whole pages: mmap() fails with EINVAL otherwise.
+ */
+struct gslcdfb_screen_dmabuf {
+	__u32 flags;		/* O_CLOEXEC and/or O_RDWR for the new fd */
+	__u32 screen;		/* screen index */
+	__s32 fd;		/* returned dma-buf fd */
+	__u32 size;		/* returned dma-buf size in bytes */
+};
+
+#define GSLCDFB_IOCTL_EXPORT_SCREEN	_IOWR('F', 0x45, struct gslcdfb_screen_dmabuf)
+
+#endif /* _UAPI_GSLCDFB_H */
@@ -0,0 +1,151 @@
+/*
+ * Timing table of the initcalls and driver probes
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Every initcall and every driver probe is timed and recorded in a fixed
+ * table, until the table is full. debugfs/initcall_stats lists them from
+ * the slowest to the fastest, which is more useful for trimming the boot
+ * than the initcall_debug log. Probes retried from the deferred probe list
+ * are marked as such, the time they spend deferring adds up too.
+ */
+
+#include <linux/atomic.h>
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/time64.h>
+
+#define INITCALL_STATS_ENTRIES	256
+
+struct initcall_stat {
+	initcall_t fn;		/* NULL for a probe */
+	char name[32];		/* driver and device of a probe */
+	u64 ns;
+	int ret;
+	bool retry;
+	bool valid;
+};
+
+static struct initcall_stat initcall_stats[INITCALL_STATS_ENTRIES];
+static atomic_t initcall_stats_count = ATOMIC_INIT(0);
+
+/**
+ * initcall_stats_add - Record the time taken by an initcall or a probe
+ * @fn:		Initcall, NULL for a probe
+ * @drv:	Driver name of a probe
+ * @dev:	Device name of a probe
+ * @ns:		Time taken, in ns
+ * @ret:	Return value
+ * @retry:	Probe retried from the deferred probe list
+ */
+void initcall_stats_add(initcall_t fn, const char *drv, const char *dev,
+			u64 ns, int ret, bool retry)
+{
+	struct initcall_stat *stat;
+	int i;
+
+	i = atomic_inc_return(&initcall_stats_count) - 1;
+	if (i >= INITCALL_STATS_ENTRIES)
+		return;
+
+	stat = &initcall_stats[i];
+	stat->fn = fn;
+	if (!fn)
+		snprintf(stat->name, sizeof(stat->name), "%s %s", drv, dev);
+	stat->ns = ns;
+	stat->ret = ret;
+	stat->retry = retry;
+	/* The entry may be listed as soon as it is valid */
+	smp_wmb();
+	stat->valid = true;
+}
+
+static int initcall_stats_cmp(const void *a, const void *b)
+{
+	const struct initcall_stat *x = *(const struct initcall_stat **)a;
+	const struct initcall_stat *y = *(const struct initcall_stat **)b;
+
+	if (x->ns == y->ns)
+		return 0;
+	return x->ns < y->ns ? 1 : -1;
+}
+
+static int initcall_stats_show(struct seq_file *m, void *v)
+{
+	int count = atomic_read(&initcall_stats_count);
+	u64 calls = 0, probes = 0, retries = 0;
+	struct initcall_stat **sorted;
+	int i, n = 0;
+
+	sorted = kmalloc_array(INITCALL_STATS_ENTRIES, sizeof(*sorted),
+			       GFP_KERNEL);
+	if (!sorted)
+		return -ENOMEM;
+
+	for (i = 0; i < min(count, INITCALL_STATS_ENTRIES); i++) {
+		if (!READ_ONCE(initcall_stats[i].valid))
+			continue;
+		smp_rmb();
+		sorted[n++] = &initcall_stats[i];
+	}
+	sort(sorted, n, sizeof(*sorted), initcall_stats_cmp, NULL);
+
+	seq_puts(m, "     usecs   ret kind  name\n");
+	for (i = 0; i < n; i++) {
+		struct initcall_stat *stat = sorted[i];
+
+		seq_printf(m, "%10llu %5d ", div_u64(stat->ns, NSEC_PER_USEC),
+			   stat->ret);
+		if (stat->fn) {
+			seq_printf(m, "call  %pf\n", stat->fn);
+			calls += stat->ns;
+		} else {
+			seq_printf(m, "%-5s %s\n",
+				   stat->retry ? "retry" : "probe", stat->name);
+			if (stat->retry)
+				retries += stat->ns;
+			else
+				probes += stat->ns;
+		}
+	}
+
+	seq_printf(m, "total usecs: initcalls %llu, probes %llu, retries %llu\n",
+		   div_u64(calls, NSEC_PER_USEC),
+		   div_u64(probes, NSEC_PER_USEC),
+		   div_u64(retries, NSEC_PER_USEC));
+	if (count > INITCALL_STATS_ENTRIES)
+		seq_printf(m, "%d entries dropped\n",
+			   count - INITCALL_STATS_ENTRIES);
+
+	kfree(sorted);
+
+	return 0;
+}
+
+static int initcall_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, initcall_stats_show, NULL);
+}
+
+static const struct file_operations initcall_stats_fops = {
+	.open		= initcall_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init initcall_stats_init(void)
+{
+	debugfs_create_file("initcall_stats", 0400, NULL, NULL,
+			    &initcall_stats_fops);
+
+	return 0;
+}
+late_initcall(initcall_stats_init);
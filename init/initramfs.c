@@ -9,6 +9,9 @@
 #endif
 
 #include <linux/init.h>
+#include <linux/async.h>
+#include <linux/completion.h>
+#include <linux/export.h>
 #include <linux/fs.h>
 #include <linux/slab.h>
 #include <linux/types.h>
@@ -606,7 +609,31 @@ static void __init clean_rootfs(void)
 }
 #endif
 
-static int __init populate_rootfs(void)
+static bool __initdata initramfs_async = true;
+
+static int __init initramfs_async_setup(char *str)
+{
+	strtobool(str, &initramfs_async);
+	return 1;
+}
+__setup("initramfs_async=", initramfs_async_setup);
+
+static DECLARE_COMPLETION(initramfs_done);
+
+/**
+ * wait_for_initramfs - wait until the initramfs has been unpacked
+ *
+ * The initramfs is unpacked in the background while the device initcalls
+ * run. Anything that looks up files in rootfs before init is started,
+ * such as firmware loading and usermode helpers, waits here first.
+ */
+void wait_for_initramfs(void)
+{
+	wait_for_completion(&initramfs_done);
+}
+EXPORT_SYMBOL_GPL(wait_for_initramfs);
+
+static void __init do_populate_rootfs(void *unused, async_cookie_t cookie)
 {
 	/* Load the built in initramfs */
 	char *err = unpack_to_rootfs(__initramfs_start, __initramfs_size);
@@ -653,11 +680,27 @@ static int __init populate_rootfs(void)
 #endif
 	}
 	flush_delayed_fput();
+	complete_all(&initramfs_done);
+
 	/*
 	 * Try loading default modules from initramfs.  This gives
-	 * us a chance to load before device_initcalls.
+	 * us a chance to load before device_initcalls, unless we are
+	 * running alongside them.
 	 */
 	load_default_modules();
+}
+
+/*
+ * Decompressing a large initramfs takes a while, so it runs on another
+ * CPU while the device initcalls probe. kernel_init() synchronizes with
+ * it before the init sections, which hold the unpacking code, are freed.
+ */
+static int __init populate_rootfs(void)
+{
+	if (initramfs_async)
+		async_schedule(do_populate_rootfs, NULL);
+	else
+		do_populate_rootfs(NULL, 0);
 
 	return 0;
 }
@@ -783,17 +783,25 @@ static int __init_or_module do_one_initcall_debug(initcall_t fn)
 int __init_or_module do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	u64 calltime = 0;
 	int ret;
 	char msgbuf[64];
 
 	if (initcall_blacklisted(fn))
 		return -EPERM;
 
+	if (IS_ENABLED(CONFIG_INITCALL_STATS))
+		calltime = ktime_get_ns();
+
 	if (initcall_debug)
 		ret = do_one_initcall_debug(fn);
 	else
 		ret = fn();
 
+	if (IS_ENABLED(CONFIG_INITCALL_STATS))
+		initcall_stats_add(fn, NULL, NULL, ktime_get_ns() - calltime,
+				   ret, false);
+
 	msgbuf[0] = 0;
 
 	if (preempt_count() != count) {
@@ -1038,6 +1046,8 @@ static noinline void __init kernel_init_freeable(void)
 
 	do_basic_setup();
 
+	wait_for_initramfs();
+
 	/* Open the /dev/console on the rootfs, this should never fail */
 	if (sys_open((const char __user *) "/dev/console", O_RDWR, 0) < 0)
 		pr_err("Warning: unable to open an initial console.\n");
@@ -584,6 +584,29 @@ static int set_irq_wake_real(unsigned int irq, unsigned int on)
 	return ret;
 }
 
+/**
+ *	irq_set_thread_priority - set the priority of the irq threads
+ *	@irq:	interrupt to control
+ *	@prio:	SCHED_FIFO priority, 0 selects the default
+ *
+ *	Threaded handlers all run at MAX_USER_RT_PRIO/2 by default, so
+ *	a latency critical device queues behind housekeeping ones on
+ *	the same CPU. This lets platform code rank them. It applies to
+ *	threads created afterwards, so call it before the handler is
+ *	requested.
+ */
+int irq_set_thread_priority(unsigned int irq, unsigned int prio)
+{
+	struct irq_desc *desc = irq_to_desc(irq);
+
+	if (!desc || prio >= MAX_USER_RT_PRIO)
+		return -EINVAL;
+
+	desc->thread_prio = prio;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(irq_set_thread_priority);
+
 /**
  *	irq_set_irq_wake - control irq power management wakeup
  *	@irq:	interrupt to control
@@ -1073,9 +1096,10 @@ static void irq_release_resources(struct irq_desc *desc)
 static int
 setup_irq_thread(struct irqaction *new, unsigned int irq, bool secondary)
 {
+	struct irq_desc *desc = irq_to_desc(irq);
 	struct task_struct *t;
 	struct sched_param param = {
-		.sched_priority = MAX_USER_RT_PRIO/2,
+		.sched_priority = desc->thread_prio ? : MAX_USER_RT_PRIO/2,
 	};
 
 	if (!secondary) {
@@ -1084,7 +1108,8 @@ setup_irq_thread(struct irqaction *new, unsigned int irq, bool secondary)
 	} else {
 		t = kthread_create(irq_thread, new, "irq/%d-s-%s", irq,
 				   new->name);
-		param.sched_priority -= 1;
+		if (param.sched_priority > 1)
+			param.sched_priority -= 1;
 	}
 
 	if (IS_ERR(t))
@@ -750,6 +750,58 @@ static void set_load_weight(struct task_struct *p)
 	load->inv_weight = sched_prio_to_wmult[prio];
 }
 
+#ifdef CONFIG_SCHED_UTIL_MIN
+/*
+ * The value is taken when the task is enqueued, so that the runqueue count
+ * stays right when the task changes groups or the group its value.
+ */
+static inline void util_min_enqueue(struct rq *rq, struct task_struct *p)
+{
+	unsigned int util_min = READ_ONCE(task_group(p)->util_min);
+
+	p->util_min = util_min;
+	if (!util_min)
+		return;
+
+	rq->nr_util_min++;
+	if (util_min <= rq->util_min)
+		return;
+
+	WRITE_ONCE(rq->util_min, util_min);
+
+	/*
+	 * Raise the frequency right away, not at the next tick. The governor
+	 * hooks are per CPU, so a wakeup from another CPU has the target CPU
+	 * reschedule and apply the floor itself.
+	 */
+	if (cpu_of(rq) == smp_processor_id()) {
+		cpufreq_update_util(rq, SCHED_CPUFREQ_UTIL_MIN);
+	} else {
+		rq->util_min_kick = true;
+		resched_curr(rq);
+	}
+}
+
+/* Called with the rq locked, on its own CPU */
+static inline void util_min_apply(struct rq *rq)
+{
+	if (unlikely(rq->util_min_kick)) {
+		rq->util_min_kick = false;
+		cpufreq_update_this_cpu(rq, SCHED_CPUFREQ_UTIL_MIN);
+	}
+}
+
+static inline void util_min_dequeue(struct rq *rq, struct task_struct *p)
+{
+	if (p->util_min && !--rq->nr_util_min)
+		WRITE_ONCE(rq->util_min, 0);
+}
+#else
+static inline void util_min_enqueue(struct rq *rq, struct task_struct *p) { }
+static inline void util_min_dequeue(struct rq *rq, struct task_struct *p) { }
+static inline void util_min_apply(struct rq *rq) { }
+#endif
+
 static inline void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 {
 	if (!(flags & ENQUEUE_NOCLOCK))
@@ -759,6 +811,7 @@ static inline void enqueue_task(struct rq *rq, struct task_struct *p, int flags)
 		sched_info_queued(rq, p);
 
 	p->sched_class->enqueue_task(rq, p, flags);
+	util_min_enqueue(rq, p);
 }
 
 static inline void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
@@ -769,6 +822,7 @@ static inline void dequeue_task(struct rq *rq, struct task_struct *p, int flags)
 	if (!(flags & DEQUEUE_SAVE))
 		sched_info_dequeued(rq, p);
 
+	util_min_dequeue(rq, p);
 	p->sched_class->dequeue_task(rq, p, flags);
 }
 
@@ -3428,6 +3482,7 @@ static void __sched notrace __schedule(bool preempt)
 	next = pick_next_task(rq, prev, &rf);
 	clear_tsk_need_resched(prev);
 	clear_preempt_need_resched();
+	util_min_apply(rq);
 
 	if (likely(prev != next)) {
 		rq->nr_switches++;
@@ -6907,6 +6962,10 @@ cpu_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
 	if (IS_ERR(tg))
 		return ERR_PTR(-ENOMEM);
 
+#ifdef CONFIG_SCHED_UTIL_MIN
+	tg->util_min = parent->util_min;
+#endif
+
 	return &tg->css;
 }
 
@@ -6999,6 +7058,28 @@ static void cpu_cgroup_attach(struct cgroup_taskset *tset)
 		sched_move_task(task);
 }
 
+#ifdef CONFIG_SCHED_UTIL_MIN
+static int cpu_util_min_write_u64(struct cgroup_subsys_state *css,
+				  struct cftype *cftype, u64 util_min)
+{
+	struct task_group *tg = css_tg(css);
+
+	if (tg == &root_task_group || util_min > SCHED_CAPACITY_SCALE)
+		return -EINVAL;
+
+	/* Tasks already runnable pick the new value up when next enqueued */
+	WRITE_ONCE(tg->util_min, util_min);
+
+	return 0;
+}
+
+static u64 cpu_util_min_read_u64(struct cgroup_subsys_state *css,
+				 struct cftype *cft)
+{
+	return css_tg(css)->util_min;
+}
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 static int cpu_shares_write_u64(struct cgroup_subsys_state *css,
 				struct cftype *cftype, u64 shareval)
@@ -7294,6 +7375,13 @@ static struct cftype cpu_files[] = {
 		.write_u64 = cpu_shares_write_u64,
 	},
 #endif
+#ifdef CONFIG_SCHED_UTIL_MIN
+	{
+		.name = "util_min",
+		.read_u64 = cpu_util_min_read_u64,
+		.write_u64 = cpu_util_min_write_u64,
+	},
+#endif
 #ifdef CONFIG_CFS_BANDWIDTH
 	{
 		.name = "cfs_quota_us",
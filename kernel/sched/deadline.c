@@ -1055,6 +1055,93 @@ static void yield_task_dl(struct rq *rq)
 	rq_clock_skip_update(rq, true);
 }
 
+/**
+ * sched_dl_task_align - start the current period of a deadline task now
+ * @p: the SCHED_DEADLINE task
+ *
+ * Moves the start of the current period of @p to now, giving it a deadline
+ * one relative deadline from now. Called at an external event, such as a
+ * vblank, this phase-aligns the periods of @p to that event. Callable from
+ * hard interrupt context.
+ *
+ * The runtime of @p is only refilled, and a throttled (or yielded) @p only
+ * woken, if its previous period has elapsed. Otherwise @p keeps the runtime
+ * it has left, and if that is used up waits for the end of the moved
+ * period. Either way @p never gets more than its runtime per period, as
+ * granted by admission control. For the periods to line up with the event,
+ * the period of @p should be a little shorter than the event interval.
+ *
+ * Return: 0 on success, -ESRCH if @p is exiting, -EINVAL if @p is not a
+ * deadline task.
+ */
+int sched_dl_task_align(struct task_struct *p)
+{
+	struct sched_dl_entity *dl_se = &p->dl;
+	struct rq_flags rf;
+	bool queued, elapsed;
+	struct rq *rq;
+	int ret = 0;
+
+	rq = task_rq_lock(p, &rf);
+
+	if ((p->flags & PF_EXITING) || p->state == TASK_DEAD) {
+		ret = -ESRCH;
+		goto unlock;
+	}
+	if (!dl_task(p) || !dl_prio(p->normal_prio)) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	/*
+	 * Leave boosted tasks alone, as the replenishment timer does. A timer
+	 * callback that is already running ends the period for us.
+	 */
+	if (dl_se->dl_boosted ||
+	    (dl_se->dl_throttled && hrtimer_callback_running(&dl_se->dl_timer)))
+		goto unlock;
+
+	update_rq_clock(rq);
+	if (task_current(rq, p))
+		update_curr_dl(rq);
+
+	elapsed = !dl_time_before(rq_clock(rq), dl_next_period(dl_se));
+
+	if (dl_se->dl_throttled) {
+		if (hrtimer_try_to_cancel(&dl_se->dl_timer) == 1)
+			put_task_struct(p);
+		dl_se->dl_throttled = 0;
+	}
+
+	queued = task_on_rq_queued(p);
+	if (on_dl_rq(dl_se))
+		__dequeue_task_dl(rq, p, 0);
+
+	dl_se->deadline = rq_clock(rq) + dl_se->dl_deadline;
+	if (elapsed) {
+		dl_se->runtime = dl_se->dl_runtime;
+		dl_se->dl_yielded = 0;
+	} else if (dl_runtime_exceeded(dl_se)) {
+		/* Out of runtime until the end of the moved period */
+		start_dl_timer(p);
+		dl_se->dl_throttled = 1;
+	}
+
+	if (queued && !dl_se->dl_throttled) {
+		enqueue_task_dl(rq, p, 0);
+		if (task_current(rq, p) || !dl_task(rq->curr))
+			resched_curr(rq);
+		else
+			check_preempt_curr_dl(rq, p, 0);
+	}
+
+unlock:
+	task_rq_unlock(rq, p, &rf);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(sched_dl_task_align);
+
 #ifdef CONFIG_SMP
 
 static int find_later_rq(struct task_struct *task);
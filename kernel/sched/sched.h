@@ -313,6 +313,11 @@ struct task_group {
 #endif
 
 	struct cfs_bandwidth cfs_bandwidth;
+
+#ifdef CONFIG_SCHED_UTIL_MIN
+	/* schedutil minimum utilization while the group's tasks run */
+	unsigned int util_min;
+#endif
 };
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -653,6 +658,16 @@ struct rq {
 
 	struct cfs_rq cfs;
 	struct rt_rq rt;
+#ifdef CONFIG_SCHED_UTIL_MIN
+	/*
+	 * Highest util_min of the tasks enqueued since the runqueue last had
+	 * none with util_min set, and the number of those tasks.
+	 */
+	unsigned int util_min;
+	unsigned int nr_util_min;
+	/* util_min rose from another CPU, apply it at the next schedule */
+	bool util_min_kick;
+#endif
 	struct dl_rq dl;
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
@@ -2002,6 +2017,18 @@ static inline void cpufreq_update_util(struct rq *rq, unsigned int flags) {}
 static inline void cpufreq_update_this_cpu(struct rq *rq, unsigned int flags) {}
 #endif /* CONFIG_CPU_FREQ */
 
+#ifdef CONFIG_SCHED_UTIL_MIN
+static inline unsigned long rq_util_min(struct rq *rq)
+{
+	return READ_ONCE(rq->util_min);
+}
+#else
+static inline unsigned long rq_util_min(struct rq *rq)
+{
+	return 0;
+}
+#endif
+
 #ifdef arch_scale_freq_capacity
 #ifndef arch_scale_freq_invariant
 #define arch_scale_freq_invariant()	(true)
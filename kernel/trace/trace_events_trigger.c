@@ -1038,10 +1038,15 @@ static struct event_command trigger_traceoff_cmd = {
 };
 
 #ifdef CONFIG_TRACER_SNAPSHOT
+/*
+ * The snapshot is taken in the instance the triggering event belongs to,
+ * which register_snapshot_trigger() stores in private_data. An event in
+ * a small per-subsystem instance then only swaps that instance's buffer.
+ */
 static void
 snapshot_trigger(struct event_trigger_data *data, void *rec)
 {
-	tracing_snapshot();
+	tracing_snapshot_instance(data->private_data);
 }
 
 static void
@@ -1061,9 +1066,12 @@ register_snapshot_trigger(char *glob, struct event_trigger_ops *ops,
 			  struct event_trigger_data *data,
 			  struct trace_event_file *file)
 {
-	int ret = register_trigger(glob, ops, data, file);
+	int ret;
+
+	data->private_data = file->tr;
 
-	if (ret > 0 && tracing_alloc_snapshot() != 0) {
+	ret = register_trigger(glob, ops, data, file);
+	if (ret > 0 && tracing_alloc_snapshot_instance(file->tr) != 0) {
 		unregister_trigger(glob, ops, data, file);
 		ret = 0;
 	}
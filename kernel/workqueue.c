@@ -48,6 +48,10 @@
 #include <linux/nodemask.h>
 #include <linux/moduleparam.h>
 #include <linux/uaccess.h>
+#include <linux/tick.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/timekeeping.h>
 
 #include "workqueue_internal.h"
 
@@ -103,6 +107,7 @@ enum {
 	HIGHPRI_NICE_LEVEL	= MIN_NICE,
 
 	WQ_NAME_LEN		= 24,
+	WQ_LAT_BUCKETS		= 16,		/* up to 16ms and beyond */
 };
 
 /*
@@ -149,6 +154,10 @@ struct worker_pool {
 	unsigned int		flags;		/* X: flags */
 
 	unsigned long		watchdog_ts;	/* L: watchdog timestamp */
+#ifdef CONFIG_WQ_LATENCY_HIST
+	/* queueing latency, bucket n counts [2^(n-1), 2^n) usecs */
+	unsigned long		lat_hist[WQ_LAT_BUCKETS]; /* L */
+#endif
 
 	struct list_head	worklist;	/* L: list of pending works */
 	int			nr_workers;	/* L: total number of workers */
@@ -339,6 +348,8 @@ struct workqueue_struct *system_wq __read_mostly;
 EXPORT_SYMBOL(system_wq);
 struct workqueue_struct *system_highpri_wq __read_mostly;
 EXPORT_SYMBOL_GPL(system_highpri_wq);
+struct workqueue_struct *system_display_wq __read_mostly;
+EXPORT_SYMBOL_GPL(system_display_wq);
 struct workqueue_struct *system_long_wq __read_mostly;
 EXPORT_SYMBOL_GPL(system_long_wq);
 struct workqueue_struct *system_unbound_wq __read_mostly;
@@ -1277,6 +1288,76 @@ fail:
 	return -EAGAIN;
 }
 
+#ifdef CONFIG_WQ_LATENCY_HIST
+/*
+ * The work may run on another CPU than it was queued on, so this needs a
+ * clock that is monotonic across CPUs, unlike local_clock(). The fast
+ * accessor is also fine while timekeeping is suspended.
+ */
+static void wq_latency_queued(struct work_struct *work)
+{
+	work->queued_ns = ktime_get_mono_fast_ns();
+}
+
+/* called with pool->lock held when a worker picks up @work */
+static void wq_latency_account(struct worker_pool *pool,
+			       struct work_struct *work)
+{
+	u64 usecs = div_u64(ktime_get_mono_fast_ns() - work->queued_ns,
+			    NSEC_PER_USEC);
+	unsigned int bucket = usecs ? fls64(usecs) : 0;
+
+	pool->lat_hist[min_t(unsigned int, bucket, WQ_LAT_BUCKETS - 1)]++;
+}
+
+static int wq_latency_show(struct seq_file *m, void *v)
+{
+	struct worker_pool *pool;
+	int pi, i;
+
+	seq_puts(m, "pool cpu nice  <usecs:count>...\n");
+
+	mutex_lock(&wq_pool_mutex);
+	for_each_pool(pool, pi) {
+		seq_printf(m, "%4d %3d %4d ", pool->id, pool->cpu,
+			   pool->attrs->nice);
+		spin_lock_irq(&pool->lock);
+		for (i = 0; i < WQ_LAT_BUCKETS; i++)
+			seq_printf(m, " %lu:%lu", i ? 1UL << i : 1UL,
+				   pool->lat_hist[i]);
+		spin_unlock_irq(&pool->lock);
+		seq_putc(m, '\n');
+	}
+	mutex_unlock(&wq_pool_mutex);
+
+	return 0;
+}
+
+static int wq_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, wq_latency_show, NULL);
+}
+
+static const struct file_operations wq_latency_fops = {
+	.open		= wq_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init wq_latency_debugfs_init(void)
+{
+	debugfs_create_file("workqueue_latency", 0444, NULL, NULL,
+			    &wq_latency_fops);
+	return 0;
+}
+late_initcall(wq_latency_debugfs_init);
+#else
+static inline void wq_latency_queued(struct work_struct *work) { }
+static inline void wq_latency_account(struct worker_pool *pool,
+				      struct work_struct *work) { }
+#endif
+
 /**
  * insert_work - insert a work into a pool
  * @pwq: pwq @work belongs to
@@ -1298,6 +1379,7 @@ static void insert_work(struct pool_workqueue *pwq, struct work_struct *work,
 	/* we own @work, set data and link */
 	set_work_pwq(work, pwq, extra_flags);
 	list_add_tail(&work->entry, head);
+	wq_latency_queued(work);
 	get_pwq(pwq);
 
 	/*
@@ -2061,6 +2143,7 @@ __acquires(&pool->lock)
 	work_color = get_work_color(work);
 
 	list_del_init(&work->entry);
+	wq_latency_account(pool, work);
 
 	/*
 	 * CPU intensive works don't participate in concurrency management.
@@ -5525,6 +5608,17 @@ int __init workqueue_init_early(void)
 
 	BUG_ON(!alloc_cpumask_var(&wq_unbound_cpumask, GFP_KERNEL));
 	cpumask_copy(wq_unbound_cpumask, cpu_possible_mask);
+#ifdef CONFIG_NO_HZ_FULL
+	/*
+	 * Keep unbound work off the full dynticks CPUs from the start, the
+	 * boot CPU always stays a housekeeping CPU.
+	 */
+	if (tick_nohz_full_running) {
+		cpumask_andnot(wq_unbound_cpumask, wq_unbound_cpumask,
+			       tick_nohz_full_mask);
+		cpumask_set_cpu(smp_processor_id(), wq_unbound_cpumask);
+	}
+#endif
 
 	pwq_cache = KMEM_CACHE(pool_workqueue, SLAB_PANIC);
 
@@ -5568,6 +5662,7 @@ int __init workqueue_init_early(void)
 
 	system_wq = alloc_workqueue("events", 0, 0);
 	system_highpri_wq = alloc_workqueue("events_highpri", WQ_HIGHPRI, 0);
+	system_display_wq = alloc_workqueue("events_display", WQ_HIGHPRI, 0);
 	system_long_wq = alloc_workqueue("events_long", 0, 0);
 	system_unbound_wq = alloc_workqueue("events_unbound", WQ_UNBOUND,
 					    WQ_UNBOUND_MAX_ACTIVE);
@@ -5578,7 +5673,8 @@ int __init workqueue_init_early(void)
 	system_freezable_power_efficient_wq = alloc_workqueue("events_freezable_power_efficient",
 					      WQ_FREEZABLE | WQ_POWER_EFFICIENT,
 					      0);
-	BUG_ON(!system_wq || !system_highpri_wq || !system_long_wq ||
+	BUG_ON(!system_wq || !system_highpri_wq || !system_display_wq ||
+	       !system_long_wq ||
 	       !system_unbound_wq || !system_freezable_wq ||
 	       !system_power_efficient_wq ||
 	       !system_freezable_power_efficient_wq);
@@ -361,6 +361,38 @@ void *gen_pool_dma_alloc(struct gen_pool *pool, size_t size, dma_addr_t *dma)
 }
 EXPORT_SYMBOL(gen_pool_dma_alloc);
 
+/**
+ * gen_pool_dma_alloc_align - allocate aligned special memory for DMA usage
+ * @pool: pool to allocate from
+ * @size: number of bytes to allocate from the pool
+ * @dma: dma-view physical address return value.  Use NULL if unneeded.
+ * @align: alignment in bytes of the starting address, a power of 2
+ *
+ * Same as gen_pool_dma_alloc(), with the first-fit algorithm honouring
+ * @align instead of the pool allocation function. Hardware descriptors
+ * usually need more than the pool granularity.
+ */
+void *gen_pool_dma_alloc_align(struct gen_pool *pool, size_t size,
+		dma_addr_t *dma, int align)
+{
+	struct genpool_data_align data = { .align = align };
+	unsigned long vaddr;
+
+	if (!pool)
+		return NULL;
+
+	vaddr = gen_pool_alloc_algo(pool, size, gen_pool_first_fit_align,
+				    &data);
+	if (!vaddr)
+		return NULL;
+
+	if (dma)
+		*dma = gen_pool_virt_to_phys(pool, vaddr);
+
+	return (void *)vaddr;
+}
+EXPORT_SYMBOL(gen_pool_dma_alloc_align);
+
 /**
  * gen_pool_free - free allocated special memory back to the pool
  * @pool: pool to free to
@@ -0,0 +1,194 @@
+/*
+ * Frame buffer drawing benchmark
+ *
+ * Times the fb_ops drawing hooks of a registered frame buffer, which are
+ * the NEON or generic cfb routines depending on the driver and config,
+ * and full frame uploads through the kernel mapping. Each result is
+ * reported in MB/s of pixels touched and in full frames per second.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/fb.h>
+#include <linux/io.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+static unsigned int fb;
+module_param(fb, uint, 0444);
+MODULE_PARM_DESC(fb, "Frame buffer to benchmark (default: 0)");
+
+static unsigned int iterations = 100;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Repetitions of each operation (default: 100)");
+
+#define GLYPH_HEIGHT	16
+
+static void __init test_fb_report(struct fb_info *info, const char *op,
+				  u64 bytes, u64 frames, u64 ns)
+{
+	ns = max_t(u64, ns, 1);
+
+	pr_info("fb%d %ux%u-%u %s: %llu MB/s, %llu.%02llu frames/s\n",
+		info->node, info->var.xres, info->var.yres,
+		info->var.bits_per_pixel, op,
+		div64_u64(bytes * 1000, ns),
+		div64_u64(frames * NSEC_PER_SEC, ns),
+		div64_u64(frames * NSEC_PER_SEC * 100, ns) % 100);
+}
+
+static void __init test_fb_sync(struct fb_info *info)
+{
+	if (info->fbops->fb_sync)
+		info->fbops->fb_sync(info);
+}
+
+static void __init test_fb_fillrect(struct fb_info *info, u32 frame)
+{
+	struct fb_fillrect rect = {
+		.width = info->var.xres,
+		.height = info->var.yres,
+		.rop = ROP_COPY,
+	};
+	unsigned int i;
+	u64 start;
+
+	start = ktime_get_ns();
+	for (i = 0; i < iterations; i++) {
+		rect.color = i & 1 ? 0 : 7;
+		info->fbops->fb_fillrect(info, &rect);
+	}
+	test_fb_sync(info);
+
+	test_fb_report(info, "fillrect", (u64)frame * iterations,
+		       iterations, ktime_get_ns() - start);
+}
+
+/* move the lower part of the screen up by one glyph, as scrolling does */
+static void __init test_fb_copyarea(struct fb_info *info, u32 frame)
+{
+	struct fb_copyarea area = {
+		.sy = GLYPH_HEIGHT,
+		.width = info->var.xres,
+		.height = info->var.yres - GLYPH_HEIGHT,
+	};
+	u64 bytes = (u64)area.height * info->fix.line_length;
+	unsigned int i;
+	u64 start;
+
+	start = ktime_get_ns();
+	for (i = 0; i < iterations; i++)
+		info->fbops->fb_copyarea(info, &area);
+	test_fb_sync(info);
+
+	test_fb_report(info, "copyarea", bytes * iterations,
+		       div_u64(bytes * iterations, frame),
+		       ktime_get_ns() - start);
+}
+
+/* draw a screen full of monochrome glyph rows, as the console does */
+static void __init test_fb_imageblit(struct fb_info *info, u32 frame)
+{
+	struct fb_image image = {
+		.width = info->var.xres & ~7,
+		.height = GLYPH_HEIGHT,
+		.fg_color = 7,
+		.depth = 1,
+	};
+	unsigned int rows = info->var.yres / GLYPH_HEIGHT;
+	unsigned int i, row;
+	u8 *bits;
+	u64 start;
+
+	bits = kmalloc(image.width / 8 * image.height, GFP_KERNEL);
+	if (!bits)
+		return;
+	memset(bits, 0x5a, image.width / 8 * image.height);
+	image.data = bits;
+
+	start = ktime_get_ns();
+	for (i = 0; i < iterations; i++) {
+		for (row = 0; row < rows; row++) {
+			image.dy = row * GLYPH_HEIGHT;
+			info->fbops->fb_imageblit(info, &image);
+		}
+	}
+	test_fb_sync(info);
+
+	test_fb_report(info, "imageblit",
+		       (u64)rows * GLYPH_HEIGHT * info->fix.line_length *
+		       iterations, iterations, ktime_get_ns() - start);
+	kfree(bits);
+}
+
+/* copy a whole frame from system memory, as a software renderer does */
+static void __init test_fb_upload(struct fb_info *info, u32 frame)
+{
+	unsigned int i;
+	u64 start;
+	void *src;
+
+	if (!info->screen_base)
+		return;
+
+	src = vmalloc(frame);
+	if (!src)
+		return;
+	memset(src, 0x3c, frame);
+
+	start = ktime_get_ns();
+	for (i = 0; i < iterations; i++)
+		memcpy_toio(info->screen_base, src, frame);
+
+	test_fb_report(info, "upload", (u64)frame * iterations, iterations,
+		       ktime_get_ns() - start);
+	vfree(src);
+}
+
+static int __init test_fb_init(void)
+{
+	struct fb_info *info;
+	u32 frame;
+
+	if (fb >= FB_MAX || !registered_fb[fb]) {
+		pr_err("no frame buffer %u\n", fb);
+		return -ENODEV;
+	}
+	info = registered_fb[fb];
+
+	if (!lock_fb_info(info))
+		return -ENODEV;
+
+	frame = info->var.yres * info->fix.line_length;
+	if (info->var.yres <= GLYPH_HEIGHT ||
+	    frame > (info->screen_size ? : info->fix.smem_len)) {
+		unlock_fb_info(info);
+		pr_err("fb%u mode too small for the benchmark\n", fb);
+		return -EINVAL;
+	}
+
+	test_fb_fillrect(info, frame);
+	test_fb_copyarea(info, frame);
+	test_fb_imageblit(info, frame);
+	test_fb_upload(info, frame);
+
+	unlock_fb_info(info);
+
+	return 0;
+}
+
+static void __exit test_fb_exit(void)
+{
+}
+
+module_init(test_fb_init);
+module_exit(test_fb_exit);
+
+MODULE_DESCRIPTION("Frame buffer drawing benchmark");
+MODULE_LICENSE("GPL");
@@ -35,6 +35,7 @@
 #include <linux/cma.h>
 #include <linux/highmem.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <trace/events/cma.h>
 
 #include "cma.h"
@@ -129,7 +130,8 @@ static int __init cma_activate_area(struct cma *cma)
 			if (page_zone(pfn_to_page(pfn)) != zone)
 				goto err;
 		}
-		init_cma_reserved_pageblock(pfn_to_page(base_pfn));
+		if (!cma->reserved)
+			init_cma_reserved_pageblock(pfn_to_page(base_pfn));
 	} while (--i);
 
 	mutex_init(&cma->lock);
@@ -221,6 +223,21 @@ int __init cma_init_reserved_mem(phys_addr_t base, phys_addr_t size,
 	return 0;
 }
 
+/**
+ * cma_set_reserved() - keep a contiguous area for its own allocations
+ * @cma: Contiguous memory region created but not yet activated.
+ *
+ * The pages of a reserved area are not lent to the page allocator for
+ * movable allocations while they are free. cma_alloc() then never has to
+ * migrate anything and cannot fail because a page is pinned, at the cost
+ * of the memory being unusable for anything else. Must be called before
+ * the areas are activated at core_initcall time.
+ */
+void __init cma_set_reserved(struct cma *cma)
+{
+	cma->reserved = true;
+}
+
 /**
  * cma_declare_contiguous() - reserve custom contiguous area
  * @base: Base address of the reserved area optional, use 0 for any
@@ -405,6 +422,7 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align,
 	unsigned long bitmap_maxno, bitmap_no, bitmap_count;
 	struct page *page = NULL;
 	int ret = -ENOMEM;
+	u64 start_ns;
 
 	if (!cma || !cma->count)
 		return NULL;
@@ -423,6 +441,8 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align,
 	if (bitmap_count > bitmap_maxno)
 		return NULL;
 
+	start_ns = ktime_get_ns();
+
 	for (;;) {
 		mutex_lock(&cma->lock);
 		bitmap_no = bitmap_find_next_zero_area_off(cma->bitmap,
@@ -441,6 +461,13 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align,
 		mutex_unlock(&cma->lock);
 
 		pfn = cma->base_pfn + (bitmap_no << cma->order_per_bit);
+		if (cma->reserved) {
+			/* Nothing to migrate, the pages were never free */
+			page = pfn_to_page(pfn);
+			ret = 0;
+			break;
+		}
+
 		mutex_lock(&cma_mutex);
 		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA,
 					 gfp_mask);
@@ -461,6 +488,7 @@ struct page *cma_alloc(struct cma *cma, size_t count, unsigned int align,
 	}
 
 	trace_cma_alloc(pfn, page, count, align);
+	cma_debug_alloc_done(cma, ktime_get_ns() - start_ns, !page);
 
 	if (ret) {
 		pr_info("%s: alloc failed, req-size: %zu pages, ret: %d\n",
@@ -498,7 +526,8 @@ bool cma_release(struct cma *cma, const struct page *pages, unsigned int count)
 
 	VM_BUG_ON(pfn + count > cma->base_pfn + cma->count);
 
-	free_contig_range(pfn, count);
+	if (!cma->reserved)
+		free_contig_range(pfn, count);
 	cma_clear_bitmap(cma, pfn, count);
 	trace_cma_release(pfn, pages, count);
 
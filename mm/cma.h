@@ -1,6 +1,9 @@
 #ifndef __MM_CMA_H__
 #define __MM_CMA_H__
 
+/* Allocation latencies below 1us, 2us, ... 16ms, and all longer ones */
+#define CMA_ALLOC_LATENCY_BUCKETS	16
+
 struct cma {
 	unsigned long   base_pfn;
 	unsigned long   count;
@@ -10,8 +13,11 @@ struct cma {
 #ifdef CONFIG_CMA_DEBUGFS
 	struct hlist_head mem_head;
 	spinlock_t mem_head_lock;
+	atomic_long_t alloc_latency[CMA_ALLOC_LATENCY_BUCKETS];
+	atomic_long_t alloc_failed;
 #endif
 	const char *name;
+	bool reserved;	/* never handed to the page allocator */
 };
 
 extern struct cma cma_areas[MAX_CMA_AREAS];
@@ -22,4 +28,12 @@ static inline unsigned long cma_bitmap_maxno(struct cma *cma)
 	return cma->count >> cma->order_per_bit;
 }
 
+#ifdef CONFIG_CMA_DEBUGFS
+void cma_debug_alloc_done(struct cma *cma, u64 ns, bool failed);
+#else
+static inline void cma_debug_alloc_done(struct cma *cma, u64 ns, bool failed)
+{
+}
+#endif
+
 #endif
@@ -9,6 +9,8 @@
 #include <linux/cma.h>
 #include <linux/list.h>
 #include <linux/kernel.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/mm_types.h>
 
@@ -161,13 +163,55 @@ static int cma_alloc_write(void *data, u64 val)
 }
 DEFINE_SIMPLE_ATTRIBUTE(cma_alloc_fops, NULL, cma_alloc_write, "%llu\n");
 
+void cma_debug_alloc_done(struct cma *cma, u64 ns, bool failed)
+{
+	unsigned long us = div_u64(ns, NSEC_PER_USEC);
+	unsigned int i;
+
+	if (failed) {
+		atomic_long_inc(&cma->alloc_failed);
+		return;
+	}
+
+	i = us ? ilog2(us) + 1 : 0;
+	atomic_long_inc(&cma->alloc_latency[min_t(unsigned int, i,
+					    CMA_ALLOC_LATENCY_BUCKETS - 1)]);
+}
+
+static int cma_alloc_latency_show(struct seq_file *m, void *v)
+{
+	struct cma *cma = m->private;
+	int i;
+
+	for (i = 0; i < CMA_ALLOC_LATENCY_BUCKETS - 1; i++)
+		seq_printf(m, "<%8luus %lu\n", 1UL << i,
+			   atomic_long_read(&cma->alloc_latency[i]));
+	seq_printf(m, ">=%7luus %lu\n", 1UL << i,
+		   atomic_long_read(&cma->alloc_latency[i]));
+	seq_printf(m, "failed     %lu\n", atomic_long_read(&cma->alloc_failed));
+
+	return 0;
+}
+
+static int cma_alloc_latency_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, cma_alloc_latency_show, inode->i_private);
+}
+
+static const struct file_operations cma_alloc_latency_fops = {
+	.open		= cma_alloc_latency_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static void cma_debugfs_add_one(struct cma *cma, int idx)
 {
 	struct dentry *tmp;
-	char name[16];
+	char name[32];
 	int u32s;
 
-	sprintf(name, "cma-%s", cma->name);
+	snprintf(name, sizeof(name), "cma-%s", cma->name);
 
 	tmp = debugfs_create_dir(name, cma_debugfs_root);
 
@@ -185,6 +229,9 @@ static void cma_debugfs_add_one(struct cma *cma, int idx)
 				&cma->order_per_bit, &cma_debugfs_fops);
 	debugfs_create_file("used", S_IRUGO, tmp, cma, &cma_used_fops);
 	debugfs_create_file("maxchunk", S_IRUGO, tmp, cma, &cma_maxchunk_fops);
+	debugfs_create_file("alloc_latency", S_IRUGO, tmp, cma,
+			    &cma_alloc_latency_fops);
+	debugfs_create_bool("reserved", S_IRUGO, tmp, &cma->reserved);
 
 	u32s = DIV_ROUND_UP(cma_bitmap_maxno(cma), BITS_PER_BYTE * sizeof(u32));
 	debugfs_create_u32_array("bitmap", S_IRUGO, tmp, (u32*)cma->bitmap, u32s);
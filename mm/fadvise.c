@@ -114,6 +114,18 @@ SYSCALL_DEFINE4(fadvise64_64, int, fd, loff_t, offset, loff_t, len, int, advice)
 		break;
 	case POSIX_FADV_NOREUSE:
 		break;
+	case POSIX_FADV_KEEP_RESIDENT:
+	case POSIX_FADV_NOKEEP_RESIDENT:
+		/* Outlives the file descriptor, like mlock it needs privileges */
+		if (!capable(CAP_IPC_LOCK)) {
+			ret = -EPERM;
+			break;
+		}
+		if (advice == POSIX_FADV_KEEP_RESIDENT)
+			mapping_set_keep_resident(mapping);
+		else
+			mapping_clear_keep_resident(mapping);
+		break;
 	case POSIX_FADV_DONTNEED:
 		if (!inode_write_congested(mapping->host))
 			__filemap_fdatawrite_range(mapping, offset, endbyte,
@@ -67,6 +67,9 @@ static inline unsigned long ra_submit(struct file_ra_state *ra,
 					ra->start, ra->size, ra->async_size);
 }
 
+void page_cache_readahead_nowait(struct file *filp, struct page *page,
+		pgoff_t offset, unsigned long req_size);
+
 /*
  * Turn a non-refcounted page (->_refcount == 0) into refcounted with
  * a count of one.
@@ -826,6 +826,9 @@ static bool hugepage_vma_check(struct vm_area_struct *vma)
 	}
 	if (!vma->anon_vma || vma->vm_ops)
 		return false;
+	/* A collapse could make wprotect tracked ptes writable */
+	if (userfaultfd_wp(vma))
+		return false;
 	if (is_vma_temporary_stack(vma))
 		return false;
 	return !(vma->vm_flags & VM_NO_KHUGEPAGED);
@@ -105,6 +105,14 @@ static long madvise_behavior(struct vm_area_struct *vma,
 		break;
 	case MADV_HUGEPAGE:
 	case MADV_NOHUGEPAGE:
+		if (IS_ENABLED(CONFIG_ARCH_HAS_PFNMAP_HUGEPAGE) &&
+		    (vma->vm_flags & VM_PFNMAP)) {
+			/* Only the page tables change, not the vma */
+			error = pfnmap_hugepage_madvise(vma, start, end,
+							behavior);
+			*prev = vma;
+			goto out;
+		}
 		error = hugepage_madvise(vma, &new_flags, behavior);
 		if (error) {
 			/*
@@ -681,7 +689,8 @@ madvise_behavior_valid(int behavior)
 	case MADV_MERGEABLE:
 	case MADV_UNMERGEABLE:
 #endif
-#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) || \
+    defined(CONFIG_ARCH_HAS_PFNMAP_HUGEPAGE)
 	case MADV_HUGEPAGE:
 	case MADV_NOHUGEPAGE:
 #endif
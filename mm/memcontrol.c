@@ -3247,6 +3247,49 @@ static int mem_cgroup_swappiness_write(struct cgroup_subsys_state *css,
 	return 0;
 }
 
+#ifdef CONFIG_ZSWAP
+static u64 mem_cgroup_zswap_skip_read(struct cgroup_subsys_state *css,
+				      struct cftype *cft)
+{
+	return mem_cgroup_from_css(css)->zswap_skip;
+}
+
+static int mem_cgroup_zswap_skip_write(struct cgroup_subsys_state *css,
+				       struct cftype *cft, u64 val)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(css);
+
+	/* Root pages are everyone's, the knob is for the groups below it */
+	if (!css->parent || val > 1)
+		return -EINVAL;
+
+	memcg->zswap_skip = val;
+
+	return 0;
+}
+
+/**
+ * mem_cgroup_zswap_skip - check if a page should bypass zswap
+ * @page: page being swapped out
+ *
+ * Pages of a cgroup with memory.zswap_skip set go to the swap device
+ * directly, so that reclaim on their behalf never compresses anything.
+ */
+bool mem_cgroup_zswap_skip(struct page *page)
+{
+	struct mem_cgroup *memcg;
+
+	VM_BUG_ON_PAGE(!PageLocked(page), page);
+
+	if (mem_cgroup_disabled())
+		return false;
+
+	memcg = page->mem_cgroup;
+
+	return memcg && READ_ONCE(memcg->zswap_skip);
+}
+#endif
+
 static void __mem_cgroup_threshold(struct mem_cgroup *memcg, bool swap)
 {
 	struct mem_cgroup_threshold_ary *t;
@@ -3960,6 +4003,13 @@ static struct cftype mem_cgroup_legacy_files[] = {
 		.read_u64 = mem_cgroup_swappiness_read,
 		.write_u64 = mem_cgroup_swappiness_write,
 	},
+#ifdef CONFIG_ZSWAP
+	{
+		.name = "zswap_skip",
+		.read_u64 = mem_cgroup_zswap_skip_read,
+		.write_u64 = mem_cgroup_zswap_skip_write,
+	},
+#endif
 	{
 		.name = "move_charge_at_immigrate",
 		.read_u64 = mem_cgroup_move_charge_read,
@@ -4222,6 +4272,9 @@ mem_cgroup_css_alloc(struct cgroup_subsys_state *parent_css)
 	if (parent) {
 		memcg->swappiness = mem_cgroup_swappiness(parent);
 		memcg->oom_kill_disable = parent->oom_kill_disable;
+#ifdef CONFIG_ZSWAP
+		memcg->zswap_skip = parent->zswap_skip;
+#endif
 	}
 	if (parent && parent->use_hierarchy) {
 		memcg->use_hierarchy = true;
@@ -2519,6 +2519,15 @@ static int do_wp_page(struct vm_fault *vmf)
 {
 	struct vm_area_struct *vma = vmf->vma;
 
+	/*
+	 * Report the write to a write protected page. It stays protected,
+	 * and the write is reported again, until userland unprotects it.
+	 */
+	if (userfaultfd_wp_protected(vma, vmf->address)) {
+		pte_unmap_unlock(vmf->pte, vmf->ptl);
+		return handle_userfault(vmf, VM_UFFD_WP);
+	}
+
 	vmf->page = vm_normal_page(vma, vmf->address, vmf->orig_pte);
 	if (!vmf->page) {
 		/*
@@ -2788,7 +2797,10 @@ int do_swap_page(struct vm_fault *vmf)
 	inc_mm_counter_fast(vma->vm_mm, MM_ANONPAGES);
 	dec_mm_counter_fast(vma->vm_mm, MM_SWAPENTS);
 	pte = mk_pte(page, vma->vm_page_prot);
-	if ((vmf->flags & FAULT_FLAG_WRITE) && reuse_swap_page(page, NULL)) {
+	/* A write protected page stays readonly for do_wp_page() below */
+	if ((vmf->flags & FAULT_FLAG_WRITE) &&
+	    !userfaultfd_wp_protected(vma, vmf->address) &&
+	    reuse_swap_page(page, NULL)) {
 		pte = maybe_mkwrite(pte_mkdirty(pte), vma);
 		vmf->flags &= ~FAULT_FLAG_WRITE;
 		ret |= VM_FAULT_WRITE;
@@ -3602,6 +3614,10 @@ static int create_huge_pmd(struct vm_fault *vmf)
 
 static int wp_huge_pmd(struct vm_fault *vmf, pmd_t orig_pmd)
 {
+	/* wprotect tracking reports writes at pte level */
+	if (userfaultfd_wp(vmf->vma))
+		goto split;
+
 	if (vma_is_anonymous(vmf->vma))
 		return do_huge_pmd_wp_page(vmf, orig_pmd);
 	if (vmf->vma->vm_ops->huge_fault)
@@ -3609,6 +3625,7 @@ static int wp_huge_pmd(struct vm_fault *vmf, pmd_t orig_pmd)
 
 	/* COW handled on pte level: split pmd */
 	VM_BUG_ON_VMA(vmf->vma->vm_flags & VM_SHARED, vmf->vma);
+split:
 	__split_huge_pmd(vmf->vma, vmf->pmd, vmf->address, false, NULL);
 
 	return VM_FAULT_FALLBACK;
@@ -19,6 +19,8 @@
 #include <linux/syscalls.h>
 #include <linux/file.h>
 #include <linux/mm_inline.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include "internal.h"
 
@@ -278,6 +280,22 @@ static unsigned long get_next_ra_size(struct file_ra_state *ra,
 	return min(newsize, max);
 }
 
+/*
+ * With read_ahead_stream_kb set on the bdi, a stream that keeps consuming
+ * its readahead windows fully may go past read_ahead_kb, up to the stream
+ * limit, and ramps up by 4 each time. Storage like SD cards only reaches
+ * its bandwidth with requests far larger than the default window.
+ */
+static unsigned long get_stream_ra_size(struct file_ra_state *ra,
+					struct backing_dev_info *bdi,
+					unsigned long max_pages)
+{
+	if (!bdi->ra_stream_pages)
+		return get_next_ra_size(ra, max_pages);
+
+	return min(4 * ra->size, max(max_pages, bdi->ra_stream_pages));
+}
+
 /*
  * On-demand readahead design.
  *
@@ -402,7 +420,7 @@ ondemand_readahead(struct address_space *mapping,
 	if ((offset == (ra->start + ra->size - ra->async_size) ||
 	     offset == (ra->start + ra->size))) {
 		ra->start += ra->size;
-		ra->size = get_next_ra_size(ra, max_pages);
+		ra->size = get_stream_ra_size(ra, bdi, max_pages);
 		ra->async_size = ra->size;
 		goto readit;
 	}
@@ -455,8 +473,14 @@ ondemand_readahead(struct address_space *mapping,
 
 	/*
 	 * standalone, small random read
-	 * Read as is, and do not pollute the readahead state.
+	 * Read as is, and do not pollute the readahead state. A stream
+	 * window is dropped though, to ramp up again from this read.
 	 */
+	if (bdi->ra_stream_pages && ra->size > max_pages) {
+		ra->start = offset;
+		ra->size = req_size;
+		ra->async_size = 0;
+	}
 	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
 
 initial_readahead:
@@ -555,6 +579,80 @@ page_cache_async_readahead(struct address_space *mapping,
 }
 EXPORT_SYMBOL_GPL(page_cache_async_readahead);
 
+struct readahead_work {
+	struct work_struct	work;
+	struct file		*filp;
+	pgoff_t			offset;
+	unsigned long		req_size;
+	bool			hit_readahead_marker;
+};
+
+static void readahead_workfn(struct work_struct *work)
+{
+	struct readahead_work *rw = container_of(work, struct readahead_work,
+						 work);
+	struct file *filp = rw->filp;
+
+	if (rw->hit_readahead_marker)
+		ondemand_readahead(filp->f_mapping, &filp->f_ra, filp, true,
+				   rw->offset, rw->req_size);
+	else
+		page_cache_sync_readahead(filp->f_mapping, &filp->f_ra, filp,
+					  rw->offset, rw->req_size);
+
+	atomic_set(&filp->f_ra.nowait_queued, 0);
+	fput(filp);
+	kfree(rw);
+}
+
+/**
+ * page_cache_readahead_nowait - readahead for a read that must not block
+ * @filp: the file being read
+ * @page: the page with PG_readahead set at @offset, or NULL on a cache miss
+ * @offset: start offset into the file, in pagecache page-sized units
+ * @req_size: hint: total size of the read, in pagecache pages
+ *
+ * Allocating pages and ->readpages() may both sleep, and some filesystems
+ * decompress or decrypt right in ->readpages(), so the readahead that
+ * page_cache_sync_readahead() or page_cache_async_readahead() would do is
+ * handed to a workqueue. Only one such readahead is queued per file at a
+ * time, so a reader polling on a miss does not queue it over and over.
+ * Nothing is started while one is queued, or if memory is short; the caller
+ * will try again.
+ */
+void page_cache_readahead_nowait(struct file *filp, struct page *page,
+		pgoff_t offset, unsigned long req_size)
+{
+	struct readahead_work *rw;
+
+	if (!filp->f_ra.ra_pages)
+		return;
+
+	/* Same bit is used for PG_readahead and PG_reclaim */
+	if (page && PageWriteback(page))
+		return;
+
+	/* Leave the marker for the retry if readahead is already queued */
+	if (atomic_cmpxchg(&filp->f_ra.nowait_queued, 0, 1))
+		return;
+
+	rw = kmalloc(sizeof(*rw), GFP_NOWAIT | __GFP_NOWARN);
+	if (!rw) {
+		atomic_set(&filp->f_ra.nowait_queued, 0);
+		return;
+	}
+
+	if (page)
+		ClearPageReadahead(page);
+
+	INIT_WORK(&rw->work, readahead_workfn);
+	rw->filp = get_file(filp);
+	rw->offset = offset;
+	rw->req_size = req_size;
+	rw->hit_readahead_marker = page != NULL;
+	queue_work(system_unbound_wq, &rw->work);
+}
+
 static ssize_t
 do_readahead(struct address_space *mapping, struct file *filp,
 	     pgoff_t index, unsigned long nr)
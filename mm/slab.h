@@ -99,6 +99,7 @@ extern void create_boot_cache(struct kmem_cache *, const char *name,
 			size_t size, unsigned long flags);
 
 int slab_unmergeable(struct kmem_cache *s);
+extern unsigned int slab_merge_slack;
 struct kmem_cache *find_mergeable(size_t size, size_t align,
 		unsigned long flags, const char *name, void (*ctor)(void *));
 #ifndef CONFIG_SLOB
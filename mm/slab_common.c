@@ -63,6 +63,12 @@ __setup_param("slub_nomerge", slub_nomerge, setup_slab_nomerge, 0);
 
 __setup("slab_nomerge", setup_slab_nomerge);
 
+/*
+ * How much bigger, in 1/16th of its object size, a cache may be than the
+ * one merged into it. By default only the alignment to a word differs.
+ */
+unsigned int slab_merge_slack __read_mostly;
+
 /*
  * Determine the size of a slab object
  */
@@ -317,7 +323,8 @@ struct kmem_cache *find_mergeable(size_t size, size_t align,
 		if ((s->size & ~(align - 1)) != s->size)
 			continue;
 
-		if (s->size - size >= sizeof(void *))
+		if (s->size - size >= max_t(size_t, sizeof(void *),
+					    s->size * slab_merge_slack / 16))
 			continue;
 
 		if (IS_ENABLED(CONFIG_SLAB) && align &&
@@ -34,6 +34,7 @@
 #include <linux/stacktrace.h>
 #include <linux/prefetch.h>
 #include <linux/memcontrol.h>
+#include <linux/debugfs.h>
 
 #include <trace/events/kmem.h>
 
@@ -3178,6 +3179,15 @@ static int slub_min_order;
 static int slub_max_order = PAGE_ALLOC_COSTLY_ORDER;
 static int slub_min_objects;
 
+/*
+ * With slub_compact the partial slabs kept around per node and per cpu are
+ * cut down, by more on smaller systems, and caches of nearly the same size
+ * are merged. That trades some allocator speed for memory on small-RAM
+ * devices, the per cpu slab fast path itself is left as it is.
+ */
+static bool slub_compact;
+static unsigned int slub_compact_shift __read_mostly;
+
 /*
  * Calculate the order of allocation given an slab object size.
  *
@@ -3403,10 +3413,10 @@ static int init_kmem_cache_nodes(struct kmem_cache *s)
 
 static void set_min_partial(struct kmem_cache *s, unsigned long min)
 {
-	if (min < MIN_PARTIAL)
-		min = MIN_PARTIAL;
-	else if (min > MAX_PARTIAL)
-		min = MAX_PARTIAL;
+	if (min < MIN_PARTIAL >> slub_compact_shift)
+		min = MIN_PARTIAL >> slub_compact_shift;
+	else if (min > MAX_PARTIAL >> slub_compact_shift)
+		min = MAX_PARTIAL >> slub_compact_shift;
 	s->min_partial = min;
 }
 
@@ -3595,6 +3605,7 @@ static int kmem_cache_open(struct kmem_cache *s, unsigned long flags)
 		s->cpu_partial = 13;
 	else
 		s->cpu_partial = 30;
+	s->cpu_partial >>= slub_compact_shift;
 
 #ifdef CONFIG_NUMA
 	s->remote_node_defrag_ratio = 1000;
@@ -3725,6 +3736,15 @@ static int __init setup_slub_min_objects(char *str)
 
 __setup("slub_min_objects=", setup_slub_min_objects);
 
+static int __init setup_slub_compact(char *str)
+{
+	slub_compact = true;
+
+	return 1;
+}
+
+__setup("slub_compact", setup_slub_compact);
+
 void *__kmalloc(size_t size, gfp_t flags)
 {
 	struct kmem_cache *s;
@@ -4152,6 +4172,19 @@ static struct kmem_cache * __init bootstrap(struct kmem_cache *static_cache)
 	return s;
 }
 
+static void __init slub_compact_init(void)
+{
+	unsigned long ram_mb = totalram_pages >> (20 - PAGE_SHIFT);
+
+	/* Up to 256 MB the partial limits go down to a quarter, else half */
+	slub_compact_shift = ram_mb <= 256 ? 2 : 1;
+	/* Merge caches up to 1/16th (1/8th) of the object size apart */
+	slab_merge_slack = slub_compact_shift;
+
+	pr_info("SLUB: compact, %lu MB, partial limits >> %u\n",
+		ram_mb, slub_compact_shift);
+}
+
 void __init kmem_cache_init(void)
 {
 	static __initdata struct kmem_cache boot_kmem_cache,
@@ -4160,6 +4193,9 @@ void __init kmem_cache_init(void)
 	if (debug_guardpage_minorder())
 		slub_max_order = 0;
 
+	if (slub_compact)
+		slub_compact_init();
+
 	kmem_cache_node = &boot_kmem_cache_node;
 	kmem_cache = &boot_kmem_cache;
 
@@ -5842,3 +5878,79 @@ ssize_t slabinfo_write(struct file *file, const char __user *buffer,
 	return -EIO;
 }
 #endif /* CONFIG_SLABINFO */
+
+#if defined(CONFIG_SLUB_DEBUG) && defined(CONFIG_DEBUG_FS)
+/*
+ * debugfs/slub_waste: the memory each cache holds without an object in it.
+ * free are the free objects of the node partial lists, cpu_free those of the
+ * per cpu partial lists (approximate), pad the space between the object and
+ * the slot it takes, tail the end of each slab no object fits in. The free
+ * objects of the per cpu slabs are not counted.
+ */
+static int slub_waste_show(struct seq_file *m, void *v)
+{
+	unsigned long total = 0;
+	struct kmem_cache *s;
+
+	seq_puts(m, "# name               objsize size    slabs  objects   "
+		 "free   cpu_free   pad        tail       wasted\n");
+
+	mutex_lock(&slab_mutex);
+	list_for_each_entry(s, &slab_caches, list) {
+		unsigned long nr_slabs = 0, nr_objs = 0, nr_free = 0;
+		unsigned long cpu_free = 0, inuse, pad, tail, wasted;
+		struct kmem_cache_node *n;
+		int node, cpu;
+
+		for_each_kmem_cache_node(s, node, n) {
+			nr_slabs += node_nr_slabs(n);
+			nr_objs += node_nr_objs(n);
+			nr_free += count_partial(n, count_free);
+		}
+
+		for_each_online_cpu(cpu) {
+			struct page *page;
+
+			page = READ_ONCE(per_cpu_ptr(s->cpu_slab, cpu)->partial);
+			if (page)
+				cpu_free += READ_ONCE(page->pobjects);
+		}
+
+		inuse = nr_objs - min(nr_objs, nr_free + cpu_free);
+		pad = inuse * (s->size - s->object_size);
+		tail = nr_slabs * ((PAGE_SIZE << oo_order(s->oo)) -
+				   oo_objects(s->oo) * s->size);
+		wasted = (nr_free + cpu_free) * s->size + pad + tail;
+		total += wasted;
+
+		seq_printf(m, "%-20s %7d %7d %6lu %8lu %6lu %10lu %10lu %10lu %12lu\n",
+			   s->name, s->object_size, s->size, nr_slabs, nr_objs,
+			   nr_free, cpu_free, pad, tail, wasted);
+	}
+	mutex_unlock(&slab_mutex);
+
+	seq_printf(m, "# total wasted %lu kB\n", total >> 10);
+
+	return 0;
+}
+
+static int slub_waste_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, slub_waste_show, NULL);
+}
+
+static const struct file_operations slub_waste_fops = {
+	.open		= slub_waste_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init slub_waste_init(void)
+{
+	debugfs_create_file("slub_waste", 0400, NULL, NULL, &slub_waste_fops);
+
+	return 0;
+}
+late_initcall(slub_waste_init);
+#endif /* CONFIG_SLUB_DEBUG && CONFIG_DEBUG_FS */
@@ -558,3 +558,74 @@ ssize_t mfill_zeropage(struct mm_struct *dst_mm, unsigned long start,
 {
 	return __mcopy_atomic(dst_mm, start, 0, len, true);
 }
+
+static int mwriteprotect_pte(pte_t *pte, unsigned long addr,
+			     unsigned long next, struct mm_walk *walk)
+{
+	if (pte_present(*pte))
+		userfaultfd_wp_set(walk->vma, addr);
+	return 0;
+}
+
+/*
+ * Private anonymous memory is mapped readonly by vm_page_prot and only
+ * made writable by the write faults, so resetting the ptes to
+ * vm_page_prot write protects the range: the next write to each page
+ * goes through do_wp_page(), which reports it if the page is marked.
+ * Pages not in memory yet are not marked, a write to them is a missing
+ * fault instead. Unprotecting drops the marks.
+ */
+int mwriteprotect_range(struct mm_struct *dst_mm, unsigned long start,
+			unsigned long len, bool enable_wp)
+{
+	struct vm_area_struct *dst_vma;
+	struct mm_walk walk = {
+		.pte_entry = mwriteprotect_pte,
+		.mm = dst_mm,
+	};
+	int err;
+
+	/*
+	 * Sanitize the command parameters:
+	 */
+	BUG_ON(start & ~PAGE_MASK);
+	BUG_ON(len & ~PAGE_MASK);
+
+	/* Does the address range wrap, or is the span zero-sized? */
+	BUG_ON(start + len <= start);
+
+	down_read(&dst_mm->mmap_sem);
+
+	/*
+	 * Make sure the range is fully within a single existing vma
+	 * registered for wprotect tracking.
+	 */
+	err = -ENOENT;
+	dst_vma = find_vma(dst_mm, start);
+	if (!dst_vma || !userfaultfd_wp(dst_vma))
+		goto out_unlock;
+	if (start < dst_vma->vm_start ||
+	    start + len > dst_vma->vm_end)
+		goto out_unlock;
+
+	err = -EINVAL;
+	if (!vma_is_anonymous(dst_vma))
+		goto out_unlock;
+
+	if (!enable_wp) {
+		userfaultfd_wp_clear(dst_vma, start, start + len);
+		err = 0;
+		goto out_unlock;
+	}
+
+	/* Mark the pages before they fault on the readonly ptes */
+	err = userfaultfd_wp_prepare(dst_vma, start, start + len);
+	if (err)
+		goto out_unlock;
+	walk_page_range(start, start + len, &walk);
+	change_protection(dst_vma, start, start + len, dst_vma->vm_page_prot,
+			  0, 0);
+out_unlock:
+	up_read(&dst_mm->mmap_sem);
+	return err;
+}
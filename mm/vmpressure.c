@@ -70,6 +70,16 @@ static const unsigned int vmpressure_level_critical = 95;
  */
 static const unsigned int vmpressure_level_critical_prio = ilog2(100 / 10);
 
+/*
+ * The levels above are only known once reclaim is running, which is late
+ * for a device that cannot afford direct reclaim at all. A "headroom=<kB>"
+ * event instead fires as soon as the free memory above the high watermarks
+ * of all zones falls below the given size, before kswapd even wakes up.
+ * It is checked every vmpressure_wmark_interval while such events exist,
+ * and fires again once the headroom was back up by an eighth.
+ */
+static const unsigned long vmpressure_wmark_interval = HZ / 20;
+
 static struct vmpressure *work_to_vmpressure(struct work_struct *work)
 {
 	return container_of(work, struct vmpressure, work);
@@ -326,6 +336,112 @@ void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio)
 	vmpressure(gfp, memcg, true, vmpressure_win, 0);
 }
 
+struct vmpressure_wmark_event {
+	struct eventfd_ctx *efd;
+	struct mem_cgroup *memcg;
+	unsigned long headroom;
+	bool signalled;
+	struct list_head node;
+};
+
+static LIST_HEAD(vmpressure_wmark_events);
+static DEFINE_MUTEX(vmpressure_wmark_lock);
+
+static void vmpressure_wmark_fn(struct work_struct *work);
+static DECLARE_DEFERRABLE_WORK(vmpressure_wmark_work, vmpressure_wmark_fn);
+
+static unsigned long vmpressure_headroom(void)
+{
+	unsigned long headroom = 0;
+	unsigned long free, high;
+	struct zone *zone;
+
+	for_each_populated_zone(zone) {
+		free = zone_page_state(zone, NR_FREE_PAGES);
+		high = high_wmark_pages(zone);
+		if (free > high)
+			headroom += free - high;
+	}
+
+	return headroom;
+}
+
+static void vmpressure_wmark_fn(struct work_struct *work)
+{
+	struct vmpressure_wmark_event *ev;
+	unsigned long headroom;
+
+	mutex_lock(&vmpressure_wmark_lock);
+
+	headroom = vmpressure_headroom();
+	list_for_each_entry(ev, &vmpressure_wmark_events, node) {
+		if (headroom < ev->headroom) {
+			if (!ev->signalled)
+				eventfd_signal(ev->efd, 1);
+			ev->signalled = true;
+		} else if (headroom >= ev->headroom + ev->headroom / 8) {
+			ev->signalled = false;
+		}
+	}
+
+	if (!list_empty(&vmpressure_wmark_events))
+		schedule_delayed_work(&vmpressure_wmark_work,
+				      vmpressure_wmark_interval);
+
+	mutex_unlock(&vmpressure_wmark_lock);
+}
+
+static int vmpressure_register_wmark(struct mem_cgroup *memcg,
+				     struct eventfd_ctx *eventfd,
+				     const char *args)
+{
+	struct vmpressure_wmark_event *ev;
+	unsigned long kbytes;
+	int ret;
+
+	ret = kstrtoul(args, 10, &kbytes);
+	if (ret)
+		return ret;
+	if (!(kbytes >> (PAGE_SHIFT - 10)))
+		return -EINVAL;
+
+	ev = kzalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return -ENOMEM;
+
+	ev->efd = eventfd;
+	ev->memcg = memcg;
+	ev->headroom = kbytes >> (PAGE_SHIFT - 10);
+
+	mutex_lock(&vmpressure_wmark_lock);
+	if (list_empty(&vmpressure_wmark_events))
+		schedule_delayed_work(&vmpressure_wmark_work, 0);
+	list_add(&ev->node, &vmpressure_wmark_events);
+	mutex_unlock(&vmpressure_wmark_lock);
+
+	return 0;
+}
+
+static bool vmpressure_unregister_wmark(struct mem_cgroup *memcg,
+					struct eventfd_ctx *eventfd)
+{
+	struct vmpressure_wmark_event *ev;
+	bool found = false;
+
+	mutex_lock(&vmpressure_wmark_lock);
+	list_for_each_entry(ev, &vmpressure_wmark_events, node) {
+		if (ev->efd != eventfd || ev->memcg != memcg)
+			continue;
+		list_del(&ev->node);
+		kfree(ev);
+		found = true;
+		break;
+	}
+	mutex_unlock(&vmpressure_wmark_lock);
+
+	return found;
+}
+
 /**
  * vmpressure_register_event() - Bind vmpressure notifications to an eventfd
  * @memcg:	memcg that is interested in vmpressure notifications
@@ -336,7 +452,8 @@ void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio)
  * infrastructure, so that the notifications will be delivered to the
  * @eventfd. The @args parameter is a string that denotes pressure level
  * threshold (one of vmpressure_str_levels, i.e. "low", "medium", or
- * "critical").
+ * "critical"), or "headroom=<kB>" for a watermark distance threshold. The
+ * latter is about the free memory of the whole system, whatever @memcg.
  *
  * To be used as memcg event method.
  */
@@ -347,6 +464,9 @@ int vmpressure_register_event(struct mem_cgroup *memcg,
 	struct vmpressure_event *ev;
 	int level;
 
+	if (!strncmp(args, "headroom=", 9))
+		return vmpressure_register_wmark(memcg, eventfd, args + 9);
+
 	for (level = 0; level < VMPRESSURE_NUM_LEVELS; level++) {
 		if (!strcmp(vmpressure_str_levels[level], args))
 			break;
@@ -386,6 +506,9 @@ void vmpressure_unregister_event(struct mem_cgroup *memcg,
 	struct vmpressure *vmpr = memcg_to_vmpressure(memcg);
 	struct vmpressure_event *ev;
 
+	if (vmpressure_unregister_wmark(memcg, eventfd))
+		return;
+
 	mutex_lock(&vmpr->events_lock);
 	list_for_each_entry(ev, &vmpr->events, node) {
 		if (ev->efd != eventfd)
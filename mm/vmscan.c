@@ -846,6 +846,32 @@ enum page_references {
 	PAGEREF_ACTIVATE,
 };
 
+/*
+ * Page cache of a file advised with POSIX_FADV_KEEP_RESIDENT stays on the
+ * active list, until reclaim gets down to half of its priority levels.
+ */
+static bool page_keep_resident(struct page *page, struct scan_control *sc)
+{
+	struct address_space *mapping;
+	bool ret;
+
+	if (sc->priority <= DEF_PRIORITY / 2 || !page_is_file_cache(page))
+		return false;
+
+	/*
+	 * shrink_active_list() calls this on unlocked pages, so the mapping
+	 * can be truncated and its inode freed under us. Inodes are freed
+	 * by RCU, and a page that left its mapping meanwhile is not kept.
+	 */
+	rcu_read_lock();
+	mapping = page_mapping(page);
+	ret = mapping && mapping_keep_resident(mapping) &&
+	      page_mapping(page) == mapping;
+	rcu_read_unlock();
+
+	return ret;
+}
+
 static enum page_references page_check_references(struct page *page,
 						  struct scan_control *sc)
 {
@@ -863,6 +889,9 @@ static enum page_references page_check_references(struct page *page,
 	if (vm_flags & VM_LOCKED)
 		return PAGEREF_RECLAIM;
 
+	if (page_keep_resident(page, sc))
+		return PAGEREF_ACTIVATE;
+
 	if (referenced_ptes) {
 		if (PageSwapBacked(page))
 			return PAGEREF_ACTIVATE;
@@ -1959,6 +1988,11 @@ static void shrink_active_list(unsigned long nr_to_scan,
 			}
 		}
 
+		if (page_keep_resident(page, sc)) {
+			list_add(&page->lru, &l_active);
+			continue;
+		}
+
 		if (page_referenced(page, 0, sc->target_mem_cgroup,
 				    &vm_flags)) {
 			nr_rotated += hpage_nr_pages(page);
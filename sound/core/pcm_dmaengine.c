@@ -21,6 +21,7 @@
 #include <linux/module.h>
 #include <linux/init.h>
 #include <linux/dmaengine.h>
+#include <linux/hrtimer.h>
 #include <linux/slab.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
@@ -33,6 +34,11 @@ struct dmaengine_pcm_runtime_data {
 	dma_cookie_t cookie;
 
 	unsigned int pos;
+
+	struct snd_pcm_substream *substream;
+	struct hrtimer timer;
+	ktime_t timer_period;
+	atomic_t timer_running;
 };
 
 static inline struct dmaengine_pcm_runtime_data *substream_to_prtd(
@@ -146,9 +152,59 @@ static void dmaengine_pcm_dma_complete(void *arg)
 	if (prtd->pos >= snd_pcm_lib_buffer_bytes(substream))
 		prtd->pos = 0;
 
+	/* the period timer reports progress for this stream */
+	if (atomic_read(&prtd->timer_running))
+		return;
+
 	snd_pcm_period_elapsed(substream);
 }
 
+/*
+ * Streams opened with SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP run the DMA
+ * without interrupts. An hrtimer stands in for them: once a period it
+ * lets the core read the position from the DMA residue and wake the
+ * application when avail_min frames are ready, so small buffers need
+ * neither small DMA periods nor an interrupt per period.
+ */
+static enum hrtimer_restart dmaengine_pcm_timer_fn(struct hrtimer *timer)
+{
+	struct dmaengine_pcm_runtime_data *prtd =
+		container_of(timer, struct dmaengine_pcm_runtime_data, timer);
+
+	if (!atomic_read(&prtd->timer_running))
+		return HRTIMER_NORESTART;
+
+	snd_pcm_period_elapsed(prtd->substream);
+	if (!atomic_read(&prtd->timer_running))
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(timer, prtd->timer_period);
+	return HRTIMER_RESTART;
+}
+
+static void dmaengine_pcm_timer_start(struct snd_pcm_substream *substream)
+{
+	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
+	struct snd_pcm_runtime *runtime = substream->runtime;
+
+	if (!runtime->no_period_wakeup)
+		return;
+
+	prtd->timer_period = ns_to_ktime(div_u64((u64)runtime->period_size *
+						 NSEC_PER_SEC, runtime->rate));
+	atomic_set(&prtd->timer_running, 1);
+	hrtimer_start(&prtd->timer, prtd->timer_period, HRTIMER_MODE_REL);
+}
+
+/* Called under the stream lock, which the timer takes: don't wait for it */
+static void dmaengine_pcm_timer_stop(struct snd_pcm_substream *substream)
+{
+	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
+
+	atomic_set(&prtd->timer_running, 0);
+	hrtimer_try_to_cancel(&prtd->timer);
+}
+
 static int dmaengine_pcm_prepare_and_submit(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
@@ -200,21 +256,26 @@ int snd_dmaengine_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 		if (ret)
 			return ret;
 		dma_async_issue_pending(prtd->dma_chan);
+		dmaengine_pcm_timer_start(substream);
 		break;
 	case SNDRV_PCM_TRIGGER_RESUME:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
 		dmaengine_resume(prtd->dma_chan);
+		dmaengine_pcm_timer_start(substream);
 		break;
 	case SNDRV_PCM_TRIGGER_SUSPEND:
+		dmaengine_pcm_timer_stop(substream);
 		if (runtime->info & SNDRV_PCM_INFO_PAUSE)
 			dmaengine_pause(prtd->dma_chan);
 		else
 			dmaengine_terminate_async(prtd->dma_chan);
 		break;
 	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		dmaengine_pcm_timer_stop(substream);
 		dmaengine_pause(prtd->dma_chan);
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
+		dmaengine_pcm_timer_stop(substream);
 		dmaengine_terminate_async(prtd->dma_chan);
 		break;
 	default:
@@ -317,6 +378,9 @@ int snd_dmaengine_pcm_open(struct snd_pcm_substream *substream,
 		return -ENOMEM;
 
 	prtd->dma_chan = chan;
+	prtd->substream = substream;
+	hrtimer_init(&prtd->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	prtd->timer.function = dmaengine_pcm_timer_fn;
 
 	substream->runtime->private_data = prtd;
 
@@ -353,6 +417,7 @@ int snd_dmaengine_pcm_close(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
 
+	hrtimer_cancel(&prtd->timer);
 	dmaengine_synchronize(prtd->dma_chan);
 	kfree(prtd);
 
@@ -370,6 +435,7 @@ int snd_dmaengine_pcm_close_release_chan(struct snd_pcm_substream *substream)
 {
 	struct dmaengine_pcm_runtime_data *prtd = substream_to_prtd(substream);
 
+	hrtimer_cancel(&prtd->timer);
 	dmaengine_synchronize(prtd->dma_chan);
 	dma_release_channel(prtd->dma_chan);
 	kfree(prtd);
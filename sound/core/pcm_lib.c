@@ -473,6 +473,10 @@ static int snd_pcm_update_hw_ptr0(struct snd_pcm_substream *substream,
 			runtime->hw_ptr_interrupt -= runtime->boundary;
 	}
 	runtime->hw_ptr_base = hw_base;
+	/* mmap readers may check hw_ptr without the stream lock; publish it
+	 * only after the silence fill and everything before it
+	 */
+	smp_wmb();
 	runtime->status->hw_ptr = new_hw_ptr;
 	runtime->hw_ptr_jiffies = curr_jiffies;
 	if (crossed_boundary) {
@@ -36,6 +36,9 @@
 #include <sound/timer.h>
 #include <sound/minors.h>
 #include <linux/uio.h>
+#ifdef CONFIG_ARM
+#include <asm/cachetype.h>
+#endif
 
 /*
  *  Compatibility
@@ -3242,7 +3245,26 @@ static unsigned int snd_pcm_capture_poll(struct file *file, poll_table * wait)
  * Only on coherent architectures, we can mmap the status and the control records
  * for effcient data transfer.  On others, we have to use HWSYNC ioctl...
  */
-#if defined(CONFIG_X86) || defined(CONFIG_PPC) || defined(CONFIG_ALPHA)
+#if defined(CONFIG_X86) || defined(CONFIG_PPC) || defined(CONFIG_ALPHA) || \
+	defined(CONFIG_ARM)
+
+#ifdef CONFIG_ARM
+/*
+ * The records are ordinary cached pages. A non-aliasing VIPT or PIPT
+ * data cache, as on ARMv7, sees the same lines through the user and
+ * the kernel mapping; VIVT and aliasing VIPT caches don't.
+ */
+static bool pcm_mmap_records_coherent(void)
+{
+	return !cache_is_vivt() && !cache_is_vipt_aliasing();
+}
+#else
+static bool pcm_mmap_records_coherent(void)
+{
+	return true;
+}
+#endif
+
 /*
  * mmap status record
  */
@@ -3268,6 +3290,8 @@ static int snd_pcm_mmap_status(struct snd_pcm_substream *substream, struct file
 			       struct vm_area_struct *area)
 {
 	long size;
+	if (!pcm_mmap_records_coherent())
+		return -ENXIO;
 	if (!(area->vm_flags & VM_READ))
 		return -EINVAL;
 	size = area->vm_end - area->vm_start;
@@ -3304,6 +3328,8 @@ static int snd_pcm_mmap_control(struct snd_pcm_substream *substream, struct file
 				struct vm_area_struct *area)
 {
 	long size;
+	if (!pcm_mmap_records_coherent())
+		return -ENXIO;
 	if (!(area->vm_flags & VM_READ))
 		return -EINVAL;
 	size = area->vm_end - area->vm_start;
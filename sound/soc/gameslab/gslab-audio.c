@@ -0,0 +1,184 @@
+/*
+ * Gameslab ASoC machine driver, PL I2S controller with an ADAU1761 codec
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+/*
+ * The codec is the bit clock and frame master. It runs its PLL from the
+ * fixed MCLK that the board feeds it and derives the sample rate from that,
+ * so the only thing to do per stream is to pick the PLL output matching the
+ * 48 kHz or the 44.1 kHz family.
+ */
+
+#include <linux/clk.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+
+#include <sound/pcm_params.h>
+#include <sound/soc.h>
+
+#include "../codecs/adau17x1.h"
+
+struct gslab_audio {
+	struct snd_soc_card card;
+	struct snd_soc_dai_link dai_link;
+	struct clk *mclk;
+};
+
+static int gslab_audio_hw_params(struct snd_pcm_substream *substream,
+				 struct snd_pcm_hw_params *params)
+{
+	struct snd_soc_pcm_runtime *rtd = substream->private_data;
+	struct snd_soc_dai *codec_dai = rtd->codec_dai;
+	struct gslab_audio *priv = snd_soc_card_get_drvdata(rtd->card);
+	unsigned int pll_rate;
+	int ret;
+
+	if (params_rate(params) % 8000 == 0)
+		pll_rate = 48000 * 1024;
+	else
+		pll_rate = 44100 * 1024;
+
+	ret = snd_soc_dai_set_pll(codec_dai, ADAU17X1_PLL,
+				  ADAU17X1_PLL_SRC_MCLK,
+				  clk_get_rate(priv->mclk), pll_rate);
+	if (ret)
+		return ret;
+
+	return snd_soc_dai_set_sysclk(codec_dai, ADAU17X1_CLK_SRC_PLL,
+				      pll_rate, SND_SOC_CLOCK_IN);
+}
+
+static const struct snd_soc_ops gslab_audio_ops = {
+	.hw_params = gslab_audio_hw_params,
+};
+
+static const struct snd_soc_dapm_widget gslab_audio_widgets[] = {
+	SND_SOC_DAPM_HP("Headphone Out", NULL),
+	SND_SOC_DAPM_SPK("Speaker", NULL),
+	SND_SOC_DAPM_MIC("Mic In", NULL),
+};
+
+static const struct snd_soc_dapm_route gslab_audio_routes[] = {
+	{ "Headphone Out", NULL, "LHP" },
+	{ "Headphone Out", NULL, "RHP" },
+	{ "Speaker", NULL, "LOUT" },
+	{ "Speaker", NULL, "ROUT" },
+	{ "LINN", NULL, "Mic In" },
+	{ "RINN", NULL, "Mic In" },
+};
+
+static int gslab_audio_probe(struct platform_device *pdev)
+{
+	struct device_node *np = pdev->dev.of_node;
+	struct snd_soc_dai_link *dai_link;
+	struct gslab_audio *priv;
+	struct snd_soc_card *card;
+	int ret;
+
+	priv = devm_kzalloc(&pdev->dev, sizeof(*priv), GFP_KERNEL);
+	if (!priv)
+		return -ENOMEM;
+
+	priv->mclk = devm_clk_get(&pdev->dev, "mclk");
+	if (IS_ERR(priv->mclk)) {
+		ret = PTR_ERR(priv->mclk);
+		if (ret != -EPROBE_DEFER)
+			dev_err(&pdev->dev, "failed to get mclk: %d\n", ret);
+		return ret;
+	}
+
+	dai_link = &priv->dai_link;
+	dai_link->name = "adau1761";
+	dai_link->stream_name = "adau1761";
+	dai_link->codec_dai_name = "adau-hifi";
+	dai_link->dai_fmt = SND_SOC_DAIFMT_I2S | SND_SOC_DAIFMT_NB_NF |
+			    SND_SOC_DAIFMT_CBM_CFM;
+	dai_link->ops = &gslab_audio_ops;
+
+	dai_link->cpu_of_node = of_parse_phandle(np, "gameslab,i2s-controller",
+						 0);
+	if (!dai_link->cpu_of_node) {
+		dev_err(&pdev->dev, "missing gameslab,i2s-controller\n");
+		return -EINVAL;
+	}
+	dai_link->platform_of_node = dai_link->cpu_of_node;
+
+	dai_link->codec_of_node = of_parse_phandle(np, "gameslab,audio-codec",
+						   0);
+	if (!dai_link->codec_of_node) {
+		dev_err(&pdev->dev, "missing gameslab,audio-codec\n");
+		ret = -EINVAL;
+		goto err_put_cpu;
+	}
+
+	card = &priv->card;
+	card->dev = &pdev->dev;
+	card->owner = THIS_MODULE;
+	card->dai_link = dai_link;
+	card->num_links = 1;
+	card->dapm_widgets = gslab_audio_widgets;
+	card->num_dapm_widgets = ARRAY_SIZE(gslab_audio_widgets);
+	card->dapm_routes = gslab_audio_routes;
+	card->num_dapm_routes = ARRAY_SIZE(gslab_audio_routes);
+	card->fully_routed = true;
+
+	ret = snd_soc_of_parse_card_name(card, "gameslab,model");
+	if (ret)
+		goto err_put_codec;
+	if (!card->name)
+		card->name = "Gameslab Audio";
+
+	snd_soc_card_set_drvdata(card, priv);
+
+	ret = devm_snd_soc_register_card(&pdev->dev, card);
+	if (ret) {
+		if (ret != -EPROBE_DEFER)
+			dev_err(&pdev->dev, "failed to register card: %d\n",
+				ret);
+		goto err_put_codec;
+	}
+
+	return 0;
+
+err_put_codec:
+	of_node_put(dai_link->codec_of_node);
+err_put_cpu:
+	of_node_put(dai_link->cpu_of_node);
+	return ret;
+}
+
+static int gslab_audio_remove(struct platform_device *pdev)
+{
+	struct snd_soc_card *card = platform_get_drvdata(pdev);
+	struct gslab_audio *priv = snd_soc_card_get_drvdata(card);
+
+	of_node_put(priv->dai_link.codec_of_node);
+	of_node_put(priv->dai_link.cpu_of_node);
+
+	return 0;
+}
+
+static const struct of_device_id gslab_audio_of_match[] = {
+	{ .compatible = "gameslab,audio-adau1761" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, gslab_audio_of_match);
+
+static struct platform_driver gslab_audio_driver = {
+	.probe = gslab_audio_probe,
+	.remove = gslab_audio_remove,
+	.driver = {
+		.name = "gslab-audio",
+		.of_match_table = gslab_audio_of_match,
+		.pm = &snd_soc_pm_ops,
+	},
+};
+module_platform_driver(gslab_audio_driver);
+
+MODULE_DESCRIPTION("Gameslab ADAU1761 machine driver");
+MODULE_LICENSE("GPL v2");
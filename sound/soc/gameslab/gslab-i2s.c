@@ -0,0 +1,281 @@
+/*
+ * Gameslab PL I2S controller ASoC driver
+ *
+ * This file is licensed under the terms of the GNU General Public License
+ * version 2.  This program is licensed "as is" without any warranty of any
+ * kind, whether express or implied.
+ */
+
+/*
+ * The I2S core in the PL serializes an AXI-Stream from the AXI DMA MM2S
+ * channel and feeds captured samples back over a stream into S2MM. It is
+ * always a bit clock and frame slave of the codec. There is no FIFO
+ * register for the DMA to target, the DMA channels are wired to the core's
+ * stream ports, so the generic dmaengine PCM is registered without a slave
+ * config and the cyclic transfers are set up by the AXI DMA driver.
+ *
+ * Every beat of the stream carries one 32-bit word: a whole S16_LE stereo
+ * frame or a single S32_LE/S24_LE sample, as selected in the format register.
+ */
+
+#include <linux/clk.h>
+#include <linux/dmaengine.h>
+#include <linux/module.h>
+#include <linux/of_device.h>
+#include <linux/platform_device.h>
+#include <linux/regmap.h>
+
+#include <sound/dmaengine_pcm.h>
+#include <sound/pcm_params.h>
+#include <sound/soc.h>
+#include <sound/soc-dai.h>
+
+#define GSLAB_I2S_CTRL_REG		0x00
+#define GSLAB_I2S_CTRL_TX_EN			BIT(0)
+#define GSLAB_I2S_CTRL_RX_EN			BIT(1)
+#define GSLAB_I2S_CTRL_TX_FLUSH			BIT(2)
+#define GSLAB_I2S_CTRL_RX_FLUSH			BIT(3)
+
+#define GSLAB_I2S_FMT_REG		0x04
+#define GSLAB_I2S_FMT_PACKED_16			BIT(0)
+
+#define GSLAB_I2S_STATUS_REG		0x08
+#define GSLAB_I2S_STATUS_TX_UNDERRUN		BIT(0)
+#define GSLAB_I2S_STATUS_RX_OVERRUN		BIT(1)
+
+/*
+ * 64 frames per period keep a two period buffer under 3 ms at 48 kHz. The
+ * AXI DMA reports the residue per segment and every period is a segment,
+ * so the pointer is exact at period boundaries.
+ */
+#define GSLAB_I2S_PERIOD_FRAMES_MIN	64
+#define GSLAB_I2S_FRAME_BYTES_MIN	4
+#define GSLAB_I2S_BUFFER_BYTES_MAX	(64 * 1024)
+
+struct gslab_i2s {
+	struct regmap *regmap;
+	struct clk *clk;
+};
+
+static int gslab_i2s_hw_params(struct snd_pcm_substream *substream,
+			       struct snd_pcm_hw_params *params,
+			       struct snd_soc_dai *dai)
+{
+	struct gslab_i2s *i2s = snd_soc_dai_get_drvdata(dai);
+	unsigned int fmt;
+
+	switch (params_format(params)) {
+	case SNDRV_PCM_FORMAT_S16_LE:
+		fmt = GSLAB_I2S_FMT_PACKED_16;
+		break;
+	case SNDRV_PCM_FORMAT_S24_LE:
+	case SNDRV_PCM_FORMAT_S32_LE:
+		fmt = 0;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	/* Playback and capture share the frame clock and the format */
+	return regmap_write(i2s->regmap, GSLAB_I2S_FMT_REG, fmt);
+}
+
+static int gslab_i2s_set_fmt(struct snd_soc_dai *dai, unsigned int fmt)
+{
+	if ((fmt & SND_SOC_DAIFMT_MASTER_MASK) != SND_SOC_DAIFMT_CBM_CFM)
+		return -EINVAL;
+
+	if ((fmt & SND_SOC_DAIFMT_FORMAT_MASK) != SND_SOC_DAIFMT_I2S)
+		return -EINVAL;
+
+	if ((fmt & SND_SOC_DAIFMT_INV_MASK) != SND_SOC_DAIFMT_NB_NF)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int gslab_i2s_trigger(struct snd_pcm_substream *substream, int cmd,
+			     struct snd_soc_dai *dai)
+{
+	struct gslab_i2s *i2s = snd_soc_dai_get_drvdata(dai);
+	bool tx = substream->stream == SNDRV_PCM_STREAM_PLAYBACK;
+	unsigned int en = tx ? GSLAB_I2S_CTRL_TX_EN : GSLAB_I2S_CTRL_RX_EN;
+	unsigned int flush = tx ? GSLAB_I2S_CTRL_TX_FLUSH :
+				  GSLAB_I2S_CTRL_RX_FLUSH;
+
+	switch (cmd) {
+	case SNDRV_PCM_TRIGGER_START:
+	case SNDRV_PCM_TRIGGER_RESUME:
+	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
+		regmap_write(i2s->regmap, GSLAB_I2S_STATUS_REG,
+			     tx ? GSLAB_I2S_STATUS_TX_UNDERRUN :
+				  GSLAB_I2S_STATUS_RX_OVERRUN);
+		regmap_update_bits(i2s->regmap, GSLAB_I2S_CTRL_REG, en, en);
+		break;
+
+	case SNDRV_PCM_TRIGGER_STOP:
+	case SNDRV_PCM_TRIGGER_SUSPEND:
+	case SNDRV_PCM_TRIGGER_PAUSE_PUSH:
+		/* Drop what is left so a restart does not play stale data */
+		regmap_update_bits(i2s->regmap, GSLAB_I2S_CTRL_REG,
+				   en | flush, flush);
+		break;
+
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static const struct snd_soc_dai_ops gslab_i2s_dai_ops = {
+	.hw_params	= gslab_i2s_hw_params,
+	.set_fmt	= gslab_i2s_set_fmt,
+	.trigger	= gslab_i2s_trigger,
+};
+
+#define GSLAB_I2S_FORMATS	(SNDRV_PCM_FMTBIT_S16_LE | \
+				 SNDRV_PCM_FMTBIT_S24_LE | \
+				 SNDRV_PCM_FMTBIT_S32_LE)
+
+static struct snd_soc_dai_driver gslab_i2s_dai = {
+	.playback = {
+		.stream_name = "Playback",
+		.channels_min = 2,
+		.channels_max = 2,
+		.rates = SNDRV_PCM_RATE_8000_96000,
+		.formats = GSLAB_I2S_FORMATS,
+	},
+	.capture = {
+		.stream_name = "Capture",
+		.channels_min = 2,
+		.channels_max = 2,
+		.rates = SNDRV_PCM_RATE_8000_96000,
+		.formats = GSLAB_I2S_FORMATS,
+	},
+	.ops = &gslab_i2s_dai_ops,
+	.symmetric_rates = 1,
+	.symmetric_samplebits = 1,
+};
+
+static const struct snd_soc_component_driver gslab_i2s_component = {
+	.name	= "gslab-i2s",
+};
+
+static const struct snd_pcm_hardware gslab_i2s_pcm_hardware = {
+	.info = SNDRV_PCM_INFO_INTERLEAVED |
+		SNDRV_PCM_INFO_MMAP |
+		SNDRV_PCM_INFO_MMAP_VALID |
+		SNDRV_PCM_INFO_PAUSE |
+		SNDRV_PCM_INFO_RESUME |
+		SNDRV_PCM_INFO_BATCH,
+	.period_bytes_min = GSLAB_I2S_PERIOD_FRAMES_MIN *
+			    GSLAB_I2S_FRAME_BYTES_MIN,
+	.period_bytes_max = GSLAB_I2S_BUFFER_BYTES_MAX / 2,
+	.periods_min = 2,
+	.periods_max = GSLAB_I2S_BUFFER_BYTES_MAX /
+		       (GSLAB_I2S_PERIOD_FRAMES_MIN *
+			GSLAB_I2S_FRAME_BYTES_MIN),
+	.buffer_bytes_max = GSLAB_I2S_BUFFER_BYTES_MAX,
+	.fifo_size = 0,
+};
+
+/* No prepare_slave_config, the DMA talks to the stream ports directly */
+static const struct snd_dmaengine_pcm_config gslab_i2s_dmaengine_config = {
+	.pcm_hardware = &gslab_i2s_pcm_hardware,
+	.prealloc_buffer_size = GSLAB_I2S_BUFFER_BYTES_MAX,
+};
+
+static const struct regmap_config gslab_i2s_regmap_config = {
+	.reg_bits	= 32,
+	.reg_stride	= 4,
+	.val_bits	= 32,
+	.max_register	= GSLAB_I2S_STATUS_REG,
+};
+
+static int gslab_i2s_probe(struct platform_device *pdev)
+{
+	struct gslab_i2s *i2s;
+	struct resource *res;
+	void __iomem *regs;
+	int ret;
+
+	i2s = devm_kzalloc(&pdev->dev, sizeof(*i2s), GFP_KERNEL);
+	if (!i2s)
+		return -ENOMEM;
+	platform_set_drvdata(pdev, i2s);
+
+	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
+	regs = devm_ioremap_resource(&pdev->dev, res);
+	if (IS_ERR(regs))
+		return PTR_ERR(regs);
+
+	i2s->regmap = devm_regmap_init_mmio(&pdev->dev, regs,
+					    &gslab_i2s_regmap_config);
+	if (IS_ERR(i2s->regmap)) {
+		dev_err(&pdev->dev, "Regmap initialisation failed\n");
+		return PTR_ERR(i2s->regmap);
+	}
+
+	i2s->clk = devm_clk_get(&pdev->dev, "axi");
+	if (IS_ERR(i2s->clk)) {
+		dev_err(&pdev->dev, "Can't get the axi clock\n");
+		return PTR_ERR(i2s->clk);
+	}
+
+	ret = clk_prepare_enable(i2s->clk);
+	if (ret)
+		return ret;
+
+	regmap_write(i2s->regmap, GSLAB_I2S_CTRL_REG,
+		     GSLAB_I2S_CTRL_TX_FLUSH | GSLAB_I2S_CTRL_RX_FLUSH);
+
+	ret = devm_snd_soc_register_component(&pdev->dev,
+					      &gslab_i2s_component,
+					      &gslab_i2s_dai, 1);
+	if (ret) {
+		dev_err(&pdev->dev, "Could not register DAI\n");
+		goto err_clk_disable;
+	}
+
+	ret = devm_snd_dmaengine_pcm_register(&pdev->dev,
+					      &gslab_i2s_dmaengine_config, 0);
+	if (ret) {
+		dev_err(&pdev->dev, "Could not register PCM\n");
+		goto err_clk_disable;
+	}
+
+	return 0;
+
+err_clk_disable:
+	clk_disable_unprepare(i2s->clk);
+	return ret;
+}
+
+static int gslab_i2s_remove(struct platform_device *pdev)
+{
+	struct gslab_i2s *i2s = platform_get_drvdata(pdev);
+
+	clk_disable_unprepare(i2s->clk);
+
+	return 0;
+}
+
+static const struct of_device_id gslab_i2s_of_match[] = {
+	{ .compatible = "gameslab,i2s-1.0" },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, gslab_i2s_of_match);
+
+static struct platform_driver gslab_i2s_driver = {
+	.probe = gslab_i2s_probe,
+	.remove = gslab_i2s_remove,
+	.driver = {
+		.name = "gslab-i2s",
+		.of_match_table = gslab_i2s_of_match,
+	},
+};
+module_platform_driver(gslab_i2s_driver);
+
+MODULE_DESCRIPTION("Gameslab PL I2S controller driver");
+MODULE_LICENSE("GPL v2");
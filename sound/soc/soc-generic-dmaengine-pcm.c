@@ -155,6 +155,9 @@ static int dmaengine_pcm_set_runtime_hwparams(struct snd_pcm_substream *substrea
 			hw.info |= SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME;
 		if (dma_caps.residue_granularity <= DMA_RESIDUE_GRANULARITY_SEGMENT)
 			hw.info |= SNDRV_PCM_INFO_BATCH;
+		/* a period timer can follow the DMA through its residue */
+		if (!(pcm->flags & SND_DMAENGINE_PCM_FLAG_NO_RESIDUE))
+			hw.info |= SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
 
 		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
 			addr_widths = dma_caps.dst_addr_widths;
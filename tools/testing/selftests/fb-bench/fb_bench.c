@@ -0,0 +1,210 @@
+/*
+ * Frame buffer upload and blit benchmark
+ *
+ * Measures what a user space renderer sees on an fbdev device: full frame
+ * uploads into the mmap()ed frame buffer, followed by GSLCDFB_IOCTL_SYNC
+ * when the mapping is cacheable, and screen to screen copies through
+ * GSLCDFB_IOCTL_BLIT, which gslcdfb runs on the CDMA engine. Results are
+ * printed in MB/s and frames per second. Optionally switches the pixel
+ * format first, so the same run covers 16, 24 and 32 bpp.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/fb.h>
+#include <video/gslcdfb.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void report(const struct fb_var_screeninfo *var, const char *op,
+		   uint64_t bytes, double frames, uint64_t ns)
+{
+	if (!ns)
+		ns = 1;
+
+	printf("%ux%u-%u %-12s %8.1f MB/s %8.2f frames/s\n",
+	       var->xres, var->yres, var->bits_per_pixel, op,
+	       bytes * 1000.0 / ns, frames * 1e9 / ns);
+}
+
+/* whether the mapping is cacheable, from the gslcdfb module parameter */
+static const char *mapping_name(void)
+{
+	char c = 0;
+	int fd;
+
+	fd = open("/sys/module/gslcdfb/parameters/cached", O_RDONLY);
+	if (fd < 0)
+		return "unknown";
+	if (read(fd, &c, 1) != 1)
+		c = 0;
+	close(fd);
+
+	return c == 'Y' ? "cached+flush" : "writecombine";
+}
+
+static int bench_upload(int fd, const struct fb_var_screeninfo *var,
+			size_t line_length, uint8_t *fbmem,
+			unsigned int iterations)
+{
+	size_t frame = (size_t)var->yres * line_length;
+	struct gslcdfb_sync sync = {
+		.flags = GSLCDFB_SYNC_WRITE | GSLCDFB_SYNC_END,
+		.height = var->yres,
+	};
+	int have_sync = 1;
+	uint64_t start;
+	unsigned int i;
+	uint8_t *src;
+
+	src = malloc(frame);
+	if (!src)
+		return -ENOMEM;
+	memset(src, 0x3c, frame);
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		memcpy(fbmem, src, frame);
+		if (have_sync && ioctl(fd, GSLCDFB_IOCTL_SYNC, &sync) < 0)
+			have_sync = 0;
+	}
+	report(var, "upload", (uint64_t)frame * iterations, iterations,
+	       now_ns() - start);
+
+	free(src);
+	return 0;
+}
+
+/* scroll the screen by 16 lines with the blit engine */
+static int bench_blit(int fd, const struct fb_var_screeninfo *var,
+		      size_t line_length, unsigned int iterations)
+{
+	struct gslcdfb_blit blit = {
+		.sy = 16,
+		.width = var->xres,
+		.height = var->yres - 16,
+	};
+	uint64_t bytes = (uint64_t)blit.height * line_length;
+	uint64_t start;
+	unsigned int i;
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		if (ioctl(fd, GSLCDFB_IOCTL_BLIT, &blit) < 0) {
+			if (errno == ENOTTY || errno == EINVAL) {
+				printf("blit: not supported, skipped\n");
+				return 0;
+			}
+			perror("GSLCDFB_IOCTL_BLIT");
+			return -errno;
+		}
+	}
+	report(var, "blit", bytes * iterations,
+	       (double)bytes * iterations / ((uint64_t)var->yres * line_length),
+	       now_ns() - start);
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-d /dev/fbN] [-b bpp] [-n iterations]\n"
+		"  -b  switch to this pixel depth first and leave it set\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dev = "/dev/fb0";
+	struct fb_var_screeninfo var;
+	struct fb_fix_screeninfo fix;
+	unsigned int iterations = 100;
+	unsigned int bpp = 0;
+	uint8_t *fbmem;
+	int fd, opt, ret;
+
+	while ((opt = getopt(argc, argv, "d:b:n:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			dev = optarg;
+			break;
+		case 'b':
+			bpp = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	fd = open(dev, O_RDWR);
+	if (fd < 0) {
+		printf("%s: %s, skipped\n", dev, strerror(errno));
+		return KSFT_SKIP;
+	}
+
+	if (ioctl(fd, FBIOGET_VSCREENINFO, &var) < 0) {
+		perror("FBIOGET_VSCREENINFO");
+		return KSFT_FAIL;
+	}
+
+	if (bpp && bpp != var.bits_per_pixel) {
+		var.bits_per_pixel = bpp;
+		var.activate = FB_ACTIVATE_NOW;
+		if (ioctl(fd, FBIOPUT_VSCREENINFO, &var) < 0) {
+			printf("%u bpp: %s, skipped\n", bpp, strerror(errno));
+			return KSFT_SKIP;
+		}
+	}
+
+	if (ioctl(fd, FBIOGET_FSCREENINFO, &fix) < 0) {
+		perror("FBIOGET_FSCREENINFO");
+		return KSFT_FAIL;
+	}
+
+	fbmem = mmap(NULL, fix.smem_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+		     fd, 0);
+	if (fbmem == MAP_FAILED) {
+		perror("mmap");
+		return KSFT_FAIL;
+	}
+
+	printf("%s: %s, mapping %s\n", dev, fix.id, mapping_name());
+
+	ret = bench_upload(fd, &var, fix.line_length, fbmem, iterations);
+	if (!ret)
+		ret = bench_blit(fd, &var, fix.line_length, iterations);
+
+	munmap(fbmem, fix.smem_len);
+	close(fd);
+
+	return ret ? KSFT_FAIL : KSFT_PASS;
+}
@@ -0,0 +1,35 @@
+#!/bin/sh
+# Runs the frame buffer benchmarks at each pixel format gslcdfb supports:
+# fb_bench for uploads and CDMA blits from user space, then the test_fb
+# module for the in-kernel fillrect/copyarea/imageblit paths.
+
+# Kselftest framework requirement - SKIP code is 4.
+ksft_skip=4
+
+FB=${FB:-0}
+
+if [ ! -c /dev/fb$FB ]; then
+	echo "fb-bench: no /dev/fb$FB [SKIP]"
+	exit $ksft_skip
+fi
+
+orig=$(cat /sys/class/graphics/fb$FB/bits_per_pixel)
+rc=0
+
+for bpp in 16 24 32; do
+	./fb_bench -d /dev/fb$FB -b $bpp
+	ret=$?
+	[ $ret -eq $ksft_skip ] && continue
+	[ $ret -ne 0 ] && rc=1
+
+	if modprobe -q test_fb fb=$FB; then
+		dmesg | grep "test_fb: fb$FB " | tail -n 4
+		modprobe -q -r test_fb
+	else
+		echo "fb-bench: test_fb module not available"
+	fi
+done
+
+./fb_bench -d /dev/fb$FB -b $orig -n 0 > /dev/null
+
+exit $rc
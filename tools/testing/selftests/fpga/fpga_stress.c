@@ -0,0 +1,305 @@
+/*
+ * FPGA reconfiguration stress test and benchmark
+ *
+ * Loads a full image through the FPGA manager "firmware" attribute and
+ * partial images through an FPGA region "firmware" attribute, over and
+ * over, and reports per-load latency distributions, throughput and the
+ * number of failed loads. Full loads are asynchronous: the test waits for
+ * load_result to leave -EINPROGRESS with poll(). After every load the
+ * manager has to report the "operating" state.
+ *
+ * Throughput is the image file size over the load latency, so it covers
+ * firmware loading as well as the PCAP transfer; the per-phase split is
+ * in the manager's debugfs "stats" file.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+#define MGR_CLASS	"/sys/class/fpga_manager"
+#define REGION_CLASS	"/sys/class/fpga_region"
+#define FW_PATH		"/lib/firmware"
+#define LOAD_TIMEOUT_MS	10000
+#define MAX_PARTIALS	8
+
+struct stats {
+	const char *name;
+	uint64_t *samples;	/* load latency in ns */
+	uint64_t bytes;
+	unsigned int count;
+	unsigned int failures;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int write_attr(const char *path, const char *val)
+{
+	ssize_t len = strlen(val);
+	int fd, ret = 0;
+
+	fd = open(path, O_WRONLY);
+	if (fd < 0)
+		return -errno;
+	if (write(fd, val, len) != len)
+		ret = -errno;
+	close(fd);
+
+	return ret;
+}
+
+static int read_attr(int fd, char *buf, size_t size)
+{
+	ssize_t len;
+
+	len = pread(fd, buf, size - 1, 0);
+	if (len < 0)
+		return -errno;
+	buf[len] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+
+	return 0;
+}
+
+static int check_operating(const char *mgr)
+{
+	char path[256], state[64];
+	int fd, ret;
+
+	snprintf(path, sizeof(path), MGR_CLASS "/%s/state", mgr);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	ret = read_attr(fd, state, sizeof(state));
+	close(fd);
+	if (ret)
+		return ret;
+
+	return strcmp(state, "operating") ? -EIO : 0;
+}
+
+static off_t image_size(const char *image)
+{
+	char path[512];
+	struct stat st;
+
+	snprintf(path, sizeof(path), FW_PATH "/%s", image);
+	return stat(path, &st) ? 0 : st.st_size;
+}
+
+/* start a full load and wait for load_result to report how it went */
+static int load_full(const char *mgr, const char *image)
+{
+	char path[256], result[32];
+	struct pollfd pfd;
+	uint64_t deadline;
+	int ret, val;
+
+	snprintf(path, sizeof(path), MGR_CLASS "/%s/load_result", mgr);
+	pfd.fd = open(path, O_RDONLY);
+	if (pfd.fd < 0)
+		return -errno;
+	pfd.events = POLLPRI | POLLERR;
+
+	/* arm poll() before the load can finish */
+	ret = read_attr(pfd.fd, result, sizeof(result));
+	if (ret)
+		goto out;
+
+	snprintf(path, sizeof(path), MGR_CLASS "/%s/firmware", mgr);
+	ret = write_attr(path, image);
+	if (ret)
+		goto out;
+
+	deadline = now_ns() + LOAD_TIMEOUT_MS * 1000000ULL;
+	for (;;) {
+		ret = read_attr(pfd.fd, result, sizeof(result));
+		if (ret)
+			goto out;
+		val = atoi(result);
+		if (val != -EINPROGRESS) {
+			ret = val;
+			break;
+		}
+		if (now_ns() > deadline) {
+			ret = -ETIMEDOUT;
+			break;
+		}
+		poll(&pfd, 1, LOAD_TIMEOUT_MS);
+	}
+
+out:
+	close(pfd.fd);
+	return ret;
+}
+
+static int load_partial(const char *region, const char *image)
+{
+	char path[256];
+
+	snprintf(path, sizeof(path), REGION_CLASS "/%s/firmware", region);
+	return write_attr(path, image);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void record(struct stats *s, uint64_t ns, off_t bytes, int ret,
+		   unsigned int cycle)
+{
+	if (ret) {
+		s->failures++;
+		fprintf(stderr, "%s load %u failed: %s\n", s->name, cycle,
+			strerror(-ret));
+		return;
+	}
+	s->samples[s->count++] = ns;
+	s->bytes += bytes;
+}
+
+static void report(struct stats *s)
+{
+	uint64_t total = 0;
+	unsigned int i;
+
+	if (!s->count && !s->failures)
+		return;
+
+	printf("%s: %u loads, %u failures\n", s->name,
+	       s->count + s->failures, s->failures);
+	if (!s->count)
+		return;
+
+	qsort(s->samples, s->count, sizeof(*s->samples), cmp_u64);
+	for (i = 0; i < s->count; i++)
+		total += s->samples[i];
+
+	printf("  latency ms: min %.2f p50 %.2f p90 %.2f p99 %.2f max %.2f\n",
+	       s->samples[0] / 1e6,
+	       s->samples[(s->count - 1) * 50 / 100] / 1e6,
+	       s->samples[(s->count - 1) * 90 / 100] / 1e6,
+	       s->samples[(s->count - 1) * 99 / 100] / 1e6,
+	       s->samples[s->count - 1] / 1e6);
+	printf("  throughput: %.1f MB/s\n", s->bytes * 1000.0 / total);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -m fpgaN [-f full.bin] [-r regionN -p part.bin[,part2.bin...]]\n"
+		"          [-n cycles] [-F full_every]\n"
+		"  Images are names relative to " FW_PATH ". Each cycle swaps\n"
+		"  the next partial image into the region; the full image is\n"
+		"  loaded first and then every full_every cycles (0: once).\n"
+		"  Without -m the test is skipped.\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *partials[MAX_PARTIALS];
+	const char *mgr = NULL, *full = NULL, *region = NULL;
+	unsigned int cycles = 1000, full_every = 0, nr_partials = 0;
+	struct stats full_stats = { .name = "full" };
+	struct stats part_stats = { .name = "partial" };
+	unsigned int i;
+	uint64_t start;
+	char *tok;
+	int opt, ret;
+
+	while ((opt = getopt(argc, argv, "m:f:r:p:n:F:h")) != -1) {
+		switch (opt) {
+		case 'm':
+			mgr = optarg;
+			break;
+		case 'f':
+			full = optarg;
+			break;
+		case 'r':
+			region = optarg;
+			break;
+		case 'p':
+			for (tok = strtok(optarg, ",");
+			     tok && nr_partials < MAX_PARTIALS;
+			     tok = strtok(NULL, ","))
+				partials[nr_partials++] = tok;
+			break;
+		case 'n':
+			cycles = strtoul(optarg, NULL, 0);
+			break;
+		case 'F':
+			full_every = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	if (!mgr || (!full && !nr_partials) || (nr_partials && !region) ||
+	    !cycles) {
+		usage(argv[0]);
+		return KSFT_SKIP;
+	}
+
+	full_stats.samples = calloc(cycles + 1, sizeof(uint64_t));
+	part_stats.samples = calloc(cycles, sizeof(uint64_t));
+	if (!full_stats.samples || !part_stats.samples)
+		return KSFT_FAIL;
+
+	for (i = 0; i < cycles; i++) {
+		if (full && (i == 0 || (full_every && i % full_every == 0))) {
+			start = now_ns();
+			ret = load_full(mgr, full);
+			if (!ret)
+				ret = check_operating(mgr);
+			record(&full_stats, now_ns() - start, image_size(full),
+			       ret, i);
+		}
+
+		if (nr_partials) {
+			const char *image = partials[i % nr_partials];
+
+			start = now_ns();
+			ret = load_partial(region, image);
+			if (!ret)
+				ret = check_operating(mgr);
+			record(&part_stats, now_ns() - start,
+			       image_size(image), ret, i);
+		} else if (!full_every) {
+			/* full loads only: reload every cycle */
+			full_every = 1;
+		}
+	}
+
+	report(&full_stats);
+	report(&part_stats);
+
+	return full_stats.failures || part_stats.failures ?
+		KSFT_FAIL : KSFT_PASS;
+}
@@ -0,0 +1,799 @@
+/*
+ * Frame pacing benchmark
+ *
+ * Runs a synthetic game workload for a while and reports how evenly frames
+ * reach the screen, so kernel changes can be gated on measured pacing:
+ *
+ * - render: draws into the back page of the frame buffer, spends a set
+ *   amount of CPU time per frame, flips with FBIOPAN_DISPLAY and waits
+ *   for the vblank that latches the flip. Frame times are the intervals
+ *   between those vblanks, a frame that took n refresh periods missed
+ *   n - 1 vblanks.
+ * - audio: plays silence through a PCM device with the raw ALSA ioctls,
+ *   one period at a time, and counts underruns.
+ * - input: injects events through uinput at a fixed rate and measures
+ *   when they are read back from the evdev node.
+ *
+ * Each part is skipped if its device is missing or set to "none". The
+ * results are printed as text, or as a single JSON object with -j.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/fb.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <sound/asound.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+#define VBLANK_PROBES		16
+#define INPUT_PERIOD_NS		8000000ULL
+#define INPUT_SLOTS		64
+#define POLL_MS			100
+
+#define AUDIO_RATE		48000
+#define AUDIO_CHANNELS		2
+#define AUDIO_PERIOD		256
+#define AUDIO_PERIODS		4
+
+struct stats {
+	const char *name;
+	uint64_t *samples;
+	unsigned int count;
+	unsigned int size;
+};
+
+static volatile bool stop;
+
+static uint64_t ts_to_ns(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts_to_ns(&ts);
+}
+
+static void stats_add(struct stats *s, uint64_t ns)
+{
+	if (s->count == s->size) {
+		unsigned int size = s->size ? s->size * 2 : 1024;
+		uint64_t *samples;
+
+		samples = realloc(s->samples, size * sizeof(*samples));
+		if (!samples)
+			return;
+		s->samples = samples;
+		s->size = size;
+	}
+	s->samples[s->count++] = ns;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/* Only valid once the samples are sorted */
+static uint64_t percentile(const struct stats *s, unsigned int pct)
+{
+	if (!s->count)
+		return 0;
+
+	return s->samples[(s->count - 1) * pct / 100];
+}
+
+static void stats_sort(struct stats *s)
+{
+	qsort(s->samples, s->count, sizeof(*s->samples), cmp_u64);
+}
+
+static void stats_print(const struct stats *s)
+{
+	if (!s->count) {
+		printf("%s: no samples\n", s->name);
+		return;
+	}
+
+	printf("%s over %u samples (us):\n", s->name, s->count);
+	printf("  min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+	       s->samples[0] / 1000.0, percentile(s, 50) / 1000.0,
+	       percentile(s, 90) / 1000.0, percentile(s, 99) / 1000.0,
+	       s->samples[s->count - 1] / 1000.0);
+}
+
+static void stats_json(const char *key, const struct stats *s)
+{
+	printf("\"%s\":{\"samples\":%u,\"p50_us\":%.1f,\"p90_us\":%.1f,"
+	       "\"p99_us\":%.1f,\"max_us\":%.1f}",
+	       key, s->count, percentile(s, 50) / 1000.0,
+	       percentile(s, 90) / 1000.0, percentile(s, 99) / 1000.0,
+	       s->count ? s->samples[s->count - 1] / 1000.0 : 0.0);
+}
+
+/* Render */
+
+struct render {
+	const char *path;
+	unsigned int work_us;
+	int fd;
+	struct fb_var_screeninfo var, orig_var;
+	uint8_t *fb;
+	size_t fb_size;
+	uint32_t line_length;
+	unsigned int pages;
+	uint64_t period_ns;
+	unsigned int missed;
+	struct stats frames;
+};
+
+static int render_open(struct render *r)
+{
+	struct fb_fix_screeninfo fix;
+	struct fb_var_screeninfo var;
+
+	r->fd = open(r->path, O_RDWR);
+	if (r->fd < 0)
+		return -errno;
+
+	if (ioctl(r->fd, FBIOGET_VSCREENINFO, &r->orig_var) < 0)
+		return -errno;
+
+	/* Ask for a second page to flip to, fall back to a single one */
+	var = r->orig_var;
+	var.yres_virtual = var.yres * 2;
+	var.yoffset = 0;
+	ioctl(r->fd, FBIOPUT_VSCREENINFO, &var);
+
+	if (ioctl(r->fd, FBIOGET_VSCREENINFO, &r->var) < 0 ||
+	    ioctl(r->fd, FBIOGET_FSCREENINFO, &fix) < 0)
+		return -errno;
+
+	r->line_length = fix.line_length;
+	r->pages = r->var.yres_virtual >= r->var.yres * 2 &&
+		   fix.smem_len >= fix.line_length * r->var.yres * 2 ? 2 : 1;
+	r->fb_size = fix.smem_len;
+	r->fb = mmap(NULL, r->fb_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		     r->fd, 0);
+	if (r->fb == MAP_FAILED) {
+		r->fb = NULL;
+		return -errno;
+	}
+
+	return 0;
+}
+
+static void render_close(struct render *r)
+{
+	if (r->fb)
+		munmap(r->fb, r->fb_size);
+	if (r->fd >= 0) {
+		ioctl(r->fd, FBIOPUT_VSCREENINFO, &r->orig_var);
+		close(r->fd);
+	}
+}
+
+static uint64_t render_wait_vblank(struct render *r)
+{
+	uint32_t crtc = 0;
+
+	if (ioctl(r->fd, FBIO_WAITFORVSYNC, &crtc) < 0)
+		return 0;
+	return now_ns();
+}
+
+/* The refresh period is the median of a few vblank intervals */
+static int render_probe_period(struct render *r)
+{
+	struct stats s = { .name = "vblank" };
+	uint64_t prev, t;
+	unsigned int i;
+
+	prev = render_wait_vblank(r);
+	for (i = 0; prev && i < VBLANK_PROBES; i++) {
+		t = render_wait_vblank(r);
+		if (!t)
+			break;
+		stats_add(&s, t - prev);
+		prev = t;
+	}
+
+	if (s.count < VBLANK_PROBES) {
+		free(s.samples);
+		return -EIO;
+	}
+
+	stats_sort(&s);
+	r->period_ns = percentile(&s, 50);
+	free(s.samples);
+
+	return r->period_ns ? 0 : -EIO;
+}
+
+/* Move a band down the page, so each frame changes the image */
+static void render_draw(struct render *r, unsigned int page,
+			unsigned int frame)
+{
+	unsigned int bytes_pp = (r->var.bits_per_pixel + 7) / 8;
+	unsigned int band = r->var.yres / 8, y, y0;
+	uint8_t *base = r->fb + page * r->var.yres * r->line_length;
+
+	y0 = (frame * 4) % (r->var.yres - band);
+	for (y = 0; y < r->var.yres; y++)
+		memset(base + y * r->line_length,
+		       y >= y0 && y < y0 + band ? 0xff : 0x00,
+		       r->var.xres * bytes_pp);
+}
+
+/* Stands in for game logic, a busy loop of work_us */
+static void render_work(struct render *r)
+{
+	uint64_t end = now_ns() + r->work_us * 1000ULL;
+
+	while (now_ns() < end)
+		;
+}
+
+static void *render_thread(void *arg)
+{
+	struct render *r = arg;
+	unsigned int frame, page = 0, n;
+	uint64_t prev = 0, t, dt;
+
+	for (frame = 0; !stop; frame++) {
+		if (r->pages > 1)
+			page ^= 1;
+
+		render_draw(r, page, frame);
+		render_work(r);
+
+		r->var.yoffset = page * r->var.yres;
+		if (ioctl(r->fd, FBIOPAN_DISPLAY, &r->var) < 0) {
+			perror("FBIOPAN_DISPLAY");
+			break;
+		}
+
+		t = render_wait_vblank(r);
+		if (!t) {
+			perror("FBIO_WAITFORVSYNC");
+			break;
+		}
+
+		if (prev) {
+			dt = t - prev;
+			stats_add(&r->frames, dt);
+			n = (dt + r->period_ns / 2) / r->period_ns;
+			if (n > 1)
+				r->missed += n - 1;
+		}
+		prev = t;
+	}
+
+	return NULL;
+}
+
+/* Audio */
+
+struct audio {
+	const char *path;
+	int fd;
+	unsigned int period;
+	unsigned int periods;
+	unsigned long written;
+	unsigned int xruns;
+	int error;
+};
+
+static void param_set_mask(struct snd_pcm_hw_params *p, int n,
+			   unsigned int bit)
+{
+	struct snd_mask *m = &p->masks[n - SNDRV_PCM_HW_PARAM_FIRST_MASK];
+
+	memset(m, 0, sizeof(*m));
+	m->bits[bit >> 5] |= 1U << (bit & 31);
+}
+
+static void param_set_int(struct snd_pcm_hw_params *p, int n,
+			  unsigned int val)
+{
+	struct snd_interval *i =
+		&p->intervals[n - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL];
+
+	i->min = val;
+	i->max = val;
+	i->integer = 1;
+}
+
+static unsigned int param_get_int(struct snd_pcm_hw_params *p, int n)
+{
+	return p->intervals[n - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].min;
+}
+
+static void param_init(struct snd_pcm_hw_params *p)
+{
+	int n;
+
+	memset(p, 0, sizeof(*p));
+	for (n = SNDRV_PCM_HW_PARAM_FIRST_MASK;
+	     n <= SNDRV_PCM_HW_PARAM_LAST_MASK; n++)
+		memset(&p->masks[n - SNDRV_PCM_HW_PARAM_FIRST_MASK], 0xff,
+		       sizeof(struct snd_mask));
+	for (n = SNDRV_PCM_HW_PARAM_FIRST_INTERVAL;
+	     n <= SNDRV_PCM_HW_PARAM_LAST_INTERVAL; n++)
+		p->intervals[n - SNDRV_PCM_HW_PARAM_FIRST_INTERVAL].max = ~0U;
+	p->rmask = ~0U;
+	p->info = ~0U;
+}
+
+static int audio_open(struct audio *a)
+{
+	struct snd_pcm_hw_params hw;
+	struct snd_pcm_sw_params sw;
+	unsigned long buffer;
+
+	a->fd = open(a->path, O_RDWR);
+	if (a->fd < 0)
+		return -errno;
+
+	param_init(&hw);
+	param_set_mask(&hw, SNDRV_PCM_HW_PARAM_ACCESS,
+		       SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+	param_set_mask(&hw, SNDRV_PCM_HW_PARAM_FORMAT,
+		       SNDRV_PCM_FORMAT_S16_LE);
+	param_set_mask(&hw, SNDRV_PCM_HW_PARAM_SUBFORMAT,
+		       SNDRV_PCM_SUBFORMAT_STD);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_SAMPLE_BITS, 16);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_FRAME_BITS,
+		      16 * AUDIO_CHANNELS);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_CHANNELS, AUDIO_CHANNELS);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_RATE, AUDIO_RATE);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_PERIOD_SIZE, AUDIO_PERIOD);
+	param_set_int(&hw, SNDRV_PCM_HW_PARAM_PERIODS, AUDIO_PERIODS);
+
+	if (ioctl(a->fd, SNDRV_PCM_IOCTL_HW_PARAMS, &hw) < 0)
+		return -errno;
+
+	a->period = param_get_int(&hw, SNDRV_PCM_HW_PARAM_PERIOD_SIZE);
+	a->periods = param_get_int(&hw, SNDRV_PCM_HW_PARAM_PERIODS);
+	buffer = (unsigned long)a->period * a->periods;
+
+	/* Start once the buffer is full, an empty buffer is an underrun */
+	memset(&sw, 0, sizeof(sw));
+	sw.tstamp_mode = SNDRV_PCM_TSTAMP_NONE;
+	sw.period_step = 1;
+	sw.avail_min = a->period;
+	sw.start_threshold = buffer;
+	sw.stop_threshold = buffer;
+	sw.boundary = buffer;
+	while (sw.boundary * 2 <= LONG_MAX - buffer)
+		sw.boundary *= 2;
+
+	if (ioctl(a->fd, SNDRV_PCM_IOCTL_SW_PARAMS, &sw) < 0 ||
+	    ioctl(a->fd, SNDRV_PCM_IOCTL_PREPARE) < 0)
+		return -errno;
+
+	return 0;
+}
+
+static void *audio_thread(void *arg)
+{
+	struct audio *a = arg;
+	struct snd_xferi x;
+	int16_t *buf;
+
+	buf = calloc(a->period, AUDIO_CHANNELS * sizeof(*buf));
+	if (!buf) {
+		a->error = -ENOMEM;
+		return NULL;
+	}
+
+	while (!stop) {
+		memset(&x, 0, sizeof(x));
+		x.buf = buf;
+		x.frames = a->period;
+
+		if (ioctl(a->fd, SNDRV_PCM_IOCTL_WRITEI_FRAMES, &x) == 0) {
+			a->written += x.frames;
+			continue;
+		}
+
+		if (errno != EPIPE) {
+			a->error = -errno;
+			break;
+		}
+
+		a->xruns++;
+		if (ioctl(a->fd, SNDRV_PCM_IOCTL_PREPARE) < 0) {
+			a->error = -errno;
+			break;
+		}
+	}
+
+	ioctl(a->fd, SNDRV_PCM_IOCTL_DROP);
+	free(buf);
+
+	return NULL;
+}
+
+/* Input */
+
+struct input {
+	const char *path;
+	int ufd;
+	int evfd;
+	uint64_t sent[INPUT_SLOTS];
+	unsigned int lost;
+	struct stats latency;
+};
+
+/* The evdev node is the eventN entry of the input device in sysfs */
+static int input_open_evdev(struct input *in)
+{
+	char sysname[64], path[PATH_MAX];
+	struct dirent *de;
+	DIR *dir;
+	int fd = -ENOENT;
+
+	if (ioctl(in->ufd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0)
+		return -errno;
+
+	snprintf(path, sizeof(path), "/sys/class/input/%s", sysname);
+	dir = opendir(path);
+	if (!dir)
+		return -errno;
+
+	while ((de = readdir(dir))) {
+		if (strncmp(de->d_name, "event", 5))
+			continue;
+		snprintf(path, sizeof(path), "/dev/input/%s", de->d_name);
+		fd = open(path, O_RDONLY | O_NONBLOCK);
+		if (fd < 0)
+			fd = -errno;
+		break;
+	}
+	closedir(dir);
+
+	return fd;
+}
+
+/*
+ * Only MSC_SCAN is reported, so nothing treats the device as a keyboard
+ * or a pad. The scan value carries a sequence number.
+ */
+static int input_open(struct input *in)
+{
+	struct uinput_setup setup;
+	int clk = CLOCK_MONOTONIC, fd = -ENOENT, retries;
+
+	in->ufd = open(in->path, O_WRONLY);
+	if (in->ufd < 0)
+		return -errno;
+
+	memset(&setup, 0, sizeof(setup));
+	setup.id.bustype = BUS_VIRTUAL;
+	strcpy(setup.name, "frame-pacing");
+
+	if (ioctl(in->ufd, UI_SET_EVBIT, EV_MSC) < 0 ||
+	    ioctl(in->ufd, UI_SET_MSCBIT, MSC_SCAN) < 0 ||
+	    ioctl(in->ufd, UI_DEV_SETUP, &setup) < 0 ||
+	    ioctl(in->ufd, UI_DEV_CREATE) < 0)
+		return -errno;
+
+	/* udev may take a moment to create the node */
+	for (retries = 0; retries < 50; retries++) {
+		fd = input_open_evdev(in);
+		if (fd >= 0)
+			break;
+		usleep(20000);
+	}
+	if (fd < 0)
+		return fd;
+
+	in->evfd = fd;
+	if (ioctl(in->evfd, EVIOCSCLOCKID, &clk) < 0)
+		return -errno;
+
+	return 0;
+}
+
+static void input_close(struct input *in)
+{
+	if (in->evfd >= 0)
+		close(in->evfd);
+	if (in->ufd >= 0) {
+		ioctl(in->ufd, UI_DEV_DESTROY);
+		close(in->ufd);
+	}
+}
+
+static void *input_inject_thread(void *arg)
+{
+	struct input *in = arg;
+	struct input_event ev[2];
+	struct timespec next;
+	unsigned int seq;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	for (seq = 0; !stop; seq++) {
+		memset(ev, 0, sizeof(ev));
+		ev[0].type = EV_MSC;
+		ev[0].code = MSC_SCAN;
+		ev[0].value = seq;
+		ev[1].type = EV_SYN;
+		ev[1].code = SYN_REPORT;
+
+		__atomic_store_n(&in->sent[seq % INPUT_SLOTS], now_ns(),
+				 __ATOMIC_RELEASE);
+		if (write(in->ufd, ev, sizeof(ev)) != sizeof(ev)) {
+			perror("uinput write");
+			break;
+		}
+
+		next.tv_nsec += INPUT_PERIOD_NS;
+		if (next.tv_nsec >= 1000000000L) {
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+
+	return NULL;
+}
+
+static void *input_read_thread(void *arg)
+{
+	struct pollfd pfd;
+	struct input *in = arg;
+	struct input_event ev;
+	unsigned int expect = 0, seq;
+	uint64_t t;
+
+	pfd.fd = in->evfd;
+	pfd.events = POLLIN;
+
+	while (!stop) {
+		if (poll(&pfd, 1, POLL_MS) <= 0)
+			continue;
+
+		t = now_ns();
+		while (read(in->evfd, &ev, sizeof(ev)) == sizeof(ev)) {
+			if (ev.type != EV_MSC || ev.code != MSC_SCAN)
+				continue;
+
+			seq = ev.value;
+			in->lost += seq - expect;
+			expect = seq + 1;
+			stats_add(&in->latency, t -
+				  __atomic_load_n(&in->sent[seq % INPUT_SLOTS],
+						  __ATOMIC_ACQUIRE));
+		}
+	}
+
+	return NULL;
+}
+
+static bool device_enabled(const char *path)
+{
+	return path && strcmp(path, "none");
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -d <dev>   frame buffer (default: /dev/fb0)\n"
+		"  -a <dev>   PCM playback device (default: /dev/snd/pcmC0D0p)\n"
+		"  -u <dev>   uinput device (default: /dev/uinput)\n"
+		"             a device set to \"none\" skips its part\n"
+		"  -s <sec>   duration (default: 10)\n"
+		"  -w <us>    CPU time spent per frame (default: 4000)\n"
+		"  -j         print the results as JSON\n"
+		"  -f <us>    fail if the 99th percentile frame time exceeds this\n"
+		"  -m <num>   fail if more vblanks are missed\n"
+		"  -x <num>   fail if there are more audio underruns\n"
+		"  -l <us>    fail if the 99th percentile input latency exceeds this\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	struct render r = {
+		.path = "/dev/fb0", .fd = -1, .work_us = 4000,
+		.frames = { .name = "frame time" },
+	};
+	struct audio a = { .path = "/dev/snd/pcmC0D0p", .fd = -1 };
+	struct input in = {
+		.path = "/dev/uinput", .ufd = -1, .evfd = -1,
+		.latency = { .name = "input latency" },
+	};
+	long max_missed = -1, max_xruns = -1;
+	uint64_t max_frame_ns = 0, max_input_ns = 0;
+	bool has_render, has_audio, has_input, json = false;
+	pthread_t render_tid, audio_tid, inject_tid, read_tid;
+	unsigned int seconds = 10;
+	int ret = KSFT_PASS, err, opt;
+
+	while ((opt = getopt(argc, argv, "d:a:u:s:w:jf:m:x:l:h")) != -1) {
+		switch (opt) {
+		case 'd':
+			r.path = optarg;
+			break;
+		case 'a':
+			a.path = optarg;
+			break;
+		case 'u':
+			in.path = optarg;
+			break;
+		case 's':
+			seconds = atoi(optarg);
+			break;
+		case 'w':
+			r.work_us = atoi(optarg);
+			break;
+		case 'j':
+			json = true;
+			break;
+		case 'f':
+			max_frame_ns = strtoull(optarg, NULL, 0) * 1000ULL;
+			break;
+		case 'm':
+			max_missed = atol(optarg);
+			break;
+		case 'x':
+			max_xruns = atol(optarg);
+			break;
+		case 'l':
+			max_input_ns = strtoull(optarg, NULL, 0) * 1000ULL;
+			break;
+		default:
+			usage(argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	has_render = device_enabled(r.path);
+	if (has_render) {
+		err = render_open(&r);
+		if (!err)
+			err = render_probe_period(&r);
+		if (err) {
+			fprintf(stderr, "%s: %s, skipping render\n", r.path,
+				strerror(-err));
+			has_render = false;
+		}
+	}
+
+	has_audio = device_enabled(a.path);
+	if (has_audio) {
+		err = audio_open(&a);
+		if (err) {
+			fprintf(stderr, "%s: %s, skipping audio\n", a.path,
+				strerror(-err));
+			has_audio = false;
+		}
+	}
+
+	has_input = device_enabled(in.path);
+	if (has_input) {
+		err = input_open(&in);
+		if (err) {
+			fprintf(stderr, "%s: %s, skipping input\n", in.path,
+				strerror(-err));
+			has_input = false;
+		}
+	}
+
+	if (!has_render && !has_audio && !has_input) {
+		ret = KSFT_SKIP;
+		goto out;
+	}
+
+	if (has_render)
+		pthread_create(&render_tid, NULL, render_thread, &r);
+	if (has_audio)
+		pthread_create(&audio_tid, NULL, audio_thread, &a);
+	if (has_input) {
+		pthread_create(&read_tid, NULL, input_read_thread, &in);
+		pthread_create(&inject_tid, NULL, input_inject_thread, &in);
+	}
+
+	sleep(seconds);
+	stop = true;
+
+	if (has_render)
+		pthread_join(render_tid, NULL);
+	if (has_audio)
+		pthread_join(audio_tid, NULL);
+	if (has_input) {
+		pthread_join(inject_tid, NULL);
+		pthread_join(read_tid, NULL);
+	}
+
+	stats_sort(&r.frames);
+	stats_sort(&in.latency);
+
+	if (json) {
+		printf("{\"duration_s\":%u", seconds);
+		if (has_render) {
+			printf(",\"refresh_us\":%.1f,\"pages\":%u,",
+			       r.period_ns / 1000.0, r.pages);
+			stats_json("frame_time", &r.frames);
+			printf(",\"missed_vblanks\":%u", r.missed);
+		}
+		if (has_audio)
+			printf(",\"audio_frames\":%lu,\"audio_xruns\":%u",
+			       a.written, a.xruns);
+		if (has_input) {
+			printf(",");
+			stats_json("input_latency", &in.latency);
+			printf(",\"input_lost\":%u", in.lost);
+		}
+		printf("}\n");
+	} else {
+		if (has_render) {
+			printf("refresh period %.1f us, %u page(s)\n",
+			       r.period_ns / 1000.0, r.pages);
+			stats_print(&r.frames);
+			printf("missed vblanks: %u\n", r.missed);
+		}
+		if (has_audio)
+			printf("audio: %lu frames, %u underruns\n",
+			       a.written, a.xruns);
+		if (has_input) {
+			stats_print(&in.latency);
+			printf("input events lost: %u\n", in.lost);
+		}
+	}
+
+	if (has_render && (!r.frames.count ||
+			   (max_frame_ns &&
+			    percentile(&r.frames, 99) > max_frame_ns) ||
+			   (max_missed >= 0 && r.missed > max_missed)))
+		ret = KSFT_FAIL;
+	if (has_audio && (a.error ||
+			  (max_xruns >= 0 && a.xruns > max_xruns)))
+		ret = KSFT_FAIL;
+	if (has_input && (!in.latency.count || in.lost ||
+			  (max_input_ns &&
+			   percentile(&in.latency, 99) > max_input_ns)))
+		ret = KSFT_FAIL;
+
+out:
+	render_close(&r);
+	if (a.fd >= 0)
+		close(a.fd);
+	input_close(&in);
+	free(r.frames.samples);
+	free(in.latency.samples);
+
+	return ret;
+}
@@ -0,0 +1,418 @@
+/*
+ * Input to display latency benchmark
+ *
+ * Drives a GPIO line which is looped back to a button input, waits for the
+ * key event on the evdev node, draws into the frame buffer and waits for the
+ * vblank which scans it out. The delays from the GPIO edge to the event and
+ * to the vblank are collected over many iterations and reported as
+ * distributions, so regressions anywhere in the input, scheduler or display
+ * paths show up.
+ *
+ * With a DRM device the vblank timestamp comes from DRM_IOCTL_WAIT_VBLANK,
+ * with an fbdev device it is taken when FBIO_WAITFORVSYNC returns and thus
+ * includes the wakeup latency of this process.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License version 2 as published by
+ * the Free Software Foundation.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/fb.h>
+#include <linux/gpio.h>
+#include <linux/input.h>
+#include <drm/drm.h>
+
+#define KSFT_PASS	0
+#define KSFT_FAIL	1
+#define KSFT_SKIP	4
+
+#define EVENT_TIMEOUT_MS	1000
+#define SETTLE_US		20000
+#define NUM_BUCKETS		16
+
+struct stats {
+	const char *name;
+	uint64_t *samples;
+	unsigned int count;
+};
+
+static uint64_t ts_to_ns(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+static uint64_t tv_to_ns(long sec, long usec)
+{
+	return (uint64_t)sec * 1000000000ULL + (uint64_t)usec * 1000ULL;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts_to_ns(&ts);
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t percentile(const struct stats *s, unsigned int pct)
+{
+	unsigned int idx = (s->count - 1) * pct / 100;
+
+	return s->samples[idx];
+}
+
+/* Sorts the samples, returns the 99th percentile in ns */
+static uint64_t report(struct stats *s)
+{
+	unsigned int buckets[NUM_BUCKETS] = { 0 };
+	uint64_t sum = 0;
+	unsigned int i, b;
+
+	if (!s->count) {
+		printf("%s: no samples\n", s->name);
+		return 0;
+	}
+
+	qsort(s->samples, s->count, sizeof(*s->samples), cmp_u64);
+
+	for (i = 0; i < s->count; i++) {
+		uint64_t us = s->samples[i] / 1000;
+
+		sum += s->samples[i];
+		/* bucket b holds [2^(b-1), 2^b) us, the last one the rest */
+		for (b = 0; b < NUM_BUCKETS - 1 && us >= (1ULL << b); b++)
+			;
+		buckets[b]++;
+	}
+
+	printf("%s latency over %u samples (us):\n", s->name, s->count);
+	printf("  min %.1f  mean %.1f  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+	       s->samples[0] / 1000.0, sum / s->count / 1000.0,
+	       percentile(s, 50) / 1000.0, percentile(s, 90) / 1000.0,
+	       percentile(s, 99) / 1000.0, s->samples[s->count - 1] / 1000.0);
+
+	for (b = 0; b < NUM_BUCKETS; b++) {
+		if (!buckets[b])
+			continue;
+		if (b == NUM_BUCKETS - 1)
+			printf("  >= %6llu us: %u\n", 1ULL << (b - 1),
+			       buckets[b]);
+		else
+			printf("  < %7llu us: %u\n", 1ULL << b, buckets[b]);
+	}
+
+	return percentile(s, 99);
+}
+
+static int gpio_request_output(const char *chip, unsigned int line)
+{
+	struct gpiohandle_request req;
+	int fd, ret;
+
+	fd = open(chip, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+
+	memset(&req, 0, sizeof(req));
+	req.lineoffsets[0] = line;
+	req.lines = 1;
+	req.flags = GPIOHANDLE_REQUEST_OUTPUT;
+	strcpy(req.consumer_label, "input-latency");
+
+	ret = ioctl(fd, GPIO_GET_LINEHANDLE_IOCTL, &req);
+	if (ret < 0)
+		ret = -errno;
+	close(fd);
+
+	return ret < 0 ? ret : req.fd;
+}
+
+static int gpio_set(int fd, int value)
+{
+	struct gpiohandle_data data;
+
+	memset(&data, 0, sizeof(data));
+	data.values[0] = value;
+
+	return ioctl(fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data);
+}
+
+static void drain_events(int fd)
+{
+	struct input_event ev;
+
+	while (read(fd, &ev, sizeof(ev)) == sizeof(ev))
+		;
+}
+
+/*
+ * Wait for a key event with the given value, code -1 matches any key.
+ * Returns the event timestamp in ns or 0 on timeout.
+ */
+static uint64_t wait_key(int fd, int code, int value)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	struct input_event ev;
+
+	for (;;) {
+		if (poll(&pfd, 1, EVENT_TIMEOUT_MS) <= 0)
+			return 0;
+
+		while (read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+			if (ev.type != EV_KEY || ev.value != value)
+				continue;
+			if (code >= 0 && ev.code != code)
+				continue;
+			return tv_to_ns(ev.time.tv_sec, ev.time.tv_usec);
+		}
+	}
+}
+
+struct display {
+	int fd;
+	bool drm;
+	uint8_t *fb;
+	size_t fb_size;
+	uint32_t line_length;
+	uint32_t bytes_pp;
+};
+
+static int display_open(struct display *d, const char *path)
+{
+	struct fb_var_screeninfo var;
+	struct fb_fix_screeninfo fix;
+
+	d->fd = open(path, O_RDWR);
+	if (d->fd < 0)
+		return -errno;
+
+	d->drm = strstr(path, "/dri/") != NULL;
+	if (d->drm)
+		return 0;
+
+	if (ioctl(d->fd, FBIOGET_FSCREENINFO, &fix) < 0 ||
+	    ioctl(d->fd, FBIOGET_VSCREENINFO, &var) < 0)
+		return -errno;
+
+	d->line_length = fix.line_length;
+	d->bytes_pp = (var.bits_per_pixel + 7) / 8;
+	d->fb_size = fix.smem_len;
+	d->fb = mmap(NULL, d->fb_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		     d->fd, 0);
+	if (d->fb == MAP_FAILED) {
+		d->fb = NULL;
+		return -errno;
+	}
+
+	return 0;
+}
+
+/* Toggle a 32x32 block in the corner, so every iteration changes the image */
+static void display_draw(struct display *d, unsigned int iter)
+{
+	unsigned int y;
+
+	if (!d->fb)
+		return;
+
+	for (y = 0; y < 32; y++)
+		memset(d->fb + y * d->line_length, iter & 1 ? 0xff : 0x00,
+		       32 * d->bytes_pp);
+}
+
+/* Returns the timestamp of the next vblank in ns or 0 on error */
+static uint64_t display_wait_vblank(struct display *d)
+{
+	if (d->drm) {
+		union drm_wait_vblank vbl;
+
+		memset(&vbl, 0, sizeof(vbl));
+		vbl.request.type = _DRM_VBLANK_RELATIVE;
+		vbl.request.sequence = 1;
+		if (ioctl(d->fd, DRM_IOCTL_WAIT_VBLANK, &vbl) < 0)
+			return 0;
+		/* DRM vblank timestamps are CLOCK_MONOTONIC */
+		return tv_to_ns(vbl.reply.tval_sec, vbl.reply.tval_usec);
+	} else {
+		uint32_t crtc = 0;
+
+		if (ioctl(d->fd, FBIO_WAITFORVSYNC, &crtc) < 0)
+			return 0;
+		return now_ns();
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s -g <gpiochip> -l <line> -e <event> [options]\n"
+		"  -g <dev>   gpiochip with the output looped back to the button\n"
+		"  -l <line>  offset of the output line on the gpiochip\n"
+		"  -e <dev>   evdev node of the button\n"
+		"  -k <code>  key code of the button (default: any key)\n"
+		"  -a         the button is active low, drive the line low to press\n"
+		"  -d <dev>   frame buffer (/dev/fbN) or DRM (/dev/dri/cardN) device\n"
+		"  -n <num>   number of iterations (default: 200)\n"
+		"  -t <us>    fail if the 99th percentile exceeds this latency\n",
+		prog);
+}
+
+int main(int argc, char **argv)
+{
+	const char *chip = NULL, *event = NULL, *disp_path = NULL;
+	struct stats input = { .name = "GPIO edge to evdev event" };
+	struct stats display = { .name = "GPIO edge to vblank" };
+	struct display d = { .fd = -1 };
+	unsigned int iterations = 200, i;
+	uint64_t limit_ns = 0, p99;
+	int line = -1, code = -1, active_low = 0;
+	int gpio_fd, ev_fd, clk = CLOCK_MONOTONIC;
+	int ret = KSFT_PASS;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "g:l:e:k:ad:n:t:h")) != -1) {
+		switch (opt) {
+		case 'g':
+			chip = optarg;
+			break;
+		case 'l':
+			line = atoi(optarg);
+			break;
+		case 'e':
+			event = optarg;
+			break;
+		case 'k':
+			code = atoi(optarg);
+			break;
+		case 'a':
+			active_low = 1;
+			break;
+		case 'd':
+			disp_path = optarg;
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 't':
+			limit_ns = strtoull(optarg, NULL, 0) * 1000ULL;
+			break;
+		default:
+			usage(argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	/* Needs a board with a loopback wired up, skip when not configured */
+	if (!chip || line < 0 || !event || !iterations) {
+		usage(argv[0]);
+		return KSFT_SKIP;
+	}
+
+	gpio_fd = gpio_request_output(chip, line);
+	if (gpio_fd < 0) {
+		fprintf(stderr, "%s line %d: %s\n", chip, line,
+			strerror(-gpio_fd));
+		return KSFT_SKIP;
+	}
+
+	ev_fd = open(event, O_RDONLY | O_NONBLOCK);
+	if (ev_fd < 0) {
+		perror(event);
+		return KSFT_SKIP;
+	}
+
+	if (ioctl(ev_fd, EVIOCSCLOCKID, &clk) < 0) {
+		perror("EVIOCSCLOCKID");
+		return KSFT_FAIL;
+	}
+
+	if (disp_path) {
+		int err = display_open(&d, disp_path);
+
+		if (err) {
+			fprintf(stderr, "%s: %s\n", disp_path, strerror(-err));
+			return KSFT_SKIP;
+		}
+	}
+
+	input.samples = calloc(iterations, sizeof(*input.samples));
+	display.samples = calloc(iterations, sizeof(*display.samples));
+	if (!input.samples || !display.samples)
+		return KSFT_FAIL;
+
+	for (i = 0; i < iterations; i++) {
+		uint64_t t0, t_ev, t_vbl;
+
+		/* release the button and let it settle */
+		gpio_set(gpio_fd, active_low);
+		usleep(SETTLE_US);
+		drain_events(ev_fd);
+
+		t0 = now_ns();
+		if (gpio_set(gpio_fd, !active_low) < 0) {
+			perror("GPIOHANDLE_SET_LINE_VALUES_IOCTL");
+			ret = KSFT_FAIL;
+			break;
+		}
+
+		t_ev = wait_key(ev_fd, code, 1);
+		if (!t_ev) {
+			fprintf(stderr, "iteration %u: no key press event\n",
+				i);
+			ret = KSFT_FAIL;
+			break;
+		}
+		input.samples[input.count++] = t_ev > t0 ? t_ev - t0 : 0;
+
+		if (d.fd < 0)
+			continue;
+
+		display_draw(&d, i);
+		t_vbl = display_wait_vblank(&d);
+		if (!t_vbl) {
+			perror("wait for vblank");
+			ret = KSFT_FAIL;
+			break;
+		}
+		display.samples[display.count++] = t_vbl > t0 ? t_vbl - t0 : 0;
+	}
+
+	gpio_set(gpio_fd, active_low);
+
+	p99 = report(&input);
+	if (limit_ns && p99 > limit_ns)
+		ret = KSFT_FAIL;
+
+	if (d.fd >= 0) {
+		p99 = report(&display);
+		if (limit_ns && p99 > limit_ns)
+			ret = KSFT_FAIL;
+	}
+
+	if (ret == KSFT_FAIL && limit_ns)
+		printf("latency limit %llu us\n",
+		       (unsigned long long)(limit_ns / 1000));
+
+	return ret;
+}
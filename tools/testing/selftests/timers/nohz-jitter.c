@@ -0,0 +1,217 @@
+/* Measure the jitter a CPU sees from the tick and other interruptions
+ *		(C) Copyright 2017
+ *		Licensed under the GPLv2
+ *
+ *  To build:
+ *	$ gcc nohz-jitter.c -o nohz-jitter -lrt
+ *
+ *  The test pins itself to one CPU, the last one by default, and spins
+ *  reading CLOCK_MONOTONIC. Every gap between two reads longer than the
+ *  threshold is time the CPU spent elsewhere, in the tick or any other
+ *  interrupt. With -p it instead wakes up periodically with an absolute
+ *  clock_nanosleep(), like cyclictest, and measures the wakeup latency.
+ *
+ *  Run it on a CPU booted with nohz_full=<cpu> rcu_nocbs=<cpu> and on one
+ *  without, the interruption count and the worst gap should go down.
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef KTEST
+#include "../kselftest.h"
+#else
+static inline int ksft_exit_pass(void)
+{
+	exit(0);
+}
+static inline int ksft_exit_fail(void)
+{
+	exit(1);
+}
+#endif
+
+#define NSEC_PER_SEC	1000000000ULL
+#define NSEC_PER_USEC	1000ULL
+
+/* Histogram of the gaps, in usecs, the last bucket takes the rest */
+#define HIST_BUCKETS	32
+
+static unsigned long long hist[HIST_BUCKETS];
+
+static unsigned long long ts_ns(struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts_ns(&ts);
+}
+
+static void hist_add(unsigned long long ns)
+{
+	unsigned long long us = ns / NSEC_PER_USEC;
+
+	hist[us < HIST_BUCKETS ? us : HIST_BUCKETS - 1]++;
+}
+
+static void hist_print(void)
+{
+	int i;
+
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		printf("  %s%3d us: %llu\n", i == HIST_BUCKETS - 1 ? ">=" : "  ",
+		       i, hist[i]);
+	}
+}
+
+/* Spin and record the gaps between two reads of the clock */
+static unsigned long long spin(unsigned long long duration,
+			       unsigned long long threshold,
+			       unsigned long long *count)
+{
+	unsigned long long start, prev, now, gap, max = 0;
+
+	start = prev = now_ns();
+	while (prev - start < duration) {
+		now = now_ns();
+		gap = now - prev;
+		if (gap > threshold) {
+			(*count)++;
+			hist_add(gap);
+			if (gap > max)
+				max = gap;
+		}
+		prev = now;
+	}
+
+	return max;
+}
+
+/* Sleep until the next period and record how late the wakeup is */
+static unsigned long long periodic(unsigned long long duration,
+				   unsigned long long period,
+				   unsigned long long *count)
+{
+	unsigned long long start, next, late, max = 0;
+	struct timespec ts;
+
+	start = next = now_ns();
+	while (next - start < duration) {
+		next += period;
+		ts.tv_sec = next / NSEC_PER_SEC;
+		ts.tv_nsec = next % NSEC_PER_SEC;
+		if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))
+			continue;
+
+		late = now_ns() - next;
+		(*count)++;
+		hist_add(late);
+		if (late > max)
+			max = late;
+	}
+
+	return max;
+}
+
+static void usage(const char *prog)
+{
+	printf("Usage: %s [-c cpu] [-d secs] [-t threshold_us] [-p period_us]"
+	       " [-l limit_us]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long duration = 10 * NSEC_PER_SEC;
+	unsigned long long threshold = 2 * NSEC_PER_USEC;
+	unsigned long long period = 0, limit = 0;
+	unsigned long long max, count = 0;
+	int cpu = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+	struct sched_param param = { .sched_priority = 1 };
+	cpu_set_t set;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:d:t:p:l:h")) != -1) {
+		switch (opt) {
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'd':
+			duration = strtoull(optarg, NULL, 0) * NSEC_PER_SEC;
+			break;
+		case 't':
+			threshold = strtoull(optarg, NULL, 0) * NSEC_PER_USEC;
+			break;
+		case 'p':
+			period = strtoull(optarg, NULL, 0) * NSEC_PER_USEC;
+			break;
+		case 'l':
+			limit = strtoull(optarg, NULL, 0) * NSEC_PER_USEC;
+			break;
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!duration) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set)) {
+		printf("Cannot run on CPU%d: %s\n", cpu, strerror(errno));
+		return ksft_exit_fail();
+	}
+
+	/* Not being real time is fine, only the numbers get worse */
+	if (sched_setscheduler(0, SCHED_FIFO, &param))
+		printf("Running as SCHED_OTHER: %s\n", strerror(errno));
+
+	if (period) {
+		printf("Wakeup latency on CPU%d, %llu us period, %llu s:\n",
+		       cpu, period / NSEC_PER_USEC, duration / NSEC_PER_SEC);
+		max = periodic(duration, period, &count);
+		printf("%llu wakeups, max latency %llu us\n",
+		       count, max / NSEC_PER_USEC);
+	} else {
+		printf("Interruptions longer than %llu us on CPU%d, %llu s:\n",
+		       threshold / NSEC_PER_USEC, cpu,
+		       duration / NSEC_PER_SEC);
+		max = spin(duration, threshold, &count);
+		printf("%llu interruptions (%llu/s), max gap %llu us\n",
+		       count, count * NSEC_PER_SEC / duration,
+		       max / NSEC_PER_USEC);
+	}
+	hist_print();
+
+	if (limit && max > limit) {
+		printf("[FAILED]\n");
+		return ksft_exit_fail();
+	}
+	printf("[OK]\n");
+	return ksft_exit_pass();
+}